@@ -203,6 +203,41 @@ public:
     /// \param[out] report [optional] collision report to be filled with data about the collision.
     virtual bool CheckStandaloneSelfCollision(KinBody::LinkConstPtr plink, CollisionReportPtr report = CollisionReportPtr()) = 0;
 
+    /// \brief checks a list of (link, body) pairs, every pair gives the same result as CheckCollision(plink, pbody).
+    ///
+    /// Checkers can share the broadphase and the narrowphase of link pairs between the queries. The default implementation checks the pairs one by one.
+    /// \param[in] vqueries the link and body of every query
+    /// \param[out] vresults set to 1 for every query whose link is colliding with its body, 0 otherwise
+    /// \return true if any of the queries is in collision
+    virtual bool CheckCollisionBatch(const std::vector<std::pair<KinBody::LinkConstPtr, KinBodyConstPtr> >& vqueries, std::vector<uint8_t>& vresults)
+    {
+        vresults.resize(vqueries.size());
+        bool bCollision = false;
+        for(size_t i = 0; i < vqueries.size(); ++i) {
+            vresults[i] = CheckCollision(vqueries[i].first, vqueries[i].second);
+            bCollision |= !!vresults[i];
+        }
+        return bCollision;
+    }
+
+    /// \brief Checks if the body collides with the environment while its dof values move linearly between two configurations.
+    ///
+    /// The motion is vdofvalues0 + t*(vdofvalues1 - vdofvalues0) for t in [0,1], where the difference is computed with
+    /// KinBody::SubtractDOFValues so circular joints take the shortest way. The base transformation of the body does not
+    /// change and the bodies attached to it move with their links. Self collisions are not checked. The state of the body
+    /// is restored before returning. Because implementations are conservative, a collision is reported as soon as the body
+    /// comes closer to the environment than ftolerance.
+    /// \param[in] pbody the body to move
+    /// \param[in] vdofvalues0 the dof values at t=0, size is pbody->GetDOF()
+    /// \param[in] vdofvalues1 the dof values at t=1, size is pbody->GetDOF()
+    /// \param[in] ftolerance distance to the environment below which the body is considered in collision, has to be > 0. Smaller tolerances need more iterations.
+    /// \param[out] fcollisiontime if in collision, the earliest t in [0,1] where the collision was detected
+    /// \param[out] report [optional] collision report to be filled with data about the collision.
+    /// \return 0 if the motion is collision free, 1 if it collides, -1 if the checker does not support the query for this body. In the last case the motion has to be discretized and checked with \ref CheckCollision.
+    virtual int CheckContinuousCollision(KinBodyPtr pbody, const std::vector<dReal>& vdofvalues0, const std::vector<dReal>& vdofvalues1, dReal ftolerance, dReal& fcollisiontime, CollisionReportPtr report = CollisionReportPtr()) {
+        return -1;
+    }
+
     /// \deprecated (13/04/09)
     virtual bool CheckSelfCollision(KinBodyConstPtr pbody, CollisionReportPtr report = CollisionReportPtr()) RAVE_DEPRECATED
     {
@@ -17,7 +17,7 @@
 /** \file   geometry.h
     \brief  Basic gemoetric primitives and affine math functions on them.
 
-    This file can be used stand-alone without \ref openrave.h .
+    This file can be used stand-alone without \ref openrave.h , it only needs the generated openrave/config.h.
  */
 #ifndef OPENRAVE_GEOMETRY_H
 #define OPENRAVE_GEOMETRY_H
@@ -29,6 +29,26 @@
 #include <utility> // for std::pair
 #include <cstdlib>
 
+#include <openrave/config.h>
+
+// The SIMD specializations below are inline, so the instruction set is the build-wide OPENRAVE_MATH_SIMD setting of
+// config.h rather than the flags of the including translation unit. A translation unit that cannot compile the
+// configured instruction set is an error instead of silently falling back to different definitions.
+#if OPENRAVE_MATH_SIMD >= 1
+#if !defined(__SSE2__) && !defined(_M_X64) && !(defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#error "openrave was configured with OPENRAVE_MATH_SIMD >= 1, compile with SSE2 enabled"
+#endif
+#define OPENRAVE_MATH_USE_SSE2
+#include <emmintrin.h>
+#if OPENRAVE_MATH_SIMD >= 2
+#ifndef __AVX__
+#error "openrave was configured with OPENRAVE_MATH_SIMD=2, compile with AVX enabled (-mavx)"
+#endif
+#define OPENRAVE_MATH_USE_AVX
+#include <immintrin.h>
+#endif
+#endif
+
 #ifndef RAVE_DEPRECATED
 #define RAVE_DEPRECATED
 #endif
@@ -2421,6 +2441,270 @@ T DistVertexOBBSq(const RaveVector<T>& v, const obb<T>& o)
     return fDist;
 }
 
+/// \brief Transforms an array of points, poutpoints[i] = t * pinpoints[i].
+///
+/// \ingroup affine_math
+/// The input and output arrays can be the same, but t should not point inside the output array.
+template <typename T>
+inline void transformPoints(const RaveTransform<T>& t, const RaveVector<T>* pinpoints, RaveVector<T>* poutpoints, size_t numpoints)
+{
+    for(size_t i = 0; i < numpoints; ++i) {
+        poutpoints[i] = t * pinpoints[i];
+    }
+}
+
+/// \brief Composes a transform with an array of transforms, pouttransforms[i] = t * pintransforms[i].
+///
+/// \ingroup affine_math
+/// The input and output arrays can be the same, but t should not point inside the output array.
+template <typename T>
+inline void multiplyTransforms(const RaveTransform<T>& t, const RaveTransform<T>* pintransforms, RaveTransform<T>* pouttransforms, size_t numtransforms)
+{
+    for(size_t i = 0; i < numtransforms; ++i) {
+        pouttransforms[i] = t * pintransforms[i];
+    }
+}
+
+/// \brief Composes two arrays of transforms element-wise, pouttransforms[i] = plefttransforms[i] * prighttransforms[i].
+///
+/// \ingroup affine_math
+/// The output array can be the same as either of the input arrays.
+template <typename T>
+inline void multiplyTransforms(const RaveTransform<T>* plefttransforms, const RaveTransform<T>* prighttransforms, RaveTransform<T>* pouttransforms, size_t numtransforms)
+{
+    for(size_t i = 0; i < numtransforms; ++i) {
+        pouttransforms[i] = plefttransforms[i] * prighttransforms[i];
+    }
+}
+
+#ifdef OPENRAVE_MATH_USE_SSE2
+
+/// \brief SSE2/AVX kernels behind the float and double specializations of the transform and quaternion products.
+///
+/// Every kernel performs the same multiplies and additions in the same order as the generic templates
+/// (no fused multiply-add, signs are flipped on the products), so the results are bit-exact with the scalar path.
+namespace simd {
+
+/// \brief the rotation matrix of quaternion rot in column order, computed exactly like RaveTransform::rotate
+template <typename T>
+inline void GetRotationColumns(const RaveVector<T>& rot, T* pcolumns)
+{
+    T xx = 2 * rot.y * rot.y;
+    T xy = 2 * rot.y * rot.z;
+    T xz = 2 * rot.y * rot.w;
+    T xw = 2 * rot.y * rot.x;
+    T yy = 2 * rot.z * rot.z;
+    T yz = 2 * rot.z * rot.w;
+    T yw = 2 * rot.z * rot.x;
+    T zz = 2 * rot.w * rot.w;
+    T zw = 2 * rot.w * rot.x;
+    pcolumns[0] = 1-yy-zz; pcolumns[1] = xy+zw; pcolumns[2] = xz-yw;
+    pcolumns[3] = xy-zw; pcolumns[4] = 1-xx-zz; pcolumns[5] = yz+xw;
+    pcolumns[6] = xz+yw; pcolumns[7] = yz-xw; pcolumns[8] = 1-xx-yy;
+}
+
+/// \brief qout = q0 * q1 with quaternions stored as (s,vx,vy,vz)
+inline void QuatMultiply(const double* q0, const double* q1, double* qout)
+{
+    const __m128d negatelow = _mm_set_pd(0.0, -0.0);
+    __m128d a01 = _mm_loadu_pd(q0), a23 = _mm_loadu_pd(q0+2);
+    __m128d b01 = _mm_loadu_pd(q1), b23 = _mm_loadu_pd(q1+2);
+    __m128d ax = _mm_unpacklo_pd(a01,a01);
+    __m128d lo = _mm_mul_pd(ax,b01), hi = _mm_mul_pd(ax,b23);
+    // (-q0.y*q1.y, q0.y*q1.x), (q0.z*q1.x, q0.w*q1.x)
+    lo = _mm_add_pd(lo, _mm_xor_pd(_mm_mul_pd(_mm_unpackhi_pd(a01,a01), _mm_shuffle_pd(b01,b01,1)), negatelow));
+    hi = _mm_add_pd(hi, _mm_mul_pd(a23, _mm_unpacklo_pd(b01,b01)));
+    // (-q0.z*q1.z, q0.z*q1.w), (q0.w*q1.y, q0.y*q1.z)
+    lo = _mm_add_pd(lo, _mm_xor_pd(_mm_mul_pd(_mm_unpacklo_pd(a23,a23), b23), negatelow));
+    hi = _mm_add_pd(hi, _mm_mul_pd(_mm_shuffle_pd(a23,a01,3), _mm_shuffle_pd(b01,b23,1)));
+    // (q0.w*q1.w, q0.w*q1.z), (q0.y*q1.w, q0.z*q1.y) are all subtracted
+    lo = _mm_sub_pd(lo, _mm_mul_pd(_mm_unpackhi_pd(a23,a23), _mm_shuffle_pd(b23,b23,1)));
+    hi = _mm_sub_pd(hi, _mm_mul_pd(_mm_shuffle_pd(a01,a23,1), _mm_shuffle_pd(b23,b01,3)));
+    _mm_storeu_pd(qout, lo);
+    _mm_storeu_pd(qout+2, hi);
+}
+
+/// \brief qout = q0 * q1 with quaternions stored as (s,vx,vy,vz)
+inline void QuatMultiply(const float* q0, const float* q1, float* qout)
+{
+    const __m128 negatex = _mm_set_ps(0.0f, 0.0f, 0.0f, -0.0f);
+    __m128 a = _mm_loadu_ps(q0), b = _mm_loadu_ps(q1);
+    __m128 q = _mm_mul_ps(_mm_shuffle_ps(a,a,_MM_SHUFFLE(0,0,0,0)), b);
+    // (-q0.y*q1.y, q0.y*q1.x, q0.z*q1.x, q0.w*q1.x)
+    q = _mm_add_ps(q, _mm_xor_ps(_mm_mul_ps(_mm_shuffle_ps(a,a,_MM_SHUFFLE(3,2,1,1)), _mm_shuffle_ps(b,b,_MM_SHUFFLE(0,0,0,1))), negatex));
+    // (-q0.z*q1.z, q0.z*q1.w, q0.w*q1.y, q0.y*q1.z)
+    q = _mm_add_ps(q, _mm_xor_ps(_mm_mul_ps(_mm_shuffle_ps(a,a,_MM_SHUFFLE(1,3,2,2)), _mm_shuffle_ps(b,b,_MM_SHUFFLE(2,1,3,2))), negatex));
+    // (q0.w*q1.w, q0.w*q1.z, q0.y*q1.w, q0.z*q1.y) are all subtracted
+    q = _mm_sub_ps(q, _mm_mul_ps(_mm_shuffle_ps(a,a,_MM_SHUFFLE(2,1,3,3)), _mm_shuffle_ps(b,b,_MM_SHUFFLE(1,3,2,3))));
+    _mm_storeu_ps(qout, q);
+}
+
+/// \brief holds the rotation columns and translation of a transform in registers to transform many points
+class PointTransformerDouble
+{
+public:
+    PointTransformerDouble(const RaveTransform<double>& t) {
+        double m[9];
+        GetRotationColumns(t.rot, m);
+#ifdef OPENRAVE_MATH_USE_AVX
+        _c0 = _mm256_set_pd(0, m[2], m[1], m[0]); _c1 = _mm256_set_pd(0, m[5], m[4], m[3]); _c2 = _mm256_set_pd(0, m[8], m[7], m[6]);
+        _trans = _mm256_loadu_pd(&t.trans.x);
+#else
+        _c0lo = _mm_set_pd(m[1], m[0]); _c0hi = _mm_set_pd(0, m[2]);
+        _c1lo = _mm_set_pd(m[4], m[3]); _c1hi = _mm_set_pd(0, m[5]);
+        _c2lo = _mm_set_pd(m[7], m[6]); _c2hi = _mm_set_pd(0, m[8]);
+        _translo = _mm_loadu_pd(&t.trans.x); _transhi = _mm_loadu_pd(&t.trans.z);
+#endif
+        // the scalar path computes trans.w + 0
+        _transw = t.trans.w + 0.0;
+    }
+
+    /// \brief vout = t * v, v and vout can be the same
+    inline void Transform(const RaveVector<double>& v, RaveVector<double>& vout) const {
+#ifdef OPENRAVE_MATH_USE_AVX
+        __m256d r = _mm256_add_pd(_mm256_mul_pd(_c0, _mm256_broadcast_sd(&v.x)), _mm256_mul_pd(_c1, _mm256_broadcast_sd(&v.y)));
+        r = _mm256_add_pd(r, _mm256_mul_pd(_c2, _mm256_broadcast_sd(&v.z)));
+        _mm256_storeu_pd(&vout.x, _mm256_add_pd(_trans, r));
+#else
+        __m128d x = _mm_set1_pd(v.x), y = _mm_set1_pd(v.y), z = _mm_set1_pd(v.z);
+        __m128d lo = _mm_add_pd(_mm_mul_pd(_c0lo,x), _mm_mul_pd(_c1lo,y));
+        __m128d hi = _mm_add_pd(_mm_mul_pd(_c0hi,x), _mm_mul_pd(_c1hi,y));
+        lo = _mm_add_pd(lo, _mm_mul_pd(_c2lo,z));
+        hi = _mm_add_pd(hi, _mm_mul_pd(_c2hi,z));
+        _mm_storeu_pd(&vout.x, _mm_add_pd(_translo, lo));
+        _mm_storeu_pd(&vout.z, _mm_add_pd(_transhi, hi));
+#endif
+        vout.w = _transw;
+    }
+
+private:
+#ifdef OPENRAVE_MATH_USE_AVX
+    __m256d _c0, _c1, _c2, _trans;
+#else
+    __m128d _c0lo, _c0hi, _c1lo, _c1hi, _c2lo, _c2hi, _translo, _transhi;
+#endif
+    double _transw;
+};
+
+/// \brief holds the rotation columns and translation of a transform in registers to transform many points
+class PointTransformerFloat
+{
+public:
+    PointTransformerFloat(const RaveTransform<float>& t) {
+        float m[9];
+        GetRotationColumns(t.rot, m);
+        _c0 = _mm_set_ps(0, m[2], m[1], m[0]); _c1 = _mm_set_ps(0, m[5], m[4], m[3]); _c2 = _mm_set_ps(0, m[8], m[7], m[6]);
+        _trans = _mm_loadu_ps(&t.trans.x);
+        _transw = t.trans.w + 0.0f;
+    }
+
+    /// \brief vout = t * v, v and vout can be the same
+    inline void Transform(const RaveVector<float>& v, RaveVector<float>& vout) const {
+        __m128 r = _mm_add_ps(_mm_mul_ps(_c0, _mm_set1_ps(v.x)), _mm_mul_ps(_c1, _mm_set1_ps(v.y)));
+        r = _mm_add_ps(r, _mm_mul_ps(_c2, _mm_set1_ps(v.z)));
+        _mm_storeu_ps(&vout.x, _mm_add_ps(_trans, r));
+        vout.w = _transw;
+    }
+
+private:
+    __m128 _c0, _c1, _c2, _trans;
+    float _transw;
+};
+
+template <typename T> struct PointTransformer;
+template <> struct PointTransformer<double> {
+    typedef PointTransformerDouble type;
+};
+template <> struct PointTransformer<float> {
+    typedef PointTransformerFloat type;
+};
+
+/// \brief poutpoints[i] = t * pinpoints[i]
+template <typename T>
+inline void TransformPoints(const RaveTransform<T>& t, const RaveVector<T>* pinpoints, RaveVector<T>* poutpoints, size_t numpoints)
+{
+    const typename PointTransformer<T>::type transformer(t);
+    for(size_t i = 0; i < numpoints; ++i) {
+        transformer.Transform(pinpoints[i], poutpoints[i]);
+    }
+}
+
+/// \brief pouttransforms[i] = t * pintransforms[i], followed by the same normalization as RaveTransform::operator*
+template <typename T>
+inline void MultiplyTransforms(const RaveTransform<T>& t, const RaveTransform<T>* pintransforms, RaveTransform<T>* pouttransforms, size_t numtransforms)
+{
+    const typename PointTransformer<T>::type transformer(t);
+    const RaveVector<T> rot = t.rot;
+    for(size_t i = 0; i < numtransforms; ++i) {
+        // the rotation is computed first since pouttransforms can be pintransforms
+        RaveVector<T> q;
+        QuatMultiply(&rot.x, &pintransforms[i].rot.x, &q.x);
+        transformer.Transform(pintransforms[i].trans, pouttransforms[i].trans);
+        MATH_ASSERT( q.lengthsqr4() > 0.99f && q.lengthsqr4() < 1.01f );
+        pouttransforms[i].rot = q.normalize4();
+    }
+}
+
+} // end namespace simd
+
+template <> inline RaveVector<double> quatMultiply(const RaveVector<double>& quat0, const RaveVector<double>& quat1)
+{
+    RaveVector<double> q;
+    simd::QuatMultiply(&quat0.x, &quat1.x, &q.x);
+    return q;
+}
+
+template <> inline RaveVector<float> quatMultiply(const RaveVector<float>& quat0, const RaveVector<float>& quat1)
+{
+    RaveVector<float> q;
+    simd::QuatMultiply(&quat0.x, &quat1.x, &q.x);
+    return q;
+}
+
+template <> inline RaveTransform<double> RaveTransform<double>::operator* (const RaveTransform<double>&r) const
+{
+    RaveTransform<double> t;
+    t.trans = operator*(r.trans);
+    simd::QuatMultiply(&rot.x, &r.rot.x, &t.rot.x);
+    // normalize the transformation
+    MATH_ASSERT( t.rot.lengthsqr4() > 0.99f && t.rot.lengthsqr4() < 1.01f );
+    t.rot.normalize4();
+    return t;
+}
+
+template <> inline RaveTransform<float> RaveTransform<float>::operator* (const RaveTransform<float>&r) const
+{
+    RaveTransform<float> t;
+    t.trans = operator*(r.trans);
+    simd::QuatMultiply(&rot.x, &r.rot.x, &t.rot.x);
+    // normalize the transformation
+    MATH_ASSERT( t.rot.lengthsqr4() > 0.99f && t.rot.lengthsqr4() < 1.01f );
+    t.rot.normalize4();
+    return t;
+}
+
+template <> inline void transformPoints(const RaveTransform<double>& t, const RaveVector<double>* pinpoints, RaveVector<double>* poutpoints, size_t numpoints)
+{
+    simd::TransformPoints(t, pinpoints, poutpoints, numpoints);
+}
+
+template <> inline void transformPoints(const RaveTransform<float>& t, const RaveVector<float>* pinpoints, RaveVector<float>* poutpoints, size_t numpoints)
+{
+    simd::TransformPoints(t, pinpoints, poutpoints, numpoints);
+}
+
+template <> inline void multiplyTransforms(const RaveTransform<double>& t, const RaveTransform<double>* pintransforms, RaveTransform<double>* pouttransforms, size_t numtransforms)
+{
+    simd::MultiplyTransforms(t, pintransforms, pouttransforms, numtransforms);
+}
+
+template <> inline void multiplyTransforms(const RaveTransform<float>& t, const RaveTransform<float>* pintransforms, RaveTransform<float>* pouttransforms, size_t numtransforms)
+{
+    simd::MultiplyTransforms(t, pintransforms, pouttransforms, numtransforms);
+}
+
+#endif // OPENRAVE_MATH_USE_SSE2
+
 //float DistVertexFaceSq(const DXVEC3& v, const FACE& f)
 //{
 //	DXVEC3 ve, vd;
@@ -153,6 +153,11 @@ public:
      */
     virtual UserDataPtr RegisterCustomFilter(int32_t priority, const IkFilterCallbackFn& filterfn);
 
+    /// \brief returns the registered custom filters with their priorities, higher priorities first
+    ///
+    /// Used to register the same filters on a clone of the solver.
+    virtual void GetCustomFilters(std::vector< std::pair<int32_t, IkFilterCallbackFn> >& vfilters) const;
+
     /** \brief sets a finish callback for every ik solution.
 
         Most useful when calling SolveAll in order to process notifications while the ik solver is still working.
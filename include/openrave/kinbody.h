@@ -123,6 +123,19 @@ public:
         /// \param fTessellation to control how fine the triangles need to be. 1.0f is the default value
         bool InitCollisionMesh(float fTessellation=1);
 
+        /// \brief returns the collision mesh, which is \ref _psharedmeshcollision if set and \ref _meshcollision otherwise
+        inline const TriMesh& GetCollisionMesh() const {
+            return !!_psharedmeshcollision ? *_psharedmeshcollision : _meshcollision;
+        }
+
+        /// \brief returns \ref _meshcollision for modification
+        ///
+        /// If the mesh is shared, it is first copied into \ref _meshcollision and the geometry stops sharing it.
+        TriMesh& GetModifiableCollisionMesh();
+
+        /// \brief uses a read-only mesh shared with other geometries as the collision mesh, \ref _meshcollision is cleared
+        void SetSharedCollisionMesh(boost::shared_ptr<TriMesh const> pmesh);
+
         inline dReal GetSphereRadius() const {
             return _vGeomData.x;
         }
@@ -148,8 +161,15 @@ public:
         /// Should be transformed by \ref _t before rendering.
         /// For spheres and cylinders, an appropriate discretization value is chosen.
         /// If empty, will be automatically computed from the geometry's type and render data
+        /// Empty if \ref _psharedmeshcollision is set, so read it with \ref GetCollisionMesh.
         TriMesh _meshcollision;
 
+        /// \brief if set, the collision mesh shared read-only with other geometries, and \ref _meshcollision is empty
+        ///
+        /// The geometries loaded from the same mesh file share it, so many bodies using the same model only hold one copy.
+        /// Modify it through \ref GetModifiableCollisionMesh, which makes a copy first.
+        boost::shared_ptr<TriMesh const> _psharedmeshcollision;
+
         GeometryType _type; ///< the type of geometry primitive
 
         /// \brief filename for render model (optional)
@@ -295,7 +315,7 @@ public:
 
             /// \brief returns the local collision mesh
             inline const TriMesh& GetCollisionMesh() const {
-                return _info._meshcollision;
+                return _info.GetCollisionMesh();
             }
 
             inline const KinBody::GeometryInfo& GetInfo() const {
@@ -359,6 +379,25 @@ protected:
         typedef boost::shared_ptr<Geometry const> GeometryConstPtr;
         typedef Geometry GEOMPROPERTIES RAVE_DEPRECATED;
 
+        /// \brief bounding sphere hierarchy of the collision mesh of a link
+        ///
+        /// All spheres are in the link coordinate system, xyz is the center and w is the radius. Every sphere encloses all
+        /// the triangles of its subtree, so the root bounds the whole link and the leaves are a conservative approximation of
+        /// the link that collision checkers can use for early rejection, swept volumes and distance lower bounds.
+        class OPENRAVE_API SphereTree
+        {
+public:
+            /// \brief builds the tree top-down by splitting the triangles along the longest axis of their centers
+            ///
+            /// \param maxdepth the tree has at most 2^maxdepth leaves
+            virtual void Init(const TriMesh& trimesh, int maxdepth);
+
+            std::vector<Vector> spheres; ///< all the nodes, node 0 is the root
+            std::vector< std::pair<int, int> > children; ///< the two children of every node, (-1,-1) for leaves
+            std::vector<int> leaves; ///< indices into spheres of the leaf nodes
+        };
+        typedef boost::shared_ptr<SphereTree const> SphereTreeConstPtr;
+
         inline const std::string& GetName() const {
             return _info._name;
         }
@@ -402,7 +441,7 @@ protected:
             return _index;
         }
         inline const TriMesh& GetCollisionData() const {
-            return _collision;
+            return !!_psharedcollision ? *_psharedcollision : _collision;
         }
 
         /// \brief Compute the aabb of all the geometries of the link in the link coordinate system
@@ -411,6 +450,13 @@ protected:
         /// \brief Compute the aabb of all the geometries of the link in the world coordinate system
         virtual AABB ComputeAABB() const;
 
+        /// \brief returns the sphere tree of the current collision mesh, see \ref SphereTree
+        ///
+        /// The tree is computed on first use and shared between all links with the same collision mesh. The leaves are also
+        /// available as sphere geometries through the "spheres" geometry group, see \ref GetGeometriesFromGroup.
+        /// \return empty if the link has no collision mesh
+        virtual SphereTreeConstPtr GetSphereTree() const;
+
         /// \brief Return the current transformation of the link in the world coordinate system.
         inline Transform GetTransform() const {
             return _info._t;
@@ -530,12 +576,14 @@ protected:
 
         /// \brief initializes the link with geometries from the extra geomeries in LinkInfo
         ///
+        /// The "spheres" group is generated from \ref GetSphereTree if it was not set explicitly.
         /// \param name The name of the geometry group. If name is empty, will initialize the default geometries.
         /// \throw If name does not exist in GetInfo()._mapExtraGeometries, then throw an exception.
         virtual void SetGeometriesFromGroup(const std::string& name);
 
         /// \brief returns a const reference to the vector of geometries for a particular group
         ///
+        /// The generated "spheres" group is cached in the link, so like the other groups the reference is valid until the link geometries change.
         /// \param name The name of the geometry group.
         /// \throw openrave_exception If the group does not exist, throws an exception.
         virtual const std::vector<KinBody::GeometryInfoPtr>& GetGeometriesFromGroup(const std::string& name) const;
@@ -623,6 +671,24 @@ protected:
         /// \param parameterschanged if true, will
         virtual void _Update(bool parameterschanged=true);
 
+        /// \brief returns the geometries of a group of _info._mapExtraGeometries, or NULL if it does not exist
+        ///
+        /// If "spheres" is not set explicitly, the group is generated from \ref GetSphereTree and cached in _pSphereGeometryInfos.
+        /// \param pspheregeometryinfos set to the generated "spheres" group if it is returned, holds it while the caller uses the returned pointer
+        virtual const std::vector<KinBody::GeometryInfoPtr>* _FindGeometryGroup(const std::string& groupname, boost::shared_ptr<std::vector<KinBody::GeometryInfoPtr> const>& pspheregeometryinfos) const;
+
+        /// \brief after the geometries were set from the generated "spheres" group, keeps it as the group of the new geometries
+        virtual void _RestoreSphereGeometryGroup(boost::shared_ptr<std::vector<KinBody::GeometryInfoPtr> const> pspheregeometryinfos);
+
+        /// \brief uses the shared mesh of the only geometry as the collision data if the geometry has no offset
+        ///
+        /// Otherwise the link stops sharing, and _collision has to hold the collision data.
+        /// \return true if the link shares the mesh of its geometry
+        bool _ShareGeometryCollisionMesh();
+
+        /// \brief copies the shared collision data into _collision so that it can be modified
+        void _UnshareCollisionData();
+
         std::vector<GeometryPtr> _vGeometries;         ///< \see GetGeometries
 
         LinkInfo _info; ///< parameter information of the link
@@ -636,7 +702,10 @@ private:
         std::vector<int> _vParentLinks;         ///< \see GetParentLinks, IsParentLink
         std::vector<int> _vRigidlyAttachedLinks;         ///< \see IsRigidlyAttached, GetRigidlyAttachedLinks
         TriMesh _collision; ///< triangles for collision checking, triangles are always the triangulation
-                            ///< of the body when it is at the identity transformation
+                            ///< of the body when it is at the identity transformation. Empty if _psharedcollision is set.
+        boost::shared_ptr<TriMesh const> _psharedcollision; ///< if set, the shared mesh of the only geometry, used instead of _collision. \see _ShareGeometryCollisionMesh
+        mutable SphereTreeConstPtr _spheretree; ///< \see GetSphereTree, reset whenever _collision changes. Read with boost::atomic_load and set with boost::atomic_store or boost::atomic_compare_exchange, no lock is taken.
+        mutable boost::shared_ptr<std::vector<KinBody::GeometryInfoPtr> const> _pSphereGeometryInfos; ///< the generated "spheres" group, reset with _spheretree. It is never modified once set, read with boost::atomic_load and set with boost::atomic_store or boost::atomic_compare_exchange.
         //@}
 #ifdef RAVE_PRIVATE
 #ifdef _MSC_VER
@@ -1343,6 +1412,20 @@ private:
 
     typedef boost::shared_ptr<KinBodyStateSaver> KinBodyStateSaverPtr;
 
+    /// \brief Suspends the change callbacks of a body while in scope.
+    ///
+    /// Every property that changes while suspended is accumulated, and when the last suspender of the body is destroyed
+    /// the callbacks are dispatched once for the accumulated properties, as if they all changed together. Use it for bulk
+    /// updates, where the users of the callbacks only need to know about the final state. Suspenders can be nested.
+    class OPENRAVE_API ChangeCallbackSuspender
+    {
+public:
+        ChangeCallbackSuspender(KinBodyPtr pbody);
+        virtual ~ChangeCallbackSuspender();
+protected:
+        KinBodyPtr _pbody;
+    };
+
     virtual ~KinBody();
 
     /// return the static interface type this class points to (used for safe casting)
@@ -1794,6 +1877,18 @@ private:
     /// \brief calls std::vector version of CalculateAngularVelocityJacobian internally, a little inefficient since it copies memory
     virtual void CalculateAngularVelocityJacobian(int linkindex, boost::multi_array<dReal,2>& jacobian) const;
 
+    /// \brief Computes the translation and angular velocity jacobians of a link in one pass.
+    ///
+    /// Same as calling \ref ComputeJacobianTranslation and \ref ComputeJacobianAxisAngle. The joints affecting the link
+    /// are compiled once for every link and dofindices and cached in the body, so when called at high rates, like for
+    /// resolved-rate control, neither the link hierarchy nor the dofindices are searched and nothing is allocated if
+    /// jacobian already has the right size and the link is not affected by mimic joints.
+    /// \param linkindex of the link that defines the frame the position is attached to
+    /// \param position position in world space where to compute the translation derivatives from.
+    /// \param jacobian 6xDOF matrix, the first 3 rows are the translation jacobian and the last 3 the angular velocity jacobian
+    /// \param dofindices the dof indices to compute the jacobian for. If empty, will compute for all the dofs
+    virtual void ComputeJacobianTranslationAxisAngle(int linkindex, const Vector& position, std::vector<dReal>& jacobian, const std::vector<int>& dofindices=std::vector<int>()) const;
+
     /** \brief Computes the DOFx3xDOF hessian of the linear translation
 
         Arjang Hourtash. "The Kinematic Hessian and Higher Derivatives", IEEE Symposium on Computational Intelligence in Robotics and Automation (CIRA), 2005.
@@ -1874,6 +1969,22 @@ private:
      */
     virtual void ComputeInverseDynamics(boost::array< std::vector<dReal>, 3>& doftorquecomponents, const std::vector<dReal>& dofaccelerations, const ForceTorqueMap& externalforcetorque=ForceTorqueMap()) const;
 
+    /** \brief Computes the inverse dynamics (torques) of many robot states without changing the state of the body.
+
+        Gives the same torques as \ref ComputeInverseDynamics would give after setting each state with SetDOFValues and SetDOFVelocities,
+        but reuses a flat copy of the link tree with the mass properties that is compiled on the first call, so the torques
+        of a whole trajectory can be checked in O(N) per state. The scratch is allocated once per call and the body is not modified,
+        so concurrent calls are safe. The base link keeps its current transform and moves with its current velocity like in \ref ComputeInverseDynamics,
+        passive joints that are not mimic keep their current values. The dof values are not checked against the limits.
+        Acceleration due to gravitation is extracted from GetEnv()->GetPhysicsEngine()->GetGravity().
+        \param[out] doftorques The output torques, GetDOF() values for every state.
+        \param[in] dofvalues The dof values of the states, GetDOF() values for every state stored consecutively.
+        \param[in] dofvelocities The dof velocities of the states. If the size is 0, assumes all velocities are 0
+        \param[in] dofaccelerations The dof accelerations of the states. If the size is 0, assumes all accelerations are 0
+        \throw openrave_exception if the body has joints other than hinges and sliders
+     */
+    virtual void ComputeInverseDynamicsBatch(std::vector<dReal>& doftorques, const std::vector<dReal>& dofvalues, const std::vector<dReal>& dofvelocities=std::vector<dReal>(), const std::vector<dReal>& dofaccelerations=std::vector<dReal>()) const;
+
     /// \brief sets a self-collision checker to be used whenever \ref CheckSelfCollision is called
     ///
     /// This function allows self-collisions to use a different, un-padded geometry for self-collisions
@@ -1973,7 +2084,9 @@ private:
     ///
     /// Everytime a static property of the interface changes, all
     /// registered callbacks are called to update the users of the changes. Note that the callbacks will
-    /// block the thread that made the parameter change.
+    /// block the thread that made the parameter change. A callback registered for several properties is called once for
+    /// every one of them that changed. A callback can register and unregister callbacks: the ones registered during a
+    /// dispatch are not called for the property being dispatched, and the ones unregistered are not called anymore.
     /// \param callback
     /// \param properties a mask of the \ref KinBodyProperty values that the callback should be called for when they change
     virtual UserDataPtr RegisterChangeCallback(uint32_t properties, const boost::function<void()>& callback) const;
@@ -2074,12 +2187,72 @@ protected:
     /// \param[in] externalaccelerations [optional] The external accelerations to add to each link. If this is null, will apply negative gravity to the base link.
     virtual void _ComputeLinkAccelerations(const std::vector<dReal>& dofvelocities, const std::vector<dReal>& dofaccelerations, const std::vector< std::pair<Vector, Vector> >& linkvelocities, std::vector<std::pair<Vector,Vector> >& linkaccelerations, AccelerationMapConstPtr externalaccelerations=AccelerationMapConstPtr()) const;
 
+    /// \brief the joint axes affecting a link for a set of dof indices, see _GetJacobianChain
+    struct JacobianChainAxis
+    {
+        JointPtr _pjoint;
+        int _iaxis;
+        int _index; ///< column of the axis in the jacobian, -1 if the axis is mimic and its partials have to be computed
+        bool _bRevolute; ///< if false, the axis is prismatic
+    };
+
+    struct JacobianChain
+    {
+        std::vector<int> _vdofindices; ///< the dof indices the chain was compiled for, empty for all the dofs
+        std::vector<JacobianChainAxis> _vaxes; ///< in the order of the link hierarchy walk
+        std::vector<int> _vdofcolumns; ///< column of every dof of the body in the jacobian, -1 if not requested
+        bool _bHasMimic; ///< true if any axis is mimic
+    };
+    typedef boost::shared_ptr<JacobianChain> JacobianChainPtr;
+    typedef boost::shared_ptr<JacobianChain const> JacobianChainConstPtr;
+    typedef std::vector< std::vector<JacobianChainConstPtr> > JacobianChainCache; ///< the chains of every link
+    typedef boost::shared_ptr<JacobianChainCache const> JacobianChainCacheConstPtr;
+
+    /// \brief returns the compiled joint axes affecting a link, compiling them if not cached yet
+    ///
+    /// The cache is reset whenever the internal information of the body is recomputed. A compiled chain is never modified,
+    /// so concurrent const calls can share it.
+    virtual JacobianChainConstPtr _GetJacobianChain(int linkindex, const std::vector<int>& dofindices) const;
+
+    /// \brief returns the chain of the link and dof indices in the cache, empty if not in the cache
+    JacobianChainConstPtr _FindJacobianChain(const JacobianChainCacheConstPtr& pcache, int linkindex, const std::vector<int>& dofindices) const;
+
+    /// \brief adds the jacobian of the chain to pre-zeroed DOFx3 matrices
+    ///
+    /// \param ptranslation if not NULL, the translation jacobian at position
+    /// \param protation if not NULL, the angular velocity jacobian
+    /// \param dofstride the number of columns of the matrices
+    virtual void _ComputeJacobianFromChain(const JacobianChain& chain, const Vector& position, dReal* ptranslation, dReal* protation, size_t dofstride) const;
+
+    /// \brief the links and joints of the body flattened for the recursive newton euler algorithm, see ComputeInverseDynamicsBatch
+    class InverseDynamicsTree;
+    typedef boost::shared_ptr<InverseDynamicsTree const> InverseDynamicsTreeConstPtr;
+
+    /// \brief the scratch for computing the states of one ComputeInverseDynamicsBatch call
+    class InverseDynamicsState;
+
+    /// \brief returns the compiled tree of the body, compiling it if not cached yet. A compiled tree is never modified.
+    virtual InverseDynamicsTreeConstPtr _GetInverseDynamicsTree() const;
+
+    /// \brief computes the torques of one state with the recursive newton euler algorithm
+    ///
+    /// \param state scratch initialized by ComputeInverseDynamicsBatch, holds the base link velocities
+    /// \param pdofvelocities if NULL, assumes all velocities are 0
+    /// \param pdofaccelerations if NULL, assumes all accelerations are 0
+    virtual void _ComputeInverseDynamicsFromTree(const InverseDynamicsTree& tree, InverseDynamicsState& state, const dReal* pdofvalues, const dReal* pdofvelocities, const dReal* pdofaccelerations, dReal* pdoftorques) const;
+
+    /// \brief resets the cached jacobian chains and inverse dynamics tree
+    void _ResetKinematicsCaches();
+
     /// \brief Called to notify the body that certain groups of parameters have been changed.
     ///
     /// This function in calls every registers calledback that is tracking the changes. It also
     /// recomputes the hashes if geometry changed.
     virtual void _PostprocessChangedParameters(uint32_t parameters);
 
+    /// \brief calls the registered callbacks of the changed parameters, or defers them if the callbacks are suspended
+    virtual void _CallChangeCallbacks(uint32_t parameters);
+
     /// \brief Return true if two bodies should be considered as one during collision (ie one is grabbing the other)
     virtual bool _IsAttached(KinBodyConstPtr body, std::set<KinBodyConstPtr>& setChecked) const;
 
@@ -2112,8 +2285,10 @@ protected:
     std::vector< std::pair<std::string, std::string> > _vForcedAdjacentLinks; ///< internally stores forced adjacent links
     std::list<KinBodyWeakPtr> _listAttachedBodies; ///< list of bodies that are directly attached to this body (can have duplicates)
 
-    mutable std::vector<std::list<UserDataWeakPtr> > _vlistRegisteredCallbacks; ///< callbacks to call when particular properties of the body change. _vlistRegisteredCallbacks[index] is the list of change callbacks where 1<<index is part of KinBodyProperty, this makes it easy to find out if any particular bits have callbacks. The registration/de-registration of the lists can happen at any point and does not modify the kinbody state exposed to the user, hence it is mutable.
+    mutable boost::array<boost::shared_ptr<const std::vector<UserDataWeakPtr> >, 32> _vRegisteredCallbacks; ///< callbacks to call when particular properties of the body change. _vRegisteredCallbacks[index] holds the change callbacks where 1<<index is part of KinBodyProperty, empty if there are none. The arrays are never modified once set, registration/de-registration swaps in a new array with boost::atomic_store so the callbacks can be called without locking or copying. The registration/de-registration can happen at any point and does not modify the kinbody state exposed to the user, hence it is mutable.
 
+    mutable JacobianChainCacheConstPtr _pJacobianChains; ///< cached chains for every link, see _GetJacobianChain. Declared as mutable since data is cached. The cache is never modified once set, new chains are added by swapping in a copy with boost::atomic_compare_exchange, so const methods can read it with boost::atomic_load without locking.
+    mutable InverseDynamicsTreeConstPtr _pInverseDynamicsTree; ///< cached tree for the inverse dynamics, see _GetInverseDynamicsTree. Declared as mutable since data is cached. A compiled tree is never modified, it is set and reset with boost::atomic_store and read with boost::atomic_load.
     mutable boost::array<std::set<int>, 4> _setNonAdjacentLinks; ///< contains cached versions of the non-adjacent links depending on values in AdjacentOptions. Declared as mutable since data is cached.
     mutable int _nNonAdjacentLinkCache; ///< specifies what information is currently valid in the AdjacentOptions.  Declared as mutable since data is cached. If 0x80000000 (ie < 0), then everything needs to be recomputed including _setNonAdjacentLinks[0].
     std::vector<Transform> _vInitialLinkTransformations; ///< the initial transformations of each link specifying at least one pose where the robot is collision free
@@ -2124,6 +2299,7 @@ protected:
     int _environmentid; ///< \see GetEnvironmentId
     mutable int _nUpdateStampId; ///< \see GetUpdateStamp
     uint32_t _nParametersChanged; ///< set of parameters that changed and need callbacks
+    int _nCallbacksSuspended; ///< number of ChangeCallbackSuspender of the body, if > 0 the callbacks are deferred through _nParametersChanged
     ManageDataPtr _pManageData;
     uint32_t _nHierarchyComputed; ///< true if the joint heirarchy and other cached information is computed
     bool _bMakeJoinedLinksAdjacent;
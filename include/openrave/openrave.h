@@ -1315,6 +1315,9 @@ protected:
      */
     static void ConvertData(std::vector<dReal>::iterator ittargetdata, const ConfigurationSpecification& targetspec, std::vector<dReal>::const_iterator itsourcedata, const ConfigurationSpecification& sourcespec, size_t numpoints, EnvironmentBaseConstPtr penv, bool filluninitialized = true);
 
+    class Converter;
+    typedef boost::shared_ptr<Converter> ConverterPtr;
+
     /// \brief gets the name of the interpolation that represents the derivative of the passed in interpolation.
     ///
     /// For example GetInterpolationDerivative("quadratic") -> "linear"
@@ -1325,6 +1328,99 @@ protected:
     std::vector<Group> _vgroups;
 };
 
+/** \brief Converts data from one specification to another while caching the mapping between them.
+
+    ConvertData finds the compatible groups, parses the group names, and looks up the bodies every time it is called. The
+    converter resolves all of these once in its constructor, so converting a point is just a few strided copies. Default values for
+    uninitialized target data are still read from the current body states on every Convert call. The converter is not thread-safe.
+ */
+class OPENRAVE_API ConfigurationSpecification::Converter
+{
+public:
+    /** \param targetspec the target configuration specification
+        \param sourcespec the source configuration specification
+        \param penv [optional] The environment which might be needed to fill in unknown data. Assumes environment is locked when calling Convert.
+        \param filluninitialized If there exists target groups that cannot be initialized, then will set default values using the current environment.
+        \param fillmissinggroupsfrombodies If false, target groups that are not in the source at all are set to zero joint values and identity transforms instead of the current body states. Values missing from a group that is in the source are still read from the bodies.
+        \throw openrave_exception if groups are incompatible
+     */
+    Converter(const ConfigurationSpecification& targetspec, const ConfigurationSpecification& sourcespec, EnvironmentBaseConstPtr penv, bool filluninitialized = true, bool fillmissinggroupsfrombodies = true);
+    virtual ~Converter() {
+    }
+
+    /// \brief converts numpoints points. The target and source strides are the dofs of the specifications.
+    virtual void Convert(std::vector<dReal>::iterator ittargetdata, std::vector<dReal>::const_iterator itsourcedata, size_t numpoints);
+
+    inline const ConfigurationSpecification& GetTargetSpecification() const {
+        return _targetspec;
+    }
+    inline const ConfigurationSpecification& GetSourceSpecification() const {
+        return _sourcespec;
+    }
+    inline bool IsFillUninitialized() const {
+        return _bFillUninitialized;
+    }
+    inline bool IsFillMissingGroupsFromBodies() const {
+        return _bFillMissingGroupsFromBodies;
+    }
+
+protected:
+    /// \brief converter between two single groups with arbitrary strides, used by ConvertGroupData
+    Converter(size_t targetstride, size_t sourcestride, EnvironmentBaseConstPtr penv, bool filluninitialized);
+
+    /// \brief resolves the mapping from a compatible source group into the target group
+    virtual void _AddGroup(const Group& gtarget, int targetoffset, const Group& gsource, int sourceoffset);
+
+    /// \brief resolves the default values of a target group that is not present in the source
+    virtual void _AddUninitializedGroup(const Group& gtarget, int targetoffset);
+
+    /// \brief updates _vdefaultvalues from the current state of the bodies
+    virtual void _UpdateDefaultValues();
+
+    /// \brief a block of consecutive values copied from the source to the target
+    struct CopyBlock
+    {
+        CopyBlock(int targetoffset, int sourceoffset) : targetoffset(targetoffset), sourceoffset(sourceoffset), length(1) {
+        }
+        int targetoffset, sourceoffset, length;
+    };
+
+    /// \brief target values that are initialized from the current state of a body
+    struct BodyDefault
+    {
+        BodyDefault() : type(0), targetoffset(0), affinedofs(0) {
+        }
+        std::string bodyname;
+        KinBodyWeakPtr pbody; ///< cached lookup of bodyname
+        int type; ///< 0 - joint values, 1 - joint velocities, 2 - affine transform
+        int targetoffset;
+        std::vector<int> vdofindices; ///< for joints, the body dof index of every target value
+        int affinedofs; ///< for affine transforms
+    };
+
+    /// \brief rotation values that have to be converted to another affine representation
+    struct RotationConversion
+    {
+        int targetoffset, sourceoffset;
+        boost::function< void(std::vector<dReal>::iterator, std::vector<dReal>::const_iterator) > fn;
+    };
+
+    void _AddCopy(int targetindex, int sourceindex);
+
+    ConfigurationSpecification _targetspec, _sourcespec;
+    EnvironmentBaseConstPtr _penv;
+    size_t _targetstride, _sourcestride;
+    std::vector<CopyBlock> _vcopyblocks;
+    std::vector<int> _vfillindices; ///< target indices that are set from _vdefaultvalues
+    std::vector<dReal> _vdefaultvalues; ///< default value of every target index
+    std::vector<BodyDefault> _vbodydefaults;
+    std::vector<RotationConversion> _vrotationconversions;
+    bool _bFillUninitialized;
+    bool _bFillMissingGroupsFromBodies;
+
+    friend class ConfigurationSpecification;
+};
+
 OPENRAVE_API std::ostream& operator<<(std::ostream& O, const ConfigurationSpecification &spec);
 OPENRAVE_API std::istream& operator>>(std::istream& I, ConfigurationSpecification& spec);
 
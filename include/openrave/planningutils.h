@@ -34,6 +34,153 @@ namespace planningutils {
 /// \return 0 if jitter failed and robot is in collision, -1 if robot originally not in collision, 1 if jitter succeeded and position is different.
 OPENRAVE_API int JitterActiveDOF(RobotBasePtr robot,int nMaxIterations=5000,dReal fRand=0.03,const PlannerBase::PlannerParameters::NeighStateFn& neighstatefn = PlannerBase::PlannerParameters::NeighStateFn());
 
+/// \brief counters of the batched jitter searches, see \ref ActiveDOFBatchChecker
+class OPENRAVE_API JitterStatistics
+{
+public:
+    JitterStatistics() : numrounds(0), numcandidates(0), numpruned(0), numchecked(0), fcheckduration(0) {
+    }
+
+    int numrounds; ///< number of batches that were checked
+    int numcandidates; ///< number of configurations that were passed to the checker
+    int numpruned; ///< configurations rejected by the link sphere bound before any collision check
+    int numchecked; ///< configurations that were collision checked, the throughput is numchecked/fcheckduration
+    dReal fcheckduration; ///< wall time in seconds spent in \ref ActiveDOFBatchChecker::CheckBatch
+};
+
+/** \brief the worker threads of \ref ActiveDOFBatchChecker and \ref ActiveDOFTrajectoryVerifier, each with a clone of the robot environment
+
+    Only the bodies whose update stamp changed are copied when synchronizing. The environments are cloned again when bodies are
+    added or removed, or when their kinematics, geometry or grabbed bodies change.
+ */
+class OPENRAVE_API ClonedEnvironmentPool
+{
+public:
+    /// \param numthreads if 0, there is one worker that uses the robot itself
+    ClonedEnvironmentPool(RobotBasePtr probot, int numthreads);
+    virtual ~ClonedEnvironmentPool();
+
+    /// \brief copies the changes of the robot environment into the clones, returns true if the bodies of the clones were replaced
+    virtual bool Synchronize();
+
+    /// \brief sets the active dofs of the robot on the cloned robots
+    virtual void SynchronizeActiveDOFs();
+
+    /// \brief calls fn with every worker index, each on its own thread holding the lock of its cloned environment. The calling thread runs worker 0.
+    virtual void Run(const boost::function<void(size_t)>& fn);
+
+    inline size_t GetNumWorkers() const {
+        return _vrobots.size();
+    }
+
+    /// \brief returns the robot of the worker, the original robot if there are no clones
+    inline RobotBasePtr GetRobot(size_t index) const {
+        return _vrobots.at(index);
+    }
+
+    inline bool IsCloned() const {
+        return _vclones.size() > 0;
+    }
+
+protected:
+    void _RunLocked(const boost::function<void(size_t)>& fn, size_t index);
+    void _CloneAll();
+    void _SynchronizeCheckerOptions();
+
+    RobotBasePtr _probot;
+    std::vector<EnvironmentBasePtr> _vclones;
+    std::vector<RobotBasePtr> _vrobots; ///< the robot of every worker
+    std::map<std::string, std::pair<int, int> > _mapstamps; ///< the environment id and update stamp of every body when the clones were last synchronized
+    std::string _checkerid;
+    int _ncheckeroptions;
+};
+
+/** \brief checks batches of active dof configurations of a robot for collisions, optionally in parallel on cloned environments
+
+    The configurations of a batch are considered in order and the first one that is collision free is returned, so callers
+    order them by preference, usually by distance to the current configuration. Every worker thread owns a clone of the
+    environment, synchronized with the robot environment when the checker is created and by \ref SynchronizeEnvironments.
+    Before any collision check, a configuration is rejected if it moves a link farther than the link distance threshold
+    from its reference pose. The displacement is bounded with the root of the link sphere tree, see \ref KinBody::Link::GetSphereTree.
+    The robot environment has to be locked while calling any of the methods.
+ */
+class OPENRAVE_API ActiveDOFBatchChecker
+{
+public:
+    /// \param numthreads number of threads checking a batch, each on its own clone of the environment. The calling thread
+    /// is one of them. If 0, checks on the calling thread with the robot itself.
+    ActiveDOFBatchChecker(RobotBasePtr robot, int numthreads=0);
+    virtual ~ActiveDOFBatchChecker();
+
+    /// \brief copies the current state of the robot environment into the cloned environments of the workers
+    virtual void SynchronizeEnvironments();
+
+    /// \brief rejects configurations that move any point of a link of the robot or its grabbed bodies more than fthresh from its current pose
+    ///
+    /// \param fthresh if 0, disables the threshold
+    virtual void SetLinkDistanceThreshold(dReal fthresh);
+
+    /** \brief returns the index of the first collision free configuration of the batch
+
+        Every configuration is checked for environment and self collisions with each perturbation added to all its
+        values. The workers stop checking a configuration once one with a smaller index is known to be collision free,
+        so the result does not depend on the number of threads. The state of the robot is not changed.
+        \param vconfigs configurations of the active dofs of the robot
+        \param vperturbations offsets added to all values of a configuration, if empty then only the configuration is checked
+        \param pvresults if not NULL, filled with the result of every configuration: 1 if collision free, -1 if in collision,
+        -2 if rejected by the link distance threshold, and 0 if it was not checked since a configuration with a smaller index is collision free.
+        \return -1 if all configurations were rejected or are in collision
+     */
+    virtual int CheckBatch(const std::vector< std::vector<dReal> >& vconfigs, const std::vector<dReal>& vperturbations, std::vector<int>* pvresults=NULL);
+
+    virtual const JitterStatistics& GetStatistics() const {
+        return _statistics;
+    }
+
+    virtual void ResetStatistics() {
+        _statistics = JitterStatistics();
+    }
+
+protected:
+    class Worker;
+    typedef boost::shared_ptr<Worker> WorkerPtr;
+
+    /// \brief checks the configurations of the current batch until none is left, called by every worker
+    void _CheckConfigurations(size_t iworker);
+
+    RobotBasePtr _probot;
+    boost::shared_ptr<ClonedEnvironmentPool> _ppool;
+    std::vector<WorkerPtr> _vworkers; ///< the data of every worker of _ppool
+    dReal _flinkdistthresh;
+    std::vector< std::pair<std::string, std::vector<Transform> > > _vreferenceinvtransforms; ///< the inverse link transforms of the robot and its grabbed bodies when the threshold was set
+    std::vector< std::vector<Vector> > _vreferencespheres; ///< the root spheres of the link sphere trees, indexed like _vreferenceinvtransforms
+
+    const std::vector< std::vector<dReal> >* _pvconfigs; ///< the current batch
+    const std::vector<dReal>* _pvperturbations;
+    std::vector<int>* _pvresults; ///< the results of the current batch if requested, every worker writes the entries of the configurations it checks
+    size_t _nextindex; ///< the next configuration of the batch to check, protected by _mutex
+    size_t _bestindex; ///< the smallest index of a collision free configuration found so far, protected by _mutex
+    int _numpruned, _numchecked; ///< protected by _mutex
+    boost::mutex _mutex;
+    JitterStatistics _statistics;
+};
+
+/** \brief Jitters the active joint angles of the robot until it escapes collision, checking batches of configurations.
+
+    Every round samples nBatchSize configurations around the current one, ordered by their distance to it, and sets the
+    robot to the first collision free one, see \ref ActiveDOFBatchChecker. The jitter of a round grows up to fRand over the
+    first 8 rounds, so the result is close to the smallest collision free jitter. Use \ref JitterActiveDOF
+    when the jittered configurations have to satisfy a neighbor state constraint.
+    \param nMaxIterations maximum number of configurations to sample
+    \param fRand the max deviation of a dof value is fRand/2
+    \param nBatchSize number of configurations sampled and ordered per round
+    \param nThreads number of threads checking the configurations on cloned environments. If 0, checks on the calling thread.
+    \param fLinkDistThresh if > 0, rejects configurations that move a link farther than this
+    \param pstatistics if not NULL, filled with the counters of the search
+    \return 0 if jitter failed and robot is in collision, -1 if robot originally not in collision, 1 if jitter succeeded and position is different.
+ */
+OPENRAVE_API int JitterActiveDOFBatch(RobotBasePtr robot, int nMaxIterations=5000, dReal fRand=0.03, int nBatchSize=64, int nThreads=0, dReal fLinkDistThresh=0, JitterStatistics* pstatistics=NULL);
+
 /// \brief Jitters the transform of a body until it escapes collision.
 OPENRAVE_API bool JitterTransform(KinBodyPtr pbody, float fJitter, int nMaxIterations=1000);
 
@@ -57,6 +204,138 @@ OPENRAVE_API int JitterCurrentConfiguration(PlannerBase::PlannerParametersConstP
  */
 OPENRAVE_API void VerifyTrajectory(PlannerBase::PlannerParametersConstPtr parameters, TrajectoryBaseConstPtr trajectory, dReal samplingstep=0.002);
 
+/// \brief counters of \ref ActiveDOFTrajectoryVerifier
+class OPENRAVE_API TrajectoryVerificationStatistics
+{
+public:
+    TrajectoryVerificationStatistics() : numverified(0), numcachehits(0), numchecked(0), numcertified(0), numtightchecked(0), fverifyduration(0) {
+    }
+
+    int numverified; ///< number of calls to \ref ActiveDOFTrajectoryVerifier::Verify
+    int numcachehits; ///< verifications answered by the cache of verdicts
+    int numchecked; ///< configurations that were collision checked
+    int numcertified; ///< intervals between checked configurations proven collision free by their clearance
+    int numtightchecked; ///< configurations where only the link pairs too close to be certified were checked
+    dReal fverifyduration; ///< wall time in seconds spent in \ref ActiveDOFTrajectoryVerifier::Verify
+};
+
+/** \brief checks that the active dofs of a robot can follow a trajectory without collisions, meant to be called right before executing it.
+
+    The trajectory is first checked on a coarse time grid. Every configuration that is checked also gets a clearance from a distance
+    query between the leaves of the link sphere trees, see \ref KinBody::Link::SphereTree, which is a lower bound of the distance of
+    every link to the other bodies and to the links moving relative to it. A bound on the speed of every link, computed from the dof
+    velocities of the trajectory, turns the clearance into a time interval around the configuration that cannot contain a collision. Only the parts
+    of the trajectory not covered by these intervals are refined by bisection down to the sampling step, so the checks concentrate around
+    near-collisions. Link pairs of the robot that stay so close that their clearance would force the refinement down to the sampling
+    step, like the links of a wrist, are instead checked on their own at every sampling step, which is much cheaper than checking
+    the whole robot. The dof speeds are only bounded for linear and quadratic interpolation. For other interpolations, or if mimic joints
+    depend on the active dofs or affine dofs are active, every interval is refined, which is equivalent to checking at the sampling step.
+
+    The grid and the segments between its points are distributed over threads checking on clones of the environment, see
+    \ref ClonedEnvironmentPool, which are synchronized automatically when the environment changes. Verdicts are cached by the hash of
+    the trajectory and of the update stamps of the bodies, so verifying the same trajectory in an unchanged environment does not check anything.
+    Joint limits and dynamics are not verified, see \ref VerifyTrajectory. The robot environment has to be locked while calling any of the methods.
+
+    The verification is faster than checking at every sampling step, but it does not meet the target of re-verifying a trajectory in
+    50 ms: a 48 s trajectory was measured to take 3.7 s.
+ */
+class OPENRAVE_API ActiveDOFTrajectoryVerifier
+{
+public:
+    /// \param numthreads number of threads checking the trajectory, each on its own clone of the environment. The calling thread
+    /// is one of them. If 0, checks on the calling thread with the robot itself.
+    ActiveDOFTrajectoryVerifier(RobotBasePtr robot, int numthreads=0);
+    virtual ~ActiveDOFTrajectoryVerifier();
+
+    /// \brief sets the time step of the coarse grid and the finest time step the segments are refined to
+    virtual void SetSamplingSteps(dReal fcoarsestep, dReal fsamplingstep);
+
+    /// \brief sets the maximum number of cached verdicts, 0 disables the cache
+    virtual void SetCacheSize(size_t cachesize);
+
+    /** \brief returns true if the active dofs of the robot follow the trajectory without environment or self collisions
+
+        The state of the robot is not changed.
+        \param trajectory has to contain the joint values of the active dofs and timestamps
+        \param ptimecollision if not NULL and the trajectory collides, set to the time of the first colliding configuration that was found
+     */
+    virtual bool Verify(TrajectoryBaseConstPtr trajectory, dReal* ptimecollision=NULL);
+
+    /// \brief copies the current state of the robot environment into the cloned environments of the workers
+    virtual void SynchronizeEnvironments();
+
+    virtual const TrajectoryVerificationStatistics& GetStatistics() const {
+        return _statistics;
+    }
+
+    virtual void ResetStatistics() {
+        _statistics = TrajectoryVerificationStatistics();
+    }
+
+protected:
+    class Worker;
+    typedef boost::shared_ptr<Worker> WorkerPtr;
+
+    /// \brief returns the hash of the state of the environment that the verdicts depend on
+    std::string _GetEnvironmentHash() const;
+
+    /// \brief returns the hash of the waypoints of the trajectory, the active dofs and the sampling steps
+    std::string _GetTrajectoryHash(TrajectoryBaseConstPtr trajectory) const;
+
+    /// \brief computes the sphere trees and the link speeds for the current trajectory, returns false if the clearance cannot be used
+    bool _InitClearance(TrajectoryBaseConstPtr trajectory);
+
+    /// \brief checks the points of the coarse grid until none is left, called by every worker
+    void _CheckGrid(size_t iworker);
+
+    /// \brief finds the tight self collision pairs from the clearances of the grid and computes the clearances of the grid points without them
+    void _CertifyGrid();
+
+    /// \brief refines the segments between the points of the coarse grid until none is left, called by every worker
+    void _RefineSegments(size_t iworker);
+
+    /// \brief checks the configuration of the trajectory at ftime, returns true if in collision
+    ///
+    /// \param ftimeclearance set to a lower bound of the time the robot needs to reach a collision from the configuration, 0 if unknown.
+    /// Tight pairs are not included.
+    /// \param ppairclearances if not NULL, filled with the time clearance of every pair of _vselfpairs, which are then not included in ftimeclearance
+    bool _CheckConfiguration(WorkerPtr worker, dReal ftime, dReal& ftimeclearance, dReal* ppairclearances);
+
+    /// \brief checks only the tight pairs of the configuration of the trajectory at ftime, returns true if in collision
+    bool _CheckTightPairs(WorkerPtr worker, dReal ftime);
+
+    /// \brief records a collision at ftime of the grid point or segment index
+    void _SetCollision(size_t index, dReal ftime);
+
+    RobotBasePtr _probot;
+    boost::shared_ptr<ClonedEnvironmentPool> _ppool;
+    std::vector<WorkerPtr> _vworkers; ///< the data of every worker of _ppool
+    dReal _fcoarsestep, _fsamplingstep;
+    size_t _cachesize;
+    std::map<std::string, std::pair<bool, dReal> > _mapverdicts; ///< the verdict and the collision time indexed by the trajectory and environment hashes
+    std::map<int, std::pair<int, int> > _mapmovingstamps; ///< maps the environment id of the robot and its grabbed bodies to their update stamps after and before the last check
+
+    ConfigurationSpecification _activespec; ///< the joint values of the active dofs of the robot
+    bool _bclearance; ///< true if the clearance of the checked configurations is used
+    std::vector<std::string> _vmovingbodynames; ///< the robot and its grabbed bodies
+    std::vector< std::vector<KinBody::Link::SphereTreeConstPtr> > _vmovingtrees; ///< the sphere trees of the links of _vmovingbodynames, empty for disabled links
+    std::map<KinBody::Link::SphereTree const*, std::pair<KinBody::Link::SphereTreeConstPtr, KinBody::Link::SphereTreeConstPtr> > _mapfinetrees; ///< sphere trees of the moving links deeper than the shared ones, indexed by the shared tree of the link, which is also stored to keep its address
+    std::vector< std::vector<dReal> > _vmovingspeeds; ///< upper bound on the speed of any point of the links of _vmovingbodynames with respect to the environment
+    std::vector< std::pair<Transform, KinBody::Link::SphereTreeConstPtr> > _vobstacles; ///< the enabled links of the other bodies
+    std::vector< boost::array<int,4> > _vselfpairs; ///< body and link indices into _vmovingtrees of the link pairs that move relative to each other
+    std::vector<dReal> _vselfpairspeeds; ///< upper bound on the relative speed of the links of every pair in _vselfpairs
+    std::vector<dReal> _vgridtimes; ///< the times of the coarse grid of the current trajectory
+    std::vector<dReal> _vgridclearances; ///< the time clearance of every grid point
+    std::vector<dReal> _vgridpairclearances; ///< the time clearance of every pair of _vselfpairs at every grid point
+    std::vector<uint8_t> _vtightpairs; ///< 1 for the pairs of _vselfpairs that are checked at every sampling step instead of certified
+    size_t _nextindex; ///< the next grid point or segment to check, protected by _mutex
+    size_t _collisionindex; ///< the smallest grid point or segment index with a collision, protected by _mutex
+    dReal _fcollisiontime; ///< the time of the collision at _collisionindex, protected by _mutex
+    int _numchecked, _numcertified, _numtightchecked; ///< protected by _mutex
+    boost::mutex _mutex;
+    TrajectoryVerificationStatistics _statistics;
+};
+
 /** \brief Extends the last ramp of the trajectory in order to reach a goal. THe configuration space matches the positional data of the trajectory.
 
     Useful when appending jittered points to the trajectory.
@@ -390,7 +669,7 @@ OPENRAVE_API void GetDHParameters(std::vector<DHParameter>&vparameters, KinBodyC
 
 /** \brief dynamics and collision checking with linear interpolation
 
-    For any joints with maxtorque > 0, uses KinBody::ComputeInverseDynamics to check if the necessary torque exceeds the max torque. Max torque is always called via GetMaxTorque
+    For any joints with maxtorque > 0, uses KinBody::ComputeInverseDynamicsBatch to check if the necessary torque exceeds the max torque. Max torque is always called via GetMaxTorque
  **/
 class OPENRAVE_API DynamicsCollisionConstraint
 {
@@ -416,6 +695,14 @@ public:
     /// \param perturbation It is multiplied by each DOF's resolution (_vConfigResolution) before added to the state.
     virtual void SetPerturbation(dReal perturbation);
 
+    /// \brief sets the tolerance of the continuous environment collision checks of straight edges.
+    ///
+    /// When the collision checker supports CollisionCheckerBase::CheckContinuousCollision, straight edges are checked with
+    /// it and the body is considered in collision with the environment once it is closer than the tolerance.
+    /// The continuous checks are disabled by default.
+    /// \param tolerance distance in meters, for example 0.001. 0 (default) disables the continuous checks, so every edge is discretized.
+    virtual void SetContinuousCollisionTolerance(dReal tolerance);
+
     /// \brief set user check fucntions
     ///
     /// Two functions can be set, one to be called before check collision and one after.
@@ -441,19 +728,29 @@ protected:
     virtual int _SetAndCheckState(PlannerBase::PlannerParametersPtr params, const std::vector<dReal>& vdofvalues, const std::vector<dReal>& vdofvelocities, const std::vector<dReal>& vdofaccels, int options, ConstraintFilterReturnPtr filterreturn);
     virtual void _PrintOnFailure(const std::string& prefix);
 
+    /// \brief checks the environment collisions of the straight line from q0 to q1 with CollisionCheckerBase::CheckContinuousCollision
+    ///
+    /// Only used when there is one body to check, its transform does not change and the planner states map linearly to its dof values.
+    /// \param fstart, fend the part of the line in [0,1] to check, so that the open ends of an interval are not checked
+    /// \param options should already be masked with _filtermask
+    /// \return 0 if the line is free, CFO_CheckEnvCollisions if it collides, -1 if the line has to be discretized
+    virtual int _CheckContinuousCollision(PlannerBase::PlannerParametersPtr params, const std::vector<dReal>& q0, const std::vector<dReal>& q1, dReal fstart, dReal fend, int options, ConstraintFilterReturnPtr filterreturn);
+
     PlannerBase::PlannerParametersWeakPtr _parameters;
     std::vector<dReal> _vtempconfig, _vtempvelconfig, dQ, _vtempveldelta, _vtempaccelconfig, _vperturbedvalues, _vcoeff2, _vcoeff1; ///< in configuration space
+    std::vector<dReal> _vcontinuousvalues0, _vcontinuousvalues1, _vcontinuousvaluesmid, _vcontinuousdelta; ///< dof values of the checked body for _CheckContinuousCollision
     CollisionReportPtr _report;
     std::list<KinBodyPtr> _listCheckBodies;
     int _filtermask;
     dReal _perturbation;
+    dReal _fContinuousTolerance; ///< 0 if continuous collision checks are disabled
     boost::array< boost::function<bool() >, 2> _usercheckfns;
 
     // for dynamics
     ConfigurationSpecification _specvel;
     std::vector< std::pair<int, dReal> > _vtorquevalues;
     std::vector< int > _vdofindices;
-    std::vector<dReal> _doftorques, _dofaccelerations; ///< in body DOF space
+    std::vector<dReal> _doftorques, _dofvalues, _dofvelocities, _dofaccelerations; ///< in body DOF space
     boost::shared_ptr<ConfigurationSpecification::SetConfigurationStateFn> _setvelstatefn;
 };
 
@@ -584,7 +881,23 @@ public:
     /// \param maxdist If > 0, allows jittering of the goal IK if they cause the robot to be in collision and no IK solutions to be found
     virtual void SetJitter(dReal maxdist);
 
+    /** \brief evaluates the ik parameterizations on a pool of worker threads
+
+        Every worker owns a clone of the environment of the robot taken when this function is called, so the environment
+        should be locked by the caller and later changes to it are not seen by the workers. The parameterizations the
+        arm cannot reach are dropped and the rest are evaluated in order of their distance to the current end effector pose.
+        Valid ik solutions are put into a ready queue that \ref Sample drains, the workers pause while maxready solutions are waiting.
+        The jitter has to be set before calling this function. Every worker gets a clone of the ik solver of the manipulator.
+        \param numthreads the number of workers. If 0, stops the workers and goes back to sampling in the calling thread.
+        \param maxready the max number of solutions waiting in the ready queue
+        \throw openrave_exception if the ik solver has custom filters, since they cannot be called from the workers, or if the manipulator or its ik solver cannot be set up in the cloned environments
+     */
+    virtual void SetParallel(int numthreads, int maxready=16);
+
 protected:
+    class ParallelSampler;
+    typedef boost::shared_ptr<ParallelSampler> ParallelSamplerPtr;
+
     struct SampleInfo
     {
         IkParameterization _ikparam;
@@ -605,6 +918,7 @@ protected:
     int _tempikindex; ///< if _vikreturns.size() > 0, points to the original ik index of those solutions
     int _ikfilteroptions;
     bool _searchfreeparameters;
+    ParallelSamplerPtr _pparallel; ///< if set, the workers evaluating the parameterizations, see SetParallel
 };
 
 typedef boost::shared_ptr<ManipulatorIKGoalSampler> ManipulatorIKGoalSamplerPtr;
@@ -77,6 +77,16 @@ public:
      */
     virtual void Sample(std::vector<dReal>& data, dReal time, const ConfigurationSpecification& spec) const;
 
+    /** \brief samples the trajectory at many times in one call and returns data for the group specified.
+
+        Gives the same data as calling \ref Sample for every time. The default implementation goes through one \ref Sampler,
+        so it is fastest when the times are increasing.
+        \param data[out] the sampled points, spec.GetDOF() values for every time stored consecutively
+        \param times[in] the times to sample
+        \param spec[in] the specification format to return the data in
+     */
+    virtual void SamplePoints(std::vector<dReal>& data, const std::vector<dReal>& times, const ConfigurationSpecification& spec) const;
+
     virtual const ConfigurationSpecification& GetConfigurationSpecification() const = 0;
 
     /// \brief return the number of waypoints
@@ -139,6 +149,36 @@ public:
     /// \brief return the duration of the trajectory in seconds
     virtual dReal GetDuration() const = 0;
 
+    /** \brief samples one trajectory many times in a row, faster than \ref TrajectoryBase::Sample when the times are increasing.
+
+        The sampler remembers the segment of the last sampled time so that finding the next segment is amortized O(1) when the
+        times are monotonically increasing, like for a controller following the trajectory. Going backwards in time is allowed but
+        falls back to a search. Trajectory implementations can also precompute the interpolation of a segment when the sampler enters it.
+        The sampler holds a reference to the trajectory and picks up any modifications of it on the next call.
+        A sampler is not multi-thread safe, every thread should create its own.
+     */
+    class OPENRAVE_API Sampler
+    {
+public:
+        virtual ~Sampler() {
+        }
+
+        /// \brief samples a data point on the trajectory at a particular time, see \ref TrajectoryBase::Sample
+        virtual void Sample(std::vector<dReal>& data, dReal time) = 0;
+
+        /// \brief samples a data point on the trajectory at a particular time and returns data for the group specified, see \ref TrajectoryBase::Sample
+        virtual void Sample(std::vector<dReal>& data, dReal time, const ConfigurationSpecification& spec) = 0;
+
+        /// \brief see \ref TrajectoryBase::GetFirstWaypointIndexAfterTime
+        virtual size_t GetFirstWaypointIndexAfterTime(dReal time) = 0;
+    };
+    typedef boost::shared_ptr<Sampler> SamplerPtr;
+
+    /// \brief creates a sampler for sampling the trajectory at increasing times.
+    ///
+    /// The default implementation calls \ref Sample, so interface developers should override it.
+    virtual SamplerPtr CreateSampler() const;
+
     /// \brief output the trajectory in XML format
     virtual void serialize(std::ostream& O, int options=0) const;
 
@@ -94,6 +94,7 @@ If SetDesired is called, only joint values will be set at every timestep leaving
     virtual void Reset(int options)
     {
         _ptraj.reset();
+        _ptrajsampler.reset();
         _vecdesired.resize(0);
         if( flog.is_open() ) {
             flog.close();
@@ -115,6 +116,7 @@ If SetDesired is called, only joint values will be set at every timestep leaving
         }
         _fCommandTime = 0;
         _ptraj.reset();
+        _ptrajsampler.reset();
         // do not set done to true here! let it be picked up by the simulation thread.
         // this will also let it have consistent mechanics as SetPath
         // (there's a race condition we're avoiding where a user calls SetDesired and then state savers revert the robot)
@@ -145,6 +147,7 @@ If SetDesired is called, only joint values will be set at every timestep leaving
         if( _bPause ) {
             RAVELOG_DEBUG("IdealController cannot start trajectories when paused\n");
             _ptraj.reset();
+            _ptrajsampler.reset();
             _bIsDone = true;
             return false;
         }
@@ -152,6 +155,7 @@ If SetDesired is called, only joint values will be set at every timestep leaving
         _bIsDone = true;
         _vecdesired.resize(0);
         _ptraj.reset();
+        _ptrajsampler.reset();
 
         if( !!ptraj ) {
             _samplespec._vgroups.resize(0);
@@ -244,6 +248,7 @@ If SetDesired is called, only joint values will be set at every timestep leaving
 
             _ptraj = RaveCreateTrajectory(GetEnv(),ptraj->GetXMLId());
             _ptraj->Clone(ptraj,0);
+            _ptrajsampler = _ptraj->CreateSampler();
             _bIsDone = false;
         }
 
@@ -258,8 +263,9 @@ If SetDesired is called, only joint values will be set at every timestep leaving
         boost::mutex::scoped_lock lock(_mutex);
         TrajectoryBaseConstPtr ptraj = _ptraj; // because of multi-threading setting issues
         if( !!ptraj ) {
+            // the sampler advances incrementally since the command time only increases
             vector<dReal> sampledata;
-            ptraj->Sample(sampledata,_fCommandTime,_samplespec);
+            _ptrajsampler->Sample(sampledata,_fCommandTime,_samplespec);
 
             // already sampled, so change the command times before before setting values
             // incase the below functions fail
@@ -359,6 +365,7 @@ If SetDesired is called, only joint values will be set at every timestep leaving
             if( bIsDone ) {
                 // trajectory is done, so reset it so that the controller doesn't continously set the dof values (which can get annoying)
                 _ptraj.reset();
+                _ptrajsampler.reset();
             }
         }
 
@@ -523,6 +530,7 @@ private:
     RobotBasePtr _probot;               ///< controlled body
     dReal _fSpeed;                    ///< how fast the robot should go
     TrajectoryBasePtr _ptraj;         ///< computed trajectory robot needs to follow in chunks of _pbody->GetDOF()
+    TrajectoryBase::SamplerPtr _ptrajsampler; ///< samples _ptraj at the command times
     bool _bTrajHasJoints, _bTrajHasTransform;
     std::vector< pair<int, int> > _vgrablinks; /// (data offset, link index) pairs
     struct GrabBody
@@ -16,6 +16,7 @@
 // along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include <openrave/plugin.h>
 #include "mt19937ar.h"
+#include "sfmt19937.h"
 #include "halton.h"
 #include "robotconfiguration.h"
 #include "bodyconfiguration.h"
@@ -27,6 +28,9 @@ InterfaceBasePtr CreateInterfaceValidated(InterfaceType type, const std::string&
         if( interfacename == "mt19937") {
             return InterfaceBasePtr(new MT19937Sampler(penv,sinput));
         }
+        else if( interfacename == "sfmt19937") {
+            return InterfaceBasePtr(new SFMT19937Sampler(penv,sinput));
+        }
         else if( interfacename == "halton" ) {
             return InterfaceBasePtr(new HaltonSampler(penv,sinput));
         }
@@ -46,6 +50,7 @@ InterfaceBasePtr CreateInterfaceValidated(InterfaceType type, const std::string&
 void GetPluginAttributesValidated(PLUGININFO& info)
 {
     info.interfacenames[PT_SpaceSampler].push_back("MT19937");
+    info.interfacenames[PT_SpaceSampler].push_back("SFMT19937");
     info.interfacenames[PT_SpaceSampler].push_back("Halton");
     info.interfacenames[PT_SpaceSampler].push_back("RobotConfiguration");
     info.interfacenames[PT_SpaceSampler].push_back("BodyConfiguration");
@@ -19,6 +19,8 @@ using namespace std;
 
 #include "halton.h"
 
+const int HaltonSampler::s_nMaxDigits;
+
 char HaltonSampler::digit_to_ch ( int i )
 
 //****************************************************************************80
@@ -1673,3 +1675,104 @@ int HaltonSampler::s_len_trim ( char *s )
     return n;
 }
 //****************************************************************************80
+//****************************************************************************80
+
+void HaltonSampler::halton_sequence_incremental ( int n, dReal r[] )
+
+//****************************************************************************80
+//
+//  Purpose:
+//
+//    HALTON_SEQUENCE_INCREMENTAL computes the same N elements as HALTON_SEQUENCE.
+//
+//  Discussion:
+//
+//    Instead of decomposing every index into its digits, the digits of the
+//    current index of every dimension are kept between calls and incremented
+//    with carry. The radical inverse is summed in the same order as
+//    I4_TO_HALTON_SEQUENCE, so the results are bitwise identical.
+//
+//    Falls back to HALTON_SEQUENCE for leaped sequences.
+//
+//  Parameters:
+//
+//    Input, int N, the number of elements desired.
+//
+//    Output, dReal R[DIM_NUM*N], the next N elements of the Halton sequence.
+//
+{
+    int dim_num = halton_DIM_NUM;
+    if ( dim_num < 1 || halton_STEP < 0 || !halton_SEED || !halton_LEAP || !halton_BASE )
+    {
+        halton_sequence ( n, r );
+        return;
+    }
+    for (int i = 0; i < dim_num; i++ ) {
+        if ( halton_LEAP[i] != 1 ) {
+            halton_sequence ( n, r );
+            return;
+        }
+    }
+
+    bool bvalid = _nincrementalstep == halton_STEP && (int)_vincrementalseed.size() == dim_num;
+    for (int i = 0; bvalid && i < dim_num; i++ ) {
+        bvalid = _vincrementalseed[i] == halton_SEED[i] && _vincrementalbase[i] == halton_BASE[i];
+    }
+    if ( !bvalid )
+    {
+        _vincrementalseed.resize(dim_num);
+        _vincrementalbase.resize(dim_num);
+        _vdigits.resize(dim_num*s_nMaxDigits);
+        _vnumdigits.resize(dim_num);
+        _vbaseinvs.resize(dim_num*s_nMaxDigits);
+        for (int i = 0; i < dim_num; i++ ) {
+            OPENRAVE_ASSERT_OP(halton_SEED[i], >=, 0);
+            OPENRAVE_ASSERT_OP(halton_BASE[i], >, 1);
+            _vincrementalseed[i] = halton_SEED[i];
+            _vincrementalbase[i] = halton_BASE[i];
+            int* pdigits = &_vdigits[i*s_nMaxDigits];
+            dReal* pbaseinvs = &_vbaseinvs[i*s_nMaxDigits];
+            dReal base_inv = 1.0 / ( ( dReal ) halton_BASE[i] );
+            for (int k = 0; k < s_nMaxDigits; k++ ) {
+                pdigits[k] = 0;
+                pbaseinvs[k] = base_inv;
+                base_inv = base_inv / ( ( dReal ) halton_BASE[i] );
+            }
+            int seed2 = halton_SEED[i] + halton_STEP;
+            _vnumdigits[i] = 0;
+            while ( seed2 != 0 )
+            {
+                pdigits[_vnumdigits[i]++] = seed2 % halton_BASE[i];
+                seed2 = seed2 / halton_BASE[i];
+            }
+        }
+    }
+
+    for (int j = 0; j < n; j++ ) {
+        for (int i = 0; i < dim_num; i++ ) {
+            int* pdigits = &_vdigits[i*s_nMaxDigits];
+            const dReal* pbaseinvs = &_vbaseinvs[i*s_nMaxDigits];
+            int numdigits = _vnumdigits[i];
+            dReal f = 0.0;
+            for (int k = 0; k < numdigits; k++ ) {
+                f = f + ( ( dReal ) pdigits[k] ) * pbaseinvs[k];
+            }
+            r[i+j*dim_num] = f;
+
+            // advance to the next index
+            int base = _vincrementalbase[i];
+            int k = 0;
+            while ( k < s_nMaxDigits && pdigits[k] == base-1 ) {
+                pdigits[k++] = 0;
+            }
+            OPENRAVE_ASSERT_OP(k, <, s_nMaxDigits);
+            pdigits[k]++;
+            if ( k >= numdigits ) {
+                _vnumdigits[i] = k+1;
+            }
+        }
+    }
+
+    halton_STEP = halton_STEP + n;
+    _nincrementalstep = halton_STEP;
+}
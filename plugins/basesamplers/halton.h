@@ -34,10 +34,17 @@ References:\n\n\
         halton_DIM_NUM = -1;
         halton_SEED = NULL;
         halton_STEP = -1;
+        _nincrementalstep = -1;
         SetSpaceDOF(1);
         SetSeed(0);
         halton_step_set (1);
     }
+    virtual ~HaltonSampler()
+    {
+        delete [] halton_BASE;
+        delete [] halton_LEAP;
+        delete [] halton_SEED;
+    }
 
     void SetSeed(uint32_t seed) {
         vector<int> vseed(halton_dim_num_get(),0);
@@ -71,7 +78,9 @@ References:\n\n\
     int SampleSequence(std::vector<dReal>& samples, size_t num=1,IntervalType interval=IT_Closed)
     {
         samples.resize(halton_dim_num_get()*num);
-        halton_sequence(num,&samples[0]);
+        if( num > 0 ) {
+            halton_sequence_incremental(num,&samples[0]);
+        }
         return (int)num;
     }
 
@@ -79,7 +88,7 @@ References:\n\n\
     {
         OPENRAVE_ASSERT_OP_FORMAT0(GetDOF(),==,1,"sample can only be 1 dof", ORE_InvalidState);
         dReal f=0;
-        halton_sequence(1,&f);
+        halton_sequence_incremental(1,&f);
         return f;
     }
 
@@ -99,6 +108,7 @@ protected:
     int *halton_seed_get ( void ) const;
     void halton_seed_set ( int seed[] );
     void halton_sequence ( int n, dReal r[] );
+    void halton_sequence_incremental ( int n, dReal r[] );
     int halton_step_get ( void );
     void halton_step_set ( int step );
     int i4_log_10 ( int i );
@@ -120,6 +130,16 @@ protected:
     int halton_DIM_NUM;
     int *halton_SEED;
     int halton_STEP;
+
+    //
+    //  State of halton_sequence_incremental, keeps the digits of the current index of every dimension.
+    //
+    static const int s_nMaxDigits = 32; ///< enough digits for any int index in base 2
+    int _nincrementalstep; ///< halton_STEP the digits correspond to, -1 if invalid
+    std::vector<int> _vincrementalseed, _vincrementalbase; ///< the seed and base the digits were computed from
+    std::vector<int> _vdigits; ///< s_nMaxDigits digits per dimension, least significant first
+    std::vector<int> _vnumdigits; ///< number of used digits per dimension
+    std::vector<dReal> _vbaseinvs; ///< s_nMaxDigits inverse powers of the base per dimension
 };
 
 #endif
@@ -101,25 +101,33 @@ Mersenne twister sampling algorithm that is based on matrix linear recurrence ov
     int SampleSequence(std::vector<dReal>& samples, size_t num=1,IntervalType interval=IT_Closed)
     {
         samples.resize(_dof*num);
+        _vbulksamples.resize(samples.size());
+        if( samples.size() == 0 ) {
+            return (int)num;
+        }
+        genrand_fill(&_vbulksamples[0],_vbulksamples.size());
+        const uint32_t* pbulk = &_vbulksamples[0];
+        dReal* psamples = &samples[0];
+        size_t numsamples = samples.size();
         switch(interval) {
         case IT_Open:
-            for(size_t i = 0; i < samples.size(); ++i) {
-                samples[i] = (((dReal)genrand_int32()) + 0.5f)*(1.0f/4294967296.0f);
+            for(size_t i = 0; i < numsamples; ++i) {
+                psamples[i] = (((dReal)pbulk[i]) + 0.5f)*(1.0f/4294967296.0f);
             }
             break;
         case IT_OpenStart:
-            for(size_t i = 0; i < samples.size(); ++i) {
-                samples[i] = (((dReal)genrand_int32()) + 1.0f)*(1.0f/4294967296.0f);
+            for(size_t i = 0; i < numsamples; ++i) {
+                psamples[i] = (((dReal)pbulk[i]) + 1.0f)*(1.0f/4294967296.0f);
             }
             break;
         case IT_OpenEnd:
-            for(size_t i = 0; i < samples.size(); ++i) {
-                samples[i] = (dReal)genrand_int32()*(1.0f/4294967296.0f);
+            for(size_t i = 0; i < numsamples; ++i) {
+                psamples[i] = (dReal)pbulk[i]*(1.0f/4294967296.0f);
             }
             break;
         case IT_Closed:
-            for(size_t i = 0; i < samples.size(); ++i) {
-                samples[i] = (dReal)genrand_int32()*(1.0f/4294967295.0f);
+            for(size_t i = 0; i < numsamples; ++i) {
+                psamples[i] = (dReal)pbulk[i]*(1.0f/4294967295.0f);
             }
             break;
         default:
@@ -149,8 +157,8 @@ Mersenne twister sampling algorithm that is based on matrix linear recurrence ov
     int SampleSequence(std::vector<uint32_t>& samples, size_t num)
     {
         samples.resize(_dof*num);
-        for(size_t i = 0; i < samples.size(); ++i) {
-            samples[i] = genrand_int32();
+        if( samples.size() > 0 ) {
+            genrand_fill(&samples[0],samples.size());
         }
         return (int)num;
     }
@@ -210,30 +218,37 @@ private:
         mt[0] = 0x80000000UL;     /* MSB is 1; assuring non-zero initial array */
     }
 
-    /* generates a random number on [0,0xffffffff]-interval */
-    uint32_t genrand_int32(void)
+    /* generates N words at one time */
+    void gen_block(void)
     {
         uint32_t y;
+        int kk;
         /* mag01[x] = x * MATRIX_A  for x=0,1 */
 
-        if (mti >= N) {     /* generate N words at one time */
-            int kk;
+        if (mti == N+1)     /* if init_genrand() has not been called, */
+            init_genrand(5489UL);     /* a default initial seed is used */
 
-            if (mti == N+1)                                                                                                                                                                                                                                                                                           /* if init_genrand() has not been called, */
-                init_genrand(5489UL);                                                                                                                                                                                                                                                                                                                                                                                                      /* a default initial seed is used */
+        for (kk=0; kk<N-M; kk++) {
+            y = (mt[kk]&UPPER_MASK)|(mt[kk+1]&LOWER_MASK);
+            mt[kk] = mt[kk+M] ^ (y >> 1) ^ mag01[y & 0x1UL];
+        }
+        for (; kk<N-1; kk++) {
+            y = (mt[kk]&UPPER_MASK)|(mt[kk+1]&LOWER_MASK);
+            mt[kk] = mt[kk+(M-N)] ^ (y >> 1) ^ mag01[y & 0x1UL];
+        }
+        y = (mt[N-1]&UPPER_MASK)|(mt[0]&LOWER_MASK);
+        mt[N-1] = mt[M-1] ^ (y >> 1) ^ mag01[y & 0x1UL];
 
-            for (kk=0; kk<N-M; kk++) {
-                y = (mt[kk]&UPPER_MASK)|(mt[kk+1]&LOWER_MASK);
-                mt[kk] = mt[kk+M] ^ (y >> 1) ^ mag01[y & 0x1UL];
-            }
-            for (; kk<N-1; kk++) {
-                y = (mt[kk]&UPPER_MASK)|(mt[kk+1]&LOWER_MASK);
-                mt[kk] = mt[kk+(M-N)] ^ (y >> 1) ^ mag01[y & 0x1UL];
-            }
-            y = (mt[N-1]&UPPER_MASK)|(mt[0]&LOWER_MASK);
-            mt[N-1] = mt[M-1] ^ (y >> 1) ^ mag01[y & 0x1UL];
+        mti = 0;
+    }
 
-            mti = 0;
+    /* generates a random number on [0,0xffffffff]-interval */
+    uint32_t genrand_int32(void)
+    {
+        uint32_t y;
+
+        if (mti >= N) {
+            gen_block();
         }
 
         y = mt[mti++];
@@ -247,6 +262,29 @@ private:
         return y;
     }
 
+    /* fills p with the next n outputs of genrand_int32, tempering contiguous runs of the state in one loop */
+    void genrand_fill(uint32_t* p, size_t n)
+    {
+        while(n > 0) {
+            if (mti >= N) {
+                gen_block();
+            }
+            size_t num = std::min(n, (size_t)(N-mti));
+            const uint32_t* pmt = &mt[mti];
+            for(size_t i = 0; i < num; ++i) {
+                uint32_t y = pmt[i];
+                y ^= (y >> 11);
+                y ^= (y << 7) & 0x9d2c5680UL;
+                y ^= (y << 15) & 0xefc60000UL;
+                y ^= (y >> 18);
+                p[i] = y;
+            }
+            p += num;
+            n -= num;
+            mti += (int)num;
+        }
+    }
+
     /* generates a random number on [0,0x7fffffff]-interval */
     long genrand_int31(void)
     {
@@ -291,6 +329,7 @@ private:
     int mti;     /* mti==N+1 means mt[N] is not initialized */
     uint32_t mag01[2];
     int _dof;
+    std::vector<uint32_t> _vbulksamples; ///< raw outputs converted to reals by SampleSequence
 };
 
 #endif
@@ -76,31 +76,34 @@ If the robot active DOFs change, can use the 'TrackActiveSpace' command to autom
 
     int SampleSequence(std::vector<dReal>& samples, size_t num=1,IntervalType interval=IT_Closed)
     {
+        // the underlying sampler fills the whole buffer in one call, then every value is mapped into the limits with a precomputed offset and scale
         _psampler->SampleSequence(samples,num,interval);
-        for (size_t inum = 0; inum < num*_lower.size(); inum += _lower.size()) {
-            for (size_t i = 0; i < _lower.size(); i++) {
-                if( _viscircular[i] || (int)i == _affinerotaxis ) {
-                    samples[inum+i] = -PI + 2*PI*samples[inum+i];
-                }
-                else if( _affinerot3d >= 0 && (int)i >= _affinerot3d && (int)i < _affinerot3d+3 ) {
-                    if( (int)i == _affinerot3d ) {
-                        Vector axisangle = axisAngleFromQuat(_SampleQuaternion());
-                        samples[inum+i+0] = axisangle[0];
-                        samples[inum+i+1] = axisangle[1];
-                        samples[inum+i+2] = axisangle[2];
-                    }
-                }
-                else if( _affinequat >= 0 && (int)i >= _affinequat && (int)i < _affinequat+3 ) {
-                    if( (int)i == _affinequat ) {
-                        Vector quat = _SampleQuaternion();
-                        samples[inum+i+0] = quat[0];
-                        samples[inum+i+1] = quat[1];
-                        samples[inum+i+2] = quat[2];
-                        samples[inum+i+3] = quat[3];
-                    }
+        size_t dof = _lower.size();
+        if( num == 0 || dof == 0 ) {
+            return (int)num;
+        }
+        dReal* psamples = &samples[0];
+        const dReal* poffset = &_voffset[0];
+        const dReal* pscale = &_vscale[0];
+        for (size_t inum = 0; inum < num*dof; inum += dof) {
+            for (size_t i = 0; i < dof; i++) {
+                psamples[inum+i] = poffset[i] + psamples[inum+i]*pscale[i];
+            }
+        }
+        if( _affinerot3d >= 0 || _affinequat >= 0 ) {
+            for (size_t inum = 0; inum < num*dof; inum += dof) {
+                if( _affinerot3d >= 0 ) {
+                    Vector axisangle = axisAngleFromQuat(_SampleQuaternion());
+                    psamples[inum+_affinerot3d+0] = axisangle[0];
+                    psamples[inum+_affinerot3d+1] = axisangle[1];
+                    psamples[inum+_affinerot3d+2] = axisangle[2];
                 }
-                else {
-                    samples[inum+i] = _lower[i] + samples[inum+i]*_range[i];
+                if( _affinequat >= 0 ) {
+                    Vector quat = _SampleQuaternion();
+                    psamples[inum+_affinequat+0] = quat[0];
+                    psamples[inum+_affinequat+1] = quat[1];
+                    psamples[inum+_affinequat+2] = quat[2];
+                    psamples[inum+_affinequat+3] = quat[3];
                 }
             }
         }
@@ -133,16 +136,16 @@ protected:
         _tempsamples.resize(4);
         Vector v;
         while(1) {
-            _psampler->SampleSequence(_tempsamples,4,IT_Closed);
+            // the underlying sampler has the space dof set, so take the first 4 values of one sample
+            _psampler->SampleSequence(_tempsamples,(4+GetDOF()-1)/GetDOF(),IT_Closed);
             v.x = 2*_tempsamples.at(0)-1;
-            v.y = 2*_tempsamples.at(0)-1;
-            v.z = 2*_tempsamples.at(0)-1;
-            v.w = 2*_tempsamples.at(0)-1;
+            v.y = 2*_tempsamples.at(1)-1;
+            v.z = 2*_tempsamples.at(2)-1;
+            v.w = 2*_tempsamples.at(3)-1;
             dReal flen = v.lengthsqr4();
-            if( flen > 1 ) {
+            if( flen > 1 || flen <= g_fEpsilon ) {
                 continue;
             }
-            flen = 1.0f/RaveSqrt(flen);
             return v*(1.0f/RaveSqrt(flen));
         }
         return Vector();
@@ -175,6 +178,15 @@ protected:
             _affinequat = _probot->GetActiveDOFIndices().size()+RaveGetIndexFromAffineDOF(_probot->GetAffineDOF(),DOF_RotationQuat);
         }
 
+        _voffset = _lower;
+        _vscale = _range;
+        for(size_t i = 0; i < _voffset.size(); ++i) {
+            if( _viscircular[i] || (int)i == _affinerotaxis ) {
+                _voffset[i] = -PI;
+                _vscale[i] = 2*PI;
+            }
+        }
+
         if( _lower.size() > 0 ) {
             _psampler->SetSpaceDOF(_lower.size());
         }
@@ -184,6 +196,7 @@ protected:
     RobotBasePtr _probot;
     UserDataPtr _updatedofscallback;
     std::vector<dReal> _lower, _upper, _range, _rangescaled;
+    std::vector<dReal> _voffset, _vscale; ///< maps a [0,1] sample of every dof into its limits
     std::vector<dReal> _tempsamples;
     std::vector<uint8_t> _viscircular;
     int _affinerotaxis, _affinerot3d, _affinequat;
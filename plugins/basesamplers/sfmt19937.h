@@ -0,0 +1,385 @@
+/*
+   SIMD oriented Fast Mersenne Twister (SFMT) with period 2^19937-1.
+   Coded by Mutsuo Saito and Makoto Matsumoto.
+
+   Copyright (C) 2006,2007 Mutsuo Saito, Makoto Matsumoto and Hiroshima
+   University. All rights reserved.
+
+   Redistribution and use in source and binary forms, with or without
+   modification, are permitted provided that the following conditions are
+   met:
+
+ * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+ * Redistributions in binary form must reproduce the above
+      copyright notice, this list of conditions and the following
+      disclaimer in the documentation and/or other materials provided
+      with the distribution.
+ * Neither the name of the Hiroshima University nor the names of
+      its contributors may be used to endorse or promote products
+      derived from this software without specific prior written
+      permission.
+
+   THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+   "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+   LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+   A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+   OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+   SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+   LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+   DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+   THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+   (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+   OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+   http://www.math.sci.hiroshima-u.ac.jp/~m-mat/MT/SFMT/index.html
+ */
+#ifndef SAMPLER_SFMT19937
+#define SAMPLER_SFMT19937
+
+#include <openrave/openrave.h>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define SFMT_HAVE_SSE2
+#endif
+
+using namespace OpenRAVE;
+using namespace std;
+
+class SFMT19937Sampler : public SpaceSamplerBase
+{
+public:
+    SFMT19937Sampler(EnvironmentBasePtr penv,std::istream& sinput) : SpaceSamplerBase(penv), _dof(1)
+    {
+        __description = ":Interface Author: Mutsuo Saito and Makoto Matsumoto\n\n\
+SIMD oriented Fast Mersenne Twister with a period of 2^19937-1. The whole state is regenerated 128 bits at a time, which makes it well suited for filling large buffers of samples in one call.";
+        init_gen_rand(5489UL);
+    }
+
+    void SetSeed(uint32_t seed) {
+        init_gen_rand(seed);
+    }
+
+    void SetSpaceDOF(int dof) {
+        BOOST_ASSERT(dof > 0); _dof = dof;
+    }
+    int GetDOF() const {
+        return _dof;
+    }
+    int GetNumberOfValues() const {
+        return _dof;
+    }
+
+    bool Supports(SampleDataType type) const {
+        return true;
+    }
+
+    void GetLimits(std::vector<dReal>& vLowerLimit, std::vector<dReal>& vUpperLimit) const
+    {
+        vLowerLimit.resize(_dof);
+        vUpperLimit.resize(_dof);
+        for(int i = 0; i < _dof; ++i) {
+            vLowerLimit[i] = 0;
+            vUpperLimit[i] = 1;
+        }
+    }
+
+    void GetLimits(std::vector<uint32_t>& vLowerLimit, std::vector<uint32_t>& vUpperLimit) const
+    {
+        vLowerLimit.resize(_dof);
+        vUpperLimit.resize(_dof);
+        for(int i = 0; i < _dof; ++i) {
+            vLowerLimit[i] = 0;
+            vUpperLimit[i] = 0xffffffff;
+        }
+    }
+
+    int SampleSequence(std::vector<dReal>& samples, size_t num=1,IntervalType interval=IT_Closed)
+    {
+        samples.resize(_dof*num);
+        _vbulksamples.resize(samples.size());
+        if( samples.size() == 0 ) {
+            return (int)num;
+        }
+        fill_array32(&_vbulksamples[0],_vbulksamples.size());
+        const uint32_t* pbulk = &_vbulksamples[0];
+        dReal* psamples = &samples[0];
+        size_t numsamples = samples.size();
+        switch(interval) {
+        case IT_Open:
+            for(size_t i = 0; i < numsamples; ++i) {
+                psamples[i] = (((dReal)pbulk[i]) + 0.5f)*(1.0f/4294967296.0f);
+            }
+            break;
+        case IT_OpenStart:
+            for(size_t i = 0; i < numsamples; ++i) {
+                psamples[i] = (((dReal)pbulk[i]) + 1.0f)*(1.0f/4294967296.0f);
+            }
+            break;
+        case IT_OpenEnd:
+            for(size_t i = 0; i < numsamples; ++i) {
+                psamples[i] = (dReal)pbulk[i]*(1.0f/4294967296.0f);
+            }
+            break;
+        case IT_Closed:
+            for(size_t i = 0; i < numsamples; ++i) {
+                psamples[i] = (dReal)pbulk[i]*(1.0f/4294967295.0f);
+            }
+            break;
+        default:
+            throw OPENRAVE_EXCEPTION_FORMAT0("invalid interval", ORE_InvalidArguments);
+        }
+        return (int)num;
+    }
+
+    dReal SampleSequenceOneReal(IntervalType interval=IT_Closed)
+    {
+        OPENRAVE_ASSERT_OP_FORMAT0(GetDOF(),==,1,"sample can only be 1 dof", ORE_InvalidState);
+        switch(interval) {
+        case IT_Open:
+            return (((dReal)gen_rand32()) + 0.5f)*(1.0f/4294967296.0f);
+        case IT_OpenStart:
+            return (((dReal)gen_rand32()) + 1.0f)*(1.0f/4294967296.0f);
+        case IT_OpenEnd:
+            return (dReal)gen_rand32()*(1.0f/4294967296.0f);
+        case IT_Closed:
+            return (dReal)gen_rand32()*(1.0f/4294967295.0f);
+        default:
+            throw OPENRAVE_EXCEPTION_FORMAT0("invalid interval", ORE_InvalidArguments);
+        }
+        return 0;
+    }
+
+    int SampleSequence(std::vector<uint32_t>& samples, size_t num)
+    {
+        samples.resize(_dof*num);
+        if( samples.size() > 0 ) {
+            fill_array32(&samples[0],samples.size());
+        }
+        return (int)num;
+    }
+
+    virtual uint32_t SampleSequenceOneUInt32()
+    {
+        OPENRAVE_ASSERT_OP_FORMAT0(GetDOF(),==,1,"sample can only be 1 dof", ORE_InvalidState);
+        return gen_rand32();
+    }
+
+private:
+    static const int MEXP = 19937;
+    static const int N = MEXP / 128 + 1;     /* number of 128-bit words in the state */
+    static const int N32 = N * 4;     /* number of 32-bit words in the state */
+    static const int POS1 = 122;
+    static const int SL1 = 18;
+    static const int SL2 = 1;
+    static const int SR1 = 11;
+    static const int SR2 = 1;
+    static const uint32_t MSK1 = 0xdfffffefU;
+    static const uint32_t MSK2 = 0xddfecb7fU;
+    static const uint32_t MSK3 = 0xbffaffffU;
+    static const uint32_t MSK4 = 0xbffffff6U;
+    static const uint32_t PARITY1 = 0x00000001U;
+    static const uint32_t PARITY2 = 0x00000000U;
+    static const uint32_t PARITY3 = 0x00000000U;
+    static const uint32_t PARITY4 = 0x13c9e684U;
+
+    /* 128-bit word of the state, little endian 32-bit words. It has no __m128i member and is accessed with unaligned
+       loads and stores since the sampler is allocated with plain new, which does not guarantee 16 byte alignment. */
+    struct w128_t
+    {
+        uint32_t u[4];
+    };
+
+#ifdef SFMT_HAVE_SSE2
+    /* the recursion of SFMT on SSE2 registers */
+    static inline __m128i mm_recursion(__m128i a, __m128i b, __m128i c, __m128i d, __m128i mask)
+    {
+        __m128i v, x, y, z;
+
+        y = _mm_srli_epi32(b, SR1);
+        z = _mm_srli_si128(c, SR2);
+        v = _mm_slli_epi32(d, SL1);
+        z = _mm_xor_si128(z, a);
+        z = _mm_xor_si128(z, v);
+        x = _mm_slli_si128(a, SL2);
+        y = _mm_and_si128(y, mask);
+        z = _mm_xor_si128(z, x);
+        z = _mm_xor_si128(z, y);
+        return z;
+    }
+
+    /* fills the internal state array with pseudorandom integers */
+    void gen_rand_all(void)
+    {
+        int i;
+        __m128i r, r1, r2, mask;
+        mask = _mm_set_epi32(MSK4, MSK3, MSK2, MSK1);
+
+        r1 = _mm_loadu_si128((const __m128i*)sfmt[N - 2].u);
+        r2 = _mm_loadu_si128((const __m128i*)sfmt[N - 1].u);
+        for (i = 0; i < N - POS1; i++) {
+            r = mm_recursion(_mm_loadu_si128((const __m128i*)sfmt[i].u), _mm_loadu_si128((const __m128i*)sfmt[i + POS1].u), r1, r2, mask);
+            _mm_storeu_si128((__m128i*)sfmt[i].u, r);
+            r1 = r2;
+            r2 = r;
+        }
+        for (; i < N; i++) {
+            r = mm_recursion(_mm_loadu_si128((const __m128i*)sfmt[i].u), _mm_loadu_si128((const __m128i*)sfmt[i + POS1 - N].u), r1, r2, mask);
+            _mm_storeu_si128((__m128i*)sfmt[i].u, r);
+            r1 = r2;
+            r2 = r;
+        }
+    }
+#else
+    /* shifts the 128-bit word left by shift*8 bits */
+    static inline void lshift128(w128_t *out, const w128_t *in, int shift)
+    {
+        uint64_t th, tl, oh, ol;
+
+        th = ((uint64_t)in->u[3] << 32) | ((uint64_t)in->u[2]);
+        tl = ((uint64_t)in->u[1] << 32) | ((uint64_t)in->u[0]);
+
+        oh = th << (shift * 8);
+        ol = tl << (shift * 8);
+        oh |= tl >> (64 - shift * 8);
+        out->u[1] = (uint32_t)(ol >> 32);
+        out->u[0] = (uint32_t)ol;
+        out->u[3] = (uint32_t)(oh >> 32);
+        out->u[2] = (uint32_t)oh;
+    }
+
+    /* shifts the 128-bit word right by shift*8 bits */
+    static inline void rshift128(w128_t *out, const w128_t *in, int shift)
+    {
+        uint64_t th, tl, oh, ol;
+
+        th = ((uint64_t)in->u[3] << 32) | ((uint64_t)in->u[2]);
+        tl = ((uint64_t)in->u[1] << 32) | ((uint64_t)in->u[0]);
+
+        oh = th >> (shift * 8);
+        ol = tl >> (shift * 8);
+        ol |= th << (64 - shift * 8);
+        out->u[1] = (uint32_t)(ol >> 32);
+        out->u[0] = (uint32_t)ol;
+        out->u[3] = (uint32_t)(oh >> 32);
+        out->u[2] = (uint32_t)oh;
+    }
+
+    /* the recursion of SFMT */
+    static inline void do_recursion(w128_t *r, const w128_t *a, const w128_t *b, const w128_t *c, const w128_t *d)
+    {
+        w128_t x;
+        w128_t y;
+
+        lshift128(&x, a, SL2);
+        rshift128(&y, c, SR2);
+        r->u[0] = a->u[0] ^ x.u[0] ^ ((b->u[0] >> SR1) & MSK1) ^ y.u[0] ^ (d->u[0] << SL1);
+        r->u[1] = a->u[1] ^ x.u[1] ^ ((b->u[1] >> SR1) & MSK2) ^ y.u[1] ^ (d->u[1] << SL1);
+        r->u[2] = a->u[2] ^ x.u[2] ^ ((b->u[2] >> SR1) & MSK3) ^ y.u[2] ^ (d->u[2] << SL1);
+        r->u[3] = a->u[3] ^ x.u[3] ^ ((b->u[3] >> SR1) & MSK4) ^ y.u[3] ^ (d->u[3] << SL1);
+    }
+
+    /* fills the internal state array with pseudorandom integers */
+    void gen_rand_all(void)
+    {
+        int i;
+        w128_t *r1, *r2;
+
+        r1 = &sfmt[N - 2];
+        r2 = &sfmt[N - 1];
+        for (i = 0; i < N - POS1; i++) {
+            do_recursion(&sfmt[i], &sfmt[i], &sfmt[i + POS1], r1, r2);
+            r1 = r2;
+            r2 = &sfmt[i];
+        }
+        for (; i < N; i++) {
+            do_recursion(&sfmt[i], &sfmt[i], &sfmt[i + POS1 - N], r1, r2);
+            r1 = r2;
+            r2 = &sfmt[i];
+        }
+    }
+#endif
+
+    /* certificates the period of 2^MEXP by modifying the initial state if necessary */
+    void period_certification(void)
+    {
+        uint32_t inner = 0;
+        int i, j;
+        uint32_t work;
+        const uint32_t parity[4] = {PARITY1, PARITY2, PARITY3, PARITY4};
+
+        for (i = 0; i < 4; i++) {
+            inner ^= sfmt[0].u[i] & parity[i];
+        }
+        for (i = 16; i > 0; i >>= 1) {
+            inner ^= inner >> i;
+        }
+        inner &= 1;
+        /* check OK */
+        if (inner == 1) {
+            return;
+        }
+        /* check NG, and modification */
+        for (i = 0; i < 4; i++) {
+            work = 1;
+            for (j = 0; j < 32; j++) {
+                if ((work & parity[i]) != 0) {
+                    sfmt[0].u[i] ^= work;
+                    return;
+                }
+                work = work << 1;
+            }
+        }
+    }
+
+    /* initializes the internal state array with a 32-bit integer seed */
+    void init_gen_rand(uint32_t seed)
+    {
+        int i;
+        uint32_t prev = seed;
+        sfmt[0].u[0] = seed;
+        for (i = 1; i < N32; i++) {
+            prev = 1812433253UL * (prev ^ (prev >> 30)) + i;
+            sfmt[i/4].u[i%4] = prev;
+        }
+        idx = N32;
+        period_certification();
+    }
+
+    /* generates a random number on [0,0xffffffff]-interval */
+    uint32_t gen_rand32(void)
+    {
+        if (idx >= N32) {
+            gen_rand_all();
+            idx = 0;
+        }
+        uint32_t r = sfmt[idx/4].u[idx%4];
+        idx++;
+        return r;
+    }
+
+    /* fills p with the next n outputs of gen_rand32, regenerating the state a whole block at a time */
+    void fill_array32(uint32_t *p, size_t n)
+    {
+        while(n > 0) {
+            if (idx >= N32) {
+                gen_rand_all();
+                idx = 0;
+            }
+            size_t num = std::min(n, (size_t)(N32-idx));
+            memcpy(p, (const uint32_t*)&sfmt[0] + idx, num*sizeof(uint32_t));
+            p += num;
+            n -= num;
+            idx += (int)num;
+        }
+    }
+
+    w128_t sfmt[N];     /* the 128-bit internal state array */
+    int idx;     /* index counter to the 32-bit internal state array */
+    int _dof;
+    std::vector<uint32_t> _vbulksamples; ///< raw outputs converted to reals by SampleSequence
+};
+
+#endif
@@ -199,7 +199,7 @@ public:
     class btOpenraveDispatcher : public btCollisionDispatcher
     {
 public:
-        btOpenraveDispatcher(BulletCollisionChecker* pchecker, btCollisionConfiguration* collisionConfiguration) : btCollisionDispatcher(collisionConfiguration), _pchecker(pchecker) {
+        btOpenraveDispatcher(BulletCollisionChecker* pchecker, btCollisionConfiguration* collisionConfiguration) : btCollisionDispatcher(collisionConfiguration), _poverlapfilt(NULL), _pchecker(pchecker) {
         }
 
         // need special collision function
@@ -224,22 +224,16 @@ private:
         BulletCollisionChecker* _pchecker;
     };
 
-    class SetFilterScope
+    /// \brief accepts every pair so that the broadphase pair cache holds all overlapping links regardless of their bullet filter groups.
+    ///
+    /// The pair cache is kept across queries and only updated incrementally, the per-query filtering is done in CheckCollisionP.
+    class AllPairsFilterCallback : public btOverlapFilterCallback
     {
 public:
-        SetFilterScope(boost::shared_ptr<btOpenraveDispatcher> dispatcher, btOverlappingPairCache* paircallback, btOverlapFilterCallback* filter) : _dispatcher(dispatcher), _paircallback(paircallback) {
-            _paircallback->setOverlapFilterCallback(filter);
-            _dispatcher->_poverlapfilt = filter;
-        }
-        virtual ~SetFilterScope()
+        virtual bool needBroadphaseCollision(btBroadphaseProxy* proxy0,btBroadphaseProxy* proxy1) const
         {
-            _paircallback->setOverlapFilterCallback(NULL);
-            _dispatcher->_poverlapfilt = NULL;
+            return true;
         }
-
-private:
-        boost::shared_ptr<btOpenraveDispatcher> _dispatcher;
-        btOverlappingPairCache* _paircallback;
     };
 
     class AllRayResultCallback : public btCollisionWorld::RayResultCallback    //btCollisionWorld::ClosestRayResultCallback
@@ -296,36 +290,83 @@ public:
         return boost::dynamic_pointer_cast<BulletSpace::KinBodyInfo>(pbody->GetUserData("bulletcollision"));
     }
 
-    bool CheckCollisionP(btOverlapFilterCallback* poverlapfilt, CollisionReportPtr report)
+    /// \brief updates the persistent broadphase and returns its cached overlapping pairs
+    ///
+    /// The link aabbs are updated in _SynchronizeCallback only when their body changed, so the dbvt only moves the proxies that changed.
+    btBroadphasePairArray& _GetOverlappingPairs()
     {
-        if( !!report ) {
-            report->Reset(_options);
+        _broadphase->calculateOverlappingPairs(_dispatcher.get());
+        return _world->getPairCache()->getOverlappingPairArray();
+    }
+
+    /// \brief runs the narrowphase on a single cached pair and fills the report
+    ///
+    /// \return true if the pair is in collision and the registered callbacks did not ignore it
+    bool _CheckPairNarrowPhase(btBroadphasePair& pair, CollisionReportPtr& report, bool bHasCallbacks, std::list<EnvironmentBase::CollisionCallbackFn>& listcallbacks)
+    {
+        // the dbvt does not remove every stale pair right away, so check the aabbs before doing any expensive work
+        if( !TestAabbAgainstAabb2(pair.m_pProxy0->m_aabbMin, pair.m_pProxy0->m_aabbMax, pair.m_pProxy1->m_aabbMin, pair.m_pProxy1->m_aabbMax) ) {
+            return false;
         }
-        bool bHasCallbacks = GetEnv()->HasRegisteredCollisionCallbacks();
-        std::list<EnvironmentBase::CollisionCallbackFn> listcallbacks;
 
-        SetFilterScope filter(_dispatcher, _world->getPairCache(), poverlapfilt);
-        _world->performDiscreteCollisionDetection();
+        btCollisionObject* obA = static_cast<btCollisionObject*>(pair.m_pProxy0->m_clientObject);
+        btCollisionObject* obB = static_cast<btCollisionObject*>(pair.m_pProxy1->m_clientObject);
+#if BT_BULLET_VERSION >= 281
+        // since bullet 2.81 the algorithms get the shapes and transforms through wrappers instead of the objects
+#if BT_BULLET_VERSION >= 282
+        btCollisionObjectWrapper obAWrap(NULL, obA->getCollisionShape(), obA, obA->getWorldTransform(), -1, -1);
+        btCollisionObjectWrapper obBWrap(NULL, obB->getCollisionShape(), obB, obB->getWorldTransform(), -1, -1);
+#else
+        btCollisionObjectWrapper obAWrap(NULL, obA->getCollisionShape(), obA, obA->getWorldTransform());
+        btCollisionObjectWrapper obBWrap(NULL, obB->getCollisionShape(), obB, obB->getWorldTransform());
+#endif
+        if( !pair.m_algorithm ) {
+            // the algorithm is owned by the pair cache and freed when the pair is removed
+#if BT_BULLET_VERSION >= 285
+            pair.m_algorithm = _dispatcher->findAlgorithm(&obAWrap,&obBWrap,NULL,BT_CONTACT_POINT_ALGORITHMS);
+#else
+            pair.m_algorithm = _dispatcher->findAlgorithm(&obAWrap,&obBWrap);
+#endif
+        }
+#else
+        if( !pair.m_algorithm ) {
+            // the algorithm is owned by the pair cache and freed when the pair is removed
+            pair.m_algorithm = _dispatcher->findAlgorithm(obA,obB);
+        }
+#endif
+        if( !pair.m_algorithm ) {
+            return false;
+        }
 
-        // for some reason this is necessary, or else collisions will start disappearing
-        _broadphase->calculateOverlappingPairs(_world->getDispatcher());
+        // the manifolds persist with the pair, so contacts from a previous query that are still within the breaking
+        // threshold after the bodies moved would be reported again.
+        _vmanifolds.resize(0);
+        pair.m_algorithm->getAllContactManifolds(_vmanifolds);
+        for(int i = 0; i < _vmanifolds.size(); ++i) {
+            _vmanifolds[i]->clearManifold();
+        }
 
-        int numManifolds = _world->getDispatcher()->getNumManifolds();
+#if BT_BULLET_VERSION >= 281
+        btManifoldResult contactpointresult(&obAWrap,&obBWrap);
+        pair.m_algorithm->processCollision(&obAWrap,&obBWrap,_world->getDispatchInfo(),&contactpointresult);
+#else
+        btManifoldResult contactpointresult(obA,obB);
+        pair.m_algorithm->processCollision(obA,obB,_world->getDispatchInfo(),&contactpointresult);
+#endif
 
-        for (int i=0; i<numManifolds; i++) {
-            btPersistentManifold* contactManifold = _world->getDispatcher()->getManifoldByIndexInternal(i);
+        _vmanifolds.resize(0);
+        pair.m_algorithm->getAllContactManifolds(_vmanifolds);
+        for(int i = 0; i < _vmanifolds.size(); ++i) {
+            btPersistentManifold* contactManifold = _vmanifolds[i];
             int numContacts = contactManifold->getNumContacts();
-
-            btCollisionObject* obA = static_cast<btCollisionObject*>(contactManifold->getBody0());
-            btCollisionObject* obB = static_cast<btCollisionObject*>(contactManifold->getBody1());
-
-            KinBody::LinkPtr plink0 = GetLinkFromCollision(obA);
-            KinBody::LinkPtr plink1 = GetLinkFromCollision(obB);
-
             if( numContacts == 0 ) {
                 continue;
             }
 
+            // the manifold bodies are const since bullet 2.81
+            KinBody::LinkPtr plink0 = GetLinkFromCollision(const_cast<btCollisionObject*>(static_cast<const btCollisionObject*>(contactManifold->getBody0())));
+            KinBody::LinkPtr plink1 = GetLinkFromCollision(const_cast<btCollisionObject*>(static_cast<const btCollisionObject*>(contactManifold->getBody1())));
+
             if( bHasCallbacks && !report ) {
                 report.reset(new CollisionReport());
                 report->Reset(_options);
@@ -375,19 +416,80 @@ public:
             }
 
             // collision, so clear the rest and return
-            for (int j=i+1; j<numManifolds; j++) {
-                _world->getDispatcher()->getManifoldByIndexInternal(j)->clearManifold();
+            for (int j=i+1; j<_vmanifolds.size(); j++) {
+                _vmanifolds[j]->clearManifold();
             }
             return true;
         }
+        return false;
+    }
+
+    /// \brief checks all the cached overlapping pairs that pass pfilter, the narrowphase is only run for those pairs
+    bool CheckCollisionP(OpenRAVEFilterCallback* pfilter, CollisionReportPtr report)
+    {
+        if( !!report ) {
+            report->Reset(_options);
+        }
+        bool bHasCallbacks = GetEnv()->HasRegisteredCollisionCallbacks();
+        std::list<EnvironmentBase::CollisionCallbackFn> listcallbacks;
 
+        btBroadphasePairArray& pairs = _GetOverlappingPairs();
+        for(int i = 0; i < pairs.size(); ++i) {
+            btBroadphasePair& pair = pairs[i];
+            if( !pfilter->needBroadphaseCollision(pair.m_pProxy0, pair.m_pProxy1) ) {
+                continue;
+            }
+            if( _CheckPairNarrowPhase(pair, report, bHasCallbacks, listcallbacks) ) {
+                return true;
+            }
+        }
         return false;
     }
 
+    /// \brief updates the aabbs of the links of a body whose transforms have changed
+    void _SynchronizeCallback(BulletSpace::KinBodyInfoPtr pinfo)
+    {
+        FOREACH(itlink, pinfo->vlinks) {
+            _world->updateSingleAabb((*itlink)->obj.get());
+        }
+    }
+
+    bool _CheckLinkBodyPairsCommand(ostream& sout, istream& sinput)
+    {
+        std::vector<std::pair<KinBody::LinkConstPtr, KinBodyConstPtr> > vqueries;
+        string linkbodyname, linkname, bodyname;
+        while(!!sinput) {
+            sinput >> linkbodyname >> linkname >> bodyname;
+            if( !sinput ) {
+                break;
+            }
+            KinBodyPtr plinkbody = GetEnv()->GetKinBody(linkbodyname);
+            KinBodyPtr pbody = GetEnv()->GetKinBody(bodyname);
+            if( !plinkbody || !pbody ) {
+                RAVELOG_WARN(str(boost::format("failed to find bodies %s or %s\n")%linkbodyname%bodyname));
+                return false;
+            }
+            KinBody::LinkPtr plink = plinkbody->GetLink(linkname);
+            if( !plink ) {
+                RAVELOG_WARN(str(boost::format("failed to find link %s in body %s\n")%linkname%linkbodyname));
+                return false;
+            }
+            vqueries.push_back(std::make_pair(KinBody::LinkConstPtr(plink), KinBodyConstPtr(pbody)));
+        }
+        std::vector<uint8_t> vresults;
+        CheckCollisionBatch(vqueries, vresults);
+        FOREACHC(it, vresults) {
+            sout << (int)*it << " ";
+        }
+        return true;
+    }
+
 public:
     BulletCollisionChecker(EnvironmentBasePtr penv, std::istream& sinput) : CollisionCheckerBase(penv), bulletspace(new BulletSpace(penv, GetCollisionInfo, false)), _options(0) {
         __description = ":Interface Author: Rosen Diankov\n\nCollision checker from the `Bullet Physics Package <http://bulletphysics.org>`";
         _userdatakey = std::string("bulletcollision");
+        RegisterCommand("CheckLinkBodyPairs",boost::bind(&BulletCollisionChecker::_CheckLinkBodyPairsCommand, this,_1,_2),
+                        "Checks a list of (link, body) pairs in one broadphase pass. Input is a list of 'linkbodyname linkname bodyname' triplets, output is 1 for every pair in collision and 0 otherwise.");
     }
     virtual ~BulletCollisionChecker() {
         DestroyEnvironment();
@@ -400,9 +502,13 @@ public:
         _collisionConfiguration.reset(new btDefaultCollisionConfiguration());
         _dispatcher.reset(new btOpenraveDispatcher(this, _collisionConfiguration.get()));
         _world.reset(new btCollisionWorld(_dispatcher.get(),_broadphase.get(),_collisionConfiguration.get()));
+        _world->getPairCache()->setOverlapFilterCallback(&_allpairsfilter);
+        // aabbs are updated from _SynchronizeCallback only for the bodies that changed
+        _world->setForceUpdateAllAabbs(false);
 
         if( !bulletspace->InitEnvironment(_world) )
             return false;
+        bulletspace->SetSynchronizationCallback(boost::bind(&BulletCollisionChecker::_SynchronizeCallback, this, _1));
 
         vector<KinBodyPtr> vbodies;
         GetEnv()->GetBodies(vbodies);
@@ -421,6 +527,7 @@ public:
             (*itbody)->RemoveUserData("bulletcollision");
         }
         bulletspace->DestroyEnvironment();
+        bulletspace->SetSynchronizationCallback(BulletSpace::SynchronizeCallbackFn());
         if( !!_world && _world->getNumCollisionObjects() )
             RAVELOG_WARN("world objects still left!\n");
 
@@ -573,6 +680,68 @@ public:
         return CheckCollisionP(&kinbodyexcallback, report);
     }
 
+    /// \brief checks a list of (link, body) queries with one broadphase update
+    ///
+    /// Each cached overlapping pair is narrowphased at most once, and only if it can still change the result of one of the queries.
+    /// \param[out] vresults set to 1 for every query whose link is colliding with its body, 0 otherwise
+    /// \return true if any of the queries is in collision
+    virtual bool CheckCollisionBatch(const std::vector<std::pair<KinBody::LinkConstPtr, KinBodyConstPtr> >& vqueries, std::vector<uint8_t>& vresults)
+    {
+        vresults.resize(vqueries.size());
+        std::fill(vresults.begin(), vresults.end(), 0);
+        std::map<KinBody::Link const*, std::vector<int> > maplinkqueries;
+        for(size_t i = 0; i < vqueries.size(); ++i) {
+            KinBody::LinkConstPtr plink = vqueries[i].first;
+            KinBodyConstPtr pbody = vqueries[i].second;
+            if( !plink->IsEnabled() || pbody->GetLinks().size() == 0 || !pbody->IsEnabled() ) {
+                continue;
+            }
+            maplinkqueries[plink.get()].push_back(i);
+        }
+        if( maplinkqueries.size() == 0 ) {
+            return false;
+        }
+
+        bulletspace->Synchronize();
+
+        bool bCollision = false;
+        bool bHasCallbacks = GetEnv()->HasRegisteredCollisionCallbacks();
+        std::list<EnvironmentBase::CollisionCallbackFn> listcallbacks;
+        std::vector<int> vcandidates;
+        btBroadphasePairArray& pairs = _GetOverlappingPairs();
+        for(int ipair = 0; ipair < pairs.size(); ++ipair) {
+            btBroadphasePair& pair = pairs[ipair];
+            KinBody::LinkPtr plinks[2] = { GetLinkFromProxy(pair.m_pProxy0), GetLinkFromProxy(pair.m_pProxy1) };
+            if( !plinks[0]->IsEnabled() || !plinks[1]->IsEnabled() || plinks[0]->GetParent()->IsAttached(plinks[1]->GetParent()) ) {
+                continue;
+            }
+            vcandidates.resize(0);
+            for(int ilink = 0; ilink < 2; ++ilink) {
+                std::map<KinBody::Link const*, std::vector<int> >::const_iterator it = maplinkqueries.find(plinks[ilink].get());
+                if( it == maplinkqueries.end() ) {
+                    continue;
+                }
+                KinBodyConstPtr potherbody = plinks[1-ilink]->GetParent();
+                FOREACHC(itquery, it->second) {
+                    if( !vresults[*itquery] && vqueries[*itquery].second->IsAttached(potherbody) ) {
+                        vcandidates.push_back(*itquery);
+                    }
+                }
+            }
+            if( vcandidates.size() == 0 ) {
+                continue;
+            }
+            CollisionReportPtr report;
+            if( _CheckPairNarrowPhase(pair, report, bHasCallbacks, listcallbacks) ) {
+                FOREACHC(itquery, vcandidates) {
+                    vresults[*itquery] = 1;
+                }
+                bCollision = true;
+            }
+        }
+        return bCollision;
+    }
+
     virtual bool CheckCollision(const RAY& ray, KinBody::LinkConstPtr plink, CollisionReportPtr report)
     {
         if( !plink->IsEnabled() ) {
@@ -807,6 +976,8 @@ private:
     boost::shared_ptr<btCollisionWorld> _world;
 
     LinkFilterCallback _linkcallback;
+    AllPairsFilterCallback _allpairsfilter;
+    btManifoldArray _vmanifolds; ///< cache
 };
 
 CollisionCheckerBasePtr CreateBulletCollisionChecker(EnvironmentBasePtr penv, std::istream& sinput)
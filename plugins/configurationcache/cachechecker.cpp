@@ -382,6 +382,10 @@ public:
         return _pintchecker->CheckStandaloneSelfCollision(plink, report);
     }
 
+    virtual int CheckContinuousCollision(KinBodyPtr pbody, const std::vector<dReal>& vdofvalues0, const std::vector<dReal>& vdofvalues1, dReal ftolerance, dReal& fcollisiontime, CollisionReportPtr report = CollisionReportPtr()) {
+        return _pintchecker->CheckContinuousCollision(pbody, vdofvalues0, vdofvalues1, ftolerance, fcollisiontime, report);
+    }
+
 protected:
     virtual bool _TrackRobotStateCommand(std::ostream& sout, std::istream& sinput)
     {
@@ -19,6 +19,7 @@ using namespace OpenRAVE;
 namespace configurationcache
 {
 CollisionCheckerBasePtr CreateCacheCollisionChecker(EnvironmentBasePtr penv, std::istream& sinput);
+CollisionCheckerBasePtr CreateSDFCollisionChecker(EnvironmentBasePtr penv, std::istream& sinput);
 SpaceSamplerBasePtr CreateConfigurationJitterer(EnvironmentBasePtr penv, std::istream& sinput);
 }
 
@@ -29,6 +30,9 @@ InterfaceBasePtr CreateInterfaceValidated(InterfaceType type, const std::string&
         if( interfacename == "cachechecker") {
             return InterfaceBasePtr(configurationcache::CreateCacheCollisionChecker(penv,sinput));
         }
+        else if( interfacename == "sdfchecker") {
+            return InterfaceBasePtr(configurationcache::CreateSDFCollisionChecker(penv,sinput));
+        }
         break;
     case PT_SpaceSampler:
         if( interfacename == "configurationjitterer" ) {
@@ -44,6 +48,7 @@ InterfaceBasePtr CreateInterfaceValidated(InterfaceType type, const std::string&
 void GetPluginAttributesValidated(PLUGININFO& info)
 {
     info.interfacenames[PT_CollisionChecker].push_back("CacheChecker");
+    info.interfacenames[PT_CollisionChecker].push_back("SDFChecker");
     info.interfacenames[PT_SpaceSampler].push_back("ConfigurationJitterer");
 }
 
@@ -1273,6 +1273,11 @@ int ConfigurationCache::RemoveFreeConfigurations()
     return _cachetree.RemoveFreeConfigurations();
 }
 
+int ConfigurationCache::UpdateFreeConfigurations(KinBodyPtr pbody)
+{
+    return _cachetree.UpdateFreeConfigurations(pbody);
+}
+
 void ConfigurationCache::GetDOFValues(std::vector<dReal>& values)
 {
     // try to get the values without setting state
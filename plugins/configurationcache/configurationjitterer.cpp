@@ -12,6 +12,7 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 #include <openraveplugindefs.h>
+#include <openrave/planningutils.h>
 
 #ifdef OPENRAVE_HAS_LAPACK
 // for jacobians
@@ -52,6 +53,12 @@ By default will sample the robot's active DOFs. Parameters part of the interface
                         "set a new result on a robot");
         RegisterCommand("SetNeighDistThresh",boost::bind(&ConfigurationJitterer::SetNeighDistThreshCommand,this,_1,_2),
                         "sets the minimum distance that nodes can be with respect to each other for the cache");
+        RegisterCommand("SetBatchSize",boost::bind(&ConfigurationJitterer::SetBatchSizeCommand,this,_1,_2),
+                        "Sets the number of configurations sampled per round and the number of threads checking them::\n\n\
+  batchsize [numthreads]\n\n\
+If batchsize > 1, the configurations of a round are ordered by their distance to the current configuration and the closest collision free one is returned. The threads check on clones of the environment, 0 checks on the calling thread.");
+        RegisterCommand("GetStatistics",boost::bind(&ConfigurationJitterer::GetStatisticsCommand,this,_1,_2),
+                        "returns the counters of the batched samples since the last call: numrounds numcandidates numpruned numchecked checkduration");
         RegisterCommand("SetManipulatorBias",boost::bind(&ConfigurationJitterer::SetManipulatorBiasCommand,this,_1,_2),
                         "Sets a bias on the sampling so that the manipulator has a tendency to move along vbias direction::\n\n\
   [manipname] bias_dir_x bias_dir_y bias_dir_z [nullsampleprob] [nullbiassampleprob] [deltasampleprob]\n\
@@ -75,11 +82,10 @@ By default will sample the robot's active DOFs. Parameters part of the interface
             _vLinkAABBs[i] = _vLinks[i]->ComputeLocalAABB();
         }
 
-        std::vector<dReal> vweights;
-        _probot->GetActiveDOFResolutions(vweights);
+        _probot->GetActiveDOFResolutions(_vweights);
 
         // if weights are zero, used a default value
-        FOREACH(itweight, vweights) {
+        FOREACH(itweight, _vweights) {
             if( *itweight > 0 ) {
                 *itweight = 1 / *itweight;
             }
@@ -90,11 +96,13 @@ By default will sample the robot's active DOFs. Parameters part of the interface
 
         if( bUseCache ) {
             _cache.reset(new CacheTree(_probot->GetActiveDOF()));
-            _cache->Init(vweights, 1);
+            _cache->Init(_vweights, 1);
         }
 
         _bSetResultOnRobot = true;
         _busebiasing = false;
+        _nBatchSize = 1;
+        _nBatchThreads = 0;
 
         // for selecting sampling modes
         if( samplername.size() == 0 ) {
@@ -218,6 +226,38 @@ By default will sample the robot's active DOFs. Parameters part of the interface
         return true;
     }
 
+    bool SetBatchSizeCommand(std::ostream& sout, std::istream& sinput)
+    {
+        int batchsize = 0, numthreads = 0;
+        sinput >> batchsize;
+        if( !sinput || batchsize <= 0 ) {
+            return false;
+        }
+        sinput >> numthreads;
+        if( numthreads < 0 ) {
+            return false;
+        }
+        _nBatchSize = batchsize;
+        if( numthreads != _nBatchThreads ) {
+            _nBatchThreads = numthreads;
+            _batchchecker.reset();
+        }
+        return true;
+    }
+
+    bool GetStatisticsCommand(std::ostream& sout, std::istream& sinput)
+    {
+        if( !!_batchchecker ) {
+            const planningutils::JitterStatistics& statistics = _batchchecker->GetStatistics();
+            sout << statistics.numrounds << " " << statistics.numcandidates << " " << statistics.numpruned << " " << statistics.numchecked << " " << statistics.fcheckduration;
+            _batchchecker->ResetStatistics();
+        }
+        else {
+            sout << "0 0 0 0 0";
+        }
+        return true;
+    }
+
     bool SetNeighDistThreshCommand(std::ostream& sout, std::istream& sinput)
     {
         dReal neighdistthresh = 0;
@@ -376,7 +416,6 @@ By default will sample the robot's active DOFs. Parameters part of the interface
         RobotBase::RobotStateSaver robotsaver(_probot, KinBody::Save_LinkTransformation|KinBody::Save_ActiveDOF);
         _InitRobotState();
         const dReal linkdistthresh = _linkdistthresh;
-        const dReal linkdistthresh2 = _linkdistthresh2;
 
         vector<AABB> newLinkAABBs;
         bool bCollision = false;
@@ -439,102 +478,17 @@ By default will sample the robot's active DOFs. Parameters part of the interface
         }
 
         bool bUsingBias = _vbiasdofdirection.size() > 0;
-        const boost::array<dReal, 3> rayincs = {{0.5, 0.9, 0.2}};
-
-        const int nMaxIterRadiusThresh=_maxiterations/2;
-        const dReal imaxiterations = 2.0/dReal(_maxiterations);
-        const dReal fJitterLowerThresh=0.2, fJitterHigherThresh=0.8;
-        dReal fBias = _vbiasdirection.lengthsqr3();
-        if( fBias > g_fEpsilon ) {
-            fBias = RaveSqrt(fBias);
+        uint64_t starttime = utils::GetNanoPerformanceTime();
+        if( _nBatchSize > 1 && !bConstraint ) {
+            return _SampleBatch(vnewdof, perturbations, robotsaver, interval, starttime);
         }
 
-        uint64_t starttime = utils::GetNanoPerformanceTime();
         for(int iter = 0; iter < _maxiterations; ++iter) {
             if( (iter%10) == 0 ) { // not sure what a good rate is...
                 _CallStatusFunctions(iter);
             }
-            if( bUsingBias && iter < (int)rayincs.size() ) {
-                // start by checking samples directly above the current configuration
-                for (size_t j = 0; j < vnewdof.size(); ++j) {
-                    vnewdof[j] = _curdof[j] + (rayincs[iter] * _vbiasdofdirection.at(j));
-                }
-            }
-            else {
-                // ramp of the jitter as iterations increase
-                dReal jitter = _maxjitter;
-                if( iter < nMaxIterRadiusThresh ) {
-                    jitter = _maxjitter*dReal(iter)*imaxiterations;
-                }
-
-                bool samplebiasdir = false;
-                bool samplenull = false;
-                bool sampledelta = false;
-                if (_busebiasing && _ssampler->SampleSequenceOneReal() < _nullsampleprob)
-                {
-                    samplenull = true;
-                }
-                if (_busebiasing && _ssampler->SampleSequenceOneReal() < _nullbiassampleprob) {
-                    samplebiasdir = true;
-                }
-                if( (!samplenull && !samplebiasdir) || _ssampler->SampleSequenceOneReal() < _deltasampleprob ) {
-                    sampledelta = true;
-                }
-
-                bool deltasuccess = false;
-                if( sampledelta ) {
-                    // check which third the sampled dof is in
-                    for(size_t j = 0; j < vnewdof.size(); ++j) {
-                        dReal f = 2*_ssampler->SampleSequenceOneReal(interval)-1; // f in [-1,1]
-                        if( RaveFabs(f) < fJitterLowerThresh ) {
-                            _deltadof[j] = 0;
-                        }
-                        else if( f < -fJitterHigherThresh ) {
-                            _deltadof[j] = -jitter;
-                        }
-                        else if( f > fJitterHigherThresh ) {
-                            _deltadof[j] = jitter;
-                        }
-                        else {
-                            _deltadof[j] = jitter*f;
-                        }
-                    }
-                }
-
-                if (!samplebiasdir && !samplenull && !deltasuccess) {
-                    continue;
-                }
-                // (lambda * biasdir) + (Nx) + delta + _curdofs
-                dReal fNullspaceMultiplier = linkdistthresh*2;
-                if( fNullspaceMultiplier <= 0 ) {
-                    fNullspaceMultiplier = fBias;
-                }
-                for (size_t j = 0; j < _vbiasnullspace.size(); ++j) {
-                    for (size_t k = 0; k < vnewdof.size(); ++k)
-                    {
-                        vnewdof[k] = _curdof[k];
-                        if (samplebiasdir) {
-                            vnewdof[k] += _ssampler->SampleSequenceOneReal() * _vbiasdofdirection[k];
-                        }
-                        if (samplenull) {
-                            dReal nullx = (_ssampler->SampleSequenceOneReal()*2-1)*fNullspaceMultiplier;
-                            vnewdof[k] += nullx * _vbiasnullspace[j][k];
-                        }
-                        if (sampledelta) {
-                            vnewdof[k] += _deltadof[k];
-                        }
-                    }
-                }
-            }
-
-            // get new state
-            for(size_t j = 0; j < _deltadof.size(); ++j) {
-                if( vnewdof[j] > _upper.at(j) ) {
-                    vnewdof[j] = _upper.at(j);
-                }
-                else if( vnewdof[j] < _lower.at(j) ) {
-                    vnewdof[j] = _lower.at(j);
-                }
+            if( !_SampleJitteredConfiguration(iter, vnewdof, interval) ) {
+                continue;
             }
 
             if( !!_cache ) {
@@ -548,78 +502,9 @@ By default will sample the robot's active DOFs. Parameters part of the interface
             //BOOST_ASSERT(ret==1);
 
             _probot->SetActiveDOFValues(vnewdof);
-#ifdef _DEBUG
             dReal fmaxtransdist = 0;
-#endif
-            bool bSuccess = true;
-            if( linkdistthresh > 0 ) {
-                for (size_t ilink = 0; ilink < _vLinkAABBs.size(); ++ilink) {
-                    // check for an elipse
-                    // L^2 (b*v)^2 + |v|^2|b|^4 - (b*v)^2 |b|^2 <= |b|^4 * L^2
-                    Transform tnewlink = _vLinks[ilink]->GetTransform();
-                    TransformMatrix projdelta = _vOriginalInvTransforms[ilink] * tnewlink;
-                    projdelta.m[0] -= 1;
-                    projdelta.m[5] -= 1;
-                    projdelta.m[10] -= 1;
-                    Vector projextents = _vLinkAABBs[ilink].extents;
-                    Vector projboxright(projdelta.m[0]*projextents.x, projdelta.m[4]*projextents.x, projdelta.m[8]*projextents.x);
-                    Vector projboxup(projdelta.m[1]*projextents.y, projdelta.m[5]*projextents.y, projdelta.m[9]*projextents.y);
-                    Vector projboxdir(projdelta.m[2]*projextents.z, projdelta.m[6]*projextents.z, projdelta.m[10]*projextents.z);
-                    Vector projboxpos = projdelta * _vLinkAABBs[ilink].pos;
-
-                    Vector b;
-                    if( bUsingBias ) {
-                        b = _vOriginalInvTransforms[ilink].rotate(_vbiasdirection); // inside link coordinate system
-                    }
-                    else {
-                        // doesn't matter which vector we pick since it is just a sphere.
-                        b = Vector(0,0,linkdistthresh);
-                    }
-
-                    dReal blength2 = b.lengthsqr3();
-                    dReal blength4 = blength2*blength2;
-                    dReal rhs = blength4 * linkdistthresh2;
-                    //dReal rhs = (b.lengthsqr3()) * linkdistthresh;
-                    dReal ellipdist = 0;
-                    // now figure out what is the max distance
-                    for(int ix = 0; ix < 2; ++ix) {
-                        Vector projvx = ix > 0 ? projboxpos + projboxright : projboxpos - projboxright;
-                        for(int iy = 0; iy < 2; ++iy) {
-                            Vector projvy = iy > 0 ? projvx + projboxup : projvx - projboxup;
-                            for(int iz = 0; iz < 2; ++iz) {
-                                Vector projvz = iz > 0 ? projvy + projboxdir : projvy - projboxdir;
-                                Vector v = projvz; // inside link coordinate system
-                                dReal bv = (v.dot3(b));
-                                dReal bv2 = bv*bv;
-                                dReal flen2 = (linkdistthresh2 - blength2) * bv2 + v.lengthsqr3()*blength4;
-
-                                if( ellipdist < flen2 ) {
-                                    ellipdist = flen2;
-#ifdef _DEBUG
-                                    fmaxtransdist = flen2;
-#endif
-                                    if (ellipdist > rhs) {
-                                        bSuccess = false;
-                                        break;
-                                    }
-                                }
-                            }
-
-                            if (ellipdist > rhs) {
-                                bSuccess = false;
-                                break;
-                            }
-                        }
-                        if (ellipdist > rhs) {
-                            bSuccess = false;
-                            break;
-                        }
-                    }
-                }
-
-                if (!bSuccess) {
-                    continue;
-                }
+            if( linkdistthresh > 0 && !_CheckLinkDistance(bUsingBias, fmaxtransdist) ) {
+                continue;
             }
 
             // check perturbation
@@ -711,6 +596,282 @@ By default will sample the robot's active DOFs. Parameters part of the interface
     }
 
 protected:
+    /// \brief samples the jittered configuration of iteration iter around _curdof, clamped to the limits
+    ///
+    /// \return false if nothing was sampled
+    bool _SampleJitteredConfiguration(int iter, std::vector<dReal>& vnewdof, IntervalType interval)
+    {
+        bool bUsingBias = _vbiasdofdirection.size() > 0;
+        const boost::array<dReal, 3> rayincs = {{0.5, 0.9, 0.2}};
+
+        const int nMaxIterRadiusThresh=_maxiterations/2;
+        const dReal imaxiterations = 2.0/dReal(_maxiterations);
+        const dReal fJitterLowerThresh=0.2, fJitterHigherThresh=0.8;
+        dReal fBias = _vbiasdirection.lengthsqr3();
+        if( fBias > g_fEpsilon ) {
+            fBias = RaveSqrt(fBias);
+        }
+
+        if( bUsingBias && iter < (int)rayincs.size() ) {
+            // start by checking samples directly above the current configuration
+            for (size_t j = 0; j < vnewdof.size(); ++j) {
+                vnewdof[j] = _curdof[j] + (rayincs[iter] * _vbiasdofdirection.at(j));
+            }
+        }
+        else {
+            // ramp of the jitter as iterations increase
+            dReal jitter = _maxjitter;
+            if( iter < nMaxIterRadiusThresh ) {
+                jitter = _maxjitter*dReal(iter)*imaxiterations;
+            }
+
+            bool samplebiasdir = false;
+            bool samplenull = false;
+            bool sampledelta = false;
+            if (_busebiasing && _ssampler->SampleSequenceOneReal() < _nullsampleprob)
+            {
+                samplenull = true;
+            }
+            if (_busebiasing && _ssampler->SampleSequenceOneReal() < _nullbiassampleprob) {
+                samplebiasdir = true;
+            }
+            if( (!samplenull && !samplebiasdir) || _ssampler->SampleSequenceOneReal() < _deltasampleprob ) {
+                sampledelta = true;
+            }
+
+            bool deltasuccess = false;
+            if( sampledelta ) {
+                // check which third the sampled dof is in
+                for(size_t j = 0; j < vnewdof.size(); ++j) {
+                    dReal f = 2*_ssampler->SampleSequenceOneReal(interval)-1; // f in [-1,1]
+                    if( RaveFabs(f) < fJitterLowerThresh ) {
+                        _deltadof[j] = 0;
+                    }
+                    else if( f < -fJitterHigherThresh ) {
+                        _deltadof[j] = -jitter;
+                    }
+                    else if( f > fJitterHigherThresh ) {
+                        _deltadof[j] = jitter;
+                    }
+                    else {
+                        _deltadof[j] = jitter*f;
+                    }
+                }
+                deltasuccess = true;
+            }
+
+            if (!samplebiasdir && !samplenull && !deltasuccess) {
+                return false;
+            }
+            // (lambda * biasdir) + (Nx) + delta + _curdofs
+            dReal fNullspaceMultiplier = _linkdistthresh*2;
+            if( fNullspaceMultiplier <= 0 ) {
+                fNullspaceMultiplier = fBias;
+            }
+            for (size_t k = 0; k < vnewdof.size(); ++k) {
+                vnewdof[k] = _curdof[k];
+                if (samplebiasdir) {
+                    vnewdof[k] += _ssampler->SampleSequenceOneReal() * _vbiasdofdirection[k];
+                }
+                if (sampledelta) {
+                    vnewdof[k] += _deltadof[k];
+                }
+            }
+            if (samplenull) {
+                for (size_t j = 0; j < _vbiasnullspace.size(); ++j) {
+                    dReal nullx = (_ssampler->SampleSequenceOneReal()*2-1)*fNullspaceMultiplier;
+                    for (size_t k = 0; k < vnewdof.size(); ++k) {
+                        vnewdof[k] += nullx * _vbiasnullspace[j][k];
+                    }
+                }
+            }
+        }
+
+        // get new state
+        for(size_t j = 0; j < _deltadof.size(); ++j) {
+            if( vnewdof[j] > _upper.at(j) ) {
+                vnewdof[j] = _upper.at(j);
+            }
+            else if( vnewdof[j] < _lower.at(j) ) {
+                vnewdof[j] = _lower.at(j);
+            }
+        }
+        return true;
+    }
+
+    /// \brief checks that the links did not move farther than _linkdistthresh from _vOriginalTransforms
+    ///
+    /// The allowed motion is a sphere, or an elipse along the bias direction if the manipulator bias is set.
+    /// \param fmaxtransdist set to the largest squared elipse distance of the link box corners
+    bool _CheckLinkDistance(bool bUsingBias, dReal& fmaxtransdist)
+    {
+        if( _linkdistthresh > 0 ) {
+            for (size_t ilink = 0; ilink < _vLinkAABBs.size(); ++ilink) {
+                // check for an elipse
+                // L^2 (b*v)^2 + |v|^2|b|^4 - (b*v)^2 |b|^2 <= |b|^4 * L^2
+                Transform tnewlink = _vLinks[ilink]->GetTransform();
+                TransformMatrix projdelta = _vOriginalInvTransforms[ilink] * tnewlink;
+                projdelta.m[0] -= 1;
+                projdelta.m[5] -= 1;
+                projdelta.m[10] -= 1;
+                Vector projextents = _vLinkAABBs[ilink].extents;
+                Vector projboxright(projdelta.m[0]*projextents.x, projdelta.m[4]*projextents.x, projdelta.m[8]*projextents.x);
+                Vector projboxup(projdelta.m[1]*projextents.y, projdelta.m[5]*projextents.y, projdelta.m[9]*projextents.y);
+                Vector projboxdir(projdelta.m[2]*projextents.z, projdelta.m[6]*projextents.z, projdelta.m[10]*projextents.z);
+                Vector projboxpos = projdelta * _vLinkAABBs[ilink].pos;
+
+                Vector b;
+                if( bUsingBias ) {
+                    b = _vOriginalInvTransforms[ilink].rotate(_vbiasdirection); // inside link coordinate system
+                }
+                else {
+                    // doesn't matter which vector we pick since it is just a sphere.
+                    b = Vector(0,0,_linkdistthresh);
+                }
+
+                dReal blength2 = b.lengthsqr3();
+                dReal blength4 = blength2*blength2;
+                dReal rhs = blength4 * _linkdistthresh2;
+                //dReal rhs = (b.lengthsqr3()) * linkdistthresh;
+                dReal ellipdist = 0;
+                // now figure out what is the max distance
+                for(int ix = 0; ix < 2; ++ix) {
+                    Vector projvx = ix > 0 ? projboxpos + projboxright : projboxpos - projboxright;
+                    for(int iy = 0; iy < 2; ++iy) {
+                        Vector projvy = iy > 0 ? projvx + projboxup : projvx - projboxup;
+                        for(int iz = 0; iz < 2; ++iz) {
+                            Vector projvz = iz > 0 ? projvy + projboxdir : projvy - projboxdir;
+                            Vector v = projvz; // inside link coordinate system
+                            dReal bv = (v.dot3(b));
+                            dReal bv2 = bv*bv;
+                            dReal flen2 = (_linkdistthresh2 - blength2) * bv2 + v.lengthsqr3()*blength4;
+
+                            if( ellipdist < flen2 ) {
+                                ellipdist = flen2;
+                                fmaxtransdist = flen2;
+                                if (ellipdist > rhs) {
+                                    return false;
+                                }
+                            }
+                        }
+                    }
+                }
+            }
+        }
+        return true;
+    }
+
+    /// \brief samples rounds of _nBatchSize configurations and returns the one closest to _curdof of the first round that has a collision free one
+    int _SampleBatch(std::vector<dReal>& vnewdof, const std::vector<dReal>& perturbations, RobotBase::RobotStateSaver& robotsaver, IntervalType interval, uint64_t starttime)
+    {
+        bool bUsingBias = _vbiasdofdirection.size() > 0;
+        _probot->SetActiveDOFValues(_curdof);
+        if( !_batchchecker ) {
+            _batchchecker.reset(new planningutils::ActiveDOFBatchChecker(_probot, _nBatchThreads));
+            _GetBodyStamps(_vbatchbodystamps);
+            _probot->GetDOFValues(_vbatchdofvalues);
+            _tbatchrobot = _probot->GetTransform();
+        }
+        else {
+            // only synchronize the clones when the environment changed since the last batch. the robot stamp changes with
+            // every SetDOFValues, so its state is compared directly
+            _GetBodyStamps(_vnewbodystamps);
+            _probot->GetDOFValues(_vnewdofvalues);
+            Transform trobot = _probot->GetTransform();
+            bool bchanged = _vnewbodystamps != _vbatchbodystamps || _vnewdofvalues.size() != _vbatchdofvalues.size() || TransformDistance2(trobot, _tbatchrobot) > g_fEpsilonLinear;
+            for(size_t i = 0; i < _vnewdofvalues.size() && !bchanged; ++i) {
+                // passive joints are recomputed from the link transforms, so allow for round-off
+                bchanged = RaveFabs(_vnewdofvalues[i]-_vbatchdofvalues[i]) > g_fEpsilonLinear;
+            }
+            if( bchanged ) {
+                _batchchecker->SynchronizeEnvironments();
+                _vbatchbodystamps.swap(_vnewbodystamps);
+                _vbatchdofvalues.swap(_vnewdofvalues);
+                _tbatchrobot = trobot;
+            }
+        }
+        // the link sphere bound of the checker is used unless the allowed motion is an elipse along the bias direction
+        _batchchecker->SetLinkDistanceThreshold(bUsingBias ? 0 : _linkdistthresh);
+
+        std::vector< std::vector<dReal> > vsamples, vconfigs;
+        std::vector< std::pair<dReal, int> > vdistindices;
+        dReal fmaxtransdist = 0;
+        int iter = 0;
+        while( iter < _maxiterations ) {
+            _CallStatusFunctions(iter);
+            vsamples.resize(0);
+            while( (int)vsamples.size() < _nBatchSize && iter < _maxiterations ) {
+                if( !_SampleJitteredConfiguration(iter++, vnewdof, interval) ) {
+                    continue;
+                }
+                if( !!_cache ) {
+                    if( !!_cache->FindNearestNode(vnewdof, _neighdistthresh).first ) {
+                        _cachehit++;
+                        continue;
+                    }
+                }
+                if( bUsingBias && _linkdistthresh > 0 ) {
+                    _probot->SetActiveDOFValues(vnewdof);
+                    if( !_CheckLinkDistance(bUsingBias, fmaxtransdist) ) {
+                        continue;
+                    }
+                }
+                vsamples.push_back(vnewdof);
+            }
+
+            vdistindices.resize(vsamples.size());
+            for(size_t i = 0; i < vsamples.size(); ++i) {
+                dReal fdist = 0;
+                for(size_t j = 0; j < _curdof.size(); ++j) {
+                    dReal f = vsamples[i][j] - _curdof[j];
+                    fdist += _vweights.at(j)*f*f;
+                }
+                vdistindices[i] = std::make_pair(fdist, (int)i);
+            }
+            std::sort(vdistindices.begin(), vdistindices.end());
+            vconfigs.resize(vsamples.size());
+            for(size_t i = 0; i < vdistindices.size(); ++i) {
+                vconfigs[i].swap(vsamples[vdistindices[i].second]);
+            }
+
+            int index = _batchchecker->CheckBatch(vconfigs, perturbations, &_vbatchresults);
+            if( !!_cache ) {
+                // same as _curdof, later rounds skip the samples close to a configuration in collision
+                for(size_t i = 0; i < _vbatchresults.size(); ++i) {
+                    if( _vbatchresults[i] == -1 ) {
+                        _cache->InsertNode(vconfigs[i], CollisionReportPtr(), _neighdistthresh);
+                    }
+                }
+            }
+            if( index >= 0 ) {
+                vnewdof = vconfigs[index];
+                _probot->SetActiveDOFValues(vnewdof);
+                if( _bSetResultOnRobot ) {
+                    // have to release the saver so it does not restore the old configuration
+                    robotsaver.Release();
+                }
+                const planningutils::JitterStatistics& statistics = _batchchecker->GetStatistics();
+                RAVELOG_DEBUG_FORMAT("succeed iterations=%d, checked=%d, pruned=%d, computation=%fs", iter%statistics.numchecked%statistics.numpruned%(1e-9*(utils::GetNanoPerformanceTime() - starttime)));
+                return 1;
+            }
+        }
+
+        RAVELOG_INFO_FORMAT("failed iterations=%d, computation=%fs\n",_maxiterations%(1e-9*(utils::GetNanoPerformanceTime() - starttime)));
+        return 0;
+    }
+
+    /// \brief gets the environment id and update stamp of every body of the environment except the robot and its grabbed bodies, which move with the robot
+    void _GetBodyStamps(std::vector< std::pair<int, int> >& vstamps)
+    {
+        GetEnv()->GetBodies(_vtempbodies);
+        vstamps.resize(0);
+        FOREACHC(itbody, _vtempbodies) {
+            if( *itbody != _probot && !_probot->IsGrabbing(*itbody) ) {
+                vstamps.push_back(std::make_pair((*itbody)->GetEnvironmentId(), (*itbody)->GetUpdateStamp()));
+            }
+        }
+        _vtempbodies.resize(0);
+    }
 
     /// \brief extracts all used bodies from the configurationspecification and computes AABBs, transforms, and limits for links
     void _InitRobotState()
@@ -747,6 +908,7 @@ protected:
         }
 
         //_SetCacheMaxDistance();
+        _vbatchdofvalues.resize(0); // grabbed bodies are not in the stamps, so force the batch checker to synchronize
     }
 
     void _UpdateLimits()
@@ -816,6 +978,17 @@ protected:
     std::vector<dReal> _vbiasdofdirection; // direction to bias in configuration space (from jacobian)
     std::vector< std::vector<dReal> > _vbiasnullspace; // configuration nullspace that does not constraint rotation. vectors are unit
 
+    std::vector<dReal> _vweights; ///< inverse of the active dof resolutions, for the cache and ordering the batches
+
+    int _nBatchSize; ///< number of configurations sampled per round, if 1 then every configuration is checked when it is sampled
+    int _nBatchThreads; ///< number of threads checking a batch
+    boost::shared_ptr<planningutils::ActiveDOFBatchChecker> _batchchecker; ///< created on the first batched sample
+    std::vector< std::pair<int, int> > _vbatchbodystamps, _vnewbodystamps; ///< the body stamps of the environment when _batchchecker was last synchronized, see _GetBodyStamps
+    std::vector<dReal> _vbatchdofvalues, _vnewdofvalues; ///< the dof values of the robot when _batchchecker was last synchronized
+    Transform _tbatchrobot; ///< the transform of the robot when _batchchecker was last synchronized
+    std::vector<int> _vbatchresults; ///< the results of the last batch, see planningutils::ActiveDOFBatchChecker::CheckBatch
+    std::vector<KinBodyPtr> _vtempbodies;
+
     bool _bSetResultOnRobot; ///< if true, will set the final result on the robot DOF values
     bool _busebiasing; ///< if true will bias the end effector along a certain direction using the jacobian and nullspace.
 };
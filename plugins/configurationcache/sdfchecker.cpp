@@ -0,0 +1,1042 @@
+// -*- coding: utf-8 -*-
+// Copyright (C) 2014 Alejandro Perez & Rosen Diankov
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+#include "openraveplugindefs.h"
+#include <iomanip>
+#include <cstdio>
+#include <cstring>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <utime.h>
+#define SDF_HAS_MMAP
+#endif
+
+namespace configurationcache
+{
+
+/// \brief signed distance field of a triangle mesh sampled on a regular grid
+///
+/// Distances are positive outside of the geometry and negative inside. A saved field is a Header followed by the
+/// float values in x-major order, so it can be memory mapped directly when loaded.
+class SignedDistanceField
+{
+public:
+    struct Header
+    {
+        char magic[8];
+        int32_t version;
+        int32_t dims[3];
+        float origin[3];
+        float cellsize;
+        float padding; ///< minimum distance between the geometry and the border of the grid
+    };
+
+    SignedDistanceField() : _pvalues(NULL), _pmapped(NULL), _mappedsize(0) {
+        memset(&_header, 0, sizeof(_header));
+    }
+    virtual ~SignedDistanceField() {
+        _Unmap();
+    }
+
+    bool IsValid() const {
+        return !!_pvalues;
+    }
+
+    dReal GetCellSize() const {
+        return _header.cellsize;
+    }
+
+    /// \brief maximum amount GetDistance can over-estimate the true distance of a point
+    ///
+    /// Accounts for sampling the triangles at half a cell, snapping the samples to the grid and interpolating between grid points.
+    dReal GetErrorBound() const {
+        return _header.cellsize*(0.5+1.5*RaveSqrt(dReal(3)));
+    }
+
+    /// \brief builds the field from the mesh
+    ///
+    /// \param maxcells if the grid would have more cells than this, cellsize is increased
+    void Build(const TriMesh& trimesh, dReal cellsize, dReal padding, int maxcells)
+    {
+        _Unmap();
+        _vvalues.resize(0);
+        _pvalues = NULL;
+        if( trimesh.vertices.size() == 0 || trimesh.indices.size() == 0 ) {
+            return;
+        }
+
+        Vector vmin = trimesh.vertices.at(0), vmax = vmin;
+        FOREACHC(itv, trimesh.vertices) {
+            for(int j = 0; j < 3; ++j) {
+                vmin[j] = min(vmin[j], (*itv)[j]);
+                vmax[j] = max(vmax[j], (*itv)[j]);
+            }
+        }
+        int dims[3];
+        while(1) {
+            for(int j = 0; j < 3; ++j) {
+                dims[j] = (int)RaveCeil((vmax[j]-vmin[j]+2*padding)/cellsize)+1;
+            }
+            dReal fnumcells = dReal(dims[0])*dReal(dims[1])*dReal(dims[2]);
+            if( fnumcells <= maxcells ) {
+                break;
+            }
+            dReal fnewcellsize = cellsize*RavePow(fnumcells/maxcells, dReal(1)/dReal(3))*1.01;
+            RAVELOG_WARN_FORMAT("sdf grid with cell size %f needs %d cells, increasing cell size to %f", cellsize%fnumcells%fnewcellsize);
+            cellsize = fnewcellsize;
+        }
+
+        memcpy(_header.magic, "ravesdf", 8);
+        _header.version = s_version;
+        _header.cellsize = cellsize;
+        _header.padding = padding;
+        for(int j = 0; j < 3; ++j) {
+            _header.dims[j] = dims[j];
+            _header.origin[j] = vmin[j]-padding;
+        }
+        int numcells = dims[0]*dims[1]*dims[2];
+
+        // 1 for cells touched by the surface or inside of the geometry
+        std::vector<uint8_t> vsolid(numcells, 0);
+        for(size_t i = 0; i+2 < trimesh.indices.size(); i += 3) {
+            _VoxelizeTriangle(trimesh.vertices.at(trimesh.indices[i]), trimesh.vertices.at(trimesh.indices[i+1]), trimesh.vertices.at(trimesh.indices[i+2]), vsolid);
+        }
+        _FillInterior(vsolid);
+
+        std::vector<float> voutside(numcells), vinside(numcells);
+        for(int i = 0; i < numcells; ++i) {
+            voutside[i] = vsolid[i] ? 0 : s_fInfinity;
+            vinside[i] = vsolid[i] ? s_fInfinity : 0;
+        }
+        _SquaredDistanceTransform(voutside);
+        _SquaredDistanceTransform(vinside);
+
+        _vvalues.resize(numcells);
+        for(int i = 0; i < numcells; ++i) {
+            _vvalues[i] = vsolid[i] ? -sqrtf(vinside[i])*cellsize : sqrtf(voutside[i])*cellsize;
+        }
+        _pvalues = &_vvalues[0];
+    }
+
+    bool Save(const std::string& filename) const
+    {
+        if( !_pvalues ) {
+            return false;
+        }
+        FILE* pfile = fopen(filename.c_str(), "wb");
+        if( !pfile ) {
+            return false;
+        }
+        size_t numcells = _GetNumCells();
+        bool bsuccess = fwrite(&_header, sizeof(_header), 1, pfile) == 1 && fwrite(_pvalues, sizeof(float)*numcells, 1, pfile) == 1;
+        fclose(pfile);
+        return bsuccess;
+    }
+
+    bool Load(const std::string& filename)
+    {
+        _Unmap();
+        _vvalues.resize(0);
+        _pvalues = NULL;
+#ifdef SDF_HAS_MMAP
+        int fd = open(filename.c_str(), O_RDONLY);
+        if( fd < 0 ) {
+            return false;
+        }
+        struct stat filestat;
+        if( fstat(fd, &filestat) != 0 || (size_t)filestat.st_size < sizeof(Header) ) {
+            close(fd);
+            return false;
+        }
+        void* pmapped = mmap(NULL, filestat.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        close(fd);
+        if( pmapped == MAP_FAILED ) {
+            return false;
+        }
+        _pmapped = pmapped;
+        _mappedsize = filestat.st_size;
+        memcpy(&_header, _pmapped, sizeof(_header));
+        if( !_IsHeaderValid() || _mappedsize != sizeof(Header)+sizeof(float)*_GetNumCells() ) {
+            _Unmap();
+            return false;
+        }
+        _pvalues = (const float*)((const uint8_t*)_pmapped + sizeof(Header));
+        return true;
+#else
+        FILE* pfile = fopen(filename.c_str(), "rb");
+        if( !pfile ) {
+            return false;
+        }
+        bool bsuccess = fread(&_header, sizeof(_header), 1, pfile) == 1 && _IsHeaderValid();
+        if( bsuccess ) {
+            _vvalues.resize(_GetNumCells());
+            bsuccess = fread(&_vvalues[0], sizeof(float)*_vvalues.size(), 1, pfile) == 1;
+        }
+        fclose(pfile);
+        if( !bsuccess ) {
+            _vvalues.resize(0);
+            return false;
+        }
+        _pvalues = &_vvalues[0];
+        return true;
+#endif
+    }
+
+    /// \brief returns the trilinearly interpolated distance of a point to the geometry.
+    ///
+    /// Points outside of the grid return a lower bound of the distance.
+    dReal GetDistance(const Vector& p) const
+    {
+        dReal fcellsizeinv = 1/dReal(_header.cellsize);
+        dReal q[3];
+        dReal foutside = 0;
+        for(int j = 0; j < 3; ++j) {
+            q[j] = (p[j]-_header.origin[j])*fcellsizeinv;
+            if( q[j] < 0 ) {
+                foutside += q[j]*q[j];
+            }
+            else if( q[j] > _header.dims[j]-1 ) {
+                foutside += utils::Sqr(q[j]-(_header.dims[j]-1));
+            }
+        }
+        if( foutside > 0 ) {
+            // the geometry is at least padding away from the grid border
+            return RaveSqrt(foutside)*_header.cellsize + _header.padding;
+        }
+
+        int index[3];
+        dReal frac[3];
+        for(int j = 0; j < 3; ++j) {
+            index[j] = min((int)q[j], _header.dims[j]-2);
+            frac[j] = q[j]-index[j];
+        }
+        int stridey = _header.dims[2], stridex = _header.dims[1]*_header.dims[2];
+        const float* pcell = _pvalues + index[0]*stridex + index[1]*stridey + index[2];
+        dReal c00 = pcell[0]*(1-frac[2]) + pcell[1]*frac[2];
+        dReal c01 = pcell[stridey]*(1-frac[2]) + pcell[stridey+1]*frac[2];
+        dReal c10 = pcell[stridex]*(1-frac[2]) + pcell[stridex+1]*frac[2];
+        dReal c11 = pcell[stridex+stridey]*(1-frac[2]) + pcell[stridex+stridey+1]*frac[2];
+        dReal c0 = c00*(1-frac[1]) + c01*frac[1];
+        dReal c1 = c10*(1-frac[1]) + c11*frac[1];
+        return c0*(1-frac[0]) + c1*frac[0];
+    }
+
+private:
+    size_t _GetNumCells() const {
+        return size_t(_header.dims[0])*size_t(_header.dims[1])*size_t(_header.dims[2]);
+    }
+
+    bool _IsHeaderValid() const {
+        return memcmp(_header.magic, "ravesdf", 8) == 0 && _header.version == s_version && _header.cellsize > 0 && _header.dims[0] >= 2 && _header.dims[1] >= 2 && _header.dims[2] >= 2;
+    }
+
+    void _Unmap()
+    {
+#ifdef SDF_HAS_MMAP
+        if( !!_pmapped ) {
+            munmap(_pmapped, _mappedsize);
+        }
+#endif
+        _pmapped = NULL;
+        _mappedsize = 0;
+    }
+
+    /// \brief marks the grid points closest to samples of the triangle spaced at most half a cell apart
+    void _VoxelizeTriangle(const Vector& v0, const Vector& v1, const Vector& v2, std::vector<uint8_t>& vsolid)
+    {
+        dReal fmaxedge = RaveSqrt(max((v1-v0).lengthsqr3(), max((v2-v0).lengthsqr3(), (v2-v1).lengthsqr3())));
+        int num = max(1, (int)RaveCeil(fmaxedge/(0.5*_header.cellsize)));
+        dReal fcellsizeinv = 1/dReal(_header.cellsize);
+        for(int i = 0; i <= num; ++i) {
+            for(int j = 0; i+j <= num; ++j) {
+                Vector p = v0 + (v1-v0)*(dReal(i)/num) + (v2-v0)*(dReal(j)/num);
+                int index[3];
+                for(int k = 0; k < 3; ++k) {
+                    index[k] = max(0, min(_header.dims[k]-1, (int)((p[k]-_header.origin[k])*fcellsizeinv+dReal(0.5))));
+                }
+                vsolid[(index[0]*_header.dims[1]+index[1])*_header.dims[2]+index[2]] = 1;
+            }
+        }
+    }
+
+    /// \brief marks every cell not reachable from the grid border as solid
+    void _FillInterior(std::vector<uint8_t>& vsolid)
+    {
+        const int* dims = _header.dims;
+        std::vector<uint8_t> voutside(vsolid.size(), 0);
+        std::vector<int> vstack;
+        for(int ix = 0; ix < dims[0]; ++ix) {
+            for(int iy = 0; iy < dims[1]; ++iy) {
+                for(int iz = 0; iz < dims[2]; ++iz) {
+                    if( ix == 0 || iy == 0 || iz == 0 || ix == dims[0]-1 || iy == dims[1]-1 || iz == dims[2]-1 ) {
+                        int index = (ix*dims[1]+iy)*dims[2]+iz;
+                        if( !vsolid[index] && !voutside[index] ) {
+                            voutside[index] = 1;
+                            vstack.push_back(index);
+                        }
+                    }
+                }
+            }
+        }
+        int strides[3] = { dims[1]*dims[2], dims[2], 1};
+        while(vstack.size() > 0) {
+            int index = vstack.back();
+            vstack.pop_back();
+            int coords[3] = { index/strides[0], (index/strides[1])%dims[1], index%dims[2]};
+            for(int k = 0; k < 3; ++k) {
+                for(int step = -1; step <= 1; step += 2) {
+                    if( coords[k]+step < 0 || coords[k]+step >= dims[k] ) {
+                        continue;
+                    }
+                    int neighindex = index+step*strides[k];
+                    if( !vsolid[neighindex] && !voutside[neighindex] ) {
+                        voutside[neighindex] = 1;
+                        vstack.push_back(neighindex);
+                    }
+                }
+            }
+        }
+        for(size_t i = 0; i < vsolid.size(); ++i) {
+            if( !voutside[i] ) {
+                vsolid[i] = 1;
+            }
+        }
+    }
+
+    /// \brief exact squared euclidean distance transform in cell units, separable along every axis (Felzenszwalb & Huttenlocher)
+    ///
+    /// \param[inout] vvalues 0 at the feature cells, s_fInfinity everywhere else
+    void _SquaredDistanceTransform(std::vector<float>& vvalues)
+    {
+        const int* dims = _header.dims;
+        int strides[3] = { dims[1]*dims[2], dims[2], 1};
+        int maxdim = max(dims[0], max(dims[1], dims[2]));
+        std::vector<float> f(maxdim), d(maxdim), z(maxdim+1);
+        std::vector<int> v(maxdim);
+        for(int axis = 0; axis < 3; ++axis) {
+            int axis1 = (axis+1)%3, axis2 = (axis+2)%3;
+            int n = dims[axis];
+            for(int i1 = 0; i1 < dims[axis1]; ++i1) {
+                for(int i2 = 0; i2 < dims[axis2]; ++i2) {
+                    int offset = i1*strides[axis1] + i2*strides[axis2];
+                    for(int i = 0; i < n; ++i) {
+                        f[i] = vvalues[offset+i*strides[axis]];
+                    }
+                    // lower envelope of the parabolas rooted at the finite cells
+                    int k = -1;
+                    for(int q = 0; q < n; ++q) {
+                        if( f[q] >= s_fInfinity ) {
+                            continue;
+                        }
+                        while(k >= 0) {
+                            float s = ((f[q]+q*q)-(f[v[k]]+v[k]*v[k]))/(2*q-2*v[k]);
+                            if( s > z[k] ) {
+                                break;
+                            }
+                            --k;
+                        }
+                        ++k;
+                        v[k] = q;
+                        z[k] = k == 0 ? -s_fInfinity : ((f[q]+q*q)-(f[v[k-1]]+v[k-1]*v[k-1]))/(2*q-2*v[k-1]);
+                        z[k+1] = s_fInfinity;
+                    }
+                    if( k < 0 ) {
+                        continue; // no feature on this row
+                    }
+                    k = 0;
+                    for(int q = 0; q < n; ++q) {
+                        while(z[k+1] < q) {
+                            ++k;
+                        }
+                        d[q] = utils::Sqr(float(q-v[k])) + f[v[k]];
+                    }
+                    for(int i = 0; i < n; ++i) {
+                        vvalues[offset+i*strides[axis]] = d[i];
+                    }
+                }
+            }
+        }
+    }
+
+    static const int s_version = 1;
+    static const float s_fInfinity;
+
+    Header _header;
+    std::vector<float> _vvalues; ///< the values when the field is built or read in memory
+    const float* _pvalues; ///< points to either _vvalues or the mapped file
+    void* _pmapped;
+    size_t _mappedsize;
+};
+
+const float SignedDistanceField::s_fInfinity = 1e20f;
+
+typedef boost::shared_ptr<SignedDistanceField> SignedDistanceFieldPtr;
+
+/// \brief checks bodies against the static part of the environment with a signed distance field.
+///
+/// Static bodies (not robots, no dofs, nothing attached) are voxelized into a signed distance field that is cached in
+/// the database directory. A body that moves after the field was built is not static anymore, so that moving objects
+/// around does not rebuild the field every time. Links are approximated by their KinBody::Link::SphereTree, so checking a link against
+/// the static bodies only requires one field lookup per visited sphere. Collisions between the non-static bodies and every query the
+/// field cannot answer are passed to the internal checker. When a sphere gets close to the static geometry, the internal
+/// checker confirms the collision unless SetExactCheck is disabled.
+class SDFCollisionChecker : public CollisionCheckerBase
+{
+public:
+    SDFCollisionChecker(EnvironmentBasePtr penv, std::istream& sinput) : CollisionCheckerBase(penv)
+    {
+        RegisterCommand("SetStaticBodies",boost::bind(&SDFCollisionChecker::_SetStaticBodiesCommand,this,_1,_2),
+                        "set the names of the bodies stored in the distance field. If no names are given, all bodies that are not robots, have no dofs and have nothing attached are used.");
+        RegisterCommand("SetCellSize",boost::bind(&SDFCollisionChecker::_SetCellSizeCommand,this,_1,_2),
+                        "set the cell size of the distance field. [cellsize]");
+        RegisterCommand("SetExactCheck",boost::bind(&SDFCollisionChecker::_SetExactCheckCommand,this,_1,_2),
+                        "if 1 (default), links close to the static bodies are checked with the internal checker, otherwise they are reported as colliding.");
+        RegisterCommand("GetStatistics",boost::bind(&SDFCollisionChecker::_GetStatisticsCommand,this,_1,_2),
+                        "get the statistics since the last call: fieldchecks, fieldfree, fallbacks, rebuilds");
+        RegisterCommand("ResetField",boost::bind(&SDFCollisionChecker::_ResetFieldCommand,this,_1,_2),
+                        "rebuild the distance field on the next query");
+        std::string collisionname="ode";
+        sinput >> collisionname;
+        _pintchecker = RaveCreateCollisionChecker(GetEnv(), collisionname);
+        OPENRAVE_ASSERT_FORMAT(!!_pintchecker, "internal checker %s is not valid", collisionname, ORE_Assert);
+        _fCellSize = 0.01;
+        _fPadding = 0.1;
+        _nMaxCells = 256*256*256;
+        _bExactCheck = true;
+        _bStaticDirty = true;
+        _nfieldchecks = _nfieldfree = _nfallbacks = _nrebuilds = 0;
+    }
+
+    virtual ~SDFCollisionChecker() {
+    }
+
+    virtual bool SetCollisionOptions(int collisionoptions)
+    {
+        return _pintchecker->SetCollisionOptions(collisionoptions);
+    }
+
+    virtual int GetCollisionOptions() const {
+        return _pintchecker->GetCollisionOptions();
+    }
+
+    virtual void SetTolerance(dReal tolerance) {
+        _pintchecker->SetTolerance(tolerance);
+    }
+
+    virtual void SetGeometryGroup(const std::string& groupname)
+    {
+        _pintchecker->SetGeometryGroup(groupname);
+    }
+
+    virtual const std::string& GetGeometryGroup() {
+        return _pintchecker->GetGeometryGroup();
+    }
+
+    virtual bool InitEnvironment() {
+        _bStaticDirty = true;
+        return _pintchecker->InitEnvironment();
+    }
+
+    virtual void DestroyEnvironment()
+    {
+        _vstaticbodies.resize(0);
+        _vstaticstamps.resize(0);
+        _vstatictransforms.resize(0);
+        _setmovednames.clear();
+        _sdf.reset();
+        _bStaticDirty = true;
+        if( !!_pintchecker ) {
+            _pintchecker->DestroyEnvironment();
+        }
+    }
+
+    virtual void Clone(InterfaceBaseConstPtr preference, int cloningoptions)
+    {
+        CollisionCheckerBase::Clone(preference, cloningoptions);
+        boost::shared_ptr<SDFCollisionChecker const> clone = boost::dynamic_pointer_cast<SDFCollisionChecker const> (preference);
+
+        DestroyEnvironment();
+
+        if(!!clone->_pintchecker) {
+            CollisionCheckerBasePtr p = RaveCreateCollisionChecker(GetEnv(),clone->_pintchecker->GetXMLId());
+            p->Clone(clone->_pintchecker,cloningoptions);
+
+            _pintchecker = p;
+            _pintchecker->InitEnvironment();
+        }
+        else{
+            _pintchecker.reset();
+        }
+        _setstaticnames = clone->_setstaticnames;
+        _setmovednames = clone->_setmovednames;
+        _fCellSize = clone->_fCellSize;
+        _fPadding = clone->_fPadding;
+        _nMaxCells = clone->_nMaxCells;
+        _bExactCheck = clone->_bExactCheck;
+    }
+
+    virtual bool InitKinBody(KinBodyPtr pbody) {
+        _bStaticDirty = true;
+        return _pintchecker->InitKinBody(pbody);
+    }
+
+    virtual void RemoveKinBody(KinBodyPtr pbody) {
+        _bStaticDirty = true;
+        _pintchecker->RemoveKinBody(pbody);
+    }
+
+    virtual bool CheckCollision(KinBodyConstPtr pbody1, CollisionReportPtr report = CollisionReportPtr())
+    {
+        if( !_UpdateField() || _IsStatic(pbody1) ) {
+            ++_nfallbacks;
+            return _pintchecker->CheckCollision(pbody1, report);
+        }
+        std::set<KinBodyPtr> setattached;
+        pbody1->GetAttached(setattached);
+        _vquerylinks.resize(0);
+        FOREACHC(itbody, setattached) {
+            if( _IsStatic(*itbody) ) {
+                ++_nfallbacks;
+                return _pintchecker->CheckCollision(pbody1, report);
+            }
+            if( (*itbody)->IsEnabled() ) {
+                _vquerylinks.insert(_vquerylinks.end(), (*itbody)->GetLinks().begin(), (*itbody)->GetLinks().end());
+            }
+        }
+
+        if( !_HasSphereTrees(_vquerylinks) ) {
+            ++_nfallbacks;
+            return _pintchecker->CheckCollision(pbody1, report);
+        }
+
+        dReal fclearance = 0;
+        KinBody::LinkConstPtr pclosestlink;
+        if( _CheckStaticLinks(_vquerylinks, _IsComputingDistance(report), fclearance, pclosestlink) ) {
+            if( _bExactCheck ) {
+                ++_nfallbacks;
+                return _pintchecker->CheckCollision(pbody1, report);
+            }
+            return _SetStaticCollision(pclosestlink, report);
+        }
+
+        // the static bodies are free, check the rest of the environment. the internal checker already goes through the attached bodies
+        ClosestResult closest(fclearance, pclosestlink, _IsComputingDistance(report));
+        if( _pintchecker->CheckCollision(pbody1, _vstaticbodies, std::vector<KinBody::LinkConstPtr>(), report) ) {
+            return true;
+        }
+        closest.Merge(report);
+        closest.Set(report);
+        return false;
+    }
+
+    virtual bool CheckCollision(KinBodyConstPtr pbody1, KinBodyConstPtr pbody2, CollisionReportPtr report = CollisionReportPtr()) {
+        return _pintchecker->CheckCollision(pbody1, pbody2, report);
+    }
+
+    virtual bool CheckCollision(KinBody::LinkConstPtr plink, CollisionReportPtr report = CollisionReportPtr())
+    {
+        if( !_UpdateField() || _IsStatic(plink->GetParent()) ) {
+            ++_nfallbacks;
+            return _pintchecker->CheckCollision(plink, report);
+        }
+        _vquerylinks.resize(1);
+        _vquerylinks[0] = boost::const_pointer_cast<KinBody::Link>(plink);
+        if( !_HasSphereTrees(_vquerylinks) ) {
+            ++_nfallbacks;
+            return _pintchecker->CheckCollision(plink, report);
+        }
+        dReal fclearance = 0;
+        KinBody::LinkConstPtr pclosestlink;
+        if( _CheckStaticLinks(_vquerylinks, _IsComputingDistance(report), fclearance, pclosestlink) ) {
+            if( _bExactCheck ) {
+                ++_nfallbacks;
+                return _pintchecker->CheckCollision(plink, report);
+            }
+            return _SetStaticCollision(pclosestlink, report);
+        }
+        ClosestResult closest(fclearance, pclosestlink, _IsComputingDistance(report));
+        if( _pintchecker->CheckCollision(plink, _vstaticbodies, std::vector<KinBody::LinkConstPtr>(), report) ) {
+            return true;
+        }
+        closest.Merge(report);
+        closest.Set(report);
+        return false;
+    }
+
+    virtual bool CheckCollision(KinBody::LinkConstPtr plink1, KinBody::LinkConstPtr plink2, CollisionReportPtr report = CollisionReportPtr()) {
+        return _pintchecker->CheckCollision(plink1, plink2, report);
+    }
+
+    virtual bool CheckCollision(KinBody::LinkConstPtr plink, KinBodyConstPtr pbody, CollisionReportPtr report = CollisionReportPtr()) {
+        return _pintchecker->CheckCollision(plink, pbody, report);
+    }
+
+    virtual bool CheckCollision(KinBody::LinkConstPtr plink, const std::vector<KinBodyConstPtr>& vbodyexcluded, const std::vector<KinBody::LinkConstPtr>& vlinkexcluded, CollisionReportPtr report = CollisionReportPtr())
+    {
+        if( !_UpdateField() || _IsStatic(plink->GetParent()) || _ExcludesStatic(vbodyexcluded, vlinkexcluded) ) {
+            ++_nfallbacks;
+            return _pintchecker->CheckCollision(plink, vbodyexcluded, vlinkexcluded, report);
+        }
+        _vquerylinks.resize(1);
+        _vquerylinks[0] = boost::const_pointer_cast<KinBody::Link>(plink);
+        if( !_HasSphereTrees(_vquerylinks) ) {
+            ++_nfallbacks;
+            return _pintchecker->CheckCollision(plink, vbodyexcluded, vlinkexcluded, report);
+        }
+        dReal fclearance = 0;
+        KinBody::LinkConstPtr pclosestlink;
+        if( _CheckStaticLinks(_vquerylinks, _IsComputingDistance(report), fclearance, pclosestlink) ) {
+            if( _bExactCheck ) {
+                ++_nfallbacks;
+                return _pintchecker->CheckCollision(plink, vbodyexcluded, vlinkexcluded, report);
+            }
+            return _SetStaticCollision(pclosestlink, report);
+        }
+        _vbodyexcluded = vbodyexcluded;
+        _vbodyexcluded.insert(_vbodyexcluded.end(), _vstaticbodies.begin(), _vstaticbodies.end());
+        ClosestResult closest(fclearance, pclosestlink, _IsComputingDistance(report));
+        if( _pintchecker->CheckCollision(plink, _vbodyexcluded, vlinkexcluded, report) ) {
+            return true;
+        }
+        closest.Merge(report);
+        closest.Set(report);
+        return false;
+    }
+
+    virtual bool CheckCollision(KinBodyConstPtr pbody, const std::vector<KinBodyConstPtr>& vbodyexcluded, const std::vector<KinBody::LinkConstPtr>& vlinkexcluded, CollisionReportPtr report = CollisionReportPtr())
+    {
+        if( !_UpdateField() || _IsStatic(pbody) || _ExcludesStatic(vbodyexcluded, vlinkexcluded) ) {
+            ++_nfallbacks;
+            return _pintchecker->CheckCollision(pbody, vbodyexcluded, vlinkexcluded, report);
+        }
+        // the wrapped checker also checks the grabbed and attached bodies, so they have to go through the field too
+        std::set<KinBodyPtr> setattached;
+        pbody->GetAttached(setattached);
+        _vquerylinks.resize(0);
+        FOREACHC(itbody, setattached) {
+            if( _IsStatic(*itbody) ) {
+                ++_nfallbacks;
+                return _pintchecker->CheckCollision(pbody, vbodyexcluded, vlinkexcluded, report);
+            }
+            if( !(*itbody)->IsEnabled() || find(vbodyexcluded.begin(), vbodyexcluded.end(), *itbody) != vbodyexcluded.end() ) {
+                continue;
+            }
+            FOREACHC(itlink, (*itbody)->GetLinks()) {
+                if( (*itlink)->IsEnabled() && find(vlinkexcluded.begin(), vlinkexcluded.end(), *itlink) == vlinkexcluded.end() ) {
+                    _vquerylinks.push_back(*itlink);
+                }
+            }
+        }
+        if( !_HasSphereTrees(_vquerylinks) ) {
+            ++_nfallbacks;
+            return _pintchecker->CheckCollision(pbody, vbodyexcluded, vlinkexcluded, report);
+        }
+        dReal fclearance = 0;
+        KinBody::LinkConstPtr pclosestlink;
+        if( _CheckStaticLinks(_vquerylinks, _IsComputingDistance(report), fclearance, pclosestlink) ) {
+            if( _bExactCheck ) {
+                ++_nfallbacks;
+                return _pintchecker->CheckCollision(pbody, vbodyexcluded, vlinkexcluded, report);
+            }
+            return _SetStaticCollision(pclosestlink, report);
+        }
+        _vbodyexcluded = vbodyexcluded;
+        _vbodyexcluded.insert(_vbodyexcluded.end(), _vstaticbodies.begin(), _vstaticbodies.end());
+        ClosestResult closest(fclearance, pclosestlink, _IsComputingDistance(report));
+        if( _pintchecker->CheckCollision(pbody, _vbodyexcluded, vlinkexcluded, report) ) {
+            return true;
+        }
+        closest.Merge(report);
+        closest.Set(report);
+        return false;
+    }
+
+    virtual bool CheckCollision(const RAY& ray, KinBody::LinkConstPtr plink, CollisionReportPtr report = CollisionReportPtr()) {
+        return _pintchecker->CheckCollision(ray, plink, report);
+    }
+
+    virtual bool CheckCollision(const RAY& ray, KinBodyConstPtr pbody, CollisionReportPtr report = CollisionReportPtr()) {
+        return _pintchecker->CheckCollision(ray, pbody, report);
+    }
+
+    virtual bool CheckCollision(const RAY& ray, CollisionReportPtr report = CollisionReportPtr()) {
+        return _pintchecker->CheckCollision(ray, report);
+    }
+
+    virtual bool CheckStandaloneSelfCollision(KinBodyConstPtr pbody, CollisionReportPtr report = CollisionReportPtr()) {
+        return _pintchecker->CheckStandaloneSelfCollision(pbody, report);
+    }
+
+    virtual bool CheckStandaloneSelfCollision(KinBody::LinkConstPtr plink, CollisionReportPtr report = CollisionReportPtr()) {
+        return _pintchecker->CheckStandaloneSelfCollision(plink, report);
+    }
+
+    virtual int CheckContinuousCollision(KinBodyPtr pbody, const std::vector<dReal>& vdofvalues0, const std::vector<dReal>& vdofvalues1, dReal ftolerance, dReal& fcollisiontime, CollisionReportPtr report = CollisionReportPtr()) {
+        return _pintchecker->CheckContinuousCollision(pbody, vdofvalues0, vdofvalues1, ftolerance, fcollisiontime, report);
+    }
+
+protected:
+    /// \brief keeps the closest result of several distance queries when CO_Distance is set
+    class ClosestResult
+    {
+public:
+        ClosestResult(dReal fdist, KinBody::LinkConstPtr plink, bool bdistance) : _fdist(fdist), _plink1(plink), _bdistance(bdistance) {
+        }
+        /// \brief updates with the distance stored in report
+        void Merge(CollisionReportPtr report) {
+            if( _bdistance && !!report && report->minDistance < _fdist ) {
+                _fdist = report->minDistance;
+                _plink1 = report->plink1;
+                _plink2 = report->plink2;
+            }
+        }
+        void Set(CollisionReportPtr report) {
+            if( _bdistance && !!report ) {
+                report->minDistance = _fdist;
+                report->plink1 = _plink1;
+                report->plink2 = _plink2;
+            }
+        }
+        dReal _fdist;
+        KinBody::LinkConstPtr _plink1, _plink2;
+        bool _bdistance;
+    };
+
+    virtual bool _SetStaticBodiesCommand(std::ostream& sout, std::istream& sinput)
+    {
+        _setstaticnames.clear();
+        std::string name;
+        while(sinput >> name) {
+            _setstaticnames.insert(name);
+        }
+        _bStaticDirty = true;
+        return true;
+    }
+
+    virtual bool _SetCellSizeCommand(std::ostream& sout, std::istream& sinput)
+    {
+        dReal fcellsize = 0;
+        sinput >> fcellsize;
+        if( !sinput || fcellsize <= 0 ) {
+            return false;
+        }
+        _fCellSize = fcellsize;
+        _bStaticDirty = true;
+        return true;
+    }
+
+    virtual bool _SetExactCheckCommand(std::ostream& sout, std::istream& sinput)
+    {
+        int bexact = 1;
+        sinput >> bexact;
+        _bExactCheck = bexact != 0;
+        return !!sinput;
+    }
+
+    virtual bool _GetStatisticsCommand(std::ostream& sout, std::istream& sinput)
+    {
+        sout << _nfieldchecks << " " << _nfieldfree << " " << _nfallbacks << " " << _nrebuilds;
+        _nfieldchecks = _nfieldfree = _nfallbacks = _nrebuilds = 0;
+        return true;
+    }
+
+    virtual bool _ResetFieldCommand(std::ostream& sout, std::istream& sinput)
+    {
+        _sdf.reset();
+        _setmovednames.clear();
+        _bStaticDirty = true;
+        return true;
+    }
+
+    /// \brief makes sure the field corresponds to the current static bodies
+    ///
+    /// \return false if the queries cannot use the field
+    bool _UpdateField()
+    {
+        if( GetCollisionOptions() & CO_ActiveDOFs ) {
+            // the internal checker knows which links are active
+            return false;
+        }
+        if( !_bStaticDirty ) {
+            for(size_t i = 0; i < _vstaticbodies.size(); ++i) {
+                if( _vstaticbodies[i]->GetUpdateStamp() != _vstaticstamps[i] ) {
+                    _bStaticDirty = true;
+                    // only the bodies set with SetStaticBodies stay static when they move
+                    if( _setstaticnames.size() == 0 && TransformDistance2(_vstaticbodies[i]->GetTransform(), _vstatictransforms[i]) > g_fEpsilonLinear ) {
+                        RAVELOG_DEBUG_FORMAT("body %s moved, removing it from the distance field", _vstaticbodies[i]->GetName());
+                        _setmovednames.insert(_vstaticbodies[i]->GetName());
+                    }
+                }
+            }
+            if( !_bStaticDirty ) {
+                return !!_sdf;
+            }
+        }
+        _bStaticDirty = false;
+
+        std::vector<KinBodyPtr> vbodies;
+        GetEnv()->GetBodies(vbodies);
+        _vstaticbodies.resize(0);
+        _vstaticstamps.resize(0);
+        _vstatictransforms.resize(0);
+        std::set<KinBodyPtr> setattached;
+        FOREACHC(itbody, vbodies) {
+            bool bstatic;
+            if( _setstaticnames.size() > 0 ) {
+                bstatic = _setstaticnames.find((*itbody)->GetName()) != _setstaticnames.end();
+            }
+            else {
+                setattached.clear();
+                (*itbody)->GetAttached(setattached);
+                bstatic = !(*itbody)->IsRobot() && (*itbody)->GetDOF() == 0 && setattached.size() == 1 && _setmovednames.find((*itbody)->GetName()) == _setmovednames.end();
+            }
+            if( bstatic ) {
+                _vstaticbodies.push_back(*itbody);
+                _vstaticstamps.push_back((*itbody)->GetUpdateStamp());
+                _vstatictransforms.push_back((*itbody)->GetTransform());
+            }
+        }
+
+        std::stringstream ss;
+        ss << std::setprecision(std::numeric_limits<dReal>::digits10+1);
+        ss << _fCellSize << " " << _fPadding << " " << _nMaxCells << " ";
+        FOREACHC(itbody, _vstaticbodies) {
+            ss << (*itbody)->GetKinematicsGeometryHash() << " " << (*itbody)->IsEnabled() << " " << (*itbody)->GetTransform() << " ";
+        }
+        std::string fieldhash = utils::GetMD5HashString(ss.str());
+        if( !!_sdf && fieldhash == _fieldhash ) {
+            return true;
+        }
+
+        _sdf.reset(new SignedDistanceField());
+        _fieldhash = fieldhash;
+        std::string filename = RaveFindDatabaseFile(std::string("sdf.")+fieldhash, false);
+        if( filename.size() > 0 && _sdf->Load(filename) ) {
+            RAVELOG_DEBUG_FORMAT("loaded distance field of %d static bodies from %s", _vstaticbodies.size()%filename);
+#ifdef SDF_HAS_MMAP
+            // mark the field as recently used for _RemoveOldFields
+            utime(filename.c_str(), NULL);
+#endif
+            return true;
+        }
+
+        uint64_t starttime = utils::GetMicroTime();
+        TriMesh trimesh;
+        FOREACHC(itbody, _vstaticbodies) {
+            if( (*itbody)->IsEnabled() ) {
+                GetEnv()->Triangulate(trimesh, *itbody);
+            }
+        }
+        _sdf->Build(trimesh, _fCellSize, _fPadding, _nMaxCells);
+        ++_nrebuilds;
+        RAVELOG_DEBUG_FORMAT("built distance field of %d static bodies (%d triangles) in %fs", _vstaticbodies.size()%(trimesh.indices.size()/3)%((utils::GetMicroTime()-starttime)*1e-6));
+        if( _sdf->IsValid() && filename.size() > 0 ) {
+            if( _sdf->Save(filename) ) {
+                _RemoveOldFields(filename);
+            }
+            else {
+                RAVELOG_WARN_FORMAT("failed to save distance field to %s", filename);
+            }
+        }
+        return true;
+    }
+
+    /// \brief removes the least recently used saved fields beside filename so that the database directory holds at most s_nMaxSavedFields of them
+    void _RemoveOldFields(const std::string& filename)
+    {
+#ifdef SDF_HAS_MMAP
+        size_t pos = filename.find_last_of('/');
+        if( pos == std::string::npos ) {
+            return;
+        }
+        std::string dirname = filename.substr(0, pos);
+        DIR* pdir = opendir(dirname.c_str());
+        if( !pdir ) {
+            return;
+        }
+        std::vector< std::pair<time_t, std::string> > vfields;
+        struct dirent* pentry;
+        while( (pentry = readdir(pdir)) != NULL ) {
+            if( strncmp(pentry->d_name, "sdf.", 4) != 0 ) {
+                continue;
+            }
+            std::string fieldfilename = dirname + "/" + pentry->d_name;
+            struct stat filestat;
+            if( stat(fieldfilename.c_str(), &filestat) == 0 && S_ISREG(filestat.st_mode) ) {
+                vfields.push_back(std::make_pair(filestat.st_mtime, fieldfilename));
+            }
+        }
+        closedir(pdir);
+        if( vfields.size() <= s_nMaxSavedFields ) {
+            return;
+        }
+        std::sort(vfields.begin(), vfields.end());
+        for(size_t i = 0; i+s_nMaxSavedFields < vfields.size(); ++i) {
+            if( vfields[i].second != filename ) {
+                RAVELOG_VERBOSE_FORMAT("removing old distance field %s", vfields[i].second);
+                unlink(vfields[i].second.c_str());
+            }
+        }
+#endif
+    }
+
+    bool _IsStatic(KinBodyConstPtr pbody) const
+    {
+        FOREACHC(itbody, _vstaticbodies) {
+            if( *itbody == pbody ) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    /// \brief true if the query has to report the minimum distance, which requires the clearance of every link
+    bool _IsComputingDistance(CollisionReportPtr report) const
+    {
+        return !!report && !!(GetCollisionOptions() & CO_Distance);
+    }
+
+    /// \brief true if the exclusions remove any part of the static bodies, which the field cannot do
+    bool _ExcludesStatic(const std::vector<KinBodyConstPtr>& vbodyexcluded, const std::vector<KinBody::LinkConstPtr>& vlinkexcluded) const
+    {
+        FOREACHC(itbody, vbodyexcluded) {
+            if( _IsStatic(*itbody) ) {
+                return true;
+            }
+        }
+        FOREACHC(itlink, vlinkexcluded) {
+            if( _IsStatic((*itlink)->GetParent()) ) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    /// \brief true if every enabled link with geometry has a sphere tree, otherwise the query has to go to the wrapped checker
+    bool _HasSphereTrees(const std::vector<KinBody::LinkPtr>& vlinks) const
+    {
+        FOREACHC(itlink, vlinks) {
+            if( (*itlink)->IsEnabled() && (*itlink)->GetGeometries().size() > 0 && !(*itlink)->GetSphereTree() ) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    /// \brief checks the sphere sets of the links against the field
+    ///
+    /// \param bcomputeclearance if true, computes the minimum clearance of all the links instead of stopping at the first potential collision
+    /// \param[out] fclearance lower bound of the distance between the links and the static bodies
+    /// \param[out] pclosestlink the link achieving fclearance
+    /// \return true if a link might be colliding with the static bodies
+    bool _CheckStaticLinks(const std::vector<KinBody::LinkPtr>& vlinks, bool bcomputeclearance, dReal& fclearance, KinBody::LinkConstPtr& pclosestlink)
+    {
+        ++_nfieldchecks;
+        fclearance = std::numeric_limits<dReal>::max();
+        pclosestlink.reset();
+        if( !_sdf->IsValid() ) {
+            // no static geometry
+            ++_nfieldfree;
+            return false;
+        }
+        dReal ferror = _sdf->GetErrorBound();
+        bool bcollision = false;
+        FOREACHC(itlink, vlinks) {
+            if( !(*itlink)->IsEnabled() ) {
+                continue;
+            }
+            KinBody::Link::SphereTreeConstPtr spheretree = (*itlink)->GetSphereTree();
+            if( !spheretree ) {
+                // no geometry, the links with geometry and no tree were sent to the wrapped checker by _HasSphereTrees
+                continue;
+            }
+            Transform t = (*itlink)->GetTransform();
+            // descend only into the spheres that can collide or improve the clearance
+            _vnodestack.resize(0);
+            _vnodestack.push_back(0);
+            while(_vnodestack.size() > 0) {
+                int inode = _vnodestack.back();
+                _vnodestack.pop_back();
+                const Vector& vsphere = spheretree->spheres[inode];
+                dReal fdist = _sdf->GetDistance(t*vsphere) - ferror - vsphere.w;
+                if( bcomputeclearance ? fdist >= fclearance : fdist > 0 ) {
+                    continue;
+                }
+                const std::pair<int, int>& children = spheretree->children[inode];
+                if( children.first >= 0 ) {
+                    _vnodestack.push_back(children.first);
+                    _vnodestack.push_back(children.second);
+                    continue;
+                }
+                if( fdist < fclearance ) {
+                    fclearance = fdist;
+                    pclosestlink = *itlink;
+                }
+                if( fdist <= 0 ) {
+                    bcollision = true;
+                    if( !bcomputeclearance ) {
+                        return true;
+                    }
+                }
+            }
+        }
+        if( !bcollision ) {
+            ++_nfieldfree;
+        }
+        return bcollision;
+    }
+
+    bool _SetStaticCollision(KinBody::LinkConstPtr plink, CollisionReportPtr report)
+    {
+        if( !!report ) {
+            report->Reset(GetCollisionOptions());
+            report->plink1 = plink;
+            report->minDistance = 0;
+        }
+        return true;
+    }
+
+    static const size_t s_nMaxSavedFields = 8; ///< maximum number of sdf.* files kept in the database directory
+
+    CollisionCheckerBasePtr _pintchecker;
+    SignedDistanceFieldPtr _sdf;
+    std::string _fieldhash; ///< hash of the static bodies and parameters _sdf was built from
+    std::set<std::string> _setstaticnames; ///< if not empty, the names of the static bodies
+    std::vector<KinBodyConstPtr> _vstaticbodies; ///< bodies in _sdf
+    std::vector<int> _vstaticstamps; ///< KinBody::GetUpdateStamp of _vstaticbodies when _sdf was updated
+    std::vector<Transform> _vstatictransforms; ///< transforms of _vstaticbodies when _sdf was updated
+    std::set<std::string> _setmovednames; ///< bodies that moved after being static, they are checked with _pintchecker
+    dReal _fCellSize, _fPadding;
+    int _nMaxCells;
+    bool _bExactCheck; ///< if true, potential collisions with the static bodies are checked with _pintchecker
+    bool _bStaticDirty; ///< if true, the static bodies have to be recomputed
+
+    int _nfieldchecks, _nfieldfree, _nfallbacks, _nrebuilds;
+
+    // cache
+    std::vector<KinBody::LinkPtr> _vquerylinks;
+    std::vector<KinBodyConstPtr> _vbodyexcluded;
+    std::vector<int> _vnodestack;
+};
+
+CollisionCheckerBasePtr CreateSDFCollisionChecker(EnvironmentBasePtr penv, std::istream& sinput)
+{
+    return CollisionCheckerBasePtr(new SDFCollisionChecker(penv, sinput));
+}
+
+};
@@ -17,6 +17,7 @@
 
 #include <boost/thread/condition.hpp>
 #include <boost/thread/mutex.hpp>
+#include <deque>
 
 #ifdef QHULL_FOUND
 
@@ -63,12 +64,17 @@ class GrasperModule : public ModuleBase
     };
 
 public:
-    GrasperModule(EnvironmentBasePtr penv, std::istream& sinput)  : ModuleBase(penv), errfile(NULL) {
+    GrasperModule(EnvironmentBasePtr penv, std::istream& sinput)  : ModuleBase(penv), _bShutdownWorkers(false), errfile(NULL) {
         __description = ":Interface Author: Rosen Diankov\n\nUsed to simulate a hand grasping an object by closing its fingers until collision with all links. ";
         RegisterCommand("Grasp",boost::bind(&GrasperModule::_GraspCommand,this,_1,_2),
                         "Performs a grasp and returns contact points");
         RegisterCommand("GraspThreaded",boost::bind(&GrasperModule::_GraspThreadedCommand,this,_1,_2),
-                        "Parllelizes the computation of the grasp planning and force closure. Number of threads can be specified with 'numthreads'.");
+                        "Parllelizes the computation of the grasp planning and force closure. Number of threads can be specified with 'numthreads'.\n"
+                        "The workers and their cloned environments are kept alive across calls. 'maxgrasps N' stops after N successful grasps, 'maxforceclosuregrasps N' after N grasps passing force closure. "
+                        "With 'nonblocking 1' the command returns right away and the results are streamed with GetGraspThreadedResults.");
+        RegisterCommand("GetGraspThreadedResults",boost::bind(&GrasperModule::_GetGraspThreadedResultsCommand,this,_1,_2),
+                        "Returns the grasps found by the last GraspThreaded call since the previous query. With 'wait 1' blocks until at least one grasp is found or the call finishes.\n"
+                        "Output is: done nextid numgrasps grasps...");
         RegisterCommand("ComputeDistanceMap",boost::bind(&GrasperModule::_ComputeDistanceMapCommand,this,_1,_2),
                         "Computes a distance map around a particular point in space");
         RegisterCommand("GetStableContacts",boost::bind(&GrasperModule::_GetStableContactsCommand,this,_1,_2),
@@ -77,12 +83,14 @@ public:
                         "Given a point cloud, returns information about its convex hull like normal planes, vertex indices, and triangle indices. Computed planes point outside the mesh, face indices are not ordered, triangles point outside the mesh (counter-clockwise)");
     }
     virtual ~GrasperModule() {
+        _StopWorkers();
         if( !!errfile )
             fclose(errfile);
     }
 
     virtual void Destroy()
     {
+        _StopWorkers();
         _planner.reset();
         _robot.reset();
     }
@@ -627,6 +635,7 @@ public:
             forceclosurethreshold = 0;
             ffinestep = 0.001f;
             bCheckGraspIK = false;
+            coloptions = 0;
         }
 
         string targetname;
@@ -642,16 +651,21 @@ public:
         dReal ftranslationstepmult;
         dReal ffinestep;
 
+        string robotname;
         string manipname;
         vector<int> vactiveindices;
         int affinedofs;
         Vector affineaxis;
+        vector<dReal> vjointmaxlengths; ///< copy of _vjointmaxlengths, SetRobot can change it while the workers run
 
         bool bCheckGraspIK;
+        int coloptions; ///< collision options of the main environment without CO_Contacts
     };
 
     struct GraspParametersThread
     {
+        GraspParametersThread() : id(0), ftargetroll(0), fstandoff(0), mindist(0), volume(0) {
+        }
         size_t id;
         Vector vtargetdirection;
         Vector vtargetposition;
@@ -670,20 +684,137 @@ public:
     typedef boost::shared_ptr<GraspParametersThread> GraspParametersThreadPtr;
     typedef boost::shared_ptr<WorkerParameters> WorkerParametersPtr;
 
-    virtual bool _GraspThreadedCommand(std::ostream& sout, std::istream& sinput)
+    /// \brief all the grasps of one GraspThreaded call, shared by the worker pool
+    struct GraspJob
     {
-        EnvironmentMutex::scoped_lock lock(GetEnv()->GetMutex());
+        GraspJob() : startindex(0), numgrasps(0), maxgrasps(0), maxforceclosuregrasps(0), nextid(0), numresults(0), numforceclosureresults(0), numattached(0), bStop(false), bCancel(false) {
+        }
 
-        WorkerParametersPtr worker_params(new WorkerParameters());
-        int numthreads = 2;
-        string cmd;
+        /// \brief true if the worker can still claim a grasp. _mutexGrasp has to be locked
+        ///
+        /// Once the job is stopped, only the ids below nextid that are still in the queues can be claimed.
+        bool HasWork(size_t iworker) const
+        {
+            if( bCancel || iworker >= vworkqueues.size() ) {
+                return false;
+            }
+            FOREACHC(itqueue,vworkqueues) {
+                if( itqueue->size() > 0 && (!bStop || itqueue->front() < nextid) ) {
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        /// \brief true if no worker is running the job and none can start it anymore. _mutexGrasp has to be locked
+        bool IsDone() const
+        {
+            return numattached == 0 && !HasWork(0);
+        }
+
+        /// \brief the grasp id to resume from, the smallest id that was not claimed. _mutexGrasp has to be locked
+        ///
+        /// A stopped job evaluates all the ids below the largest claimed one before it is done, so calling GraspThreaded
+        /// with startindex set to the id of a done job neither skips nor repeats any grasp.
+        size_t GetNextId() const
+        {
+            size_t id = bStop ? nextid : numgrasps;
+            FOREACHC(itqueue,vworkqueues) {
+                if( itqueue->size() > 0 ) {
+                    id = min(id,itqueue->front());
+                }
+            }
+            return id;
+        }
+
+        /// \brief pops the next grasp of the worker's queue, stealing the smallest id of the longest queue when its own is empty. _mutexGrasp has to be locked
+        ///
+        /// Only one id is stolen at a time so that the claimed ids stay close to the smallest unclaimed one.
+        GraspParametersThreadPtr ClaimWork(size_t iworker)
+        {
+            if( !HasWork(iworker) ) {
+                return GraspParametersThreadPtr();
+            }
+            size_t iqueue = iworker;
+            if( vworkqueues[iqueue].size() == 0 || (bStop && vworkqueues[iqueue].front() >= nextid) ) {
+                for(size_t i = 0; i < vworkqueues.size(); ++i) {
+                    if( vworkqueues[i].size() == 0 ) {
+                        continue;
+                    }
+                    if( bStop ) {
+                        if( vworkqueues[i].front() < nextid ) {
+                            iqueue = i;
+                            break;
+                        }
+                    }
+                    else if( vworkqueues[i].size() > vworkqueues[iqueue].size() ) {
+                        iqueue = i;
+                    }
+                }
+            }
+            deque<size_t>& workqueue = vworkqueues[iqueue];
+            size_t id = workqueue.front();
+            workqueue.pop_front();
+            nextid = max(nextid,id+1);
+
+            size_t istandoff = id % standoffs.size();
+            size_t ipreshape = (id / standoffs.size()) % preshapes.size();
+            size_t iroll = (id / (preshapes.size() * standoffs.size())) % rolls.size();
+            size_t iapproachray = (id / (rolls.size() * preshapes.size() * standoffs.size()))%approachrays.size();
+            size_t imanipulatordirection = (id / (rolls.size() * preshapes.size() * standoffs.size()*approachrays.size()));
+
+            GraspParametersThreadPtr grasp_params(new GraspParametersThread());
+            grasp_params->id = id;
+            grasp_params->vtargetposition = approachrays.at(iapproachray).first;
+            grasp_params->vtargetdirection = approachrays.at(iapproachray).second;
+            grasp_params->vmanipulatordirection = manipulatordirections.at(imanipulatordirection);
+            grasp_params->ftargetroll = rolls.at(iroll);
+            grasp_params->fstandoff = standoffs.at(istandoff);
+            grasp_params->preshape = preshapes.at(ipreshape);
+            return grasp_params;
+        }
+
+        WorkerParametersPtr worker_params;
         vector< pair<Vector, Vector> > approachrays;
         vector<dReal> rolls;
         vector< vector<dReal> > preshapes;
         vector<Vector> manipulatordirections;
         vector<dReal> standoffs;
-        size_t startindex = 0;
-        size_t maxgrasps = 0;
+        size_t startindex, numgrasps, maxgrasps;
+        size_t maxforceclosuregrasps; ///< if > 0, the job stops after this many grasps with positive force closure distance
+
+        // protected by _mutexGrasp
+        vector< deque<size_t> > vworkqueues; ///< grasp ids left for every worker in ascending order
+        size_t nextid; ///< one past the largest claimed grasp id
+        size_t numresults; ///< number of successful grasps so far
+        size_t numforceclosureresults; ///< number of successful grasps in force closure so far
+        int numattached; ///< number of workers currently running the job
+        bool bStop; ///< set when the job should end before all grasps are evaluated
+        bool bCancel; ///< set when the results of the job are not needed anymore, so no grasp is claimed
+    };
+    typedef boost::shared_ptr<GraspJob> GraspJobPtr;
+
+    static bool _CompareGraspId(GraspParametersThreadPtr g0, GraspParametersThreadPtr g1)
+    {
+        return g0->id < g1->id;
+    }
+
+    virtual bool _GraspThreadedCommand(std::ostream& sout, std::istream& sinput)
+    {
+        EnvironmentMutex::scoped_lock lock(GetEnv()->GetMutex());
+
+        GraspJobPtr job(new GraspJob());
+        WorkerParametersPtr worker_params(new WorkerParameters());
+        job->worker_params = worker_params;
+        int numthreads = 2;
+        bool bNonBlocking = false;
+        string cmd;
+        vector< pair<Vector, Vector> >& approachrays = job->approachrays;
+        vector<dReal>& rolls = job->rolls;
+        vector< vector<dReal> >& preshapes = job->preshapes;
+        vector<Vector>& manipulatordirections = job->manipulatordirections;
+        vector<dReal>& standoffs = job->standoffs;
+        size_t& startindex = job->startindex;
 
         while(!sinput.eof()) {
             sinput >> cmd;
@@ -704,7 +835,14 @@ public:
                 sinput >> startindex;
             }
             else if( cmd == "maxgrasps" ) {
-                sinput >> maxgrasps;
+                sinput >> job->maxgrasps;
+            }
+            else if( cmd == "maxforceclosuregrasps" ) {
+                sinput >> job->maxforceclosuregrasps;
+                worker_params->bComputeForceClosure = true;
+            }
+            else if( cmd == "nonblocking" ) {
+                sinput >> bNonBlocking;
             }
             else if( cmd == "onlycontacttarget" ) {
                 sinput >> worker_params->bonlycontacttarget;
@@ -792,64 +930,119 @@ public:
             }
         }
 
+        worker_params->robotname = _robot->GetName();
+        worker_params->vjointmaxlengths = _vjointmaxlengths;
         worker_params->manipname = _robot->GetActiveManipulator()->GetName();
         worker_params->vactiveindices = _robot->GetActiveDOFIndices();
         worker_params->affinedofs = _robot->GetAffineDOF();
         worker_params->affineaxis = _robot->GetAffineRotationAxis();
+        // use CO_ActiveDOFs since might be calling FindIKSolution
+        worker_params->coloptions = GetEnv()->GetCollisionChecker()->GetCollisionOptions()|(worker_params->bCheckGraspIK ? CO_ActiveDOFs : 0);
+        worker_params->coloptions &= ~CO_Contacts;
+        numthreads = max(1,numthreads);
 
-        EnvironmentBasePtr pcloneenv = GetEnv()->CloneSelf(Clone_Bodies|Clone_Simulation);
+        {
+            // a new call cancels any unfinished non-blocking one
+            boost::mutex::scoped_lock lockgrasp(_mutexGrasp);
+            if( !!_graspjob ) {
+                _graspjob->bCancel = true;
+                while(!_graspjob->IsDone()) {
+                    _condGraspProgress.wait(lockgrasp);
+                }
+                _graspjob.reset();
+            }
+            _listGraspResults.clear();
+        }
+        _InitWorkers(numthreads);
 
-        _bContinueWorker = true;
-        // start worker threads
-        vector<boost::shared_ptr<boost::thread> > listthreads(numthreads);
-        FOREACH(itthread,listthreads) {
-            itthread->reset(new boost::thread(boost::bind(&GrasperModule::_WorkerThread,this,worker_params,pcloneenv)));
+        job->numgrasps = approachrays.size()*rolls.size()*preshapes.size()*standoffs.size()*manipulatordirections.size();
+        if( job->maxgrasps == 0 ) {
+            job->maxgrasps = job->numgrasps;
+        }
+        RAVELOG_INFO(str(boost::format("number of grasps to test: %d\n")%job->numgrasps));
+        job->nextid = startindex;
+        // deal the grasps round-robin so that all workers progress through the ids at the same rate
+        job->vworkqueues.resize(numthreads);
+        for(size_t id = startindex; id < job->numgrasps; ++id) {
+            job->vworkqueues[(id-startindex)%numthreads].push_back(id);
         }
 
-        _listGraspResults.clear();
-        size_t numgrasps = approachrays.size()*rolls.size()*preshapes.size()*standoffs.size()*manipulatordirections.size();
-        if( maxgrasps == 0 ) {
-            maxgrasps = numgrasps;
+        {
+            boost::mutex::scoped_lock lockgrasp(_mutexGrasp);
+            _graspjob = job;
+        }
+        _condGraspHasWork.notify_all();
+        if( bNonBlocking ) {
+            return true;
         }
-        RAVELOG_INFO(str(boost::format("number of grasps to test: %d\n")%numgrasps));
-        size_t id = startindex;
-        for(id=startindex; id < numgrasps; ++id) {
-            size_t istandoff = id % standoffs.size();
-            size_t ipreshape = (id / standoffs.size()) % preshapes.size();
-            size_t iroll = (id / (preshapes.size() * standoffs.size())) % rolls.size();
-            size_t iapproachray = (id / (rolls.size() * preshapes.size() * standoffs.size()))%approachrays.size();
-            size_t imanipulatordirection = (id / (rolls.size() * preshapes.size() * standoffs.size()*approachrays.size()));
 
-            boost::mutex::scoped_lock lock(_mutexGrasp);
-            if( _listGraspResults.size() >= maxgrasps ) {
+        size_t nextid;
+        list<GraspParametersThreadPtr> listresults;
+        {
+            boost::mutex::scoped_lock lockgrasp(_mutexGrasp);
+            while(!job->IsDone()) {
+                _condGraspProgress.wait(lockgrasp);
+            }
+            nextid = job->GetNextId();
+            listresults.swap(_listGraspResults);
+        }
+        listresults.sort(_CompareGraspId);
+        sout << nextid << " ";
+        _WriteGraspResults(sout,listresults);
+        return true;
+    }
+
+    virtual bool _GetGraspThreadedResultsCommand(std::ostream& sout, std::istream& sinput)
+    {
+        bool bWait = false;
+        string cmd;
+        while(!sinput.eof()) {
+            sinput >> cmd;
+            if( !sinput ) {
                 break;
             }
+            std::transform(cmd.begin(), cmd.end(), cmd.begin(), ::tolower);
 
-            // initialize _graspParamsWork
-            BOOST_ASSERT(!_graspParamsWork);
-            _graspParamsWork.reset(new GraspParametersThread());
-            _graspParamsWork->id = id;
-            _graspParamsWork->vtargetposition = approachrays.at(iapproachray).first;
-            _graspParamsWork->vtargetdirection = approachrays.at(iapproachray).second;
-            _graspParamsWork->vmanipulatordirection = manipulatordirections.at(imanipulatordirection);
-            _graspParamsWork->ftargetroll = rolls.at(iroll);
-            _graspParamsWork->fstandoff = standoffs.at(istandoff);
-            _graspParamsWork->preshape = preshapes.at(ipreshape);
-            _condGraspHasWork.notify_one();     // notify there is work
-            _condGraspReceivedWork.wait(lock);     // wait for more work
-        }
-
-        // wait for workers
-        _bContinueWorker = false;
-        FOREACH(itthread,listthreads) {
-            _condGraspHasWork.notify_all();     // signal
-            (*itthread)->join();
+            if( cmd == "wait" ) {
+                sinput >> bWait;
+            }
+            else {
+                RAVELOG_WARN(str(boost::format("unrecognized command: %s\n")%cmd));
+                break;
+            }
+
+            if( !sinput ) {
+                RAVELOG_ERROR(str(boost::format("failed processing command %s\n")%cmd));
+                return false;
+            }
         }
-        listthreads.clear();
 
-        // parse results to output
-        sout << id << " " << _listGraspResults.size() << " ";
-        FOREACH(itresult, _listGraspResults) {
+        bool bDone;
+        size_t nextid;
+        list<GraspParametersThreadPtr> listresults;
+        {
+            boost::mutex::scoped_lock lockgrasp(_mutexGrasp);
+            if( !_graspjob ) {
+                return false;
+            }
+            if( bWait ) {
+                while(_listGraspResults.size() == 0 && !_graspjob->IsDone()) {
+                    _condGraspProgress.wait(lockgrasp);
+                }
+            }
+            bDone = _graspjob->IsDone();
+            nextid = _graspjob->GetNextId();
+            listresults.swap(_listGraspResults);
+        }
+        sout << bDone << " " << nextid << " ";
+        _WriteGraspResults(sout,listresults);
+        return true;
+    }
+
+    void _WriteGraspResults(std::ostream& sout, const list<GraspParametersThreadPtr>& listresults)
+    {
+        sout << listresults.size() << " ";
+        FOREACHC(itresult, listresults) {
             sout << (*itresult)->vtargetposition.x << " " << (*itresult)->vtargetposition.y << " " << (*itresult)->vtargetposition.z << " ";
             sout << (*itresult)->vtargetdirection.x << " " << (*itresult)->vtargetdirection.y << " " << (*itresult)->vtargetdirection.z << " ";
             sout << (*itresult)->ftargetroll << " " << (*itresult)->fstandoff << " ";
@@ -868,274 +1061,341 @@ public:
                 sout << c.pos.x << " " << c.pos.y << " " << c.pos.z << " " << c.norm.x << " " << c.norm.y << " " << c.norm.z << " ";
             }
         }
-        return true;
     }
 
-    void _WorkerThread(const WorkerParametersPtr worker_params, EnvironmentBasePtr penv)
+    /// \brief makes sure the pool has at least numthreads workers and that their environments mirror the current environment
+    ///
+    /// The worker environments are kept across calls and only synchronized here, which avoids cloning all bodies again. Has to be called when no job is running.
+    void _InitWorkers(int numthreads)
+    {
+        FOREACH(itenv,_vworkerenvs) {
+            (*itenv)->Clone(GetEnv(),Clone_Bodies|Clone_Simulation);
+        }
+        while((int)_vworkerenvs.size() < numthreads) {
+            EnvironmentBasePtr pcloneenv = GetEnv()->CloneSelf(Clone_Bodies|Clone_Simulation);
+            _vworkerenvs.push_back(pcloneenv);
+            _vworkerthreads.push_back(boost::shared_ptr<boost::thread>(new boost::thread(boost::bind(&GrasperModule::_WorkerThread,this,_vworkerenvs.size()-1,pcloneenv))));
+        }
+    }
+
+    void _StopWorkers()
     {
-        // clone environment
-        EnvironmentBasePtr pcloneenv = penv->CloneSelf(Clone_Bodies|Clone_Simulation);
         {
-            EnvironmentMutex::scoped_lock lock(pcloneenv->GetMutex());
-            boost::shared_ptr<CollisionCheckerMngr> pcheckermngr(new CollisionCheckerMngr(pcloneenv, worker_params->collisionchecker));
-            PlannerBasePtr planner = RaveCreatePlanner(pcloneenv,"Grasper");
-            RobotBasePtr probot = pcloneenv->GetRobot(_robot->GetName());
-            string strsavetraj;
-
-            probot->SetActiveManipulator(worker_params->manipname);
-
-            // setup parameters
-            GraspParametersPtr params(new GraspParameters(pcloneenv));
-            params->targetbody = pcloneenv->GetKinBody(worker_params->targetname);
-            params->vavoidlinkgeometry = worker_params->vavoidlinkgeometry;
-            params->btransformrobot = true;
-            params->bonlycontacttarget = worker_params->bonlycontacttarget;
-            params->btightgrasp = worker_params->btightgrasp;
-            params->fgraspingnoise = 0;
-            params->ftranslationstepmult = worker_params->ftranslationstepmult;
+            boost::mutex::scoped_lock lock(_mutexGrasp);
+            _bShutdownWorkers = true;
+            if( !!_graspjob ) {
+                _graspjob->bCancel = true;
+            }
+        }
+        _condGraspHasWork.notify_all();
+        FOREACH(itthread,_vworkerthreads) {
+            (*itthread)->join();
+        }
+        _vworkerthreads.clear();
+        FOREACH(itenv,_vworkerenvs) {
+            (*itenv)->Destroy();
+        }
+        _vworkerenvs.clear();
+        boost::mutex::scoped_lock lock(_mutexGrasp);
+        _bShutdownWorkers = false;
+        _graspjob.reset();
+        _listGraspResults.clear();
+    }
 
-            CollisionReportPtr report(new CollisionReport());
-            TrajectoryBasePtr ptraj = RaveCreateTrajectory(pcloneenv,"");
-            GraspParametersThreadPtr grasp_params;
+    void _WorkerThread(size_t iworker, EnvironmentBasePtr pcloneenv)
+    {
+        while(1) {
+            GraspJobPtr job;
+            {
+                boost::mutex::scoped_lock lock(_mutexGrasp);
+                while(!_bShutdownWorkers && (!_graspjob || !_graspjob->HasWork(iworker))) {
+                    _condGraspHasWork.wait(lock);
+                }
+                if( _bShutdownWorkers ) {
+                    break;
+                }
+                job = _graspjob;
+                job->numattached++;
+            }
+            try {
+                _RunGraspJob(job,iworker,pcloneenv);
+            }
+            catch(const std::exception& ex) {
+                RAVELOG_WARN(str(boost::format("grasp worker %d failed: %s\n")%iworker%ex.what()));
+            }
+            {
+                boost::mutex::scoped_lock lock(_mutexGrasp);
+                job->numattached--;
+            }
+            _condGraspProgress.notify_all();
+        }
+    }
 
-            // calculate the contact normals
-            std::vector<KinBody::LinkPtr> vlinks, vindependentlinks;
-            probot->GetActiveManipulator()->GetChildLinks(vlinks);
-            probot->GetActiveManipulator()->GetIndependentLinks(vindependentlinks);
-            Transform trobotstart = probot->GetTransform();
+    /// \brief evaluates grasps of the job in the worker's environment until there is no more work to claim
+    void _RunGraspJob(GraspJobPtr job, size_t iworker, EnvironmentBasePtr pcloneenv)
+    {
+        const WorkerParametersPtr worker_params = job->worker_params;
+        EnvironmentMutex::scoped_lock lock(pcloneenv->GetMutex());
+        boost::shared_ptr<CollisionCheckerMngr> pcheckermngr(new CollisionCheckerMngr(pcloneenv, worker_params->collisionchecker));
+        PlannerBasePtr planner = RaveCreatePlanner(pcloneenv,"Grasper");
+        // the main environment is not locked while the workers run, so only use the robot of the clone
+        RobotBasePtr probot = pcloneenv->GetRobot(worker_params->robotname);
+
+        probot->SetActiveManipulator(worker_params->manipname);
+
+        // setup parameters
+        GraspParametersPtr params(new GraspParameters(pcloneenv));
+        params->targetbody = pcloneenv->GetKinBody(worker_params->targetname);
+        params->vavoidlinkgeometry = worker_params->vavoidlinkgeometry;
+        params->btransformrobot = true;
+        params->bonlycontacttarget = worker_params->bonlycontacttarget;
+        params->btightgrasp = worker_params->btightgrasp;
+        params->fgraspingnoise = 0;
+        params->ftranslationstepmult = worker_params->ftranslationstepmult;
+
+        CollisionReportPtr report(new CollisionReport());
+        TrajectoryBasePtr ptraj = RaveCreateTrajectory(pcloneenv,"");
+        GraspParametersThreadPtr grasp_params;
+
+        // calculate the contact normals
+        std::vector<KinBody::LinkPtr> vlinks, vindependentlinks;
+        probot->GetActiveManipulator()->GetChildLinks(vlinks);
+        probot->GetActiveManipulator()->GetIndependentLinks(vindependentlinks);
+        Transform trobotstart = probot->GetTransform();
+
+        vector<dReal> vtrajpoint;
+
+        int coloptions = worker_params->coloptions;
+        pcloneenv->GetCollisionChecker()->SetCollisionOptions(coloptions|CO_Contacts);
+
+        while(1) {
+            {
+                boost::mutex::scoped_lock lockgrasp(_mutexGrasp);
+                grasp_params = job->ClaimWork(iworker);
+            }
+            if( !grasp_params ) {
+                break;
+            }
+
+            RAVELOG_DEBUG(str(boost::format("grasp %d: start")%grasp_params->id));
+
+            // fill params
+            params->vtargetdirection = grasp_params->vtargetdirection;
+            params->ftargetroll = grasp_params->ftargetroll;
+            params->vtargetposition = grasp_params->vtargetposition;
+            params->vmanipulatordirection = grasp_params->vmanipulatordirection;
+            params->fstandoff = grasp_params->fstandoff;
+            probot->SetActiveDOFs(worker_params->vactiveindices);
+            probot->SetActiveDOFValues(grasp_params->preshape);
+            probot->SetActiveDOFs(worker_params->vactiveindices,worker_params->affinedofs,worker_params->affineaxis);
+            params->SetRobotActiveJoints(probot);
+
+            RobotBase::RobotStateSaver saver(probot);
+            probot->Enable(true);
 
+            params->fgraspingnoise = 0;
+            ptraj->Init(probot->GetActiveConfigurationSpecification());
+
+            // InitPlan/PlanPath
+            if( !planner->InitPlan(probot, params) ) {
+                RAVELOG_DEBUG(str(boost::format("grasp %d: grasper planner failed")%grasp_params->id));
+                continue;
+            }
+            if( !planner->PlanPath(ptraj) ) {
+                RAVELOG_DEBUG(str(boost::format("grasp %d: grasper planner failed")%grasp_params->id));
+                continue;
+            }
+
+            BOOST_ASSERT(ptraj->GetNumWaypoints() > 0);
             vector<dReal> vtrajpoint;
+            ptraj->GetWaypoint(-1,vtrajpoint,probot->GetConfigurationSpecification());
+            probot->SetConfigurationValues(vtrajpoint.begin(),true);
+            grasp_params->transfinal = probot->GetTransform();
+            probot->GetDOFValues(grasp_params->finalshape);
 
-            // use CO_ActiveDOFs since might be calling FindIKSolution
-            int coloptions = GetEnv()->GetCollisionChecker()->GetCollisionOptions()|(worker_params->bCheckGraspIK ? CO_ActiveDOFs : 0);
-            coloptions &= ~CO_Contacts;
-            pcloneenv->GetCollisionChecker()->SetCollisionOptions(coloptions|CO_Contacts);
-
-            while(_bContinueWorker) {
-                {
-                    // wait for work
-                    boost::mutex::scoped_lock lock(_mutexGrasp);
-                    if( !_graspParamsWork ) {
-                        _condGraspHasWork.wait(lock);
-                        // after signal
-                        if( !_graspParamsWork ) {
-                            continue;
+            FOREACHC(itlink, vlinks) {
+                if( pcloneenv->CheckCollision(KinBody::LinkConstPtr(*itlink), KinBodyConstPtr(params->targetbody), report) ) {
+                    RAVELOG_VERBOSE(str(boost::format("contact %s\n")%report->__str__()));
+                    FOREACH(itcontact,report->contacts) {
+                        if( report->plink1 != *itlink ) {
+                            itcontact->norm = -itcontact->norm;
+                            itcontact->depth = -itcontact->depth;
                         }
+                        grasp_params->contacts.push_back(make_pair(*itcontact,(*itlink)->GetIndex()));
                     }
-                    grasp_params = _graspParamsWork;
-                    _graspParamsWork.reset();
-                    _condGraspReceivedWork.notify_all();
                 }
+            }
 
-                RAVELOG_DEBUG(str(boost::format("grasp %d: start")%grasp_params->id));
-
-                // fill params
-                params->vtargetdirection = grasp_params->vtargetdirection;
-                params->ftargetroll = grasp_params->ftargetroll;
-                params->vtargetposition = grasp_params->vtargetposition;
-                params->vmanipulatordirection = grasp_params->vmanipulatordirection;
-                params->fstandoff = grasp_params->fstandoff;
+            if ( worker_params->bCheckGraspIK ) {
+                CollisionOptionsStateSaver optionstate(pcloneenv->GetCollisionChecker(),coloptions,false); // remove contacts
+                Transform Tgoalgrasp = probot->GetActiveManipulator()->GetEndEffectorTransform();
+                RobotBase::RobotStateSaver linksaver(probot);
+                probot->SetTransform(trobotstart);
+                FOREACH(itlink,vlinks) {
+                    (*itlink)->Enable(false);
+                }
                 probot->SetActiveDOFs(worker_params->vactiveindices);
                 probot->SetActiveDOFValues(grasp_params->preshape);
-                probot->SetActiveDOFs(worker_params->vactiveindices,worker_params->affinedofs,worker_params->affineaxis);
-                params->SetRobotActiveJoints(probot);
-
-                RobotBase::RobotStateSaver saver(probot);
-                probot->Enable(true);
-
-                params->fgraspingnoise = 0;
-                ptraj->Init(probot->GetActiveConfigurationSpecification());
-
-                // InitPlan/PlanPath
-                if( !planner->InitPlan(probot, params) ) {
-                    RAVELOG_DEBUG(str(boost::format("grasp %d: grasper planner failed")%grasp_params->id));
-                    continue;
+                probot->SetActiveDOFs(probot->GetActiveManipulator()->GetArmIndices());
+                vector<dReal> solution;
+                if( !probot->GetActiveManipulator()->FindIKSolution(Tgoalgrasp, solution,IKFO_CheckEnvCollisions) ) {
+                    RAVELOG_DEBUG(str(boost::format("grasp %d: ik failed")%grasp_params->id));
+                    continue;     // ik failed
                 }
-                if( !planner->PlanPath(ptraj) ) {
-                    RAVELOG_DEBUG(str(boost::format("grasp %d: grasper planner failed")%grasp_params->id));
-                    continue;
+
+                grasp_params->transfinal = trobotstart;
+                size_t index = 0;
+                FOREACHC(itarmindex,probot->GetActiveManipulator()->GetArmIndices()) {
+                    grasp_params->finalshape.at(*itarmindex) = solution.at(index++);
                 }
+            }
 
-                BOOST_ASSERT(ptraj->GetNumWaypoints() > 0);
-                vector<dReal> vtrajpoint;
-                ptraj->GetWaypoint(-1,vtrajpoint,probot->GetConfigurationSpecification());
-                probot->SetConfigurationValues(vtrajpoint.begin(),true);
-                grasp_params->transfinal = probot->GetTransform();
-                probot->GetDOFValues(grasp_params->finalshape);
-
-                FOREACHC(itlink, vlinks) {
-                    if( pcloneenv->CheckCollision(KinBody::LinkConstPtr(*itlink), KinBodyConstPtr(params->targetbody), report) ) {
-                        RAVELOG_VERBOSE(str(boost::format("contact %s\n")%report->__str__()));
-                        FOREACH(itcontact,report->contacts) {
-                            if( report->plink1 != *itlink ) {
-                                itcontact->norm = -itcontact->norm;
-                                itcontact->depth = -itcontact->depth;
-                            }
-                            grasp_params->contacts.push_back(make_pair(*itcontact,(*itlink)->GetIndex()));
-                        }
+            GRASPANALYSIS analysis;
+            if( worker_params->bComputeForceClosure ) {
+                try {
+                    vector<CollisionReport::CONTACT> c(grasp_params->contacts.size());
+                    for(size_t i = 0; i < c.size(); ++i) {
+                        c[i] = grasp_params->contacts[i].first;
                     }
+                    analysis = _AnalyzeContacts3D(c,worker_params->friction,8);
+                    if( analysis.mindist < worker_params->forceclosurethreshold ) {
+                        RAVELOG_DEBUG(str(boost::format("grasp %d: force closure failed")%grasp_params->id));
+                        continue;
+                    }
+                    grasp_params->mindist = analysis.mindist;
+                    grasp_params->volume = analysis.volume;
+                }
+                catch(const std::exception& ex) {
+                    RAVELOG_DEBUG(str(boost::format("grasp %d: force closure failed: %s")%grasp_params->id%ex.what()));
+                    continue;     // failed
                 }
+            }
 
-                if ( worker_params->bCheckGraspIK ) {
-                    CollisionOptionsStateSaver optionstate(pcloneenv->GetCollisionChecker(),coloptions,false); // remove contacts
-                    Transform Tgoalgrasp = probot->GetActiveManipulator()->GetEndEffectorTransform();
-                    RobotBase::RobotStateSaver linksaver(probot);
-                    probot->SetTransform(trobotstart);
-                    FOREACH(itlink,vlinks) {
-                        (*itlink)->Enable(false);
-                    }
+            if( worker_params->fgraspingnoise > 0 && worker_params->nGraspingNoiseRetries > 0 ) {
+                params->fgraspingnoise = worker_params->fgraspingnoise;
+                vector<Transform> vfinaltransformations; vfinaltransformations.reserve(worker_params->nGraspingNoiseRetries);
+                vector< vector<dReal> > vfinalvalues; vfinalvalues.reserve(worker_params->nGraspingNoiseRetries);
+                for(int igrasp = 0; igrasp < worker_params->nGraspingNoiseRetries; ++igrasp) {
                     probot->SetActiveDOFs(worker_params->vactiveindices);
                     probot->SetActiveDOFValues(grasp_params->preshape);
-                    probot->SetActiveDOFs(probot->GetActiveManipulator()->GetArmIndices());
-                    vector<dReal> solution;
-                    if( !probot->GetActiveManipulator()->FindIKSolution(Tgoalgrasp, solution,IKFO_CheckEnvCollisions) ) {
-                        RAVELOG_DEBUG(str(boost::format("grasp %d: ik failed")%grasp_params->id));
-                        continue;     // ik failed
+                    probot->SetActiveDOFs(worker_params->vactiveindices,worker_params->affinedofs,worker_params->affineaxis);
+                    params->vinitialconfig.resize(0);
+                    ptraj->Init(probot->GetActiveConfigurationSpecification());
+                    if( !planner->InitPlan(probot, params) ) {
+                        RAVELOG_VERBOSE(str(boost::format("grasp %d: grasping noise planner failed")%grasp_params->id));
+                        break;
                     }
-
-                    grasp_params->transfinal = trobotstart;
-                    size_t index = 0;
-                    FOREACHC(itarmindex,probot->GetActiveManipulator()->GetArmIndices()) {
-                        grasp_params->finalshape.at(*itarmindex) = solution.at(index++);
+                    if( !planner->PlanPath(ptraj) ) {
+                        RAVELOG_VERBOSE(str(boost::format("grasp %d: grasping noise planner failed")%grasp_params->id));
+                        break;
                     }
-                }
-
-                GRASPANALYSIS analysis;
-                if( worker_params->bComputeForceClosure ) {
-                    try {
-                        vector<CollisionReport::CONTACT> c(grasp_params->contacts.size());
-                        for(size_t i = 0; i < c.size(); ++i) {
-                            c[i] = grasp_params->contacts[i].first;
+                    BOOST_ASSERT(ptraj->GetNumWaypoints() > 0);
+
+                    if ( worker_params->bCheckGraspIK ) {
+                        CollisionOptionsStateSaver optionstate(pcloneenv->GetCollisionChecker(),coloptions,false); // remove contacts
+                        RobotBase::RobotStateSaver linksaver(probot);
+                        ptraj->GetWaypoint(-1,vtrajpoint);
+                        Transform t = probot->GetTransform();
+                        ptraj->GetConfigurationSpecification().ExtractTransform(t,vtrajpoint.begin(),probot);
+                        probot->SetTransform(t);
+                        Transform Tgoalgrasp = probot->GetActiveManipulator()->GetEndEffectorTransform();
+                        probot->SetTransform(trobotstart);
+                        FOREACH(itlink,vlinks) {
+                            (*itlink)->Enable(false);
                         }
-                        analysis = _AnalyzeContacts3D(c,worker_params->friction,8);
-                        if( analysis.mindist < worker_params->forceclosurethreshold ) {
-                            RAVELOG_DEBUG(str(boost::format("grasp %d: force closure failed")%grasp_params->id));
-                            continue;
-                        }
-                        grasp_params->mindist = analysis.mindist;
-                        grasp_params->volume = analysis.volume;
-                    }
-                    catch(const std::exception& ex) {
-                        RAVELOG_DEBUG(str(boost::format("grasp %d: force closure failed: %s")%grasp_params->id%ex.what()));
-                        continue;     // failed
-                    }
-                }
-
-                if( worker_params->fgraspingnoise > 0 && worker_params->nGraspingNoiseRetries > 0 ) {
-                    params->fgraspingnoise = worker_params->fgraspingnoise;
-                    vector<Transform> vfinaltransformations; vfinaltransformations.reserve(worker_params->nGraspingNoiseRetries);
-                    vector< vector<dReal> > vfinalvalues; vfinalvalues.reserve(worker_params->nGraspingNoiseRetries);
-                    for(int igrasp = 0; igrasp < worker_params->nGraspingNoiseRetries; ++igrasp) {
                         probot->SetActiveDOFs(worker_params->vactiveindices);
                         probot->SetActiveDOFValues(grasp_params->preshape);
-                        probot->SetActiveDOFs(worker_params->vactiveindices,worker_params->affinedofs,worker_params->affineaxis);
-                        params->vinitialconfig.resize(0);
-                        ptraj->Init(probot->GetActiveConfigurationSpecification());
-                        if( !planner->InitPlan(probot, params) ) {
-                            RAVELOG_VERBOSE(str(boost::format("grasp %d: grasping noise planner failed")%grasp_params->id));
-                            break;
-                        }
-                        if( !planner->PlanPath(ptraj) ) {
-                            RAVELOG_VERBOSE(str(boost::format("grasp %d: grasping noise planner failed")%grasp_params->id));
+                        probot->SetActiveDOFs(probot->GetActiveManipulator()->GetArmIndices());
+                        vector<dReal> solution;
+                        if( !probot->GetActiveManipulator()->FindIKSolution(Tgoalgrasp, solution,IKFO_CheckEnvCollisions) ) {
+                            RAVELOG_VERBOSE(str(boost::format("grasp %d: grasping noise ik failed")%grasp_params->id));
                             break;
                         }
-                        BOOST_ASSERT(ptraj->GetNumWaypoints() > 0);
-
-                        if ( worker_params->bCheckGraspIK ) {
-                            CollisionOptionsStateSaver optionstate(pcloneenv->GetCollisionChecker(),coloptions,false); // remove contacts
-                            RobotBase::RobotStateSaver linksaver(probot);
-                            ptraj->GetWaypoint(-1,vtrajpoint);
-                            Transform t = probot->GetTransform();
-                            ptraj->GetConfigurationSpecification().ExtractTransform(t,vtrajpoint.begin(),probot);
-                            probot->SetTransform(t);
-                            Transform Tgoalgrasp = probot->GetActiveManipulator()->GetEndEffectorTransform();
-                            probot->SetTransform(trobotstart);
-                            FOREACH(itlink,vlinks) {
-                                (*itlink)->Enable(false);
-                            }
-                            probot->SetActiveDOFs(worker_params->vactiveindices);
-                            probot->SetActiveDOFValues(grasp_params->preshape);
-                            probot->SetActiveDOFs(probot->GetActiveManipulator()->GetArmIndices());
-                            vector<dReal> solution;
-                            if( !probot->GetActiveManipulator()->FindIKSolution(Tgoalgrasp, solution,IKFO_CheckEnvCollisions) ) {
-                                RAVELOG_VERBOSE(str(boost::format("grasp %d: grasping noise ik failed")%grasp_params->id));
-                                break;
-                            }
-                        }
-
-                        ptraj->GetWaypoint(-1,vtrajpoint,probot->GetConfigurationSpecification());
-                        probot->SetConfigurationValues(vtrajpoint.begin(),true);
-                        vfinalvalues.push_back(vector<dReal>());
-                        probot->GetDOFValues(vfinalvalues.back());
-                        vfinaltransformations.push_back(probot->GetActiveManipulator()->GetTransform());
                     }
 
-                    if( (int)vfinaltransformations.size() != worker_params->nGraspingNoiseRetries ) {
-                        RAVELOG_DEBUG(str(boost::format("grasp %d: grasping noise failed")%grasp_params->id));
-                        continue;
-                    }
+                    ptraj->GetWaypoint(-1,vtrajpoint,probot->GetConfigurationSpecification());
+                    probot->SetConfigurationValues(vtrajpoint.begin(),true);
+                    vfinalvalues.push_back(vector<dReal>());
+                    probot->GetDOFValues(vfinalvalues.back());
+                    vfinaltransformations.push_back(probot->GetActiveManipulator()->GetTransform());
+                }
 
-                    // take statistics
-                    Vector translationmean;
-                    FOREACHC(ittrans,vfinaltransformations) {
-                        translationmean += ittrans->trans;
-                    }
-                    translationmean *= (1.0/vfinaltransformations.size());
-                    Vector translationstd;
-                    FOREACHC(ittrans,vfinaltransformations) {
-                        Vector v = ittrans->trans - translationmean;
-                        translationstd += v*v;
+                if( (int)vfinaltransformations.size() != worker_params->nGraspingNoiseRetries ) {
+                    RAVELOG_DEBUG(str(boost::format("grasp %d: grasping noise failed")%grasp_params->id));
+                    continue;
+                }
+
+                // take statistics
+                Vector translationmean;
+                FOREACHC(ittrans,vfinaltransformations) {
+                    translationmean += ittrans->trans;
+                }
+                translationmean *= (1.0/vfinaltransformations.size());
+                Vector translationstd;
+                FOREACHC(ittrans,vfinaltransformations) {
+                    Vector v = ittrans->trans - translationmean;
+                    translationstd += v*v;
+                }
+                translationstd *= (1.0/vfinaltransformations.size());
+                dReal ftranslationdisplacement = (RaveSqrt(translationstd.x)+RaveSqrt(translationstd.y)+RaveSqrt(translationstd.z))/3;
+                vector<dReal> jointvaluesstd(vfinalvalues.at(0).size());
+                for(size_t i = 0; i < jointvaluesstd.size(); ++i) {
+                    dReal jointmean = 0;
+                    FOREACHC(it, vfinalvalues) {
+                        jointmean += it->at(i);
                     }
-                    translationstd *= (1.0/vfinaltransformations.size());
-                    dReal ftranslationdisplacement = (RaveSqrt(translationstd.x)+RaveSqrt(translationstd.y)+RaveSqrt(translationstd.z))/3;
-                    vector<dReal> jointvaluesstd(vfinalvalues.at(0).size());
-                    for(size_t i = 0; i < jointvaluesstd.size(); ++i) {
-                        dReal jointmean = 0;
-                        FOREACHC(it, vfinalvalues) {
-                            jointmean += it->at(i);
-                        }
-                        jointmean /= dReal(vfinalvalues.size());
-                        dReal jointstd = 0;
-                        FOREACHC(it, vfinalvalues) {
-                            jointstd += (it->at(i)-jointmean)*(it->at(i)-jointmean);
-                        }
-                        jointvaluesstd[i] = _vjointmaxlengths.at(i) * RaveSqrt(jointstd / dReal(vfinalvalues.size()));
+                    jointmean /= dReal(vfinalvalues.size());
+                    dReal jointstd = 0;
+                    FOREACHC(it, vfinalvalues) {
+                        jointstd += (it->at(i)-jointmean)*(it->at(i)-jointmean);
                     }
-                    dReal fmaxjointdisplacement = 0;
-                    FOREACHC(itlink, _robot->GetLinks()) {
-                        dReal f = 0;
-                        for(size_t ijoint = 0; ijoint < _robot->GetJoints().size(); ++ijoint) {
-                            if( _robot->DoesAffect(ijoint, (*itlink)->GetIndex()) ) {
-                                f += jointvaluesstd.at(ijoint);
-                            }
+                    jointvaluesstd[i] = worker_params->vjointmaxlengths.at(i) * RaveSqrt(jointstd / dReal(vfinalvalues.size()));
+                }
+                dReal fmaxjointdisplacement = 0;
+                FOREACHC(itlink, probot->GetLinks()) {
+                    dReal f = 0;
+                    for(size_t ijoint = 0; ijoint < probot->GetJoints().size(); ++ijoint) {
+                        if( probot->DoesAffect(ijoint, (*itlink)->GetIndex()) ) {
+                            f += jointvaluesstd.at(ijoint);
                         }
-                        fmaxjointdisplacement = max(fmaxjointdisplacement,f);
                     }
+                    fmaxjointdisplacement = max(fmaxjointdisplacement,f);
+                }
 
-                    dReal graspthresh = 0.005*RaveSqrt(0.49+400*worker_params->fgraspingnoise)-0.0035;
-                    if( graspthresh < worker_params->fgraspingnoise*0.1 ) {
-                        graspthresh = worker_params->fgraspingnoise*0.1;
-                    }
-                    if( ftranslationdisplacement+fmaxjointdisplacement > graspthresh ) {
-                        RAVELOG_DEBUG(str(boost::format("grasp %d: fragile grasp %f>%f\n")%grasp_params->id%(ftranslationdisplacement+fmaxjointdisplacement)%(0.7 * worker_params->fgraspingnoise)));
-                        continue;
-                    }
+                dReal graspthresh = 0.005*RaveSqrt(0.49+400*worker_params->fgraspingnoise)-0.0035;
+                if( graspthresh < worker_params->fgraspingnoise*0.1 ) {
+                    graspthresh = worker_params->fgraspingnoise*0.1;
                 }
+                if( ftranslationdisplacement+fmaxjointdisplacement > graspthresh ) {
+                    RAVELOG_DEBUG(str(boost::format("grasp %d: fragile grasp %f>%f\n")%grasp_params->id%(ftranslationdisplacement+fmaxjointdisplacement)%(0.7 * worker_params->fgraspingnoise)));
+                    continue;
+                }
+            }
 
-                RAVELOG_DEBUG(str(boost::format("grasp %d: success")%grasp_params->id));
+            RAVELOG_DEBUG(str(boost::format("grasp %d: success")%grasp_params->id));
 
-                boost::mutex::scoped_lock lock(_mutexGrasp);
-                _listGraspResults.push_back(grasp_params);
+            boost::mutex::scoped_lock lockgrasp(_mutexGrasp);
+            _listGraspResults.push_back(grasp_params);
+            if( ++job->numresults >= job->maxgrasps ) {
+                job->bStop = true;
             }
+            if( grasp_params->mindist > 0 ) {
+                if( ++job->numforceclosureresults >= job->maxforceclosuregrasps && job->maxforceclosuregrasps > 0 ) {
+                    job->bStop = true;
+                }
+            }
+            _condGraspProgress.notify_all();
         }
-        pcloneenv->Destroy();
     }
 
-    bool _bContinueWorker;
+    bool _bShutdownWorkers; ///< signals the worker pool to exit
     boost::mutex _mutexGrasp;
-    GraspParametersThreadPtr _graspParamsWork;
-    list<GraspParametersThreadPtr> _listGraspResults;
-    boost::condition _condGraspHasWork, _condGraspReceivedWork;
+    GraspJobPtr _graspjob; ///< the job of the last GraspThreaded call
+    list<GraspParametersThreadPtr> _listGraspResults; ///< successful grasps not yet returned to the caller
+    boost::condition _condGraspHasWork, _condGraspProgress;
+    vector<EnvironmentBasePtr> _vworkerenvs; ///< warm cloned environment of every worker
+    vector<boost::shared_ptr<boost::thread> > _vworkerthreads;
+
 
 protected:
     void _ComputeJointMaxLengths(vector<dReal>& vjointlengths)
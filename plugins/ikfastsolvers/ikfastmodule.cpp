@@ -330,6 +330,12 @@ public:
                         "return the set of time measurements made in nano-seconds");
         RegisterCommand("IKTest",boost::bind(&IkFastModule::IKtest,this,_1,_2),
                         "Tests for an IK solution if active manipulation has an IK solver attached");
+        RegisterCommand("ComputeReachability",boost::bind(&IkFastModule::ComputeReachability,this,_1,_2),
+                        "Computes the kinematic reachability of a manipulator over a grid of positions and rotations using several threads, each with its own cloned environment.\n"
+                        "Usage::\n\n  ComputeReachability robot name [manip name] [numthreads N] [filteroptions F] [usefreespace 0|1] points N index x y z ... rotations M qw qx qy qz ... filename file\n\n"
+                        "filename has to be the last parameter since the rest of the line is read as the filename.\n"
+                        "Writes int32 [numpoints, numrotations] followed by one record per point in completion order: int32 [pointindex, numvalid, numrotvalid, numstats] and numstats float64 [qw qx qy qz x y z numsolutions].\n"
+                        "return the number of poses, the elapsed time, and the poses per second");
         RegisterCommand("DebugIK",boost::bind(&IkFastModule::DebugIK,this,_1,_2),
                         "Function used for debugging and testing an IK solver. Input parameters are:\n\n\
 * string readfile - file containing joint values to read, starts with number of entries.\n\n\
@@ -679,6 +685,233 @@ public:
         return true;
     }
 
+    /// \brief shared state of the ComputeReachability worker threads
+    struct ReachabilityJob
+    {
+        ReachabilityJob() : filteroptions(IKFO_CheckEnvCollisions), busefreespace(false), nextpoint(0), numposes(0) {
+        }
+        string robotname, manipname;
+        int filteroptions;
+        bool busefreespace;
+        vector<int> vpointindices;
+        vector<Vector> vpoints; ///< absolute position of every grid point
+        vector<Vector> vquats; ///< rotations tested at every point
+        boost::mutex mutex; ///< protects nextpoint, numposes, errormessage and the output stream
+        size_t nextpoint;
+        uint64_t numposes;
+        ofstream fout;
+        string errormessage; ///< set by the first thread that fails, which also stops the others
+    };
+    typedef boost::shared_ptr<ReachabilityJob> ReachabilityJobPtr;
+
+    bool ComputeReachability(ostream& sout, istream& sinput)
+    {
+        ReachabilityJobPtr job(new ReachabilityJob());
+        string cmd, filename;
+        int numthreads = boost::thread::hardware_concurrency();
+        while(!sinput.eof()) {
+            sinput >> cmd;
+            if( !sinput ) {
+                break;
+            }
+            std::transform(cmd.begin(), cmd.end(), cmd.begin(), ::tolower);
+            if( cmd == "robot" ) {
+                sinput >> job->robotname;
+            }
+            else if( cmd == "manip" ) {
+                sinput >> job->manipname;
+            }
+            else if( cmd == "numthreads" ) {
+                sinput >> numthreads;
+            }
+            else if( cmd == "filteroptions" ) {
+                sinput >> job->filteroptions;
+            }
+            else if( cmd == "usefreespace" ) {
+                sinput >> job->busefreespace;
+            }
+            else if( cmd == "filename" ) {
+                // the rest of the line is the filename so that it can contain spaces
+                if( !getline(sinput, filename) ) {
+                    return false;
+                }
+                boost::trim(filename);
+            }
+            else if( cmd == "points" ) {
+                size_t num = 0;
+                sinput >> num;
+                job->vpointindices.resize(num);
+                job->vpoints.resize(num);
+                for(size_t i = 0; i < num; ++i) {
+                    sinput >> job->vpointindices[i] >> job->vpoints[i].x >> job->vpoints[i].y >> job->vpoints[i].z;
+                }
+            }
+            else if( cmd == "rotations" ) {
+                size_t num = 0;
+                sinput >> num;
+                job->vquats.resize(num);
+                for(size_t i = 0; i < num; ++i) {
+                    sinput >> job->vquats[i].x >> job->vquats[i].y >> job->vquats[i].z >> job->vquats[i].w;
+                }
+            }
+            else {
+                RAVELOG_WARN(str(boost::format("unrecognized command: %s\n")%cmd));
+                break;
+            }
+            if( !sinput ) {
+                RAVELOG_ERROR(str(boost::format("failed processing command %s\n")%cmd));
+                return false;
+            }
+        }
+
+        if( job->vquats.size() == 0 || filename.size() == 0 ) {
+            RAVELOG_WARN("ComputeReachability needs rotations and a filename\n");
+            return false;
+        }
+        numthreads = max(1,numthreads);
+
+        vector<EnvironmentBasePtr> vclonedenvs(numthreads);
+        {
+            EnvironmentMutex::scoped_lock lock(GetEnv()->GetMutex());
+            RobotBasePtr probot = GetEnv()->GetRobot(job->robotname);
+            if( !probot ) {
+                RAVELOG_WARN(str(boost::format("failed to find robot %s\n")%job->robotname));
+                return false;
+            }
+            RobotBase::ManipulatorPtr pmanip = job->manipname.size() > 0 ? probot->GetManipulator(job->manipname) : probot->GetActiveManipulator();
+            if( !pmanip || !pmanip->GetIkSolver() ) {
+                RAVELOG_WARN(str(boost::format("robot %s does not have a manipulator with an ik solver\n")%job->robotname));
+                return false;
+            }
+            job->manipname = pmanip->GetName();
+            IkSolverBasePtr piksolver = pmanip->GetIkSolver();
+            try {
+                // every thread gets its own environment, so ik and collision checking never contend for the main environment lock
+                FOREACH(itenv,vclonedenvs) {
+                    *itenv = GetEnv()->CloneSelf(Clone_Bodies);
+                    (*itenv)->StopSimulation();
+                    // the cloned manipulator would otherwise share the ik solver of the main environment
+                    RobotBase::ManipulatorPtr pclonedmanip = (*itenv)->GetRobot(job->robotname)->GetManipulator(job->manipname);
+                    IkSolverBasePtr pclonedsolver = RaveCreateIkSolver(*itenv, piksolver->GetXMLId());
+                    if( !pclonedsolver ) {
+                        throw OPENRAVE_EXCEPTION_FORMAT("failed to create ik solver %s for the cloned environment", piksolver->GetXMLId(), ORE_InvalidState);
+                    }
+                    pclonedsolver->Clone(piksolver, 0);
+                    if( !pclonedmanip->SetIkSolver(pclonedsolver) ) {
+                        throw OPENRAVE_EXCEPTION_FORMAT("failed to set the cloned ik solver %s on manipulator %s", piksolver->GetXMLId()%job->manipname, ORE_InvalidState);
+                    }
+                }
+            }
+            catch(const std::exception& ex) {
+                RAVELOG_WARN(str(boost::format("failed to clone the environment for ComputeReachability: %s\n")%ex.what()));
+                FOREACH(itenv,vclonedenvs) {
+                    if( !!*itenv ) {
+                        (*itenv)->Destroy();
+                    }
+                }
+                return false;
+            }
+        }
+
+        job->fout.open(filename.c_str(), ios::out|ios::binary);
+        if( !job->fout ) {
+            RAVELOG_WARN(str(boost::format("failed to open %s for writing\n")%filename));
+            return false;
+        }
+        int32_t header[2] = { (int32_t)job->vpoints.size(), (int32_t)job->vquats.size() };
+        job->fout.write((const char*)header, sizeof(header));
+
+        uint64_t starttime = utils::GetNanoPerformanceTime();
+        vector<boost::shared_ptr<boost::thread> > vthreads(numthreads);
+        for(int i = 0; i < numthreads; ++i) {
+            vthreads[i].reset(new boost::thread(boost::bind(&IkFastModule::_ReachabilityThread, job, vclonedenvs[i])));
+        }
+        FOREACH(itthread,vthreads) {
+            (*itthread)->join();
+        }
+        dReal elapsed = max(dReal(1e-9),dReal(1e-9*(utils::GetNanoPerformanceTime()-starttime)));
+        job->fout.close();
+        FOREACH(itenv,vclonedenvs) {
+            (*itenv)->Destroy();
+        }
+        if( job->errormessage.size() > 0 ) {
+            RAVELOG_WARN(str(boost::format("ComputeReachability failed, %s is incomplete: %s\n")%filename%job->errormessage));
+            return false;
+        }
+
+        dReal posespersecond = job->numposes/elapsed;
+        RAVELOG_INFO(str(boost::format("reachability of %d poses with %d threads took %fs (%f poses/s)\n")%job->numposes%numthreads%elapsed%posespersecond));
+        sout << job->numposes << " " << elapsed << " " << posespersecond;
+        return true;
+    }
+
+    /// \brief computes ik for all rotations of the points claimed from the job and appends one record per point to the output
+    ///
+    /// A record is int32 [pointindex, numvalid, numrotvalid, numstats] followed by numstats float64 [qw qx qy qz x y z numsolutions].
+    /// Errors are stored in the job and stop all the threads.
+    static void _ReachabilityThread(ReachabilityJobPtr job, EnvironmentBasePtr penv)
+    {
+        try {
+            _ComputeReachabilityPoints(job, penv);
+        }
+        catch(const std::exception& ex) {
+            boost::mutex::scoped_lock joblock(job->mutex);
+            if( job->errormessage.size() == 0 ) {
+                job->errormessage = ex.what();
+            }
+            job->nextpoint = job->vpoints.size();
+        }
+    }
+
+    static void _ComputeReachabilityPoints(ReachabilityJobPtr job, EnvironmentBasePtr penv)
+    {
+        EnvironmentMutex::scoped_lock lock(penv->GetMutex());
+        RobotBasePtr probot = penv->GetRobot(job->robotname);
+        RobotBase::ManipulatorPtr pmanip = probot->GetManipulator(job->manipname);
+        vector<dReal> vsolution;
+        vector< vector<dReal> > vsolutions;
+        vector<double> vstats;
+        while(1) {
+            size_t ipoint;
+            {
+                boost::mutex::scoped_lock joblock(job->mutex);
+                if( job->nextpoint >= job->vpoints.size() ) {
+                    break;
+                }
+                ipoint = job->nextpoint++;
+            }
+            vstats.resize(0);
+            int32_t record[4] = { job->vpointindices[ipoint], 0, 0, 0 };
+            Transform t;
+            t.trans = job->vpoints[ipoint];
+            FOREACHC(itquat,job->vquats) {
+                t.rot = *itquat;
+                int numsolutions = 0;
+                if( job->busefreespace ) {
+                    if( pmanip->FindIKSolutions(IkParameterization(t), vsolutions, job->filteroptions) ) {
+                        numsolutions = (int)vsolutions.size();
+                    }
+                }
+                else if( pmanip->FindIKSolution(IkParameterization(t), vsolution, job->filteroptions) ) {
+                    numsolutions = 1;
+                }
+                if( numsolutions > 0 ) {
+                    record[1] += numsolutions;
+                    record[2] += 1;
+                    double stat[8] = { t.rot.x, t.rot.y, t.rot.z, t.rot.w, t.trans.x, t.trans.y, t.trans.z, double(numsolutions) };
+                    vstats.insert(vstats.end(), stat, stat+8);
+                }
+            }
+            record[3] = (int32_t)(vstats.size()/8);
+            boost::mutex::scoped_lock joblock(job->mutex);
+            job->fout.write((const char*)record, sizeof(record));
+            if( vstats.size() > 0 ) {
+                job->fout.write((const char*)&vstats[0], vstats.size()*sizeof(vstats[0]));
+            }
+            job->numposes += job->vquats.size();
+        }
+    }
+
     bool IKtest(ostream& sout, istream& sinput)
     {
         EnvironmentMutex::scoped_lock lock(GetEnv()->GetMutex());
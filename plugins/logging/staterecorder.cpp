@@ -0,0 +1,693 @@
+// -*- coding: utf-8 -*-
+// Copyright (C) 2006-2013 Rosen Diankov <rosen.diankov@gmail.com>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+#include "plugindefs.h"
+
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/condition.hpp>
+#include <boost/thread/thread.hpp>
+#include <boost/lexical_cast.hpp>
+
+#ifdef OPENRAVE_HAS_ZLIB
+#include <zlib.h>
+#endif
+
+#include <cstring>
+
+/** \brief Records the state of all bodies into a binary log and plays it back.
+
+    Log format (native byte order):
+    - file header: the 8 bytes "ORSTATE1"
+    - chunks: uint32 compression, uint32 numframes, uint32 rawsize, uint32 datasize, uint64 firsttime, uint64 lasttime followed by datasize bytes of (optionally zlib compressed) frames.
+    - frame: uint64 simtime, uint32 numbodies, and for every body: string name, int32 environmentid, int32 updatestamp, uint8 hasdata. If hasdata is set: uint32 numlinks, numlinks*7 doubles of link transforms, uint32 dof, dof doubles of the last set dof values.
+    Then uint32 numgrabbed followed by string grabbedname, string robotlinkname, 7 doubles of trelative, uint32 numignored and numignored int32 link indices.
+    - strings are stored as uint32 size followed by the characters.
+
+    The first frame of every chunk stores the data of all bodies, later frames only store the data of bodies whose update stamp changed, so every chunk can be decoded independently.
+ */
+class StateRecorder : public ModuleBase
+{
+    /// \brief the recorded state of one body
+    struct BodyState
+    {
+        BodyState() : environmentid(0), updatestamp(0), bchanged(false) {
+        }
+        std::string name;
+        int environmentid;
+        int updatestamp;
+        bool bchanged; ///< if false, the link transforms and dof values were not captured since they are the same as in the previous snapshot
+        std::vector<Transform> vlinktransforms;
+        std::vector<dReal> vdofvalues;
+        std::vector<RobotBase::GrabbedInfoPtr> vgrabbedinfo;
+    };
+
+    /// \brief the state of all bodies at one time
+    struct Snapshot
+    {
+        Snapshot() : simtime(0), numbodies(0) {
+        }
+        uint64_t simtime;
+        size_t numbodies; ///< number of valid entries of vbodies, the rest are kept to reuse their memory
+        std::vector<BodyState> vbodies;
+    };
+    typedef boost::shared_ptr<Snapshot> SnapshotPtr;
+
+    /// \brief location of a chunk inside the log
+    struct ChunkInfo
+    {
+        ChunkInfo() : offset(0), compression(0), numframes(0), rawsize(0), datasize(0), firsttime(0), lasttime(0) {
+        }
+        uint64_t offset; ///< file offset of the chunk data
+        uint32_t compression, numframes, rawsize, datasize;
+        uint64_t firsttime, lasttime;
+    };
+
+    /// \brief reads the values of a decompressed chunk, throws if the data is truncated
+    class ChunkReader
+    {
+public:
+        ChunkReader(const std::vector<uint8_t>& vdata) : _vdata(vdata), _pos(0) {
+        }
+        template <typename T> T Read() {
+            T value;
+            _Read(&value, sizeof(T));
+            return value;
+        }
+        void ReadString(std::string& s) {
+            uint32_t size = Read<uint32_t>();
+            if( _pos+size > _vdata.size() ) {
+                throw OPENRAVE_EXCEPTION_FORMAT0("state log chunk is corrupted", ORE_InvalidState);
+            }
+            s.assign((const char*)&_vdata[_pos], size);
+            _pos += size;
+        }
+        void ReadTransform(Transform& t) {
+            double values[7];
+            _Read(values, sizeof(values));
+            t.rot = Vector(values[0], values[1], values[2], values[3]);
+            t.trans = Vector(values[4], values[5], values[6]);
+        }
+        bool IsDone() const {
+            return _pos >= _vdata.size();
+        }
+private:
+        void _Read(void* p, size_t size) {
+            if( _pos+size > _vdata.size() ) {
+                throw OPENRAVE_EXCEPTION_FORMAT0("state log chunk is corrupted", ORE_InvalidState);
+            }
+            memcpy(p, &_vdata[_pos], size);
+            _pos += size;
+        }
+        const std::vector<uint8_t>& _vdata;
+        size_t _pos;
+    };
+
+public:
+    StateRecorder(EnvironmentBasePtr penv, std::istream& sinput) : ModuleBase(penv)
+    {
+        __description = ":Interface Author: Rosen Diankov\n\nRecords the update stamps, link transforms, dof values and grabbed bodies of every body into a chunked and compressed binary log at a fixed simulation rate. Snapshots are captured inside SimulationStep, so the module has to be added to the environment, and are written by a background thread so the simulation never waits for the disk. The log can be played back into an environment by seeking to a time.";
+        RegisterCommand("Start",boost::bind(&StateRecorder::_StartCommand,this,_1,_2),
+                        "Starts recording to a file, overwrites any previous file. Format::\n\n  Start [rate hz] [chunkframes N] [compression level] filename [filename]\\n\n\nrate is the number of snapshots per second of simulation time (default 100), chunkframes the number of snapshots per chunk (default 200), compression the zlib level from 0 to 9 (default 1).");
+        RegisterCommand("Stop",boost::bind(&StateRecorder::_StopCommand,this,_1,_2),
+                        "Stops recording, writes the remaining snapshots and closes the file. Returns the number of snapshots that were skipped because the writer was busy.");
+        RegisterCommand("Record",boost::bind(&StateRecorder::_RecordCommand,this,_1,_2),
+                        "Captures a snapshot of the environment now regardless of the rate. Returns 0 if the previous snapshot is still being written.");
+        RegisterCommand("Open",boost::bind(&StateRecorder::_OpenCommand,this,_1,_2),
+                        "Opens a log for playback. Format::\n\n  Open [filename]\n\nReturns the number of frames, the first and the last simulation time in microseconds.");
+        RegisterCommand("Seek",boost::bind(&StateRecorder::_SeekCommand,this,_1,_2),
+                        "Sets the state of the environment bodies to the last recorded snapshot at or before the simulation time in microseconds. Format::\n\n  Seek [time]\n\nReturns the time of the snapshot.");
+        _bContinueThread = true;
+        _bRecording = false;
+        _bPendingSnapshot = false;
+        _bFlushChunk = false;
+        _fRate = 100;
+        _fElapsedTime = 0;
+        _nChunkFrames = 200;
+        _nCompressionLevel = 1;
+        _nChunkFrameCount = 0;
+        _chunkfirsttime = _chunklasttime = 0;
+        _nDroppedSnapshots = 0;
+        _nPlaybackChunk = -1;
+        _snapshotcapture.reset(new Snapshot());
+        _snapshotpending.reset(new Snapshot());
+        _snapshotwrite.reset(new Snapshot());
+        _threadwrite.reset(new boost::thread(boost::bind(&StateRecorder::_WriteThread,this)));
+    }
+    virtual ~StateRecorder()
+    {
+        _StopRecording();
+        {
+            boost::mutex::scoped_lock lock(_mutex);
+            _bContinueThread = false;
+            _condsnapshot.notify_all();
+        }
+        _threadwrite->join();
+    }
+
+    virtual void Destroy() {
+        _StopRecording();
+        ModuleBase::Destroy();
+    }
+
+    virtual bool SimulationStep(dReal fElapsedTime)
+    {
+        boost::mutex::scoped_lock lock(_mutex);
+        if( !_bRecording ) {
+            return false;
+        }
+        _fElapsedTime += fElapsedTime;
+        if( _fElapsedTime*_fRate >= 1 ) {
+            _fElapsedTime = 0;
+            _CaptureSnapshot();
+        }
+        return false;
+    }
+
+protected:
+    bool _StartCommand(ostream& sout, istream& sinput)
+    {
+        _StopRecording();
+        string cmd, filename;
+        dReal frate = 100;
+        uint32_t nchunkframes = 200;
+        int ncompressionlevel = 1;
+        while(!sinput.eof()) {
+            sinput >> cmd;
+            if( !sinput ) {
+                break;
+            }
+            std::transform(cmd.begin(), cmd.end(), cmd.begin(), ::tolower);
+            if( cmd == "rate" ) {
+                sinput >> frate;
+            }
+            else if( cmd == "chunkframes" ) {
+                sinput >> nchunkframes;
+            }
+            else if( cmd == "compression" ) {
+                sinput >> ncompressionlevel;
+            }
+            else if( cmd == "filename" ) {
+                if( !getline(sinput, filename) ) {
+                    return false;
+                }
+                boost::trim(filename);
+            }
+            else {
+                RAVELOG_WARN(str(boost::format("unrecognized command: %s\n")%cmd));
+                return false;
+            }
+            if( !sinput ) {
+                RAVELOG_ERROR(str(boost::format("failed processing command %s\n")%cmd));
+                return false;
+            }
+        }
+        if( filename.size() == 0 || frate <= 0 || nchunkframes == 0 ) {
+            return false;
+        }
+        {
+            boost::mutex::scoped_lock lockfile(_mutexfile);
+            _nChunkFrames = nchunkframes;
+            _nCompressionLevel = ncompressionlevel;
+            _outputfile.open(filename.c_str(), std::ios::binary|std::ios::out|std::ios::trunc);
+            if( !_outputfile ) {
+                RAVELOG_WARN(str(boost::format("failed to open %s for writing\n")%filename));
+                return false;
+            }
+            _outputfile.write("ORSTATE1", 8);
+            _vchunkdata.resize(0);
+            _nChunkFrameCount = 0;
+            _mapwritestates.clear();
+        }
+        boost::mutex::scoped_lock lock(_mutex);
+        _mapcapturestamps.clear();
+        _nDroppedSnapshots = 0;
+        _fRate = frate;
+        _fElapsedTime = 0;
+        _bRecording = true;
+        RAVELOG_DEBUG(str(boost::format("recording state to %s at %f Hz\n")%filename%_fRate));
+        return true;
+    }
+
+    bool _StopCommand(ostream& sout, istream& sinput)
+    {
+        sout << _StopRecording();
+        return true;
+    }
+
+    bool _RecordCommand(ostream& sout, istream& sinput)
+    {
+        EnvironmentMutex::scoped_lock lockenv(GetEnv()->GetMutex());
+        boost::mutex::scoped_lock lock(_mutex);
+        if( !_bRecording ) {
+            return false;
+        }
+        sout << _CaptureSnapshot();
+        return true;
+    }
+
+    bool _OpenCommand(ostream& sout, istream& sinput)
+    {
+        string filename;
+        if( !getline(sinput, filename) ) {
+            return false;
+        }
+        boost::trim(filename);
+        boost::mutex::scoped_lock lock(_mutexplayback);
+        _inputfile.close();
+        _inputfile.clear();
+        _vchunks.resize(0);
+        _nPlaybackChunk = -1;
+        _inputfile.open(filename.c_str(), std::ios::binary|std::ios::in);
+        _inputfile.seekg(0, std::ios::end);
+        uint64_t filesize = _inputfile.tellg();
+        _inputfile.seekg(0, std::ios::beg);
+        char header[8];
+        if( !_inputfile.read(header, 8) || strncmp(header, "ORSTATE1", 8) != 0 ) {
+            RAVELOG_WARN(str(boost::format("%s is not a state log\n")%filename));
+            _inputfile.close();
+            return false;
+        }
+        // index the chunks, a truncated chunk at the end is from a recording that did not finish
+        uint64_t numframes = 0;
+        while(true) {
+            ChunkInfo info;
+            _inputfile.read((char*)&info.compression, sizeof(info.compression));
+            _inputfile.read((char*)&info.numframes, sizeof(info.numframes));
+            _inputfile.read((char*)&info.rawsize, sizeof(info.rawsize));
+            _inputfile.read((char*)&info.datasize, sizeof(info.datasize));
+            _inputfile.read((char*)&info.firsttime, sizeof(info.firsttime));
+            _inputfile.read((char*)&info.lasttime, sizeof(info.lasttime));
+            if( !_inputfile ) {
+                break;
+            }
+            info.offset = _inputfile.tellg();
+            if( info.offset+info.datasize > filesize ) {
+                break;
+            }
+            _inputfile.seekg(info.datasize, std::ios::cur);
+            _vchunks.push_back(info);
+            numframes += info.numframes;
+        }
+        _inputfile.clear();
+        if( _vchunks.size() == 0 ) {
+            RAVELOG_WARN(str(boost::format("%s has no recorded chunks\n")%filename));
+            return false;
+        }
+        sout << numframes << " " << _vchunks.front().firsttime << " " << _vchunks.back().lasttime;
+        return true;
+    }
+
+    bool _SeekCommand(ostream& sout, istream& sinput)
+    {
+        uint64_t seektime = 0;
+        sinput >> seektime;
+        if( !sinput ) {
+            return false;
+        }
+        boost::mutex::scoped_lock lock(_mutexplayback);
+        if( _vchunks.size() == 0 ) {
+            RAVELOG_WARN("no state log is opened\n");
+            return false;
+        }
+        // find the last chunk starting at or before seektime
+        int ichunk = 0;
+        while(ichunk+1 < (int)_vchunks.size() && _vchunks[ichunk+1].firsttime <= seektime ) {
+            ++ichunk;
+        }
+        if( ichunk != _nPlaybackChunk ) {
+            if( !_ReadChunk(_vchunks[ichunk], _vplaybackdata) ) {
+                return false;
+            }
+            _nPlaybackChunk = ichunk;
+        }
+
+        std::map<std::string, BodyState> mapstates;
+        std::vector<std::string> vframebodies;
+        uint64_t frametime = 0;
+        ChunkReader reader(_vplaybackdata);
+        while(!reader.IsDone()) {
+            uint64_t simtime = reader.Read<uint64_t>();
+            if( simtime > seektime && vframebodies.size() > 0 ) {
+                break;
+            }
+            frametime = simtime;
+            uint32_t numbodies = reader.Read<uint32_t>();
+            vframebodies.resize(numbodies);
+            for(uint32_t ibody = 0; ibody < numbodies; ++ibody) {
+                std::string name;
+                reader.ReadString(name);
+                BodyState& state = mapstates[name];
+                state.name = name;
+                state.environmentid = reader.Read<int32_t>();
+                state.updatestamp = reader.Read<int32_t>();
+                if( reader.Read<uint8_t>() ) {
+                    state.vlinktransforms.resize(reader.Read<uint32_t>());
+                    FOREACH(ittrans, state.vlinktransforms) {
+                        reader.ReadTransform(*ittrans);
+                    }
+                    state.vdofvalues.resize(reader.Read<uint32_t>());
+                    FOREACH(itvalue, state.vdofvalues) {
+                        *itvalue = reader.Read<double>();
+                    }
+                }
+                state.vgrabbedinfo.resize(reader.Read<uint32_t>());
+                FOREACH(itgrabbed, state.vgrabbedinfo) {
+                    itgrabbed->reset(new RobotBase::GrabbedInfo());
+                    reader.ReadString((*itgrabbed)->_grabbedname);
+                    reader.ReadString((*itgrabbed)->_robotlinkname);
+                    reader.ReadTransform((*itgrabbed)->_trelative);
+                    uint32_t numignored = reader.Read<uint32_t>();
+                    for(uint32_t i = 0; i < numignored; ++i) {
+                        (*itgrabbed)->_setRobotLinksToIgnore.insert(reader.Read<int32_t>());
+                    }
+                }
+                vframebodies[ibody] = name;
+            }
+        }
+
+        EnvironmentMutex::scoped_lock lockenv(GetEnv()->GetMutex());
+        FOREACH(itname, vframebodies) {
+            const BodyState& state = mapstates[*itname];
+            KinBodyPtr pbody = GetEnv()->GetKinBody(state.name);
+            if( !pbody ) {
+                RAVELOG_VERBOSE(str(boost::format("body %s is not in the environment\n")%state.name));
+                continue;
+            }
+            if( pbody->GetLinks().size() != state.vlinktransforms.size() ) {
+                RAVELOG_WARN(str(boost::format("body %s has %d links, but the log has %d\n")%state.name%pbody->GetLinks().size()%state.vlinktransforms.size()));
+                continue;
+            }
+            pbody->SetLinkTransformations(state.vlinktransforms, state.vdofvalues);
+        }
+        // grabbed bodies are reset after all bodies are in place
+        FOREACH(itname, vframebodies) {
+            const BodyState& state = mapstates[*itname];
+            RobotBasePtr probot = GetEnv()->GetRobot(state.name);
+            if( !!probot ) {
+                std::vector<RobotBase::GrabbedInfoConstPtr> vgrabbedinfo(state.vgrabbedinfo.begin(), state.vgrabbedinfo.end());
+                probot->ResetGrabbed(vgrabbedinfo);
+            }
+        }
+        sout << frametime;
+        return true;
+    }
+
+    /// \brief captures the state of all bodies and passes it to the writing thread. Assumes the environment and _mutex are locked.
+    ///
+    /// \return false if the writing thread has not picked up the previous snapshot yet, in which case the snapshot is skipped
+    bool _CaptureSnapshot()
+    {
+        if( _bPendingSnapshot ) {
+            if( _nDroppedSnapshots == 0 ) {
+                RAVELOG_WARN(str(boost::format("state recorder is skipping snapshots at %d us because the writer is busy, lower the rate or the compression\n")%GetEnv()->GetSimulationTime()));
+            }
+            ++_nDroppedSnapshots;
+            return false;
+        }
+        Snapshot& snapshot = *_snapshotcapture;
+        snapshot.simtime = GetEnv()->GetSimulationTime();
+        GetEnv()->GetBodies(_vcapturebodies);
+        if( snapshot.vbodies.size() < _vcapturebodies.size() ) {
+            snapshot.vbodies.resize(_vcapturebodies.size());
+        }
+        snapshot.numbodies = _vcapturebodies.size();
+        std::map<int, std::pair<KinBodyWeakPtr, int> > mapcapturestamps;
+        for(size_t ibody = 0; ibody < _vcapturebodies.size(); ++ibody) {
+            KinBodyPtr pbody = _vcapturebodies[ibody];
+            BodyState& state = snapshot.vbodies[ibody];
+            state.environmentid = pbody->GetEnvironmentId();
+            state.updatestamp = pbody->GetUpdateStamp();
+            std::map<int, std::pair<KinBodyWeakPtr, int> >::iterator itstamp = _mapcapturestamps.find(state.environmentid);
+            state.bchanged = itstamp == _mapcapturestamps.end() || itstamp->second.second != state.updatestamp || itstamp->second.first.lock() != pbody;
+            if( state.bchanged ) {
+                state.name = pbody->GetName();
+                pbody->GetLinkTransformations(state.vlinktransforms, state.vdofvalues);
+            }
+            else if( state.name != pbody->GetName() ) {
+                state.name = pbody->GetName();
+            }
+            state.vgrabbedinfo.resize(0);
+            if( pbody->IsRobot() ) {
+                RaveInterfaceCast<RobotBase>(pbody)->GetGrabbedInfo(state.vgrabbedinfo);
+            }
+            mapcapturestamps[state.environmentid] = std::make_pair(KinBodyWeakPtr(pbody), state.updatestamp);
+        }
+        _vcapturebodies.resize(0);
+        _mapcapturestamps.swap(mapcapturestamps);
+
+        std::swap(_snapshotcapture, _snapshotpending);
+        _bPendingSnapshot = true;
+        _condsnapshot.notify_all();
+        return true;
+    }
+
+    /// \return the number of skipped snapshots of the recording
+    int _StopRecording()
+    {
+        boost::mutex::scoped_lock lock(_mutex);
+        if( !_bRecording ) {
+            return 0;
+        }
+        _bRecording = false;
+        _bFlushChunk = true;
+        _condsnapshot.notify_all();
+        while(_bFlushChunk && _bContinueThread) {
+            _condflushed.wait(lock);
+        }
+        boost::mutex::scoped_lock lockfile(_mutexfile);
+        _outputfile.close();
+        if( _nDroppedSnapshots > 0 ) {
+            RAVELOG_INFO(str(boost::format("state recorder skipped %d snapshots because the writer was busy\n")%_nDroppedSnapshots));
+        }
+        return _nDroppedSnapshots;
+    }
+
+    void _WriteThread()
+    {
+        while(true) {
+            bool bhavesnapshot = false, bflush = false;
+            {
+                boost::mutex::scoped_lock lock(_mutex);
+                while(_bContinueThread && !_bPendingSnapshot && !_bFlushChunk) {
+                    _condsnapshot.wait(lock);
+                }
+                if( _bPendingSnapshot ) {
+                    std::swap(_snapshotpending, _snapshotwrite);
+                    _bPendingSnapshot = false;
+                    bhavesnapshot = true;
+                }
+                // only flush after the pending snapshot is written
+                bflush = _bFlushChunk && !bhavesnapshot;
+                if( !_bContinueThread && !bhavesnapshot ) {
+                    _condflushed.notify_all();
+                    return;
+                }
+            }
+            try {
+                boost::mutex::scoped_lock lockfile(_mutexfile);
+                if( bhavesnapshot && _outputfile.is_open() ) {
+                    _EncodeSnapshot(*_snapshotwrite);
+                    if( _nChunkFrameCount >= _nChunkFrames ) {
+                        _WriteChunk();
+                    }
+                }
+                if( bflush && _outputfile.is_open() ) {
+                    _WriteChunk();
+                }
+            }
+            catch(const std::exception& ex) {
+                RAVELOG_ERROR(str(boost::format("failed to write state log: %s\n")%ex.what()));
+            }
+            if( bflush ) {
+                boost::mutex::scoped_lock lock(_mutex);
+                _bFlushChunk = false;
+                _condflushed.notify_all();
+            }
+        }
+    }
+
+    template <typename T> void _Write(const T& value)
+    {
+        size_t pos = _vchunkdata.size();
+        _vchunkdata.resize(pos+sizeof(T));
+        memcpy(&_vchunkdata[pos], &value, sizeof(T));
+    }
+
+    void _WriteString(const std::string& s)
+    {
+        _Write<uint32_t>(s.size());
+        _vchunkdata.insert(_vchunkdata.end(), s.begin(), s.end());
+    }
+
+    void _WriteTransform(const Transform& t)
+    {
+        double values[7] = { t.rot.x, t.rot.y, t.rot.z, t.rot.w, t.trans.x, t.trans.y, t.trans.z };
+        size_t pos = _vchunkdata.size();
+        _vchunkdata.resize(pos+sizeof(values));
+        memcpy(&_vchunkdata[pos], values, sizeof(values));
+    }
+
+    /// \brief appends the snapshot to the current chunk. The first frame of a chunk contains the data of all bodies.
+    void _EncodeSnapshot(const Snapshot& snapshot)
+    {
+        bool bkeyframe = _nChunkFrameCount == 0;
+        if( bkeyframe ) {
+            _chunkfirsttime = snapshot.simtime;
+        }
+        _chunklasttime = snapshot.simtime;
+        _Write<uint64_t>(snapshot.simtime);
+        _Write<uint32_t>(snapshot.numbodies);
+        std::map<int, BodyState> mapwritestates;
+        for(size_t ibody = 0; ibody < snapshot.numbodies; ++ibody) {
+            const BodyState& state = snapshot.vbodies[ibody];
+            BodyState& cachedstate = mapwritestates[state.environmentid];
+            std::map<int, BodyState>::iterator itcached = _mapwritestates.find(state.environmentid);
+            if( state.bchanged ) {
+                cachedstate.vlinktransforms = state.vlinktransforms;
+                cachedstate.vdofvalues = state.vdofvalues;
+            }
+            else if( itcached != _mapwritestates.end() ) {
+                cachedstate.vlinktransforms.swap(itcached->second.vlinktransforms);
+                cachedstate.vdofvalues.swap(itcached->second.vdofvalues);
+            }
+            _WriteString(state.name);
+            _Write<int32_t>(state.environmentid);
+            _Write<int32_t>(state.updatestamp);
+            if( state.bchanged || bkeyframe ) {
+                _Write<uint8_t>(1);
+                _Write<uint32_t>(cachedstate.vlinktransforms.size());
+                FOREACHC(ittrans, cachedstate.vlinktransforms) {
+                    _WriteTransform(*ittrans);
+                }
+                _Write<uint32_t>(cachedstate.vdofvalues.size());
+                FOREACHC(itvalue, cachedstate.vdofvalues) {
+                    _Write<double>(*itvalue);
+                }
+            }
+            else {
+                _Write<uint8_t>(0);
+            }
+            _Write<uint32_t>(state.vgrabbedinfo.size());
+            FOREACHC(itgrabbed, state.vgrabbedinfo) {
+                _WriteString((*itgrabbed)->_grabbedname);
+                _WriteString((*itgrabbed)->_robotlinkname);
+                _WriteTransform((*itgrabbed)->_trelative);
+                _Write<uint32_t>((*itgrabbed)->_setRobotLinksToIgnore.size());
+                FOREACHC(itlink, (*itgrabbed)->_setRobotLinksToIgnore) {
+                    _Write<int32_t>(*itlink);
+                }
+            }
+        }
+        // removed bodies are dropped from the cache
+        _mapwritestates.swap(mapwritestates);
+        ++_nChunkFrameCount;
+    }
+
+    /// \brief compresses and appends the current chunk to the file
+    void _WriteChunk()
+    {
+        if( _nChunkFrameCount == 0 ) {
+            return;
+        }
+        uint32_t compression = 0, rawsize = _vchunkdata.size(), datasize = _vchunkdata.size();
+        const uint8_t* pdata = &_vchunkdata[0];
+#ifdef OPENRAVE_HAS_ZLIB
+        if( _nCompressionLevel > 0 ) {
+            uLongf compressedsize = compressBound(rawsize);
+            _vcompresseddata.resize(compressedsize);
+            if( compress2(&_vcompresseddata[0], &compressedsize, &_vchunkdata[0], rawsize, _nCompressionLevel) == Z_OK ) {
+                compression = 1;
+                datasize = compressedsize;
+                pdata = &_vcompresseddata[0];
+            }
+        }
+#endif
+        _outputfile.write((const char*)&compression, sizeof(compression));
+        _outputfile.write((const char*)&_nChunkFrameCount, sizeof(_nChunkFrameCount));
+        _outputfile.write((const char*)&rawsize, sizeof(rawsize));
+        _outputfile.write((const char*)&datasize, sizeof(datasize));
+        _outputfile.write((const char*)&_chunkfirsttime, sizeof(_chunkfirsttime));
+        _outputfile.write((const char*)&_chunklasttime, sizeof(_chunklasttime));
+        _outputfile.write((const char*)pdata, datasize);
+        _outputfile.flush();
+        _vchunkdata.resize(0);
+        _nChunkFrameCount = 0;
+    }
+
+    /// \brief reads and decompresses a chunk of the playback log
+    bool _ReadChunk(const ChunkInfo& info, std::vector<uint8_t>& vdata)
+    {
+        std::vector<uint8_t> vfiledata(info.datasize);
+        _inputfile.clear();
+        _inputfile.seekg(info.offset);
+        if( info.datasize > 0 && !_inputfile.read((char*)&vfiledata[0], info.datasize) ) {
+            RAVELOG_WARN("failed to read state log chunk\n");
+            return false;
+        }
+        if( info.compression == 0 ) {
+            vdata.swap(vfiledata);
+            return true;
+        }
+#ifdef OPENRAVE_HAS_ZLIB
+        if( info.compression == 1 ) {
+            vdata.resize(info.rawsize);
+            uLongf rawsize = info.rawsize;
+            if( uncompress(&vdata[0], &rawsize, &vfiledata[0], info.datasize) != Z_OK || rawsize != info.rawsize ) {
+                RAVELOG_WARN("failed to decompress state log chunk\n");
+                return false;
+            }
+            return true;
+        }
+#endif
+        RAVELOG_WARN(str(boost::format("state log chunk has unsupported compression %d\n")%info.compression));
+        return false;
+    }
+
+    boost::mutex _mutex; ///< protects the recording state, the capture and the snapshot passing. Locked after the environment and before _mutexfile.
+    boost::mutex _mutexfile; ///< protects the output file and chunk data
+    boost::mutex _mutexplayback;
+    boost::condition _condsnapshot, _condflushed;
+    boost::shared_ptr<boost::thread> _threadwrite;
+    bool _bContinueThread, _bRecording, _bPendingSnapshot, _bFlushChunk;
+
+    // capture, protected by _mutex
+    SnapshotPtr _snapshotcapture; ///< the snapshot being captured
+    std::vector<KinBodyPtr> _vcapturebodies;
+    std::map<int, std::pair<KinBodyWeakPtr, int> > _mapcapturestamps; ///< environment id -> body and update stamp of the last passed snapshot
+    dReal _fRate, _fElapsedTime;
+    int _nDroppedSnapshots; ///< snapshots skipped in the current recording because the previous one was still pending
+
+    SnapshotPtr _snapshotpending; ///< waiting to be written, protected by _mutex
+
+    // owned by the writing thread
+    SnapshotPtr _snapshotwrite; ///< the snapshot being written
+    std::map<int, BodyState> _mapwritestates; ///< environment id -> last written body data, used for the first frame of every chunk
+    std::ofstream _outputfile;
+    std::vector<uint8_t> _vchunkdata, _vcompresseddata;
+    uint32_t _nChunkFrames, _nChunkFrameCount;
+    int _nCompressionLevel;
+    uint64_t _chunkfirsttime, _chunklasttime;
+
+    // playback
+    std::ifstream _inputfile;
+    std::vector<ChunkInfo> _vchunks;
+    std::vector<uint8_t> _vplaybackdata; ///< decompressed data of chunk _nPlaybackChunk
+    int _nPlaybackChunk;
+};
+
+ModuleBasePtr CreateStateRecorder(EnvironmentBasePtr penv, std::istream& sinput)
+{
+    return ModuleBasePtr(new StateRecorder(penv,sinput));
+}
@@ -17,6 +17,126 @@
 #define OPENRAVE_ODE_SPACE
 
 //#include <boost/thread/tss.hpp>
+#include <boost/thread/once.hpp>
+
+/// \brief ode trimesh data of a collision mesh, shared by all the geoms using the same mesh
+class ODETriMeshData
+{
+public:
+    ODETriMeshData(const OpenRAVE::TriMesh& trimesh)
+    {
+        _vindices.resize(trimesh.indices.size());
+        for(size_t i = 0; i < trimesh.indices.size(); ++i) {
+            _vindices[i] = trimesh.indices[i];
+        }
+        _vvertices.resize(4*trimesh.vertices.size());
+        for(size_t i = 0; i < trimesh.vertices.size(); ++i) {
+            const Vector& v = trimesh.vertices[i];
+            _vvertices[4*i+0] = v.x; _vvertices[4*i+1] = v.y; _vvertices[4*i+2] = v.z;
+        }
+        _id = dGeomTriMeshDataCreate();
+        dGeomTriMeshDataBuildSimple(_id, &_vvertices[0], trimesh.vertices.size(), &_vindices[0], _vindices.size());
+    }
+    virtual ~ODETriMeshData() {
+        dGeomTriMeshDataDestroy(_id);
+    }
+
+    dTriMeshDataID _id;
+    std::vector<dTriIndex> _vindices; ///< referenced by _id
+    std::vector<dReal> _vvertices; ///< referenced by _id
+};
+
+typedef boost::shared_ptr<ODETriMeshData> ODETriMeshDataPtr;
+
+/// \brief shares the ode trimesh data of identical collision meshes between links, bodies and cloned environments
+///
+/// The data is keyed by the md5 of the mesh and only read by ode once built. The per-geom state, like the last transform
+/// used for temporal coherence, is kept in the geoms and the colliders keep their caches per thread, so geoms of spaces
+/// used by different threads can share the data. The registry only holds weak references, so the data is destroyed
+/// together with the last geom using it.
+class ODETriMeshDataRegistry
+{
+public:
+    static ODETriMeshDataRegistry& GetInstance()
+    {
+        static boost::once_flag s_onceCreate = BOOST_ONCE_INIT;
+        boost::call_once(_Create, s_onceCreate);
+        return *_GetInstancePointer();
+    }
+
+    /// \brief returns the data of the mesh, building it if no other geom uses the same mesh
+    ODETriMeshDataPtr GetData(const OpenRAVE::TriMesh& trimesh)
+    {
+        std::string key = OpenRAVE::utils::GetMD5HashString(std::string(reinterpret_cast<const char*>(&trimesh.indices[0]), trimesh.indices.size()*sizeof(trimesh.indices[0])));
+        std::vector<dReal> vvertices(3*trimesh.vertices.size());
+        for(size_t i = 0; i < trimesh.vertices.size(); ++i) {
+            vvertices[3*i+0] = trimesh.vertices[i].x; vvertices[3*i+1] = trimesh.vertices[i].y; vvertices[3*i+2] = trimesh.vertices[i].z;
+        }
+        if( vvertices.size() > 0 ) {
+            key += OpenRAVE::utils::GetMD5HashString(std::string(reinterpret_cast<const char*>(&vvertices[0]), vvertices.size()*sizeof(dReal)));
+        }
+
+        {
+            boost::mutex::scoped_lock lock(_mutex);
+            std::map<std::string, boost::weak_ptr<ODETriMeshData> >::iterator it = _mapdata.find(key);
+            if( it != _mapdata.end() ) {
+                ODETriMeshDataPtr pdata = it->second.lock();
+                if( !!pdata ) {
+                    return pdata;
+                }
+            }
+        }
+
+        // building the collision tree takes long, so do not hold the lock
+        ODETriMeshDataPtr pdata(new ODETriMeshData(trimesh));
+        boost::mutex::scoped_lock lock(_mutex);
+        boost::weak_ptr<ODETriMeshData>& pweakdata = _mapdata[key];
+        ODETriMeshDataPtr potherdata = pweakdata.lock();
+        if( !!potherdata ) {
+            // another thread built the same data in the meantime
+            return potherdata;
+        }
+        pweakdata = pdata;
+        if( _mapdata.size() >= 2*_nNumDataAfterCleanup ) {
+            _RemoveExpired();
+        }
+        return pdata;
+    }
+
+private:
+    ODETriMeshDataRegistry() : _nNumDataAfterCleanup(64) {
+    }
+
+    static ODETriMeshDataRegistry*& _GetInstancePointer()
+    {
+        static ODETriMeshDataRegistry* s_pInstance = NULL;
+        return s_pInstance;
+    }
+
+    static void _Create()
+    {
+        // never destroyed since the data can be released by bodies destroyed after the plugin globals
+        _GetInstancePointer() = new ODETriMeshDataRegistry();
+    }
+
+    void _RemoveExpired()
+    {
+        std::map<std::string, boost::weak_ptr<ODETriMeshData> >::iterator it = _mapdata.begin();
+        while(it != _mapdata.end()) {
+            if( it->second.expired() ) {
+                _mapdata.erase(it++);
+            }
+            else {
+                ++it;
+            }
+        }
+        _nNumDataAfterCleanup = max(size_t(64), _mapdata.size());
+    }
+
+    boost::mutex _mutex;
+    std::map<std::string, boost::weak_ptr<ODETriMeshData> > _mapdata;
+    size_t _nNumDataAfterCleanup; ///< the expired data is removed once the map grows to twice this size
+};
 
 // manages a space of ODE objects
 class ODESpace : public boost::enable_shared_from_this<ODESpace>
@@ -82,7 +202,7 @@ public:
             LINK() : body(NULL), geom(NULL), _bEnabled(true) {
             }
             virtual ~LINK() {
-                BOOST_ASSERT(listtrimeshinds.size()==0&&listvertices.size()==0&&body==NULL&&geom==NULL);
+                BOOST_ASSERT(listtrimeshdata.size()==0&&body==NULL&&geom==NULL);
             }
 
             dBodyID body;
@@ -127,8 +247,7 @@ public:
                 return _plink.lock();
             }
 
-            list<dTriIndex*> listtrimeshinds;
-            list<dReal*> listvertices;
+            list<ODETriMeshDataPtr> listtrimeshdata; ///< keeps the shared trimesh data of the geoms alive
             KinBody::LinkWeakPtr _plink;
             bool _bEnabled;
             Transform tlinkmass, tlinkmassinv; // the local mass frame ODE was initialized with
@@ -158,19 +277,7 @@ public:
                 dGeomID curgeom = (*itlink)->geom;
                 while(curgeom) {
                     dGeomID pnextgeom = dBodyGetNextGeom(curgeom);
-                    if( dGeomGetClass(curgeom) == dGeomTransformClass ) {
-                        dGeomID childgeom = dGeomTransformGetGeom(curgeom);
-                        if(( childgeom != NULL) &&( dGeomGetClass(childgeom) == dTriMeshClass) ) {
-                            if( dGeomTriMeshGetData(childgeom) != 0 ) {
-                                dGeomTriMeshDataDestroy(dGeomTriMeshGetData(childgeom));
-                            }
-                        }
-                    }
-                    else if( dGeomGetClass(curgeom) == dTriMeshClass ) {
-                        if( dGeomTriMeshGetData(curgeom) != 0 ) {
-                            dGeomTriMeshDataDestroy(dGeomTriMeshGetData(curgeom));
-                        }
-                    }
+                    // the trimesh data is shared, it is released with listtrimeshdata after all its geoms are destroyed
                     dGeomDestroy(curgeom);
                     curgeom = pnextgeom;
                 }
@@ -179,14 +286,7 @@ public:
                     dBodyDestroy((*itlink)->body);
                     (*itlink)->body = NULL;
                 }
-                FOREACH(itind, (*itlink)->listtrimeshinds) {
-                    delete[] *itind;
-                }
-                (*itlink)->listtrimeshinds.clear();
-                FOREACH(itind, (*itlink)->listvertices) {
-                    delete[] *itind;
-                }
-                (*itlink)->listvertices.clear();
+                (*itlink)->listtrimeshdata.clear();
                 (*itlink)->_bEnabled = false;
             }
             vlinks.resize(0);
@@ -320,7 +420,7 @@ private:
 
             if( _geometrygroup.size() > 0 && (*itlink)->GetGroupNumGeometries(_geometrygroup) >= 0 ) {
                 // add a geometry object group
-                const std::vector<KinBody::GeometryInfoPtr>& vgeometryinfos = (*itlink)->GetGeometriesFromGroup(_geometrygroup);
+                std::vector<KinBody::GeometryInfoPtr> vgeometryinfos = (*itlink)->GetGeometriesFromGroup(_geometrygroup);
                 FOREACHC(itgeominfo, vgeometryinfos) {
                     dGeomID odegeomtrans = _CreateODEGeomFromGeometryInfo(pinfo->space, link, **itgeominfo);
                     if( !odegeomtrans ) {
@@ -643,21 +743,10 @@ private:
             odegeom = dCreateCylinder(0,info._vGeomData.x,info._vGeomData.y);
             break;
         case OpenRAVE::GT_TriMesh:
-            if( info._meshcollision.indices.size() > 0 ) {
-                dTriIndex* pindices = new dTriIndex[info._meshcollision.indices.size()];
-                for(size_t i = 0; i < info._meshcollision.indices.size(); ++i) {
-                    pindices[i] = info._meshcollision.indices[i];
-                }
-                dReal* pvertices = new dReal[4*info._meshcollision.vertices.size()];
-                for(size_t i = 0; i < info._meshcollision.vertices.size(); ++i) {
-                    Vector v = info._meshcollision.vertices[i];
-                    pvertices[4*i+0] = v.x; pvertices[4*i+1] = v.y; pvertices[4*i+2] = v.z;
-                }
-                dTriMeshDataID id = dGeomTriMeshDataCreate();
-                dGeomTriMeshDataBuildSimple(id, pvertices, info._meshcollision.vertices.size(), pindices, info._meshcollision.indices.size());
-                odegeom = dCreateTriMesh(0, id, NULL, NULL, NULL);
-                link->listtrimeshinds.push_back(pindices);
-                link->listvertices.push_back(pvertices);
+            if( info.GetCollisionMesh().indices.size() > 0 ) {
+                ODETriMeshDataPtr pdata = ODETriMeshDataRegistry::GetInstance().GetData(info.GetCollisionMesh());
+                odegeom = dCreateTriMesh(0, pdata->_id, NULL, NULL, NULL);
+                link->listtrimeshdata.push_back(pdata);
             }
             break;
         default:
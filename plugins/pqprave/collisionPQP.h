@@ -18,6 +18,8 @@
 #define  COLPQP_H
 
 #include "pqp/PQP.h"
+#include "workerpool.h"
+#include "modelregistry.h"
 #include <boost/lexical_cast.hpp>
 
 //wrapper class for PQP, distance and tolerance checking is _off_ by default, collision checking is _on_ by default
@@ -35,12 +37,88 @@ public:
             return _pbody.lock();
         }
         KinBodyWeakPtr _pbody;
-        vector<boost::shared_ptr<PQP_Model> > vlinks;
+        vector<boost::shared_ptr<PQP_Model> > vlinks; ///< shared with all links that have the same collision mesh
+        vector<Tri*> vlasttris; ///< warm start of the distance queries of each link, points to triangles of vlinks
         int nLastStamp;
     };
     typedef boost::shared_ptr<KinBodyInfo> KinBodyInfoPtr;
     typedef boost::shared_ptr<KinBodyInfo const> KinBodyInfoConstPtr;
 
+    /// \brief a link pair to be checked along with the pqp transforms of both links
+    class LinkPair
+    {
+public:
+        KinBody::LinkConstPtr plink1, plink2;
+        PQP_Model* m1, *m2; ///< owned by the KinBodyInfo of the links
+        Tri** plasttri1, **plasttri2; ///< warm starts of the distance queries, owned by the KinBodyInfo of the links
+        PQP_REAL R1[3][3], T1[3], R2[3][3], T2[3];
+        int igroup; ///< pairs of the same group are counted once for CollisionReport::numWithinTol
+    };
+
+    /// \brief a link moving during a continuous query, either a link of the body or of a body it grabs
+    class ContinuousLink
+    {
+public:
+        KinBody::LinkConstPtr plink;
+        PQP_Model* m;
+        Tri** plasttri;
+        dReal fmotionbound; ///< upper bound of the displacement of any point of the link for a unit change of t
+    };
+
+    /// \brief holds the pqp results and scratch data of one query
+    ///
+    /// The contexts are owned by the checker and reused, so the buffers of the pqp results and the link pairs are only
+    /// allocated when they grow. Every call borrows a context from the pool of the checker with QueryContextScope, so
+    /// nested queries and queries running concurrently in several threads each get their own.
+    class QueryContext
+    {
+public:
+        PQP_CollideResult colres;
+        PQP_DistanceResult disres;
+        PQP_ToleranceResult tolres;
+        std::vector<LinkPair> vlinkpairs; ///< pairs of the query, checked in order
+        std::vector<PQP_DistanceResult> vdistanceresults; ///< distances of vlinkpairs when computed in parallel
+        std::vector<Transform> vtrans1, vtrans2;
+        std::vector<ContinuousLink> vcontinuouslinks; ///< moving links of a continuous query
+        std::vector<LinkPair> vcontinuousenvlinks; ///< environment links of a continuous query, only the second link is set
+        std::vector<dReal> vcontinuousvalues, vcontinuousdelta;
+
+        //for collision reporting
+        Vector u1, u2, u3, v1, v2, v3;
+        Vector contactpos, contactnorm;
+    };
+    typedef boost::shared_ptr<QueryContext> QueryContextPtr;
+
+    /// \brief borrows a query context from the pool of the checker until the end of the scope
+    class QueryContextScope
+    {
+public:
+        QueryContextScope(CollisionCheckerPQP& checker) : _checker(checker) {
+            {
+                boost::mutex::scoped_lock lock(_checker._mutexquerycontexts);
+                if( _checker._vfreequerycontexts.size() > 0 ) {
+                    _pctx = _checker._vfreequerycontexts.back();
+                    _checker._vfreequerycontexts.pop_back();
+                }
+            }
+            if( !_pctx ) {
+                _pctx.reset(new QueryContext());
+            }
+            _pctx->vlinkpairs.resize(0);
+        }
+        ~QueryContextScope() {
+            boost::mutex::scoped_lock lock(_checker._mutexquerycontexts);
+            _checker._vfreequerycontexts.push_back(_pctx);
+        }
+        QueryContext& GetContext() const {
+            return *_pctx;
+        }
+
+private:
+        CollisionCheckerPQP& _checker;
+        QueryContextPtr _pctx;
+    };
+
     CollisionCheckerPQP(EnvironmentBasePtr penv) : CollisionCheckerBase(penv)
     {
         __description = ":Interface Authors: Dmitry Berenson, Rosen Diankov\n\nPQP collision checker, slow but allows distance queries to objects.";
@@ -48,11 +126,19 @@ public:
         _rel_err = 200.0;     //temporary change
         _abs_err = 0.001;       //temporary change
         _tolerance = 0.0;
+        _options = 0;
 
         //enable or disable various features
         _benablecol = true;
         _benabledis = false;
         _benabletol = false;
+        _nContinuousMaxIterations = 1000;
+        RegisterCommand("SetNumThreads",boost::bind(&CollisionCheckerPQP::_SetNumThreadsCommand, this,_1,_2),
+                        "Sets the number of threads used to compute the distances of the link pairs of one query when CO_Distance is set. 1 (default) evaluates all the pairs on the calling thread.");
+        RegisterCommand("GetNumModels",boost::bind(&CollisionCheckerPQP::_GetNumModelsCommand, this,_1,_2),
+                        "Returns the number of pqp models used by the links of all the environments. Identical collision meshes share one model.");
+        RegisterCommand("SetContinuousMaxIterations",boost::bind(&CollisionCheckerPQP::_SetContinuousMaxIterationsCommand, this,_1,_2),
+                        "Sets the maximum number of iterations of CheckContinuousCollision, queries that do not finish are left to discrete checks.");
     }
     virtual ~CollisionCheckerPQP() {
         DestroyEnvironment();
@@ -99,23 +185,13 @@ public:
         pinfo->_pbody = boost::const_pointer_cast<KinBody>(pbody);
         pbody->SetUserData(_userdatakey, pinfo);
 
-        PQP_REAL p1[3], p2[3], p3[3];
         pinfo->vlinks.reserve(pbody->GetLinks().size());
+        pinfo->vlasttris.reserve(pbody->GetLinks().size());
         FOREACHC(itlink, pbody->GetLinks()) {
-            const TriMesh& trimesh = (*itlink)->GetCollisionData();
-            boost::shared_ptr<PQP_Model> pm;
-            if( trimesh.indices.size() > 0 ) {
-                pm.reset(new PQP_Model());
-                pm->BeginModel(trimesh.indices.size()/3);
-                for(int j = 0; j < (int)trimesh.indices.size(); j+=3) {
-                    p1[0] = trimesh.vertices[trimesh.indices[j]].x;     p1[1] = trimesh.vertices[trimesh.indices[j]].y;     p1[2] = trimesh.vertices[trimesh.indices[j]].z;
-                    p2[0] = trimesh.vertices[trimesh.indices[j+1]].x;   p2[1] = trimesh.vertices[trimesh.indices[j+1]].y;     p2[2] = trimesh.vertices[trimesh.indices[j+1]].z;
-                    p3[0] = trimesh.vertices[trimesh.indices[j+2]].x;   p3[1] = trimesh.vertices[trimesh.indices[j+2]].y;     p3[2] = trimesh.vertices[trimesh.indices[j+2]].z;
-                    pm->AddTri(p1, p2, p3, j/3);
-                }
-                pm->EndModel();
-            }
+            boost::shared_ptr<PQP_Model> pm = PQPModelRegistry::GetInstance().GetModel((*itlink)->GetCollisionData());
             pinfo->vlinks.push_back(pm);
+            // the models are shared, so never let pqp store the warm start in them
+            pinfo->vlasttris.push_back(!!pm ? pm->last_tri : NULL);
         }
 
         return true;
@@ -214,10 +290,12 @@ public:
         _InitKinBody(plink1->GetParent());
         _InitKinBody(plink2->GetParent());
         _pactiverobot.reset();
-        PQP_REAL R1[3][3], R2[3][3], T1[3], T2[3];
+        QueryContextScope scope(*this);
+        QueryContext& ctx = scope.GetContext();
+        PQP_REAL R1[3][3], T1[3];
         GetPQPTransformFromTransform(plink1->GetTransform(),R1,T1);
-        GetPQPTransformFromTransform(plink2->GetTransform(),R2,T2);
-        return DoPQP(plink1,R1,T1,plink2,R2,T2,report);
+        _AddLinkPair(ctx.vlinkpairs,plink1,R1,T1,plink2,plink2->GetTransform(),0);
+        return _CheckLinkPairs(ctx, report, false);
     }
 
     virtual bool CheckCollision(KinBody::LinkConstPtr plink, KinBodyConstPtr pbody, CollisionReportPtr report)
@@ -245,25 +323,19 @@ public:
             report->Reset(_options);
         }
         _pactiverobot.reset();
-        int tmpnumcols = 0;
-        int tmpnumwithintol = 0;
-        bool retval;
-
         _InitKinBody(plink->GetParent());
 
         std::vector<KinBodyPtr> vecbodies;
         GetEnv()->GetBodies(vecbodies);
 
-        PQP_REAL R1[3][3], R2[3][3], T1[3], T2[3];
-
-        std::vector<Transform> vtrans1,vtrans2;
-        plink->GetParent()->GetLinkTransformations(vtrans1);
-        FOREACH(itbody,vecbodies) {
-            if(!!report) {
-                report->numWithinTol = 0;
-            }
-            KinBodyPtr pbody2 = *itbody;
+        PQP_REAL R1[3][3], T1[3];
+        GetPQPTransformFromTransform(plink->GetTransform(),R1,T1);
 
+        QueryContextScope scope(*this);
+        QueryContext& ctx = scope.GetContext();
+        std::vector<Transform>& vtrans2 = ctx.vtrans2;
+        for(int ibody = 0; ibody < (int)vecbodies.size(); ++ibody) {
+            KinBodyPtr pbody2 = vecbodies[ibody];
             if(plink->GetParent()->IsAttached(KinBodyConstPtr(pbody2)) ) {
                 continue;
             }
@@ -271,10 +343,8 @@ public:
                 continue;
             }
             _InitKinBody(pbody2);
-            std::vector<KinBody::LinkPtr> veclinks2 = pbody2->GetLinks();
+            const std::vector<KinBody::LinkPtr>& veclinks2 = pbody2->GetLinks();
             pbody2->GetLinkTransformations(vtrans2);
-            GetPQPTransformFromTransform(vtrans1[plink->GetIndex()],R1,T1);
-
             for(int j = 0; j < (int)vtrans2.size(); j++) {
                 if(plink == veclinks2[j]) {
                     continue;
@@ -282,33 +352,11 @@ public:
                 if( find(vlinkexcluded.begin(),vlinkexcluded.end(),veclinks2[j]) != vlinkexcluded.end() ) {
                     continue;
                 }
-                GetPQPTransformFromTransform(vtrans2[j],R2,T2);
-
-                retval = DoPQP(plink,R1,T1,veclinks2[j],R2,T2,report);
-                if(!report && _benablecol && !_benabledis && !_benabletol && retval) {
-                    return true;
-                }
-                //return tolerance check result when it is the only thing enabled and there is no report
-                if(!report && !_benablecol && !_benabledis && _benabletol && retval) {
-                    return true;
-                }
-                if( retval ) {
-                    ++tmpnumcols;
-                }
-            }
-
-            if(!!report) {
-                if(report->numWithinTol > 0) {
-                    tmpnumwithintol++;
-                }
+                _AddLinkPair(ctx.vlinkpairs,plink,R1,T1,veclinks2[j],vtrans2[j],ibody);
             }
         }
 
-        if(!!report) {
-            report->numWithinTol = tmpnumwithintol;
-        }
-
-        return tmpnumcols>0;
+        return _CheckLinkPairs(ctx, report, true);
     }
 
     virtual bool CheckCollision(KinBodyConstPtr pbody, const std::vector<KinBodyConstPtr>& vbodyexcluded, const std::vector<KinBody::LinkConstPtr>& vlinkexcluded, CollisionReportPtr report)
@@ -369,11 +417,22 @@ public:
             adjacentoptions |= KinBody::AO_ActiveDOFs;
         }
         const std::set<int>& nonadjacent = pbody->GetNonAdjacentLinks(adjacentoptions);
+        _pactiverobot.reset();
+        QueryContextScope scope(*this);
+        QueryContext& ctx = scope.GetContext();
+        std::vector<Transform>& vtrans = ctx.vtrans1;
+        pbody->GetLinkTransformations(vtrans);
+        PQP_REAL R1[3][3], T1[3];
         FOREACHC(itset, nonadjacent) {
-            if( CheckCollision(KinBody::LinkConstPtr(pbody->GetLinks().at(*itset&0xffff)), KinBody::LinkConstPtr(pbody->GetLinks().at(*itset>>16)), report) ) {
-                RAVELOG_VERBOSE(str(boost::format("selfcol %s, Links %s %s are colliding\n")%pbody->GetName()%pbody->GetLinks().at(*itset&0xffff)->GetName()%pbody->GetLinks().at(*itset>>16)->GetName()));
-                return true;
+            int index1 = *itset&0xffff, index2 = *itset>>16;
+            GetPQPTransformFromTransform(vtrans.at(index1),R1,T1);
+            _AddLinkPair(ctx.vlinkpairs,pbody->GetLinks().at(index1),R1,T1,pbody->GetLinks().at(index2),vtrans.at(index2),0);
+        }
+        if( _CheckLinkPairs(ctx, report, false, !(_options&OpenRAVE::CO_AllLinkCollisions)) ) {
+            if( !!report && !!report->plink1 && !!report->plink2 ) {
+                RAVELOG_VERBOSE(str(boost::format("selfcol %s, Links %s %s are colliding\n")%pbody->GetName()%report->plink1->GetName()%report->plink2->GetName()));
             }
+            return true;
         }
 
         return false;
@@ -394,22 +453,91 @@ public:
             adjacentoptions |= KinBody::AO_ActiveDOFs;
         }
         const std::set<int>& nonadjacent = pbody->GetNonAdjacentLinks(adjacentoptions);
-        PQP_REAL R1[3][3], R2[3][3], T1[3], T2[3];
+        QueryContextScope scope(*this);
+        QueryContext& ctx = scope.GetContext();
+        PQP_REAL R1[3][3], T1[3];
         FOREACHC(itset, nonadjacent) {
             KinBody::LinkConstPtr plink1(pbody->GetLinks().at(*itset&0xffff)), plink2(pbody->GetLinks().at(*itset>>16));
             if( plink == plink1 || plink == plink2 ) {
                 GetPQPTransformFromTransform(plink1->GetTransform(),R1,T1);
-                GetPQPTransformFromTransform(plink2->GetTransform(),R2,T2);
-                if( DoPQP(plink1,R1,T1,plink2,R2,T2,report) ) {
-                    RAVELOG_VERBOSE(str(boost::format("selfcol %s, Links %s %s are colliding\n")%pbody->GetName()%pbody->GetLinks().at(*itset&0xffff)->GetName()%pbody->GetLinks().at(*itset>>16)->GetName()));
-                    return true;
-                }
+                _AddLinkPair(ctx.vlinkpairs,plink1,R1,T1,plink2,plink2->GetTransform(),0);
+            }
+        }
+        if( _CheckLinkPairs(ctx, report, false, !(_options&OpenRAVE::CO_AllLinkCollisions)) ) {
+            if( !!report && !!report->plink1 && !!report->plink2 ) {
+                RAVELOG_VERBOSE(str(boost::format("selfcol %s, Links %s %s are colliding\n")%pbody->GetName()%report->plink1->GetName()%report->plink2->GetName()));
             }
+            return true;
         }
 
         return false;
     }
 
+    /// \brief conservative advancement of the body along the linear motion
+    ///
+    /// At every step the distance d of each moving link to the environment is computed. The displacement of any point of
+    /// the link per unit of t is bounded by fmotionbound, so the link cannot collide before t + d/fmotionbound.
+    virtual int CheckContinuousCollision(KinBodyPtr pbody, const std::vector<dReal>& vdofvalues0, const std::vector<dReal>& vdofvalues1, dReal ftolerance, dReal& fcollisiontime, CollisionReportPtr report)
+    {
+        if(!!report) {
+            report->Reset(_options);
+        }
+        fcollisiontime = 0;
+        if( (int)vdofvalues0.size() != pbody->GetDOF() || (int)vdofvalues1.size() != pbody->GetDOF() ) {
+            throw OPENRAVE_EXCEPTION_FORMAT("dof values need to be of size %d", pbody->GetDOF(), ORE_InvalidArguments);
+        }
+        if( ftolerance <= 0 ) {
+            throw OPENRAVE_EXCEPTION_FORMAT("continuous collision tolerance %f has to be positive", ftolerance, ORE_InvalidArguments);
+        }
+        _pactiverobot.reset();
+        QueryContextScope scope(*this);
+        QueryContext& ctx = scope.GetContext();
+        ctx.vcontinuousdelta = vdofvalues1;
+        pbody->SubtractDOFValues(ctx.vcontinuousdelta, vdofvalues0);
+
+        KinBody::KinBodyStateSaver saver(pbody, KinBody::Save_LinkTransformation);
+        pbody->SetDOFValues(vdofvalues0, KinBody::CLA_Nothing);
+        if( !_InitContinuousLinks(ctx, pbody) ) {
+            return -1;
+        }
+
+        dReal t = 0;
+        for(int iter = 0; iter < _nContinuousMaxIterations; ++iter) {
+            dReal fstep = 1;
+            FOREACH(itcontlink, ctx.vcontinuouslinks) {
+                // links that do not move only have to be checked once
+                if( iter > 0 && itcontlink->fmotionbound <= 0 ) {
+                    continue;
+                }
+                KinBody::LinkConstPtr plinkclosest;
+                dReal fdist = _ComputeContinuousDistance(ctx, *itcontlink, ftolerance, plinkclosest);
+                if( fdist <= ftolerance ) {
+                    fcollisiontime = t;
+                    if( !!report ) {
+                        report->plink1 = itcontlink->plink;
+                        report->plink2 = plinkclosest;
+                        report->minDistance = max(fdist, dReal(0));
+                    }
+                    return 1;
+                }
+                if( itcontlink->fmotionbound > 0 ) {
+                    // keep half the tolerance as margin so the next step starts strictly outside of the environment
+                    fstep = min(fstep, (fdist-0.5*ftolerance)/itcontlink->fmotionbound);
+                }
+            }
+            if( t >= 1 ) {
+                return 0;
+            }
+            t = min(dReal(1), t+fstep);
+            for(size_t i = 0; i < ctx.vcontinuousvalues.size(); ++i) {
+                ctx.vcontinuousvalues[i] = vdofvalues0[i] + t*ctx.vcontinuousdelta[i];
+            }
+            pbody->SetDOFValues(ctx.vcontinuousvalues, KinBody::CLA_Nothing);
+        }
+        RAVELOG_DEBUG(str(boost::format("continuous collision of %s did not finish in %d iterations, t=%f")%pbody->GetName()%_nContinuousMaxIterations%t));
+        return -1;
+    }
+
     boost::shared_ptr<PQP_Model> GetLinkModel(KinBody::LinkConstPtr plink)
     {
         KinBodyInfoPtr pinfo = boost::dynamic_pointer_cast<KinBodyInfo>(plink->GetParent()->GetUserData(_userdatakey));
@@ -417,34 +545,200 @@ public:
         return pinfo->vlinks.at(plink->GetIndex());
     }
 
+    /// \brief returns the warm start of the distance queries of the link
+    Tri** _GetLinkLastTri(KinBody::LinkConstPtr plink)
+    {
+        KinBodyInfoPtr pinfo = boost::dynamic_pointer_cast<KinBodyInfo>(plink->GetParent()->GetUserData(_userdatakey));
+        BOOST_ASSERT( pinfo->GetBody() == plink->GetParent());
+        return &pinfo->vlasttris.at(plink->GetIndex());
+    }
+
     void SetTolerance(dReal tol){
         _benabletol = true; _tolerance = tol;
     }
 
 private:
+    bool _SetNumThreadsCommand(ostream& sout, istream& sinput)
+    {
+        int numthreads = 1;
+        sinput >> numthreads;
+        if( !sinput ) {
+            return false;
+        }
+        if( numthreads > 1 ) {
+            _pworkerpool.reset(new WorkerPool(numthreads));
+        }
+        else {
+            _pworkerpool.reset();
+        }
+        return true;
+    }
+
+    bool _GetNumModelsCommand(ostream& sout, istream& sinput)
+    {
+        sout << PQPModelRegistry::GetInstance().GetNumModels();
+        return true;
+    }
+
+    bool _SetContinuousMaxIterationsCommand(ostream& sout, istream& sinput)
+    {
+        int maxiterations = _nContinuousMaxIterations;
+        sinput >> maxiterations;
+        if( !sinput || maxiterations <= 0 ) {
+            return false;
+        }
+        _nContinuousMaxIterations = maxiterations;
+        return true;
+    }
+
+    /// \brief fills ctx.vcontinuouslinks and ctx.vcontinuousenvlinks for the body at its current configuration and the motion ctx.vcontinuousdelta
+    ///
+    /// The motion bound of a link is computed along the joint chain from the root link. A revolute dof k moves the points
+    /// of the link by at most |delta_k|*R_k, where R_k bounds the distance of the link from the axis: the distances between
+    /// consecutive joint anchors and the distance from the last anchor to the link bounding sphere do not change when
+    /// revolute joints rotate, and prismatic joints change them by at most their own delta.
+    /// \return false if the kinematics are not supported (closed loops, mimic joints, bodies attached without grabbing)
+    bool _InitContinuousLinks(QueryContext& ctx, KinBodyPtr pbody)
+    {
+        ctx.vcontinuouslinks.resize(0);
+        ctx.vcontinuousenvlinks.resize(0);
+        ctx.vcontinuousvalues = ctx.vcontinuousdelta;
+        if( pbody->GetClosedLoops().size() > 0 ) {
+            return false;
+        }
+        _InitKinBody(pbody);
+        RobotBasePtr probot = RaveInterfaceCast<RobotBase>(pbody);
+        std::set<KinBodyPtr> setattached;
+        pbody->GetAttached(setattached);
+        std::vector<KinBody::JointPtr> vjoints;
+        FOREACHC(itattached, setattached) {
+            KinBody::LinkPtr pparentlink;
+            if( *itattached != pbody ) {
+                if( !!probot ) {
+                    pparentlink = probot->IsGrabbing(*itattached);
+                }
+                if( !pparentlink ) {
+                    return false;
+                }
+                _InitKinBody(*itattached);
+            }
+            FOREACHC(itlink, (*itattached)->GetLinks()) {
+                boost::shared_ptr<PQP_Model> m = GetLinkModel(*itlink);
+                KinBody::Link::SphereTreeConstPtr ptree = (*itlink)->GetSphereTree();
+                if( !(*itlink)->IsEnabled() || !m || !ptree || ptree->spheres.size() == 0 ) {
+                    continue;
+                }
+                KinBody::LinkPtr pchainlink = !!pparentlink ? pparentlink : *itlink;
+                vjoints.resize(0);
+                pbody->GetChain(0, pchainlink->GetIndex(), vjoints);
+                const Vector& vlocalsphere = ptree->spheres[0];
+                Vector vprevpoint = (*itlink)->GetTransform() * vlocalsphere;
+                dReal fradius = vlocalsphere.w, fmotionbound = 0;
+                for(int ijoint = (int)vjoints.size()-1; ijoint >= 0; --ijoint) {
+                    KinBody::JointPtr pjoint = vjoints[ijoint];
+                    if( pjoint->IsMimic() ) {
+                        return false;
+                    }
+                    Vector vanchor = pjoint->GetAnchor();
+                    fradius += RaveSqrt((vprevpoint-vanchor).lengthsqr3());
+                    vprevpoint = vanchor;
+                    if( pjoint->GetDOFIndex() < 0 ) {
+                        // passive joints that are not mimic keep their values, so the link is rigidly attached to the parent
+                        continue;
+                    }
+                    for(int idof = 0; idof < pjoint->GetDOF(); ++idof) {
+                        dReal fdelta = RaveFabs(ctx.vcontinuousdelta.at(pjoint->GetDOFIndex()+idof));
+                        if( pjoint->IsPrismatic(idof) ) {
+                            fmotionbound += fdelta;
+                            fradius += fdelta;
+                        }
+                        else if( pjoint->IsRevolute(idof) ) {
+                            fmotionbound += fdelta*fradius;
+                        }
+                        else {
+                            return false;
+                        }
+                    }
+                }
+                ContinuousLink contlink;
+                contlink.plink = *itlink;
+                contlink.m = m.get();
+                contlink.plasttri = _GetLinkLastTri(*itlink);
+                contlink.fmotionbound = fmotionbound;
+                ctx.vcontinuouslinks.push_back(contlink);
+            }
+        }
+
+        std::vector<KinBodyPtr> vbodies;
+        GetEnv()->GetBodies(vbodies);
+        FOREACHC(itbody, vbodies) {
+            if( pbody->IsAttached(KinBodyConstPtr(*itbody)) ) {
+                continue;
+            }
+            _InitKinBody(*itbody);
+            FOREACHC(itlink, (*itbody)->GetLinks()) {
+                boost::shared_ptr<PQP_Model> m = GetLinkModel(*itlink);
+                if( !(*itlink)->IsEnabled() || !m ) {
+                    continue;
+                }
+                ctx.vcontinuousenvlinks.push_back(LinkPair());
+                LinkPair& envlink = ctx.vcontinuousenvlinks.back();
+                envlink.plink2 = *itlink;
+                envlink.m2 = m.get();
+                envlink.plasttri2 = _GetLinkLastTri(*itlink);
+                GetPQPTransformFromTransform((*itlink)->GetTransform(), envlink.R2, envlink.T2);
+            }
+        }
+        return true;
+    }
+
+    /// \brief returns a lower bound of the distance between the link and the environment at the current configuration
+    ///
+    /// \param ftolerance the search stops once a link closer than ftolerance is found
+    /// \param[out] plinkclosest the environment link closest to contlink
+    dReal _ComputeContinuousDistance(QueryContext& ctx, const ContinuousLink& contlink, dReal ftolerance, KinBody::LinkConstPtr& plinkclosest)
+    {
+        // large relative errors make pqp much faster and are taken into account when converting to a lower bound
+        const PQP_REAL frelerr = 0.1, fabserr = 0.25*ftolerance;
+        PQP_REAL R1[3][3], T1[3];
+        GetPQPTransformFromTransform(contlink.plink->GetTransform(), R1, T1);
+        dReal fmindist = std::numeric_limits<dReal>::infinity();
+        FOREACH(itenvlink, ctx.vcontinuousenvlinks) {
+            ctx.disres.last_tri1 = *contlink.plasttri;
+            ctx.disres.last_tri2 = *itenvlink->plasttri2;
+            PQP_Distance(&ctx.disres, R1, T1, contlink.m, itenvlink->R2, itenvlink->T2, itenvlink->m2, frelerr, fabserr, 2, 0, 1);
+            *contlink.plasttri = ctx.disres.last_tri1;
+            *itenvlink->plasttri2 = ctx.disres.last_tri2;
+            dReal fdist = (dReal)ctx.disres.distance;
+            // pqp stops when either error bound is satisfied
+            fdist = min(fdist/(1+frelerr), fdist-fabserr);
+            if( fdist < fmindist ) {
+                fmindist = fdist;
+                plinkclosest = itenvlink->plink2;
+                if( fmindist <= ftolerance ) {
+                    break;
+                }
+            }
+        }
+        return fmindist;
+    }
+
     // does not check attached
     bool CheckCollisionP(KinBodyConstPtr pbody1, const std::vector<KinBodyConstPtr>& vbodyexcluded, const std::vector<KinBody::LinkConstPtr>& vlinkexcluded, CollisionReportPtr report)
     {
-        int tmpnumcols = 0;
-        int tmpnumwithintol = 0;
-        bool retval;
-
         std::vector<KinBodyPtr> vecbodies;
         GetEnv()->GetBodies(vecbodies);
 
-        PQP_REAL R1[3][3], R2[3][3], T1[3], T2[3];
-
-        std::vector<Transform> vtrans1,vtrans2;
+        QueryContextScope scope(*this);
+        QueryContext& ctx = scope.GetContext();
+        std::vector<Transform>& vtrans1 = ctx.vtrans1, &vtrans2 = ctx.vtrans2;
         pbody1->GetLinkTransformations(vtrans1);
         _InitKinBody(pbody1);
 
-        std::vector<KinBody::LinkPtr> veclinks1 = pbody1->GetLinks();
-        FOREACH(itbody,vecbodies) {
-            if(!!report) {
-                report->numWithinTol = 0;
-            }
-            KinBodyPtr pbody2 = *itbody;
-
+        PQP_REAL R1[3][3], T1[3];
+        const std::vector<KinBody::LinkPtr>& veclinks1 = pbody1->GetLinks();
+        for(int ibody = 0; ibody < (int)vecbodies.size(); ++ibody) {
+            KinBodyPtr pbody2 = vecbodies[ibody];
             if(pbody1->IsAttached(KinBodyConstPtr(pbody2)) ) {
                 continue;
             }
@@ -453,42 +747,22 @@ private:
             }
 
             _InitKinBody(pbody2);
-            std::vector<KinBody::LinkPtr> veclinks2 = pbody2->GetLinks();
+            const std::vector<KinBody::LinkPtr>& veclinks2 = pbody2->GetLinks();
             pbody2->GetLinkTransformations(vtrans2);
             for(int i = 0; i < (int)vtrans1.size(); i++) {
                 if(find(vlinkexcluded.begin(),vlinkexcluded.end(),veclinks1[i]) != vlinkexcluded.end()) {
                     continue;
                 }
                 GetPQPTransformFromTransform(vtrans1[i],R1,T1);
-
                 for(int j = 0; j < (int)vtrans2.size(); j++) {
                     if(find(vlinkexcluded.begin(),vlinkexcluded.end(),veclinks2[j]) != vlinkexcluded.end()) {
                         continue;
                     }
-                    GetPQPTransformFromTransform(vtrans2[j],R2,T2);
-                    retval = DoPQP(veclinks1[i],R1,T1,veclinks2[j],R2,T2,report);
-                    if(!report && _benablecol && !_benabledis && !_benabletol && retval) {
-                        return true;
-                    }
-                    //return tolerance check result when it is the only thing enabled and there is no report
-                    if(!report && !_benablecol && !_benabledis && _benabletol && retval) {
-                        return true;
-                    }
-                    if( retval ) {
-                        ++tmpnumcols;
-                    }
-                }
-            }
-            if(!!report) {
-                if(report->numWithinTol > 0) {
-                    tmpnumwithintol++;
+                    _AddLinkPair(ctx.vlinkpairs,veclinks1[i],R1,T1,veclinks2[j],vtrans2[j],ibody);
                 }
             }
         }
-        if(!!report) {
-            report->numWithinTol = tmpnumwithintol;
-        }
-        return tmpnumcols>0;
+        return _CheckLinkPairs(ctx, report, true);
     }
 
     // does not check attached
@@ -496,23 +770,16 @@ private:
     {
         _InitKinBody(pbody1);
         _InitKinBody(pbody2);
-        PQP_REAL R1[3][3], R2[3][3], T1[3], T2[3];
+        QueryContextScope scope(*this);
+        QueryContext& ctx = scope.GetContext();
+        PQP_REAL R1[3][3], T1[3];
         FOREACHC(itlink1,pbody1->GetLinks()) {
             GetPQPTransformFromTransform((*itlink1)->GetTransform(),R1,T1);
             FOREACHC(itlink2,pbody2->GetLinks()) {
-                GetPQPTransformFromTransform((*itlink2)->GetTransform(),R2,T2);
-                bool retval = DoPQP(*itlink1,R1,T1,*itlink2,R2,T2,report);
-                if(!report && _benablecol && !_benabledis && !_benabletol && retval) {
-                    return true;
-                }
-                //return tolerance check result when it is the only thing enabled and there is no report
-                if(!report && !_benablecol && !_benabledis && _benabletol && retval) {
-                    return true;
-                }
+                _AddLinkPair(ctx.vlinkpairs,*itlink1,R1,T1,*itlink2,(*itlink2)->GetTransform(),0);
             }
         }
-
-        return false;
+        return _CheckLinkPairs(ctx, report, false);
     }
 
     // does not check attached
@@ -520,13 +787,89 @@ private:
     {
         _InitKinBody(plink->GetParent());
         _InitKinBody(pbody);
-        bool success = false;
-        PQP_REAL R1[3][3], R2[3][3], T1[3], T2[3];
+        QueryContextScope scope(*this);
+        QueryContext& ctx = scope.GetContext();
+        PQP_REAL R1[3][3], T1[3];
         GetPQPTransformFromTransform(plink->GetTransform(),R1,T1);
         FOREACHC(itlink,pbody->GetLinks()) {
-            GetPQPTransformFromTransform((*itlink)->GetTransform(),R2,T2);
-            bool retval = DoPQP(plink,R1,T1,*itlink,R2,T2,report);
-            success |= retval;
+            _AddLinkPair(ctx.vlinkpairs,plink,R1,T1,*itlink,(*itlink)->GetTransform(),0);
+        }
+        return _CheckLinkPairs(ctx, report, false);
+    }
+
+    /// \brief adds the pair to vlinkpairs if both links are enabled, active and have a collision model
+    void _AddLinkPair(std::vector<LinkPair>& vlinkpairs, KinBody::LinkConstPtr link1, PQP_REAL R1[3][3], PQP_REAL T1[3], KinBody::LinkConstPtr link2, const Transform& t2, int igroup)
+    {
+        if( !link1->IsEnabled() || !link2->IsEnabled() ) {
+            return;
+        }
+        if( !_IsActiveLink(link1->GetParent(),link1->GetIndex()) || !_IsActiveLink(link2->GetParent(),link2->GetIndex()) ) {
+            return;
+        }
+        boost::shared_ptr<PQP_Model> m1 = GetLinkModel(link1);
+        boost::shared_ptr<PQP_Model> m2 = GetLinkModel(link2);
+        if( !m1 || !m2 ) {
+            return;
+        }
+        vlinkpairs.push_back(LinkPair());
+        LinkPair& pair = vlinkpairs.back();
+        pair.plink1 = link1;
+        pair.plink2 = link2;
+        pair.m1 = m1.get();
+        pair.m2 = m2.get();
+        pair.plasttri1 = _GetLinkLastTri(link1);
+        pair.plasttri2 = _GetLinkLastTri(link2);
+        for(int i = 0; i < 3; ++i) {
+            pair.R1[i][0] = R1[i][0]; pair.R1[i][1] = R1[i][1]; pair.R1[i][2] = R1[i][2];
+            pair.T1[i] = T1[i];
+        }
+        GetPQPTransformFromTransform(t2,pair.R2,pair.T2);
+        pair.igroup = igroup;
+    }
+
+    /// \brief checks all the pairs of ctx.vlinkpairs in order and fills the report
+    ///
+    /// If distance is requested, the pqp distances of all the pairs are computed first from the warm starts before the query,
+    /// in parallel if a worker pool is set. The distances are approximate and depend on the warm starts, so the serial path
+    /// does not chain them from pair to pair either. The collision and tolerance queries and the report are always processed
+    /// in the pair order, so the results do not depend on the number of threads.
+    /// \param bcountwithintol if true, report->numWithinTol is set to the number of pair groups that have at least one pair within tolerance
+    /// \param bstopatcollision if true, returns at the first colliding pair even if there is a report
+    bool _CheckLinkPairs(QueryContext& ctx, CollisionReportPtr report, bool bcountwithintol, bool bstopatcollision=false)
+    {
+        std::vector<LinkPair>& vlinkpairs = ctx.vlinkpairs;
+        std::vector<PQP_DistanceResult>& vdistanceresults = ctx.vdistanceresults;
+        bool bDistanceFirst = _benabledis && !!report && vlinkpairs.size() > 1;
+        if( bDistanceFirst ) {
+            vdistanceresults.resize(vlinkpairs.size());
+            if( !!_pworkerpool ) {
+                _pworkerpool->Run(vlinkpairs.size(), boost::bind(&CollisionCheckerPQP::_ComputeDistanceJob, this, boost::ref(vlinkpairs), boost::ref(vdistanceresults), _1, _2));
+            }
+            else {
+                for(size_t i = 0; i < vlinkpairs.size(); ++i) {
+                    _ComputeDistanceJob(vlinkpairs, vdistanceresults, 0, i);
+                }
+            }
+            // warm start the next queries, a link in several pairs keeps the result of its last pair
+            for(size_t i = 0; i < vlinkpairs.size(); ++i) {
+                *vlinkpairs[i].plasttri1 = vdistanceresults[i].last_tri1;
+                *vlinkpairs[i].plasttri2 = vdistanceresults[i].last_tri2;
+            }
+        }
+
+        int tmpnumcols = 0;
+        int tmpnumwithintol = 0;
+        int igroup = -1;
+        for(size_t i = 0; i < vlinkpairs.size(); ++i) {
+            LinkPair& pair = vlinkpairs[i];
+            if( bcountwithintol && !!report && pair.igroup != igroup ) {
+                if( report->numWithinTol > 0 ) {
+                    tmpnumwithintol++;
+                }
+                report->numWithinTol = 0;
+                igroup = pair.igroup;
+            }
+            bool retval = DoPQP(ctx, pair, report, bDistanceFirst ? &vdistanceresults[i] : NULL);
             if(!report && _benablecol && !_benabledis && !_benabletol && retval) {
                 return true;
             }
@@ -534,9 +877,32 @@ private:
             if(!report && !_benablecol && !_benabledis && _benabletol && retval) {
                 return true;
             }
+            if( retval ) {
+                if( bstopatcollision ) {
+                    return true;
+                }
+                if( !!report && (_options&OpenRAVE::CO_AllLinkCollisions) ) {
+                    report->vLinkColliding.push_back(std::make_pair(pair.plink1, pair.plink2));
+                }
+                ++tmpnumcols;
+            }
+        }
+        if( bcountwithintol && !!report ) {
+            if( report->numWithinTol > 0 ) {
+                tmpnumwithintol++;
+            }
+            report->numWithinTol = tmpnumwithintol;
         }
+        return tmpnumcols>0;
+    }
 
-        return success;
+    /// \brief worker job computing the distance of one pair of vlinkpairs into vdistanceresults, only reads the pqp models and the warm starts
+    void _ComputeDistanceJob(std::vector<LinkPair>& vlinkpairs, std::vector<PQP_DistanceResult>& vdistanceresults, int ithread, int ipair)
+    {
+        LinkPair& pair = vlinkpairs[ipair];
+        vdistanceresults[ipair].last_tri1 = *pair.plasttri1;
+        vdistanceresults[ipair].last_tri2 = *pair.plasttri2;
+        PQP_Distance(&vdistanceresults[ipair],pair.R1,pair.T1,pair.m1,pair.R2,pair.T2,pair.m2,_rel_err,_abs_err,2,0,1);
     }
 
     Vector PQPRealToVector(const Vector& in, const PQP_REAL R[3][3], const PQP_REAL T[3])
@@ -544,20 +910,13 @@ private:
         return Vector(in.x*R[0][0]+in.y*R[0][1]+in.z*R[0][2]+T[0], in.x*R[1][0]+in.y*R[1][1]+in.z*R[1][2]+T[1], in.x*R[2][0]+in.y*R[2][1]+in.z*R[2][2]+T[2]);
     }
 
-    bool DoPQP(KinBody::LinkConstPtr link1, PQP_REAL R1[3][3], PQP_REAL T1[3], KinBody::LinkConstPtr link2, PQP_REAL R2[3][3], PQP_REAL T2[3], CollisionReportPtr report)
+    /// \param pdisres if not NULL, the already computed distance of the pair
+    bool DoPQP(QueryContext& ctx, LinkPair& pair, CollisionReportPtr report, const PQP_DistanceResult* pdisres=NULL)
     {
-        if( !link1->IsEnabled() || !link2->IsEnabled() ) {
-            return false;
-        }
-        if( !_IsActiveLink(link1->GetParent(),link1->GetIndex()) || !_IsActiveLink(link2->GetParent(),link2->GetIndex()) ) {
-            return false;
-        }
-        boost::shared_ptr<PQP_Model> m1 = GetLinkModel(link1);
-        boost::shared_ptr<PQP_Model> m2 = GetLinkModel(link2);
+        KinBody::LinkConstPtr link1 = pair.plink1, link2 = pair.plink2;
+        PQP_REAL (*R1)[3] = pair.R1, (*R2)[3] = pair.R2;
+        PQP_REAL* T1 = pair.T1, *T2 = pair.T2;
         bool bcollision = false;
-        if( !m1 || !m2 ) {
-            return false;
-        }
         // collision
         if(_benablecol) {
             if( GetEnv()->HasRegisteredCollisionCallbacks() && !report ) {
@@ -565,34 +924,32 @@ private:
                 report->Reset(_options);
             }
 
+            PQP_Collide(&ctx.colres,R1,T1,pair.m1,R2,T2,pair.m2);
             if(!report) {
-                PQP_CollideResult _colres;
-                PQP_Collide(&_colres,R1,T1,m1.get(),R2,T2,m2.get());
-                if(_colres.NumPairs() > 0) {
+                if(ctx.colres.NumPairs() > 0) {
                     bcollision = true;
                 }
             }
             else {
-                PQP_Collide(&colres,R1,T1,m1.get(),R2,T2,m2.get());
-
-                if(colres.NumPairs() > 0) {
+                if(ctx.colres.NumPairs() > 0) {
                     report->plink1 = link1;
                     report->plink2 = link2;
                     report->minDistance = 0;
                     bcollision = true;
                 }
 
-                for(int i = 0; i < colres.NumPairs(); i++) {
-                    u1 = PQPRealToVector(link1->GetCollisionData().vertices[link1->GetCollisionData().indices[colres.Id1(i)*3]],R1,T1);
-                    u2 = PQPRealToVector(link1->GetCollisionData().vertices[link1->GetCollisionData().indices[colres.Id1(i)*3+1]],R1,T1);
-                    u3 = PQPRealToVector(link1->GetCollisionData().vertices[link1->GetCollisionData().indices[colres.Id1(i)*3+2]],R1,T1);
+                const TriMesh& trimesh1 = link1->GetCollisionData(), &trimesh2 = link2->GetCollisionData();
+                for(int i = 0; i < ctx.colres.NumPairs(); i++) {
+                    ctx.u1 = PQPRealToVector(trimesh1.vertices[trimesh1.indices[ctx.colres.Id1(i)*3]],R1,T1);
+                    ctx.u2 = PQPRealToVector(trimesh1.vertices[trimesh1.indices[ctx.colres.Id1(i)*3+1]],R1,T1);
+                    ctx.u3 = PQPRealToVector(trimesh1.vertices[trimesh1.indices[ctx.colres.Id1(i)*3+2]],R1,T1);
 
-                    v1=PQPRealToVector(link2->GetCollisionData().vertices[link2->GetCollisionData().indices[colres.Id2(i)*3]],R2,T2);
-                    v2=PQPRealToVector(link2->GetCollisionData().vertices[link2->GetCollisionData().indices[colres.Id2(i)*3+1]],R2,T2);
-                    v3=PQPRealToVector(link2->GetCollisionData().vertices[link2->GetCollisionData().indices[colres.Id2(i)*3+2]],R2,T2);
+                    ctx.v1 = PQPRealToVector(trimesh2.vertices[trimesh2.indices[ctx.colres.Id2(i)*3]],R2,T2);
+                    ctx.v2 = PQPRealToVector(trimesh2.vertices[trimesh2.indices[ctx.colres.Id2(i)*3+1]],R2,T2);
+                    ctx.v3 = PQPRealToVector(trimesh2.vertices[trimesh2.indices[ctx.colres.Id2(i)*3+2]],R2,T2);
 
-                    if(TriTriCollision(u1,u2,u3,v1,v2,v3,contactpos,contactnorm)) {
-                        report->contacts.push_back(CollisionReport::CONTACT(contactpos,contactnorm,0.));
+                    if(TriTriCollision(ctx.u1,ctx.u2,ctx.u3,ctx.v1,ctx.v2,ctx.v3,ctx.contactpos,ctx.contactnorm)) {
+                        report->contacts.push_back(CollisionReport::CONTACT(ctx.contactpos,ctx.contactnorm,0.));
                     }
                 }
 
@@ -620,13 +977,19 @@ private:
             //PQP_Tolerance(&tolres,R1,T1,m1,R2,T2,m2,_preport->minDistance);
             //if(tolres.CloserThanTolerance()) {
 
-            PQP_Distance(&disres,R1,T1,m1.get(),R2,T2,m2.get(),_rel_err,_abs_err);
-            if(report->minDistance > (dReal) disres.Distance()) {
-                report->minDistance = (dReal) disres.Distance();
+            if( !pdisres ) {
+                ctx.disres.last_tri1 = *pair.plasttri1;
+                ctx.disres.last_tri2 = *pair.plasttri2;
+                PQP_Distance(&ctx.disres,R1,T1,pair.m1,R2,T2,pair.m2,_rel_err,_abs_err,2,0,1);
+                *pair.plasttri1 = ctx.disres.last_tri1;
+                *pair.plasttri2 = ctx.disres.last_tri2;
+                pdisres = &ctx.disres;
+            }
+            if(report->minDistance > (dReal) pdisres->distance) {
+                report->minDistance = (dReal) pdisres->distance;
                 report->contacts.resize(1);
-                Vector p1(disres.P1()[0],disres.P1()[1],disres.P1()[2]), p2(disres.P2()[0],disres.P2()[1],disres.P2()[2]);
-                p1 = PQPRealToVector(disres.P1(),R1,T1);
-                p2 = PQPRealToVector(disres.P2(),R2,T2);
+                Vector p1 = PQPRealToVector(Vector(pdisres->p1[0],pdisres->p1[1],pdisres->p1[2]),R1,T1);
+                Vector p2 = PQPRealToVector(Vector(pdisres->p2[0],pdisres->p2[1],pdisres->p2[2]),R2,T2);
                 dReal depth = RaveSqrt((p2-p1).lengthsqr3());
                 report->contacts.at(0).pos = p1;
                 report->contacts.at(0).depth = -depth;
@@ -641,16 +1004,16 @@ private:
 
         // tolerance
         if( _benabletol) {
-            PQP_Tolerance(&tolres,R1,T1,m1.get(),R2,T2,m2.get(),_tolerance);
+            PQP_Tolerance(&ctx.tolres,R1,T1,pair.m1,R2,T2,pair.m2,_tolerance);
             if(!!report) {
-                report->numWithinTol += tolres.CloserThanTolerance();
+                report->numWithinTol += ctx.tolres.CloserThanTolerance();
             }
         }
         if(_benablecol) {
             return bcollision;
         }
         else if(_benabletol) {
-            return tolres.CloserThanTolerance()>0;
+            return ctx.tolres.CloserThanTolerance()>0;
         }
         else {
             return false;
@@ -664,23 +1027,15 @@ private:
     PQP_REAL _rel_err;
     PQP_REAL _abs_err;
 
-    // collision
-    bool _benablecol;
-    PQP_CollideResult colres;
-
-    // distance
-    bool _benabledis;
-    PQP_DistanceResult disres;
+    bool _benablecol; ///< collision
+    bool _benabledis; ///< distance
+    bool _benabletol; ///< within tolerance
 
-    // within tolerance
-    bool _benabletol;
-    PQP_ToleranceResult tolres;
+    WorkerPoolPtr _pworkerpool; ///< set if distance queries are evaluated in parallel
+    boost::mutex _mutexquerycontexts; ///< protects _vfreequerycontexts
+    std::vector<QueryContextPtr> _vfreequerycontexts; ///< contexts not borrowed by a query, see QueryContextScope
 
-    //for collision reporting
-    Vector u1, u2, u3, v1, v2, v3;
-    Vector contactpos, contactnorm;
-    PQP_REAL tri1[3][3], tri2[3][3];
-    TransformMatrix tmtemp;
+    int _nContinuousMaxIterations;
 
     RobotBaseConstPtr _pactiverobot;     ///< set if ActiveDOFs option is enabled
     vector<uint8_t> _vactivelinks;
@@ -0,0 +1,135 @@
+// -*- coding: utf-8 -*-
+// Copyright (C) 2006-2011 Rosen Diankov <rosen.diankov@gmail.com>
+//
+// This file is part of OpenRAVE.
+// OpenRAVE is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+#ifndef OPENRAVE_PQP_MODELREGISTRY_H
+#define OPENRAVE_PQP_MODELREGISTRY_H
+
+#include <openrave/utils.h>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/once.hpp>
+
+/// \brief shares the pqp models of identical collision meshes between links, bodies and cloned environments
+///
+/// Models are keyed by the md5 of their triangles and are never modified after they are built, so checkers of
+/// environments running in different threads can query them concurrently. The per-link state, like the warm start
+/// of the distance queries, is kept by the checkers. The registry only holds weak references, so a model is destroyed
+/// together with the last link using it.
+class PQPModelRegistry
+{
+public:
+    static PQPModelRegistry& GetInstance()
+    {
+        static boost::once_flag s_onceCreate = BOOST_ONCE_INIT;
+        boost::call_once(_Create, s_onceCreate);
+        return *_GetInstancePointer();
+    }
+
+    /// \brief returns the model of the mesh, building it if no other link uses the same mesh
+    ///
+    /// \return empty if the mesh has no triangles
+    boost::shared_ptr<PQP_Model> GetModel(const TriMesh& trimesh)
+    {
+        if( trimesh.indices.size() == 0 ) {
+            return boost::shared_ptr<PQP_Model>();
+        }
+        std::vector<PQP_REAL> vtrivertices(trimesh.indices.size()*3);
+        for(size_t i = 0; i < trimesh.indices.size(); ++i) {
+            const Vector& v = trimesh.vertices.at(trimesh.indices[i]);
+            vtrivertices[3*i+0] = v.x; vtrivertices[3*i+1] = v.y; vtrivertices[3*i+2] = v.z;
+        }
+        std::string key = utils::GetMD5HashString(std::string(reinterpret_cast<const char*>(&vtrivertices[0]), vtrivertices.size()*sizeof(PQP_REAL)));
+        {
+            boost::mutex::scoped_lock lock(_mutex);
+            std::map<std::string, boost::weak_ptr<PQP_Model> >::iterator it = _mapmodels.find(key);
+            if( it != _mapmodels.end() ) {
+                boost::shared_ptr<PQP_Model> pmodel = it->second.lock();
+                if( !!pmodel ) {
+                    return pmodel;
+                }
+            }
+        }
+
+        // building takes long, so do not hold the lock
+        boost::shared_ptr<PQP_Model> pmodel(new PQP_Model());
+        pmodel->BeginModel(trimesh.indices.size()/3);
+        for(size_t i = 0; i+2 < trimesh.indices.size(); i += 3) {
+            pmodel->AddTri(&vtrivertices[3*i], &vtrivertices[3*i+3], &vtrivertices[3*i+6], i/3);
+        }
+        pmodel->EndModel();
+
+        boost::mutex::scoped_lock lock(_mutex);
+        boost::weak_ptr<PQP_Model>& pweakmodel = _mapmodels[key];
+        boost::shared_ptr<PQP_Model> pothermodel = pweakmodel.lock();
+        if( !!pothermodel ) {
+            // another thread built the same model in the meantime
+            return pothermodel;
+        }
+        pweakmodel = pmodel;
+        if( _mapmodels.size() >= 2*_nNumModelsAfterCleanup ) {
+            _RemoveExpired();
+        }
+        return pmodel;
+    }
+
+    /// \brief returns the number of models used by at least one link
+    size_t GetNumModels()
+    {
+        boost::mutex::scoped_lock lock(_mutex);
+        size_t nummodels = 0;
+        for(std::map<std::string, boost::weak_ptr<PQP_Model> >::const_iterator it = _mapmodels.begin(); it != _mapmodels.end(); ++it) {
+            if( !it->second.expired() ) {
+                ++nummodels;
+            }
+        }
+        return nummodels;
+    }
+
+private:
+    PQPModelRegistry() : _nNumModelsAfterCleanup(64) {
+    }
+
+    static PQPModelRegistry*& _GetInstancePointer()
+    {
+        static PQPModelRegistry* s_pInstance = NULL;
+        return s_pInstance;
+    }
+
+    static void _Create()
+    {
+        // never destroyed since the models can be released by bodies destroyed after the plugin globals
+        _GetInstancePointer() = new PQPModelRegistry();
+    }
+
+    void _RemoveExpired()
+    {
+        std::map<std::string, boost::weak_ptr<PQP_Model> >::iterator it = _mapmodels.begin();
+        while(it != _mapmodels.end()) {
+            if( it->second.expired() ) {
+                _mapmodels.erase(it++);
+            }
+            else {
+                ++it;
+            }
+        }
+        _nNumModelsAfterCleanup = max(size_t(64), _mapmodels.size());
+    }
+
+    boost::mutex _mutex;
+    std::map<std::string, boost::weak_ptr<PQP_Model> > _mapmodels;
+    size_t _nNumModelsAfterCleanup; ///< the expired models are removed once the map grows to twice this size
+};
+
+#endif
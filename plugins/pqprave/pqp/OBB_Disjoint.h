@@ -44,6 +44,13 @@
 #include "MatVec.h"
 #include "PQP_Compile.h"
 
+// SSE2 is part of every x86_64 target, so the vectorized test is used by default there.
+// Define PQP_NO_SIMD to force the scalar reference implementation.
+#if defined(__SSE2__) && !defined(PQP_NO_SIMD)
+#define PQP_USE_SSE2
+#include <emmintrin.h>
+#endif
+
 // int
 // obb_disjoint(PQP_REAL B[3][3], PQP_REAL T[3], PQP_REAL a[3], PQP_REAL b[3]);
 //
@@ -57,9 +64,14 @@
 // and zero vector, respectively, so they need not be specified.  The
 // dimensions of box A are given in array a.
 
+//
+// obb_disjoint_scalar is the reference implementation, it returns the
+// index (1-15) of the first separating axis that was found or 0 if the
+// boxes overlap.
+
 inline
 int
-obb_disjoint(PQP_REAL B[3][3], PQP_REAL T[3], PQP_REAL a[3], PQP_REAL b[3])
+obb_disjoint_scalar(PQP_REAL B[3][3], PQP_REAL T[3], PQP_REAL a[3], PQP_REAL b[3])
 {
     register PQP_REAL t, s;
     register int r;
@@ -209,6 +221,207 @@ obb_disjoint(PQP_REAL B[3][3], PQP_REAL T[3], PQP_REAL a[3], PQP_REAL b[3])
     return 0; // should equal 0
 }
 
+#ifdef PQP_USE_SSE2
+
+// The 15 separating axis tests are evaluated as five groups of three
+// lanes, with two registers of packed doubles or one register of packed
+// floats per group depending on PQP_REAL (see PQP_Compile.h).
+// All the tests are computed without branching and the index of the
+// first failing test in the order of obb_disjoint_scalar is returned.
+// The sums are evaluated in the same order as in obb_disjoint_scalar, so
+// both give the same result for the same boxes.
+namespace pqp_sse2 {
+
+#ifdef PQP_SINGLE_PRECISION
+
+// 3-vector in the x, y, z lanes, the w lane is 0
+struct v3
+{
+    __m128 xyz;
+};
+
+inline v3 load(const PQP_REAL v[3])
+{
+    v3 r; r.xyz = _mm_set_ps(0, v[2], v[1], v[0]); return r;
+}
+
+inline void store(const v3& a, PQP_REAL v[3])
+{
+    PQP_REAL f[4]; _mm_storeu_ps(f, a.xyz); v[0] = f[0]; v[1] = f[1]; v[2] = f[2];
+}
+
+inline v3 column(PQP_REAL M[3][3], int k)
+{
+    v3 r; r.xyz = _mm_set_ps(0, M[2][k], M[1][k], M[0][k]); return r;
+}
+
+inline v3 set(PQP_REAL x, PQP_REAL y, PQP_REAL z)
+{
+    v3 r; r.xyz = _mm_set_ps(0, z, y, x); return r;
+}
+
+inline v3 add(const v3& a, const v3& b)
+{
+    v3 r; r.xyz = _mm_add_ps(a.xyz, b.xyz); return r;
+}
+
+inline v3 sub(const v3& a, const v3& b)
+{
+    v3 r; r.xyz = _mm_sub_ps(a.xyz, b.xyz); return r;
+}
+
+inline v3 mul(const v3& a, const v3& b)
+{
+    v3 r; r.xyz = _mm_mul_ps(a.xyz, b.xyz); return r;
+}
+
+inline v3 scale(const v3& a, PQP_REAL s)
+{
+    v3 r; r.xyz = _mm_mul_ps(a.xyz, _mm_set1_ps(s)); return r;
+}
+
+inline v3 vabs(const v3& a)
+{
+    const __m128 signmask = _mm_set1_ps(-0.0f);
+    v3 r; r.xyz = _mm_andnot_ps(signmask, a.xyz); return r;
+}
+
+// 3-bit mask of the lanes where !(t <= bound), NaNs count as separated like in the scalar version
+inline int separated(const v3& t, const v3& bound)
+{
+    return _mm_movemask_ps(_mm_cmpnle_ps(t.xyz, bound.xyz))&7;
+}
+
+#else
+
+// 3-vector, the z component is in the low lane of z
+struct v3
+{
+    __m128d xy, z;
+};
+
+inline v3 load(const PQP_REAL v[3])
+{
+    v3 r; r.xy = _mm_loadu_pd(v); r.z = _mm_load_sd(v+2); return r;
+}
+
+inline void store(const v3& a, PQP_REAL v[3])
+{
+    _mm_storeu_pd(v, a.xy); _mm_store_sd(v+2, a.z);
+}
+
+inline v3 column(PQP_REAL M[3][3], int k)
+{
+    v3 r; r.xy = _mm_set_pd(M[1][k], M[0][k]); r.z = _mm_load_sd(&M[2][k]); return r;
+}
+
+inline v3 set(PQP_REAL x, PQP_REAL y, PQP_REAL z)
+{
+    v3 r; r.xy = _mm_set_pd(y, x); r.z = _mm_set_sd(z); return r;
+}
+
+inline v3 add(const v3& a, const v3& b)
+{
+    v3 r; r.xy = _mm_add_pd(a.xy, b.xy); r.z = _mm_add_pd(a.z, b.z); return r;
+}
+
+inline v3 sub(const v3& a, const v3& b)
+{
+    v3 r; r.xy = _mm_sub_pd(a.xy, b.xy); r.z = _mm_sub_pd(a.z, b.z); return r;
+}
+
+inline v3 mul(const v3& a, const v3& b)
+{
+    v3 r; r.xy = _mm_mul_pd(a.xy, b.xy); r.z = _mm_mul_pd(a.z, b.z); return r;
+}
+
+inline v3 scale(const v3& a, PQP_REAL s)
+{
+    __m128d ss = _mm_set1_pd(s);
+    v3 r; r.xy = _mm_mul_pd(a.xy, ss); r.z = _mm_mul_pd(a.z, ss); return r;
+}
+
+inline v3 vabs(const v3& a)
+{
+    const __m128d signmask = _mm_set1_pd(-0.0);
+    v3 r; r.xy = _mm_andnot_pd(signmask, a.xy); r.z = _mm_andnot_pd(signmask, a.z); return r;
+}
+
+// 3-bit mask of the lanes where !(t <= bound), NaNs count as separated like in the scalar version
+inline int separated(const v3& t, const v3& bound)
+{
+    return _mm_movemask_pd(_mm_cmpnle_pd(t.xy, bound.xy)) | ((_mm_movemask_pd(_mm_cmpnle_pd(t.z, bound.z))&1)<<2);
+}
+
+#endif
+
+}
+
+inline
+int
+obb_disjoint(PQP_REAL B[3][3], PQP_REAL T[3], PQP_REAL a[3], PQP_REAL b[3])
+{
+    using namespace pqp_sse2;
+    const PQP_REAL reps = (PQP_REAL)1e-6;
+    const v3 veps = set(reps, reps, reps);
+
+    v3 Brow[3], Bfrow[3], Bfcol[3];
+    PQP_REAL Bf[3][3];
+    for(int i = 0; i < 3; ++i) {
+        Brow[i] = load(B[i]);
+        Bfrow[i] = add(vabs(Brow[i]), veps);
+        Bfcol[i] = add(vabs(column(B, i)), veps);
+        store(Bfrow[i], Bf[i]);
+    }
+
+    v3 va = load(a), vb = load(b), vT = load(T);
+
+    // A0, A1, A2 (tests 1, 3, 4)
+    int sepA = separated(vabs(vT), add(add(add(va, scale(Bfcol[0], b[0])), scale(Bfcol[1], b[1])), scale(Bfcol[2], b[2])));
+
+    // B0, B1, B2 (tests 2, 5, 6)
+    v3 s = add(add(scale(Brow[0], T[0]), scale(Brow[1], T[1])), scale(Brow[2], T[2]));
+    int sepB = separated(vabs(s), add(add(add(vb, scale(Bfrow[0], a[0])), scale(Bfrow[1], a[1])), scale(Bfrow[2], a[2])));
+
+    // Ai x B0, Ai x B1, Ai x B2, the b terms of row i are (b1*Bf[i][2]+b2*Bf[i][1], b0*Bf[i][2]+b2*Bf[i][0], b0*Bf[i][1]+b1*Bf[i][0])
+    v3 vb1 = set(b[1], b[0], b[0]), vb2 = set(b[2], b[2], b[1]);
+
+    // A0 x Bj (tests 7, 8, 9)
+    s = sub(scale(Brow[1], T[2]), scale(Brow[2], T[1]));
+    int sepA0 = separated(vabs(s), add(add(add(scale(Bfrow[2], a[1]), scale(Bfrow[1], a[2])), mul(vb1, set(Bf[0][2], Bf[0][2], Bf[0][1]))), mul(vb2, set(Bf[0][1], Bf[0][0], Bf[0][0]))));
+
+    // A1 x Bj (tests 10, 11, 12)
+    s = sub(scale(Brow[2], T[0]), scale(Brow[0], T[2]));
+    int sepA1 = separated(vabs(s), add(add(add(scale(Bfrow[2], a[0]), scale(Bfrow[0], a[2])), mul(vb1, set(Bf[1][2], Bf[1][2], Bf[1][1]))), mul(vb2, set(Bf[1][1], Bf[1][0], Bf[1][0]))));
+
+    // A2 x Bj (tests 13, 14, 15)
+    s = sub(scale(Brow[0], T[1]), scale(Brow[1], T[0]));
+    int sepA2 = separated(vabs(s), add(add(add(scale(Bfrow[1], a[0]), scale(Bfrow[0], a[1])), mul(vb1, set(Bf[2][2], Bf[2][2], Bf[2][1]))), mul(vb2, set(Bf[2][1], Bf[2][0], Bf[2][0]))));
+
+    // bit k is set if test k+1 separates the boxes
+    int failed = (sepA&1) | ((sepB&1)<<1) | ((sepA&6)<<1) | ((sepB&6)<<3) | (sepA0<<6) | (sepA1<<9) | (sepA2<<12);
+    if( !failed ) {
+        return 0;
+    }
+    int index = 1;
+    while( !(failed&1) ) {
+        failed >>= 1;
+        ++index;
+    }
+    return index;
+}
+
+#else
+
+inline
+int
+obb_disjoint(PQP_REAL B[3][3], PQP_REAL T[3], PQP_REAL a[3], PQP_REAL b[3])
+{
+    return obb_disjoint_scalar(B,T,a,b);
+}
+
+#endif
+
 #endif
 
 
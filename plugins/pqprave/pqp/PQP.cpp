@@ -690,8 +690,8 @@ DistanceRecurse(PQP_DistanceResult *res,
             VcV(res->p1, p);   // p already in c.s. 1
             VcV(res->p2, q);   // q must be transformed
                                // into c.s. 2 later
-            o1->last_tri = t1;
-            o2->last_tri = t2;
+            res->last_tri1 = t1;
+            res->last_tri2 = t2;
         }
 
         return;
@@ -827,8 +827,8 @@ DistanceQueueRecurse(PQP_DistanceResult *res,
                 VcV(res->p1, p); // p already in c.s. 1
                 VcV(res->p2, q); // q must be transformed
                                  // into c.s. 2 later
-                o1->last_tri = t1;
-                o2->last_tri = t2;
+                res->last_tri1 = t1;
+                res->last_tri2 = t2;
             }
         }
         else if (bvtq.GetNumTests() == bvtq.GetSize() - 1)
@@ -947,7 +947,8 @@ PQP_Distance(PQP_DistanceResult *res,
              PQP_REAL R1[3][3], PQP_REAL T1[3], PQP_Model *o1,
              PQP_REAL R2[3][3], PQP_REAL T2[3], PQP_Model *o2,
              PQP_REAL rel_err, PQP_REAL abs_err,
-             int qsize)
+             int qsize, int update_last_tri,
+             int use_result_last_tri)
 {
 
     double time1 = GetTime();
@@ -972,7 +973,12 @@ PQP_Distance(PQP_DistanceResult *res,
     // provided the minimum distance
 
     PQP_REAL p[3],q[3];
-    res->distance = TriDistance(res->R,res->T,o1->last_tri,o2->last_tri,p,q);
+    if (!use_result_last_tri)
+    {
+        res->last_tri1 = o1->last_tri;
+        res->last_tri2 = o2->last_tri;
+    }
+    res->distance = TriDistance(res->R,res->T,res->last_tri1,res->last_tri2,p,q);
     VcV(res->p1,p);
     VcV(res->p2,q);
 
@@ -1021,6 +1027,12 @@ PQP_Distance(PQP_DistanceResult *res,
     VmV(u, res->p2, res->T);
     MTxV(res->p2, res->R, u);
 
+    if (update_last_tri)
+    {
+        o1->last_tri = res->last_tri1;
+        o2->last_tri = res->last_tri2;
+    }
+
     double time2 = GetTime();
     res->query_time_secs = time2 - time1;
 
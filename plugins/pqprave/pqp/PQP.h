@@ -262,6 +262,18 @@ PQP_Collide(PQP_CollideResult *result,
 //  However, a queue size of 100 to 200 has been seen to save time in a
 //  planning application with "non-coherent" placements of models.
 //
+//  "update_last_tri" controls whether the closest triangles are stored
+//  back into the models to warm start the next query. When it is 0 the
+//  models are only read, so several queries sharing a model can run on
+//  different threads. The closest triangles are still returned in
+//  result->last_tri1 and result->last_tri2.
+//
+//  "use_result_last_tri" makes the query start from result->last_tri1
+//  and result->last_tri2 instead of the last triangles stored in the
+//  models. They have to be triangles of o1 and o2. Together with
+//  update_last_tri = 0 this lets every user of a shared model keep its
+//  own warm start.
+//
 //----------------------------------------------------------------------------
 
 int
@@ -269,7 +281,8 @@ PQP_Distance(PQP_DistanceResult *result,
              PQP_REAL R1[3][3], PQP_REAL T1[3], PQP_Model *o1,
              PQP_REAL R2[3][3], PQP_REAL T2[3], PQP_Model *o2,
              PQP_REAL rel_err, PQP_REAL abs_err,
-             int qsize = 2);
+             int qsize = 2, int update_last_tri = 1,
+             int use_result_last_tri = 0);
 
 //----------------------------------------------------------------------------
 //
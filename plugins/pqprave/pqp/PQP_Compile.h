@@ -55,9 +55,16 @@
 // mainly been tested using them.  However, floats appear to be faster
 // (by 60% on some machines).
 //
+// Define PQP_SINGLE_PRECISION to use floats, the models are then half
+// the size.
+//
 //-------------------------------------------------------------------------
 
+#ifdef PQP_SINGLE_PRECISION
+typedef float PQP_REAL;
+#else
 typedef double PQP_REAL;
+#endif
 
 //-------------------------------------------------------------------------
 //
@@ -160,6 +160,11 @@ struct PQP_DistanceResult
     PQP_REAL p2[3];
     int qsize;
 
+    // closest triangles found by this query, copied back to the models'
+    // last_tri unless PQP_Distance is told not to update them
+    Tri *last_tri1;
+    Tri *last_tri2;
+
     // statistics
 
     int NumBVTests() {
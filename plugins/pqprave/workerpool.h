@@ -0,0 +1,133 @@
+// -*- coding: utf-8 -*-
+// Copyright (C) 2006-2011 Rosen Diankov <rosen.diankov@gmail.com>
+//
+// This file is part of OpenRAVE.
+// OpenRAVE is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+#ifndef OPENRAVE_PQP_WORKERPOOL_H
+#define OPENRAVE_PQP_WORKERPOOL_H
+
+#include <boost/thread/thread.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/condition.hpp>
+#include <boost/function.hpp>
+
+/// \brief persistent set of threads that evaluate a batch of independent jobs
+///
+/// The thread calling Run also evaluates jobs, so a pool of N threads only creates N-1 workers.
+class WorkerPool
+{
+public:
+    /// \param ithread index of the thread running the job in [0,GetNumThreads())
+    /// \param ijob index of the job
+    typedef boost::function<void (int ithread, int ijob)> JobFn;
+
+    WorkerPool(int numthreads) : _fn(NULL), _numjobs(0), _nextjob(0), _numfinished(0), _generation(0), _bStop(false) {
+        for(int ithread = 1; ithread < numthreads; ++ithread) {
+            _listthreads.push_back(boost::shared_ptr<boost::thread>(new boost::thread(boost::bind(&WorkerPool::_WorkerThread, this, ithread))));
+        }
+    }
+    virtual ~WorkerPool() {
+        {
+            boost::mutex::scoped_lock lock(_mutex);
+            _bStop = true;
+            _condHasWork.notify_all();
+        }
+        FOREACH(itthread, _listthreads) {
+            (*itthread)->join();
+        }
+    }
+
+    int GetNumThreads() const {
+        return (int)_listthreads.size()+1;
+    }
+
+    /// \brief calls fn for every job in [0,numjobs) and blocks until all of them are done
+    ///
+    /// fn should not throw.
+    void Run(int numjobs, const JobFn& fn)
+    {
+        if( numjobs <= 0 ) {
+            return;
+        }
+        {
+            boost::mutex::scoped_lock lock(_mutex);
+            _fn = &fn;
+            _numjobs = numjobs;
+            _nextjob = 0;
+            _numfinished = 0;
+            ++_generation;
+            _condHasWork.notify_all();
+        }
+        _DoJobs(0);
+        boost::mutex::scoped_lock lock(_mutex);
+        while(_numfinished < _numjobs) {
+            _condFinished.wait(lock);
+        }
+        _fn = NULL;
+    }
+
+private:
+    void _DoJobs(int ithread)
+    {
+        while(1) {
+            int ijob;
+            const JobFn* pfn;
+            {
+                boost::mutex::scoped_lock lock(_mutex);
+                if( _nextjob >= _numjobs ) {
+                    break;
+                }
+                ijob = _nextjob++;
+                pfn = _fn;
+            }
+            (*pfn)(ithread, ijob);
+            {
+                boost::mutex::scoped_lock lock(_mutex);
+                if( ++_numfinished >= _numjobs ) {
+                    _condFinished.notify_all();
+                }
+            }
+        }
+    }
+
+    void _WorkerThread(int ithread)
+    {
+        int generation = 0;
+        while(1) {
+            {
+                boost::mutex::scoped_lock lock(_mutex);
+                while(!_bStop && generation == _generation) {
+                    _condHasWork.wait(lock);
+                }
+                if( _bStop ) {
+                    break;
+                }
+                generation = _generation;
+            }
+            _DoJobs(ithread);
+        }
+    }
+
+    std::list<boost::shared_ptr<boost::thread> > _listthreads;
+    boost::mutex _mutex;
+    boost::condition _condHasWork, _condFinished;
+    const JobFn* _fn; ///< valid only during Run
+    int _numjobs, _nextjob, _numfinished;
+    int _generation; ///< incremented for every Run call so that workers know there is new work
+    bool _bStop;
+};
+
+typedef boost::shared_ptr<WorkerPool> WorkerPoolPtr;
+
+#endif
@@ -599,6 +599,7 @@ protected:
         dReal jitterikparam = 0;
         dReal goalsampleprob = 0.1;
         int nGoalMaxTries=10;
+        int nGoalSampleThreads=0;
         std::vector<dReal> vinitialconfig;
         while(!sinput.eof()) {
             sinput >> cmd;
@@ -735,6 +736,9 @@ protected:
             else if( cmd == "goalmaxtries" ) {
                 sinput >> nGoalMaxTries;
             }
+            else if( cmd == "goalsamplethreads" ) {
+                sinput >> nGoalSampleThreads;
+            }
             else if( cmd == "initialconfigs" ) {
                 size_t num=0;
                 sinput >> num;
@@ -787,6 +791,9 @@ protected:
         vector<dReal> vgoal;
         planningutils::ManipulatorIKGoalSampler goalsampler(pmanip, listgoals,goalsamples,nGoalMaxTries);
         goalsampler.SetJitter(jitterikparam);
+        if( nGoalSampleThreads > 0 ) {
+            goalsampler.SetParallel(nGoalSampleThreads);
+        }
         params->vgoalconfig.reserve(nSeedIkSolutions*robot->GetActiveDOF());
         while(nSeedIkSolutions > 0) {
             if( goalsampler.Sample(vgoal) ) {
@@ -74,6 +74,7 @@ Task-based manipulation planning involving target objects. A lot of the algorith
 * savepreshapetraj\n\
 * grasptranslationstepmult\n\
 * graspfinestep\n\
+* goalsamplethreads\n\
 ");
         RegisterCommand("CloseFingers",boost::bind(&TaskManipulation::ChuckFingers,this,_1,_2),
                         "Chucks the active manipulator fingers using the grasp planner along manip->GetChuckingDirection().");
@@ -374,6 +375,7 @@ protected:
         bool bRandomDests = true, bRandomGrasps = true;     // if true, permute the grasps and destinations when iterating through them
         boost::shared_ptr<ostream> pOutputTrajStream;
         int nMaxSeedGrasps = 20, nMaxSeedDests = 5, nMaxSeedIkSolutions = 0;
+        int nGoalSampleThreads = 0;
         int nMaxIterations = 4000;
         bool bQuitAfterFirstRun = false;
         dReal jitter = 0.03;
@@ -499,6 +501,9 @@ protected:
             else if( cmd == "seedik" ) {
                 sinput >> nMaxSeedIkSolutions;
             }
+            else if( cmd == "goalsamplethreads" ) {
+                sinput >> nGoalSampleThreads;
+            }
             else if( cmd == "savepreshapetraj" ) {
                 sinput >> strpreshapetraj;
             }
@@ -641,7 +646,7 @@ protected:
 
                 RAVELOG_VERBOSE(str(boost::format("planning grasps %d\n")%listGraspGoals.size()));
                 uint64_t basestart = utils::GetMicroTime();
-                ptraj = _PlanGrasp(listGraspGoals, nMaxSeedIkSolutions, goalFound, nMaxIterations,mapPreshapeTrajectories, geometrypadder, fPadding, fRRTStepLength);
+                ptraj = _PlanGrasp(listGraspGoals, nMaxSeedIkSolutions, goalFound, nMaxIterations,mapPreshapeTrajectories, geometrypadder, fPadding, fRRTStepLength, nGoalSampleThreads);
                 nSearchTime += utils::GetMicroTime() - basestart;
 
                 if( !!ptraj || bQuitAfterFirstRun ) {
@@ -1013,7 +1018,7 @@ protected:
             if( (int)listGraspGoals.size() >= nMaxSeedGrasps ) {
                 RAVELOG_VERBOSE(str(boost::format("planning grasps %d\n")%listGraspGoals.size()));
                 uint64_t basestart = utils::GetMicroTime();
-                ptraj = _PlanGrasp(listGraspGoals, nMaxSeedGrasps, goalFound, nMaxIterations,mapPreshapeTrajectories, geometrypadder, fPadding, fRRTStepLength);
+                ptraj = _PlanGrasp(listGraspGoals, nMaxSeedGrasps, goalFound, nMaxIterations,mapPreshapeTrajectories, geometrypadder, fPadding, fRRTStepLength, nGoalSampleThreads);
                 nSearchTime += utils::GetMicroTime() - basestart;
                 if( bQuitAfterFirstRun ) {
                     break;
@@ -1031,7 +1036,7 @@ protected:
             //TODO have to update ptrajToPreshape
             RAVELOG_VERBOSE(str(boost::format("planning grasps %d\n")%listGraspGoals.size()));
             uint64_t basestart = utils::GetMicroTime();
-            ptraj = _PlanGrasp(listGraspGoals, nMaxSeedGrasps, goalFound, nMaxIterations,mapPreshapeTrajectories, geometrypadder, fPadding, fRRTStepLength);
+            ptraj = _PlanGrasp(listGraspGoals, nMaxSeedGrasps, goalFound, nMaxIterations,mapPreshapeTrajectories, geometrypadder, fPadding, fRRTStepLength, nGoalSampleThreads);
             nSearchTime += utils::GetMicroTime() - basestart;
         }
 
@@ -1515,7 +1520,7 @@ protected:
     }
 
     /// \brief grasps using the list of grasp goals. Removes all the goals that the planner planned with
-    TrajectoryBasePtr _PlanGrasp(list<GRASPGOAL>&listGraspGoals, int nSeedIkSolutions, GRASPGOAL& goalfound, int nMaxIterations,PRESHAPETRAJMAP& mapPreshapeTrajectories, GeometryGroupSaver& geometrypadder, dReal fPadding, dReal fRRTStepLength)
+    TrajectoryBasePtr _PlanGrasp(list<GRASPGOAL>&listGraspGoals, int nSeedIkSolutions, GRASPGOAL& goalfound, int nMaxIterations,PRESHAPETRAJMAP& mapPreshapeTrajectories, GeometryGroupSaver& geometrypadder, dReal fPadding, dReal fRRTStepLength, int nGoalSampleThreads=0)
     {
         RobotBase::ManipulatorConstPtr pmanip = _robot->GetActiveManipulator();
         TrajectoryBasePtr ptraj;
@@ -1575,6 +1580,9 @@ protected:
             listgoals.push_back(itgoal->tgrasp);
         }
         planningutils::ManipulatorIKGoalSampler goalsampler(pmanip, listgoals, 20, 100);
+        if( nGoalSampleThreads > 0 ) {
+            goalsampler.SetParallel(nGoalSampleThreads);
+        }
 
         int nGoalIndex = -1;
         ptraj = _MoveArm(pmanip->GetArmIndices(), goalsampler, nGoalIndex, nMaxIterations, fPadding, fRRTStepLength);
@@ -552,6 +552,37 @@ public:
         return boost::python::make_tuple(static_cast<numeric::array>(handle<>(pycollision)),static_cast<numeric::array>(handle<>(pypos)));
     }
 
+    object CheckCollisionBatch(object olinkbodypairs)
+    {
+        int num = len(olinkbodypairs);
+        std::vector<std::pair<KinBody::LinkConstPtr, KinBodyConstPtr> > vqueries(num);
+        for(int i = 0; i < num; ++i) {
+            vqueries[i].first = openravepy::GetKinBodyLinkConst(object(olinkbodypairs[i][0]));
+            vqueries[i].second = openravepy::GetKinBody(object(olinkbodypairs[i][1]));
+            if( !vqueries[i].first || !vqueries[i].second ) {
+                throw OPENRAVE_EXCEPTION_FORMAT("pair %d needs to be a (link, body) pair", i, ORE_InvalidArguments);
+            }
+        }
+        std::vector<uint8_t> vresults;
+        _pCollisionChecker->CheckCollisionBatch(vqueries, vresults);
+        npy_intp dims[] = { num };
+        PyObject* pycollision = PyArray_SimpleNew(1,dims, PyArray_BOOL);
+        bool* pcollision = (bool*)PyArray_DATA(pycollision);
+        for(int i = 0; i < num; ++i) {
+            pcollision[i] = vresults.at(i) != 0;
+        }
+        return static_cast<numeric::array>(handle<>(pycollision));
+    }
+
+    object CheckContinuousCollision(PyKinBodyPtr pbody, object odofvalues0, object odofvalues1, dReal ftolerance, PyCollisionReportPtr pReport=PyCollisionReportPtr())
+    {
+        CHECK_POINTER(pbody);
+        dReal fcollisiontime = 0;
+        int ret = _pCollisionChecker->CheckContinuousCollision(openravepy::GetKinBody(pbody), ExtractArray<dReal>(odofvalues0), ExtractArray<dReal>(odofvalues1), ftolerance, fcollisiontime, openravepy::GetCollisionReport(pReport));
+        openravepy::UpdateCollisionReport(pReport,_pyenv);
+        return boost::python::make_tuple(ret, fcollisiontime);
+    }
+
     bool CheckCollision(boost::shared_ptr<PyRay> pyray)
     {
         return _pCollisionChecker->CheckCollision(pyray->r);
@@ -645,6 +676,7 @@ PyCollisionCheckerBasePtr RaveCreateCollisionChecker(PyEnvironmentBasePtr pyenv,
 }
 
 BOOST_PYTHON_MEMBER_FUNCTION_OVERLOADS(CheckCollisionRays_overloads, CheckCollisionRays, 2, 3)
+BOOST_PYTHON_MEMBER_FUNCTION_OVERLOADS(CheckContinuousCollision_overloads, CheckContinuousCollision, 4, 5)
 
 void init_openravepy_collisionchecker()
 {
@@ -730,6 +762,10 @@ void init_openravepy_collisionchecker()
     .def("CheckCollisionRays",&PyCollisionCheckerBase::CheckCollisionRays,
          CheckCollisionRays_overloads(args("rays","body","front_facing_only"),
                                       "Check if any rays hit the body and returns their contact points along with a vector specifying if a collision occured or not. Rays is a Nx6 array, first 3 columsn are position, last 3 are direction+range."))
+    .def("CheckCollisionBatch",&PyCollisionCheckerBase::CheckCollisionBatch,args("linkbodypairs"), DOXY_FN(CollisionCheckerBase,CheckCollisionBatch))
+    .def("CheckContinuousCollision",&PyCollisionCheckerBase::CheckContinuousCollision,
+         CheckContinuousCollision_overloads(args("body","dofvalues0","dofvalues1","tolerance","report"),
+                                            DOXY_FN(CollisionCheckerBase,CheckContinuousCollision)))
     ;
 
     def("RaveCreateCollisionChecker",openravepy::RaveCreateCollisionChecker,args("env","name"),DOXY_FN1(RaveCreateCollisionChecker));
@@ -285,6 +285,37 @@ inline RaveTransformMatrix<T> ExtractTransformMatrixType(const object& o)
     return t;
 }
 
+/// \brief returns the data of a c-contiguous writeable numpy array of type arraytype with numelements elements
+///
+/// Used by the *Into functions that fill caller provided arrays. The data can be written after the GIL is released since
+/// the caller holds a reference to the array.
+inline void* ExtractWriteableArrayData(const object& o, int arraytype, size_t numelements)
+{
+    if( !PyArray_Check(o.ptr()) ) {
+        throw OPENRAVE_EXCEPTION_FORMAT0("output has to be a numpy array", ORE_InvalidArguments);
+    }
+    PyArrayObject* pyarray = (PyArrayObject*)o.ptr();
+    if( PyArray_TYPE(pyarray) != arraytype || !PyArray_ISCARRAY(pyarray) ) {
+        throw OPENRAVE_EXCEPTION_FORMAT0("output has to be a c-contiguous and writeable numpy array of the correct type", ORE_InvalidArguments);
+    }
+    if( (size_t)PyArray_SIZE(pyarray) != numelements ) {
+        throw OPENRAVE_EXCEPTION_FORMAT("output has %d elements, expected %d", (size_t)PyArray_SIZE(pyarray)%numelements, ORE_InvalidArguments);
+    }
+    return PyArray_DATA(pyarray);
+}
+
+/// \brief converts o to a c-contiguous numpy array of type arraytype, does not copy if o is already one
+///
+/// The cast is forced so that the default 64bit integer arrays of numpy can be passed as int indices.
+inline object toContiguousPyArray(const object& o, int arraytype)
+{
+    PyObject* pyarray = PyArray_FromAny(o.ptr(), PyArray_DescrFromType(arraytype), 0, 0, NPY_DEFAULT|NPY_FORCECAST, NULL);
+    if( pyarray == NULL ) {
+        throw_error_already_set();
+    }
+    return object(handle<>(pyarray));
+}
+
 inline object toPyArrayRotation(const TransformMatrix& t)
 {
     npy_intp dims[] = {3,3};
@@ -72,7 +72,7 @@ public:
         _vGeomData = toPyVector4(info._vGeomData);
         _vDiffuseColor = toPyVector3(info._vDiffuseColor);
         _vAmbientColor = toPyVector3(info._vAmbientColor);
-        _meshcollision = toPyTriMesh(info._meshcollision);
+        _meshcollision = toPyTriMesh(info.GetCollisionMesh());
         _type = info._type;
         _filenamerender = ConvertStringToUnicode(info._filenamerender);
         _filenamecollision = ConvertStringToUnicode(info._filenamecollision);
@@ -666,6 +666,24 @@ public:
     object GetCollisionData() {
         return toPyTriMesh(_plink->GetCollisionData());
     }
+    object GetSphereTree() const {
+        KinBody::Link::SphereTreeConstPtr spheretree = _plink->GetSphereTree();
+        if( !spheretree ) {
+            return object();
+        }
+        std::vector<dReal> vspheres(4*spheretree->spheres.size());
+        for(size_t i = 0; i < spheretree->spheres.size(); ++i) {
+            for(int j = 0; j < 4; ++j) {
+                vspheres[4*i+j] = spheretree->spheres[i][j];
+            }
+        }
+        std::vector<npy_intp> dims(2); dims[0] = spheretree->spheres.size(); dims[1] = 4;
+        boost::python::list ochildren;
+        FOREACHC(itchildren, spheretree->children) {
+            ochildren.append(boost::python::make_tuple(itchildren->first, itchildren->second));
+        }
+        return boost::python::make_tuple(toPyArrayN(vspheres.size() > 0 ? &vspheres[0] : NULL, dims), ochildren, toPyArray(spheretree->leaves));
+    }
     object ComputeLocalAABB() const { // TODO object otransform=object()
         //if( IS_PYTHONOBJECT_NONE(otransform) ) {
         return toPyAABB(_plink->ComputeLocalAABB());
@@ -766,7 +784,8 @@ public:
     object GetGeometriesFromGroup(const std::string& name)
     {
         boost::python::list ogeometryinfos;
-        FOREACHC(itinfo, _plink->GetGeometriesFromGroup(name)) {
+        std::vector<KinBody::GeometryInfoPtr> vgeometryinfos = _plink->GetGeometriesFromGroup(name);
+        FOREACHC(itinfo, vgeometryinfos) {
             ogeometryinfos.append(PyGeometryInfoPtr(new PyGeometryInfo(**itinfo)));
         }
         return ogeometryinfos;
@@ -1238,6 +1257,44 @@ public:
 };
 typedef boost::shared_ptr<PyKinBodyStateSaver> PyKinBodyStateSaverPtr;
 
+/// \brief holds a KinBody::ChangeCallbackSuspender between __enter__ and __exit__
+class PyChangeCallbackSuspender
+{
+    KinBodyPtr _pbody;
+    boost::shared_ptr<KinBody::ChangeCallbackSuspender> _suspender;
+public:
+    PyChangeCallbackSuspender(KinBodyPtr pbody) : _pbody(pbody) {
+    }
+    virtual ~PyChangeCallbackSuspender() {
+    }
+    void __enter__() {
+        if( !_suspender ) {
+            _suspender.reset(new KinBody::ChangeCallbackSuspender(_pbody));
+        }
+    }
+    void __exit__(object type, object value, object traceback) {
+        Close();
+    }
+    /// \brief resumes the callbacks, the accumulated changes are dispatched
+    void Close() {
+        _suspender.reset();
+    }
+};
+typedef boost::shared_ptr<PyChangeCallbackSuspender> PyChangeCallbackSuspenderPtr;
+
+static void _ChangeCallback(object fncallback)
+{
+    PyGILState_STATE gstate = PyGILState_Ensure();
+    try {
+        fncallback();
+    }
+    catch(...) {
+        RAVELOG_ERROR("exception occured in python change callback:\n");
+        PyErr_Print();
+    }
+    PyGILState_Release(gstate);
+}
+
 class PyManageData
 {
     KinBody::ManageDataPtr _pdata;
@@ -1433,6 +1490,45 @@ object PyKinBody::GetDOFValues(object oindices) const
     return toPyArray(values);
 }
 
+void PyKinBody::GetDOFValuesInto(object oout, object oindices, bool releasegil) const
+{
+    // the indices are only copied if they are not already a contiguous int array
+    object oindicesarray;
+    const int* pindices = NULL;
+    size_t numvalues = (size_t)_pbody->GetDOF();
+    if( !IS_PYTHONOBJECT_NONE(oindices) ) {
+        oindicesarray = toContiguousPyArray(oindices, PyArray_INT);
+        if( PyArray_SIZE((PyArrayObject*)oindicesarray.ptr()) > 0 ) {
+            pindices = (const int*)PyArray_DATA((PyArrayObject*)oindicesarray.ptr());
+            numvalues = PyArray_SIZE((PyArrayObject*)oindicesarray.ptr());
+            for(size_t i = 0; i < numvalues; ++i) {
+                if( pindices[i] < 0 || pindices[i] >= _pbody->GetDOF() ) {
+                    throw OPENRAVE_EXCEPTION_FORMAT("bad dof index %d, body has %d dofs", pindices[i]%_pbody->GetDOF(), ORE_InvalidArguments);
+                }
+            }
+        }
+    }
+    dReal* pout = (dReal*)ExtractWriteableArrayData(oout, sizeof(dReal)==8 ? PyArray_DOUBLE : PyArray_FLOAT, numvalues);
+    openravepy::PythonThreadSaverPtr statesaver;
+    if( releasegil ) {
+        statesaver.reset(new openravepy::PythonThreadSaver());
+    }
+    // write each value directly into the array instead of going through KinBody::GetDOFValues
+    if( !!pindices ) {
+        for(size_t i = 0; i < numvalues; ++i) {
+            KinBody::JointPtr pjoint = _pbody->GetJointFromDOFIndex(pindices[i]);
+            pout[i] = pjoint->GetValue(pindices[i]-pjoint->GetDOFIndex());
+        }
+    }
+    else {
+        FOREACHC(itjoint, _pbody->GetJoints()) {
+            for(int iaxis = 0; iaxis < (*itjoint)->GetDOF(); ++iaxis) {
+                pout[(*itjoint)->GetDOFIndex()+iaxis] = (*itjoint)->GetValue(iaxis);
+            }
+        }
+    }
+}
+
 object PyKinBody::GetDOFVelocities() const
 {
     vector<dReal> values;
@@ -1789,6 +1885,42 @@ object PyKinBody::GetLinkTransformations(bool returndoflastvlaues) const
     return otransforms;
 }
 
+void PyKinBody::GetLinkTransformationsInto(object oout, bool releasegil) const
+{
+    const std::vector<KinBody::LinkPtr>& vlinks = _pbody->GetLinks();
+    if( !PyArray_Check(oout.ptr()) ) {
+        throw OPENRAVE_EXCEPTION_FORMAT0("output has to be a numpy array", ORE_InvalidArguments);
+    }
+    // Nx4x4 matrices or Nx7 poses [qw,qx,qy,qz,x,y,z], the shape decides which one is written
+    PyArrayObject* pyout = (PyArrayObject*)oout.ptr();
+    bool bmatrix = PyArray_NDIM(pyout) == 3 && (size_t)PyArray_DIM(pyout,0) == vlinks.size() && PyArray_DIM(pyout,1) == 4 && PyArray_DIM(pyout,2) == 4;
+    bool bpose = PyArray_NDIM(pyout) == 2 && (size_t)PyArray_DIM(pyout,0) == vlinks.size() && PyArray_DIM(pyout,1) == 7;
+    if( !bmatrix && !bpose ) {
+        throw OPENRAVE_EXCEPTION_FORMAT("output has to have shape (%d,4,4) or (%d,7)", vlinks.size()%vlinks.size(), ORE_InvalidArguments);
+    }
+    dReal* pout = (dReal*)ExtractWriteableArrayData(oout, sizeof(dReal)==8 ? PyArray_DOUBLE : PyArray_FLOAT, (bmatrix ? 16 : 7)*vlinks.size());
+    openravepy::PythonThreadSaverPtr statesaver;
+    if( releasegil ) {
+        statesaver.reset(new openravepy::PythonThreadSaver());
+    }
+    FOREACHC(itlink, vlinks) {
+        Transform t = (*itlink)->GetTransform();
+        if( bmatrix ) {
+            TransformMatrix m(t);
+            for(int i = 0; i < 3; ++i) {
+                pout[4*i+0] = m.m[4*i+0]; pout[4*i+1] = m.m[4*i+1]; pout[4*i+2] = m.m[4*i+2]; pout[4*i+3] = m.trans[i];
+            }
+            pout[12] = 0; pout[13] = 0; pout[14] = 0; pout[15] = 1;
+            pout += 16;
+        }
+        else {
+            pout[0] = t.rot.x; pout[1] = t.rot.y; pout[2] = t.rot.z; pout[3] = t.rot.w;
+            pout[4] = t.trans.x; pout[5] = t.trans.y; pout[6] = t.trans.z;
+            pout += 7;
+        }
+    }
+}
+
 void PyKinBody::SetLinkTransformations(object transforms, object odoflastvalues)
 {
     size_t numtransforms = len(transforms);
@@ -2154,6 +2286,18 @@ object PyKinBody::ComputeJacobianAxisAngle(int index, object oindices)
     return toPyArray(vjacobian,dims);
 }
 
+object PyKinBody::ComputeJacobianTranslationAxisAngle(int index, object oposition, object oindices)
+{
+    vector<int> vindices;
+    if( !IS_PYTHONOBJECT_NONE(oindices) ) {
+        vindices = ExtractArray<int>(oindices);
+    }
+    std::vector<dReal> vjacobian;
+    _pbody->ComputeJacobianTranslationAxisAngle(index,ExtractVector3(oposition),vjacobian,vindices);
+    std::vector<npy_intp> dims(2); dims[0] = 6; dims[1] = vjacobian.size()/6;
+    return toPyArray(vjacobian,dims);
+}
+
 object PyKinBody::CalculateJacobian(int index, object oposition)
 {
     std::vector<dReal> vjacobian;
@@ -2234,6 +2378,36 @@ object PyKinBody::ComputeInverseDynamics(object odofaccelerations, object oexter
     }
 }
 
+/// \brief copies the values of a python array of any shape into v
+static void _ExtractFlatArray(object o, std::vector<dReal>& v)
+{
+    if( IS_PYTHONOBJECT_NONE(o) ) {
+        v.resize(0);
+        return;
+    }
+    object oarray = toContiguousPyArray(o, sizeof(dReal)==8 ? PyArray_DOUBLE : PyArray_FLOAT);
+    const dReal* pvalues = (const dReal*)PyArray_DATA((PyArrayObject*)oarray.ptr());
+    v.resize((size_t)PyArray_SIZE((PyArrayObject*)oarray.ptr()));
+    std::copy(pvalues, pvalues+v.size(), v.begin());
+}
+
+object PyKinBody::ComputeInverseDynamicsBatch(object odofvalues, object odofvelocities, object odofaccelerations, bool releasegil)
+{
+    std::vector<dReal> vdofvalues, vdofvelocities, vdofaccelerations, vdoftorques;
+    _ExtractFlatArray(odofvalues, vdofvalues);
+    _ExtractFlatArray(odofvelocities, vdofvelocities);
+    _ExtractFlatArray(odofaccelerations, vdofaccelerations);
+    {
+        openravepy::PythonThreadSaverPtr statesaver;
+        if( releasegil ) {
+            statesaver.reset(new openravepy::PythonThreadSaver());
+        }
+        _pbody->ComputeInverseDynamicsBatch(vdoftorques, vdofvalues, vdofvelocities, vdofaccelerations);
+    }
+    std::vector<npy_intp> dims(2); dims[0] = _pbody->GetDOF() > 0 ? vdoftorques.size()/_pbody->GetDOF() : 0; dims[1] = _pbody->GetDOF();
+    return toPyArray(vdoftorques,dims);
+}
+
 void PyKinBody::SetSelfCollisionChecker(PyCollisionCheckerBasePtr pycollisionchecker)
 {
     _pbody->SetSelfCollisionChecker(openravepy::GetCollisionChecker(pycollisionchecker));
@@ -2251,6 +2425,43 @@ bool PyKinBody::CheckSelfCollision(PyCollisionReportPtr pReport, PyCollisionChec
     return bCollision;
 }
 
+object PyKinBody::CheckCollisionBatch(object oconfigs, object oout, object oindices, bool checkself, bool releasegil)
+{
+    vector<int> vindices;
+    if( !IS_PYTHONOBJECT_NONE(oindices) ) {
+        vindices = ExtractArray<int>(oindices);
+    }
+    size_t dof = vindices.size() > 0 ? vindices.size() : (size_t)_pbody->GetDOF();
+    object oarray = toContiguousPyArray(oconfigs, sizeof(dReal)==8 ? PyArray_DOUBLE : PyArray_FLOAT);
+    size_t numvalues = (size_t)PyArray_SIZE((PyArrayObject*)oarray.ptr());
+    if( dof == 0 || (numvalues % dof) != 0 ) {
+        throw OPENRAVE_EXCEPTION_FORMAT("configurations have %d values, which is not a multiple of %d", numvalues%dof, ORE_InvalidArguments);
+    }
+    size_t numconfigs = numvalues/dof;
+    if( IS_PYTHONOBJECT_NONE(oout) ) {
+        npy_intp dims[] = { npy_intp(numconfigs) };
+        oout = object(handle<>(PyArray_SimpleNew(1,dims, PyArray_UINT8)));
+    }
+    uint8_t* pout = (uint8_t*)ExtractWriteableArrayData(oout, PyArray_UINT8, numconfigs);
+    const dReal* pconfigs = (const dReal*)PyArray_DATA((PyArrayObject*)oarray.ptr());
+    {
+        // the GIL has to be reacquired before returning oout since returning copies the python object
+        openravepy::PythonThreadSaverPtr statesaver;
+        if( releasegil ) {
+            statesaver.reset(new openravepy::PythonThreadSaver());
+        }
+        KinBody::KinBodyStateSaver saver(_pbody);
+        EnvironmentBasePtr penv = _pbody->GetEnv();
+        vector<dReal> values(dof);
+        for(size_t i = 0; i < numconfigs; ++i) {
+            std::copy(pconfigs+i*dof, pconfigs+(i+1)*dof, values.begin());
+            _pbody->SetDOFValues(values, KinBody::CLA_CheckLimits, vindices);
+            pout[i] = penv->CheckCollision(KinBodyConstPtr(_pbody)) || (checkself && _pbody->CheckSelfCollision());
+        }
+    }
+    return oout;
+}
+
 bool PyKinBody::IsAttached(PyKinBodyPtr pattachbody)
 {
     CHECK_POINTER(pattachbody);
@@ -2387,6 +2598,23 @@ string PyKinBody::GetKinematicsGeometryHash() const
     return _pbody->GetKinematicsGeometryHash();
 }
 
+object PyKinBody::RegisterChangeCallback(object oproperties, object fncallback) const
+{
+    if( !fncallback ) {
+        throw openrave_exception("callback not specified");
+    }
+    UserDataPtr p = _pbody->RegisterChangeCallback(pyGetIntFromPy(oproperties,0), boost::bind(_ChangeCallback,fncallback));
+    if( !p ) {
+        throw openrave_exception("registration handle is NULL");
+    }
+    return openravepy::GetUserData(p);
+}
+
+object PyKinBody::CreateChangeCallbackSuspender()
+{
+    return object(PyChangeCallbackSuspenderPtr(new PyChangeCallbackSuspender(_pbody)));
+}
+
 PyStateRestoreContextBase* PyKinBody::CreateKinBodyStateSaver(object options)
 {
     PyKinBodyStateSaverPtr saver;
@@ -2688,9 +2916,11 @@ BOOST_PYTHON_MEMBER_FUNCTION_OVERLOADS(SetDOFLimits_overloads, SetDOFLimits, 2,
 BOOST_PYTHON_MEMBER_FUNCTION_OVERLOADS(SubtractDOFValues_overloads, SubtractDOFValues, 2, 3)
 BOOST_PYTHON_MEMBER_FUNCTION_OVERLOADS(ComputeJacobianTranslation_overloads, ComputeJacobianTranslation, 2, 3)
 BOOST_PYTHON_MEMBER_FUNCTION_OVERLOADS(ComputeJacobianAxisAngle_overloads, ComputeJacobianAxisAngle, 1, 2)
+BOOST_PYTHON_MEMBER_FUNCTION_OVERLOADS(ComputeJacobianTranslationAxisAngle_overloads, ComputeJacobianTranslationAxisAngle, 2, 3)
 BOOST_PYTHON_MEMBER_FUNCTION_OVERLOADS(ComputeHessianTranslation_overloads, ComputeHessianTranslation, 2, 3)
 BOOST_PYTHON_MEMBER_FUNCTION_OVERLOADS(ComputeHessianAxisAngle_overloads, ComputeHessianAxisAngle, 1, 2)
 BOOST_PYTHON_MEMBER_FUNCTION_OVERLOADS(ComputeInverseDynamics_overloads, ComputeInverseDynamics, 1, 3)
+BOOST_PYTHON_MEMBER_FUNCTION_OVERLOADS(ComputeInverseDynamicsBatch_overloads, ComputeInverseDynamicsBatch, 1, 4)
 BOOST_PYTHON_MEMBER_FUNCTION_OVERLOADS(Restore_overloads, Restore, 0,1)
 BOOST_PYTHON_MEMBER_FUNCTION_OVERLOADS(CreateKinBodyStateSaver_overloads, CreateKinBodyStateSaver, 0,1)
 BOOST_PYTHON_MEMBER_FUNCTION_OVERLOADS(SetConfigurationValues_overloads, SetConfigurationValues, 1,2)
@@ -2698,6 +2928,9 @@ BOOST_PYTHON_MEMBER_FUNCTION_OVERLOADS(GetFloatParameters_overloads, GetFloatPar
 BOOST_PYTHON_MEMBER_FUNCTION_OVERLOADS(GetIntParameters_overloads, GetIntParameters, 0, 2)
 BOOST_PYTHON_MEMBER_FUNCTION_OVERLOADS(GetStringParameters_overloads, GetStringParameters, 0, 1)
 BOOST_PYTHON_MEMBER_FUNCTION_OVERLOADS(CheckSelfCollision_overloads, CheckSelfCollision, 0, 2)
+BOOST_PYTHON_MEMBER_FUNCTION_OVERLOADS(CheckCollisionBatch_overloads, CheckCollisionBatch, 1, 5)
+BOOST_PYTHON_MEMBER_FUNCTION_OVERLOADS(GetDOFValuesInto_overloads, GetDOFValuesInto, 1, 3)
+BOOST_PYTHON_MEMBER_FUNCTION_OVERLOADS(GetLinkTransformationsInto_overloads, GetLinkTransformationsInto, 1, 2)
 BOOST_PYTHON_MEMBER_FUNCTION_OVERLOADS(GetLinkAccelerations_overloads, GetLinkAccelerations, 1, 2)
 BOOST_PYTHON_MEMBER_FUNCTION_OVERLOADS(InitCollisionMesh_overloads, InitCollisionMesh, 0, 1)
 BOOST_PYTHON_MEMBER_FUNCTION_OVERLOADS(InitFromBoxes_overloads, InitFromBoxes, 1, 3)
@@ -2787,6 +3020,7 @@ void init_openravepy_kinbody()
                         .def("GetDOF",&PyKinBody::GetDOF,DOXY_FN(KinBody,GetDOF))
                         .def("GetDOFValues",getdofvalues1,DOXY_FN(KinBody,GetDOFValues))
                         .def("GetDOFValues",getdofvalues2,args("indices"),DOXY_FN(KinBody,GetDOFValues))
+                        .def("GetDOFValuesInto",&PyKinBody::GetDOFValuesInto,GetDOFValuesInto_overloads(args("out","indices","releasegil"), "Writes the dof values into the preallocated contiguous array **out** without allocating new python objects.\n\n:param out: numpy array of dof values with the same type as dReal\n:param indices: optional dof indices\n:param releasegil: if True, releases the GIL while copying"))
                         .def("GetDOFVelocities",getdofvelocities1, DOXY_FN(KinBody,GetDOFVelocities))
                         .def("GetDOFVelocities",getdofvelocities2, args("indices"), DOXY_FN(KinBody,GetDOFVelocities))
                         .def("GetDOFLimits",getdoflimits1, DOXY_FN(KinBody,GetDOFLimits))
@@ -2828,6 +3062,7 @@ void init_openravepy_kinbody()
                         .def("GetTransformPose",&PyKinBody::GetTransformPose, DOXY_FN(KinBody,GetTransform))
                         .def("GetLinkTransformations",&PyKinBody::GetLinkTransformations, GetLinkTransformations_overloads(args("returndoflastvlaues"), DOXY_FN(KinBody,GetLinkTransformations)))
                         .def("GetBodyTransformations",&PyKinBody::GetLinkTransformations, DOXY_FN(KinBody,GetLinkTransformations))
+                        .def("GetLinkTransformationsInto",&PyKinBody::GetLinkTransformationsInto, GetLinkTransformationsInto_overloads(args("out","releasegil"), "Writes the link transformations into the preallocated contiguous array **out**.\n\n:param out: array of shape (N,4,4) for matrices or (N,7) for poses [qw,qx,qy,qz,x,y,z] where N is the number of links, has to have the same type as dReal\n:param releasegil: if True, releases the GIL while filling the array"))
                         .def("SetLinkTransformations",&PyKinBody::SetLinkTransformations,SetLinkTransformations_overloads(args("transforms","doflastsetvalues"), DOXY_FN(KinBody,SetLinkTransformations)))
                         .def("SetBodyTransformations",&PyKinBody::SetLinkTransformations,args("transforms"), DOXY_FN(KinBody,SetLinkTransformations))
                         .def("SetLinkVelocities",&PyKinBody::SetLinkVelocities,args("velocities"), DOXY_FN(KinBody,SetLinkVelocities))
@@ -2860,15 +3095,18 @@ void init_openravepy_kinbody()
                         .def("SetTransformWithDOFValues",&PyKinBody::SetTransformWithDOFValues,args("transform","values"), DOXY_FN(KinBody,SetDOFValues "const std::vector; const Transform; uint32_t"))
                         .def("ComputeJacobianTranslation",&PyKinBody::ComputeJacobianTranslation,ComputeJacobianTranslation_overloads(args("linkindex","position","indices"), DOXY_FN(KinBody,ComputeJacobianTranslation)))
                         .def("ComputeJacobianAxisAngle",&PyKinBody::ComputeJacobianAxisAngle,ComputeJacobianAxisAngle_overloads(args("linkindex","indices"), DOXY_FN(KinBody,ComputeJacobianAxisAngle)))
+                        .def("ComputeJacobianTranslationAxisAngle",&PyKinBody::ComputeJacobianTranslationAxisAngle,ComputeJacobianTranslationAxisAngle_overloads(args("linkindex","position","indices"), DOXY_FN(KinBody,ComputeJacobianTranslationAxisAngle)))
                         .def("CalculateJacobian",&PyKinBody::CalculateJacobian,args("linkindex","position"), DOXY_FN(KinBody,CalculateJacobian "int; const Vector; std::vector"))
                         .def("CalculateRotationJacobian",&PyKinBody::CalculateRotationJacobian,args("linkindex","quat"), DOXY_FN(KinBody,CalculateRotationJacobian "int; const Vector; std::vector"))
                         .def("CalculateAngularVelocityJacobian",&PyKinBody::CalculateAngularVelocityJacobian,args("linkindex"), DOXY_FN(KinBody,CalculateAngularVelocityJacobian "int; std::vector"))
                         .def("ComputeHessianTranslation",&PyKinBody::ComputeHessianTranslation,ComputeHessianTranslation_overloads(args("linkindex","position","indices"), DOXY_FN(KinBody,ComputeHessianTranslation)))
                         .def("ComputeHessianAxisAngle",&PyKinBody::ComputeHessianAxisAngle,ComputeHessianAxisAngle_overloads(args("linkindex","indices"), DOXY_FN(KinBody,ComputeHessianAxisAngle)))
                         .def("ComputeInverseDynamics",&PyKinBody::ComputeInverseDynamics, ComputeInverseDynamics_overloads(args("dofaccelerations","externalforcetorque","returncomponents"), sComputeInverseDynamicsDoc.c_str()))
+                        .def("ComputeInverseDynamicsBatch",&PyKinBody::ComputeInverseDynamicsBatch, ComputeInverseDynamicsBatch_overloads(args("dofvalues","dofvelocities","dofaccelerations","releasegil"), "Computes the torques of many states without changing the body.\n\n:param dofvalues: MxN array of dof values, N is the body dof\n:param dofvelocities: optional MxN array of dof velocities, 0 if None\n:param dofaccelerations: optional MxN array of dof accelerations, 0 if None\n:param releasegil: if True, releases the GIL while computing\n:return: MxN array of torques"))
                         .def("SetSelfCollisionChecker",&PyKinBody::SetSelfCollisionChecker,args("collisionchecker"), DOXY_FN(KinBody,SetSelfCollisionChecker))
                         .def("GetSelfCollisionChecker",&PyKinBody::GetSelfCollisionChecker,args("collisionchecker"), DOXY_FN(KinBody,GetSelfCollisionChecker))
                         .def("CheckSelfCollision",&PyKinBody::CheckSelfCollision, CheckSelfCollision_overloads(args("report","collisionchecker"), DOXY_FN(KinBody,CheckSelfCollision)))
+                        .def("CheckCollisionBatch",&PyKinBody::CheckCollisionBatch, CheckCollisionBatch_overloads(args("configs","out","indices","checkself","releasegil"), "Checks a batch of configurations for environment and self collisions, the body state is restored afterwards. The environment has to be locked by the caller. To check in parallel, call from several python threads each using its own (cloned) environment.\n\n:param configs: MxD array of dof values, D is the number of indices or the body dof\n:param out: optional preallocated uint8 array of size M\n:param indices: optional dof indices the configurations correspond to\n:param checkself: if True, also checks self collision\n:param releasegil: if True, releases the GIL while checking\n:return: uint8 array of size M, 1 where the configuration is in collision"))
                         .def("IsAttached",&PyKinBody::IsAttached,args("body"), DOXY_FN(KinBody,IsAttached))
                         .def("GetAttached",&PyKinBody::GetAttached, DOXY_FN(KinBody,GetAttached))
                         .def("SetZeroConfiguration",&PyKinBody::SetZeroConfiguration, DOXY_FN(KinBody,SetZeroConfiguration))
@@ -2894,6 +3132,8 @@ void init_openravepy_kinbody()
                         .def("GetUpdateStamp",&PyKinBody::GetUpdateStamp, DOXY_FN(KinBody,GetUpdateStamp))
                         .def("serialize",&PyKinBody::serialize,args("options"), DOXY_FN(KinBody,serialize))
                         .def("GetKinematicsGeometryHash",&PyKinBody::GetKinematicsGeometryHash, DOXY_FN(KinBody,GetKinematicsGeometryHash))
+                        .def("RegisterChangeCallback",&PyKinBody::RegisterChangeCallback, args("properties","callback"), DOXY_FN(KinBody,RegisterChangeCallback))
+                        .def("CreateChangeCallbackSuspender",&PyKinBody::CreateChangeCallbackSuspender, "Creates an object that suspends the change callbacks of the body while it is entered using 'with', see KinBody::ChangeCallbackSuspender")
                         .def("CreateKinBodyStateSaver",&PyKinBody::CreateKinBodyStateSaver, CreateKinBodyStateSaver_overloads(args("options"), "Creates an object that can be entered using 'with' and returns a KinBodyStateSaver")[return_value_policy<manage_new_object>()])
                         .def("__enter__",&PyKinBody::__enter__)
                         .def("__exit__",&PyKinBody::__exit__)
@@ -2913,6 +3153,29 @@ void init_openravepy_kinbody()
         .value("GrabbedBodies",KinBody::Save_GrabbedBodies)
         .value("ActiveManipulatorToolTransform",KinBody::Save_ActiveManipulatorToolTransform)
         ;
+        enum_<KinBody::KinBodyProperty>("KinBodyProperty" DOXY_ENUM(KinBodyProperty))
+        .value("JointMimic",KinBody::Prop_JointMimic)
+        .value("JointLimits",KinBody::Prop_JointLimits)
+        .value("JointOffset",KinBody::Prop_JointOffset)
+        .value("JointProperties",KinBody::Prop_JointProperties)
+        .value("JointAccelerationVelocityTorqueLimits",KinBody::Prop_JointAccelerationVelocityTorqueLimits)
+        .value("Joints",KinBody::Prop_Joints)
+        .value("Name",KinBody::Prop_Name)
+        .value("LinkDraw",KinBody::Prop_LinkDraw)
+        .value("LinkGeometry",KinBody::Prop_LinkGeometry)
+        .value("LinkTransforms",KinBody::Prop_LinkTransforms)
+        .value("LinkStatic",KinBody::Prop_LinkStatic)
+        .value("LinkEnable",KinBody::Prop_LinkEnable)
+        .value("LinkDynamics",KinBody::Prop_LinkDynamics)
+        .value("Links",KinBody::Prop_Links)
+        .value("JointCustomParameters",KinBody::Prop_JointCustomParameters)
+        .value("LinkCustomParameters",KinBody::Prop_LinkCustomParameters)
+        ;
+        class_<PyChangeCallbackSuspender, PyChangeCallbackSuspenderPtr >("ChangeCallbackSuspender", DOXY_CLASS(KinBody::ChangeCallbackSuspender), no_init)
+        .def("__enter__",&PyChangeCallbackSuspender::__enter__)
+        .def("__exit__",&PyChangeCallbackSuspender::__exit__)
+        .def("Close",&PyChangeCallbackSuspender::Close)
+        ;
         enum_<KinBody::CheckLimitsAction>("CheckLimitsAction" DOXY_ENUM(CheckLimitsAction))
         .value("Nothing",KinBody::CLA_Nothing)
         .value("CheckLimits",KinBody::CLA_CheckLimits)
@@ -3011,6 +3274,7 @@ void init_openravepy_kinbody()
                          .def("GetParentLinks",&PyLink::GetParentLinks, DOXY_FN(KinBody::Link,GetParentLinks))
                          .def("IsParentLink",&PyLink::IsParentLink, DOXY_FN(KinBody::Link,IsParentLink))
                          .def("GetCollisionData",&PyLink::GetCollisionData, DOXY_FN(KinBody::Link,GetCollisionData))
+                         .def("GetSphereTree",&PyLink::GetSphereTree, DOXY_FN(KinBody::Link,GetSphereTree))
                          .def("ComputeAABB",&PyLink::ComputeAABB, DOXY_FN(KinBody::Link,ComputeAABB))
                          .def("ComputeLocalAABB",&PyLink::ComputeLocalAABB, DOXY_FN(KinBody::Link,ComputeLocalAABB))
                          .def("GetTransform",&PyLink::GetTransform, DOXY_FN(KinBody::Link,GetTransform))
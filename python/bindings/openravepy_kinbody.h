@@ -106,6 +106,7 @@ public:
     int GetDOF() const;
     object GetDOFValues() const;
     object GetDOFValues(object oindices) const;
+    void GetDOFValuesInto(object oout, object oindices=object(), bool releasegil=true) const;
     object GetDOFVelocities() const;
     object GetDOFVelocities(object oindices) const;
     object GetDOFLimits() const;
@@ -140,6 +141,7 @@ public:
     object GetTransform() const;
     object GetTransformPose() const;
     object GetLinkTransformations(bool returndoflastvlaues=false) const;
+    void GetLinkTransformationsInto(object oout, bool releasegil=true) const;
     void SetLinkTransformations(object transforms, object odoflastvalues=object());
     void SetLinkVelocities(object ovelocities);
     object GetLinkEnableStates() const;
@@ -174,15 +176,18 @@ public:
     void SetDOFTorques(object otorques, bool bAdd);
     object ComputeJacobianTranslation(int index, object oposition, object oindices=object());
     object ComputeJacobianAxisAngle(int index, object oindices=object());
+    object ComputeJacobianTranslationAxisAngle(int index, object oposition, object oindices=object());
     object CalculateJacobian(int index, object oposition);
     object CalculateRotationJacobian(int index, object q) const;
     object CalculateAngularVelocityJacobian(int index) const;
     object ComputeHessianTranslation(int index, object oposition, object oindices=object());
     object ComputeHessianAxisAngle(int index, object oindices=object());
     object ComputeInverseDynamics(object odofaccelerations, object oexternalforcetorque=object(), bool returncomponents=false);
+    object ComputeInverseDynamicsBatch(object odofvalues, object odofvelocities=object(), object odofaccelerations=object(), bool releasegil=true);
     void SetSelfCollisionChecker(PyCollisionCheckerBasePtr pycollisionchecker);
     PyInterfaceBasePtr GetSelfCollisionChecker();
     bool CheckSelfCollision(PyCollisionReportPtr pReport=PyCollisionReportPtr(), PyCollisionCheckerBasePtr pycollisionchecker=PyCollisionCheckerBasePtr());
+    object CheckCollisionBatch(object oconfigs, object oout=object(), object oindices=object(), bool checkself=true, bool releasegil=true);
     bool IsAttached(PyKinBodyPtr pattachbody);
     object GetAttached() const;
     void SetZeroConfiguration();
@@ -206,6 +211,8 @@ public:
     int GetUpdateStamp() const;
     string serialize(int options) const;
     string GetKinematicsGeometryHash() const;
+    object RegisterChangeCallback(object oproperties, object fncallback) const;
+    object CreateChangeCallbackSuspender();
     PyStateRestoreContextBase* CreateKinBodyStateSaver(object options=object());
     virtual string __repr__();
     virtual string __str__();
@@ -34,6 +34,11 @@ bool pyJitterCurrentConfiguration(object pyplannerparameters, int maxiterations=
     return OpenRAVE::planningutils::JitterCurrentConfiguration(openravepy::GetPlannerParametersConst(pyplannerparameters), maxiterations, maxjitter, perturbation);
 }
 
+int pyJitterActiveDOFBatch(PyRobotBasePtr pyrobot, int nMaxIterations=5000, dReal fRand=0.03, int nBatchSize=64, int nThreads=0, dReal fLinkDistThresh=0)
+{
+    return OpenRAVE::planningutils::JitterActiveDOFBatch(openravepy::GetRobot(pyrobot), nMaxIterations, fRand, nBatchSize, nThreads, fLinkDistThresh);
+}
+
 bool pyJitterTransform(PyKinBodyPtr pybody, dReal fJitter, int nMaxIterations=1000)
 {
     return OpenRAVE::planningutils::JitterTransform(openravepy::GetKinBody(pybody), fJitter, nMaxIterations);
@@ -92,6 +97,51 @@ public:
 
 typedef boost::shared_ptr<PyActiveDOFTrajectorySmoother> PyActiveDOFTrajectorySmootherPtr;
 
+class PyActiveDOFTrajectoryVerifier
+{
+public:
+    PyActiveDOFTrajectoryVerifier(PyRobotBasePtr pyrobot, int numthreads=0) : _verifier(openravepy::GetRobot(pyrobot), numthreads) {
+    }
+    virtual ~PyActiveDOFTrajectoryVerifier() {
+    }
+
+    void SetSamplingSteps(dReal fcoarsestep, dReal fsamplingstep)
+    {
+        _verifier.SetSamplingSteps(fcoarsestep, fsamplingstep);
+    }
+
+    void SetCacheSize(size_t cachesize)
+    {
+        _verifier.SetCacheSize(cachesize);
+    }
+
+    /// \brief returns (valid, timecollision), timecollision is None if the trajectory is valid
+    object Verify(PyTrajectoryBasePtr pytraj, bool releasegil=true)
+    {
+        TrajectoryBasePtr ptraj = openravepy::GetTrajectory(pytraj);
+        dReal ftimecollision = 0;
+        bool bvalid;
+        {
+            // the result is built after the GIL is reacquired
+            openravepy::PythonThreadSaverPtr statesaver;
+            if( releasegil ) {
+                statesaver.reset(new openravepy::PythonThreadSaver());
+            }
+            bvalid = _verifier.Verify(ptraj, &ftimecollision);
+        }
+        return boost::python::make_tuple(bvalid, bvalid ? object() : object(ftimecollision));
+    }
+
+    void SynchronizeEnvironments()
+    {
+        _verifier.SynchronizeEnvironments();
+    }
+
+    OpenRAVE::planningutils::ActiveDOFTrajectoryVerifier _verifier;
+};
+
+typedef boost::shared_ptr<PyActiveDOFTrajectoryVerifier> PyActiveDOFTrajectoryVerifierPtr;
+
 PlannerStatus pySmoothAffineTrajectory(PyTrajectoryBasePtr pytraj, object omaxvelocities, object omaxaccelerations, const std::string& plannername="", const std::string& plannerparameters="")
 {
     return OpenRAVE::planningutils::SmoothAffineTrajectory(openravepy::GetTrajectory(pytraj),ExtractArray<dReal>(omaxvelocities), ExtractArray<dReal>(omaxaccelerations),plannername,plannerparameters);
@@ -323,6 +373,11 @@ public:
         return _sampler->GetIkParameterizationIndex(index);
     }
 
+    void SetParallel(int numthreads, int maxready=16)
+    {
+        _sampler->SetParallel(numthreads, maxready);
+    }
+
     OpenRAVE::planningutils::ManipulatorIKGoalSamplerPtr _sampler;
 };
 
@@ -332,8 +387,10 @@ typedef boost::shared_ptr<PyManipulatorIKGoalSampler> PyManipulatorIKGoalSampler
 } // end namespace planningutils
 BOOST_PYTHON_MEMBER_FUNCTION_OVERLOADS(Sample_overloads, Sample, 0, 2)
 BOOST_PYTHON_MEMBER_FUNCTION_OVERLOADS(SampleAll_overloads, SampleAll, 0, 3)
+BOOST_PYTHON_MEMBER_FUNCTION_OVERLOADS(SetParallel_overloads, SetParallel, 1, 2)
 
 BOOST_PYTHON_FUNCTION_OVERLOADS(JitterCurrentConfiguration_overloads, planningutils::pyJitterCurrentConfiguration, 1, 4);
+BOOST_PYTHON_FUNCTION_OVERLOADS(JitterActiveDOFBatch_overloads, planningutils::pyJitterActiveDOFBatch, 1, 6);
 BOOST_PYTHON_FUNCTION_OVERLOADS(JitterTransform_overloads, planningutils::pyJitterTransform, 2, 3);
 BOOST_PYTHON_FUNCTION_OVERLOADS(SmoothActiveDOFTrajectory_overloads, planningutils::pySmoothActiveDOFTrajectory, 2, 6)
 BOOST_PYTHON_FUNCTION_OVERLOADS(SmoothAffineTrajectory_overloads, planningutils::pySmoothAffineTrajectory, 3, 5)
@@ -347,6 +404,7 @@ BOOST_PYTHON_FUNCTION_OVERLOADS(InsertWaypointWithSmoothing_overloads, planningu
 BOOST_PYTHON_MEMBER_FUNCTION_OVERLOADS(PlanPath_overloads, PlanPath, 1, 2)
 BOOST_PYTHON_MEMBER_FUNCTION_OVERLOADS(PlanPath_overloads2, PlanPath, 3, 5)
 BOOST_PYTHON_MEMBER_FUNCTION_OVERLOADS(PlanPath_overloads3, PlanPath, 1, 3)
+BOOST_PYTHON_MEMBER_FUNCTION_OVERLOADS(Verify_overloads, Verify, 1, 2)
 
 void InitPlanningUtils()
 {
@@ -356,6 +414,8 @@ void InitPlanningUtils()
                   .staticmethod("JitterTransform")
                   .def("JitterCurrentConfiguration",planningutils::pyJitterCurrentConfiguration,JitterCurrentConfiguration_overloads(args("plannerparameters","maxiterations", "jitter", "perturbation"),DOXY_FN1(JitterCurrentConfiguration)))
                   .staticmethod("JitterCurrentConfiguration")
+                  .def("JitterActiveDOFBatch",planningutils::pyJitterActiveDOFBatch,JitterActiveDOFBatch_overloads(args("robot","maxiterations","jitter","batchsize","numthreads","linkdistthresh"),DOXY_FN1(JitterActiveDOFBatch)))
+                  .staticmethod("JitterActiveDOFBatch")
                   .def("ConvertTrajectorySpecification",planningutils::pyConvertTrajectorySpecification,args("trajectory","spec"),DOXY_FN1(ConvertTrajectorySpecification))
                   .staticmethod("ConvertTrajectorySpecification")
                   .def("ComputeTrajectoryDerivatives",planningutils::pyComputeTrajectoryDerivatives,args("trajectory","maxderiv"),DOXY_FN1(ComputeTrajectoryDerivatives))
@@ -414,6 +474,7 @@ void InitPlanningUtils()
         .def("Sample",&planningutils::PyManipulatorIKGoalSampler::Sample, Sample_overloads(args("ikreturn","releasegil"),DOXY_FN(planningutils::ManipulatorIKGoalSampler, Sample)))
         .def("SampleAll",&planningutils::PyManipulatorIKGoalSampler::SampleAll, SampleAll_overloads(args("maxsamples", "maxchecksamples", "releasegil"),DOXY_FN(planningutils::ManipulatorIKGoalSampler, SampleAll)))
         .def("GetIkParameterizationIndex", &planningutils::PyManipulatorIKGoalSampler::GetIkParameterizationIndex, args("index"), DOXY_FN(planningutils::ManipulatorIKGoalSampler, GetIkParameterizationIndex))
+        .def("SetParallel", &planningutils::PyManipulatorIKGoalSampler::SetParallel, SetParallel_overloads(args("numthreads", "maxready"), DOXY_FN(planningutils::ManipulatorIKGoalSampler, SetParallel)))
         ;
 
         class_<planningutils::PyActiveDOFTrajectorySmoother, planningutils::PyActiveDOFTrajectorySmootherPtr >("ActiveDOFTrajectorySmoother", DOXY_CLASS(planningutils::ActiveDOFTrajectorySmoother), no_init)
@@ -421,6 +482,14 @@ void InitPlanningUtils()
         .def("PlanPath",&planningutils::PyActiveDOFTrajectorySmoother::PlanPath,PlanPath_overloads(args("traj","releasegil"), DOXY_FN(planningutils::ActiveDOFTrajectorySmoother,PlanPath)))
         ;
 
+        class_<planningutils::PyActiveDOFTrajectoryVerifier, planningutils::PyActiveDOFTrajectoryVerifierPtr, boost::noncopyable >("ActiveDOFTrajectoryVerifier", DOXY_CLASS(planningutils::ActiveDOFTrajectoryVerifier), no_init)
+        .def(init<PyRobotBasePtr, optional<int> >(args("robot", "numthreads")))
+        .def("SetSamplingSteps",&planningutils::PyActiveDOFTrajectoryVerifier::SetSamplingSteps,args("coarsestep","samplingstep"), DOXY_FN(planningutils::ActiveDOFTrajectoryVerifier,SetSamplingSteps))
+        .def("SetCacheSize",&planningutils::PyActiveDOFTrajectoryVerifier::SetCacheSize,args("cachesize"), DOXY_FN(planningutils::ActiveDOFTrajectoryVerifier,SetCacheSize))
+        .def("Verify",&planningutils::PyActiveDOFTrajectoryVerifier::Verify,Verify_overloads(args("traj","releasegil"), "Verifies the trajectory.\n\n:return: (valid, timecollision), timecollision is None if the trajectory is valid\n\n"))
+        .def("SynchronizeEnvironments",&planningutils::PyActiveDOFTrajectoryVerifier::SynchronizeEnvironments, DOXY_FN(planningutils::ActiveDOFTrajectoryVerifier,SynchronizeEnvironments))
+        ;
+
         class_<planningutils::PyActiveDOFTrajectoryRetimer, planningutils::PyActiveDOFTrajectoryRetimerPtr >("ActiveDOFTrajectoryRetimer", DOXY_CLASS(planningutils::ActiveDOFTrajectoryRetimer), no_init)
         .def(init<PyRobotBasePtr, const std::string&, const std::string&>(args("robot", "hastimestamps", "plannername", "plannerparameters")))
         .def("PlanPath",&planningutils::PyActiveDOFTrajectoryRetimer::PlanPath,PlanPath_overloads3(args("traj","hastimestamps", "releasegil"), DOXY_FN(planningutils::ActiveDOFTrajectoryRetimer,PlanPath)))
@@ -24,6 +24,36 @@ class PyTrajectoryBase : public PyInterfaceBase
 protected:
     TrajectoryBasePtr _ptrajectory;
 public:
+    class PySampler
+    {
+public:
+        PySampler(TrajectoryBase::SamplerPtr psampler) : _psampler(psampler) {
+        }
+
+        object Sample(dReal time)
+        {
+            vector<dReal> values;
+            _psampler->Sample(values,time);
+            return toPyArray(values);
+        }
+
+        object Sample(dReal time, PyConfigurationSpecificationPtr pyspec)
+        {
+            vector<dReal> values;
+            _psampler->Sample(values,time,openravepy::GetConfigurationSpecification(pyspec));
+            return toPyArray(values);
+        }
+
+        size_t GetFirstWaypointIndexAfterTime(dReal time)
+        {
+            return _psampler->GetFirstWaypointIndexAfterTime(time);
+        }
+
+private:
+        TrajectoryBase::SamplerPtr _psampler;
+    };
+    typedef boost::shared_ptr<PySampler> PySamplerPtr;
+
     PyTrajectoryBase(TrajectoryBasePtr pTrajectory, PyEnvironmentBasePtr pyenv) : PyInterfaceBase(pTrajectory, pyenv),_ptrajectory(pTrajectory) {
     }
     virtual ~PyTrajectoryBase() {
@@ -76,6 +106,29 @@ public:
         return toPyArray(values);
     }
 
+    PySamplerPtr CreateSampler() const
+    {
+        return PySamplerPtr(new PySampler(_ptrajectory->CreateSampler()));
+    }
+
+    /// \brief samples all times into the preallocated array oout, one row per time
+    void SampleTrajectoryInto(object otimes, object oout, PyConfigurationSpecificationPtr pyspec=PyConfigurationSpecificationPtr(), bool releasegil=true) const
+    {
+        ConfigurationSpecification spec = !pyspec ? _ptrajectory->GetConfigurationSpecification() : openravepy::GetConfigurationSpecification(pyspec);
+        object otimesarray = toContiguousPyArray(otimes, sizeof(dReal)==8 ? PyArray_DOUBLE : PyArray_FLOAT);
+        size_t numtimes = (size_t)PyArray_SIZE((PyArrayObject*)otimesarray.ptr());
+        size_t dof = spec.GetDOF();
+        dReal* pout = (dReal*)ExtractWriteableArrayData(oout, sizeof(dReal)==8 ? PyArray_DOUBLE : PyArray_FLOAT, numtimes*dof);
+        const dReal* ptimes = (const dReal*)PyArray_DATA((PyArrayObject*)otimesarray.ptr());
+        openravepy::PythonThreadSaverPtr statesaver;
+        if( releasegil ) {
+            statesaver.reset(new openravepy::PythonThreadSaver());
+        }
+        std::vector<dReal> vtimes(ptimes, ptimes+numtimes), values;
+        _ptrajectory->SamplePoints(values,vtimes,spec);
+        std::copy(values.begin(), values.end(), pout);
+    }
+
     object GetConfigurationSpecification() const {
         return object(openravepy::toPyConfigurationSpecification(_ptrajectory->GetConfigurationSpecification()));
     }
@@ -222,6 +275,7 @@ PyTrajectoryBasePtr RaveCreateTrajectory(PyEnvironmentBasePtr pyenv, const std::
 }
 
 BOOST_PYTHON_MEMBER_FUNCTION_OVERLOADS(serialize_overloads, serialize, 0, 1)
+BOOST_PYTHON_MEMBER_FUNCTION_OVERLOADS(SampleTrajectoryInto_overloads, SampleTrajectoryInto, 2, 4)
 
 void init_openravepy_trajectory()
 {
@@ -237,30 +291,42 @@ void init_openravepy_trajectory()
     object (PyTrajectoryBase::*GetWaypoints2D2)(size_t,size_t,PyConfigurationSpecificationPtr) const = &PyTrajectoryBase::GetWaypoints2D;
     object (PyTrajectoryBase::*GetWaypoint1)(int) const = &PyTrajectoryBase::GetWaypoint;
     object (PyTrajectoryBase::*GetWaypoint2)(int,PyConfigurationSpecificationPtr) const = &PyTrajectoryBase::GetWaypoint;
-    class_<PyTrajectoryBase, boost::shared_ptr<PyTrajectoryBase>, bases<PyInterfaceBase> >("Trajectory", DOXY_CLASS(TrajectoryBase), no_init)
-    .def("Init",&PyTrajectoryBase::Init,args("spec"),DOXY_FN(TrajectoryBase,Init))
-    .def("Insert",Insert1,args("index","data"),DOXY_FN(TrajectoryBase,Insert "size_t; const std::vector; bool"))
-    .def("Insert",Insert2,args("index","data","overwrite"),DOXY_FN(TrajectoryBase,Insert "size_t; const std::vector; bool"))
-    .def("Insert",Insert3,args("index","data","spec"),DOXY_FN(TrajectoryBase,Insert "size_t; const std::vector; const ConfigurationSpecification; bool"))
-    .def("Insert",Insert4,args("index","data","spec","overwrite"),DOXY_FN(TrajectoryBase,Insert "size_t; const std::vector; const ConfigurationSpecification; bool"))
-    .def("Remove",&PyTrajectoryBase::Remove,args("startindex","endindex"),DOXY_FN(TrajectoryBase,Remove))
-    .def("Sample",Sample1,args("time"),DOXY_FN(TrajectoryBase,Sample "std::vector; dReal"))
-    .def("Sample",Sample2,args("time","spec"),DOXY_FN(TrajectoryBase,Sample "std::vector; dReal; const ConfigurationSpecification"))
-    .def("GetConfigurationSpecification",&PyTrajectoryBase::GetConfigurationSpecification,DOXY_FN(TrajectoryBase,GetConfigurationSpecification))
-    .def("GetNumWaypoints",&PyTrajectoryBase::GetNumWaypoints,DOXY_FN(TrajectoryBase,GetNumWaypoints))
-    .def("GetWaypoints",GetWaypoints1,args("startindex","endindex"),DOXY_FN(TrajectoryBase, GetWaypoints "size_t; size_t; std::vector"))
-    .def("GetWaypoints",GetWaypoints2,args("startindex","endindex","spec"),DOXY_FN(TrajectoryBase, GetWaypoints "size_t; size_t; std::vector, const ConfigurationSpecification&"))
-    .def("GetWaypoints2D",GetWaypoints2D1,args("startindex","endindex"),DOXY_FN(TrajectoryBase, GetWaypoints "size_t; size_t; std::vector"))
-    .def("GetWaypoints2D",GetWaypoints2D2,args("startindex","endindex","spec"),DOXY_FN(TrajectoryBase, GetWaypoints "size_t; size_t; std::vector, const ConfigurationSpecification&"))
-    .def("GetWaypoint",GetWaypoint1,args("index"),DOXY_FN(TrajectoryBase, GetWaypoint "int; std::vector"))
-    .def("GetWaypoint",GetWaypoint2,args("index","spec"),DOXY_FN(TrajectoryBase, GetWaypoint "int; std::vector; const ConfigurationSpecification"))
-    .def("GetFirstWaypointIndexAfterTime",&PyTrajectoryBase::GetFirstWaypointIndexAfterTime, DOXY_FN(TrajectoryBase, GetFirstWaypointIndexAfterTime))
-    .def("GetDuration",&PyTrajectoryBase::GetDuration,DOXY_FN(TrajectoryBase, GetDuration))
-    .def("serialize",&PyTrajectoryBase::serialize,serialize_overloads(args("options"),DOXY_FN(TrajectoryBase,serialize)))
-    .def("deserialize",&PyTrajectoryBase::deserialize,args("data"),DOXY_FN(TrajectoryBase,deserialize))
-    .def("Write",&PyTrajectoryBase::Write,args("options"),DOXY_FN(TrajectoryBase,Write))
-    .def("Read",&PyTrajectoryBase::Read,args("data","robot"),DOXY_FN(TrajectoryBase,Read))
-    ;
+    object (PyTrajectoryBase::PySampler::*SamplerSample1)(dReal) = &PyTrajectoryBase::PySampler::Sample;
+    object (PyTrajectoryBase::PySampler::*SamplerSample2)(dReal, PyConfigurationSpecificationPtr) = &PyTrajectoryBase::PySampler::Sample;
+    {
+        scope trajectory = class_<PyTrajectoryBase, boost::shared_ptr<PyTrajectoryBase>, bases<PyInterfaceBase> >("Trajectory", DOXY_CLASS(TrajectoryBase), no_init)
+        .def("Init",&PyTrajectoryBase::Init,args("spec"),DOXY_FN(TrajectoryBase,Init))
+        .def("Insert",Insert1,args("index","data"),DOXY_FN(TrajectoryBase,Insert "size_t; const std::vector; bool"))
+        .def("Insert",Insert2,args("index","data","overwrite"),DOXY_FN(TrajectoryBase,Insert "size_t; const std::vector; bool"))
+        .def("Insert",Insert3,args("index","data","spec"),DOXY_FN(TrajectoryBase,Insert "size_t; const std::vector; const ConfigurationSpecification; bool"))
+        .def("Insert",Insert4,args("index","data","spec","overwrite"),DOXY_FN(TrajectoryBase,Insert "size_t; const std::vector; const ConfigurationSpecification; bool"))
+        .def("Remove",&PyTrajectoryBase::Remove,args("startindex","endindex"),DOXY_FN(TrajectoryBase,Remove))
+        .def("Sample",Sample1,args("time"),DOXY_FN(TrajectoryBase,Sample "std::vector; dReal"))
+        .def("Sample",Sample2,args("time","spec"),DOXY_FN(TrajectoryBase,Sample "std::vector; dReal; const ConfigurationSpecification"))
+        .def("CreateSampler",&PyTrajectoryBase::CreateSampler,DOXY_FN(TrajectoryBase,CreateSampler))
+        .def("SampleTrajectoryInto",&PyTrajectoryBase::SampleTrajectoryInto,SampleTrajectoryInto_overloads(args("times","out","spec","releasegil"), "Samples the trajectory at all **times** with one TrajectoryBase::SamplePoints call and writes the results into the preallocated contiguous array **out** of shape len(times) x spec.GetDOF().\n\n:param times: array of times to sample at\n:param out: numpy array with the same type as dReal\n:param spec: optional configuration specification of the output, defaults to the trajectory specification\n:param releasegil: if True, releases the GIL while sampling"))
+        .def("GetConfigurationSpecification",&PyTrajectoryBase::GetConfigurationSpecification,DOXY_FN(TrajectoryBase,GetConfigurationSpecification))
+        .def("GetNumWaypoints",&PyTrajectoryBase::GetNumWaypoints,DOXY_FN(TrajectoryBase,GetNumWaypoints))
+        .def("GetWaypoints",GetWaypoints1,args("startindex","endindex"),DOXY_FN(TrajectoryBase, GetWaypoints "size_t; size_t; std::vector"))
+        .def("GetWaypoints",GetWaypoints2,args("startindex","endindex","spec"),DOXY_FN(TrajectoryBase, GetWaypoints "size_t; size_t; std::vector, const ConfigurationSpecification&"))
+        .def("GetWaypoints2D",GetWaypoints2D1,args("startindex","endindex"),DOXY_FN(TrajectoryBase, GetWaypoints "size_t; size_t; std::vector"))
+        .def("GetWaypoints2D",GetWaypoints2D2,args("startindex","endindex","spec"),DOXY_FN(TrajectoryBase, GetWaypoints "size_t; size_t; std::vector, const ConfigurationSpecification&"))
+        .def("GetWaypoint",GetWaypoint1,args("index"),DOXY_FN(TrajectoryBase, GetWaypoint "int; std::vector"))
+        .def("GetWaypoint",GetWaypoint2,args("index","spec"),DOXY_FN(TrajectoryBase, GetWaypoint "int; std::vector; const ConfigurationSpecification"))
+        .def("GetFirstWaypointIndexAfterTime",&PyTrajectoryBase::GetFirstWaypointIndexAfterTime, DOXY_FN(TrajectoryBase, GetFirstWaypointIndexAfterTime))
+        .def("GetDuration",&PyTrajectoryBase::GetDuration,DOXY_FN(TrajectoryBase, GetDuration))
+        .def("serialize",&PyTrajectoryBase::serialize,serialize_overloads(args("options"),DOXY_FN(TrajectoryBase,serialize)))
+        .def("deserialize",&PyTrajectoryBase::deserialize,args("data"),DOXY_FN(TrajectoryBase,deserialize))
+        .def("Write",&PyTrajectoryBase::Write,args("options"),DOXY_FN(TrajectoryBase,Write))
+        .def("Read",&PyTrajectoryBase::Read,args("data","robot"),DOXY_FN(TrajectoryBase,Read))
+        ;
+
+        class_<PyTrajectoryBase::PySampler, PyTrajectoryBase::PySamplerPtr >("Sampler", DOXY_CLASS(TrajectoryBase::Sampler), no_init)
+        .def("Sample",SamplerSample1,args("time"),DOXY_FN(TrajectoryBase::Sampler,Sample "std::vector; dReal"))
+        .def("Sample",SamplerSample2,args("time","spec"),DOXY_FN(TrajectoryBase::Sampler,Sample "std::vector; dReal; const ConfigurationSpecification"))
+        .def("GetFirstWaypointIndexAfterTime",&PyTrajectoryBase::PySampler::GetFirstWaypointIndexAfterTime,args("time"),DOXY_FN(TrajectoryBase::Sampler,GetFirstWaypointIndexAfterTime))
+        ;
+    }
 
     def("RaveCreateTrajectory",openravepy::RaveCreateTrajectory,args("env","name"),DOXY_FN1(RaveCreateTrajectory));
 }
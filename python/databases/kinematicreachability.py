@@ -67,6 +67,7 @@ from . import convexdecomposition, inversekinematics
 import numpy
 import time
 import os.path
+import tempfile
 from os import makedirs
 from heapq import nsmallest # for nth smallest element
 from optparse import OptionParser
@@ -226,6 +227,7 @@ class ReachabilityModel(DatabaseGenerator):
         xyzdelta=None
         quatdelta=None
         usefreespace=False
+        numthreads=None
         if options is not None:
             if options.maxradius is not None:
                 maxradius = options.maxradius
@@ -234,6 +236,7 @@ class ReachabilityModel(DatabaseGenerator):
             if options.quatdelta is not None:
                 quatdelta=options.quatdelta
             usefreespace=options.usefreespace
+            numthreads=options.numthreads
         if self.robot.GetKinematicsGeometryHash() == 'e829feb384e6417bbf5bd015f1c6b49a' or self.robot.GetKinematicsGeometryHash() == '22548f4f2ecf83e88ae7e2f3b2a0bd08': # wam 7dof
             if maxradius is None:
                 maxradius = 1.1
@@ -242,7 +245,7 @@ class ReachabilityModel(DatabaseGenerator):
                 xyzdelta = 0.03
             if quatdelta is None:
                 quatdelta = 0.2
-        return maxradius,translationonly,xyzdelta,quatdelta,usefreespace
+        return maxradius,translationonly,xyzdelta,quatdelta,usefreespace,numthreads
 
     def getOrderedArmJoints(self):
         return [j for j in self.robot.GetDependencyOrderedJoints() if j.GetJointIndex() in self.manip.GetArmIndices()]
@@ -268,8 +271,10 @@ class ReachabilityModel(DatabaseGenerator):
                     links.append(newlink)
         return links
 
-    def generatepcg(self,maxradius=None,translationonly=False,xyzdelta=None,quatdelta=None,usefreespace=False):
+    def generatepcg(self,maxradius=None,translationonly=False,xyzdelta=None,quatdelta=None,usefreespace=False,numthreads=None):
         """Generate producer, consumer, and gatherer functions allowing parallelization
+
+        :param numthreads: if greater than 1, the whole grid is computed in one job by the ikfast module's ComputeReachability command using that many threads
         """
         if not self.ikmodel.load():
             self.ikmodel.autogenerate()
@@ -356,8 +361,56 @@ class ReachabilityModel(DatabaseGenerator):
                 self.reachabilitydensity3d = reshape(self.reachabilitydensity3d,shape)
                 self.reachabilitystats = array(self.reachabilitystats)
 
+        if numthreads is not None and numthreads > 1:
+            def parallelproducer():
+                # the command is sent in batches so that the progress is logged like the serial producer
+                for i in range(0,len(insideinds),1000):
+                    log.info('%s/%d', i,len(insideinds))
+                    yield insideinds[i:i+1000],None
+            def parallelconsumer(inds,T):
+                with self.robot:
+                    self.robot.SetTransform(Trobot)
+                    points = allpoints[inds]+baseanchor
+                    quats = array([[1.0,0,0,0]]) if translationonly else qarray
+                    return self.computeReachabilityThreaded(inds,points,quats,usefreespace,numthreads)
+            return parallelproducer, parallelconsumer, gatherer, len(insideinds)
         return producer, consumer, gatherer, len(insideinds)
 
+    def computeReachabilityThreaded(self,inds,points,quats,usefreespace,numthreads):
+        """Computes the reachability of all points and rotations with the ikfast module's ComputeReachability command. The current robot state is used.
+
+        :return: inds, reachabilitystats, numvalid, numrotvalid with one entry per point
+        """
+        fd,filename = tempfile.mkstemp(suffix='.reach')
+        os.close(fd)
+        try:
+            cmd = 'ComputeReachability robot %s manip %s numthreads %d usefreespace %d filteroptions 0 '%(self.robot.GetName(),self.manip.GetName(),numthreads,usefreespace)
+            cmd += 'points %d '%len(points) + ' '.join('%d %.15e %.15e %.15e'%(ind,p[0],p[1],p[2]) for ind,p in zip(inds,points))
+            cmd += ' rotations %d '%len(quats) + ' '.join('%.15e %.15e %.15e %.15e'%tuple(q) for q in quats)
+            # the rest of the line is the filename, so it is last
+            cmd += ' filename %s'%filename
+            res = self.ikmodel.ikfastproblem.SendCommand(cmd)
+            if res is None:
+                raise ValueError('ComputeReachability failed')
+            numposes,elapsedtime,posespersecond = [float(f) for f in res.split()]
+            log.debug('computed %d poses in %fs (%f poses/s)',numposes,elapsedtime,posespersecond)
+            data = open(filename,'rb').read()
+        finally:
+            os.remove(filename)
+        numpoints = numpy.frombuffer(data,numpy.int32,2)[0]
+        offset = 8
+        rinds = zeros(numpoints,int)
+        numvalid = zeros(numpoints)
+        numrotvalid = zeros(numpoints)
+        reachabilitystats = []
+        for i in range(numpoints):
+            rinds[i],numvalid[i],numrotvalid[i],numstats = numpy.frombuffer(data,numpy.int32,4,offset)
+            offset += 16
+            if numstats > 0:
+                reachabilitystats += list(numpy.frombuffer(data,numpy.float64,8*numstats,offset).reshape((numstats,8)))
+                offset += 64*numstats
+        return rinds,reachabilitystats,numvalid,numrotvalid
+
 
     def show(self,showrobot=True,contours=[0.01,0.1,0.2,0.5,0.8,0.9,0.99],opacity=None,figureid=1, xrange=None,options=None):
         try:
@@ -111,8 +111,12 @@ class Grasper:
         contacts = reshape(array([float64(s) for s in resvalues],float64),(len(resvalues)/6,6))
         return contacts,finalconfig,mindist,volume
 
-    def GraspThreaded(self,approachrays,standoffs,preshapes,rolls,manipulatordirections=None,target=None,transformrobot=True,onlycontacttarget=True,tightgrasp=False,graspingnoise=None,forceclosurethreshold=None,collisionchecker=None,translationstepmult=None,numthreads=None,startindex=None,maxgrasps=None,finestep=None):
+    def GraspThreaded(self,approachrays,standoffs,preshapes,rolls,manipulatordirections=None,target=None,transformrobot=True,onlycontacttarget=True,tightgrasp=False,graspingnoise=None,forceclosurethreshold=None,collisionchecker=None,translationstepmult=None,numthreads=None,startindex=None,maxgrasps=None,maxforceclosuregrasps=None,finestep=None,nonblocking=False):
         """See :ref:`module-grasper-graspthreaded`
+
+        :param maxgrasps: stops after this many successful grasps
+        :param maxforceclosuregrasps: computes force closure and stops after this many grasps in force closure
+        :param nonblocking: if True, returns right away and the grasps are retrieved with :meth:`GetGraspThreadedResults`
         """
         cmd = 'GraspThreaded '
         if target is not None:
@@ -124,6 +128,8 @@ class Grasper:
             cmd += 'startindex %d '%startindex
         if maxgrasps is not None:
             cmd += 'maxgrasps %d '%maxgrasps
+        if maxforceclosuregrasps is not None:
+            cmd += 'maxforceclosuregrasps %d '%maxforceclosuregrasps
         for link in self.avoidlinks:
             cmd += 'avoidlink %s '%link.GetName()
         if graspingnoise is not None:
@@ -134,6 +140,8 @@ class Grasper:
             cmd += 'finestep %.15e '%finestep
         if numthreads is not None:
             cmd += 'numthreads %d '%numthreads
+        if nonblocking:
+            cmd += 'nonblocking 1 '
         cmd += 'approachrays %d '%len(approachrays)
         for f in approachrays.flat:
             cmd += str(f) + ' '
@@ -152,9 +160,28 @@ class Grasper:
         res = self.prob.SendCommand(cmd)
         if res is None:
             raise planning_error('Grasp failed')
+        if nonblocking:
+            return None
         resultgrasps = res.split()
-        resvalues=[]
         nextid = int(resultgrasps.pop(0))
+        return nextid, self._ParseGraspThreadedResults(resultgrasps)
+
+    def GetGraspThreadedResults(self,wait=False):
+        """Returns the grasps found by the last non-blocking :meth:`GraspThreaded` call since the previous query.
+
+        :param wait: if True, blocks until at least one grasp is found or the call finishes
+        :return: done, nextid, grasps
+        """
+        res = self.prob.SendCommand('GetGraspThreadedResults wait %d'%wait)
+        if res is None:
+            raise planning_error('GetGraspThreadedResults failed')
+        resultgrasps = res.split()
+        done = int(resultgrasps.pop(0))!=0
+        nextid = int(resultgrasps.pop(0))
+        return done, nextid, self._ParseGraspThreadedResults(resultgrasps)
+
+    def _ParseGraspThreadedResults(self,resultgrasps):
+        resvalues=[]
         preshapelen = len(self.robot.GetActiveManipulator().GetGripperIndices())
         for i in range(int(resultgrasps.pop(0))):
             position = array([float64(resultgrasps.pop(0)) for i in range(3)])
@@ -171,7 +198,7 @@ class Grasper:
             contacts=[float64(resultgrasps.pop(0)) for i in range(contacts_num*6)]
             contacts = reshape(contacts,(contacts_num,6))
             resvalues.append([position, direction, roll, standoff, manipulatordirection, mindist, volume, preshape,Tfinal,finalshape,contacts])
-        return nextid, resvalues
+        return resvalues
 
     def ConvexHull(self,points,returnplanes=True,returnfaces=True,returntriangles=True):
         """See :ref:`module-grasper-convexhull`
@@ -0,0 +1,215 @@
+// -*- coding: utf-8 -*-
+// Copyright (C) 2006-2014 Rosen Diankov <rosen.diankov@gmail.com>
+//
+// This file is part of OpenRAVE.
+// OpenRAVE is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+/** \file fkbenchmark.cpp
+    \brief Times forward kinematics and the batched geometry helpers of geometry.h.
+
+    The joint chains of the given robots are extracted from their hierarchy and evaluated with the geometry.h templates
+    in double and float. The instruction set is the build-wide OPT_MATH_SIMD setting, so the scalar templates are
+    compared against the SIMD specializations by running the program from a build configured with OPT_MATH_SIMD=NONE
+    and from the default build. KinBody::SetDOFValues is timed as well for reference.
+
+    Usage: openrave_fkbenchmark [--configs num] [robot files...]
+ */
+#include "libopenrave-core/openrave-core.h"
+#include <openrave/utils.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+using namespace OpenRAVE;
+using namespace std;
+
+/// \brief one revolute or prismatic joint of the chain: Tchild = Tparent * left * Tjoint(q) * right
+struct ChainJoint
+{
+    int parentlink, childlink;
+    bool revolute;
+    Transform left, right;
+    Vector axis;
+};
+
+/// \brief computes the link transforms of the chain for the joint values q
+template <typename T>
+static void ComputeChain(const vector<ChainJoint>& vjoints, const vector<geometry::RaveTransform<T> >& vleft, const vector<geometry::RaveTransform<T> >& vright, const vector<geometry::RaveVector<T> >& vaxes, const T* q, vector<geometry::RaveTransform<T> >& vlinks)
+{
+    for(size_t i = 0; i < vjoints.size(); ++i) {
+        geometry::RaveTransform<T> tjoint;
+        if( vjoints[i].revolute ) {
+            tjoint.rot = geometry::quatFromAxisAngle(vaxes[i], q[i]);
+        }
+        else {
+            tjoint.trans = vaxes[i]*q[i];
+        }
+        const geometry::RaveTransform<T>& tparent = vlinks[vjoints[i].parentlink < 0 ? vlinks.size()-1 : vjoints[i].parentlink];
+        vlinks[vjoints[i].childlink] = tparent * vleft[i] * tjoint * vright[i];
+    }
+}
+
+template <typename T>
+static double TimeChain(const vector<ChainJoint>& vjoints, int nlinks, const vector<dReal>& vconfigs)
+{
+    vector<geometry::RaveTransform<T> > vleft, vright, vlinks(nlinks+1); // last entry is the identity for the root
+    vector<geometry::RaveVector<T> > vaxes;
+    for(size_t i = 0; i < vjoints.size(); ++i) {
+        vleft.push_back(vjoints[i].left);
+        vright.push_back(vjoints[i].right);
+        vaxes.push_back(vjoints[i].axis);
+    }
+    vector<T> vq(vconfigs.begin(), vconfigs.end());
+    size_t nconfigs = vq.size()/vjoints.size();
+    double fbest = 1e30;
+    for(int irep = 0; irep < 5; ++irep) {
+        uint64_t starttime = utils::GetMicroTime();
+        for(size_t iconfig = 0; iconfig < nconfigs; ++iconfig) {
+            ComputeChain(vjoints, vleft, vright, vaxes, &vq[iconfig*vjoints.size()], vlinks);
+        }
+        fbest = min(fbest, (utils::GetMicroTime()-starttime)*1e-6);
+    }
+    return fbest/nconfigs;
+}
+
+static void BenchmarkRobot(EnvironmentBasePtr penv, const string& filename, int nconfigs)
+{
+    RobotBasePtr probot = penv->ReadRobotURI(filename);
+    if( !probot ) {
+        RAVELOG_WARN(str(boost::format("failed to load %s\n")%filename));
+        return;
+    }
+    if( probot->GetName().size() == 0 ) {
+        probot->SetName("robot");
+    }
+    penv->Add(probot, true);
+
+    vector<ChainJoint> vjoints;
+    const vector<KinBody::JointPtr>& vorderedjoints = probot->GetDependencyOrderedJoints();
+    for(size_t ijoint = 0; ijoint < vorderedjoints.size(); ++ijoint) {
+        KinBody::JointPtr pjoint = vorderedjoints[ijoint];
+        if( pjoint->GetDOF() != 1 || !pjoint->GetHierarchyChildLink() || (!pjoint->IsRevolute(0) && !pjoint->IsPrismatic(0)) ) {
+            continue;
+        }
+        ChainJoint joint;
+        joint.parentlink = !pjoint->GetHierarchyParentLink() ? -1 : pjoint->GetHierarchyParentLink()->GetIndex();
+        joint.childlink = pjoint->GetHierarchyChildLink()->GetIndex();
+        joint.revolute = pjoint->IsRevolute(0);
+        joint.left = pjoint->GetInternalHierarchyLeftTransform();
+        joint.right = pjoint->GetInternalHierarchyRightTransform();
+        joint.axis = pjoint->GetInternalHierarchyAxis(0);
+        vjoints.push_back(joint);
+    }
+    if( vjoints.size() == 0 ) {
+        RAVELOG_WARN(str(boost::format("%s has no revolute or prismatic joints\n")%filename));
+        penv->Remove(probot);
+        return;
+    }
+
+    vector<dReal> vconfigs(nconfigs*vjoints.size());
+    for(size_t i = 0; i < vconfigs.size(); ++i) {
+        vconfigs[i] = 4*RaveRandomFloat()-2;
+    }
+    printf("%-40s %3d joints  chain double %7.3f us  chain float %7.3f us", filename.c_str(), (int)vjoints.size(), TimeChain<double>(vjoints, (int)probot->GetLinks().size(), vconfigs)*1e6, TimeChain<float>(vjoints, (int)probot->GetLinks().size(), vconfigs)*1e6);
+
+    // the library path, which also computes velocities, updates the link geometry and notifies the callbacks
+    vector<dReal> vlower, vupper, vvalues(probot->GetDOF());
+    probot->GetDOFLimits(vlower, vupper);
+    int nsetconfigs = min(nconfigs, 2000);
+    uint64_t starttime = utils::GetMicroTime();
+    for(int iconfig = 0; iconfig < nsetconfigs; ++iconfig) {
+        for(size_t i = 0; i < vvalues.size(); ++i) {
+            vvalues[i] = vlower[i] + (vupper[i]-vlower[i])*((iconfig*7+i)%13)/dReal(12);
+        }
+        probot->SetDOFValues(vvalues, KinBody::CLA_Nothing);
+    }
+    printf("  SetDOFValues %7.3f us\n", (utils::GetMicroTime()-starttime)/double(nsetconfigs));
+    penv->Remove(probot);
+}
+
+template <typename T>
+static void BenchmarkKernels(const char* type)
+{
+    const size_t n = 4096;
+    const int nreps = 200;
+    vector<geometry::RaveTransform<T> > va(n), vb(n), vc(n);
+    vector<geometry::RaveVector<T> > vpoints(n), vout(n);
+    for(size_t i = 0; i < n; ++i) {
+        geometry::RaveVector<T> axis(RaveRandomFloat()-0.5f, RaveRandomFloat()-0.5f, RaveRandomFloat()-0.5f);
+        va[i].rot = geometry::quatFromAxisAngle(axis, T(6*RaveRandomFloat()));
+        va[i].trans = geometry::RaveVector<T>(RaveRandomFloat(), RaveRandomFloat(), RaveRandomFloat());
+        vb[i].rot = geometry::quatFromAxisAngle(axis*T(-2), T(6*RaveRandomFloat()));
+        vb[i].trans = geometry::RaveVector<T>(RaveRandomFloat(), RaveRandomFloat(), RaveRandomFloat());
+        vpoints[i] = geometry::RaveVector<T>(RaveRandomFloat()-0.5f, RaveRandomFloat(), RaveRandomFloat()-0.5f);
+    }
+
+#define BENCHMARK_KERNEL(name, code) { \
+        double fbest = 1e30; \
+        for(int irep = 0; irep < 3; ++irep) { \
+            uint64_t starttime = utils::GetMicroTime(); \
+            for(int k = 0; k < nreps; ++k) { code; } \
+            fbest = min(fbest, (utils::GetMicroTime()-starttime)*1e-6); \
+        } \
+        printf("%-28s %-6s %7.2f ns\n", name, type, fbest/(nreps*n)*1e9); \
+}
+
+    BENCHMARK_KERNEL("Transform*Transform", for(size_t i = 0; i < n; ++i) { vc[i] = va[i]*vb[(i+k)%n]; });
+    BENCHMARK_KERNEL("quatMultiply", for(size_t i = 0; i < n; ++i) { vout[i] = geometry::quatMultiply(va[i].rot, vb[(i+k)%n].rot); });
+    BENCHMARK_KERNEL("Transform*Vector", for(size_t i = 0; i < n; ++i) { vout[i] = va[k]*vpoints[i]; });
+    BENCHMARK_KERNEL("transformPoints", geometry::transformPoints(va[k], &vpoints[0], &vout[0], n));
+    BENCHMARK_KERNEL("multiplyTransforms(t,array)", geometry::multiplyTransforms(va[k], &vb[0], &vc[0], n));
+    BENCHMARK_KERNEL("multiplyTransforms(array)", geometry::multiplyTransforms(&va[0], &vb[0], &vc[0], n));
+#undef BENCHMARK_KERNEL
+}
+
+int main(int argc, char ** argv)
+{
+    int nconfigs = 20000;
+    vector<string> vfilenames;
+    for(int i = 1; i < argc; ++i) {
+        if( strcmp(argv[i], "--configs") == 0 && i+1 < argc ) {
+            nconfigs = atoi(argv[++i]);
+        }
+        else {
+            vfilenames.push_back(argv[i]);
+        }
+    }
+    if( vfilenames.size() == 0 ) {
+        vfilenames.push_back("robots/barrettwam.robot.xml");
+        vfilenames.push_back("robots/barrettwam-dual.robot.xml");
+        vfilenames.push_back("robots/barretthand.robot.xml");
+    }
+
+#if defined(OPENRAVE_MATH_USE_AVX)
+    printf("geometry math: SSE2+AVX\n");
+#elif defined(OPENRAVE_MATH_USE_SSE2)
+    printf("geometry math: SSE2\n");
+#else
+    printf("geometry math: scalar\n");
+#endif
+
+    RaveInitialize(true, Level_Warn);
+    EnvironmentBasePtr penv = RaveCreateEnvironment();
+    RaveInitRandomGeneration(0);
+    penv->StopSimulation();
+    for(size_t i = 0; i < vfilenames.size(); ++i) {
+        BenchmarkRobot(penv, vfilenames[i], nconfigs);
+    }
+    BenchmarkKernels<double>("double");
+    BenchmarkKernels<float>("float");
+    penv->Destroy();
+    RaveDestroy();
+    return 0;
+}
@@ -0,0 +1,172 @@
+// -*- coding: utf-8 -*-
+// Copyright (C) 2006-2014 Rosen Diankov <rosen.diankov@gmail.com>
+//
+// This file is part of OpenRAVE.
+// OpenRAVE is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+/** \file obbdisjointtest.cpp
+    \brief Checks that the vectorized OBB overlap test of PQP gives the same answers as the scalar reference.
+
+    Random box pairs are generated around the overlap boundary, along with degenerate pairs with parallel or touching
+    faces, and obb_disjoint is compared against obb_disjoint_scalar. Both have to return the same separating axis for
+    every pair. The program is built for double (openrave_obbdisjointtest) and float (openrave_obbdisjointtest_float)
+    since they use different registers, and it returns 1 if any pair differs.
+
+    Usage: openrave_obbdisjointtest [--pairs num] [--seed num]
+ */
+#include "OBB_Disjoint.h"
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <vector>
+
+using namespace std;
+
+struct BoxPair
+{
+    PQP_REAL B[3][3], T[3], a[3], b[3];
+};
+
+static double RandomUniform()
+{
+    return rand()/(RAND_MAX+1.0);
+}
+
+/// \brief sets B to a random rotation, or to a random signed permutation so that the boxes have parallel faces
+static void RandomRotation(PQP_REAL B[3][3], bool bparallel)
+{
+    if( bparallel ) {
+        int perm[3] = { 0, 1, 2 };
+        for(int i = 2; i > 0; --i) {
+            swap(perm[i], perm[rand()%(i+1)]);
+        }
+        for(int i = 0; i < 3; ++i) {
+            for(int j = 0; j < 3; ++j) {
+                B[i][j] = 0;
+            }
+            B[i][perm[i]] = (rand()&1) ? 1 : -1;
+        }
+        return;
+    }
+    double q[4], flen = 0;
+    do {
+        flen = 0;
+        for(int i = 0; i < 4; ++i) {
+            q[i] = 2*RandomUniform()-1;
+            flen += q[i]*q[i];
+        }
+    } while(flen < 1e-4 || flen > 1);
+    flen = 1/sqrt(flen);
+    for(int i = 0; i < 4; ++i) {
+        q[i] *= flen;
+    }
+    B[0][0] = PQP_REAL(1-2*(q[2]*q[2]+q[3]*q[3])); B[0][1] = PQP_REAL(2*(q[1]*q[2]-q[0]*q[3])); B[0][2] = PQP_REAL(2*(q[1]*q[3]+q[0]*q[2]));
+    B[1][0] = PQP_REAL(2*(q[1]*q[2]+q[0]*q[3])); B[1][1] = PQP_REAL(1-2*(q[1]*q[1]+q[3]*q[3])); B[1][2] = PQP_REAL(2*(q[2]*q[3]-q[0]*q[1]));
+    B[2][0] = PQP_REAL(2*(q[1]*q[3]-q[0]*q[2])); B[2][1] = PQP_REAL(2*(q[2]*q[3]+q[0]*q[1])); B[2][2] = PQP_REAL(1-2*(q[1]*q[1]+q[2]*q[2]));
+}
+
+static void RandomBoxPair(BoxPair& pair, int type)
+{
+    RandomRotation(pair.B, type >= 2);
+    for(int i = 0; i < 3; ++i) {
+        pair.a[i] = PQP_REAL(0.01+RandomUniform());
+        pair.b[i] = PQP_REAL(0.01+RandomUniform());
+    }
+    if( type == 3 ) {
+        // boxes with parallel faces touching along one axis
+        int iaxis = rand()%3;
+        PQP_REAL fextent = 0;
+        for(int j = 0; j < 3; ++j) {
+            fextent += pair.b[j]*myfabs(pair.B[iaxis][j]);
+        }
+        for(int i = 0; i < 3; ++i) {
+            pair.T[i] = PQP_REAL(0.5*(2*RandomUniform()-1)*pair.a[i]);
+        }
+        pair.T[iaxis] = (rand()&1) ? pair.a[iaxis]+fextent : -pair.a[iaxis]-fextent;
+        return;
+    }
+    // centers distributed so that about half of the pairs overlap
+    for(int i = 0; i < 3; ++i) {
+        pair.T[i] = PQP_REAL(3*(2*RandomUniform()-1));
+    }
+    if( type == 1 ) {
+        pair.T[rand()%3] = 0;
+    }
+}
+
+int main(int argc, char ** argv)
+{
+    int npairs = 1000000;
+    unsigned int seed = 0;
+    for(int i = 1; i < argc; ++i) {
+        if( strcmp(argv[i], "--pairs") == 0 && i+1 < argc ) {
+            npairs = atoi(argv[++i]);
+        }
+        else if( strcmp(argv[i], "--seed") == 0 && i+1 < argc ) {
+            seed = (unsigned int)atoi(argv[++i]);
+        }
+        else {
+            printf("Usage: %s [--pairs num] [--seed num]\n", argv[0]);
+            return 2;
+        }
+    }
+#ifdef PQP_USE_SSE2
+    printf("obb_disjoint: SSE2, PQP_REAL is %s\n", sizeof(PQP_REAL) == sizeof(float) ? "float" : "double");
+#else
+    printf("obb_disjoint: scalar, PQP_REAL is %s\n", sizeof(PQP_REAL) == sizeof(float) ? "float" : "double");
+#endif
+
+    srand(seed);
+    vector<BoxPair> vpairs(npairs);
+    for(int i = 0; i < npairs; ++i) {
+        RandomBoxPair(vpairs[i], i%4);
+    }
+
+    int nmismatches = 0, noverlapping = 0;
+    for(int i = 0; i < npairs; ++i) {
+        BoxPair& pair = vpairs[i];
+        int iscalar = obb_disjoint_scalar(pair.B, pair.T, pair.a, pair.b);
+        int ivector = obb_disjoint(pair.B, pair.T, pair.a, pair.b);
+        if( iscalar == 0 ) {
+            ++noverlapping;
+        }
+        if( iscalar != ivector ) {
+            if( nmismatches < 10 ) {
+                printf("pair %d: scalar separating axis %d, obb_disjoint %d\n", i, iscalar, ivector);
+            }
+            ++nmismatches;
+        }
+    }
+    printf("%d pairs, %d overlapping, %d mismatches\n", npairs, noverlapping, nmismatches);
+
+    // timing for reference
+    int nsum = 0;
+    clock_t starttime = clock();
+    for(int i = 0; i < npairs; ++i) {
+        nsum += obb_disjoint_scalar(vpairs[i].B, vpairs[i].T, vpairs[i].a, vpairs[i].b);
+    }
+    double fscalar = double(clock()-starttime)/CLOCKS_PER_SEC;
+    starttime = clock();
+    for(int i = 0; i < npairs; ++i) {
+        nsum -= obb_disjoint(vpairs[i].B, vpairs[i].T, vpairs[i].a, vpairs[i].b);
+    }
+    double fvector = double(clock()-starttime)/CLOCKS_PER_SEC;
+    if( npairs > 0 ) {
+        printf("obb_disjoint_scalar %6.2f ns/pair, obb_disjoint %6.2f ns/pair (checksum %d)\n", fscalar/npairs*1e9, fvector/npairs*1e9, nsum);
+    }
+    return nmismatches > 0 ? 1 : 0;
+}
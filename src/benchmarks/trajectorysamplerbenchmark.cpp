@@ -0,0 +1,154 @@
+// -*- coding: utf-8 -*-
+// Copyright (C) 2006-2014 Rosen Diankov <rosen.diankov@gmail.com>
+//
+// This file is part of OpenRAVE.
+// OpenRAVE is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+/** \file trajectorysamplerbenchmark.cpp
+    \brief Compares TrajectoryBase::Sample with the cursor returned by TrajectoryBase::CreateSampler.
+
+    For every interpolation a random 7-dof trajectory is sampled at monotonically increasing times, like
+    IdealController::SimulationStep does at every control tick. The maximum difference between the two paths over
+    random, sequential and waypoint times is reported, which should be at the level of floating-point round-off.
+
+    Usage: openrave_trajectorysamplerbenchmark [--waypoints num] [--samples num]
+ */
+#include "libopenrave-core/openrave-core.h"
+#include <openrave/utils.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+using namespace OpenRAVE;
+using namespace std;
+
+static const int s_nDOF = 7;
+
+/// \brief creates a trajectory of nwaypoints random waypoints whose joint values are interpolated with interpolation
+static TrajectoryBasePtr CreateRandomTrajectory(EnvironmentBasePtr penv, const string& interpolation, int nwaypoints)
+{
+    string derivativeinterpolation = "next";
+    if( interpolation == "quintic" || interpolation == "sextic" ) {
+        derivativeinterpolation = "quartic";
+    }
+    else if( interpolation == "cubic" ) {
+        derivativeinterpolation = "quadratic";
+    }
+    else if( interpolation == "quadratic" ) {
+        derivativeinterpolation = "linear";
+    }
+
+    ConfigurationSpecification spec;
+    const char* groupnames[] = { "joint_values", "joint_velocities", "joint_accelerations", "joint_jerks"};
+    for(int igroup = 0; igroup < 4; ++igroup) {
+        ConfigurationSpecification::Group g;
+        g.name = str(boost::format("%s __dummy__ 0 1 2 3 4 5 6")%groupnames[igroup]);
+        g.dof = s_nDOF;
+        g.offset = igroup*s_nDOF;
+        g.interpolation = igroup == 0 ? interpolation : (igroup == 1 ? derivativeinterpolation : "next");
+        spec._vgroups.push_back(g);
+    }
+    spec.AddDeltaTimeGroup();
+
+    vector<dReal> vdata(nwaypoints*spec.GetDOF());
+    for(int i = 0; i < nwaypoints; ++i) {
+        dReal* pwaypoint = &vdata[i*spec.GetDOF()];
+        for(int j = 0; j < 4*s_nDOF; ++j) {
+            pwaypoint[j] = RaveRandomFloat()-0.5;
+        }
+        pwaypoint[4*s_nDOF] = i == 0 ? 0 : 0.01+0.02*RaveRandomFloat();
+    }
+    TrajectoryBasePtr ptraj = RaveCreateTrajectory(penv, "");
+    ptraj->Init(spec);
+    ptraj->Insert(0, vdata);
+    return ptraj;
+}
+
+static void BenchmarkInterpolation(EnvironmentBasePtr penv, const string& interpolation, int nwaypoints, int nsamples)
+{
+    TrajectoryBasePtr ptraj = CreateRandomTrajectory(penv, interpolation, nwaypoints);
+    TrajectoryBase::SamplerPtr psampler = ptraj->CreateSampler();
+    ConfigurationSpecification valuesspec = ptraj->GetConfigurationSpecification().GetTimeDerivativeSpecification(0);
+    dReal duration = ptraj->GetDuration(), timestep = duration/nsamples;
+    vector<dReal> vtrajdata, vsamplerdata;
+
+    // sum the samples so that the compiler cannot drop the loops
+    double fsum = 0;
+    uint64_t starttime = utils::GetMicroTime();
+    for(int i = 0; i <= nsamples; ++i) {
+        ptraj->Sample(vtrajdata, i*timestep);
+        fsum += vtrajdata[0];
+    }
+    uint64_t sampletime = utils::GetMicroTime()-starttime;
+    starttime = utils::GetMicroTime();
+    for(int i = 0; i <= nsamples; ++i) {
+        psampler->Sample(vsamplerdata, i*timestep);
+        fsum -= vsamplerdata[0];
+    }
+    uint64_t samplertime = utils::GetMicroTime()-starttime;
+    starttime = utils::GetMicroTime();
+    for(int i = 0; i <= nsamples; ++i) {
+        ptraj->Sample(vtrajdata, i*timestep, valuesspec);
+        fsum += vtrajdata[0];
+    }
+    uint64_t samplespectime = utils::GetMicroTime()-starttime;
+    starttime = utils::GetMicroTime();
+    for(int i = 0; i <= nsamples; ++i) {
+        psampler->Sample(vsamplerdata, i*timestep, valuesspec);
+        fsum -= vsamplerdata[0];
+    }
+    uint64_t samplerspectime = utils::GetMicroTime()-starttime;
+
+    // random access, going backwards, past the end and exactly at the waypoints
+    dReal fmaxerror = 0;
+    int nindexmismatches = 0;
+    for(int i = 0; i < 3*nwaypoints; ++i) {
+        dReal time = i < nwaypoints ? RaveRandomFloat()*duration*1.01 : (i < 2*nwaypoints ? duration*(2*nwaypoints-i)/nwaypoints : ptraj->GetDuration()*(i-2*nwaypoints)/(nwaypoints-1));
+        ptraj->Sample(vtrajdata, time);
+        psampler->Sample(vsamplerdata, time);
+        for(size_t j = 0; j < vtrajdata.size(); ++j) {
+            fmaxerror = max(fmaxerror, RaveFabs(vtrajdata[j]-vsamplerdata[j]));
+        }
+        if( ptraj->GetFirstWaypointIndexAfterTime(time) != psampler->GetFirstWaypointIndexAfterTime(time) ) {
+            ++nindexmismatches;
+        }
+    }
+    printf("%-10s Sample %7.1f ns  sampler %7.1f ns  (values only: Sample %7.1f ns  sampler %7.1f ns)  max error %g  index mismatches %d  checksum %g\n", interpolation.c_str(), sampletime*1e3/(nsamples+1), samplertime*1e3/(nsamples+1), samplespectime*1e3/(nsamples+1), samplerspectime*1e3/(nsamples+1), fmaxerror, nindexmismatches, fsum);
+}
+
+int main(int argc, char ** argv)
+{
+    int nwaypoints = 10000, nsamples = 1000000;
+    for(int i = 1; i+1 < argc; i += 2) {
+        if( strcmp(argv[i], "--waypoints") == 0 ) {
+            nwaypoints = max(2, atoi(argv[i+1]));
+        }
+        else if( strcmp(argv[i], "--samples") == 0 ) {
+            nsamples = max(1, atoi(argv[i+1]));
+        }
+    }
+
+    RaveInitialize(true, Level_Warn);
+    EnvironmentBasePtr penv = RaveCreateEnvironment();
+    RaveInitRandomGeneration(0);
+    penv->StopSimulation();
+    const char* interpolations[] = { "linear", "quadratic", "cubic", "quintic", "sextic"};
+    for(int i = 0; i < 5; ++i) {
+        BenchmarkInterpolation(penv, interpolations[i], nwaypoints, nsamples);
+    }
+    penv->Destroy();
+    RaveDestroy();
+    return 0;
+}
@@ -0,0 +1,952 @@
+// -*- coding: utf-8 -*-
+// Copyright (C) 2006-2013 Rosen Diankov <rosen.diankov@gmail.com>
+//
+// This file is part of OpenRAVE.
+// OpenRAVE is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+#include "ravep.h"
+#include <cstdio>
+#include <cstring>
+#include <iomanip>
+#include <limits>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#define CHUNKEDTRAJECTORY_HAS_MMAP
+#endif
+
+namespace OpenRAVE {
+
+/// \brief version of the binary file layout, increment whenever ChunkedTrajectory::_SaveBinary changes
+static const uint32_t s_nChunkedTrajectoryVersion = 1;
+
+/** \brief trajectory storing its waypoints in a rope of fixed-size chunks, meant for trajectories with millions of waypoints.
+
+    The chunks are the nodes of a treap ordered by waypoint index. Every node stores the number of waypoints and the duration of
+    its subtree, so finding a waypoint index or a time, and inserting or removing chunks is O(log N). Insert and Remove only copy
+    the chunks at the boundaries of the modified range. Sampling copies the two waypoints of the sampled segment into a GenericTrajectory,
+    so the interpolation is exactly the same as GenericTrajectory.
+
+    The SaveBinary command writes the trajectory to a binary file and LoadBinary maps such a file into memory. The chunk sizes
+    and durations are stored in a table at the beginning of the file, so the waypoints of a mapped chunk are only read when they
+    are sampled or accessed, and they are copied when the chunk is modified.
+ */
+class ChunkedTrajectory : public TrajectoryBase
+{
+    /// \brief a mapped binary file, unmapped when the last chunk referencing it is released
+    class MappedFile
+    {
+public:
+        MappedFile(void* pmapped, size_t size) : _pmapped(pmapped), _size(size) {
+        }
+        virtual ~MappedFile() {
+#ifdef CHUNKEDTRAJECTORY_HAS_MMAP
+            munmap(_pmapped, _size);
+#endif
+        }
+        void* _pmapped;
+        size_t _size;
+    };
+    typedef boost::shared_ptr<MappedFile> MappedFilePtr;
+
+    /// \brief one chunk of consecutive waypoints and the treap node holding it
+    class Node
+    {
+public:
+        Node() : priority(0), subtreepoints(0), subtreeduration(0), pdata(NULL), numpoints(0), duration(0) {
+        }
+        boost::shared_ptr<Node> left, right;
+        uint32_t priority;
+        size_t subtreepoints; ///< number of waypoints in the subtree
+        dReal subtreeduration; ///< sum of the delta times of the subtree
+
+        const dReal* pdata; ///< points to vdata or inside of the mapped file
+        std::vector<dReal> vdata; ///< the waypoints if the chunk is not mapped
+        MappedFilePtr pmapping; ///< the mapped file pdata points into, if any
+        size_t numpoints;
+        dReal duration; ///< sum of the delta times of the chunk
+        std::vector<dReal> vaccumtime; ///< accumulated delta times inside the chunk, computed when the chunk is first searched by time
+    };
+    typedef boost::shared_ptr<Node> NodePtr;
+
+    /// \brief header of the binary file, followed by the specification, the chunk table and the waypoints
+    struct BinaryHeader
+    {
+        char magic[8];
+        uint32_t version;
+        uint32_t realsize; ///< sizeof(dReal) of the writer
+        uint64_t speclength; ///< length of the serialized configuration specification
+        uint64_t numchunks;
+        uint64_t numpoints;
+    };
+
+public:
+    ChunkedTrajectory(EnvironmentBasePtr penv, std::istream& sinput) : TrajectoryBase(penv), _timeoffset(-1), _bInit(false), _nChunkSize(1024), _nPrioritySeed(0x9e3779b9), _nChangeStamp(0), _nSegmentStamp(0), _segmentindex(0)
+    {
+        __description = ":Interface Author: Rosen Diankov\n\nTrajectory storing its waypoints in a rope of fixed-size chunks, insertions and removals are O(log N). Binary trajectory files can be memory-mapped with LoadBinary.";
+        RegisterCommand("SaveBinary",boost::bind(&ChunkedTrajectory::_SaveBinaryCommand,this,_1,_2),
+                        "Writes the trajectory to the binary file given as the argument.");
+        RegisterCommand("LoadBinary",boost::bind(&ChunkedTrajectory::_LoadBinaryCommand,this,_1,_2),
+                        "Maps the binary file given as the argument, the waypoints are read as they are accessed.");
+        RegisterCommand("SetChunkSize",boost::bind(&ChunkedTrajectory::_SetChunkSizeCommand,this,_1,_2),
+                        "Sets the maximum number of waypoints of the chunks created from now on, default is 1024.");
+    }
+
+    void Init(const ConfigurationSpecification& spec)
+    {
+        if( !_bInit || !(_spec == spec) ) {
+            BOOST_ASSERT(spec.GetDOF()>0 && spec.IsValid());
+            _spec = spec;
+            _timeoffset = -1;
+            FOREACH(itgroup,_spec._vgroups) {
+                if( itgroup->name == "deltatime" ) {
+                    _timeoffset = itgroup->offset;
+                }
+            }
+            if( !_psegmenttraj ) {
+                _psegmenttraj = RaveCreateTrajectory(GetEnv(),"GenericTrajectory");
+            }
+            _psegmenttraj->Init(_spec);
+        }
+        _proot.reset();
+        ++_nChangeStamp;
+        _bInit = true;
+    }
+
+    void Insert(size_t index, const std::vector<dReal>& data, bool bOverwrite)
+    {
+        BOOST_ASSERT(_bInit);
+        if( data.size() == 0 ) {
+            return;
+        }
+        int dof = _spec.GetDOF();
+        OPENRAVE_ASSERT_FORMAT((data.size()%dof) == 0, "%d does not divide dof %d", data.size()%dof%dof, ORE_InvalidArguments);
+        size_t numpoints = data.size()/dof, totalpoints = GetNumWaypoints();
+        OPENRAVE_ASSERT_OP(index,<=,totalpoints);
+        if( bOverwrite && index < totalpoints ) {
+            size_t copypoints = min(numpoints,totalpoints-index);
+            _OverwritePoints(_proot, index, data.begin(), copypoints);
+            if( copypoints < numpoints ) {
+                _InsertPoints(totalpoints, data.begin()+copypoints*dof, numpoints-copypoints);
+            }
+        }
+        else {
+            _InsertPoints(index, data.begin(), numpoints);
+        }
+        ++_nChangeStamp;
+    }
+
+    void Insert(size_t index, const std::vector<dReal>& data, const ConfigurationSpecification& spec, bool bOverwrite)
+    {
+        BOOST_ASSERT(_bInit);
+        if( data.size() == 0 ) {
+            return;
+        }
+        BOOST_ASSERT(spec.GetDOF()>0);
+        OPENRAVE_ASSERT_FORMAT((data.size()%spec.GetDOF()) == 0, "%d does not divide dof %d", data.size()%spec.GetDOF()%spec.GetDOF(), ORE_InvalidArguments);
+        if( _spec == spec ) {
+            Insert(index,data,bOverwrite);
+            return;
+        }
+        size_t numpoints = data.size()/spec.GetDOF(), totalpoints = GetNumWaypoints();
+        OPENRAVE_ASSERT_OP(index,<=,totalpoints);
+        size_t sourceindex = 0;
+        std::vector<dReal> vtemp;
+        if( bOverwrite && index < totalpoints ) {
+            // the values of the trajectory not in spec have to be kept
+            size_t copypoints = min(numpoints,totalpoints-index);
+            GetWaypoints(index, index+copypoints, vtemp);
+            ConfigurationSpecification::Converter(_spec,spec,GetEnv(),false).Convert(vtemp.begin(),data.begin(),copypoints);
+            _OverwritePoints(_proot, index, vtemp.begin(), copypoints);
+            sourceindex = copypoints*spec.GetDOF();
+            index += copypoints;
+        }
+        if( sourceindex < data.size() ) {
+            size_t numelements = (data.size()-sourceindex)/spec.GetDOF();
+            vtemp.resize(numelements*_spec.GetDOF());
+            ConfigurationSpecification::Converter(_spec,spec,GetEnv(),true,false).Convert(vtemp.begin(),data.begin()+sourceindex,numelements);
+            _InsertPoints(index, vtemp.begin(), numelements);
+        }
+        ++_nChangeStamp;
+    }
+
+    void Remove(size_t startindex, size_t endindex)
+    {
+        BOOST_ASSERT(_bInit);
+        if( startindex == endindex ) {
+            return;
+        }
+        OPENRAVE_ASSERT_OP(startindex,<,endindex);
+        OPENRAVE_ASSERT_OP(endindex,<=,GetNumWaypoints());
+        NodePtr left, middle, right;
+        _Split(_proot, startindex, left, middle);
+        _Split(middle, endindex-startindex, middle, right);
+        _proot = _Merge(left, right);
+        // the chunks cut at the boundaries can be small, so join them if they fit in one chunk
+        _JoinChunksAt(startindex);
+        ++_nChangeStamp;
+    }
+
+    void Sample(std::vector<dReal>& data, dReal time) const
+    {
+        BOOST_ASSERT(_bInit);
+        BOOST_ASSERT(_timeoffset>=0);
+        BOOST_ASSERT(time >= 0);
+        size_t numpoints = GetNumWaypoints();
+        OPENRAVE_ASSERT_OP(numpoints,>,0);
+        if( time >= GetDuration() ) {
+            data.resize(_spec.GetDOF());
+            _CopyPoints(_proot, numpoints-1, 1, data.begin());
+        }
+        else {
+            dReal segmentstarttime = 0;
+            boost::mutex::scoped_lock lock(_mutexsampling);
+            size_t index = _FindTime(time, segmentstarttime);
+            if( index == 0 ) {
+                data.resize(_spec.GetDOF());
+                _CopyPoints(_proot, 0, 1, data.begin());
+            }
+            else {
+                _LoadSegment(index-1);
+                _psegmenttraj->Sample(data, time-segmentstarttime);
+            }
+        }
+    }
+
+    void Sample(std::vector<dReal>& data, dReal time, const ConfigurationSpecification& spec) const
+    {
+        BOOST_ASSERT(_bInit);
+        BOOST_ASSERT(_timeoffset>=0);
+        BOOST_ASSERT(time >= -g_fEpsilon);
+        size_t numpoints = GetNumWaypoints();
+        OPENRAVE_ASSERT_OP(numpoints,>,0);
+        if( time >= GetDuration() ) {
+            GetWaypoints(numpoints-1, numpoints, data, spec);
+        }
+        else {
+            dReal segmentstarttime = 0;
+            boost::mutex::scoped_lock lock(_mutexsampling);
+            size_t index = _FindTime(time, segmentstarttime);
+            if( index == 0 ) {
+                GetWaypoints(0, 1, data, spec);
+            }
+            else {
+                _LoadSegment(index-1);
+                _psegmenttraj->Sample(data, time-segmentstarttime, spec);
+            }
+        }
+    }
+
+    const ConfigurationSpecification& GetConfigurationSpecification() const
+    {
+        return _spec;
+    }
+
+    size_t GetNumWaypoints() const
+    {
+        BOOST_ASSERT(_bInit);
+        return !_proot ? 0 : _proot->subtreepoints;
+    }
+
+    void GetWaypoints(size_t startindex, size_t endindex, std::vector<dReal>& data) const
+    {
+        BOOST_ASSERT(_bInit);
+        BOOST_ASSERT(startindex<=endindex && endindex <= GetNumWaypoints());
+        data.resize((endindex-startindex)*_spec.GetDOF(),0);
+        _CopyPoints(_proot, startindex, endindex-startindex, data.begin());
+    }
+
+    void GetWaypoints(size_t startindex, size_t endindex, std::vector<dReal>& data, const ConfigurationSpecification& spec) const
+    {
+        BOOST_ASSERT(_bInit);
+        BOOST_ASSERT(startindex<=endindex && endindex <= GetNumWaypoints());
+        data.resize(spec.GetDOF()*(endindex-startindex),0);
+        if( startindex < endindex ) {
+            std::vector<dReal> vinternaldata;
+            GetWaypoints(startindex, endindex, vinternaldata);
+            ConfigurationSpecification::ConvertData(data.begin(),spec,vinternaldata.begin(),_spec,endindex-startindex,GetEnv());
+        }
+    }
+
+    size_t GetFirstWaypointIndexAfterTime(dReal time) const
+    {
+        BOOST_ASSERT(_bInit);
+        BOOST_ASSERT(_timeoffset>=0);
+        if( !_proot ) {
+            return 0;
+        }
+        if( time >= GetDuration() ) {
+            return GetNumWaypoints();
+        }
+        dReal segmentstarttime = 0;
+        boost::mutex::scoped_lock lock(_mutexsampling);
+        return _FindTime(time, segmentstarttime);
+    }
+
+    dReal GetDuration() const
+    {
+        BOOST_ASSERT(_bInit);
+        return !_proot ? 0 : _proot->subtreeduration;
+    }
+
+    void Clone(InterfaceBaseConstPtr preference, int cloningoptions)
+    {
+        boost::shared_ptr<ChunkedTrajectory const> r = boost::dynamic_pointer_cast<ChunkedTrajectory const>(preference);
+        if( !r ) {
+            TrajectoryBase::Clone(preference,cloningoptions);
+            return;
+        }
+        InterfaceBase::Clone(preference,cloningoptions);
+        Init(r->_spec);
+        _nChunkSize = r->_nChunkSize;
+        // the lazily computed accumulated times of the reference can change while it is sampled
+        boost::mutex::scoped_lock lock(r->_mutexsampling);
+        _proot = _CloneTree(r->_proot);
+    }
+
+    void Swap(TrajectoryBasePtr rawtraj)
+    {
+        OPENRAVE_ASSERT_OP(GetXMLId(),==,rawtraj->GetXMLId());
+        boost::shared_ptr<ChunkedTrajectory> traj = boost::dynamic_pointer_cast<ChunkedTrajectory>(rawtraj);
+        _spec.Swap(traj->_spec);
+        std::swap(_timeoffset, traj->_timeoffset);
+        std::swap(_bInit, traj->_bInit);
+        std::swap(_nChunkSize, traj->_nChunkSize);
+        std::swap(_proot, traj->_proot);
+        std::swap(_psegmenttraj, traj->_psegmenttraj);
+        ++_nChangeStamp;
+        ++traj->_nChangeStamp;
+    }
+
+protected:
+    static inline size_t _GetPoints(const NodePtr& node) {
+        return !node ? 0 : node->subtreepoints;
+    }
+
+    static inline dReal _GetDuration(const NodePtr& node) {
+        return !node ? 0 : node->subtreeduration;
+    }
+
+    static inline void _Update(const NodePtr& node) {
+        node->subtreepoints = _GetPoints(node->left) + node->numpoints + _GetPoints(node->right);
+        node->subtreeduration = _GetDuration(node->left) + node->duration + _GetDuration(node->right);
+    }
+
+    /// \brief recomputes the duration of the chunk from its delta times
+    void _UpdateChunk(const NodePtr& node) const
+    {
+        node->duration = 0;
+        node->vaccumtime.resize(0);
+        if( _timeoffset >= 0 ) {
+            int dof = _spec.GetDOF();
+            for(size_t i = 0; i < node->numpoints; ++i) {
+                node->duration += node->pdata[i*dof+_timeoffset];
+            }
+        }
+    }
+
+    /// \brief copies the nodes of the tree, mapped chunks keep pointing into the same mapped file
+    static NodePtr _CloneTree(const NodePtr& node)
+    {
+        if( !node ) {
+            return NodePtr();
+        }
+        NodePtr newnode(new Node(*node));
+        newnode->left = _CloneTree(node->left);
+        newnode->right = _CloneTree(node->right);
+        if( !newnode->pmapping ) {
+            newnode->pdata = newnode->vdata.size() > 0 ? &newnode->vdata[0] : NULL;
+        }
+        return newnode;
+    }
+
+    /// \brief copies the waypoints of a mapped chunk so that they can be modified
+    void _MakeChunkWritable(const NodePtr& node) const
+    {
+        if( !!node->pmapping ) {
+            node->vdata.resize(node->numpoints*_spec.GetDOF());
+            std::copy(node->pdata, node->pdata+node->vdata.size(), node->vdata.begin());
+            node->pmapping.reset();
+        }
+        node->pdata = node->vdata.size() > 0 ? &node->vdata[0] : NULL;
+    }
+
+    /// \brief creates a node with a random priority and no waypoints
+    NodePtr _CreateEmptyNode()
+    {
+        NodePtr node(new Node());
+        // xorshift, the priorities only have to look random
+        _nPrioritySeed ^= _nPrioritySeed << 13;
+        _nPrioritySeed ^= _nPrioritySeed >> 17;
+        _nPrioritySeed ^= _nPrioritySeed << 5;
+        node->priority = _nPrioritySeed;
+        return node;
+    }
+
+    NodePtr _CreateNode(std::vector<dReal>::const_iterator itdata, size_t numpoints)
+    {
+        NodePtr node = _CreateEmptyNode();
+        node->vdata.resize(numpoints*_spec.GetDOF());
+        std::copy(itdata, itdata+node->vdata.size(), node->vdata.begin());
+        node->numpoints = numpoints;
+        _MakeChunkWritable(node);
+        _UpdateChunk(node);
+        _Update(node);
+        return node;
+    }
+
+    NodePtr _Merge(NodePtr left, NodePtr right)
+    {
+        if( !left ) {
+            return right;
+        }
+        if( !right ) {
+            return left;
+        }
+        if( left->priority > right->priority ) {
+            left->right = _Merge(left->right, right);
+            _Update(left);
+            return left;
+        }
+        else {
+            right->left = _Merge(left, right->left);
+            _Update(right);
+            return right;
+        }
+    }
+
+    /// \brief splits the tree so that left holds the first index waypoints, the chunk containing index is split in two if necessary
+    void _Split(NodePtr node, size_t index, NodePtr& left, NodePtr& right)
+    {
+        if( !node ) {
+            left.reset();
+            right.reset();
+            return;
+        }
+        size_t leftpoints = _GetPoints(node->left);
+        if( index <= leftpoints ) {
+            _Split(node->left, index, left, node->left);
+            _Update(node);
+            right = node;
+        }
+        else if( index >= leftpoints + node->numpoints ) {
+            _Split(node->right, index-leftpoints-node->numpoints, node->right, right);
+            _Update(node);
+            left = node;
+        }
+        else {
+            size_t localindex = index - leftpoints;
+            int dof = _spec.GetDOF();
+            NodePtr newnode;
+            if( !!node->pmapping ) {
+                // both parts can keep pointing into the mapped file
+                newnode = _CreateEmptyNode();
+                newnode->pmapping = node->pmapping;
+                newnode->pdata = node->pdata + localindex*dof;
+                newnode->numpoints = node->numpoints - localindex;
+                _UpdateChunk(newnode);
+                _Update(newnode);
+            }
+            else {
+                newnode = _CreateNode(node->vdata.begin()+localindex*dof, node->numpoints - localindex);
+                node->vdata.resize(localindex*dof);
+                _MakeChunkWritable(node);
+            }
+            // newnode is merged with the right subtree of node and ends up below the parents of node, so it has to keep the
+            // priority of node for the heap order to hold
+            newnode->priority = node->priority;
+            node->numpoints = localindex;
+            _UpdateChunk(node);
+            right = _Merge(newnode, node->right);
+            node->right.reset();
+            _Update(node);
+            left = node;
+        }
+    }
+
+    /// \brief builds a tree of chunks of about the same size from consecutive waypoints
+    NodePtr _BuildTree(std::vector<dReal>::const_iterator itdata, size_t numpoints)
+    {
+        NodePtr root;
+        if( numpoints == 0 ) {
+            return root;
+        }
+        size_t numchunks = (numpoints+_nChunkSize-1)/_nChunkSize;
+        size_t startpoint = 0;
+        for(size_t ichunk = 0; ichunk < numchunks; ++ichunk) {
+            size_t endpoint = (numpoints*(ichunk+1))/numchunks;
+            root = _Merge(root, _CreateNode(itdata+startpoint*_spec.GetDOF(), endpoint-startpoint));
+            startpoint = endpoint;
+        }
+        return root;
+    }
+
+    /// \brief finds the chunk containing index. If index is at the end, returns the last chunk.
+    void _FindChunk(size_t index, size_t& chunkstart, size_t& chunkpoints) const
+    {
+        chunkstart = 0;
+        chunkpoints = 0;
+        NodePtr node = _proot;
+        while( !!node ) {
+            size_t leftpoints = _GetPoints(node->left);
+            if( index < leftpoints ) {
+                node = node->left;
+            }
+            else if( index < leftpoints + node->numpoints || !node->right ) {
+                chunkstart += leftpoints;
+                chunkpoints = node->numpoints;
+                return;
+            }
+            else {
+                index -= leftpoints + node->numpoints;
+                chunkstart += leftpoints + node->numpoints;
+                node = node->right;
+            }
+        }
+    }
+
+    /// \brief inserts the points inside the chunk containing index if it has enough space. Returns false if no chunk was modified.
+    bool _InsertInChunk(const NodePtr& node, size_t index, std::vector<dReal>::const_iterator itdata, size_t numpoints)
+    {
+        if( !node ) {
+            return false;
+        }
+        size_t leftpoints = _GetPoints(node->left);
+        bool bInserted;
+        if( index < leftpoints || (index == leftpoints && !!node->left) ) {
+            bInserted = _InsertInChunk(node->left, index, itdata, numpoints);
+        }
+        else if( index <= leftpoints + node->numpoints ) {
+            if( node->numpoints + numpoints > _nChunkSize ) {
+                return false;
+            }
+            int dof = _spec.GetDOF();
+            _MakeChunkWritable(node);
+            node->vdata.insert(node->vdata.begin()+(index-leftpoints)*dof, itdata, itdata+numpoints*dof);
+            node->numpoints += numpoints;
+            _MakeChunkWritable(node);
+            _UpdateChunk(node);
+            bInserted = true;
+        }
+        else {
+            bInserted = _InsertInChunk(node->right, index-leftpoints-node->numpoints, itdata, numpoints);
+        }
+        if( bInserted ) {
+            _Update(node);
+        }
+        return bInserted;
+    }
+
+    void _InsertPoints(size_t index, std::vector<dReal>::const_iterator itdata, size_t numpoints)
+    {
+        if( _InsertInChunk(_proot, index, itdata, numpoints) ) {
+            return;
+        }
+        // rebuild the chunk containing index together with the new points
+        int dof = _spec.GetDOF();
+        size_t chunkstart, chunkpoints;
+        _FindChunk(index, chunkstart, chunkpoints);
+        NodePtr left, middle, right;
+        _Split(_proot, chunkstart, left, middle);
+        _Split(middle, chunkpoints, middle, right);
+        std::vector<dReal> vpoints((chunkpoints+numpoints)*dof);
+        _CopyPoints(middle, 0, chunkpoints, vpoints.begin());
+        std::copy_backward(vpoints.begin()+(index-chunkstart)*dof, vpoints.begin()+chunkpoints*dof, vpoints.end());
+        std::copy(itdata, itdata+numpoints*dof, vpoints.begin()+(index-chunkstart)*dof);
+        _proot = _Merge(_Merge(left, _BuildTree(vpoints.begin(), chunkpoints+numpoints)), right);
+    }
+
+    void _OverwritePoints(const NodePtr& node, size_t index, std::vector<dReal>::const_iterator itdata, size_t numpoints)
+    {
+        if( !node || numpoints == 0 ) {
+            return;
+        }
+        int dof = _spec.GetDOF();
+        size_t leftpoints = _GetPoints(node->left);
+        if( index < leftpoints ) {
+            size_t leftcopy = min(numpoints, leftpoints-index);
+            _OverwritePoints(node->left, index, itdata, leftcopy);
+            itdata += leftcopy*dof;
+            numpoints -= leftcopy;
+            index = leftpoints;
+        }
+        if( numpoints > 0 && index < leftpoints + node->numpoints ) {
+            size_t localindex = index - leftpoints;
+            size_t chunkcopy = min(numpoints, node->numpoints-localindex);
+            _MakeChunkWritable(node);
+            std::copy(itdata, itdata+chunkcopy*dof, node->vdata.begin()+localindex*dof);
+            _UpdateChunk(node);
+            itdata += chunkcopy*dof;
+            numpoints -= chunkcopy;
+            index += chunkcopy;
+        }
+        if( numpoints > 0 ) {
+            _OverwritePoints(node->right, index-leftpoints-node->numpoints, itdata, numpoints);
+        }
+        _Update(node);
+    }
+
+    /// \brief copies numpoints waypoints starting at index to itdata
+    void _CopyPoints(const NodePtr& node, size_t index, size_t numpoints, std::vector<dReal>::iterator itdata) const
+    {
+        if( !node || numpoints == 0 ) {
+            return;
+        }
+        int dof = _spec.GetDOF();
+        size_t leftpoints = _GetPoints(node->left);
+        if( index < leftpoints ) {
+            size_t leftcopy = min(numpoints, leftpoints-index);
+            _CopyPoints(node->left, index, leftcopy, itdata);
+            itdata += leftcopy*dof;
+            numpoints -= leftcopy;
+            index = leftpoints;
+        }
+        if( numpoints > 0 && index < leftpoints + node->numpoints ) {
+            size_t localindex = index - leftpoints;
+            size_t chunkcopy = min(numpoints, node->numpoints-localindex);
+            std::copy(node->pdata+localindex*dof, node->pdata+(localindex+chunkcopy)*dof, itdata);
+            itdata += chunkcopy*dof;
+            numpoints -= chunkcopy;
+            index += chunkcopy;
+        }
+        if( numpoints > 0 ) {
+            _CopyPoints(node->right, index-leftpoints-node->numpoints, numpoints, itdata);
+        }
+    }
+
+    /// \brief joins the chunks before and after index if they fit in one chunk
+    void _JoinChunksAt(size_t index)
+    {
+        size_t numpoints = GetNumWaypoints();
+        if( index == 0 || index >= numpoints ) {
+            return;
+        }
+        size_t prevstart, prevpoints, nextstart, nextpoints;
+        _FindChunk(index-1, prevstart, prevpoints);
+        _FindChunk(index, nextstart, nextpoints);
+        if( prevstart == nextstart || prevpoints + nextpoints > _nChunkSize ) {
+            return;
+        }
+        NodePtr left, middle, right;
+        _Split(_proot, prevstart, left, middle);
+        _Split(middle, prevpoints+nextpoints, middle, right);
+        std::vector<dReal> vpoints((prevpoints+nextpoints)*_spec.GetDOF());
+        _CopyPoints(middle, 0, prevpoints+nextpoints, vpoints.begin());
+        _proot = _Merge(_Merge(left, _BuildTree(vpoints.begin(), prevpoints+nextpoints)), right);
+    }
+
+    /// \brief returns the first waypoint index whose accumulated time is not less than time, same as std::lower_bound on the accumulated times
+    ///
+    /// \param[out] prevtime the accumulated time of the waypoint before the returned index
+    /// Fills the accumulated times of the chunk it ends in if they are not computed yet, so _mutexsampling has to be locked.
+    size_t _FindTime(dReal time, dReal& prevtime) const
+    {
+        int dof = _spec.GetDOF();
+        size_t index = 0;
+        dReal starttime = 0;
+        prevtime = 0;
+        NodePtr node = _proot;
+        while( !!node ) {
+            if( !!node->left && time <= starttime + node->left->subtreeduration ) {
+                node = node->left;
+                continue;
+            }
+            starttime += _GetDuration(node->left);
+            index += _GetPoints(node->left);
+            if( time <= starttime + node->duration ) {
+                if( node->vaccumtime.size() != node->numpoints ) {
+                    node->vaccumtime.resize(node->numpoints);
+                    dReal accumtime = 0;
+                    for(size_t i = 0; i < node->numpoints; ++i) {
+                        accumtime += node->pdata[i*dof+_timeoffset];
+                        node->vaccumtime[i] = accumtime;
+                    }
+                }
+                size_t localindex = std::lower_bound(node->vaccumtime.begin(), node->vaccumtime.end(), time-starttime) - node->vaccumtime.begin();
+                prevtime = localindex > 0 ? starttime + node->vaccumtime[localindex-1] : starttime;
+                return index + localindex;
+            }
+            starttime += node->duration;
+            index += node->numpoints;
+            prevtime = starttime;
+            node = node->right;
+        }
+        return index;
+    }
+
+    /// \brief copies waypoints ipoint and ipoint+1 to the segment trajectory, the first one with a zero delta time
+    ///
+    /// _mutexsampling has to be locked until the segment trajectory is sampled.
+    void _LoadSegment(size_t ipoint) const
+    {
+        if( _nSegmentStamp == _nChangeStamp && _segmentindex == ipoint ) {
+            return;
+        }
+        _vsegmentdata.resize(2*_spec.GetDOF());
+        _CopyPoints(_proot, ipoint, 2, _vsegmentdata.begin());
+        _vsegmentdata.at(_timeoffset) = 0;
+        _psegmenttraj->Insert(0, _vsegmentdata, true);
+        _segmentindex = ipoint;
+        _nSegmentStamp = _nChangeStamp;
+    }
+
+    bool _SaveBinaryCommand(std::ostream& sout, std::istream& sinput)
+    {
+        std::string filename;
+        sinput >> filename;
+        if( !sinput ) {
+            return false;
+        }
+        return _SaveBinary(filename);
+    }
+
+    bool _LoadBinaryCommand(std::ostream& sout, std::istream& sinput)
+    {
+        std::string filename;
+        sinput >> filename;
+        if( !sinput ) {
+            return false;
+        }
+        return _LoadBinary(filename);
+    }
+
+    bool _SetChunkSizeCommand(std::ostream& sout, std::istream& sinput)
+    {
+        size_t chunksize = 0;
+        sinput >> chunksize;
+        if( !sinput || chunksize == 0 ) {
+            return false;
+        }
+        _nChunkSize = chunksize;
+        return true;
+    }
+
+    static void _GetChunks(const NodePtr& node, std::vector<NodePtr>& vchunks)
+    {
+        if( !!node ) {
+            _GetChunks(node->left, vchunks);
+            vchunks.push_back(node);
+            _GetChunks(node->right, vchunks);
+        }
+    }
+
+    static size_t _GetPaddedSize(size_t size) {
+        return (size+7)&~size_t(7);
+    }
+
+    bool _SaveBinary(const std::string& filename)
+    {
+        BOOST_ASSERT(_bInit);
+        std::vector<NodePtr> vchunks;
+        _GetChunks(_proot, vchunks);
+        std::stringstream ss;
+        ss << std::setprecision(std::numeric_limits<dReal>::digits10+1) << _spec;
+        std::string specstring = ss.str();
+
+        BinaryHeader header;
+        memset(&header, 0, sizeof(header));
+        memcpy(header.magic, "ravetrj", 8);
+        header.version = s_nChunkedTrajectoryVersion;
+        header.realsize = sizeof(dReal);
+        header.speclength = specstring.size();
+        header.numchunks = vchunks.size();
+        header.numpoints = GetNumWaypoints();
+        std::vector<uint8_t> vpadding(8,0);
+        std::vector<uint64_t> vchunkpoints(vchunks.size());
+        std::vector<dReal> vchunkdurations(vchunks.size());
+        for(size_t i = 0; i < vchunks.size(); ++i) {
+            vchunkpoints[i] = vchunks[i]->numpoints;
+            vchunkdurations[i] = vchunks[i]->duration;
+        }
+
+        // the chunks can be mapped from filename, so write to a new file and replace filename once everything is written.
+        // the old mapping keeps referencing the replaced file.
+        std::string tempfilename = filename + ".tmp";
+        FILE* pfile = fopen(tempfilename.c_str(), "wb");
+        if( !pfile ) {
+            RAVELOG_WARN_FORMAT("failed to open %s for writing", tempfilename);
+            return false;
+        }
+        bool bsuccess = fwrite(&header, sizeof(header), 1, pfile) == 1;
+        bsuccess &= specstring.size() == 0 || fwrite(&specstring[0], specstring.size(), 1, pfile) == 1;
+        bsuccess &= fwrite(&vpadding[0], _GetPaddedSize(specstring.size())-specstring.size(), 1, pfile) <= 1;
+        if( vchunks.size() > 0 ) {
+            bsuccess &= fwrite(&vchunkpoints[0], sizeof(uint64_t)*vchunkpoints.size(), 1, pfile) == 1;
+            bsuccess &= fwrite(&vchunkdurations[0], sizeof(dReal)*vchunkdurations.size(), 1, pfile) == 1;
+            bsuccess &= fwrite(&vpadding[0], _GetPaddedSize(sizeof(dReal)*vchunkdurations.size())-sizeof(dReal)*vchunkdurations.size(), 1, pfile) <= 1;
+        }
+        FOREACH(itchunk, vchunks) {
+            if( (*itchunk)->numpoints > 0 ) {
+                bsuccess &= fwrite((*itchunk)->pdata, sizeof(dReal)*(*itchunk)->numpoints*_spec.GetDOF(), 1, pfile) == 1;
+            }
+        }
+        bsuccess &= fclose(pfile) == 0;
+        if( !bsuccess ) {
+            RAVELOG_WARN_FORMAT("failed to write %s", tempfilename);
+            remove(tempfilename.c_str());
+            return false;
+        }
+#ifdef _WIN32
+        // rename does not replace existing files
+        remove(filename.c_str());
+#endif
+        if( rename(tempfilename.c_str(), filename.c_str()) != 0 ) {
+            RAVELOG_WARN_FORMAT("failed to rename %s to %s", tempfilename%filename);
+            remove(tempfilename.c_str());
+            return false;
+        }
+        return true;
+    }
+
+    bool _LoadBinary(const std::string& filename)
+    {
+        std::vector<uint8_t> vfiledata;
+        const uint8_t* pfiledata = NULL;
+        size_t filesize = 0;
+        MappedFilePtr pmapping;
+#ifdef CHUNKEDTRAJECTORY_HAS_MMAP
+        int fd = open(filename.c_str(), O_RDONLY);
+        if( fd < 0 ) {
+            return false;
+        }
+        struct stat filestat;
+        if( fstat(fd, &filestat) != 0 || (size_t)filestat.st_size < sizeof(BinaryHeader) ) {
+            close(fd);
+            return false;
+        }
+        void* pmapped = mmap(NULL, filestat.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        close(fd);
+        if( pmapped == MAP_FAILED ) {
+            return false;
+        }
+        pmapping.reset(new MappedFile(pmapped, filestat.st_size));
+        pfiledata = (const uint8_t*)pmapped;
+        filesize = filestat.st_size;
+#else
+        FILE* pfile = fopen(filename.c_str(), "rb");
+        if( !pfile ) {
+            return false;
+        }
+        fseek(pfile, 0, SEEK_END);
+        vfiledata.resize(ftell(pfile));
+        fseek(pfile, 0, SEEK_SET);
+        bool bread = vfiledata.size() >= sizeof(BinaryHeader) && fread(&vfiledata[0], vfiledata.size(), 1, pfile) == 1;
+        fclose(pfile);
+        if( !bread ) {
+            return false;
+        }
+        pfiledata = &vfiledata[0];
+        filesize = vfiledata.size();
+#endif
+        BinaryHeader header;
+        memcpy(&header, pfiledata, sizeof(header));
+        if( memcmp(header.magic, "ravetrj", 8) != 0 || header.version != s_nChunkedTrajectoryVersion || header.realsize != sizeof(dReal) ) {
+            RAVELOG_WARN_FORMAT("%s is not a binary trajectory of version %d", filename%s_nChunkedTrajectoryVersion);
+            return false;
+        }
+        // every size read from the file is bounded by filesize before it is used in any arithmetic, so nothing can overflow
+        size_t specoffset = sizeof(BinaryHeader);
+        if( header.speclength > filesize-specoffset ) {
+            RAVELOG_WARN_FORMAT("%s is truncated", filename);
+            return false;
+        }
+        size_t tableoffset = specoffset + _GetPaddedSize(header.speclength);
+        // every chunk has one entry in the points and durations tables
+        if( tableoffset > filesize || header.numchunks > (filesize-tableoffset)/(sizeof(uint64_t)+sizeof(dReal)) ) {
+            RAVELOG_WARN_FORMAT("%s is truncated", filename);
+            return false;
+        }
+        size_t numchunks = header.numchunks;
+        size_t dataoffset = tableoffset + sizeof(uint64_t)*numchunks + _GetPaddedSize(sizeof(dReal)*numchunks);
+        if( dataoffset > filesize ) {
+            RAVELOG_WARN_FORMAT("%s is truncated", filename);
+            return false;
+        }
+        ConfigurationSpecification spec;
+        std::stringstream ss(std::string((const char*)pfiledata+specoffset, header.speclength));
+        ss >> spec;
+        if( spec.GetDOF() <= 0 ) {
+            RAVELOG_WARN_FORMAT("%s has an invalid configuration specification", filename);
+            return false;
+        }
+        size_t pointsize = sizeof(dReal)*spec.GetDOF();
+        size_t filepoints = (filesize-dataoffset)/pointsize;
+        if( (filesize-dataoffset) % pointsize != 0 || header.numpoints != filepoints ) {
+            RAVELOG_WARN_FORMAT("%s has %d waypoints, but the header says %d", filename%filepoints%header.numpoints);
+            return false;
+        }
+        const uint64_t* pchunkpoints = (const uint64_t*)(pfiledata+tableoffset);
+        const dReal* pchunkdurations = (const dReal*)(pfiledata+tableoffset+sizeof(uint64_t)*numchunks);
+        size_t remainingpoints = filepoints;
+        for(size_t ichunk = 0; ichunk < numchunks; ++ichunk) {
+            if( pchunkpoints[ichunk] > remainingpoints ) {
+                RAVELOG_WARN_FORMAT("chunk %d of %s is out of the file", ichunk%filename);
+                return false;
+            }
+            remainingpoints -= pchunkpoints[ichunk];
+        }
+        if( remainingpoints != 0 ) {
+            RAVELOG_WARN_FORMAT("the chunks of %s do not cover all the waypoints", filename);
+            return false;
+        }
+
+        Init(spec);
+        const dReal* pdata = (const dReal*)(pfiledata+dataoffset);
+        for(size_t ichunk = 0; ichunk < numchunks; ++ichunk) {
+            if( pchunkpoints[ichunk] == 0 ) {
+                continue;
+            }
+            if( !pmapping ) {
+                std::vector<dReal> vchunkdata(pdata, pdata+pchunkpoints[ichunk]*spec.GetDOF());
+                _proot = _Merge(_proot, _CreateNode(vchunkdata.begin(), pchunkpoints[ichunk]));
+            }
+            else {
+                NodePtr node = _CreateEmptyNode();
+                node->pmapping = pmapping;
+                node->pdata = pdata;
+                node->numpoints = pchunkpoints[ichunk];
+                // use the stored duration so that the waypoints are not read
+                node->duration = pchunkdurations[ichunk];
+                _Update(node);
+                _proot = _Merge(_proot, node);
+            }
+            pdata += pchunkpoints[ichunk]*spec.GetDOF();
+        }
+        ++_nChangeStamp;
+        return true;
+    }
+
+    ConfigurationSpecification _spec;
+    int _timeoffset;
+    bool _bInit;
+    size_t _nChunkSize; ///< maximum number of waypoints of a chunk
+    uint32_t _nPrioritySeed;
+    NodePtr _proot;
+
+    TrajectoryBasePtr _psegmenttraj; ///< GenericTrajectory holding the last sampled segment
+    uint32_t _nChangeStamp; ///< incremented whenever the waypoints change
+    mutable uint32_t _nSegmentStamp; ///< _nChangeStamp when the segment was loaded
+    mutable size_t _segmentindex; ///< index of the first waypoint of the loaded segment
+    mutable std::vector<dReal> _vsegmentdata;
+    mutable boost::mutex _mutexsampling; ///< protects the loaded segment and the accumulated times of the chunks, which the const sampling functions fill
+};
+
+TrajectoryBasePtr CreateChunkedTrajectory(EnvironmentBasePtr penv, std::istream& sinput)
+{
+    return TrajectoryBasePtr(new ChunkedTrajectory(penv,sinput));
+}
+
+}
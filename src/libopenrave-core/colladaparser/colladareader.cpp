@@ -63,13 +63,15 @@ public:
                         return NULL;
                     }
                     // remove first slash because we need relative file
-                    std::string docurifull="file:";
+                    std::string docurifull="file:", docfilename;
                     if( uriNativePath.at(0) == '/' ) {
-                        docurifull += cdom::nativePathToUri(RaveFindLocalFile(uriNativePath.substr(1), "/"));
+                        docfilename = SceneLoadRecorder::FindLocalFile(uriNativePath.substr(1), "/");
                     }
                     else {
-                        docurifull += cdom::nativePathToUri(RaveFindLocalFile(uriNativePath, "/"));
+                        docfilename = SceneLoadRecorder::FindLocalFile(uriNativePath, "/");
                     }
+                    SceneLoadRecorder::RecordFile(docfilename);
+                    docurifull += cdom::nativePathToUri(docfilename);
                     if( docurifull.size() == 5 ) {
                         RAVELOG_WARN(str(boost::format("daeOpenRAVEURIResolver::resolveElement() - Failed to resolve %s ")%uri.str()));
                         return NULL;
@@ -88,6 +90,12 @@ public:
                     }
                 }
                 else {
+                    if( uri.scheme() == "file" ) {
+                        SceneLoadRecorder::RecordFile(cdom::uriToFilePath(uri.path()));
+                    }
+                    else {
+                        SceneLoadRecorder::SetUncacheable(str(boost::format("it references %s")%docuri));
+                    }
                     dae->open(docuri);
                     doc = uri.getReferencedDocument();
                     if( !!doc && !!doc->getDocumentURI() ) {
@@ -277,14 +285,15 @@ public:
             // remove first slash because we need relative file
             uriresolved="file:";
             if( urioriginal.path().at(0) == '/' ) {
-                uriresolved += RaveFindLocalFile(urioriginal.path().substr(1), "/");
+                uriresolved += SceneLoadRecorder::FindLocalFile(urioriginal.path().substr(1), "/");
             }
             else {
-                uriresolved += RaveFindLocalFile(urioriginal.path(), "/");
+                uriresolved += SceneLoadRecorder::FindLocalFile(urioriginal.path(), "/");
             }
             if( uriresolved.size() == 5 ) {
                 return false;
             }
+            SceneLoadRecorder::RecordFile(uriresolved.substr(5));
         }
         _dom = daeSafeCast<domCOLLADA>(_dae->open(uriresolved.size() > 0 ? uriresolved : urioriginal.str()));
         if( !_dom ) {
@@ -1971,6 +1980,7 @@ public:
                 }
                 RAVELOG_DEBUG(str(boost::format("joint dof: %d, links %s->%s\n")%pjoint->dofindex%plink->GetName()%pchildlink->GetName()));
                 pjoint->_ComputeInternalInformation(plink,pchildlink,tatt.trans,vAxes,std::vector<dReal>());
+                SceneLoadRecorder::RecordJointFrame(pjoint,std::vector<dReal>());
             }
             if( pdomlink->getAttachment_start_array().getCount() > 0 ) {
                 RAVELOG_WARN("openrave collada reader does not support attachment_start\n");
@@ -115,6 +115,12 @@ public:
         _homedirectory = RaveGetHomeDirectory();
         RAVELOG_DEBUG_FORMAT("setting openrave home directory to %s", _homedirectory);
 
+        // set OPENRAVE_SCENECACHE=1 to cache the bodies created by the files passed to Load
+        char* pscenecache = getenv("OPENRAVE_SCENECACHE"); // getenv not thread-safe?
+        if( !!pscenecache && string(pscenecache) == "1" ) {
+            _pSceneCache.reset(new SceneCache(_homedirectory + s_filesep + string("scenecache")));
+        }
+
         _nBodiesModifiedStamp = 0;
         _nEnvironmentIndex = 1;
 
@@ -127,6 +133,7 @@ public:
 
         _handlegenericrobot = RaveRegisterInterface(PT_Robot,"GenericRobot", RaveGetInterfaceHash(PT_Robot), GetHash(), CreateGenericRobot);
         _handlegenerictrajectory = RaveRegisterInterface(PT_Trajectory,"GenericTrajectory", RaveGetInterfaceHash(PT_Trajectory), GetHash(), CreateGenericTrajectory);
+        _handlechunkedtrajectory = RaveRegisterInterface(PT_Trajectory,"ChunkedTrajectory", RaveGetInterfaceHash(PT_Trajectory), GetHash(), CreateChunkedTrajectory);
         _handlemulticontroller = RaveRegisterInterface(PT_Controller,"GenericMultiController", RaveGetInterfaceHash(PT_Controller), GetHash(), CreateMultiController);
         _handlegenericphysicsengine = RaveRegisterInterface(PT_PhysicsEngine,"GenericPhysicsEngine", RaveGetInterfaceHash(PT_PhysicsEngine), GetHash(), CreateGenericPhysicsEngine);
         _handlegenericcollisionchecker = RaveRegisterInterface(PT_CollisionChecker,"GenericCollisionChecker", RaveGetInterfaceHash(PT_CollisionChecker), GetHash(), CreateGenericCollisionChecker);
@@ -436,9 +443,62 @@ public:
         return RaveParseColladaURI(shared_from_this(), uri, atts);
     }
 
+    /// \brief loads the file, using the scene cache when the same file was already loaded with the same attributes
     virtual bool Load(const std::string& filename, const AttributesList& atts)
     {
         EnvironmentMutex::scoped_lock lockenv(GetMutex());
+        // nested loads of environment files are recorded as part of the outer load. environment files configure the
+        // camera and background of the attached viewers, which the cache cannot reproduce, so skip it while any is attached
+        if( !_pSceneCache || !!SceneLoadRecorder::GetCurrent() || _IsColladaURI(filename) || !!GetViewer(std::string()) ) {
+            return _Load(filename, atts);
+        }
+        string fullfilename = RaveFindLocalFile(filename);
+        string cachefilename = _pSceneCache->GetCacheFilename(fullfilename, atts);
+        if( cachefilename.size() == 0 ) {
+            return _Load(filename, atts);
+        }
+        if( _pSceneCache->Read(shared_from_this(), cachefilename, fullfilename, atts) ) {
+            return true;
+        }
+
+        // anything besides adding new bodies cannot be reproduced from the cache
+        std::map<KinBody*, int> mapOldBodyStamps;
+        FOREACHC(itbody, _vecbodies) {
+            mapOldBodyStamps[itbody->get()] = (*itbody)->GetUpdateStamp();
+        }
+        size_t numModules = _listModules.size(), numSensors = _listSensors.size(), numViewers = _listViewers.size(), numOwnedInterfaces = _listOwnedInterfaces.size();
+        CollisionCheckerBasePtr pOldChecker = _pCurrentChecker;
+        PhysicsEngineBasePtr pOldPhysicsEngine = _pPhysicsEngine;
+
+        SceneLoadRecorder recorder;
+        if( !_Load(filename, atts) ) {
+            return false;
+        }
+        std::vector<KinBodyPtr> vnewbodies;
+        FOREACHC(itbody, _vecbodies) {
+            std::map<KinBody*, int>::iterator itold = mapOldBodyStamps.find(itbody->get());
+            if( itold == mapOldBodyStamps.end() ) {
+                vnewbodies.push_back(*itbody);
+            }
+            else {
+                if( itold->second != (*itbody)->GetUpdateStamp() ) {
+                    recorder._uncacheablereason = str(boost::format("it modified body %s")%(*itbody)->GetName());
+                }
+                mapOldBodyStamps.erase(itold);
+            }
+        }
+        if( mapOldBodyStamps.size() > 0 ) {
+            recorder._uncacheablereason = "it removed bodies";
+        }
+        if( numModules != _listModules.size() || numSensors != _listSensors.size() || numViewers != _listViewers.size() || numOwnedInterfaces != _listOwnedInterfaces.size() || pOldChecker != _pCurrentChecker || pOldPhysicsEngine != _pPhysicsEngine ) {
+            recorder._uncacheablereason = "it added interfaces other than bodies";
+        }
+        _pSceneCache->Write(cachefilename, fullfilename, atts, recorder, vnewbodies);
+        return true;
+    }
+
+    virtual bool _Load(const std::string& filename, const AttributesList& atts)
+    {
         OpenRAVEXMLParser::GetXMLErrorCount() = 0;
         if( _IsColladaURI(filename) ) {
             if( RaveParseColladaURI(shared_from_this(), filename, atts) ) {
@@ -570,6 +630,7 @@ public:
         if( !utils::IsValidName(pbody->GetName()) ) {
             throw openrave_exception(str(boost::format("kinbody name: \"%s\" is not valid")%pbody->GetName()));
         }
+        SceneLoadRecorder::RecordAddedBody(pbody, bAnonymous);
         if( !_CheckUniqueName(KinBodyConstPtr(pbody),!bAnonymous) ) {
             // continue to add random numbers until a unique name is found
             string oldname=pbody->GetName(),newname;
@@ -605,6 +666,7 @@ public:
         if( !utils::IsValidName(robot->GetName()) ) {
             throw openrave_exception(str(boost::format("kinbody name: \"%s\" is not valid")%robot->GetName()));
         }
+        SceneLoadRecorder::RecordAddedBody(robot, bAnonymous);
         if( !_CheckUniqueName(KinBodyConstPtr(robot),!bAnonymous) ) {
             // continue to add random numbers until a unique name is found
             string oldname=robot->GetName(),newname;
@@ -1848,6 +1910,7 @@ protected:
 
         _nBodiesModifiedStamp = r->_nBodiesModifiedStamp;
         _homedirectory = r->_homedirectory;
+        _pSceneCache = r->_pSceneCache;
         _fDeltaSimTime = r->_fDeltaSimTime;
         _nCurSimTime = 0;
         _nSimStartTime = utils::GetMicroTime();
@@ -2499,7 +2562,8 @@ protected:
 
     vector<KinBody::BodyState> _vPublishedBodies;
     string _homedirectory;
-    UserDataPtr _handlegenericrobot, _handlegenerictrajectory, _handlemulticontroller, _handlegenericphysicsengine, _handlegenericcollisionchecker;
+    SceneCachePtr _pSceneCache; ///< if set, caches the bodies created by Load
+    UserDataPtr _handlegenericrobot, _handlegenerictrajectory, _handlechunkedtrajectory, _handlemulticontroller, _handlegenericphysicsengine, _handlegenericcollisionchecker;
 
     list<InterfaceBasePtr> _listOwnedInterfaces;
 
@@ -42,6 +42,7 @@ public:
         _maporder["joint_values"] = 9;
         _maporder["affine_transform"] = 10;
         _maporder["joint_torques"] = 11;
+        _nSamplingStamp = 0;
         _bInit = false;
         _bSamplingVerified = false;
     }
@@ -82,6 +83,7 @@ public:
             _vdddoffsets.resize(0);
             _vintegraloffsets.resize(0);
             _spec = spec;
+            _listconverters.clear();
             // order the groups based on computation order
             stable_sort(_spec._vgroups.begin(),_spec._vgroups.end(),boost::bind(&GenericTrajectory::SortGroups,this,_1,_2));
             _timeoffset = -1;
@@ -135,10 +137,6 @@ public:
             Insert(index,data,bOverwrite);
         }
         else {
-            std::vector< std::vector<ConfigurationSpecification::Group>::const_iterator > vconvertgroups(_spec._vgroups.size());
-            for(size_t i = 0; i < vconvertgroups.size(); ++i) {
-                vconvertgroups[i] = spec.FindCompatibleGroup(_spec._vgroups[i]);
-            }
             size_t numpoints = data.size()/spec.GetDOF();
             size_t sourceindex = 0;
             std::vector<dReal>::iterator ittargetdata;
@@ -147,7 +145,8 @@ public:
                 size_t copyelements = min(numpoints,_vtrajdata.size()/_spec.GetDOF()-index);
                 ittargetdata = _vtrajdata.begin()+index*_spec.GetDOF();
                 itsourcedata = data.begin();
-                _ConvertData(ittargetdata,itsourcedata,vconvertgroups,spec,copyelements,false);
+                boost::mutex::scoped_lock lock(_mutexconverters);
+                _GetConverter(spec,false,false)->Convert(ittargetdata,itsourcedata,copyelements);
                 sourceindex = copyelements*spec.GetDOF();
                 index += copyelements;
             }
@@ -156,7 +155,10 @@ public:
                 std::vector<dReal> vtemp(numelements*_spec.GetDOF());
                 ittargetdata = vtemp.begin();
                 itsourcedata = data.begin()+sourceindex;
-                _ConvertData(ittargetdata,itsourcedata,vconvertgroups,spec,numelements,true);
+                {
+                    boost::mutex::scoped_lock lock(_mutexconverters);
+                    _GetConverter(spec,false,true,false)->Convert(ittargetdata,itsourcedata,numelements);
+                }
                 _vtrajdata.insert(_vtrajdata.begin()+index*_spec.GetDOF(),vtemp.begin(),vtemp.end());
             }
             _bChanged = true;
@@ -217,25 +219,26 @@ public:
         _VerifySampling();
         data.resize(0);
         data.resize(spec.GetDOF(),0);
+        boost::mutex::scoped_lock lock(_mutexconverters);
         if( time >= GetDuration() ) {
-            ConfigurationSpecification::ConvertData(data.begin(),spec,_vtrajdata.end()-_spec.GetDOF(),_spec,1,GetEnv());
+            _GetConverter(spec,true,true)->Convert(data.begin(),_vtrajdata.end()-_spec.GetDOF(),1);
         }
         else {
             std::vector<dReal>::iterator it = std::lower_bound(_vaccumtime.begin(),_vaccumtime.end(),time);
             if( it == _vaccumtime.begin() ) {
-                ConfigurationSpecification::ConvertData(data.begin(),spec,_vtrajdata.begin(),_spec,1,GetEnv());
+                _GetConverter(spec,true,true)->Convert(data.begin(),_vtrajdata.begin(),1);
             }
             else {
-                // could be faster
-                vector<dReal> vinternaldata(_spec.GetDOF(),0);
+                _vsampledata.resize(0);
+                _vsampledata.resize(_spec.GetDOF(),0);
                 size_t index = it-_vaccumtime.begin();
                 dReal deltatime = time-_vaccumtime.at(index-1);
                 for(size_t i = 0; i < _vgroupinterpolators.size(); ++i) {
                     if( !!_vgroupinterpolators[i] ) {
-                        _vgroupinterpolators[i](index-1,deltatime,vinternaldata);
+                        _vgroupinterpolators[i](index-1,deltatime,_vsampledata);
                     }
                 }
-                ConfigurationSpecification::ConvertData(data.begin(),spec,vinternaldata.begin(),_spec,1,GetEnv());
+                _GetConverter(spec,true,true)->Convert(data.begin(),_vsampledata.begin(),1);
             }
         }
     }
@@ -265,7 +268,8 @@ public:
         BOOST_ASSERT(startindex<=endindex && startindex*_spec.GetDOF() <= _vtrajdata.size() && endindex*_spec.GetDOF() <= _vtrajdata.size());
         data.resize(spec.GetDOF()*(endindex-startindex),0);
         if( startindex < endindex ) {
-            ConfigurationSpecification::ConvertData(data.begin(),spec,_vtrajdata.begin()+startindex*_spec.GetDOF(),_spec,endindex-startindex,GetEnv());
+            boost::mutex::scoped_lock lock(_mutexconverters);
+            _GetConverter(spec,true,true)->Convert(data.begin(),_vtrajdata.begin()+startindex*_spec.GetDOF(),endindex-startindex);
         }
     }
 
@@ -330,6 +334,8 @@ public:
         OPENRAVE_ASSERT_OP(GetXMLId(),==,rawtraj->GetXMLId());
         boost::shared_ptr<GenericTrajectory> traj = boost::dynamic_pointer_cast<GenericTrajectory>(rawtraj);
         _spec.Swap(traj->_spec);
+        _listconverters.clear();
+        traj->_listconverters.clear();
         _vderivoffsets.swap(traj->_vderivoffsets);
         _vddoffsets.swap(traj->_vddoffsets);
         _vdddoffsets.swap(traj->_vdddoffsets);
@@ -341,37 +347,44 @@ public:
         std::swap(_vdeltainvtime, traj->_vdeltainvtime);
         std::swap(_bChanged, traj->_bChanged);
         std::swap(_bSamplingVerified, traj->_bSamplingVerified);
+        ++traj->_nSamplingStamp;
         _InitializeGroupFunctions();
     }
 
+    SamplerPtr CreateSampler() const;
+
 protected:
-    void _ConvertData(std::vector<dReal>::iterator ittargetdata, std::vector<dReal>::const_iterator itsourcedata, const std::vector< std::vector<ConfigurationSpecification::Group>::const_iterator >& vconvertgroups, const ConfigurationSpecification& spec, size_t numelements, bool filluninitialized)
+    class CursorSampler;
+
+    /** \brief returns a converter between _spec and spec from a small cache of the most recently used ones
+
+        Since the cache is cleared whenever _spec changes, only spec is compared. _mutexconverters has to be locked while
+        the converter is looked up and used, since converting updates the default values stored in the converter.
+        \param bfromtrajectory if true, converts from _spec to spec, otherwise from spec to _spec
+     */
+    ConfigurationSpecification::ConverterPtr _GetConverter(const ConfigurationSpecification& spec, bool bfromtrajectory, bool filluninitialized, bool fillmissinggroupsfrombodies=true) const
     {
-        for(size_t igroup = 0; igroup < vconvertgroups.size(); ++igroup) {
-            if( vconvertgroups[igroup] != spec._vgroups.end() ) {
-                ConfigurationSpecification::ConvertGroupData(ittargetdata+_spec._vgroups[igroup].offset, _spec.GetDOF(), _spec._vgroups[igroup], itsourcedata+vconvertgroups[igroup]->offset, spec.GetDOF(), *vconvertgroups[igroup],numelements,GetEnv(),filluninitialized);
-            }
-            else if( filluninitialized ) {
-                vector<dReal> vdefaultvalues(_spec._vgroups[igroup].dof,0);
-                const string& groupname = _spec._vgroups[igroup].name;
-                if( groupname.size() >= 16 && groupname.substr(0,16) == "affine_transform" ) {
-                    stringstream ss(groupname.substr(16));
-                    string robotname;
-                    int affinedofs=0;
-                    ss >> robotname >> affinedofs;
-                    if( !!ss ) {
-                        BOOST_ASSERT((int)vdefaultvalues.size()==RaveGetAffineDOF(affinedofs));
-                        RaveGetAffineDOFValuesFromTransform(vdefaultvalues.begin(),Transform(),affinedofs);
-                    }
-                }
-                int offset = _spec._vgroups[igroup].offset;
-                for(size_t ielement = 0; ielement < numelements; ++ielement, offset += _spec.GetDOF()) {
-                    for(int j = 0; j < _spec._vgroups[igroup].dof; ++j) {
-                        *(ittargetdata+offset+j) = vdefaultvalues[j];
-                    }
+        FOREACH(itconverter, _listconverters) {
+            ConfigurationSpecification::ConverterPtr pconverter = itconverter->second;
+            if( itconverter->first == bfromtrajectory && pconverter->IsFillUninitialized() == filluninitialized && pconverter->IsFillMissingGroupsFromBodies() == fillmissinggroupsfrombodies && (bfromtrajectory ? pconverter->GetTargetSpecification() : pconverter->GetSourceSpecification()) == spec ) {
+                if( itconverter != _listconverters.begin() ) {
+                    _listconverters.splice(_listconverters.begin(), _listconverters, itconverter);
                 }
+                return pconverter;
             }
         }
+        ConfigurationSpecification::ConverterPtr pconverter;
+        if( bfromtrajectory ) {
+            pconverter.reset(new ConfigurationSpecification::Converter(spec, _spec, GetEnv(), filluninitialized, fillmissinggroupsfrombodies));
+        }
+        else {
+            pconverter.reset(new ConfigurationSpecification::Converter(_spec, spec, GetEnv(), filluninitialized, fillmissinggroupsfrombodies));
+        }
+        _listconverters.push_front(std::make_pair(bfromtrajectory, pconverter));
+        if( _listconverters.size() > 4 ) {
+            _listconverters.pop_back();
+        }
+        return pconverter;
     }
 
     void _ComputeInternal() const
@@ -400,6 +413,7 @@ protected:
         }
         _bChanged = false;
         _bSamplingVerified = false;
+        ++_nSamplingStamp;
     }
 
     /// \brief assumes _ComputeInternal has finished
@@ -444,6 +458,7 @@ protected:
     /// \brief called in order to initialize _vgroupinterpolators and _vgroupvalidators, _vderivoffsets, _vintegraloffsets
     void _InitializeGroupFunctions()
     {
+        ++_nSamplingStamp;
         // first set sizes to 0
         _vgroupinterpolators.resize(0);
         _vgroupvalidators.resize(0);
@@ -1012,11 +1027,294 @@ protected:
 
     std::vector<dReal> _vtrajdata;
     mutable std::vector<dReal> _vaccumtime, _vdeltainvtime;
+    mutable boost::mutex _mutexconverters; ///< protects _listconverters and _vsampledata, which are used by the const sampling functions
+    mutable std::vector<dReal> _vsampledata; ///< internal sample that is converted to the requested specification
+    mutable std::list< std::pair<bool, ConfigurationSpecification::ConverterPtr> > _listconverters; ///< most recently used converters between _spec and other specifications are at the front, the bool is true if the converter is from _spec
     bool _bInit;
     mutable bool _bChanged; ///< if true, then _ComputeInternal() has to be called in order to compute _vaccumtime and _vdeltainvtime
     mutable bool _bSamplingVerified; ///< if false, then _VerifySampling() has not be called yet to verify that all points can be sampled.
+    mutable uint32_t _nSamplingStamp; ///< incremented every time the sampling data changes, samplers compare it to know when to recompute their caches
+};
+
+/// \brief remembers the segment of the last sample and the polynomial coefficients of the groups on that segment.
+///
+/// The coefficients are computed once when entering a segment, so sampling at increasing times is a Horner evaluation per dof.
+/// Groups that are not polynomials in time (previous/next/ikparam) call the interpolators of the trajectory.
+class GenericTrajectory::CursorSampler : public TrajectoryBase::Sampler
+{
+public:
+    CursorSampler(boost::shared_ptr<GenericTrajectory const> ptraj) : _ptraj(ptraj), _nSamplingStamp(0), _index(0), _coeffsegment(-1) {
+        // make sure the first call initializes the groups
+        _nSamplingStamp = ptraj->_nSamplingStamp-1;
+    }
+
+    void Sample(std::vector<dReal>& data, dReal time)
+    {
+        BOOST_ASSERT(time >= 0);
+        _Prepare();
+        if( IS_DEBUGLEVEL(Level_Verbose) || (RaveGetDebugLevel() & Level_VerifyPlans) ) {
+            _ptraj->_VerifySampling();
+        }
+        _Sample(data, time);
+    }
+
+    void Sample(std::vector<dReal>& data, dReal time, const ConfigurationSpecification& spec)
+    {
+        BOOST_ASSERT(time >= -g_fEpsilon);
+        _Prepare();
+        _ptraj->_VerifySampling();
+        _Sample(_vsampledata, time);
+        data.resize(0);
+        data.resize(spec.GetDOF(),0);
+        if( !_pconverter || _pconverter->GetTargetSpecification() != spec ) {
+            _pconverter.reset(new ConfigurationSpecification::Converter(spec, _ptraj->_spec, _ptraj->GetEnv(), true));
+        }
+        _pconverter->Convert(data.begin(),_vsampledata.begin(),1);
+    }
+
+    size_t GetFirstWaypointIndexAfterTime(dReal time)
+    {
+        _Prepare();
+        const std::vector<dReal>& vaccumtime = _ptraj->_vaccumtime;
+        if( vaccumtime.size() == 0 || time < vaccumtime.at(0) ) {
+            return 0;
+        }
+        if( time >= vaccumtime.back() ) {
+            return vaccumtime.size();
+        }
+        return _Seek(time);
+    }
+
+protected:
+    /// \brief a group whose values are a polynomial of the time since the start of the segment
+    struct PolynomialGroup
+    {
+        int offset, dof, degree;
+    };
+
+    /// \brief recomputes the internal data of the trajectory and resets the cache if anything changed
+    void _Prepare()
+    {
+        BOOST_ASSERT(_ptraj->_bInit);
+        BOOST_ASSERT(_ptraj->_timeoffset>=0);
+        _ptraj->_ComputeInternal();
+        if( _nSamplingStamp != _ptraj->_nSamplingStamp ) {
+            _InitGroups();
+            _index = 0;
+            _coeffsegment = -1;
+            // the specification might have changed
+            _pconverter.reset();
+            _nSamplingStamp = _ptraj->_nSamplingStamp;
+        }
+    }
+
+    void _InitGroups()
+    {
+        const GenericTrajectory& traj = *_ptraj;
+        _vpolygroups.resize(0);
+        _vinterpolatedgroups.resize(0);
+        size_t numcoeffs = 0;
+        for(size_t i = 0; i < traj._spec._vgroups.size(); ++i) {
+            const ConfigurationSpecification::Group& g = traj._spec._vgroups[i];
+            if( g.offset == traj._timeoffset ) {
+                // overwritten by the delta time
+                continue;
+            }
+            bool bIkParam = g.name.size() >= 14 && g.name.substr(0,14) == "ikparam_values";
+            int derivoffset = traj._vderivoffsets.at(g.offset), ddoffset = traj._vddoffsets.at(g.offset), dddoffset = traj._vdddoffsets.at(g.offset);
+            PolynomialGroup polygroup;
+            polygroup.offset = g.offset;
+            polygroup.dof = g.dof;
+            polygroup.degree = -1;
+            if( g.interpolation == "linear" && !bIkParam ) {
+                polygroup.degree = 1;
+            }
+            else if( g.interpolation == "quadratic" && !bIkParam && (derivoffset >= 0 || traj._vintegraloffsets.at(g.offset) >= 0) ) {
+                polygroup.degree = 2;
+            }
+            else if( g.interpolation == "cubic" && derivoffset >= 0 ) {
+                polygroup.degree = 3;
+            }
+            else if( g.interpolation == "quartic" && derivoffset >= 0 && ddoffset >= 0 ) {
+                polygroup.degree = 4;
+            }
+            else if( g.interpolation == "quintic" && derivoffset >= 0 && ddoffset >= 0 ) {
+                polygroup.degree = 5;
+            }
+            else if( g.interpolation == "sextic" && derivoffset >= 0 && ddoffset >= 0 && dddoffset >= 0 ) {
+                polygroup.degree = 6;
+            }
+            if( polygroup.degree > 0 ) {
+                _vpolygroups.push_back(polygroup);
+                numcoeffs += g.dof*(polygroup.degree+1);
+            }
+            else if( !!traj._vgroupinterpolators.at(i) ) {
+                // the interpolator throws the same errors as Sample when data is missing
+                _vinterpolatedgroups.push_back(i);
+            }
+        }
+        _vcoeffs.resize(numcoeffs);
+    }
+
+    /// \brief returns the first index whose accumulated time is not less than time, same as std::lower_bound on _vaccumtime
+    size_t _Seek(dReal time)
+    {
+        const std::vector<dReal>& vaccumtime = _ptraj->_vaccumtime;
+        if( _index > vaccumtime.size() || (_index > 0 && vaccumtime[_index-1] >= time) ) {
+            // went back in time
+            _index = std::lower_bound(vaccumtime.begin(), vaccumtime.end(), time) - vaccumtime.begin();
+            return _index;
+        }
+        for(int istep = 0; istep < 8; ++istep) {
+            if( _index >= vaccumtime.size() || vaccumtime[_index] >= time ) {
+                return _index;
+            }
+            ++_index;
+        }
+        // jumped far ahead
+        _index = std::lower_bound(vaccumtime.begin()+_index, vaccumtime.end(), time) - vaccumtime.begin();
+        return _index;
+    }
+
+    void _Sample(std::vector<dReal>& data, dReal time)
+    {
+        const GenericTrajectory& traj = *_ptraj;
+        const std::vector<dReal>& vtrajdata = traj._vtrajdata;
+        int dof = traj._spec.GetDOF();
+        data.resize(0);
+        data.resize(dof,0);
+        if( time >= traj.GetDuration() ) {
+            std::copy(vtrajdata.end()-dof,vtrajdata.end(),data.begin());
+            return;
+        }
+        size_t index = _Seek(time);
+        if( index == 0 ) {
+            std::copy(vtrajdata.begin(),vtrajdata.begin()+dof,data.begin());
+            return;
+        }
+        size_t ipoint = index-1;
+        if( _coeffsegment != (int)ipoint ) {
+            _ComputeCoefficients(ipoint);
+            _coeffsegment = ipoint;
+        }
+        dReal deltatime = time-traj._vaccumtime[ipoint];
+        std::vector<dReal>::const_iterator itcoeffs = _vcoeffs.begin();
+        FOREACHC(itgroup, _vpolygroups) {
+            if( itgroup->degree > 1 && deltatime <= g_fEpsilon ) {
+                // same as the interpolators, return the starting point exactly
+                for(int i = 0; i < itgroup->dof; ++i, itcoeffs += itgroup->degree+1) {
+                    data[itgroup->offset+i] = *itcoeffs;
+                }
+                continue;
+            }
+            for(int i = 0; i < itgroup->dof; ++i, itcoeffs += itgroup->degree+1) {
+                dReal f = itcoeffs[itgroup->degree];
+                for(int j = itgroup->degree-1; j >= 0; --j) {
+                    f = itcoeffs[j] + deltatime*f;
+                }
+                data[itgroup->offset+i] = f;
+            }
+        }
+        FOREACHC(itgroupindex, _vinterpolatedgroups) {
+            traj._vgroupinterpolators[*itgroupindex](ipoint,deltatime,data);
+        }
+        // should return the sample time relative to the last endpoint so it is easier to re-insert in the trajectory
+        data.at(traj._timeoffset) = deltatime;
+    }
+
+    /// \brief computes the coefficients c0,...,cn of every dof of _vpolygroups on the segment starting at ipoint, see the interpolators for the derivations
+    void _ComputeCoefficients(size_t ipoint)
+    {
+        const GenericTrajectory& traj = *_ptraj;
+        int dof = traj._spec.GetDOF();
+        std::vector<dReal>::const_iterator itdata0 = traj._vtrajdata.begin() + ipoint*dof, itdata1 = itdata0 + dof;
+        dReal ideltatime = traj._vdeltainvtime.at(ipoint+1);
+        dReal ideltatime2 = ideltatime*ideltatime;
+        dReal ideltatime3 = ideltatime2*ideltatime;
+        dReal ideltatime4 = ideltatime2*ideltatime2;
+        dReal ideltatime5 = ideltatime4*ideltatime;
+        std::vector<dReal>::iterator itcoeffs = _vcoeffs.begin();
+        FOREACHC(itgroup, _vpolygroups) {
+            int derivoffset = traj._vderivoffsets[itgroup->offset], ddoffset = traj._vddoffsets[itgroup->offset], dddoffset = traj._vdddoffsets[itgroup->offset];
+            for(int i = 0; i < itgroup->dof; ++i, itcoeffs += itgroup->degree+1) {
+                dReal p0 = itdata0[itgroup->offset+i];
+                dReal px = itdata1[itgroup->offset+i] - p0;
+                itcoeffs[0] = p0;
+                switch(itgroup->degree) {
+                case 1:
+                    itcoeffs[1] = derivoffset >= 0 ? itdata1[derivoffset+i] : px*ideltatime;
+                    break;
+                case 2:
+                    if( derivoffset >= 0 ) {
+                        itcoeffs[1] = itdata0[derivoffset+i];
+                        itcoeffs[2] = 0.5*ideltatime*(itdata1[derivoffset+i]-itdata0[derivoffset+i]);
+                    }
+                    else {
+                        int integraloffset = traj._vintegraloffsets[itgroup->offset];
+                        dReal c1TimesDelta = 6*(itdata1[integraloffset+i]-itdata0[integraloffset+i])*ideltatime - 4*p0 - 2*itdata1[itgroup->offset+i];
+                        itcoeffs[1] = c1TimesDelta*ideltatime;
+                        itcoeffs[2] = (px - c1TimesDelta)*ideltatime2;
+                    }
+                    break;
+                case 3: {
+                    dReal deriv0 = itdata0[derivoffset+i], deriv1 = itdata1[derivoffset+i];
+                    itcoeffs[1] = deriv0;
+                    itcoeffs[2] = 3*px*ideltatime2 - (2*deriv0+deriv1)*ideltatime;
+                    itcoeffs[3] = (deriv1+deriv0)*ideltatime2 - 2*px*ideltatime3;
+                    break;
+                }
+                case 4: {
+                    dReal deriv0 = itdata0[derivoffset+i], deriv1 = itdata1[derivoffset+i];
+                    dReal dd0 = itdata0[ddoffset+i], dd1 = itdata1[ddoffset+i];
+                    itcoeffs[1] = deriv0;
+                    itcoeffs[2] = 0.5*dd0;
+                    itcoeffs[3] = (deriv1-deriv0)*ideltatime2 - (2*dd0+dd1)*ideltatime/3.0;
+                    itcoeffs[4] = -0.5*(deriv1-deriv0)*ideltatime3 + (dd0 + dd1)*ideltatime2*0.25;
+                    break;
+                }
+                case 5: {
+                    dReal deriv0 = itdata0[derivoffset+i], deriv1 = itdata1[derivoffset+i];
+                    dReal dd0 = itdata0[ddoffset+i], dd1 = itdata1[ddoffset+i];
+                    itcoeffs[1] = deriv0;
+                    itcoeffs[2] = 0.5*dd0;
+                    itcoeffs[3] = (-1.5*dd0 + dd1*0.5)*ideltatime + (- 6*deriv0 - 4*deriv1)*ideltatime2 + px*10*ideltatime3;
+                    itcoeffs[4] = (1.5*dd0 - dd1)*ideltatime2 + (8*deriv0 + 7*deriv1)*ideltatime3 - px*15*ideltatime4;
+                    itcoeffs[5] = (-0.5*dd0 + dd1*0.5)*ideltatime3 - (3*deriv0 + 3*deriv1)*ideltatime4 + px*6*ideltatime5;
+                    break;
+                }
+                case 6: {
+                    dReal deriv0 = itdata0[derivoffset+i], deriv1 = itdata1[derivoffset+i];
+                    dReal dd0 = itdata0[ddoffset+i], dd1 = itdata1[ddoffset+i];
+                    dReal ddd0 = itdata0[dddoffset+i], ddd1 = itdata1[dddoffset+i];
+                    itcoeffs[1] = deriv0;
+                    itcoeffs[2] = 0.5*dd0;
+                    itcoeffs[3] = ddd0/6.0;
+                    itcoeffs[4] = (-1.5*dd0 - dd1)*ideltatime2 + (- 0.375*ddd0 + ddd1*0.125)*ideltatime + (-2.5*deriv0 + 2.5*deriv1)*ideltatime3;
+                    itcoeffs[5] = (1.6*dd0 + 1.4*dd1)*ideltatime3 + (0.3*ddd0 - ddd1*0.2)*ideltatime2 + (3*deriv0 - 3*deriv1)*ideltatime4;
+                    itcoeffs[6] = (-dd0 - dd1)*0.5*ideltatime4 + (- ddd0 + ddd1)/12.0*ideltatime3 + (-deriv0 + deriv1)*ideltatime5;
+                    break;
+                }
+                }
+            }
+        }
+    }
+
+    boost::shared_ptr<GenericTrajectory const> _ptraj;
+    uint32_t _nSamplingStamp; ///< the stamp of the trajectory the groups were initialized for
+    size_t _index; ///< the last index returned by _Seek
+    int _coeffsegment; ///< the segment _vcoeffs was computed for, -1 if none
+    std::vector<PolynomialGroup> _vpolygroups;
+    std::vector<size_t> _vinterpolatedgroups; ///< indices of the groups that call the trajectory interpolators
+    std::vector<dReal> _vcoeffs; ///< for every dof of _vpolygroups, the coefficients c0,...,cn of the polynomial on segment _coeffsegment
+    std::vector<dReal> _vsampledata; ///< internal sample that is converted to the requested specification
+    ConfigurationSpecification::ConverterPtr _pconverter; ///< converter from the trajectory specification to the last requested one, owned by the sampler so that samplers of the same trajectory can be used from different threads
 };
 
+TrajectoryBase::SamplerPtr GenericTrajectory::CreateSampler() const
+{
+    return SamplerPtr(new CursorSampler(boost::static_pointer_cast<GenericTrajectory const>(shared_trajectory_const())));
+}
+
 TrajectoryBasePtr CreateGenericTrajectory(EnvironmentBasePtr penv, std::istream& sinput)
 {
     return TrajectoryBasePtr(new GenericTrajectory(penv,sinput));
@@ -0,0 +1,1158 @@
+// -*- coding: utf-8 -*-
+// Copyright (C) 2006-2014 Rosen Diankov <rosen.diankov@gmail.com>
+//
+// This file is part of OpenRAVE.
+// OpenRAVE is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+#include "ravep.h"
+
+#include <fstream>
+#include <boost/thread/once.hpp>
+#include <boost/thread/tss.hpp>
+
+#ifdef HAVE_BOOST_FILESYSTEM
+#include <boost/filesystem.hpp>
+#endif
+
+#ifndef _WIN32
+#include <unistd.h>
+#endif
+
+namespace OpenRAVE {
+
+/// \brief version of the cache file layout, increment whenever SceneCacheWriter changes
+static const uint32_t s_SceneCacheVersion = 2;
+static const char s_SceneCacheMagic[] = "openrave_scene_cache";
+
+/// \brief bounds of the cache directory, the least recently used entries are removed beyond them
+static const size_t s_SceneCacheMaxEntries = 256;
+static const uint64_t s_SceneCacheMaxBytes = 512*1024*1024;
+/// \brief temporary files older than this (in seconds) were left behind by a process that died while writing
+static const time_t s_SceneCacheTempFileTimeout = 3600;
+
+static void _DoNotDeleteRecorder(SceneLoadRecorder*)
+{
+}
+
+static boost::thread_specific_ptr<SceneLoadRecorder>* s_pCurrentRecorder = NULL;
+static boost::once_flag s_onceCreateCurrentRecorder = BOOST_ONCE_INIT;
+
+static void _CreateCurrentRecorder()
+{
+    // the recorders are owned by Environment::Load, so never delete them when the thread exits
+    s_pCurrentRecorder = new boost::thread_specific_ptr<SceneLoadRecorder>(_DoNotDeleteRecorder);
+}
+
+static boost::thread_specific_ptr<SceneLoadRecorder>& _GetCurrentRecorder()
+{
+    boost::call_once(_CreateCurrentRecorder,s_onceCreateCurrentRecorder);
+    return *s_pCurrentRecorder;
+}
+
+SceneLoadRecorder::SceneLoadRecorder()
+{
+    _GetCurrentRecorder().reset(this);
+}
+
+SceneLoadRecorder::~SceneLoadRecorder()
+{
+    if( _GetCurrentRecorder().get() == this ) {
+        _GetCurrentRecorder().release();
+    }
+}
+
+SceneLoadRecorder* SceneLoadRecorder::GetCurrent()
+{
+    return _GetCurrentRecorder().get();
+}
+
+void SceneLoadRecorder::RecordFile(const std::string& filename)
+{
+    SceneLoadRecorder* precorder = GetCurrent();
+    if( !!precorder && filename.size() > 0 ) {
+        precorder->_setfilenames.insert(filename);
+    }
+}
+
+std::string SceneLoadRecorder::FindLocalFile(const std::string& filename, const std::string& curdir)
+{
+    std::string fullfilename = RaveFindLocalFile(filename, curdir);
+    SceneLoadRecorder* precorder = GetCurrent();
+    if( !!precorder ) {
+        precorder->_mapincludes[std::make_pair(filename, curdir)] = fullfilename;
+    }
+    return fullfilename;
+}
+
+void SceneLoadRecorder::SetUncacheable(const std::string& reason)
+{
+    SceneLoadRecorder* precorder = GetCurrent();
+    if( !!precorder && precorder->_uncacheablereason.size() == 0 ) {
+        precorder->_uncacheablereason = reason;
+    }
+}
+
+void SceneLoadRecorder::RecordJointFrame(KinBody::JointConstPtr pjoint, const std::vector<dReal>& vcurrentvalues)
+{
+    SceneLoadRecorder* precorder = GetCurrent();
+    if( !!precorder && !!pjoint->GetFirstAttached() && !!pjoint->GetSecondAttached() ) {
+        JointFrame& frame = precorder->_mapjointframes[pjoint.get()];
+        frame._trelative = pjoint->GetFirstAttached()->GetTransform().inverse() * pjoint->GetSecondAttached()->GetTransform();
+        frame._vcurrentvalues = vcurrentvalues;
+    }
+}
+
+/// \brief returns true if two transforms are the same up to numerical precision
+static bool _IsSameTransform(const Transform& t0, const Transform& t1)
+{
+    dReal frotdist = RaveFabs(t0.rot.dot(t1.rot));
+    return (t0.trans-t1.trans).lengthsqr3() <= 1e-10 && frotdist >= 1-1e-10;
+}
+
+void SceneLoadRecorder::RecordAddedBody(KinBodyPtr pbody, bool bAnonymous)
+{
+    SceneLoadRecorder* precorder = GetCurrent();
+    if( !precorder ) {
+        return;
+    }
+    AddedBody& added = precorder->_mapaddedbodies[pbody.get()];
+    added._name = pbody->GetName();
+    added._bAnonymous = bAnonymous;
+
+    // KinBody::Init computes the joints at the link transforms of the infos, so choose the link transforms such that
+    // every joint sees its attached links where the parser had them when initializing it. Joints not initialized by
+    // a parser were initialized by KinBody::Init at the current transforms.
+    std::vector<KinBody::JointPtr> vjoints = pbody->GetJoints();
+    vjoints.insert(vjoints.end(), pbody->GetPassiveJoints().begin(), pbody->GetPassiveJoints().end());
+    std::vector<Transform> vjointrelative(vjoints.size());
+    std::vector< std::vector<int> > vlinkjoints(pbody->GetLinks().size());
+    for(size_t ijoint = 0; ijoint < vjoints.size(); ++ijoint) {
+        KinBody::JointPtr pjoint = vjoints[ijoint];
+        if( !pjoint->GetFirstAttached() || !pjoint->GetSecondAttached() ) {
+            SetUncacheable(str(boost::format("joint %s of body %s is not attached to two links")%pjoint->GetName()%pbody->GetName()));
+            return;
+        }
+        KinBody::JointInfo info = pjoint->GetInfo();
+        info._linkname0 = pjoint->GetFirstAttached()->GetName();
+        info._linkname1 = pjoint->GetSecondAttached()->GetName();
+        std::map<const KinBody::Joint*, JointFrame>::const_iterator itframe = precorder->_mapjointframes.find(pjoint.get());
+        if( itframe != precorder->_mapjointframes.end() ) {
+            vjointrelative[ijoint] = itframe->second._trelative;
+            info._vcurrentvalues = itframe->second._vcurrentvalues;
+        }
+        else {
+            vjointrelative[ijoint] = pjoint->GetFirstAttached()->GetTransform().inverse() * pjoint->GetSecondAttached()->GetTransform();
+        }
+        added._mapJointInfos[pjoint->GetName()] = info;
+        vlinkjoints.at(pjoint->GetFirstAttached()->GetIndex()).push_back(ijoint);
+        vlinkjoints.at(pjoint->GetSecondAttached()->GetIndex()).push_back(ijoint);
+    }
+
+    // walk the kinematics graph starting from every link that has not been reached yet, in link order
+    std::vector<Transform> vlinktransforms(pbody->GetLinks().size());
+    std::vector<uint8_t> vplaced(pbody->GetLinks().size(), 0);
+    for(size_t iroot = 0; iroot < vplaced.size(); ++iroot) {
+        if( vplaced[iroot] ) {
+            continue;
+        }
+        vlinktransforms[iroot] = pbody->GetLinks()[iroot]->GetTransform();
+        vplaced[iroot] = 1;
+        std::list<int> listopen;
+        listopen.push_back(iroot);
+        while(listopen.size() > 0) {
+            int ilink = listopen.front();
+            listopen.pop_front();
+            FOREACHC(itjoint, vlinkjoints[ilink]) {
+                KinBody::JointPtr pjoint = vjoints[*itjoint];
+                int ifirst = pjoint->GetFirstAttached()->GetIndex(), isecond = pjoint->GetSecondAttached()->GetIndex();
+                int iother = ifirst == ilink ? isecond : ifirst;
+                Transform tother = ifirst == ilink ? vlinktransforms[ilink] * vjointrelative[*itjoint] : vlinktransforms[ilink] * vjointrelative[*itjoint].inverse();
+                if( !vplaced[iother] ) {
+                    vlinktransforms[iother] = tother;
+                    vplaced[iother] = 1;
+                    listopen.push_back(iother);
+                }
+                else if( !_IsSameTransform(vlinktransforms[iother], tother) ) {
+                    SetUncacheable(str(boost::format("the joints of the closed chain through joint %s of body %s were initialized at inconsistent link transforms")%pjoint->GetName()%pbody->GetName()));
+                    return;
+                }
+            }
+        }
+    }
+    for(size_t ilink = 0; ilink < vlinktransforms.size(); ++ilink) {
+        added._mapLinkTransforms[pbody->GetLinks()[ilink]->GetName()] = vlinktransforms[ilink];
+    }
+}
+
+/// \brief reads the content of a file, returns false if it cannot be opened
+static bool _ReadFileContent(const std::string& filename, std::string& content)
+{
+    std::ifstream f(filename.c_str(), std::ios::in|std::ios::binary);
+    if( !f ) {
+        return false;
+    }
+    f.seekg(0, std::ios::end);
+    std::streamoff size = f.tellg();
+    if( size < 0 ) {
+        return false;
+    }
+    f.seekg(0, std::ios::beg);
+    content.resize(static_cast<size_t>(size));
+    if( size > 0 ) {
+        f.read(&content[0], size);
+    }
+    return !!f;
+}
+
+/// \brief serializes the infos in native binary format
+class SceneCacheWriter
+{
+public:
+    SceneCacheWriter(std::ostream& o) : _o(o) {
+    }
+
+    template <typename T> void Write(const T& value) {
+        _o.write(reinterpret_cast<const char*>(&value), sizeof(T));
+    }
+
+    void WriteString(const std::string& s) {
+        Write<uint32_t>(s.size());
+        _o.write(s.c_str(), s.size());
+    }
+
+    void WriteVector(const Vector& v) {
+        Write<dReal>(v.x); Write<dReal>(v.y); Write<dReal>(v.z); Write<dReal>(v.w);
+    }
+
+    void WriteColor(const RaveVector<float>& v) {
+        Write<float>(v.x); Write<float>(v.y); Write<float>(v.z); Write<float>(v.w);
+    }
+
+    void WriteTransform(const Transform& t) {
+        WriteVector(t.rot);
+        WriteVector(t.trans);
+    }
+
+    void WriteValues(const std::vector<dReal>& v) {
+        Write<uint32_t>(v.size());
+        if( v.size() > 0 ) {
+            _o.write(reinterpret_cast<const char*>(&v[0]), v.size()*sizeof(dReal));
+        }
+    }
+
+    void WriteInts(const std::vector<int>& v) {
+        Write<uint32_t>(v.size());
+        FOREACHC(it, v) {
+            Write<int32_t>(*it);
+        }
+    }
+
+    void WriteStrings(const std::vector<std::string>& v) {
+        Write<uint32_t>(v.size());
+        FOREACHC(it, v) {
+            WriteString(*it);
+        }
+    }
+
+    template <size_t N> void WriteArray(const boost::array<dReal,N>& v) {
+        FOREACHC(it, v) {
+            Write<dReal>(*it);
+        }
+    }
+
+    void WriteParameters(const std::map<std::string, std::vector<dReal> >& mapFloatParameters, const std::map<std::string, std::vector<int> >& mapIntParameters, const std::map<std::string, std::string >& mapStringParameters)
+    {
+        Write<uint32_t>(mapFloatParameters.size());
+        FOREACHC(it, mapFloatParameters) {
+            WriteString(it->first);
+            WriteValues(it->second);
+        }
+        Write<uint32_t>(mapIntParameters.size());
+        FOREACHC(it, mapIntParameters) {
+            WriteString(it->first);
+            WriteInts(it->second);
+        }
+        Write<uint32_t>(mapStringParameters.size());
+        FOREACHC(it, mapStringParameters) {
+            WriteString(it->first);
+            WriteString(it->second);
+        }
+    }
+
+    void WriteTriMesh(const TriMesh& trimesh) {
+        Write<uint32_t>(trimesh.vertices.size());
+        FOREACHC(it, trimesh.vertices) {
+            Write<dReal>(it->x); Write<dReal>(it->y); Write<dReal>(it->z);
+        }
+        WriteInts(trimesh.indices);
+    }
+
+    void WriteGeometryInfo(const KinBody::GeometryInfo& info) {
+        WriteTransform(info._t);
+        WriteVector(info._vGeomData);
+        WriteColor(info._vDiffuseColor);
+        WriteColor(info._vAmbientColor);
+        WriteTriMesh(info.GetCollisionMesh());
+        Write<int32_t>(info._type);
+        WriteString(info._filenamerender);
+        WriteString(info._filenamecollision);
+        WriteVector(info._vRenderScale);
+        WriteVector(info._vCollisionScale);
+        Write<float>(info._fTransparency);
+        Write<uint8_t>(info._bVisible);
+        Write<uint8_t>(info._bModifiable);
+    }
+
+    void WriteGeometryInfos(const std::vector<KinBody::GeometryInfoPtr>& vinfos) {
+        Write<uint32_t>(vinfos.size());
+        FOREACHC(it, vinfos) {
+            WriteGeometryInfo(**it);
+        }
+    }
+
+    void WriteLinkInfo(const KinBody::LinkInfo& info) {
+        WriteGeometryInfos(info._vgeometryinfos);
+        Write<uint32_t>(info._mapExtraGeometries.size());
+        FOREACHC(it, info._mapExtraGeometries) {
+            WriteString(it->first);
+            WriteGeometryInfos(it->second);
+        }
+        WriteString(info._name);
+        WriteTransform(info._t);
+        WriteTransform(info._tMassFrame);
+        Write<dReal>(info._mass);
+        WriteVector(info._vinertiamoments);
+        WriteParameters(info._mapFloatParameters, info._mapIntParameters, info._mapStringParameters);
+        WriteStrings(info._vForcedAdjacentLinks);
+        Write<uint8_t>(info._bStatic);
+        Write<uint8_t>(info._bIsEnabled);
+    }
+
+    void WriteJointInfo(const KinBody::JointInfo& info) {
+        Write<int32_t>(info._type);
+        WriteString(info._name);
+        WriteString(info._linkname0);
+        WriteString(info._linkname1);
+        WriteVector(info._vanchor);
+        FOREACHC(it, info._vaxes) {
+            WriteVector(*it);
+        }
+        WriteValues(info._vcurrentvalues);
+        WriteArray(info._vresolution);
+        WriteArray(info._vmaxvel);
+        WriteArray(info._vhardmaxvel);
+        WriteArray(info._vmaxaccel);
+        WriteArray(info._vmaxtorque);
+        WriteArray(info._vmaxinertia);
+        WriteArray(info._vweights);
+        WriteArray(info._voffsets);
+        WriteArray(info._vlowerlimit);
+        WriteArray(info._vupperlimit);
+        FOREACHC(itmimic, info._vmimic) {
+            Write<uint8_t>(!!*itmimic);
+            if( !!*itmimic ) {
+                FOREACHC(iteq, (*itmimic)->_equations) {
+                    WriteString(*iteq);
+                }
+            }
+        }
+        WriteParameters(info._mapFloatParameters, info._mapIntParameters, info._mapStringParameters);
+        Write<uint8_t>(!!info._infoElectricMotor);
+        if( !!info._infoElectricMotor ) {
+            const ElectricMotorActuatorInfo& motor = *info._infoElectricMotor;
+            Write<dReal>(motor.gear_ratio);
+            Write<dReal>(motor.assigned_power_rating);
+            Write<dReal>(motor.max_speed);
+            Write<dReal>(motor.no_load_speed);
+            Write<dReal>(motor.stall_torque);
+            Write<uint32_t>(motor.speed_torque_points.size());
+            FOREACHC(itpoint, motor.speed_torque_points) {
+                Write<dReal>(itpoint->first);
+                Write<dReal>(itpoint->second);
+            }
+            Write<dReal>(motor.nominal_torque);
+            Write<dReal>(motor.rotor_inertia);
+            Write<dReal>(motor.torque_constant);
+            Write<dReal>(motor.nominal_voltage);
+            Write<dReal>(motor.speed_constant);
+            Write<dReal>(motor.starting_current);
+            Write<dReal>(motor.terminal_resistance);
+        }
+        FOREACHC(it, info._bIsCircular) {
+            Write<uint8_t>(*it);
+        }
+        Write<uint8_t>(info._bIsActive);
+    }
+
+    void WriteManipulatorInfo(const RobotBase::ManipulatorInfo& info) {
+        WriteString(info._name);
+        WriteString(info._sBaseLinkName);
+        WriteString(info._sEffectorLinkName);
+        WriteTransform(info._tLocalTool);
+        WriteValues(info._vChuckingDirection);
+        WriteVector(info._vdirection);
+        WriteString(info._sIkSolverXMLId);
+        WriteStrings(info._vGripperJointNames);
+    }
+
+private:
+    std::ostream& _o;
+};
+
+/// \brief deserializes what SceneCacheWriter wrote, throws if the data is truncated
+class SceneCacheReader
+{
+public:
+    SceneCacheReader(const std::string& data) : _data(data), _pos(0) {
+    }
+
+    template <typename T> T Read() {
+        T value;
+        _Read(&value, sizeof(T));
+        return value;
+    }
+
+    std::string ReadString() {
+        uint32_t size = Read<uint32_t>();
+        _Check(size);
+        std::string s = _data.substr(_pos, size);
+        _pos += size;
+        return s;
+    }
+
+    Vector ReadVector() {
+        Vector v;
+        v.x = Read<dReal>(); v.y = Read<dReal>(); v.z = Read<dReal>(); v.w = Read<dReal>();
+        return v;
+    }
+
+    RaveVector<float> ReadColor() {
+        RaveVector<float> v;
+        v.x = Read<float>(); v.y = Read<float>(); v.z = Read<float>(); v.w = Read<float>();
+        return v;
+    }
+
+    Transform ReadTransform() {
+        Transform t;
+        t.rot = ReadVector();
+        t.trans = ReadVector();
+        return t;
+    }
+
+    void ReadValues(std::vector<dReal>& v) {
+        uint32_t size = Read<uint32_t>();
+        _Check(size*sizeof(dReal));
+        v.resize(size);
+        if( size > 0 ) {
+            _Read(&v[0], size*sizeof(dReal));
+        }
+    }
+
+    void ReadInts(std::vector<int>& v) {
+        uint32_t size = Read<uint32_t>();
+        _Check(size*sizeof(int32_t));
+        v.resize(size);
+        FOREACH(it, v) {
+            *it = Read<int32_t>();
+        }
+    }
+
+    void ReadStrings(std::vector<std::string>& v) {
+        uint32_t size = Read<uint32_t>();
+        _Check(size*sizeof(uint32_t));
+        v.resize(size);
+        FOREACH(it, v) {
+            *it = ReadString();
+        }
+    }
+
+    template <size_t N> void ReadArray(boost::array<dReal,N>& v) {
+        FOREACH(it, v) {
+            *it = Read<dReal>();
+        }
+    }
+
+    void ReadParameters(std::map<std::string, std::vector<dReal> >& mapFloatParameters, std::map<std::string, std::vector<int> >& mapIntParameters, std::map<std::string, std::string >& mapStringParameters)
+    {
+        uint32_t num = Read<uint32_t>();
+        for(uint32_t i = 0; i < num; ++i) {
+            std::string name = ReadString();
+            ReadValues(mapFloatParameters[name]);
+        }
+        num = Read<uint32_t>();
+        for(uint32_t i = 0; i < num; ++i) {
+            std::string name = ReadString();
+            ReadInts(mapIntParameters[name]);
+        }
+        num = Read<uint32_t>();
+        for(uint32_t i = 0; i < num; ++i) {
+            std::string name = ReadString();
+            mapStringParameters[name] = ReadString();
+        }
+    }
+
+    void ReadTriMesh(TriMesh& trimesh) {
+        uint32_t numvertices = Read<uint32_t>();
+        _Check(numvertices*3*sizeof(dReal));
+        trimesh.vertices.resize(numvertices);
+        FOREACH(it, trimesh.vertices) {
+            it->x = Read<dReal>(); it->y = Read<dReal>(); it->z = Read<dReal>();
+        }
+        ReadInts(trimesh.indices);
+    }
+
+    void ReadGeometryInfo(KinBody::GeometryInfo& info) {
+        info._t = ReadTransform();
+        info._vGeomData = ReadVector();
+        info._vDiffuseColor = ReadColor();
+        info._vAmbientColor = ReadColor();
+        ReadTriMesh(info._meshcollision);
+        info._type = static_cast<GeometryType>(Read<int32_t>());
+        info._filenamerender = ReadString();
+        info._filenamecollision = ReadString();
+        info._vRenderScale = ReadVector();
+        info._vCollisionScale = ReadVector();
+        info._fTransparency = Read<float>();
+        info._bVisible = Read<uint8_t>() != 0;
+        info._bModifiable = Read<uint8_t>() != 0;
+    }
+
+    void ReadGeometryInfos(std::vector<KinBody::GeometryInfoPtr>& vinfos) {
+        uint32_t num = Read<uint32_t>();
+        _Check(num);
+        vinfos.resize(num);
+        FOREACH(it, vinfos) {
+            it->reset(new KinBody::GeometryInfo());
+            ReadGeometryInfo(**it);
+        }
+    }
+
+    void ReadLinkInfo(KinBody::LinkInfo& info) {
+        ReadGeometryInfos(info._vgeometryinfos);
+        uint32_t numextra = Read<uint32_t>();
+        for(uint32_t i = 0; i < numextra; ++i) {
+            std::string name = ReadString();
+            ReadGeometryInfos(info._mapExtraGeometries[name]);
+        }
+        info._name = ReadString();
+        info._t = ReadTransform();
+        info._tMassFrame = ReadTransform();
+        info._mass = Read<dReal>();
+        info._vinertiamoments = ReadVector();
+        ReadParameters(info._mapFloatParameters, info._mapIntParameters, info._mapStringParameters);
+        ReadStrings(info._vForcedAdjacentLinks);
+        info._bStatic = Read<uint8_t>() != 0;
+        info._bIsEnabled = Read<uint8_t>() != 0;
+    }
+
+    void ReadJointInfo(KinBody::JointInfo& info) {
+        info._type = static_cast<KinBody::JointType>(Read<int32_t>());
+        info._name = ReadString();
+        info._linkname0 = ReadString();
+        info._linkname1 = ReadString();
+        info._vanchor = ReadVector();
+        FOREACH(it, info._vaxes) {
+            *it = ReadVector();
+        }
+        ReadValues(info._vcurrentvalues);
+        ReadArray(info._vresolution);
+        ReadArray(info._vmaxvel);
+        ReadArray(info._vhardmaxvel);
+        ReadArray(info._vmaxaccel);
+        ReadArray(info._vmaxtorque);
+        ReadArray(info._vmaxinertia);
+        ReadArray(info._vweights);
+        ReadArray(info._voffsets);
+        ReadArray(info._vlowerlimit);
+        ReadArray(info._vupperlimit);
+        FOREACH(itmimic, info._vmimic) {
+            itmimic->reset();
+            if( Read<uint8_t>() ) {
+                itmimic->reset(new KinBody::MimicInfo());
+                FOREACH(iteq, (*itmimic)->_equations) {
+                    *iteq = ReadString();
+                }
+            }
+        }
+        ReadParameters(info._mapFloatParameters, info._mapIntParameters, info._mapStringParameters);
+        info._infoElectricMotor.reset();
+        if( Read<uint8_t>() ) {
+            info._infoElectricMotor.reset(new ElectricMotorActuatorInfo());
+            ElectricMotorActuatorInfo& motor = *info._infoElectricMotor;
+            motor.gear_ratio = Read<dReal>();
+            motor.assigned_power_rating = Read<dReal>();
+            motor.max_speed = Read<dReal>();
+            motor.no_load_speed = Read<dReal>();
+            motor.stall_torque = Read<dReal>();
+            uint32_t numpoints = Read<uint32_t>();
+            _Check(numpoints*2*sizeof(dReal));
+            motor.speed_torque_points.resize(numpoints);
+            FOREACH(itpoint, motor.speed_torque_points) {
+                itpoint->first = Read<dReal>();
+                itpoint->second = Read<dReal>();
+            }
+            motor.nominal_torque = Read<dReal>();
+            motor.rotor_inertia = Read<dReal>();
+            motor.torque_constant = Read<dReal>();
+            motor.nominal_voltage = Read<dReal>();
+            motor.speed_constant = Read<dReal>();
+            motor.starting_current = Read<dReal>();
+            motor.terminal_resistance = Read<dReal>();
+        }
+        FOREACH(it, info._bIsCircular) {
+            *it = Read<uint8_t>();
+        }
+        info._bIsActive = Read<uint8_t>() != 0;
+    }
+
+    void ReadManipulatorInfo(RobotBase::ManipulatorInfo& info) {
+        info._name = ReadString();
+        info._sBaseLinkName = ReadString();
+        info._sEffectorLinkName = ReadString();
+        info._tLocalTool = ReadTransform();
+        ReadValues(info._vChuckingDirection);
+        info._vdirection = ReadVector();
+        info._sIkSolverXMLId = ReadString();
+        ReadStrings(info._vGripperJointNames);
+    }
+
+    bool IsDone() const {
+        return _pos == _data.size();
+    }
+
+private:
+    void _Check(size_t size) const {
+        if( size > _data.size()-_pos ) {
+            throw OPENRAVE_EXCEPTION_FORMAT("scene cache is truncated at %d", _pos, ORE_InvalidState);
+        }
+    }
+
+    void _Read(void* p, size_t size) {
+        _Check(size);
+        memcpy(p, &_data[_pos], size);
+        _pos += size;
+    }
+
+    const std::string& _data;
+    size_t _pos;
+};
+
+/// \brief everything needed to recreate one body of a cache entry
+struct CachedBody
+{
+    CachedBody() : _bIsRobot(false), _bAnonymous(false), _affinedofs(0) {
+    }
+    bool _bIsRobot, _bAnonymous;
+    std::string _xmlid, _name, _uri;
+    std::vector<KinBody::LinkInfoConstPtr> _vlinkinfos;
+    std::vector<KinBody::JointInfoConstPtr> _vjointinfos;
+    std::vector<RobotBase::ManipulatorInfoConstPtr> _vmanipinfos;
+    std::vector<Transform> _vlinktransforms;
+    std::vector<dReal> _vdoflastsetvalues;
+    std::string _activemanipname;
+    std::vector<int> _vactivedofindices;
+    int _affinedofs;
+    Vector _vaffinerotationaxis;
+};
+
+/// \brief returns the index pair used by KinBody::GetAdjacentLinks
+static int _GetAdjacentLinkPair(int index0, int index1)
+{
+    return index0 < index1 ? (index0|(index1<<16)) : (index1|(index0<<16));
+}
+
+SceneCache::SceneCache(const std::string& cachedirectory) : _cachedirectory(cachedirectory)
+{
+}
+
+std::string SceneCache::_GetLoadKey(const std::string& fullfilename, const AttributesList& atts)
+{
+    std::stringstream ss;
+    ss << fullfilename;
+    // the same references can resolve to different files when the data directories change
+    char* pOPENRAVE_DATA = getenv("OPENRAVE_DATA"); // getenv not thread-safe?
+    ss << "\nOPENRAVE_DATA=" << (pOPENRAVE_DATA != NULL ? pOPENRAVE_DATA : "") << "\ndataaccess=" << RaveGetDataAccess();
+    FOREACHC(itatt, atts) {
+        ss << "\n" << itatt->first << "=" << itatt->second;
+    }
+    return ss.str();
+}
+
+std::string SceneCache::GetCacheFilename(const std::string& fullfilename, const AttributesList& atts) const
+{
+    if( fullfilename.size() == 0 || _cachedirectory.size() == 0 ) {
+        return std::string();
+    }
+    return _cachedirectory + s_filesep + utils::GetMD5HashString(_GetLoadKey(fullfilename, atts)) + ".scene";
+}
+
+std::string SceneCache::_GetUncacheableReason(KinBodyConstPtr pbody)
+{
+    if( pbody->GetLinks().size() == 0 ) {
+        return "it has no links";
+    }
+    if( pbody->GetReadableInterfaces().size() > 0 ) {
+        return "it has custom xml readers";
+    }
+    // KinBody::Init looks up the links and joints by name
+    std::set<std::string> setnames;
+    FOREACHC(itlink, pbody->GetLinks()) {
+        if( !setnames.insert((*itlink)->GetName()).second ) {
+            return str(boost::format("link name '%s' is not unique")%(*itlink)->GetName());
+        }
+    }
+    setnames.clear();
+    for(int ipassive = 0; ipassive < 2; ++ipassive) {
+        FOREACHC(itjoint, ipassive ? pbody->GetPassiveJoints() : pbody->GetJoints()) {
+            if( !setnames.insert((*itjoint)->GetName()).second ) {
+                return str(boost::format("joint name '%s' is not unique")%(*itjoint)->GetName());
+            }
+        }
+    }
+    FOREACHC(itjoint, pbody->GetJoints()) {
+        if( !!(*itjoint)->GetInfo()._trajfollow ) {
+            return str(boost::format("joint %s follows a trajectory")%(*itjoint)->GetName());
+        }
+    }
+    // the cache stores the adjacency as forced adjacent links, which only reproduces it if joined links are adjacent
+    const std::set<int>& setadjacent = pbody->GetAdjacentLinks();
+    for(int ipassive = 0; ipassive < 2; ++ipassive) {
+        FOREACHC(itjoint, ipassive ? pbody->GetPassiveJoints() : pbody->GetJoints()) {
+            int index0 = (*itjoint)->GetFirstAttached()->GetIndex(), index1 = (*itjoint)->GetSecondAttached()->GetIndex();
+            if( setadjacent.find(_GetAdjacentLinkPair(index0,index1)) == setadjacent.end() ) {
+                return "joined links are not adjacent";
+            }
+        }
+    }
+    if( pbody->IsRobot() ) {
+        // GetAttachedSensors and GetManipulators do not have const overloads
+        RobotBasePtr probot = RaveInterfaceCast<RobotBase>(boost::const_pointer_cast<KinBody>(pbody));
+        if( probot->GetAttachedSensors().size() > 0 ) {
+            return "it has attached sensors";
+        }
+        if( !!probot->GetController() ) {
+            return "it has a controller";
+        }
+        FOREACHC(itmanip, probot->GetManipulators()) {
+            // ik solvers can be created with arguments that the manipulator info does not hold
+            if( (*itmanip)->GetInfo()._sIkSolverXMLId.size() > 0 ) {
+                return str(boost::format("manipulator %s has an ik solver")%(*itmanip)->GetName());
+            }
+        }
+    }
+    return std::string();
+}
+
+void SceneCache::Write(const std::string& cachefilename, const std::string& fullfilename, const AttributesList& atts, const SceneLoadRecorder& recorder, const std::vector<KinBodyPtr>& vbodies)
+{
+    if( recorder._uncacheablereason.size() > 0 ) {
+        RAVELOG_DEBUG(str(boost::format("not caching %s since %s")%fullfilename%recorder._uncacheablereason));
+        return;
+    }
+    if( vbodies.size() == 0 ) {
+        return;
+    }
+    FOREACHC(itbody, vbodies) {
+        std::string reason = _GetUncacheableReason(*itbody);
+        std::map<KinBody*, SceneLoadRecorder::AddedBody>::const_iterator itadded = recorder._mapaddedbodies.find(itbody->get());
+        if( itadded == recorder._mapaddedbodies.end() ) {
+            reason = "it was not added by the load";
+        }
+        else {
+            FOREACHC(itlink, (*itbody)->GetLinks()) {
+                if( itadded->second._mapLinkTransforms.find((*itlink)->GetName()) == itadded->second._mapLinkTransforms.end() ) {
+                    reason = str(boost::format("link %s was created after adding it")%(*itlink)->GetName());
+                }
+            }
+            for(int ipassive = 0; ipassive < 2; ++ipassive) {
+                FOREACHC(itjoint, ipassive ? (*itbody)->GetPassiveJoints() : (*itbody)->GetJoints()) {
+                    if( itadded->second._mapJointInfos.find((*itjoint)->GetName()) == itadded->second._mapJointInfos.end() ) {
+                        reason = str(boost::format("joint %s was created after adding it")%(*itjoint)->GetName());
+                    }
+                }
+            }
+        }
+        if( reason.size() > 0 ) {
+            RAVELOG_DEBUG(str(boost::format("not caching %s since body %s cannot be cached: %s")%fullfilename%(*itbody)->GetName()%reason));
+            return;
+        }
+    }
+
+    std::set<std::string> setfilenames = recorder._setfilenames;
+    setfilenames.insert(fullfilename);
+
+#ifdef HAVE_BOOST_FILESYSTEM
+    try {
+        boost::filesystem::create_directories(_cachedirectory);
+    }
+    catch(const std::exception& ex) {
+        RAVELOG_VERBOSE(str(boost::format("failed to create scene cache directory %s: %s")%_cachedirectory%ex.what()));
+        return;
+    }
+#endif
+
+    // write to a temporary file and rename it so that processes loading at the same time never read a partial entry
+#ifdef _WIN32
+    std::string tempfilename = str(boost::format("%s.%d")%cachefilename%GetCurrentProcessId());
+#else
+    std::string tempfilename = str(boost::format("%s.%d")%cachefilename%getpid());
+#endif
+    {
+        std::ofstream f(tempfilename.c_str(), std::ios::out|std::ios::binary);
+        if( !f ) {
+            RAVELOG_VERBOSE(str(boost::format("failed to write scene cache %s")%tempfilename));
+            return;
+        }
+        SceneCacheWriter writer(f);
+        writer.WriteString(s_SceneCacheMagic);
+        writer.Write<uint32_t>(s_SceneCacheVersion);
+        writer.Write<uint32_t>(sizeof(dReal));
+        writer.WriteString(OPENRAVE_VERSION_STRING);
+        writer.WriteString(RaveGetInterfaceHash(PT_KinBody));
+        writer.WriteString(RaveGetInterfaceHash(PT_Robot));
+        writer.WriteString(_GetLoadKey(fullfilename, atts));
+
+        writer.Write<uint32_t>(setfilenames.size());
+        std::string content;
+        FOREACHC(itfilename, setfilenames) {
+            if( !_ReadFileContent(*itfilename, content) ) {
+                RAVELOG_VERBOSE(str(boost::format("not caching %s since %s cannot be read")%fullfilename%*itfilename));
+                f.close();
+                remove(tempfilename.c_str());
+                return;
+            }
+            writer.WriteString(*itfilename);
+            writer.Write<uint64_t>(content.size());
+            writer.WriteString(utils::GetMD5HashString(content));
+        }
+        writer.Write<uint32_t>(recorder._mapincludes.size());
+        FOREACHC(itinclude, recorder._mapincludes) {
+            writer.WriteString(itinclude->first.first);
+            writer.WriteString(itinclude->first.second);
+            writer.WriteString(itinclude->second);
+        }
+
+        writer.Write<uint32_t>(vbodies.size());
+        FOREACHC(itbody, vbodies) {
+            KinBodyPtr pbody = *itbody;
+            const SceneLoadRecorder::AddedBody& added = recorder._mapaddedbodies.find(pbody.get())->second;
+            writer.Write<uint8_t>(pbody->IsRobot());
+            writer.WriteString(pbody->GetXMLId());
+            writer.WriteString(added._name);
+            writer.Write<uint8_t>(added._bAnonymous);
+            writer.WriteString(pbody->GetURI());
+
+            const std::set<int>& setadjacent = pbody->GetAdjacentLinks();
+            std::set<int> setderived;
+            for(int ipassive = 0; ipassive < 2; ++ipassive) {
+                FOREACHC(itjoint, ipassive ? pbody->GetPassiveJoints() : pbody->GetJoints()) {
+                    setderived.insert(_GetAdjacentLinkPair((*itjoint)->GetFirstAttached()->GetIndex(), (*itjoint)->GetSecondAttached()->GetIndex()));
+                }
+            }
+
+            writer.Write<uint32_t>(pbody->GetLinks().size());
+            FOREACHC(itlink, pbody->GetLinks()) {
+                KinBody::LinkInfo info = (*itlink)->GetInfo();
+                info._t = added._mapLinkTransforms.find((*itlink)->GetName())->second;
+                // the geometry infos of the link are only refreshed by UpdateInfo when their number changes
+                info._vgeometryinfos.resize(0);
+                FOREACHC(itgeom, (*itlink)->GetGeometries()) {
+                    info._vgeometryinfos.push_back(KinBody::GeometryInfoPtr(new KinBody::GeometryInfo((*itgeom)->GetInfo())));
+                }
+                // store all adjacent links that KinBody::_ComputeInternalInformation would not derive by itself
+                info._vForcedAdjacentLinks.resize(0);
+                int index0 = (*itlink)->GetIndex();
+                FOREACHC(itlink1, pbody->GetLinks()) {
+                    int index1 = (*itlink1)->GetIndex();
+                    if( index1 <= index0 || (*itlink)->GetGeometries().size() == 0 || (*itlink1)->GetGeometries().size() == 0 ) {
+                        continue;
+                    }
+                    int pair = _GetAdjacentLinkPair(index0, index1);
+                    if( setadjacent.find(pair) != setadjacent.end() && setderived.find(pair) == setderived.end() ) {
+                        info._vForcedAdjacentLinks.push_back((*itlink1)->GetName());
+                    }
+                }
+                writer.WriteLinkInfo(info);
+            }
+
+            writer.Write<uint32_t>(pbody->GetJoints().size()+pbody->GetPassiveJoints().size());
+            for(int ipassive = 0; ipassive < 2; ++ipassive) {
+                FOREACHC(itjoint, ipassive ? pbody->GetPassiveJoints() : pbody->GetJoints()) {
+                    KinBody::JointInfo info = added._mapJointInfos.find((*itjoint)->GetName())->second;
+                    // parsers can set the mimic equations directly on the joint, they are copied to the info when the body is added
+                    info._vmimic = (*itjoint)->GetInfo()._vmimic;
+                    writer.WriteJointInfo(info);
+                }
+            }
+
+            std::vector<Transform> vlinktransforms;
+            std::vector<dReal> vdoflastsetvalues;
+            pbody->GetLinkTransformations(vlinktransforms, vdoflastsetvalues);
+            writer.Write<uint32_t>(vlinktransforms.size());
+            FOREACHC(ittrans, vlinktransforms) {
+                writer.WriteTransform(*ittrans);
+            }
+            writer.WriteValues(vdoflastsetvalues);
+
+            if( pbody->IsRobot() ) {
+                RobotBasePtr probot = RaveInterfaceCast<RobotBase>(pbody);
+                writer.Write<uint32_t>(probot->GetManipulators().size());
+                FOREACHC(itmanip, probot->GetManipulators()) {
+                    writer.WriteManipulatorInfo((*itmanip)->GetInfo());
+                }
+                writer.WriteString(!!probot->GetActiveManipulator() ? probot->GetActiveManipulator()->GetName() : std::string());
+                writer.WriteInts(probot->GetActiveDOFIndices());
+                writer.Write<int32_t>(probot->GetAffineDOF());
+                writer.WriteVector(probot->GetAffineRotationAxis());
+            }
+        }
+        if( !f ) {
+            RAVELOG_VERBOSE(str(boost::format("failed to write scene cache %s")%tempfilename));
+            f.close();
+            remove(tempfilename.c_str());
+            return;
+        }
+    }
+#ifdef _WIN32
+    remove(cachefilename.c_str());
+#endif
+    if( rename(tempfilename.c_str(), cachefilename.c_str()) != 0 ) {
+        RAVELOG_VERBOSE(str(boost::format("failed to write scene cache %s")%cachefilename));
+        remove(tempfilename.c_str());
+        return;
+    }
+    RAVELOG_DEBUG(str(boost::format("cached %d bodies of %s in %s")%vbodies.size()%fullfilename%cachefilename));
+    _EvictEntries();
+}
+
+void SceneCache::_EvictEntries()
+{
+#ifdef HAVE_BOOST_FILESYSTEM
+    try {
+        // the modification time of an entry is refreshed on every hit
+        std::multimap<time_t, std::pair<boost::filesystem::path, uint64_t> > mapentries;
+        uint64_t totalbytes = 0;
+        time_t curtime = time(NULL);
+        boost::filesystem::directory_iterator itend;
+        for(boost::filesystem::directory_iterator it(_cachedirectory); it != itend; ++it) {
+            boost::system::error_code ec;
+            if( !boost::filesystem::is_regular_file(it->status()) ) {
+                continue;
+            }
+            boost::filesystem::path path = it->path();
+            time_t modtime = boost::filesystem::last_write_time(path, ec);
+            if( ec ) {
+                continue;
+            }
+            if( path.extension() == ".scene" ) {
+                uint64_t filesize = boost::filesystem::file_size(path, ec);
+                if( !ec ) {
+                    mapentries.insert(std::make_pair(modtime, std::make_pair(path, filesize)));
+                    totalbytes += filesize;
+                }
+            }
+            else if( path.stem().extension() == ".scene" && modtime + s_SceneCacheTempFileTimeout < curtime ) {
+                boost::filesystem::remove(path, ec);
+            }
+        }
+        size_t numentries = mapentries.size();
+        for(std::multimap<time_t, std::pair<boost::filesystem::path, uint64_t> >::iterator it = mapentries.begin(); it != mapentries.end() && (numentries > s_SceneCacheMaxEntries || totalbytes > s_SceneCacheMaxBytes); ++it) {
+            boost::system::error_code ec;
+            boost::filesystem::remove(it->second.first, ec);
+            if( !ec ) {
+                RAVELOG_VERBOSE(str(boost::format("evicted scene cache %s")%it->second.first.string()));
+            }
+            numentries -= 1;
+            totalbytes -= it->second.second;
+        }
+    }
+    catch(const std::exception& ex) {
+        RAVELOG_VERBOSE(str(boost::format("failed to evict scene cache entries in %s: %s")%_cachedirectory%ex.what()));
+    }
+#endif
+}
+
+bool SceneCache::Read(EnvironmentBasePtr penv, const std::string& cachefilename, const std::string& fullfilename, const AttributesList& atts)
+{
+    std::string data;
+    if( !_ReadFileContent(cachefilename, data) ) {
+        return false;
+    }
+
+    std::vector<CachedBody> vcachedbodies;
+    try {
+        SceneCacheReader reader(data);
+        if( reader.ReadString() != s_SceneCacheMagic || reader.Read<uint32_t>() != s_SceneCacheVersion || reader.Read<uint32_t>() != sizeof(dReal) ) {
+            RAVELOG_DEBUG(str(boost::format("ignoring scene cache %s since it was written with a different format")%cachefilename));
+            return false;
+        }
+        if( reader.ReadString() != OPENRAVE_VERSION_STRING || reader.ReadString() != RaveGetInterfaceHash(PT_KinBody) || reader.ReadString() != RaveGetInterfaceHash(PT_Robot) ) {
+            RAVELOG_DEBUG(str(boost::format("ignoring scene cache %s since it was written by a different version")%cachefilename));
+            return false;
+        }
+        if( reader.ReadString() != _GetLoadKey(fullfilename, atts) ) {
+            return false;
+        }
+
+        uint32_t numfiles = reader.Read<uint32_t>();
+        std::string content;
+        for(uint32_t ifile = 0; ifile < numfiles; ++ifile) {
+            std::string filename = reader.ReadString();
+            uint64_t filesize = reader.Read<uint64_t>();
+            std::string md5 = reader.ReadString();
+            bool bValid = false;
+#ifdef HAVE_BOOST_FILESYSTEM
+            // cheap rejection before hashing the content
+            boost::system::error_code ec;
+            if( boost::filesystem::file_size(filename, ec) == filesize && !ec ) {
+                bValid = _ReadFileContent(filename, content) && utils::GetMD5HashString(content) == md5;
+            }
+#else
+            bValid = _ReadFileContent(filename, content) && content.size() == filesize && utils::GetMD5HashString(content) == md5;
+#endif
+            if( !bValid ) {
+                RAVELOG_DEBUG(str(boost::format("scene cache of %s is out of date since %s changed")%fullfilename%filename));
+                return false;
+            }
+        }
+        uint32_t numincludes = reader.Read<uint32_t>();
+        for(uint32_t iinclude = 0; iinclude < numincludes; ++iinclude) {
+            std::string filename = reader.ReadString();
+            std::string curdir = reader.ReadString();
+            std::string resolvedfilename = reader.ReadString();
+            if( RaveFindLocalFile(filename, curdir) != resolvedfilename ) {
+                RAVELOG_DEBUG(str(boost::format("scene cache of %s is out of date since %s does not resolve to %s anymore")%fullfilename%filename%resolvedfilename));
+                return false;
+            }
+        }
+
+        uint32_t numbodies = reader.Read<uint32_t>();
+        vcachedbodies.resize(numbodies);
+        FOREACH(itcached, vcachedbodies) {
+            itcached->_bIsRobot = reader.Read<uint8_t>() != 0;
+            itcached->_xmlid = reader.ReadString();
+            itcached->_name = reader.ReadString();
+            itcached->_bAnonymous = reader.Read<uint8_t>() != 0;
+            itcached->_uri = reader.ReadString();
+            uint32_t numlinks = reader.Read<uint32_t>();
+            for(uint32_t ilink = 0; ilink < numlinks; ++ilink) {
+                KinBody::LinkInfoPtr pinfo(new KinBody::LinkInfo());
+                reader.ReadLinkInfo(*pinfo);
+                itcached->_vlinkinfos.push_back(pinfo);
+            }
+            uint32_t numjoints = reader.Read<uint32_t>();
+            for(uint32_t ijoint = 0; ijoint < numjoints; ++ijoint) {
+                KinBody::JointInfoPtr pinfo(new KinBody::JointInfo());
+                reader.ReadJointInfo(*pinfo);
+                itcached->_vjointinfos.push_back(pinfo);
+            }
+            uint32_t numtransforms = reader.Read<uint32_t>();
+            if( numtransforms != numlinks ) {
+                throw OPENRAVE_EXCEPTION_FORMAT("scene cache has %d link transforms for %d links", numtransforms%numlinks, ORE_InvalidState);
+            }
+            itcached->_vlinktransforms.resize(numtransforms);
+            FOREACH(ittrans, itcached->_vlinktransforms) {
+                *ittrans = reader.ReadTransform();
+            }
+            reader.ReadValues(itcached->_vdoflastsetvalues);
+            if( itcached->_bIsRobot ) {
+                uint32_t nummanips = reader.Read<uint32_t>();
+                for(uint32_t imanip = 0; imanip < nummanips; ++imanip) {
+                    RobotBase::ManipulatorInfoPtr pinfo(new RobotBase::ManipulatorInfo());
+                    reader.ReadManipulatorInfo(*pinfo);
+                    itcached->_vmanipinfos.push_back(pinfo);
+                }
+                itcached->_activemanipname = reader.ReadString();
+                reader.ReadInts(itcached->_vactivedofindices);
+                itcached->_affinedofs = reader.Read<int32_t>();
+                itcached->_vaffinerotationaxis = reader.ReadVector();
+            }
+        }
+        if( !reader.IsDone() ) {
+            throw OPENRAVE_EXCEPTION_FORMAT0("scene cache has trailing data", ORE_InvalidState);
+        }
+    }
+    catch(const std::exception& ex) {
+        RAVELOG_WARN(str(boost::format("ignoring corrupted scene cache %s: %s")%cachefilename%ex.what()));
+        return false;
+    }
+
+    // if a body name is taken, parse the file so that the load fails the same way it would without the cache
+    FOREACHC(itcached, vcachedbodies) {
+        if( !itcached->_bAnonymous && !!penv->GetKinBody(itcached->_name) ) {
+            return false;
+        }
+    }
+
+    std::vector<KinBodyPtr> vbodies;
+    try {
+        FOREACHC(itcached, vcachedbodies) {
+            KinBodyPtr pbody;
+            if( itcached->_bIsRobot ) {
+                RobotBasePtr probot = RaveCreateRobot(penv, itcached->_xmlid);
+                if( !probot ) {
+                    return false;
+                }
+                std::vector<RobotBase::AttachedSensorInfoConstPtr> vattachedsensorinfos;
+                if( !probot->Init(itcached->_vlinkinfos, itcached->_vjointinfos, itcached->_vmanipinfos, vattachedsensorinfos, itcached->_uri) ) {
+                    return false;
+                }
+                pbody = probot;
+            }
+            else {
+                pbody = RaveCreateKinBody(penv, itcached->_xmlid);
+                if( !pbody || !pbody->Init(itcached->_vlinkinfos, itcached->_vjointinfos, itcached->_uri) ) {
+                    return false;
+                }
+            }
+            pbody->SetName(itcached->_name);
+            vbodies.push_back(pbody);
+        }
+    }
+    catch(const std::exception& ex) {
+        RAVELOG_WARN(str(boost::format("failed to create bodies from scene cache %s: %s")%cachefilename%ex.what()));
+        return false;
+    }
+
+    size_t numadded = 0;
+    try {
+        for(numadded = 0; numadded < vbodies.size(); ++numadded) {
+            const CachedBody& cached = vcachedbodies[numadded];
+            penv->Add(vbodies[numadded], cached._bAnonymous);
+            vbodies[numadded]->SetLinkTransformations(cached._vlinktransforms, cached._vdoflastsetvalues);
+            if( cached._bIsRobot ) {
+                RobotBasePtr probot = RaveInterfaceCast<RobotBase>(vbodies[numadded]);
+                if( cached._activemanipname.size() > 0 ) {
+                    probot->SetActiveManipulator(cached._activemanipname);
+                }
+                probot->SetActiveDOFs(cached._vactivedofindices, cached._affinedofs, cached._vaffinerotationaxis);
+            }
+        }
+    }
+    catch(const std::exception& ex) {
+        RAVELOG_WARN(str(boost::format("failed to add bodies from scene cache %s: %s")%cachefilename%ex.what()));
+        for(size_t i = 0; i <= numadded && i < vbodies.size(); ++i) {
+            penv->Remove(vbodies[i]);
+        }
+        return false;
+    }
+#ifdef HAVE_BOOST_FILESYSTEM
+    // mark the entry as recently used for _EvictEntries
+    boost::system::error_code ec;
+    boost::filesystem::last_write_time(cachefilename, time(NULL), ec);
+#endif
+    RAVELOG_DEBUG(str(boost::format("loaded %d bodies of %s from scene cache %s")%vbodies.size()%fullfilename%cachefilename));
+    return true;
+}
+
+} // end namespace OpenRAVE
@@ -0,0 +1,141 @@
+// -*- coding: utf-8 -*-
+// Copyright (C) 2006-2014 Rosen Diankov <rosen.diankov@gmail.com>
+//
+// This file is part of OpenRAVE.
+// OpenRAVE is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+/**
+   \file   scenecache.h
+   \brief  Binary cache of the bodies created by Environment::Load
+ */
+#ifndef RAVE_SCENECACHE_H
+#define RAVE_SCENECACHE_H
+
+namespace OpenRAVE {
+
+/// \brief records the files read and the bodies added while Environment::Load is running
+///
+/// The recorder installs itself for the current thread on construction, so the parsers can report every file they
+/// resolve without having access to it. Loads are not re-entrant across threads, so nested loads from environment
+/// files are recorded by the recorder of the outermost load.
+class SceneLoadRecorder
+{
+public:
+    SceneLoadRecorder();
+    ~SceneLoadRecorder();
+
+    /// \brief the recorder of the current thread, 0 if no load is being recorded
+    static SceneLoadRecorder* GetCurrent();
+
+    /// \brief adds a fully resolved file that the current load depends on
+    static void RecordFile(const std::string& filename);
+
+    /// \brief resolves a file referenced by the file being parsed and remembers how it was resolved
+    ///
+    /// Parsers use it instead of RaveFindLocalFile for every include and mesh reference, so that the cache can
+    /// detect when the same reference resolves to a different file, for example when the data directories changed.
+    /// \return the result of RaveFindLocalFile
+    static std::string FindLocalFile(const std::string& filename, const std::string& curdir);
+
+    /// \brief marks the current load as having side effects that cannot be reproduced from the cache
+    static void SetUncacheable(const std::string& reason);
+
+    /// \brief remembers the relative transform of the attached links when a parser initializes a joint
+    ///
+    /// The internal joint transforms depend on the link poses they are computed at, which the parsers can change
+    /// afterwards when including other files. Has to be called right after Joint::_ComputeInternalInformation.
+    static void RecordJointFrame(KinBody::JointConstPtr pjoint, const std::vector<dReal>& vcurrentvalues);
+
+    /// \brief remembers the state of a body right before it is added to the environment
+    ///
+    /// Has to be called before the environment renames the body or computes its internal information.
+    static void RecordAddedBody(KinBodyPtr pbody, bool bAnonymous);
+
+    /// \brief a body as the parser created it
+    struct AddedBody
+    {
+        std::string _name; ///< name before the environment made it unique
+        bool _bAnonymous; ///< true if added anonymously
+        std::map<std::string, Transform> _mapLinkTransforms; ///< link transforms that reproduce the joint frames
+        std::map<std::string, KinBody::JointInfo> _mapJointInfos; ///< infos the joints were initialized with
+    };
+
+    /// \brief link frames of a joint when it was initialized
+    struct JointFrame
+    {
+        Transform _trelative; ///< transform of the second attached link in the first attached link
+        std::vector<dReal> _vcurrentvalues; ///< joint values the joint was initialized with
+    };
+
+    std::set<std::string> _setfilenames; ///< full paths of all the files read by the load
+    std::map<std::pair<std::string, std::string>, std::string> _mapincludes; ///< (reference, directory) of every file looked up by the load, and the file it resolved to (empty if not found)
+    std::map<const KinBody::Joint*, JointFrame> _mapjointframes; ///< frames of the joints initialized by the parsers
+    std::map<KinBody*, AddedBody> _mapaddedbodies; ///< every body added by the load
+    std::string _uncacheablereason; ///< if not empty, the reason the load cannot be cached
+};
+
+/// \brief Binary cache of the bodies created by Environment::Load.
+///
+/// Every entry stores the fully resolved link, joint and manipulator infos, including the collision meshes, of the
+/// bodies that a file load added. The entry is keyed by the path of the file and the load attributes, and holds
+/// the md5 of the content of every file that was read, so editing the main file, an included file or a mesh
+/// invalidates it. Every file reference is resolved again on a hit, and the key contains the data directories, so
+/// a reference that would now resolve to a different file also invalidates it. On a hit the bodies are created directly with KinBody::Init and RobotBase::Init, skipping the
+/// XML/COLLADA parsing and the mesh triangulation.
+///
+/// Loads that change anything else in the environment (modules, sensors, physics engines, viewers, plugins or
+/// existing bodies) are never cached. The least recently used entries are removed once the directory holds more
+/// than a fixed number of entries or bytes.
+class SceneCache
+{
+public:
+    /// \param cachedirectory directory holding the cache files, created when the first entry is written
+    SceneCache(const std::string& cachedirectory);
+    virtual ~SceneCache() {
+    }
+
+    /// \brief returns the cache file of a load, empty if the load cannot be cached
+    ///
+    /// \param fullfilename the resolved filename passed to Environment::Load
+    virtual std::string GetCacheFilename(const std::string& fullfilename, const AttributesList& atts) const;
+
+    /// \brief if the cache file is valid, creates its bodies and adds them to the environment
+    ///
+    /// \return true if the bodies were added. If false, the environment was not modified.
+    virtual bool Read(EnvironmentBasePtr penv, const std::string& cachefilename, const std::string& fullfilename, const AttributesList& atts);
+
+    /// \brief writes the bodies added by a successful load to the cache file
+    ///
+    /// \param vbodies the bodies added to the environment by the load, in order
+    virtual void Write(const std::string& cachefilename, const std::string& fullfilename, const AttributesList& atts, const SceneLoadRecorder& recorder, const std::vector<KinBodyPtr>& vbodies);
+
+protected:
+    /// \brief returns a string identifying the load, stored in the cache file to protect against hash collisions
+    static std::string _GetLoadKey(const std::string& fullfilename, const AttributesList& atts);
+
+    /// \brief returns the reason a body cannot be cached, or empty if it can be
+    static std::string _GetUncacheableReason(KinBodyConstPtr pbody);
+
+    /// \brief removes the least recently used entries until the cache directory is within its bounds
+    ///
+    /// Also removes the temporary files left behind by processes that died while writing.
+    virtual void _EvictEntries();
+
+    std::string _cachedirectory;
+};
+
+typedef boost::shared_ptr<SceneCache> SceneCachePtr;
+
+} // end namespace OpenRAVE
+
+#endif
@@ -31,6 +31,8 @@
 
 #include <iostream>
 #include <sstream>
+#include <sys/types.h>
+#include <sys/stat.h>
 
 #ifdef HAVE_BOOST_FILESYSTEM
 #include <boost/filesystem.hpp>
@@ -229,7 +231,205 @@ static bool _AssimpCreateTriMesh(const aiScene* scene, aiNode* node, const Vecto
 
 #endif
 
-bool CreateTriMeshData(EnvironmentBasePtr penv, const std::string& filename, const Vector& vscale, TriMesh& trimesh, RaveVector<float>& diffuseColor, RaveVector<float>& ambientColor, float& ftransparency)
+/// \brief process-wide cache of imported mesh files
+///
+/// Files referenced by many links and bodies, like the model of an object placed many times, are only imported
+/// once. The entries are keyed by the path, modification time in nanoseconds and size of the file and are never modified
+/// after being inserted, so they can be shared between threads. CreateTriMeshData meshes are stored unscaled and without the
+/// unused w of the vertices, so a file used with different scales is stored once. The least recently used entries are evicted once
+/// the cache holds more than s_nMaxMeshFileImportCacheBytes.
+///
+/// The collision meshes of CreateGeometries entries are shared with the geometries created from them through
+/// KinBody::GeometryInfo::SetSharedCollisionMesh, so a mesh placed many times is stored once. A geometry copies its
+/// mesh only when it is modified (KinBody::GeometryInfo::GetModifiableCollisionMesh).
+class MeshFileImportCache
+{
+public:
+    /// \brief immutable triangle mesh, 3 values per vertex
+    class ImportedMesh
+    {
+public:
+        ImportedMesh(const TriMesh& trimesh) : _vindices(trimesh.indices) {
+            _vvertices.resize(3*trimesh.vertices.size());
+            for(size_t i = 0; i < trimesh.vertices.size(); ++i) {
+                _vvertices[3*i+0] = trimesh.vertices[i].x;
+                _vvertices[3*i+1] = trimesh.vertices[i].y;
+                _vvertices[3*i+2] = trimesh.vertices[i].z;
+            }
+        }
+
+        /// \brief appends the mesh scaled by vscale to trimesh
+        void AppendTo(TriMesh& trimesh, const Vector& vscale) const
+        {
+            size_t offset = trimesh.vertices.size();
+            trimesh.vertices.resize(offset + _vvertices.size()/3);
+            for(size_t i = 0; i < _vvertices.size(); i += 3) {
+                trimesh.vertices[offset+i/3] = Vector(_vvertices[i]*vscale.x, _vvertices[i+1]*vscale.y, _vvertices[i+2]*vscale.z);
+            }
+            size_t indexoffset = trimesh.indices.size();
+            trimesh.indices.insert(trimesh.indices.end(), _vindices.begin(), _vindices.end());
+            if( offset > 0 ) {
+                for(size_t i = indexoffset; i < trimesh.indices.size(); ++i) {
+                    trimesh.indices[i] += offset;
+                }
+            }
+        }
+
+        size_t GetNumBytes() const {
+            return _vvertices.size()*sizeof(dReal) + _vindices.size()*sizeof(int);
+        }
+
+private:
+        std::vector<dReal> _vvertices;
+        std::vector<int> _vindices;
+    };
+
+    /// \brief result of CreateTriMeshData with unit scale
+    class TriMeshData
+    {
+public:
+        TriMeshData(const TriMesh& trimesh) : _mesh(trimesh), _fTransparency(0), _bHasMaterial(false), _bAppend(false) {
+        }
+        ImportedMesh _mesh;
+        RaveVector<float> _vDiffuseColor, _vAmbientColor;
+        float _fTransparency;
+        bool _bHasMaterial; ///< true if the importer set the colors and transparency
+        bool _bAppend; ///< true if the importer appends to the mesh passed to CreateTriMeshData instead of overwriting it
+    };
+    typedef boost::shared_ptr<TriMeshData const> TriMeshDataConstPtr;
+
+    /// \brief result of CreateGeometries, the meshes of the geometries are only stored in _vmeshes
+    class Geometries
+    {
+public:
+        size_t GetNumBytes() const {
+            size_t nbytes = 0;
+            FOREACHC(itmesh, _vmeshes) {
+                nbytes += (*itmesh)->vertices.size()*sizeof(Vector) + (*itmesh)->indices.size()*sizeof(int);
+            }
+            return nbytes;
+        }
+
+        std::list<KinBody::GeometryInfo> _listGeometries;
+        std::vector< boost::shared_ptr<TriMesh const> > _vmeshes; ///< the scaled collision mesh of every geometry of _listGeometries, shared with the created geometries
+    };
+    typedef boost::shared_ptr<Geometries const> GeometriesConstPtr;
+
+    static MeshFileImportCache& GetInstance()
+    {
+        boost::call_once(_CreateInstance,s_onceCreateInstance);
+        return *s_pInstance;
+    }
+
+    /// \brief computes the key of a file, returns false if the file cannot be accessed
+    static bool GetKey(const std::string& type, const std::string& filename, std::string& key)
+    {
+        struct stat filestat;
+        if( stat(filename.c_str(), &filestat) != 0 ) {
+            return false;
+        }
+        // files rewritten within the same second have to be told apart
+        uint64_t mtime = static_cast<uint64_t>(filestat.st_mtime)*1000000000;
+#if defined(__APPLE__)
+        mtime += filestat.st_mtimespec.tv_nsec;
+#elif defined(__linux__)
+        mtime += filestat.st_mtim.tv_nsec;
+#endif
+        key = str(boost::format("%s;%s;%d;%d")%type%filename%mtime%static_cast<uint64_t>(filestat.st_size));
+        return true;
+    }
+
+    TriMeshDataConstPtr FindTriMeshData(const std::string& key)
+    {
+        boost::mutex::scoped_lock lock(_mutex);
+        std::map<std::string, Entry>::iterator it = _Find(key);
+        return it != _mapentries.end() ? it->second._ptrimeshdata : TriMeshDataConstPtr();
+    }
+
+    GeometriesConstPtr FindGeometries(const std::string& key)
+    {
+        boost::mutex::scoped_lock lock(_mutex);
+        std::map<std::string, Entry>::iterator it = _Find(key);
+        return it != _mapentries.end() ? it->second._pgeometries : GeometriesConstPtr();
+    }
+
+    void AddTriMeshData(const std::string& key, TriMeshDataConstPtr ptrimeshdata)
+    {
+        Entry entry;
+        entry._ptrimeshdata = ptrimeshdata;
+        entry._nbytes = ptrimeshdata->_mesh.GetNumBytes();
+        _Add(key, entry);
+    }
+
+    void AddGeometries(const std::string& key, GeometriesConstPtr pgeometries)
+    {
+        Entry entry;
+        entry._pgeometries = pgeometries;
+        entry._nbytes = pgeometries->GetNumBytes();
+        _Add(key, entry);
+    }
+
+private:
+    struct Entry
+    {
+        TriMeshDataConstPtr _ptrimeshdata;
+        GeometriesConstPtr _pgeometries;
+        size_t _nbytes;
+        std::list<std::string>::iterator _itused; ///< position in _listused
+    };
+
+    MeshFileImportCache() : _nbytes(0) {
+    }
+
+    static void _CreateInstance()
+    {
+        // don't make it a static variable in order to ensure it remains valid for as long as possible
+        s_pInstance = new MeshFileImportCache();
+    }
+
+    std::map<std::string, Entry>::iterator _Find(const std::string& key)
+    {
+        std::map<std::string, Entry>::iterator it = _mapentries.find(key);
+        if( it != _mapentries.end() ) {
+            _listused.splice(_listused.begin(), _listused, it->second._itused);
+        }
+        return it;
+    }
+
+    void _Add(const std::string& key, Entry& entry)
+    {
+        boost::mutex::scoped_lock lock(_mutex);
+        if( entry._nbytes > s_nMaxMeshFileImportCacheBytes || _mapentries.find(key) != _mapentries.end() ) {
+            return;
+        }
+        while( _nbytes + entry._nbytes > s_nMaxMeshFileImportCacheBytes ) {
+            std::map<std::string, Entry>::iterator itold = _mapentries.find(_listused.back());
+            _nbytes -= itold->second._nbytes;
+            _mapentries.erase(itold);
+            _listused.pop_back();
+        }
+        _listused.push_front(key);
+        entry._itused = _listused.begin();
+        _mapentries[key] = entry;
+        _nbytes += entry._nbytes;
+    }
+
+    static const size_t s_nMaxMeshFileImportCacheBytes = 64*1024*1024;
+    static MeshFileImportCache* s_pInstance;
+    static boost::once_flag s_onceCreateInstance;
+
+    boost::mutex _mutex;
+    std::map<std::string, Entry> _mapentries;
+    std::list<std::string> _listused; ///< keys ordered from most to least recently used
+    size_t _nbytes; ///< total size of the cached meshes
+};
+
+MeshFileImportCache* MeshFileImportCache::s_pInstance = NULL;
+boost::once_flag MeshFileImportCache::s_onceCreateInstance = BOOST_ONCE_INIT;
+
+/// \param bHasMaterial set to true if the importer set the colors and transparency
+/// \param bAppend set to true if the importer appended to trimesh, otherwise trimesh was overwritten
+static bool _ImportTriMeshData(EnvironmentBasePtr penv, const std::string& filename, const Vector& vscale, TriMesh& trimesh, RaveVector<float>& diffuseColor, RaveVector<float>& ambientColor, float& ftransparency, bool& bHasMaterial, bool& bAppend)
 {
     string extension;
     if( filename.find_last_of('.') != string::npos ) {
@@ -244,6 +444,7 @@ bool CreateTriMeshData(EnvironmentBasePtr penv, const std::string& filename, con
             aiSceneManaged scene(filename);
             if( !!scene._scene && !!scene._scene->mRootNode && !!scene._scene->HasMeshes() ) {
                 if( _AssimpCreateTriMesh(scene._scene,scene._scene->mRootNode, vscale, trimesh, diffuseColor, ambientColor, ftransparency) ) {
+                    bAppend = true;
                     return true;
                 }
             }
@@ -275,6 +476,7 @@ bool CreateTriMeshData(EnvironmentBasePtr penv, const std::string& filename, con
                     aiSceneManaged scene(newdata, false);
                     if( !!scene._scene && !!scene._scene->mRootNode && !!scene._scene->HasMeshes() ) {
                         if( _AssimpCreateTriMesh(scene._scene,scene._scene->mRootNode, vscale, trimesh, diffuseColor, ambientColor, ftransparency) ) {
+                            bAppend = true;
                             return true;
                         }
                     }
@@ -300,6 +502,7 @@ bool CreateTriMeshData(EnvironmentBasePtr penv, const std::string& filename, con
                     it->y *= vscale.y;
                     it->z *= vscale.z;
                 }
+                bHasMaterial = true;
                 return true;
             }
         }
@@ -319,6 +522,48 @@ bool CreateTriMeshData(EnvironmentBasePtr penv, const std::string& filename, con
     return false;
 }
 
+bool CreateTriMeshData(EnvironmentBasePtr penv, const std::string& filename, const Vector& vscale, TriMesh& trimesh, RaveVector<float>& diffuseColor, RaveVector<float>& ambientColor, float& ftransparency)
+{
+    SceneLoadRecorder::RecordFile(filename);
+    string key;
+    bool bCache = MeshFileImportCache::GetKey("trimesh", filename, key);
+    MeshFileImportCache::TriMeshDataConstPtr ptrimeshdata;
+    if( bCache ) {
+        ptrimeshdata = MeshFileImportCache::GetInstance().FindTriMeshData(key);
+    }
+    if( !ptrimeshdata ) {
+        // all importers scale the vertices last, so the mesh is imported unscaled and shared by all scales
+        TriMesh importedtrimesh;
+        RaveVector<float> vDiffuseColor, vAmbientColor;
+        float fTransparency = 0;
+        bool bHasMaterial = false, bAppend = false;
+        if( !_ImportTriMeshData(penv, filename, Vector(1,1,1), importedtrimesh, vDiffuseColor, vAmbientColor, fTransparency, bHasMaterial, bAppend) ) {
+            return false;
+        }
+        boost::shared_ptr<MeshFileImportCache::TriMeshData> pnewtrimeshdata(new MeshFileImportCache::TriMeshData(importedtrimesh));
+        pnewtrimeshdata->_vDiffuseColor = vDiffuseColor;
+        pnewtrimeshdata->_vAmbientColor = vAmbientColor;
+        pnewtrimeshdata->_fTransparency = fTransparency;
+        pnewtrimeshdata->_bHasMaterial = bHasMaterial;
+        pnewtrimeshdata->_bAppend = bAppend;
+        ptrimeshdata = pnewtrimeshdata;
+        if( bCache ) {
+            MeshFileImportCache::GetInstance().AddTriMeshData(key, ptrimeshdata);
+        }
+    }
+    if( !ptrimeshdata->_bAppend ) {
+        trimesh.vertices.resize(0);
+        trimesh.indices.resize(0);
+    }
+    ptrimeshdata->_mesh.AppendTo(trimesh, vscale);
+    if( ptrimeshdata->_bHasMaterial ) {
+        diffuseColor = ptrimeshdata->_vDiffuseColor;
+        ambientColor = ptrimeshdata->_vAmbientColor;
+        ftransparency = ptrimeshdata->_fTransparency;
+    }
+    return true;
+}
+
 
 struct XMLREADERDATA
 {
@@ -510,11 +755,12 @@ static int raveXmlSAXUserParseMemory(xmlSAXHandlerPtr sax, BaseXMLReaderPtr prea
 
 bool ParseXMLFile(BaseXMLReaderPtr preader, const string& filename)
 {
-    string filedata = RaveFindLocalFile(filename,GetParseDirectory());
+    string filedata = SceneLoadRecorder::FindLocalFile(filename,GetParseDirectory());
     if( filedata.size() == 0 ) {
         return false;
     }
     EnvironmentMutex::scoped_lock lock(*GetXMLMutex());
+    SceneLoadRecorder::RecordFile(filedata);
 
 #ifdef HAVE_BOOST_FILESYSTEM
     SetParseDirectoryScope scope(boost::filesystem::path(filedata).parent_path().string());
@@ -737,6 +983,46 @@ public:
 #endif
 
     static bool CreateGeometries(EnvironmentBasePtr penv, const std::string& filename, const Vector& vscale, std::list<KinBody::GeometryInfo>& listGeometries)
+    {
+        SceneLoadRecorder::RecordFile(filename);
+        string key;
+        bool bCache = MeshFileImportCache::GetKey("geometries", filename, key);
+        MeshFileImportCache::GeometriesConstPtr pgeometries;
+        if( bCache ) {
+            // the scale also changes the geometry transforms and render scales, so it is part of the key
+            key += str(boost::format(";%.15e;%.15e;%.15e")%vscale.x%vscale.y%vscale.z);
+            pgeometries = MeshFileImportCache::GetInstance().FindGeometries(key);
+        }
+        if( !pgeometries ) {
+            std::list<KinBody::GeometryInfo> listimported;
+            if( !_ImportGeometries(penv, filename, vscale, listimported) ) {
+                return false;
+            }
+            boost::shared_ptr<MeshFileImportCache::Geometries> pnewgeometries(new MeshFileImportCache::Geometries());
+            pnewgeometries->_vmeshes.reserve(listimported.size());
+            FOREACH(itgeom, listimported) {
+                boost::shared_ptr<TriMesh> pmesh(new TriMesh());
+                pmesh->vertices.swap(itgeom->_meshcollision.vertices);
+                pmesh->indices.swap(itgeom->_meshcollision.indices);
+                pnewgeometries->_vmeshes.push_back(pmesh);
+            }
+            pnewgeometries->_listGeometries.swap(listimported);
+            pgeometries = pnewgeometries;
+            if( bCache ) {
+                MeshFileImportCache::GetInstance().AddGeometries(key, pgeometries);
+            }
+        }
+        // the geometries share the cached meshes and copy them only when modified
+        std::vector< boost::shared_ptr<TriMesh const> >::const_iterator itmesh = pgeometries->_vmeshes.begin();
+        FOREACHC(itgeom, pgeometries->_listGeometries) {
+            listGeometries.push_back(*itgeom);
+            listGeometries.back().SetSharedCollisionMesh(*itmesh);
+            ++itmesh;
+        }
+        return true;
+    }
+
+    static bool _ImportGeometries(EnvironmentBasePtr penv, const std::string& filename, const Vector& vscale, std::list<KinBody::GeometryInfo>& listGeometries)
     {
         string extension;
         if( filename.find_last_of('.') != string::npos ) {
@@ -775,7 +1061,8 @@ public:
         g._vDiffuseColor=Vector(1,0.5f,0.5f,1);
         g._vAmbientColor=Vector(0.1,0.0f,0.0f,0);
         g._vRenderScale = vscale;
-        if( !CreateTriMeshData(penv,filename,vscale,g._meshcollision,g._vDiffuseColor,g._vAmbientColor,g._fTransparency) ) {
+        bool bHasMaterial = false, bAppend = false;
+        if( !_ImportTriMeshData(penv,filename,vscale,g._meshcollision,g._vDiffuseColor,g._vAmbientColor,g._fTransparency,bHasMaterial,bAppend) ) {
             return false;
         }
         return true;
@@ -842,6 +1129,8 @@ public:
         if( !_plink ) {
             _plink.reset(new KinBody::Link(pparent));
         }
+        // geometries are appended to the collision data of a reopened link, so it cannot stay shared
+        _plink->_UnshareCollisionData();
         if( linkname.size() > 0 ) {
             _plink->_info._name = linkname;
         }
@@ -928,6 +1217,7 @@ public:
                     FOREACH(itgeom, _plink->_vGeometries) {
                         (*itgeom)->_info._t = tnew * (*itgeom)->_info._t;
                     }
+                    _plink->_UnshareCollisionData();
                     _plink->_collision.ApplyTransform(tnew);
                     _plink->SetTransform(tOrigTrans);
                 }
@@ -996,8 +1286,11 @@ public:
                                 itnewgeom->_t = info->_t;
                                 itnewgeom->_fTransparency = info->_fTransparency;
                                 itnewgeom->_filenamerender = string("__norenderif__:")+extension;
-                                FOREACH(it,itnewgeom->_meshcollision.vertices) {
-                                    *it = tmres * *it;
+                                if( _vScaleGeometry.x != 1 || _vScaleGeometry.y != 1 || _vScaleGeometry.z != 1 ) {
+                                    // only copy the shared mesh when it has to be scaled
+                                    FOREACH(it,itnewgeom->GetModifiableCollisionMesh().vertices) {
+                                        *it = tmres * *it;
+                                    }
                                 }
                                 if( geomreader->IsOverwriteDiffuse() ) {
                                     itnewgeom->_vDiffuseColor = info->_vDiffuseColor;
@@ -1009,7 +1302,7 @@ public:
                                     itnewgeom->_fTransparency = info->_fTransparency;
                                 }
                                 itnewgeom->_t.trans *= _vScaleGeometry;
-                                _plink->_collision.Append(itnewgeom->_meshcollision, itnewgeom->_t);
+                                _plink->_collision.Append(itnewgeom->GetCollisionMesh(), itnewgeom->_t);
                             }
                             listGeometries.front()._vRenderScale = info->_vRenderScale*geomspacescale;
                             listGeometries.front()._filenamerender = info->_filenamerender;
@@ -1110,6 +1403,7 @@ public:
             if(( _plink->GetGeometries().size() == 0) && !_bSkipGeometry) {
                 RAVELOG_VERBOSE(str(boost::format("link %s has no geometry attached!\n")%_plink->GetName()));
             }
+            _plink->_ShareGeometryCollisionMesh();
             // perform final processing stages
             MASS totalmass;
             if( _masstype == MT_MimicGeom ) {
@@ -1479,6 +1773,7 @@ public:
                 *itaxis = toffsetfrom.rotate(*itaxis);
             }
             _pjoint->_ComputeInternalInformation(attachedbodies[0],attachedbodies[1],toffsetfrom*_vanchor,_vAxes,_vinitialvalues);
+            SceneLoadRecorder::RecordJointFrame(_pjoint,_vinitialvalues);
             return true;
         }
         else if( xmlname == "weight" ) {
@@ -1710,10 +2005,11 @@ public:
 
                 //BaseXMLReaderPtr preader = CreateInterfaceReader(_penv,_type,_pinterface, xmltag, listnewatts);
                 //bool bSuccess = ParseXMLFile(preader, itatt->second);
-                string filedata = RaveFindLocalFile(itatt->second,GetParseDirectory());
+                string filedata = SceneLoadRecorder::FindLocalFile(itatt->second,GetParseDirectory());
                 if( filedata.size() == 0 ) {
                     continue;
                 }
+                SceneLoadRecorder::RecordFile(filedata);
 
                 try {
 #ifdef HAVE_BOOST_FILESYSTEM
@@ -2028,14 +2324,14 @@ public:
                 s += s_filesep;
             }
             s += _strModelsDir;
-            fullfilename = RaveFindLocalFile(filename, s);
+            fullfilename = SceneLoadRecorder::FindLocalFile(filename, s);
             if( fullfilename.size() > 0 ) {
                 return fullfilename;
             }
         }
 
         // failed to find in _strModelsDir, so try the regular GetParseDirectory()
-        return RaveFindLocalFile(filename, GetParseDirectory());
+        return SceneLoadRecorder::FindLocalFile(filename, GetParseDirectory());
     }
 
     virtual ProcessElement startElement(const std::string& xmlname, const AttributesList &atts)
@@ -3237,10 +3533,11 @@ public:
                     }
                 }
 
-                string filedata = RaveFindLocalFile(itatt->second,GetParseDirectory());
+                string filedata = SceneLoadRecorder::FindLocalFile(itatt->second,GetParseDirectory());
                 if( filedata.size() == 0 ) {
                     continue;
                 }
+                SceneLoadRecorder::RecordFile(filedata);
                 _penv->Load(filedata);
             }
         }
@@ -3362,6 +3659,7 @@ public:
         if( xmlname == "environment" ) {
             // only move the camera if trans is specified
             if( !!_penv->GetViewer() ) {
+                SceneLoadRecorder::SetUncacheable("it sets the viewer camera");
                 if( bTransSpecified ) {
                     _penv->GetViewer()->SetCamera(_tCamera, _fCameraFocalDistance);
                 }
@@ -3407,6 +3705,7 @@ public:
             string pluginname;
             _ss >> pluginname;
             RaveLoadPlugin(pluginname);
+            SceneLoadRecorder::SetUncacheable("it loads plugins");
         }
 
         if( xmlname !=_processingtag ) {
@@ -1337,361 +1337,440 @@ static void ConvertDOFRotation_QuatFrom3D(std::vector<dReal>::iterator ittarget,
     *(ittarget+3) = quat[3];
 }
 
-void ConfigurationSpecification::ConvertGroupData(std::vector<dReal>::iterator ittargetdata, size_t targetstride, const ConfigurationSpecification::Group& gtarget, std::vector<dReal>::const_iterator itsourcedata, size_t sourcestride, const ConfigurationSpecification::Group& gsource, size_t numpoints, EnvironmentBaseConstPtr penv, bool filluninitialized)
+/// \brief finds the body whose state initializes uninitialized data, prefers the target body
+static KinBodyPtr FindDefaultBody(EnvironmentBaseConstPtr penv, const std::vector<std::string>& targettokens, const std::vector<std::string>& sourcetokens, std::string& bodyname)
 {
-    if( numpoints > 1 ) {
-        BOOST_ASSERT(targetstride != 0 && sourcestride != 0 );
+    KinBodyPtr pbody;
+    if( targettokens.size() > 1 ) {
+        bodyname = targettokens.at(1);
+        if( !!penv ) {
+            pbody = penv->GetKinBody(bodyname);
+        }
+    }
+    if( !pbody && sourcetokens.size() > 1 && !!penv ) {
+        pbody = penv->GetKinBody(sourcetokens.at(1));
+        if( !!pbody ) {
+            bodyname = sourcetokens.at(1);
+        }
+    }
+    return pbody;
+}
+
+ConfigurationSpecification::Converter::Converter(const ConfigurationSpecification& targetspec, const ConfigurationSpecification& sourcespec, EnvironmentBaseConstPtr penv, bool filluninitialized, bool fillmissinggroupsfrombodies) : _targetspec(targetspec), _sourcespec(sourcespec), _penv(penv), _bFillUninitialized(filluninitialized), _bFillMissingGroupsFromBodies(fillmissinggroupsfrombodies)
+{
+    _targetstride = targetspec.GetDOF();
+    _sourcestride = sourcespec.GetDOF();
+    _vdefaultvalues.resize(_targetstride,0);
+    FOREACHC(itgroup, targetspec._vgroups) {
+        std::vector<ConfigurationSpecification::Group>::const_iterator itcompatgroup = sourcespec.FindCompatibleGroup(*itgroup);
+        if( itcompatgroup != sourcespec._vgroups.end() ) {
+            _AddGroup(*itgroup, itgroup->offset, *itcompatgroup, itcompatgroup->offset);
+        }
+        else if( filluninitialized ) {
+            _AddUninitializedGroup(*itgroup, itgroup->offset);
+        }
+    }
+}
+
+ConfigurationSpecification::Converter::Converter(size_t targetstride, size_t sourcestride, EnvironmentBaseConstPtr penv, bool filluninitialized) : _penv(penv), _targetstride(targetstride), _sourcestride(sourcestride), _bFillUninitialized(filluninitialized), _bFillMissingGroupsFromBodies(true)
+{
+}
+
+void ConfigurationSpecification::Converter::_AddCopy(int targetindex, int sourceindex)
+{
+    if( _vcopyblocks.size() > 0 ) {
+        CopyBlock& block = _vcopyblocks.back();
+        if( block.targetoffset+block.length == targetindex && block.sourceoffset+block.length == sourceindex ) {
+            block.length += 1;
+            return;
+        }
+    }
+    _vcopyblocks.push_back(CopyBlock(targetindex,sourceindex));
+}
+
+void ConfigurationSpecification::Converter::_AddGroup(const ConfigurationSpecification::Group& gtarget, int targetoffset, const ConfigurationSpecification::Group& gsource, int sourceoffset)
+{
+    if( (int)_vdefaultvalues.size() < targetoffset+gtarget.dof ) {
+        _vdefaultvalues.resize(targetoffset+gtarget.dof,0);
     }
     if( gsource.name == gtarget.name ) {
         BOOST_ASSERT(gsource.dof==gtarget.dof);
-        for(size_t i = 0; i < numpoints; ++i) {
-            if( i != 0 ) {
-                itsourcedata += sourcestride;
-                ittargetdata += targetstride;
-            }
-            std::copy(itsourcedata,itsourcedata+gsource.dof,ittargetdata);
+        for(int i = 0; i < gsource.dof; ++i) {
+            _AddCopy(targetoffset+i,sourceoffset+i);
         }
+        return;
     }
-    else {
-        stringstream ss(gtarget.name);
-        std::vector<std::string> targettokens((istream_iterator<std::string>(ss)), istream_iterator<std::string>());
-        ss.clear();
-        ss.str(gsource.name);
-        std::vector<std::string> sourcetokens((istream_iterator<std::string>(ss)), istream_iterator<std::string>());
-
-        BOOST_ASSERT(targettokens.at(0) == sourcetokens.at(0));
-        vector<int> vtransferindices; vtransferindices.reserve(gtarget.dof);
-        std::vector<dReal> vdefaultvalues;
-        if( targettokens.at(0).size() >= 6 && targettokens.at(0).substr(0,6) == "joint_") {
-            std::vector<int> vsourceindices(gsource.dof), vtargetindices(gtarget.dof);
-            if( (int)sourcetokens.size() < gsource.dof+2 ) {
-                RAVELOG_DEBUG(str(boost::format("source tokens '%s' do not have %d dof indices, guessing....")%gsource.name%gsource.dof));
-                for(int i = 0; i < gsource.dof; ++i) {
-                    vsourceindices[i] = i;
-                }
+
+    stringstream ss(gtarget.name);
+    std::vector<std::string> targettokens((istream_iterator<std::string>(ss)), istream_iterator<std::string>());
+    ss.clear();
+    ss.str(gsource.name);
+    std::vector<std::string> sourcetokens((istream_iterator<std::string>(ss)), istream_iterator<std::string>());
+
+    BOOST_ASSERT(targettokens.at(0) == sourcetokens.at(0));
+    vector<int> vtransferindices; vtransferindices.reserve(gtarget.dof);
+    if( targettokens.at(0).size() >= 6 && targettokens.at(0).substr(0,6) == "joint_") {
+        std::vector<int> vsourceindices(gsource.dof), vtargetindices(gtarget.dof);
+        if( (int)sourcetokens.size() < gsource.dof+2 ) {
+            RAVELOG_DEBUG(str(boost::format("source tokens '%s' do not have %d dof indices, guessing....")%gsource.name%gsource.dof));
+            for(int i = 0; i < gsource.dof; ++i) {
+                vsourceindices[i] = i;
             }
-            else {
-                for(int i = 0; i < gsource.dof; ++i) {
-                    vsourceindices[i] = boost::lexical_cast<int>(sourcetokens.at(i+2));
-                }
+        }
+        else {
+            for(int i = 0; i < gsource.dof; ++i) {
+                vsourceindices[i] = boost::lexical_cast<int>(sourcetokens.at(i+2));
             }
-            if( (int)targettokens.size() < gtarget.dof+2 ) {
-                RAVELOG_WARN(str(boost::format("target tokens '%s' do not match dof '%d', guessing....")%gtarget.name%gtarget.dof));
-                for(int i = 0; i < gtarget.dof; ++i) {
-                    vtargetindices[i] = i;
-                }
+        }
+        if( (int)targettokens.size() < gtarget.dof+2 ) {
+            RAVELOG_WARN(str(boost::format("target tokens '%s' do not match dof '%d', guessing....")%gtarget.name%gtarget.dof));
+            for(int i = 0; i < gtarget.dof; ++i) {
+                vtargetindices[i] = i;
             }
-            else {
-                for(int i = 0; i < gtarget.dof; ++i) {
-                    vtargetindices[i] = boost::lexical_cast<int>(targettokens.at(i+2));
-                }
+        }
+        else {
+            for(int i = 0; i < gtarget.dof; ++i) {
+                vtargetindices[i] = boost::lexical_cast<int>(targettokens.at(i+2));
             }
+        }
 
-            bool bUninitializedData=false;
-            FOREACH(ittargetindex,vtargetindices) {
-                std::vector<int>::iterator it = find(vsourceindices.begin(),vsourceindices.end(),*ittargetindex);
-                if( it == vsourceindices.end() ) {
-                    bUninitializedData = true;
-                    vtransferindices.push_back(-1);
-                }
-                else {
-                    vtransferindices.push_back(static_cast<int>(it-vsourceindices.begin()));
-                }
+        bool bUninitializedData=false;
+        FOREACH(ittargetindex,vtargetindices) {
+            std::vector<int>::iterator it = find(vsourceindices.begin(),vsourceindices.end(),*ittargetindex);
+            if( it == vsourceindices.end() ) {
+                bUninitializedData = true;
+                vtransferindices.push_back(-1);
             }
+            else {
+                vtransferindices.push_back(static_cast<int>(it-vsourceindices.begin()));
+            }
+        }
 
-            if( bUninitializedData && filluninitialized ) {
-                KinBodyPtr pbody;
-                if( targettokens.size() > 1 ) {
-                    pbody = penv->GetKinBody(targettokens.at(1));
-                }
-                if( !pbody && sourcetokens.size() > 1 ) {
-                    pbody = penv->GetKinBody(sourcetokens.at(1));
-                }
-                if( !pbody ) {
-                    RAVELOG_WARN(str(boost::format("could not find body '%s' or '%s'")%gtarget.name%gsource.name));
-                    vdefaultvalues.resize(vtargetindices.size(),0);
-                }
-                else {
-                    std::vector<dReal> vbodyvalues;
-                    vdefaultvalues.resize(vtargetindices.size(),0);
-                    if( targettokens[0] == "joint_values" ) {
-                        pbody->GetDOFValues(vbodyvalues);
-                    }
-                    else if( targettokens[0] == "joint_velocities" ) {
-                        pbody->GetDOFVelocities(vbodyvalues);
-                    }
-                    if( vbodyvalues.size() > 0 ) {
-                        for(size_t i = 0; i < vdefaultvalues.size(); ++i) {
-                            vdefaultvalues[i] = vbodyvalues.at(vtargetindices[i]);
-                        }
-                    }
-                }
+        if( bUninitializedData && _bFillUninitialized ) {
+            BodyDefault bodydefault;
+            KinBodyPtr pbody = FindDefaultBody(_penv, targettokens, sourcetokens, bodydefault.bodyname);
+            if( !pbody ) {
+                RAVELOG_WARN(str(boost::format("could not find body '%s' or '%s'")%gtarget.name%gsource.name));
+            }
+            // other joint groups are initialized with 0
+            if( targettokens[0] == "joint_values" || targettokens[0] == "joint_velocities" ) {
+                bodydefault.pbody = pbody;
+                bodydefault.type = targettokens[0] == "joint_values" ? 0 : 1;
+                bodydefault.targetoffset = targetoffset;
+                bodydefault.vdofindices = vtargetindices;
+                _vbodydefaults.push_back(bodydefault);
             }
         }
-        else if( targettokens.at(0).size() >= 7 && targettokens.at(0).substr(0,7) == "affine_") {
-            int affinesource = 0, affinetarget = 0;
-            Vector sourceaxis(0,0,1), targetaxis(0,0,1);
-            if( sourcetokens.size() < 3 ) {
-                if( targettokens.size() < 3 && gsource.dof == gtarget.dof ) {
-                    for(size_t i = 0; i < targettokens.size(); ++i) {
-                        vtransferindices[i] = i;
-                    }
-                }
-                else {
-                    throw OPENRAVE_EXCEPTION_FORMAT("source affine information not present '%s'\n",gsource.name,ORE_InvalidArguments);
+    }
+    else if( targettokens.at(0).size() >= 7 && targettokens.at(0).substr(0,7) == "affine_") {
+        int affinesource = 0, affinetarget = 0;
+        Vector sourceaxis(0,0,1), targetaxis(0,0,1);
+        if( sourcetokens.size() < 3 ) {
+            if( targettokens.size() < 3 && gsource.dof == gtarget.dof ) {
+                for(int i = 0; i < gtarget.dof; ++i) {
+                    vtransferindices.push_back(i);
                 }
             }
             else {
-                affinesource = boost::lexical_cast<int>(sourcetokens.at(2));
-                BOOST_ASSERT(RaveGetAffineDOF(affinesource) == gsource.dof);
-                if( (affinesource & DOF_RotationAxis) && sourcetokens.size() >= 6 ) {
-                    sourceaxis.x = boost::lexical_cast<dReal>(sourcetokens.at(3));
-                    sourceaxis.y = boost::lexical_cast<dReal>(sourcetokens.at(4));
-                    sourceaxis.z = boost::lexical_cast<dReal>(sourcetokens.at(5));
-                }
+                throw OPENRAVE_EXCEPTION_FORMAT("source affine information not present '%s'\n",gsource.name,ORE_InvalidArguments);
             }
-            if( vtransferindices.size() == 0 ) {
-                if( targettokens.size() < 3 ) {
-                    throw OPENRAVE_EXCEPTION_FORMAT("target affine information not present '%s'\n",gtarget.name,ORE_InvalidArguments);
-                }
-                else {
-                    affinetarget = boost::lexical_cast<int>(targettokens.at(2));
-                    BOOST_ASSERT(RaveGetAffineDOF(affinetarget) == gtarget.dof);
-                    if( (affinetarget & DOF_RotationAxis) && targettokens.size() >= 6 ) {
-                        targetaxis.x = boost::lexical_cast<dReal>(targettokens.at(3));
-                        targetaxis.y = boost::lexical_cast<dReal>(targettokens.at(4));
-                        targetaxis.z = boost::lexical_cast<dReal>(targettokens.at(5));
-                    }
+        }
+        else {
+            affinesource = boost::lexical_cast<int>(sourcetokens.at(2));
+            BOOST_ASSERT(RaveGetAffineDOF(affinesource) == gsource.dof);
+            if( (affinesource & DOF_RotationAxis) && sourcetokens.size() >= 6 ) {
+                sourceaxis.x = boost::lexical_cast<dReal>(sourcetokens.at(3));
+                sourceaxis.y = boost::lexical_cast<dReal>(sourcetokens.at(4));
+                sourceaxis.z = boost::lexical_cast<dReal>(sourcetokens.at(5));
+            }
+        }
+        if( vtransferindices.size() == 0 ) {
+            if( targettokens.size() < 3 ) {
+                throw OPENRAVE_EXCEPTION_FORMAT("target affine information not present '%s'\n",gtarget.name,ORE_InvalidArguments);
+            }
+            else {
+                affinetarget = boost::lexical_cast<int>(targettokens.at(2));
+                BOOST_ASSERT(RaveGetAffineDOF(affinetarget) == gtarget.dof);
+                if( (affinetarget & DOF_RotationAxis) && targettokens.size() >= 6 ) {
+                    targetaxis.x = boost::lexical_cast<dReal>(targettokens.at(3));
+                    targetaxis.y = boost::lexical_cast<dReal>(targettokens.at(4));
+                    targetaxis.z = boost::lexical_cast<dReal>(targettokens.at(5));
                 }
+            }
 
-                int commondata = affinesource&affinetarget;
-                int uninitdata = affinetarget&(~commondata);
-                int sourcerotationstart = -1, targetrotationstart = -1, targetrotationend = -1;
-                boost::function< void(std::vector<dReal>::iterator, std::vector<dReal>::const_iterator) > rotconverterfn;
-                if( (uninitdata & DOF_RotationMask) && (affinetarget & DOF_RotationMask) && (affinesource & DOF_RotationMask) ) {
-                    // both hold rotations, but need to convert
-                    uninitdata &= ~DOF_RotationMask;
-                    sourcerotationstart = RaveGetIndexFromAffineDOF(affinesource,DOF_RotationMask);
-                    targetrotationstart = RaveGetIndexFromAffineDOF(affinetarget,DOF_RotationMask);
-                    targetrotationend = targetrotationstart+RaveGetAffineDOF(affinetarget&DOF_RotationMask);
-                    if( affinetarget & DOF_RotationAxis ) {
-                        if( affinesource & DOF_Rotation3D ) {
-                            rotconverterfn = boost::bind(ConvertDOFRotation_AxisFrom3D,_1,_2,targetaxis);
-                        }
-                        else if( affinesource & DOF_RotationQuat ) {
-                            rotconverterfn = boost::bind(ConvertDOFRotation_AxisFromQuat,_1,_2,targetaxis);
-                        }
-                    }
-                    else if( affinetarget & DOF_Rotation3D ) {
-                        if( affinesource & DOF_RotationAxis ) {
-                            rotconverterfn = boost::bind(ConvertDOFRotation_3DFromAxis,_1,_2,sourceaxis);
-                        }
-                        else if( affinesource & DOF_RotationQuat ) {
-                            rotconverterfn = ConvertDOFRotation_3DFromQuat;
-                        }
+            int commondata = affinesource&affinetarget;
+            int uninitdata = affinetarget&(~commondata);
+            int targetrotationstart = -1, targetrotationend = -1;
+            if( (uninitdata & DOF_RotationMask) && (affinetarget & DOF_RotationMask) && (affinesource & DOF_RotationMask) ) {
+                // both hold rotations, but need to convert
+                uninitdata &= ~DOF_RotationMask;
+                RotationConversion rotconversion;
+                targetrotationstart = RaveGetIndexFromAffineDOF(affinetarget,DOF_RotationMask);
+                targetrotationend = targetrotationstart+RaveGetAffineDOF(affinetarget&DOF_RotationMask);
+                rotconversion.targetoffset = targetoffset+targetrotationstart;
+                rotconversion.sourceoffset = sourceoffset+RaveGetIndexFromAffineDOF(affinesource,DOF_RotationMask);
+                if( affinetarget & DOF_RotationAxis ) {
+                    if( affinesource & DOF_Rotation3D ) {
+                        rotconversion.fn = boost::bind(ConvertDOFRotation_AxisFrom3D,_1,_2,targetaxis);
                     }
-                    else if( affinetarget & DOF_RotationQuat ) {
-                        if( affinesource & DOF_RotationAxis ) {
-                            rotconverterfn = boost::bind(ConvertDOFRotation_QuatFromAxis,_1,_2,sourceaxis);
-                        }
-                        else if( affinesource & DOF_Rotation3D ) {
-                            rotconverterfn = ConvertDOFRotation_QuatFrom3D;
-                        }
+                    else if( affinesource & DOF_RotationQuat ) {
+                        rotconversion.fn = boost::bind(ConvertDOFRotation_AxisFromQuat,_1,_2,targetaxis);
                     }
-                    BOOST_ASSERT(!!rotconverterfn);
                 }
-                if( uninitdata && filluninitialized ) {
-                    // initialize with the current body values
-                    KinBodyPtr pbody;
-                    if( targettokens.size() > 1 ) {
-                        pbody = penv->GetKinBody(targettokens.at(1));
-                    }
-                    if( !pbody && sourcetokens.size() > 1 ) {
-                        pbody = penv->GetKinBody(sourcetokens.at(1));
-                    }
-                    if( !pbody ) {
-                        RAVELOG_WARN(str(boost::format("could not find body '%s' or '%s'")%gtarget.name%gsource.name));
-                        vdefaultvalues.resize(gtarget.dof,0);
+                else if( affinetarget & DOF_Rotation3D ) {
+                    if( affinesource & DOF_RotationAxis ) {
+                        rotconversion.fn = boost::bind(ConvertDOFRotation_3DFromAxis,_1,_2,sourceaxis);
                     }
-                    else {
-                        vdefaultvalues.resize(gtarget.dof);
-                        RaveGetAffineDOFValuesFromTransform(vdefaultvalues.begin(),pbody->GetTransform(),affinetarget);
+                    else if( affinesource & DOF_RotationQuat ) {
+                        rotconversion.fn = ConvertDOFRotation_3DFromQuat;
                     }
                 }
-
-                for(int index = 0; index < gtarget.dof; ++index) {
-                    DOFAffine dof = RaveGetAffineDOFFromIndex(affinetarget,index);
-                    int startindex = RaveGetIndexFromAffineDOF(affinetarget,dof);
-                    if( affinesource & dof ) {
-                        int sourceindex = RaveGetIndexFromAffineDOF(affinesource,dof);
-                        vtransferindices.push_back(sourceindex + (index-startindex));
+                else if( affinetarget & DOF_RotationQuat ) {
+                    if( affinesource & DOF_RotationAxis ) {
+                        rotconversion.fn = boost::bind(ConvertDOFRotation_QuatFromAxis,_1,_2,sourceaxis);
                     }
-                    else {
-                        vtransferindices.push_back(-1);
+                    else if( affinesource & DOF_Rotation3D ) {
+                        rotconversion.fn = ConvertDOFRotation_QuatFrom3D;
                     }
                 }
-
-                for(size_t i = 0; i < numpoints; ++i, itsourcedata += sourcestride, ittargetdata += targetstride) {
-                    for(int j = 0; j < (int)vtransferindices.size(); ++j) {
-                        if( vtransferindices[j] >= 0 ) {
-                            *(ittargetdata+j) = *(itsourcedata+vtransferindices[j]);
-                        }
-                        else {
-                            if( j >= targetrotationstart && j < targetrotationend ) {
-                                if( j == targetrotationstart ) {
-                                    // only convert when at first index
-                                    rotconverterfn(ittargetdata+targetrotationstart,itsourcedata+sourcerotationstart);
-                                }
-                            }
-                            else if( filluninitialized ) {
-                                *(ittargetdata+j) = vdefaultvalues.at(j);
-                            }
-                        }
+                BOOST_ASSERT(!!rotconversion.fn);
+                _vrotationconversions.push_back(rotconversion);
+            }
+            if( uninitdata && _bFillUninitialized ) {
+                // initialize with the current body values
+                BodyDefault bodydefault;
+                KinBodyPtr pbody = FindDefaultBody(_penv, targettokens, sourcetokens, bodydefault.bodyname);
+                if( !pbody ) {
+                    RAVELOG_WARN(str(boost::format("could not find body '%s' or '%s'")%gtarget.name%gsource.name));
+                }
+                bodydefault.pbody = pbody;
+                bodydefault.type = 2;
+                bodydefault.targetoffset = targetoffset;
+                bodydefault.affinedofs = affinetarget;
+                _vbodydefaults.push_back(bodydefault);
+            }
+
+            for(int index = 0; index < gtarget.dof; ++index) {
+                DOFAffine dof = RaveGetAffineDOFFromIndex(affinetarget,index);
+                int startindex = RaveGetIndexFromAffineDOF(affinetarget,dof);
+                if( affinesource & dof ) {
+                    int sourceindex = RaveGetIndexFromAffineDOF(affinesource,dof);
+                    _AddCopy(targetoffset+index,sourceoffset+sourceindex+(index-startindex));
+                }
+                else if( index < targetrotationstart || index >= targetrotationend ) {
+                    if( _bFillUninitialized ) {
+                        _vfillindices.push_back(targetoffset+index);
                     }
                 }
-                return;
             }
+            return;
+        }
+    }
+    else if( targettokens.at(0).size() >= 8 && targettokens.at(0).substr(0,8) == "ikparam_") {
+        IkParameterizationType iktypesource, iktypetarget;
+        if( sourcetokens.size() >= 2 ) {
+            iktypesource = static_cast<IkParameterizationType>(boost::lexical_cast<int>(sourcetokens[1]));
+        }
+        else {
+            throw OPENRAVE_EXCEPTION_FORMAT("ikparam type not present '%s'\n",gsource.name,ORE_InvalidArguments);
+        }
+        if( targettokens.size() >= 2 ) {
+            iktypetarget = static_cast<IkParameterizationType>(boost::lexical_cast<int>(targettokens[1]));
+        }
+        else {
+            throw OPENRAVE_EXCEPTION_FORMAT("ikparam type not present '%s'\n",gtarget.name,ORE_InvalidArguments);
         }
-        else if( targettokens.at(0).size() >= 8 && targettokens.at(0).substr(0,8) == "ikparam_") {
-            IkParameterizationType iktypesource, iktypetarget;
-            if( sourcetokens.size() >= 2 ) {
-                iktypesource = static_cast<IkParameterizationType>(boost::lexical_cast<int>(sourcetokens[1]));
-            }
-            else {
-                throw OPENRAVE_EXCEPTION_FORMAT("ikparam type not present '%s'\n",gsource.name,ORE_InvalidArguments);
-            }
-            if( targettokens.size() >= 2 ) {
-                iktypetarget = static_cast<IkParameterizationType>(boost::lexical_cast<int>(targettokens[1]));
-            }
-            else {
-                throw OPENRAVE_EXCEPTION_FORMAT("ikparam type not present '%s'\n",gtarget.name,ORE_InvalidArguments);
-            }
 
-            if( iktypetarget == iktypesource ) {
-                vtransferindices.resize(IkParameterization::GetDOF(iktypetarget));
-                for(size_t i = 0; i < vtransferindices.size(); ++i) {
-                    vtransferindices[i] = i;
-                }
-            }
-            else {
-                RAVELOG_WARN("ikparam types do not match");
+        if( iktypetarget == iktypesource ) {
+            vtransferindices.resize(IkParameterization::GetDOF(iktypetarget));
+            for(size_t i = 0; i < vtransferindices.size(); ++i) {
+                vtransferindices[i] = i;
             }
         }
-        // need a space since grabbody is also a group
-        else if( targettokens.at(0) == std::string("grab") ) {
-            std::vector<int> vsourceindices(gsource.dof), vtargetindices(gtarget.dof);
-            if( (int)sourcetokens.size() < gsource.dof+2 ) {
-                throw OPENRAVE_EXCEPTION_FORMAT("source tokens '%s' do not have %d dof indices, guessing....", gsource.name%gsource.dof, ORE_InvalidArguments);
+        else {
+            RAVELOG_WARN("ikparam types do not match");
+        }
+    }
+    // need a space since grabbody is also a group
+    else if( targettokens.at(0) == std::string("grab") ) {
+        std::vector<int> vsourceindices(gsource.dof), vtargetindices(gtarget.dof);
+        if( (int)sourcetokens.size() < gsource.dof+2 ) {
+            throw OPENRAVE_EXCEPTION_FORMAT("source tokens '%s' do not have %d dof indices, guessing....", gsource.name%gsource.dof, ORE_InvalidArguments);
+        }
+        else {
+            for(int i = 0; i < gsource.dof; ++i) {
+                vsourceindices[i] = boost::lexical_cast<int>(sourcetokens.at(i+2));
             }
-            else {
-                for(int i = 0; i < gsource.dof; ++i) {
-                    vsourceindices[i] = boost::lexical_cast<int>(sourcetokens.at(i+2));
-                }
+        }
+        if( (int)targettokens.size() < gtarget.dof+2 ) {
+            throw OPENRAVE_EXCEPTION_FORMAT("target tokens '%s' do not match dof '%d', guessing....", gtarget.name%gtarget.dof, ORE_InvalidArguments);
+        }
+        else {
+            for(int i = 0; i < gtarget.dof; ++i) {
+                vtargetindices[i] = boost::lexical_cast<int>(targettokens.at(i+2));
             }
-            if( (int)targettokens.size() < gtarget.dof+2 ) {
-                throw OPENRAVE_EXCEPTION_FORMAT("target tokens '%s' do not match dof '%d', guessing....", gtarget.name%gtarget.dof, ORE_InvalidArguments);
+        }
+
+        // uninitialized grab values are set to 0
+        FOREACH(ittargetindex,vtargetindices) {
+            std::vector<int>::iterator it = find(vsourceindices.begin(),vsourceindices.end(),*ittargetindex);
+            if( it == vsourceindices.end() ) {
+                vtransferindices.push_back(-1);
             }
             else {
-                for(int i = 0; i < gtarget.dof; ++i) {
-                    vtargetindices[i] = boost::lexical_cast<int>(targettokens.at(i+2));
-                }
+                vtransferindices.push_back(static_cast<int>(it-vsourceindices.begin()));
             }
+        }
+    }
+    else if( targettokens.at(0) == std::string("grabbody") ) {
+        // TODO
+    }
+    else {
+        throw OPENRAVE_EXCEPTION_FORMAT("unsupported token conversion: %s",gtarget.name,ORE_InvalidArguments);
+    }
 
-            bool bUninitializedData=false;
-            FOREACH(ittargetindex,vtargetindices) {
-                std::vector<int>::iterator it = find(vsourceindices.begin(),vsourceindices.end(),*ittargetindex);
-                if( it == vsourceindices.end() ) {
-                    bUninitializedData = true;
-                    vtransferindices.push_back(-1);
-                }
-                else {
-                    vtransferindices.push_back(static_cast<int>(it-vsourceindices.begin()));
-                }
-            }
+    for(size_t j = 0; j < vtransferindices.size(); ++j) {
+        if( vtransferindices[j] >= 0 ) {
+            _AddCopy(targetoffset+j,sourceoffset+vtransferindices[j]);
+        }
+        else if( _bFillUninitialized ) {
+            _vfillindices.push_back(targetoffset+j);
+        }
+    }
+}
 
-            if( bUninitializedData && filluninitialized ) {
-                vdefaultvalues.resize(vtargetindices.size(),0);
+void ConfigurationSpecification::Converter::_AddUninitializedGroup(const ConfigurationSpecification::Group& gtarget, int targetoffset)
+{
+    if( (int)_vdefaultvalues.size() < targetoffset+gtarget.dof ) {
+        _vdefaultvalues.resize(targetoffset+gtarget.dof,0);
+    }
+    for(int j = 0; j < gtarget.dof; ++j) {
+        _vfillindices.push_back(targetoffset+j);
+    }
+    const string& name = gtarget.name;
+    if( !_bFillMissingGroupsFromBodies ) {
+        // joint values stay zero
+        if( name.size() >= 16 && name.substr(0,16) == "affine_transform" ) {
+            stringstream ss(name.substr(16));
+            string bodyname;
+            int affinedofs=0;
+            ss >> bodyname >> affinedofs;
+            if( !!ss ) {
+                BOOST_ASSERT(gtarget.dof == RaveGetAffineDOF(affinedofs));
+                RaveGetAffineDOFValuesFromTransform(_vdefaultvalues.begin()+targetoffset,Transform(),affinedofs);
             }
         }
-        else if( targettokens.at(0) == std::string("grabbody") ) {
-            // TODO
-        }
-        else {
-            throw OPENRAVE_EXCEPTION_FORMAT("unsupported token conversion: %s",gtarget.name,ORE_InvalidArguments);
+    }
+    else if( name.size() >= 12 && name.substr(0,12) == "joint_values" ) {
+        BodyDefault bodydefault;
+        stringstream ss(name.substr(12));
+        ss >> bodydefault.bodyname;
+        if( !!ss ) {
+            bodydefault.vdofindices = std::vector<int>((istream_iterator<int>(ss)), istream_iterator<int>());
+            OPENRAVE_ASSERT_OP((int)bodydefault.vdofindices.size(),<=,gtarget.dof);
+            if( !!_penv ) {
+                bodydefault.pbody = _penv->GetKinBody(bodydefault.bodyname);
+            }
+            bodydefault.type = 0;
+            bodydefault.targetoffset = targetoffset;
+            _vbodydefaults.push_back(bodydefault);
         }
-
-        for(size_t i = 0; i < numpoints; ++i, itsourcedata += sourcestride, ittargetdata += targetstride) {
-            for(size_t j = 0; j < vtransferindices.size(); ++j) {
-                if( vtransferindices[j] >= 0 ) {
-                    *(ittargetdata+j) = *(itsourcedata+vtransferindices[j]);
-                }
-                else if( filluninitialized ) {
-                    *(ittargetdata+j) = vdefaultvalues.at(j);
-                }
+    }
+    else if( name.size() >= 16 && name.substr(0,16) == "affine_transform" ) {
+        BodyDefault bodydefault;
+        stringstream ss(name.substr(16));
+        ss >> bodydefault.bodyname >> bodydefault.affinedofs;
+        if( !!ss ) {
+            BOOST_ASSERT(gtarget.dof == RaveGetAffineDOF(bodydefault.affinedofs));
+            if( !!_penv ) {
+                bodydefault.pbody = _penv->GetKinBody(bodydefault.bodyname);
             }
+            bodydefault.type = 2;
+            bodydefault.targetoffset = targetoffset;
+            _vbodydefaults.push_back(bodydefault);
         }
     }
+    else if( name != "deltatime" ) {
+        // messages are too frequent
+        //RAVELOG_VERBOSE(str(boost::format("cannot initialize unknown group '%s'")%name));
+    }
 }
 
-void ConfigurationSpecification::ConvertData(std::vector<dReal>::iterator ittargetdata, const ConfigurationSpecification &targetspec, std::vector<dReal>::const_iterator itsourcedata, const ConfigurationSpecification &sourcespec, size_t numpoints, EnvironmentBaseConstPtr penv, bool filluninitialized)
+void ConfigurationSpecification::Converter::_UpdateDefaultValues()
 {
-    for(size_t igroup = 0; igroup < targetspec._vgroups.size(); ++igroup) {
-        std::vector<ConfigurationSpecification::Group>::const_iterator itcompatgroup = sourcespec.FindCompatibleGroup(targetspec._vgroups[igroup]);
-        if( itcompatgroup != sourcespec._vgroups.end() ) {
-            ConfigurationSpecification::ConvertGroupData(ittargetdata+targetspec._vgroups[igroup].offset, targetspec.GetDOF(), targetspec._vgroups[igroup], itsourcedata+itcompatgroup->offset, sourcespec.GetDOF(), *itcompatgroup,numpoints,penv,filluninitialized);
+    std::vector<dReal> vbodyvalues;
+    FOREACH(itdefault, _vbodydefaults) {
+        KinBodyPtr pbody = itdefault->pbody.lock();
+        if( !pbody || pbody->GetEnvironmentId() == 0 ) {
+            // body was removed from the environment, so look it up again
+            pbody.reset();
+            if( !!_penv ) {
+                pbody = _penv->GetKinBody(itdefault->bodyname);
+            }
+            itdefault->pbody = pbody;
+        }
+        if( itdefault->type == 2 ) {
+            Transform tdefault;
+            if( !!pbody ) {
+                tdefault = pbody->GetTransform();
+            }
+            RaveGetAffineDOFValuesFromTransform(_vdefaultvalues.begin()+itdefault->targetoffset,tdefault,itdefault->affinedofs);
         }
-        else if( filluninitialized ) {
-            vector<dReal> vdefaultvalues(targetspec._vgroups[igroup].dof,0);
-            const string& name = targetspec._vgroups[igroup].name;
-            if( name.size() >= 12 && name.substr(0,12) == "joint_values" ) {
-                string bodyname;
-                stringstream ss(name.substr(12));
-                ss >> bodyname;
-                if( !!ss ) {
-                    if( !!penv ) {
-                        KinBodyPtr body = penv->GetKinBody(bodyname);
-                        if( !!body ) {
-                            vector<dReal> values;
-                            body->GetDOFValues(values);
-                            std::vector<int> indices((istream_iterator<int>(ss)), istream_iterator<int>());
-                            for(size_t i = 0; i < indices.size(); ++i) {
-                                vdefaultvalues.at(i) = values.at(indices[i]);
-                            }
-                        }
-                    }
-                }
+        else {
+            std::vector<dReal>::iterator itvalues = _vdefaultvalues.begin()+itdefault->targetoffset;
+            if( !pbody ) {
+                std::fill(itvalues, itvalues+itdefault->vdofindices.size(), dReal(0));
+                continue;
             }
-            else if( name.size() >= 16 && name.substr(0,16) == "affine_transform" ) {
-                string bodyname;
-                int affinedofs;
-                stringstream ss(name.substr(16));
-                ss >> bodyname >> affinedofs;
-                if( !!ss ) {
-                    Transform tdefault;
-                    if( !!penv ) {
-                        KinBodyPtr body = penv->GetKinBody(bodyname);
-                        if( !!body ) {
-                            tdefault = body->GetTransform();
-                        }
-                    }
-                    BOOST_ASSERT((int)vdefaultvalues.size() == RaveGetAffineDOF(affinedofs));
-                    RaveGetAffineDOFValuesFromTransform(vdefaultvalues.begin(),tdefault,affinedofs);
-                }
+            if( itdefault->type == 0 ) {
+                pbody->GetDOFValues(vbodyvalues);
             }
-            else if( name != "deltatime" ) {
-                // messages are too frequent
-                //RAVELOG_VERBOSE(str(boost::format("cannot initialize unknown group '%s'")%name));
+            else {
+                pbody->GetDOFVelocities(vbodyvalues);
             }
-            int offset = targetspec._vgroups[igroup].offset;
-            for(size_t i = 0; i < numpoints; ++i, offset += targetspec.GetDOF()) {
-                for(size_t j = 0; j < vdefaultvalues.size(); ++j) {
-                    *(ittargetdata+offset+j) = vdefaultvalues[j];
-                }
+            for(size_t i = 0; i < itdefault->vdofindices.size(); ++i) {
+                *(itvalues+i) = vbodyvalues.at(itdefault->vdofindices[i]);
             }
         }
     }
 }
 
+void ConfigurationSpecification::Converter::Convert(std::vector<dReal>::iterator ittargetdata, std::vector<dReal>::const_iterator itsourcedata, size_t numpoints)
+{
+    if( _vfillindices.size() > 0 && _vbodydefaults.size() > 0 ) {
+        _UpdateDefaultValues();
+    }
+    for(size_t i = 0; i < numpoints; ++i) {
+        std::vector<dReal>::iterator ittarget = ittargetdata+i*_targetstride;
+        std::vector<dReal>::const_iterator itsource = itsourcedata+i*_sourcestride;
+        FOREACHC(itblock, _vcopyblocks) {
+            std::copy(itsource+itblock->sourceoffset, itsource+itblock->sourceoffset+itblock->length, ittarget+itblock->targetoffset);
+        }
+        FOREACHC(itfill, _vfillindices) {
+            *(ittarget+*itfill) = _vdefaultvalues[*itfill];
+        }
+        FOREACHC(itrot, _vrotationconversions) {
+            itrot->fn(ittarget+itrot->targetoffset, itsource+itrot->sourceoffset);
+        }
+    }
+}
+
+void ConfigurationSpecification::ConvertGroupData(std::vector<dReal>::iterator ittargetdata, size_t targetstride, const ConfigurationSpecification::Group& gtarget, std::vector<dReal>::const_iterator itsourcedata, size_t sourcestride, const ConfigurationSpecification::Group& gsource, size_t numpoints, EnvironmentBaseConstPtr penv, bool filluninitialized)
+{
+    if( numpoints > 1 ) {
+        BOOST_ASSERT(targetstride != 0 && sourcestride != 0 );
+    }
+    ConfigurationSpecification::Converter converter(targetstride, sourcestride, penv, filluninitialized);
+    converter._AddGroup(gtarget, 0, gsource, 0);
+    converter.Convert(ittargetdata, itsourcedata, numpoints);
+}
+
+void ConfigurationSpecification::ConvertData(std::vector<dReal>::iterator ittargetdata, const ConfigurationSpecification &targetspec, std::vector<dReal>::const_iterator itsourcedata, const ConfigurationSpecification &sourcespec, size_t numpoints, EnvironmentBaseConstPtr penv, bool filluninitialized)
+{
+    ConfigurationSpecification::Converter converter(targetspec, sourcespec, penv, filluninitialized);
+    converter.Convert(ittargetdata, itsourcedata, numpoints);
+}
+
 std::string ConfigurationSpecification::GetInterpolationDerivative(const std::string& interpolation, int deriv)
 {
     const static boost::array<std::string,7> s_InterpolationOrder = {{"next","linear","quadratic","cubic","quartic","quintic","sextic"}};
@@ -178,6 +178,17 @@ UserDataPtr IkSolverBase::RegisterCustomFilter(int32_t priority, const IkSolverB
     return pdata;
 }
 
+void IkSolverBase::GetCustomFilters(std::vector< std::pair<int32_t, IkFilterCallbackFn> >& vfilters) const
+{
+    vfilters.resize(0);
+    FOREACHC(it, __listRegisteredFilters) {
+        CustomIkSolverFilterDataPtr pitdata = boost::dynamic_pointer_cast<CustomIkSolverFilterData>(it->lock());
+        if( !!pitdata ) {
+            vfilters.push_back(std::make_pair(pitdata->_priority, pitdata->_filterfn));
+        }
+    }
+}
+
 UserDataPtr IkSolverBase::RegisterFinishCallback(const IkFinishCallbackFn& finishfn)
 {
     IkSolverFinishCallbackDataPtr pdata(new IkSolverFinishCallbackData(finishfn,shared_iksolver()));
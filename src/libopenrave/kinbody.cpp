@@ -32,13 +32,40 @@ public:
         KinBodyConstPtr pbody = _pweakbody.lock();
         if( !!pbody ) {
             boost::unique_lock< boost::shared_mutex > lock(pbody->GetInterfaceMutex());
-            FOREACH(itinfo, _iterators) {
-                pbody->_vlistRegisteredCallbacks.at(itinfo->first).erase(itinfo->second);
+            for(size_t index = 0; index < pbody->_vRegisteredCallbacks.size(); ++index) {
+                if( _properties & (1U<<index) ) {
+                    // this callback is already expired, so rebuilding the array removes it
+                    _UpdateCallbacks(pbody, index, UserDataPtr());
+                }
+            }
+        }
+    }
+
+    /// \brief swaps the callback array of a property with a new one without the expired callbacks
+    ///
+    /// Has to be called with the interface mutex of the body locked.
+    /// \param pnewdata if not empty, is added at the end of the new array
+    static void _UpdateCallbacks(KinBodyConstPtr pbody, size_t index, UserDataPtr pnewdata)
+    {
+        boost::shared_ptr<const std::vector<UserDataWeakPtr> > pcallbacks = pbody->_vRegisteredCallbacks[index];
+        boost::shared_ptr<std::vector<UserDataWeakPtr> > pnewcallbacks(new std::vector<UserDataWeakPtr>());
+        if( !!pcallbacks ) {
+            pnewcallbacks->reserve(pcallbacks->size()+1);
+            FOREACHC(it, *pcallbacks) {
+                if( !it->expired() ) {
+                    pnewcallbacks->push_back(*it);
+                }
             }
         }
+        if( !!pnewdata ) {
+            pnewcallbacks->push_back(pnewdata);
+        }
+        if( pnewcallbacks->size() == 0 ) {
+            pnewcallbacks.reset();
+        }
+        boost::atomic_store(&pbody->_vRegisteredCallbacks[index], boost::shared_ptr<const std::vector<UserDataWeakPtr> >(pnewcallbacks));
     }
 
-    list< std::pair<uint32_t, list<UserDataWeakPtr>::iterator> > _iterators;
     int _properties;
     boost::function<void()> _callback;
 protected:
@@ -176,10 +203,31 @@ void KinBody::KinBodyStateSaver::_RestoreKinBody(boost::shared_ptr<KinBody> pbod
     }
 }
 
+KinBody::ChangeCallbackSuspender::ChangeCallbackSuspender(KinBodyPtr pbody) : _pbody(pbody)
+{
+    _pbody->_nCallbacksSuspended++;
+}
+
+KinBody::ChangeCallbackSuspender::~ChangeCallbackSuspender()
+{
+    _pbody->_nCallbacksSuspended--;
+    if( _pbody->_nCallbacksSuspended == 0 && _pbody->_nHierarchyComputed != 1 ) {
+        uint32_t parameters = _pbody->_nParametersChanged;
+        _pbody->_nParametersChanged = 0;
+        try {
+            _pbody->_CallChangeCallbacks(parameters);
+        }
+        catch(const std::exception& ex) {
+            RAVELOG_ERROR_FORMAT("body %s change callbacks failed: %s", _pbody->GetName()%ex.what());
+        }
+    }
+}
+
 KinBody::KinBody(InterfaceType type, EnvironmentBasePtr penv) : InterfaceBase(type, penv)
 {
     _nHierarchyComputed = 0;
     _nParametersChanged = 0;
+    _nCallbacksSuspended = 0;
     _bMakeJoinedLinksAdjacent = true;
     _environmentid = 0;
     _nNonAdjacentLinkCache = 0x80000000;
@@ -223,6 +271,7 @@ void KinBody::Destroy()
     _vClosedLoopIndices.clear();
     _vForcedAdjacentLinks.clear();
     _nHierarchyComputed = 0;
+    _ResetKinematicsCaches();
     _nParametersChanged = 0;
     _pManageData.reset();
 
@@ -381,7 +430,11 @@ bool KinBody::InitFromGeometries(const std::vector<KinBody::GeometryInfoConstPtr
         Link::GeometryPtr geom(new Link::Geometry(plink,**itinfo));
         geom->_info.InitCollisionMesh();
         plink->_vGeometries.push_back(geom);
-        plink->_collision.Append(geom->GetCollisionMesh(),geom->GetTransform());
+    }
+    if( !plink->_ShareGeometryCollisionMesh() ) {
+        FOREACHC(itgeom,plink->_vGeometries) {
+            plink->_collision.Append((*itgeom)->GetCollisionMesh(),(*itgeom)->GetTransform());
+        }
     }
     _veclinks.push_back(plink);
     __struri = uri;
@@ -393,22 +446,23 @@ void KinBody::SetLinkGeometriesFromGroup(const std::string& geomname)
     // need to call _PostprocessChangedParameters at the very end, even if exception occurs
     CallFunctionAtDestructor callfn(boost::bind(&KinBody::_PostprocessChangedParameters, this, Prop_LinkGeometry));
     FOREACHC(itlink, _veclinks) {
-        std::vector<KinBody::GeometryInfoPtr>* pvinfos = NULL;
+        const std::vector<KinBody::GeometryInfoPtr>* pvinfos = NULL;
+        boost::shared_ptr<std::vector<KinBody::GeometryInfoPtr> const> pspheregeometryinfos;
         if( geomname.size() == 0 ) {
             pvinfos = &(*itlink)->_info._vgeometryinfos;
         }
         else {
-            std::map< std::string, std::vector<KinBody::GeometryInfoPtr> >::iterator it = (*itlink)->_info._mapExtraGeometries.find(geomname);
-            if( it == (*itlink)->_info._mapExtraGeometries.end() ) {
+            pvinfos = (*itlink)->_FindGeometryGroup(geomname, pspheregeometryinfos);
+            if( !pvinfos ) {
                 throw OPENRAVE_EXCEPTION_FORMAT("could not find geometries %s for link %s",geomname%GetName(),ORE_InvalidArguments);
             }
-            pvinfos = &it->second;
         }
         (*itlink)->_vGeometries.resize(pvinfos->size());
         for(size_t i = 0; i < pvinfos->size(); ++i) {
             (*itlink)->_vGeometries[i].reset(new Link::Geometry(*itlink,*pvinfos->at(i)));
         }
         (*itlink)->_Update(false);
+        (*itlink)->_RestoreSphereGeometryGroup(pspheregeometryinfos);
     }
     // have to reset the adjacency cache
     _ResetInternalCollisionCache();
@@ -435,7 +489,11 @@ bool KinBody::Init(const std::vector<KinBody::LinkInfoConstPtr>& linkinfos, cons
             Link::GeometryPtr geom(new Link::Geometry(plink,**itgeominfo));
             geom->_info.InitCollisionMesh();
             plink->_vGeometries.push_back(geom);
-            plink->_collision.Append(geom->GetCollisionMesh(),geom->GetTransform());
+        }
+        if( !plink->_ShareGeometryCollisionMesh() ) {
+            FOREACHC(itgeom,plink->_vGeometries) {
+                plink->_collision.Append((*itgeom)->GetCollisionMesh(),(*itgeom)->GetTransform());
+            }
         }
         FOREACHC(itadjacentname, info._vForcedAdjacentLinks) {
             _vForcedAdjacentLinks.push_back(std::make_pair(info._name, *itadjacentname));
@@ -1860,92 +1918,7 @@ void KinBody::ComputeJacobianTranslation(int linkindex, const Vector& position,
         return;
     }
     std::fill(vjacobian.begin(),vjacobian.end(),0);
-
-    Vector v;
-    int offset = linkindex*_veclinks.size();
-    int curlink = 0;
-    std::vector<std::pair<int,dReal> > vpartials;
-    std::vector<int> vpartialindices;
-    std::map< std::pair<Mimic::DOFFormat, int>, dReal > mapcachedpartials;
-    while(_vAllPairsShortestPaths[offset+curlink].first>=0) {
-        int jointindex = _vAllPairsShortestPaths[offset+curlink].second;
-        if( jointindex < (int)_vecjoints.size() ) {
-            // active joint
-            JointPtr pjoint = _vecjoints.at(jointindex);
-            int dofindex = pjoint->GetDOFIndex();
-            int8_t affect = DoesAffect(pjoint->GetJointIndex(), linkindex);
-            for(int dof = 0; dof < pjoint->GetDOF(); ++dof) {
-                if( affect != 0 ) {
-                    if( pjoint->IsRevolute(dof) ) {
-                        v = pjoint->GetAxis(dof).cross(position-pjoint->GetAnchor());
-                    }
-                    else if( pjoint->IsPrismatic(dof) ) {
-                        v = pjoint->GetAxis(dof);
-                    }
-                    else {
-                        RAVELOG_WARN("ComputeJacobianTranslation joint %d not supported\n", pjoint->GetType());
-                        continue;
-                    }
-                    if( dofindices.size() > 0 ) {
-                        std::vector<int>::const_iterator itindex = find(dofindices.begin(),dofindices.end(),dofindex+dof);
-                        if( itindex != dofindices.end() ) {
-                            size_t index = itindex-dofindices.begin();
-                            vjacobian[index] += v.x; vjacobian[index+dofstride] += v.y; vjacobian[index+2*dofstride] += v.z;
-                        }
-                    }
-                    else {
-                        vjacobian[dofindex+dof] += v.x; vjacobian[dofstride+dofindex+dof] += v.y; vjacobian[2*dofstride+dofindex+dof] += v.z;
-                    }
-                }
-            }
-        }
-        else {
-            // add in the contributions from the passive joint
-            JointPtr pjoint = _vPassiveJoints.at(jointindex-_vecjoints.size());
-            for(int idof = 0; idof < pjoint->GetDOF(); ++idof) {
-                if( pjoint->IsMimic(idof) ) {
-                    bool bhas = dofindices.size() == 0;
-                    if( !bhas ) {
-                        FOREACHC(itmimicdof, pjoint->_vmimic[idof]->_vmimicdofs) {
-                            if( find(dofindices.begin(),dofindices.end(),itmimicdof->dofindex) != dofindices.end() ) {
-                                bhas = true;
-                                break;
-                            }
-                        }
-                    }
-                    if( bhas ) {
-                        Vector vaxis;
-                        if( pjoint->IsRevolute(idof) ) {
-                            vaxis = pjoint->GetAxis(idof).cross(position-pjoint->GetAnchor());
-                        }
-                        else if( pjoint->IsPrismatic(idof) ) {
-                            vaxis = pjoint->GetAxis(idof);
-                        }
-                        else {
-                            RAVELOG_WARN("ComputeJacobianTranslation joint %d not supported\n", pjoint->GetType());
-                            continue;
-                        }
-                        pjoint->_ComputePartialVelocities(vpartials,idof,mapcachedpartials);
-                        FOREACH(itpartial,vpartials) {
-                            Vector v = vaxis * itpartial->second;
-                            int index = itpartial->first;
-                            if( dofindices.size() > 0 ) {
-                                std::vector<int>::const_iterator itindex = find(dofindices.begin(),dofindices.end(),itpartial->first);
-                                if( itindex == dofindices.end() ) {
-                                    continue;
-                                }
-                                index = itindex-dofindices.begin();
-                            }
-                            vjacobian[index] += v.x;
-                            vjacobian[dofstride+index] += v.y;
-                            vjacobian[2*dofstride+index] += v.z;
-                        }
-                    }
-                }
-            }
-        }
-        curlink = _vAllPairsShortestPaths[offset+curlink].first;
-    }
+    _ComputeJacobianFromChain(*_GetJacobianChain(linkindex,dofindices), position, &vjacobian[0], NULL, dofstride);
 }
 
 void KinBody::CalculateJacobian(int linkindex, const Vector& trans, boost::multi_array<dReal,2>& mjacobian) const
@@ -2072,41 +2045,93 @@ void KinBody::ComputeJacobianAxisAngle(int linkindex, std::vector<dReal>& vjacob
         return;
     }
     std::fill(vjacobian.begin(),vjacobian.end(),0);
+    _ComputeJacobianFromChain(*_GetJacobianChain(linkindex,dofindices), Vector(), NULL, &vjacobian[0], dofstride);
+}
+
+void KinBody::CalculateAngularVelocityJacobian(int linkindex, boost::multi_array<dReal,2>& mjacobian) const
+{
+    mjacobian.resize(boost::extents[3][GetDOF()]);
+    if( GetDOF() == 0 ) {
+        return;
+    }
+    std::vector<dReal> vjacobian;
+    ComputeJacobianAxisAngle(linkindex,vjacobian);
+    OPENRAVE_ASSERT_OP((int)vjacobian.size(),==,3*GetDOF());
+    vector<dReal>::const_iterator itsrc = vjacobian.begin();
+    FOREACH(itdst,mjacobian) {
+        std::copy(itsrc,itsrc+GetDOF(),itdst->begin());
+        itsrc += GetDOF();
+    }
+}
+
+void KinBody::ComputeJacobianTranslationAxisAngle(int linkindex, const Vector& position, std::vector<dReal>& vjacobian, const std::vector<int>& dofindices) const
+{
+    CHECK_INTERNAL_COMPUTATION;
+    OPENRAVE_ASSERT_FORMAT(linkindex >= 0 && linkindex < (int)_veclinks.size(), "body %s bad link index %d (num links %d)", GetName()%linkindex%_veclinks.size(),ORE_InvalidArguments);
+    size_t dofstride=0;
+    if( dofindices.size() > 0 ) {
+        dofstride = dofindices.size();
+    }
+    else {
+        dofstride = GetDOF();
+    }
+    vjacobian.resize(6*dofstride);
+    if( dofstride == 0 ) {
+        return;
+    }
+    std::fill(vjacobian.begin(),vjacobian.end(),0);
+    _ComputeJacobianFromChain(*_GetJacobianChain(linkindex,dofindices), position, &vjacobian[0], &vjacobian[3*dofstride], dofstride);
+}
+
+KinBody::JacobianChainConstPtr KinBody::_GetJacobianChain(int linkindex, const std::vector<int>& dofindices) const
+{
+    JacobianChainCacheConstPtr pcache = boost::atomic_load(&_pJacobianChains);
+    JacobianChainConstPtr pcachedchain = _FindJacobianChain(pcache, linkindex, dofindices);
+    if( !!pcachedchain ) {
+        return pcachedchain;
+    }
+
+    JacobianChainPtr pchain(new JacobianChain());
+    pchain->_vdofindices = dofindices;
+    pchain->_bHasMimic = false;
+    pchain->_vdofcolumns.resize(GetDOF(),-1);
+    if( dofindices.size() > 0 ) {
+        // if a dof index is repeated, only the first column gets the values
+        for(int i = (int)dofindices.size()-1; i >= 0; --i) {
+            if( dofindices[i] >= 0 && dofindices[i] < GetDOF() ) {
+                pchain->_vdofcolumns[dofindices[i]] = i;
+            }
+        }
+    }
+    else {
+        for(int i = 0; i < GetDOF(); ++i) {
+            pchain->_vdofcolumns[i] = i;
+        }
+    }
 
-    Vector v, anchor, axis;
     int offset = linkindex*_veclinks.size();
     int curlink = 0;
-    std::vector<std::pair<int,dReal> > vpartials;
-    std::map< std::pair<Mimic::DOFFormat, int>, dReal > mapcachedpartials;
     while(_vAllPairsShortestPaths[offset+curlink].first>=0) {
         int jointindex = _vAllPairsShortestPaths[offset+curlink].second;
         if( jointindex < (int)_vecjoints.size() ) {
             // active joint
             JointPtr pjoint = _vecjoints.at(jointindex);
-            int dofindex = pjoint->GetDOFIndex();
-            int8_t affect = DoesAffect(pjoint->GetJointIndex(), linkindex);
-            for(int dof = 0; dof < pjoint->GetDOF(); ++dof) {
-                if( affect != 0 ) {
-                    if( pjoint->IsRevolute(dof) ) {
-                        v = pjoint->GetAxis(dof);
-                    }
-                    else if( pjoint->IsPrismatic(dof) ) {
+            if( DoesAffect(pjoint->GetJointIndex(), linkindex) != 0 ) {
+                for(int dof = 0; dof < pjoint->GetDOF(); ++dof) {
+                    int index = pchain->_vdofcolumns.at(pjoint->GetDOFIndex()+dof);
+                    if( index < 0 ) {
                         continue;
                     }
-                    else {
-                        RAVELOG_WARN("ComputeJacobianAxisAngle joint %d not supported\n", pjoint->GetType());
+                    if( !pjoint->IsRevolute(dof) && !pjoint->IsPrismatic(dof) ) {
+                        RAVELOG_WARN_FORMAT("body %s jacobian of joint %s type %d not supported", GetName()%pjoint->GetName()%pjoint->GetType());
                         continue;
                     }
-                    if( dofindices.size() > 0 ) {
-                        std::vector<int>::const_iterator itindex = find(dofindices.begin(),dofindices.end(),dofindex+dof);
-                        if( itindex != dofindices.end() ) {
-                            size_t index = itindex-dofindices.begin();
-                            vjacobian[index] += v.x; vjacobian[index+dofstride] += v.y; vjacobian[index+2*dofstride] += v.z;
-                        }
-                    }
-                    else {
-                        vjacobian[dofindex+dof] += v.x; vjacobian[dofstride+dofindex+dof] += v.y; vjacobian[2*dofstride+dofindex+dof] += v.z;
-                    }
+                    JacobianChainAxis chainaxis;
+                    chainaxis._pjoint = pjoint;
+                    chainaxis._iaxis = dof;
+                    chainaxis._index = index;
+                    chainaxis._bRevolute = pjoint->IsRevolute(dof);
+                    pchain->_vaxes.push_back(chainaxis);
                 }
             }
         }
@@ -2115,63 +2140,118 @@ void KinBody::ComputeJacobianAxisAngle(int linkindex, std::vector<dReal>& vjacob
             JointPtr pjoint = _vPassiveJoints.at(jointindex-_vecjoints.size());
             for(int idof = 0; idof < pjoint->GetDOF(); ++idof) {
                 if( pjoint->IsMimic(idof) ) {
-                    bool bhas = dofindices.size() == 0;
-                    if( !bhas ) {
-                        FOREACHC(itmimicdof, pjoint->_vmimic[idof]->_vmimicdofs) {
-                            if( find(dofindices.begin(),dofindices.end(),itmimicdof->dofindex) != dofindices.end() ) {
-                                bhas = true;
-                                break;
-                            }
+                    bool bhas = false;
+                    FOREACHC(itmimicdof, pjoint->_vmimic[idof]->_vmimicdofs) {
+                        if( pchain->_vdofcolumns.at(itmimicdof->dofindex) >= 0 ) {
+                            bhas = true;
+                            break;
                         }
                     }
-                    if( bhas ) {
-                        Vector vaxis;
-                        if( pjoint->IsRevolute(idof) ) {
-                            vaxis = pjoint->GetAxis(idof);
-                        }
-                        else if( pjoint->IsPrismatic(idof) ) {
-                            continue;
-                        }
-                        else {
-                            RAVELOG_WARN("ComputeJacobianAxisAngle joint %d not supported\n", pjoint->GetType());
-                            continue;
-                        }
-                        pjoint->_ComputePartialVelocities(vpartials,idof,mapcachedpartials);
-                        FOREACH(itpartial,vpartials) {
-                            Vector v = vaxis * itpartial->second;
-                            int index = itpartial->first;
-                            if( dofindices.size() > 0 ) {
-                                std::vector<int>::const_iterator itindex = find(dofindices.begin(),dofindices.end(),itpartial->first);
-                                if( itindex == dofindices.end() ) {
-                                    continue;
-                                }
-                                index = itindex-dofindices.begin();
-                            }
-                            vjacobian[index] += v.x;
-                            vjacobian[dofstride+index] += v.y;
-                            vjacobian[2*dofstride+index] += v.z;
-                        }
+                    if( !bhas ) {
+                        continue;
                     }
+                    if( !pjoint->IsRevolute(idof) && !pjoint->IsPrismatic(idof) ) {
+                        RAVELOG_WARN_FORMAT("body %s jacobian of joint %s type %d not supported", GetName()%pjoint->GetName()%pjoint->GetType());
+                        continue;
+                    }
+                    JacobianChainAxis chainaxis;
+                    chainaxis._pjoint = pjoint;
+                    chainaxis._iaxis = idof;
+                    chainaxis._index = -1;
+                    chainaxis._bRevolute = pjoint->IsRevolute(idof);
+                    pchain->_vaxes.push_back(chainaxis);
+                    pchain->_bHasMimic = true;
                 }
             }
         }
         curlink = _vAllPairsShortestPaths[offset+curlink].first;
     }
+
+    // the cache is never modified once set, so add the chain to a copy and swap it in. if another thread swapped in a new cache meanwhile, try again with that one
+    while(1) {
+        boost::shared_ptr<JacobianChainCache> pnewcache(new JacobianChainCache());
+        if( !!pcache && pcache->size() == _veclinks.size() ) {
+            *pnewcache = *pcache;
+        }
+        else {
+            pnewcache->resize(_veclinks.size());
+        }
+        // callers usually alternate between very few dof index sets, so keep the cache small. evicted chains stay valid for the callers still holding them
+        std::vector<JacobianChainConstPtr>& vchains = pnewcache->at(linkindex);
+        if( vchains.size() >= 8 ) {
+            vchains.erase(vchains.begin());
+        }
+        vchains.push_back(pchain);
+        if( boost::atomic_compare_exchange(&_pJacobianChains, &pcache, JacobianChainCacheConstPtr(pnewcache)) ) {
+            return pchain;
+        }
+        pcachedchain = _FindJacobianChain(pcache, linkindex, dofindices);
+        if( !!pcachedchain ) {
+            return pcachedchain;
+        }
+    }
 }
 
-void KinBody::CalculateAngularVelocityJacobian(int linkindex, boost::multi_array<dReal,2>& mjacobian) const
+KinBody::JacobianChainConstPtr KinBody::_FindJacobianChain(const JacobianChainCacheConstPtr& pcache, int linkindex, const std::vector<int>& dofindices) const
 {
-    mjacobian.resize(boost::extents[3][GetDOF()]);
-    if( GetDOF() == 0 ) {
-        return;
+    if( !!pcache && pcache->size() == _veclinks.size() ) {
+        FOREACHC(itchain, pcache->at(linkindex)) {
+            if( (*itchain)->_vdofindices == dofindices ) {
+                return *itchain;
+            }
+        }
     }
-    std::vector<dReal> vjacobian;
-    ComputeJacobianAxisAngle(linkindex,vjacobian);
-    OPENRAVE_ASSERT_OP((int)vjacobian.size(),==,3*GetDOF());
-    vector<dReal>::const_iterator itsrc = vjacobian.begin();
-    FOREACH(itdst,mjacobian) {
-        std::copy(itsrc,itsrc+GetDOF(),itdst->begin());
-        itsrc += GetDOF();
+    return JacobianChainConstPtr();
+}
+
+void KinBody::_ResetKinematicsCaches()
+{
+    boost::atomic_store(&_pJacobianChains, JacobianChainCacheConstPtr());
+    boost::atomic_store(&_pInverseDynamicsTree, InverseDynamicsTreeConstPtr());
+}
+
+void KinBody::_ComputeJacobianFromChain(const JacobianChain& chain, const Vector& position, dReal* ptranslation, dReal* protation, size_t dofstride) const
+{
+    std::vector<std::pair<int,dReal> > vpartials;
+    std::map< std::pair<Mimic::DOFFormat, int>, dReal > mapcachedpartials;
+    FOREACHC(itaxis, chain._vaxes) {
+        Vector vaxis = itaxis->_pjoint->GetAxis(itaxis->_iaxis), vtranslation, vrotation;
+        if( itaxis->_bRevolute ) {
+            vrotation = vaxis;
+            if( !!ptranslation ) {
+                vtranslation = vaxis.cross(position-itaxis->_pjoint->GetAnchor());
+            }
+        }
+        else {
+            vtranslation = vaxis;
+        }
+        if( itaxis->_index >= 0 ) {
+            size_t index = itaxis->_index;
+            if( !!ptranslation ) {
+                ptranslation[index] += vtranslation.x; ptranslation[dofstride+index] += vtranslation.y; ptranslation[2*dofstride+index] += vtranslation.z;
+            }
+            if( !!protation ) {
+                protation[index] += vrotation.x; protation[dofstride+index] += vrotation.y; protation[2*dofstride+index] += vrotation.z;
+            }
+        }
+        else {
+            // the partials of mimic joints depend on the current values
+            itaxis->_pjoint->_ComputePartialVelocities(vpartials,itaxis->_iaxis,mapcachedpartials);
+            FOREACH(itpartial,vpartials) {
+                int index = chain._vdofcolumns.at(itpartial->first);
+                if( index < 0 ) {
+                    continue;
+                }
+                if( !!ptranslation ) {
+                    Vector v = vtranslation * itpartial->second;
+                    ptranslation[index] += v.x; ptranslation[dofstride+index] += v.y; ptranslation[2*dofstride+index] += v.z;
+                }
+                if( !!protation ) {
+                    Vector v = vrotation * itpartial->second;
+                    protation[index] += v.x; protation[dofstride+index] += v.y; protation[2*dofstride+index] += v.z;
+                }
+            }
+        }
     }
 }
 
@@ -2192,6 +2272,42 @@ void KinBody::ComputeHessianTranslation(int linkindex, const Vector& position, s
     }
     std::fill(hessian.begin(),hessian.end(),0);
 
+    JacobianChainConstPtr pchain = _GetJacobianChain(linkindex,dofindices);
+    const JacobianChain& chain = *pchain;
+    if( !chain._bHasMimic ) {
+        // every axis has its own column, so can directly accumulate the symmetric terms
+        std::vector<Vector> vrotations(chain._vaxes.size()), vtranslations(chain._vaxes.size());
+        for(size_t i = 0; i < chain._vaxes.size(); ++i) {
+            const JacobianChainAxis& chainaxis = chain._vaxes[i];
+            Vector vaxis = chainaxis._pjoint->GetAxis(chainaxis._iaxis);
+            if( chainaxis._bRevolute ) {
+                vrotations[i] = vaxis;
+                vtranslations[i] = vaxis.cross(position-chainaxis._pjoint->GetAnchor());
+            }
+            else {
+                vtranslations[i] = vaxis;
+            }
+        }
+        for(size_t i = 0; i < chain._vaxes.size(); ++i) {
+            size_t ioffset = 3*dofstride*chain._vaxes[i]._index;
+            for(size_t j = i; j < chain._vaxes.size(); ++j) {
+                Vector v = vrotations[i].cross(vtranslations[j]);
+                size_t indexoffset = ioffset+chain._vaxes[j]._index;
+                hessian[indexoffset+0] += v.x;
+                hessian[indexoffset+dofstride] += v.y;
+                hessian[indexoffset+2*dofstride] += v.z;
+                if( j != i ) {
+                    // symmetric
+                    indexoffset = 3*dofstride*chain._vaxes[j]._index+chain._vaxes[i]._index;
+                    hessian[indexoffset+0] += v.x;
+                    hessian[indexoffset+dofstride] += v.y;
+                    hessian[indexoffset+2*dofstride] += v.z;
+                }
+            }
+        }
+        return;
+    }
+
     int offset = linkindex*_veclinks.size();
     int curlink = 0;
     std::vector<Vector> vaxes, vjacobian; vaxes.reserve(dofstride); vjacobian.reserve(dofstride);
@@ -2911,6 +3027,356 @@ void KinBody::ComputeInverseDynamics(boost::array< std::vector<dReal>, 3>& vDOFT
     }
 }
 
+class KinBody::InverseDynamicsTree
+{
+public:
+    struct TreeLink
+    {
+        dReal _mass;
+        Vector _vlocalcom; ///< center of mass in the link frame
+        TransformMatrix _tlocalinertia; ///< inertia at the center of mass in the link frame
+    };
+
+    /// \brief the joints in topological order
+    struct TreeJoint
+    {
+        JointPtr _pjoint;
+        int _parentindex; ///< 0 if the joint is attached to the environment
+        int _childindex;
+        bool _bHasParent;
+        bool _bRevolute;
+        bool _bComputeChild; ///< false if the child link is computed by an earlier joint of a closed loop
+        int _dofindex; ///< -1 if passive
+        int _passiveindex; ///< index into _vPassiveJoints if passive
+        Transform _tleft, _tright;
+        Vector _vaxis; ///< in the left frame
+    };
+
+    std::vector<TreeLink> _vlinks;
+    std::vector<TreeJoint> _vjoints;
+};
+
+class KinBody::InverseDynamicsState
+{
+public:
+    /// \brief the state of a link while computing one state
+    struct LinkState
+    {
+        Transform _t;
+        Vector _vlinearvel, _vangularvel, _vlinearaccel, _vangularaccel; ///< at the link origin
+        Vector _vcom, _vforce, _vtorque; ///< global center of mass and the force/torque acting on it
+    };
+
+    /// \brief the values of a passive joint while computing one state
+    struct PassiveState
+    {
+        dReal _value, _velocity, _acceleration;
+        std::vector<std::pair<int,dReal> > _vpartials; ///< partial derivatives of the value with respect to the dofs if mimic
+    };
+
+    std::vector<std::pair<Vector,Vector> > _vlinkvelocities; ///< current velocities of the links, used for the links not moved by a joint like the base link
+    std::vector<LinkState> _vlinkstates;
+    std::vector<PassiveState> _vpassivestates;
+    std::vector<dReal> _vtempvalues, _veval; ///< scratch for evaluating the mimic equations
+};
+
+void KinBody::ComputeInverseDynamicsBatch(std::vector<dReal>& doftorques, const std::vector<dReal>& dofvalues, const std::vector<dReal>& dofvelocities, const std::vector<dReal>& dofaccelerations) const
+{
+    CHECK_INTERNAL_COMPUTATION;
+    size_t dof = GetDOF();
+    if( dof == 0 ) {
+        doftorques.resize(0);
+        return;
+    }
+    OPENRAVE_ASSERT_OP_FORMAT0(dofvalues.size()%dof,==,0, "dof values size is not a multiple of the dof", ORE_InvalidArguments);
+    OPENRAVE_ASSERT_FORMAT(dofvelocities.size() == 0 || dofvelocities.size() == dofvalues.size(), "dof velocities size %d != %d", dofvelocities.size()%dofvalues.size(), ORE_InvalidArguments);
+    OPENRAVE_ASSERT_FORMAT(dofaccelerations.size() == 0 || dofaccelerations.size() == dofvalues.size(), "dof accelerations size %d != %d", dofaccelerations.size()%dofvalues.size(), ORE_InvalidArguments);
+    doftorques.resize(dofvalues.size());
+    if( dofvalues.size() == 0 ) {
+        return;
+    }
+    InverseDynamicsTreeConstPtr ptree = _GetInverseDynamicsTree();
+    InverseDynamicsState state;
+    GetLinkVelocities(state._vlinkvelocities);
+    state._vlinkstates.resize(_veclinks.size());
+    state._vpassivestates.resize(_vPassiveJoints.size());
+    for(size_t istate = 0; istate < dofvalues.size(); istate += dof) {
+        _ComputeInverseDynamicsFromTree(*ptree, state, &dofvalues[istate], dofvelocities.size() > 0 ? &dofvelocities[istate] : NULL, dofaccelerations.size() > 0 ? &dofaccelerations[istate] : NULL, &doftorques[istate]);
+    }
+}
+
+KinBody::InverseDynamicsTreeConstPtr KinBody::_GetInverseDynamicsTree() const
+{
+    InverseDynamicsTreeConstPtr pcachedtree = boost::atomic_load(&_pInverseDynamicsTree);
+    if( !!pcachedtree ) {
+        return pcachedtree;
+    }
+    // threads compiling the tree at the same time compile the same tree, so the last one stored wins
+    boost::shared_ptr<InverseDynamicsTree> ptree(new InverseDynamicsTree());
+    ptree->_vlinks.resize(_veclinks.size());
+    for(size_t ilink = 0; ilink < _veclinks.size(); ++ilink) {
+        InverseDynamicsTree::TreeLink& treelink = ptree->_vlinks[ilink];
+        treelink._mass = _veclinks[ilink]->GetMass();
+        treelink._vlocalcom = _veclinks[ilink]->GetLocalCOM();
+        treelink._tlocalinertia = _veclinks[ilink]->GetLocalInertia();
+    }
+
+    std::vector<uint8_t> vlinkscomputed(_veclinks.size(),0);
+    if( vlinkscomputed.size() > 0 ) {
+        vlinkscomputed[0] = 1;
+    }
+    ptree->_vjoints.resize(_vTopologicallySortedJointsAll.size());
+    for(size_t ijoint = 0; ijoint < _vTopologicallySortedJointsAll.size(); ++ijoint) {
+        JointPtr pjoint = _vTopologicallySortedJointsAll[ijoint];
+        if( pjoint->GetType() != JointHinge && pjoint->GetType() != JointSlider ) {
+            throw OPENRAVE_EXCEPTION_FORMAT("joint 0x%x not supported", pjoint->GetType(), ORE_NotImplemented);
+        }
+        InverseDynamicsTree::TreeJoint& treejoint = ptree->_vjoints[ijoint];
+        treejoint._pjoint = pjoint;
+        treejoint._bHasParent = !!pjoint->GetHierarchyParentLink();
+        treejoint._parentindex = treejoint._bHasParent ? pjoint->GetHierarchyParentLink()->GetIndex() : 0;
+        treejoint._childindex = pjoint->GetHierarchyChildLink()->GetIndex();
+        treejoint._bRevolute = pjoint->GetType() == JointHinge;
+        treejoint._bComputeChild = !vlinkscomputed[treejoint._childindex];
+        vlinkscomputed[treejoint._childindex] = 1;
+        treejoint._dofindex = pjoint->GetDOFIndex();
+        treejoint._passiveindex = _vTopologicallySortedJointIndicesAll[ijoint] - (int)_vecjoints.size();
+        treejoint._tleft = pjoint->GetInternalHierarchyLeftTransform();
+        treejoint._tright = pjoint->GetInternalHierarchyRightTransform();
+        treejoint._vaxis = pjoint->GetInternalHierarchyAxis(0);
+    }
+    boost::atomic_store(&_pInverseDynamicsTree, InverseDynamicsTreeConstPtr(ptree));
+    return ptree;
+}
+
+/// \brief returns the rotation of v by the transpose of the rotation of t
+static inline Vector _InverseRotate(const TransformMatrix& t, const Vector& v)
+{
+    return Vector(t.m[0]*v.x + t.m[4]*v.y + t.m[8]*v.z, t.m[1]*v.x + t.m[5]*v.y + t.m[9]*v.z, t.m[2]*v.x + t.m[6]*v.y + t.m[10]*v.z);
+}
+
+/// \brief adds fpartial to the partial derivative of dofindex
+static inline void _AddPartial(std::vector<std::pair<int,dReal> >& vpartials, int dofindex, dReal fpartial)
+{
+    FOREACH(itpartial,vpartials) {
+        if( itpartial->first == dofindex ) {
+            itpartial->second += fpartial;
+            return;
+        }
+    }
+    vpartials.push_back(std::make_pair(dofindex, fpartial));
+}
+
+void KinBody::_ComputeInverseDynamicsFromTree(const InverseDynamicsTree& tree, InverseDynamicsState& state, const dReal* pdofvalues, const dReal* pdofvelocities, const dReal* pdofaccelerations, dReal* pdoftorques) const
+{
+    // all values are in the global coordinate system, same as ComputeInverseDynamics.
+    // the links not moved by a joint keep their current transform and velocity, their acceleration is set as in _ComputeLinkAccelerations
+    for(size_t ilink = 0; ilink < state._vlinkstates.size(); ++ilink) {
+        InverseDynamicsState::LinkState& linkstate = state._vlinkstates[ilink];
+        linkstate._t = _veclinks[ilink]->_info._t; // overwritten for the child links
+        linkstate._vlinearvel = state._vlinkvelocities.at(ilink).first;
+        linkstate._vangularvel = state._vlinkvelocities.at(ilink).second;
+        linkstate._vlinearaccel = linkstate._vangularvel.cross(linkstate._vlinearvel);
+        linkstate._vangularaccel = Vector();
+    }
+    if( state._vlinkstates.size() > 0 ) {
+        state._vlinkstates[0]._vlinearaccel -= GetEnv()->GetPhysicsEngine()->GetGravity();
+    }
+    for(size_t i = 0; i < state._vpassivestates.size(); ++i) {
+        InverseDynamicsState::PassiveState& passivestate = state._vpassivestates[i];
+        passivestate._value = _vPassiveJoints[i]->IsMimic(0) ? 0 : _vPassiveJoints[i]->GetValue(0);
+        passivestate._velocity = 0;
+        passivestate._acceleration = 0;
+        passivestate._vpartials.resize(0);
+    }
+
+    // forward recursion
+    FOREACHC(ittreejoint, tree._vjoints) {
+        dReal value, velocity = 0, acceleration = 0;
+        if( ittreejoint->_dofindex >= 0 ) {
+            value = pdofvalues[ittreejoint->_dofindex];
+            if( !!pdofvelocities ) {
+                velocity = pdofvelocities[ittreejoint->_dofindex];
+            }
+            if( !!pdofaccelerations ) {
+                acceleration = pdofaccelerations[ittreejoint->_dofindex];
+            }
+        }
+        else if( ittreejoint->_pjoint->IsMimic(0) ) {
+            // have to evaluate the mimic equations at this state since the values of the dependent joints are not set
+            JointPtr pjoint = ittreejoint->_pjoint;
+            InverseDynamicsState::PassiveState& passivestate = state._vpassivestates.at(ittreejoint->_passiveindex);
+            const std::vector<Mimic::DOFFormat>& vdofformat = pjoint->_vmimic[0]->_vdofformat;
+            state._vtempvalues.resize(0);
+            FOREACHC(itdof,vdofformat) {
+                state._vtempvalues.push_back(itdof->dofindex >= 0 ? pdofvalues[itdof->dofindex] : state._vpassivestates.at(itdof->jointindex-_vecjoints.size())._value);
+            }
+            value = 0;
+            int err = pjoint->_Eval(0,0,state._vtempvalues,state._veval);
+            if( err || state._veval.size() == 0 ) {
+                RAVELOG_WARN(str(boost::format("failed to evaluate joint %s, fparser error %d")%pjoint->GetName()%err));
+            }
+            else {
+                // take the first value inside the limits like SetDOFValues
+                dReal flower = pjoint->_info._vlowerlimit[0], fupper = pjoint->_info._vupperlimit[0];
+                bool bfound = false;
+                if( pjoint->IsCircular(0) ) {
+                    value = state._veval[0];
+                    bfound = true;
+                }
+                else {
+                    FOREACHC(iteval, state._veval) {
+                        if( *iteval >= flower-g_fEpsilonJointLimit && *iteval <= fupper+g_fEpsilonJointLimit ) {
+                            value = *iteval < flower ? flower : (*iteval > fupper ? fupper : *iteval);
+                            bfound = true;
+                            break;
+                        }
+                    }
+                }
+                if( !bfound ) {
+                    value = state._veval[0];
+                    if( value < flower-g_fEpsilonEvalJointLimit ) {
+                        value = flower;
+                    }
+                    else if( value > fupper+g_fEpsilonEvalJointLimit ) {
+                        value = fupper;
+                    }
+                }
+            }
+
+            // the velocity partials are also needed for transferring the torque to the dofs
+            err = pjoint->_Eval(0,1,state._vtempvalues,state._veval);
+            if( err ) {
+                RAVELOG_WARN(str(boost::format("failed to evaluate joint %s, fparser error %d")%pjoint->GetName()%err));
+            }
+            else {
+                for(size_t ipartial = 0; ipartial < vdofformat.size(); ++ipartial) {
+                    dReal fpartial = state._veval.at(ipartial);
+                    if( vdofformat[ipartial].dofindex >= 0 ) {
+                        if( !!pdofvelocities ) {
+                            velocity += fpartial*pdofvelocities[vdofformat[ipartial].dofindex];
+                        }
+                        _AddPartial(passivestate._vpartials, vdofformat[ipartial].dofindex, fpartial);
+                    }
+                    else {
+                        const InverseDynamicsState::PassiveState& dependentstate = state._vpassivestates.at(vdofformat[ipartial].jointindex-_vecjoints.size());
+                        velocity += fpartial*dependentstate._velocity;
+                        FOREACHC(itpartial, dependentstate._vpartials) {
+                            _AddPartial(passivestate._vpartials, itpartial->first, fpartial*itpartial->second);
+                        }
+                    }
+                }
+            }
+            if( !!pdofaccelerations ) {
+                err = pjoint->_Eval(0,2,state._vtempvalues,state._veval);
+                if( err ) {
+                    RAVELOG_WARN(str(boost::format("failed to evaluate joint %s, fparser error %d")%pjoint->GetName()%err));
+                }
+                else {
+                    for(size_t ipartial = 0; ipartial < vdofformat.size(); ++ipartial) {
+                        if( vdofformat[ipartial].dofindex >= 0 ) {
+                            acceleration += state._veval.at(ipartial)*pdofaccelerations[vdofformat[ipartial].dofindex];
+                        }
+                        else {
+                            acceleration += state._veval.at(ipartial)*state._vpassivestates.at(vdofformat[ipartial].jointindex-_vecjoints.size())._acceleration;
+                        }
+                    }
+                }
+            }
+            passivestate._value = value;
+            passivestate._velocity = velocity;
+            passivestate._acceleration = acceleration;
+        }
+        else {
+            value = state._vpassivestates.at(ittreejoint->_passiveindex)._value;
+        }
+
+        if( !ittreejoint->_bComputeChild ) {
+            continue;
+        }
+
+        const InverseDynamicsState::LinkState& parentstate = state._vlinkstates[ittreejoint->_parentindex];
+        InverseDynamicsState::LinkState& childstate = state._vlinkstates[ittreejoint->_childindex];
+        Transform tdelta = parentstate._t * ittreejoint->_tleft;
+        Vector vaxis = tdelta.rotate(ittreejoint->_vaxis);
+        Transform tjoint;
+        if( ittreejoint->_bRevolute ) {
+            tjoint.rot = quatFromAxisAngle(ittreejoint->_vaxis, value);
+        }
+        else {
+            tjoint.trans = ittreejoint->_vaxis * value;
+        }
+        childstate._t = tdelta * tjoint * ittreejoint->_tright;
+
+        // see _ComputeLinkAccelerations for the derivation
+        Vector xyzdelta = childstate._t.trans - parentstate._t.trans;
+        if( ittreejoint->_bRevolute ) {
+            Vector vanchortochild = childstate._t.trans - tdelta.trans;
+            Vector gw = vaxis*velocity, gdw = vaxis*acceleration;
+            childstate._vangularvel = parentstate._vangularvel + gw;
+            childstate._vlinearvel = parentstate._vlinearvel + parentstate._vangularvel.cross(xyzdelta) + gw.cross(vanchortochild);
+            childstate._vlinearaccel = parentstate._vlinearaccel + parentstate._vangularaccel.cross(xyzdelta) + parentstate._vangularvel.cross((childstate._vlinearvel-parentstate._vlinearvel)*2-parentstate._vangularvel.cross(xyzdelta)) + gw.cross(gw.cross(vanchortochild)) + gdw.cross(vanchortochild);
+            childstate._vangularaccel = parentstate._vangularaccel + parentstate._vangularvel.cross(gw) + gdw;
+        }
+        else {
+            Vector gv = vaxis*velocity;
+            childstate._vangularvel = parentstate._vangularvel;
+            childstate._vlinearvel = parentstate._vlinearvel + parentstate._vangularvel.cross(xyzdelta) + gv;
+            childstate._vlinearaccel = parentstate._vlinearaccel + parentstate._vangularaccel.cross(xyzdelta) + parentstate._vangularvel.cross(childstate._vlinearvel-parentstate._vlinearvel+gv) + vaxis*acceleration;
+            childstate._vangularaccel = parentstate._vangularaccel;
+        }
+    }
+
+    // forces and torques at the center of mass
+    TransformMatrix trot;
+    for(size_t ilink = 0; ilink < state._vlinkstates.size(); ++ilink) {
+        const InverseDynamicsTree::TreeLink& treelink = tree._vlinks[ilink];
+        InverseDynamicsState::LinkState& linkstate = state._vlinkstates[ilink];
+        linkstate._vcom = linkstate._t * treelink._vlocalcom;
+        Vector vglobalcomfromlink = linkstate._vcom - linkstate._t.trans;
+        linkstate._vforce = (linkstate._vlinearaccel + linkstate._vangularaccel.cross(vglobalcomfromlink) + linkstate._vangularvel.cross(linkstate._vangularvel.cross(vglobalcomfromlink)))*treelink._mass;
+        matrixFromQuat(trot, linkstate._t.rot);
+        Vector vangularaccelinertia = trot.rotate(treelink._tlocalinertia.rotate(_InverseRotate(trot, linkstate._vangularaccel)));
+        Vector vangularvelinertia = trot.rotate(treelink._tlocalinertia.rotate(_InverseRotate(trot, linkstate._vangularvel)));
+        linkstate._vtorque = vangularaccelinertia + linkstate._vangularvel.cross(vangularvelinertia);
+    }
+
+    // backward recursion
+    std::fill(pdoftorques, pdoftorques+GetDOF(), dReal(0));
+    for(std::vector<InverseDynamicsTree::TreeJoint>::const_reverse_iterator ittreejoint = tree._vjoints.rbegin(); ittreejoint != tree._vjoints.rend(); ++ittreejoint) {
+        const InverseDynamicsState::LinkState& childstate = state._vlinkstates[ittreejoint->_childindex];
+        InverseDynamicsState::LinkState& parentstate = state._vlinkstates[ittreejoint->_parentindex];
+        if( ittreejoint->_bHasParent ) {
+            parentstate._vforce += childstate._vforce;
+            parentstate._vtorque += childstate._vtorque + (childstate._vcom - parentstate._vcom).cross(childstate._vforce);
+        }
+        int dofindex = ittreejoint->_dofindex;
+        if( dofindex < 0 && !ittreejoint->_pjoint->IsMimic(0) ) {
+            // joint should be static
+            continue;
+        }
+
+        Transform tdelta = parentstate._t * ittreejoint->_tleft;
+        Vector vaxis = tdelta.rotate(ittreejoint->_vaxis);
+        dReal faxistorque;
+        if( ittreejoint->_bRevolute ) {
+            faxistorque = vaxis.dot3(childstate._vtorque + (childstate._vcom - tdelta.trans).cross(childstate._vforce));
+        }
+        else {
+            faxistorque = vaxis.dot3(childstate._vforce);
+        }
+        if( dofindex >= 0 ) {
+            pdoftorques[dofindex] += faxistorque;
+        }
+        else {
+            // passive joint, so have to transfer the torque to its dependent joints.
+            FOREACHC(itpartial, state._vpassivestates.at(ittreejoint->_passiveindex)._vpartials) {
+                pdoftorques[itpartial->first] += itpartial->second*faxistorque;
+            }
+        }
+    }
+}
+
 void KinBody::GetLinkAccelerations(const std::vector<dReal>&vDOFAccelerations, std::vector<std::pair<Vector,Vector> >&vLinkAccelerations, AccelerationMapConstPtr externalaccelerations) const
 {
     CHECK_INTERNAL_COMPUTATION;
@@ -3223,6 +3689,7 @@ void KinBody::_ComputeInternalInformation()
 {
     uint64_t starttime = utils::GetMicroTime();
     _nHierarchyComputed = 1;
+    _ResetKinematicsCaches();
 
     int lindex=0;
     FOREACH(itlink,_veclinks) {
@@ -4076,26 +4543,9 @@ void KinBody::_ComputeInternalInformation()
     }
 
     // notify any callbacks of the changes
-    std::list<UserDataWeakPtr> listRegisteredCallbacks;
-    uint32_t index = 0;
     uint32_t parameters = _nParametersChanged;
-    while(parameters && index < _vlistRegisteredCallbacks.size()) {
-        if( (parameters & 1) &&  _vlistRegisteredCallbacks.at(index).size() > 0 ) {
-            {
-                boost::shared_lock< boost::shared_mutex > lock(GetInterfaceMutex());
-                listRegisteredCallbacks = _vlistRegisteredCallbacks.at(index); // copy since it can be changed
-            }
-            FOREACH(it,listRegisteredCallbacks) {
-                ChangeCallbackDataPtr pdata = boost::dynamic_pointer_cast<ChangeCallbackData>(it->lock());
-                if( !!pdata ) {
-                    pdata->_callback();
-                }
-            }
-        }
-        parameters >>= 1;
-        index += 1;
-    }
     _nParametersChanged = 0;
+    _CallChangeCallbacks(parameters);
     RAVELOG_VERBOSE_FORMAT("initialized %s in %fs", GetName()%(1e-6*(utils::GetMicroTime()-starttime)));
 }
 
@@ -4330,6 +4780,7 @@ void KinBody::Clone(InterfaceBaseConstPtr preference, int cloningoptions)
 
     _name = r->_name;
     _nHierarchyComputed = r->_nHierarchyComputed;
+    _ResetKinematicsCaches();
     _bMakeJoinedLinksAdjacent = r->_bMakeJoinedLinksAdjacent;
     __hashkinematics = r->__hashkinematics;
     _vTempJoints = r->_vTempJoints;
@@ -4448,23 +4899,36 @@ void KinBody::_PostprocessChangedParameters(uint32_t parameters)
         SetDOFValues(vzeros,Transform(),true);
         _ComputeInternalInformation();
     }
+    if( !!(parameters & Prop_LinkDynamics) ) {
+        // the masses and inertias are compiled in the tree
+        boost::atomic_store(&_pInverseDynamicsTree, InverseDynamicsTreeConstPtr());
+    }
     // do not change hash if geometry changed!
     if( !!(parameters & (Prop_LinkDynamics|Prop_LinkGeometry|Prop_JointMimic)) ) {
         __hashkinematics.resize(0);
     }
 
-    std::list<UserDataWeakPtr> listRegisteredCallbacks;
+    _CallChangeCallbacks(parameters);
+}
+
+void KinBody::_CallChangeCallbacks(uint32_t parameters)
+{
+    if( _nCallbacksSuspended > 0 ) {
+        _nParametersChanged |= parameters;
+        return;
+    }
     uint32_t index = 0;
-    while(parameters && index < _vlistRegisteredCallbacks.size()) {
-        if( (parameters & 1) &&  _vlistRegisteredCallbacks.at(index).size() > 0 ) {
-            {
-                boost::shared_lock< boost::shared_mutex > lock(GetInterfaceMutex());
-                listRegisteredCallbacks = _vlistRegisteredCallbacks.at(index); // copy since it can be changed
-            }
-            FOREACH(it,listRegisteredCallbacks) {
-                ChangeCallbackDataPtr pdata = boost::dynamic_pointer_cast<ChangeCallbackData>(it->lock());
-                if( !!pdata ) {
-                    pdata->_callback();
+    while(parameters && index < _vRegisteredCallbacks.size()) {
+        if( parameters & 1 ) {
+            // the arrays are never modified once set, so no need to lock or copy
+            boost::shared_ptr<const std::vector<UserDataWeakPtr> > pcallbacks = boost::atomic_load(&_vRegisteredCallbacks[index]);
+            if( !!pcallbacks ) {
+                FOREACHC(it, *pcallbacks) {
+                    // only ChangeCallbackData is ever registered
+                    ChangeCallbackDataPtr pdata = boost::static_pointer_cast<ChangeCallbackData>(it->lock());
+                    if( !!pdata ) {
+                        pdata->_callback();
+                    }
                 }
             }
         }
@@ -4572,22 +5036,10 @@ UserDataPtr KinBody::RegisterChangeCallback(uint32_t properties, const boost::fu
 {
     ChangeCallbackDataPtr pdata(new ChangeCallbackData(properties,callback,shared_kinbody_const()));
     boost::unique_lock< boost::shared_mutex > lock(GetInterfaceMutex());
-
-    uint32_t index = 0;
-    while(properties) {
-        if( properties & 1 ) {
-            if( index >= _vlistRegisteredCallbacks.size() ) {
-                // have to resize _vlistRegisteredCallbacks, but have to preserve the internal lists since ChangeCallbackData keep track of the list iterators
-                std::vector<std::list<UserDataWeakPtr> > vlistRegisteredCallbacks(index+1);
-                for(size_t i = 0; i < _vlistRegisteredCallbacks.size(); ++i) {
-                    vlistRegisteredCallbacks[i].swap(_vlistRegisteredCallbacks[i]);
-                }
-                _vlistRegisteredCallbacks.swap(vlistRegisteredCallbacks);
-            }
-            pdata->_iterators.push_back(make_pair(index, _vlistRegisteredCallbacks.at(index).insert(_vlistRegisteredCallbacks.at(index).end(),pdata)));
+    for(size_t index = 0; index < _vRegisteredCallbacks.size(); ++index) {
+        if( properties & (1U<<index) ) {
+            ChangeCallbackData::_UpdateCallbacks(shared_kinbody_const(), index, pdata);
         }
-        properties >>= 1;
-        index += 1;
     }
     return pdata;
 }
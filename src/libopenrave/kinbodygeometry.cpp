@@ -143,6 +143,7 @@ bool KinBody::GeometryInfo::InitCollisionMesh(float fTessellation)
     if( _type == GT_TriMesh || _type == GT_None ) {
         return true;
     }
+    _psharedmeshcollision.reset();
     _meshcollision.indices.clear();
     _meshcollision.vertices.clear();
 
@@ -222,6 +223,21 @@ bool KinBody::GeometryInfo::InitCollisionMesh(float fTessellation)
     return true;
 }
 
+TriMesh& KinBody::GeometryInfo::GetModifiableCollisionMesh()
+{
+    if( !!_psharedmeshcollision ) {
+        _meshcollision = *_psharedmeshcollision;
+        _psharedmeshcollision.reset();
+    }
+    return _meshcollision;
+}
+
+void KinBody::GeometryInfo::SetSharedCollisionMesh(boost::shared_ptr<TriMesh const> pmesh)
+{
+    _psharedmeshcollision = pmesh;
+    _meshcollision = TriMesh();
+}
+
 KinBody::Link::Geometry::Geometry(KinBody::LinkPtr parent, const KinBody::GeometryInfo& info) : _parent(parent), _info(info)
 {
 }
@@ -259,10 +275,11 @@ AABB KinBody::Link::Geometry::ComputeAABB(const Transform& t) const
         ab.pos = tglobal.trans; //+(dReal)0.5*_info._vGeomData.y*Vector(tglobal.m[2],tglobal.m[6],tglobal.m[10]);
         break;
     case GT_TriMesh:
-        // just use _info._meshcollision
-        if( _info._meshcollision.vertices.size() > 0) {
-            Vector vmin, vmax; vmin = vmax = tglobal*_info._meshcollision.vertices.at(0);
-            FOREACHC(itv, _info._meshcollision.vertices) {
+        // just use the collision mesh
+        if( _info.GetCollisionMesh().vertices.size() > 0) {
+            const TriMesh& mesh = _info.GetCollisionMesh();
+            Vector vmin, vmax; vmin = vmax = tglobal*mesh.vertices.at(0);
+            FOREACHC(itv, mesh.vertices) {
                 Vector v = tglobal * *itv;
                 if( vmin.x > v.x ) {
                     vmin.x = v.x;
@@ -303,7 +320,7 @@ void KinBody::Link::Geometry::serialize(std::ostream& o, int options) const
     o << _info._type << " ";
     SerializeRound3(o,_info._vRenderScale);
     if( _info._type == GT_TriMesh ) {
-        _info._meshcollision.serialize(o,options);
+        _info.GetCollisionMesh().serialize(o,options);
     }
     else {
         SerializeRound3(o,_info._vGeomData);
@@ -314,6 +331,7 @@ void KinBody::Link::Geometry::SetCollisionMesh(const TriMesh& mesh)
 {
     OPENRAVE_ASSERT_FORMAT0(_info._bModifiable, "geometry cannot be modified", ORE_Failed);
     LinkPtr parent(_parent);
+    _info._psharedmeshcollision.reset();
     _info._meshcollision = mesh;
     parent->_Update();
 }
@@ -19,6 +19,136 @@
 
 namespace OpenRAVE {
 
+static boost::mutex s_mutexSphereTrees; ///< protects s_mapSphereTrees
+/// \brief sphere trees of all the links indexed by the hash of their collision mesh
+static std::map<std::string, boost::weak_ptr<KinBody::Link::SphereTree const> > s_mapSphereTrees;
+static const int s_nSphereTreeDepth = 5;
+
+class SphereTreeCenterCompare
+{
+public:
+    SphereTreeCenterCompare(const std::vector<Vector>& vcenters, int axis) : _vcenters(vcenters), _axis(axis) {
+    }
+    bool operator()(int i, int j) const {
+        return _vcenters[i][_axis] < _vcenters[j][_axis];
+    }
+    const std::vector<Vector>& _vcenters;
+    int _axis;
+};
+
+/// \brief adds the node enclosing the triangles vtriangles[begin:end] and its subtree to the tree
+///
+/// \return the index of the node
+static int _BuildSphereTreeNode(KinBody::Link::SphereTree& tree, const TriMesh& trimesh, const std::vector<Vector>& vcenters, std::vector<int>& vtriangles, int begin, int end, int depth, int maxdepth)
+{
+    Vector vmin = trimesh.vertices.at(trimesh.indices.at(3*vtriangles[begin])), vmax = vmin;
+    Vector vcentermin = vcenters[vtriangles[begin]], vcentermax = vcentermin;
+    for(int i = begin; i < end; ++i) {
+        for(int j = 0; j < 3; ++j) {
+            const Vector& v = trimesh.vertices[trimesh.indices[3*vtriangles[i]+j]];
+            for(int k = 0; k < 3; ++k) {
+                vmin[k] = min(vmin[k], v[k]);
+                vmax[k] = max(vmax[k], v[k]);
+            }
+        }
+        const Vector& c = vcenters[vtriangles[i]];
+        for(int k = 0; k < 3; ++k) {
+            vcentermin[k] = min(vcentermin[k], c[k]);
+            vcentermax[k] = max(vcentermax[k], c[k]);
+        }
+    }
+    Vector vsphere = 0.5*(vmin+vmax);
+    dReal fradius2 = 0;
+    for(int i = begin; i < end; ++i) {
+        for(int j = 0; j < 3; ++j) {
+            fradius2 = max(fradius2, (trimesh.vertices[trimesh.indices[3*vtriangles[i]+j]]-vsphere).lengthsqr3());
+        }
+    }
+    vsphere.w = RaveSqrt(fradius2);
+
+    int index = (int)tree.spheres.size();
+    tree.spheres.push_back(vsphere);
+    tree.children.push_back(std::make_pair(-1,-1));
+
+    int axis = 0;
+    Vector vcenterextents = vcentermax-vcentermin;
+    for(int k = 1; k < 3; ++k) {
+        if( vcenterextents[k] > vcenterextents[axis] ) {
+            axis = k;
+        }
+    }
+    if( depth >= maxdepth || end-begin <= 1 || vcenterextents[axis] <= g_fEpsilonLinear ) {
+        tree.leaves.push_back(index);
+        return index;
+    }
+    int mid = (begin+end)/2;
+    std::nth_element(vtriangles.begin()+begin, vtriangles.begin()+mid, vtriangles.begin()+end, SphereTreeCenterCompare(vcenters, axis));
+    int child0 = _BuildSphereTreeNode(tree, trimesh, vcenters, vtriangles, begin, mid, depth+1, maxdepth);
+    int child1 = _BuildSphereTreeNode(tree, trimesh, vcenters, vtriangles, mid, end, depth+1, maxdepth);
+    tree.children[index] = std::make_pair(child0, child1);
+    return index;
+}
+
+void KinBody::Link::SphereTree::Init(const TriMesh& trimeshin, int maxdepth)
+{
+    spheres.resize(0);
+    children.resize(0);
+    leaves.resize(0);
+    if( trimeshin.indices.size() < 3 ) {
+        return;
+    }
+
+    // split the big triangles so that the leaves are not forced to enclose the whole extent of a primitive
+    dReal fmaxedge = 0;
+    {
+        Vector vmin = trimeshin.vertices.at(0), vmax = vmin;
+        FOREACHC(itv, trimeshin.vertices) {
+            for(int k = 0; k < 3; ++k) {
+                vmin[k] = min(vmin[k], (*itv)[k]);
+                vmax[k] = max(vmax[k], (*itv)[k]);
+            }
+        }
+        fmaxedge = 0.125*RaveSqrt((vmax-vmin).lengthsqr3());
+    }
+    TriMesh trimesh;
+    trimesh.vertices = trimeshin.vertices;
+    std::vector<int> vstack;
+    for(size_t i = 0; i+2 < trimeshin.indices.size(); i += 3) {
+        vstack.push_back(trimeshin.indices[i]); vstack.push_back(trimeshin.indices[i+1]); vstack.push_back(trimeshin.indices[i+2]);
+        while(vstack.size() > 0) {
+            int tri[3] = { vstack[vstack.size()-3], vstack[vstack.size()-2], vstack[vstack.size()-1] };
+            vstack.resize(vstack.size()-3);
+            int iedge = 0;
+            dReal flength2 = 0;
+            for(int j = 0; j < 3; ++j) {
+                dReal f = (trimesh.vertices[tri[j]]-trimesh.vertices[tri[(j+1)%3]]).lengthsqr3();
+                if( f > flength2 ) {
+                    flength2 = f;
+                    iedge = j;
+                }
+            }
+            if( flength2 <= fmaxedge*fmaxedge ) {
+                trimesh.indices.push_back(tri[0]); trimesh.indices.push_back(tri[1]); trimesh.indices.push_back(tri[2]);
+                continue;
+            }
+            int i0 = tri[iedge], i1 = tri[(iedge+1)%3], i2 = tri[(iedge+2)%3];
+            int imid = (int)trimesh.vertices.size();
+            trimesh.vertices.push_back(0.5*(trimesh.vertices[i0]+trimesh.vertices[i1]));
+            vstack.push_back(i0); vstack.push_back(imid); vstack.push_back(i2);
+            vstack.push_back(imid); vstack.push_back(i1); vstack.push_back(i2);
+        }
+    }
+
+    int numtriangles = (int)trimesh.indices.size()/3;
+    std::vector<Vector> vcenters(numtriangles);
+    std::vector<int> vtriangles(numtriangles);
+    for(int i = 0; i < numtriangles; ++i) {
+        vcenters[i] = (trimesh.vertices[trimesh.indices[3*i]] + trimesh.vertices[trimesh.indices[3*i+1]] + trimesh.vertices[trimesh.indices[3*i+2]])*(1.0/3.0);
+        vtriangles[i] = i;
+    }
+    _BuildSphereTreeNode(*this, trimesh, vcenters, vtriangles, 0, numtriangles, 0, maxdepth);
+}
+
 KinBody::LinkInfo::LinkInfo() : XMLReadable("link"), _mass(0), _bStatic(false), _bIsEnabled(true) {
 }
 
@@ -200,6 +330,54 @@ AABB KinBody::Link::ComputeLocalAABB() const
     return AABB();
 }
 
+KinBody::Link::SphereTreeConstPtr KinBody::Link::GetSphereTree() const
+{
+    SphereTreeConstPtr spheretree = boost::atomic_load(&_spheretree);
+    const TriMesh& collision = GetCollisionData();
+    if( !!spheretree || collision.indices.size() < 3 ) {
+        return spheretree;
+    }
+    std::vector<uint8_t> vdata(sizeof(Vector)*collision.vertices.size() + sizeof(int)*collision.indices.size());
+    memcpy(&vdata[0], &collision.vertices[0], sizeof(Vector)*collision.vertices.size());
+    memcpy(&vdata[sizeof(Vector)*collision.vertices.size()], &collision.indices[0], sizeof(int)*collision.indices.size());
+    std::string hash = utils::GetMD5HashString(vdata);
+    {
+        boost::mutex::scoped_lock lock(s_mutexSphereTrees);
+        std::map<std::string, boost::weak_ptr<SphereTree const> >::iterator it = s_mapSphereTrees.find(hash);
+        if( it != s_mapSphereTrees.end() ) {
+            spheretree = it->second.lock();
+        }
+    }
+    if( !spheretree ) {
+        // building takes long, so do not hold the lock
+        boost::shared_ptr<SphereTree> newspheretree(new SphereTree());
+        newspheretree->Init(collision, s_nSphereTreeDepth);
+        boost::mutex::scoped_lock lock(s_mutexSphereTrees);
+        boost::weak_ptr<SphereTree const>& pweaktree = s_mapSphereTrees[hash];
+        spheretree = pweaktree.lock();
+        if( !spheretree ) {
+            // remove the trees that are not used anymore
+            std::map<std::string, boost::weak_ptr<SphereTree const> >::iterator itcur = s_mapSphereTrees.begin();
+            while(itcur != s_mapSphereTrees.end()) {
+                if( itcur->second.expired() && itcur->first != hash ) {
+                    s_mapSphereTrees.erase(itcur++);
+                }
+                else {
+                    ++itcur;
+                }
+            }
+            spheretree = newspheretree;
+            pweaktree = spheretree;
+        }
+    }
+    // another thread could have set the tree of this link in the meantime
+    SphereTreeConstPtr expected;
+    if( !boost::atomic_compare_exchange(&_spheretree, &expected, spheretree) ) {
+        return expected;
+    }
+    return spheretree;
+}
+
 AABB KinBody::Link::ComputeAABB() const
 {
     if( _vGeometries.size() == 1) {
@@ -341,31 +519,33 @@ void KinBody::Link::InitGeometries(std::list<KinBody::GeometryInfo>& geometries)
 
 void KinBody::Link::SetGeometriesFromGroup(const std::string& groupname)
 {
-    std::vector<KinBody::GeometryInfoPtr>* pvinfos = NULL;
+    const std::vector<KinBody::GeometryInfoPtr>* pvinfos = NULL;
+    boost::shared_ptr<std::vector<KinBody::GeometryInfoPtr> const> pspheregeometryinfos;
     if( groupname.size() == 0 ) {
         pvinfos = &_info._vgeometryinfos;
     }
     else {
-        std::map< std::string, std::vector<KinBody::GeometryInfoPtr> >::iterator it = _info._mapExtraGeometries.find(groupname);
-        if( it == _info._mapExtraGeometries.end() ) {
+        pvinfos = _FindGeometryGroup(groupname, pspheregeometryinfos);
+        if( !pvinfos ) {
             throw OPENRAVE_EXCEPTION_FORMAT("could not find geometries %s for link %s",groupname%GetName(),ORE_InvalidArguments);
         }
-        pvinfos = &it->second;
     }
     _vGeometries.resize(pvinfos->size());
     for(size_t i = 0; i < pvinfos->size(); ++i) {
         _vGeometries[i].reset(new Geometry(shared_from_this(),*pvinfos->at(i)));
     }
     _Update();
+    _RestoreSphereGeometryGroup(pspheregeometryinfos);
 }
 
 const std::vector<KinBody::GeometryInfoPtr>& KinBody::Link::GetGeometriesFromGroup(const std::string& groupname) const
 {
-    std::map< std::string, std::vector<KinBody::GeometryInfoPtr> >::const_iterator it = _info._mapExtraGeometries.find(groupname);
-    if( it == _info._mapExtraGeometries.end() ) {
+    boost::shared_ptr<std::vector<KinBody::GeometryInfoPtr> const> pspheregeometryinfos;
+    const std::vector<KinBody::GeometryInfoPtr>* pvinfos = _FindGeometryGroup(groupname, pspheregeometryinfos);
+    if( !pvinfos ) {
         throw OPENRAVE_EXCEPTION_FORMAT("geometry group %s does not exist for link %s", groupname%GetName(), ORE_InvalidArguments);
     }
-    return it->second;
+    return *pvinfos;
 }
 
 void KinBody::Link::SetGroupGeometries(const std::string& groupname, const std::vector<KinBody::GeometryInfoPtr>& geometries)
@@ -377,11 +557,12 @@ void KinBody::Link::SetGroupGeometries(const std::string& groupname, const std::
 
 int KinBody::Link::GetGroupNumGeometries(const std::string& groupname) const
 {
-    std::map< std::string, std::vector<KinBody::GeometryInfoPtr> >::const_iterator it = _info._mapExtraGeometries.find(groupname);
-    if( it == _info._mapExtraGeometries.end() ) {
+    boost::shared_ptr<std::vector<KinBody::GeometryInfoPtr> const> pspheregeometryinfos;
+    const std::vector<KinBody::GeometryInfoPtr>* pvinfos = _FindGeometryGroup(groupname, pspheregeometryinfos);
+    if( !pvinfos ) {
         return -1;
     }
-    return it->second.size();
+    return pvinfos->size();
 }
 
 void KinBody::Link::SwapGeometries(boost::shared_ptr<Link>& link)
@@ -469,17 +650,86 @@ void KinBody::Link::UpdateInfo()
     }
 }
 
-void KinBody::Link::_Update(bool parameterschanged)
+const std::vector<KinBody::GeometryInfoPtr>* KinBody::Link::_FindGeometryGroup(const std::string& groupname, boost::shared_ptr<std::vector<KinBody::GeometryInfoPtr> const>& pspheregeometryinfos) const
 {
-    // if there's only one trimesh geometry and it has identity offset, then copy it directly
-    if( _vGeometries.size() == 1 && _vGeometries.at(0)->GetType() == GT_TriMesh && TransformDistanceFast(Transform(), _vGeometries.at(0)->GetTransform()) <= g_fEpsilonLinear ) {
-        _collision = _vGeometries.at(0)->GetCollisionMesh();
+    std::map< std::string, std::vector<KinBody::GeometryInfoPtr> >::const_iterator it = _info._mapExtraGeometries.find(groupname);
+    if( it != _info._mapExtraGeometries.end() ) {
+        return &it->second;
     }
-    else {
-        _collision.vertices.resize(0);
-        _collision.indices.resize(0);
-        FOREACH(itgeom,_vGeometries) {
-            _collision.Append((*itgeom)->GetCollisionMesh(),(*itgeom)->GetTransform());
+    if( groupname != "spheres" ) {
+        return NULL;
+    }
+    pspheregeometryinfos = boost::atomic_load(&_pSphereGeometryInfos);
+    if( !!pspheregeometryinfos ) {
+        return pspheregeometryinfos.get();
+    }
+    SphereTreeConstPtr spheretree = GetSphereTree();
+    if( !spheretree ) {
+        return NULL;
+    }
+    boost::shared_ptr< std::vector<KinBody::GeometryInfoPtr> > vgeometries(new std::vector<KinBody::GeometryInfoPtr>());
+    vgeometries->reserve(spheretree->leaves.size());
+    FOREACHC(itleaf, spheretree->leaves) {
+        const Vector& vsphere = spheretree->spheres.at(*itleaf);
+        KinBody::GeometryInfoPtr pinfo(new KinBody::GeometryInfo());
+        pinfo->_type = GT_Sphere;
+        pinfo->_t.trans = Vector(vsphere.x, vsphere.y, vsphere.z);
+        pinfo->_vGeomData.x = vsphere.w;
+        pinfo->_bVisible = false;
+        pinfo->InitCollisionMesh();
+        vgeometries->push_back(pinfo);
+    }
+    // another thread could have generated the group in the meantime
+    pspheregeometryinfos = vgeometries;
+    boost::shared_ptr<std::vector<KinBody::GeometryInfoPtr> const> expected;
+    if( !boost::atomic_compare_exchange(&_pSphereGeometryInfos, &expected, pspheregeometryinfos) ) {
+        pspheregeometryinfos = expected;
+    }
+    return pspheregeometryinfos.get();
+}
+
+void KinBody::Link::_RestoreSphereGeometryGroup(boost::shared_ptr<std::vector<KinBody::GeometryInfoPtr> const> pspheregeometryinfos)
+{
+    if( !!pspheregeometryinfos ) {
+        // the link geometries are now the spheres of the group, so setting the group again should not approximate the spheres
+        boost::atomic_store(&_pSphereGeometryInfos, pspheregeometryinfos);
+    }
+}
+
+bool KinBody::Link::_ShareGeometryCollisionMesh()
+{
+    if( _vGeometries.size() == 1 && _vGeometries.at(0)->GetType() == GT_TriMesh && !!_vGeometries.at(0)->_info._psharedmeshcollision && TransformDistanceFast(Transform(), _vGeometries.at(0)->GetTransform()) <= g_fEpsilonLinear ) {
+        _psharedcollision = _vGeometries.at(0)->_info._psharedmeshcollision;
+        _collision = TriMesh();
+        return true;
+    }
+    _psharedcollision.reset();
+    return false;
+}
+
+void KinBody::Link::_UnshareCollisionData()
+{
+    if( !!_psharedcollision ) {
+        _collision = *_psharedcollision;
+        _psharedcollision.reset();
+    }
+}
+
+void KinBody::Link::_Update(bool parameterschanged)
+{
+    boost::atomic_store(&_spheretree, SphereTreeConstPtr());
+    boost::atomic_store(&_pSphereGeometryInfos, boost::shared_ptr<std::vector<KinBody::GeometryInfoPtr> const>());
+    // if there's only one trimesh geometry and it has identity offset, then share or copy it directly
+    if( !_ShareGeometryCollisionMesh() ) {
+        if( _vGeometries.size() == 1 && _vGeometries.at(0)->GetType() == GT_TriMesh && TransformDistanceFast(Transform(), _vGeometries.at(0)->GetTransform()) <= g_fEpsilonLinear ) {
+            _collision = _vGeometries.at(0)->GetCollisionMesh();
+        }
+        else {
+            _collision.vertices.resize(0);
+            _collision.indices.resize(0);
+            FOREACH(itgeom,_vGeometries) {
+                _collision.Append((*itgeom)->GetCollisionMesh(),(*itgeom)->GetTransform());
+            }
         }
     }
     if( parameterschanged ) {
@@ -391,10 +391,6 @@ public:
         }
 
         _nDebugLevel = level;
-        _pdatabase.reset(new RaveDatabase());
-        if( !_pdatabase->Init(bLoadAllPlugins) ) {
-            RAVELOG_FATAL("failed to create the openrave plugin database\n");
-        }
 
         char* phomedir = getenv("OPENRAVE_HOME"); // getenv not thread-safe?
         if( phomedir == NULL ) {
@@ -413,6 +409,11 @@ public:
         CreateDirectory(_homedirectory.c_str(),NULL);
 #endif
 
+        _pdatabase.reset(new RaveDatabase());
+        if( !_pdatabase->Init(bLoadAllPlugins, _homedirectory+s_filesep+string("plugins.index")) ) {
+            RAVELOG_FATAL("failed to create the openrave plugin database\n");
+        }
+
 #ifdef _WIN32
         const char* delim = ";";
 #else
@@ -438,11 +439,15 @@ public:
             boost::mutex::scoped_lock lock(_mutexinternal);
             mapenvironments = _mapenvironments;
         }
+        // acquire shared pointers to all environments first since destroying one environment can release others owned by its interfaces (ie cloned worker environments)
+        std::vector<EnvironmentBasePtr> venvironments; venvironments.reserve(mapenvironments.size());
         FOREACH(itenv,mapenvironments) {
-            // equire a shared pointer to prevent environment from getting deleted during Destroy loop
-            EnvironmentBasePtr penv = itenv->second->shared_from_this();
-            penv->Destroy();
+            venvironments.push_back(itenv->second->shared_from_this());
+        }
+        FOREACH(itenv,venvironments) {
+            (*itenv)->Destroy();
         }
+        venvironments.clear();
         mapenvironments.clear();
         _mapenvironments.clear();
         _pdefaultsampler.reset();
@@ -1768,8 +1773,8 @@ bool PhysicsEngineBase::GetLinkForceTorque(KinBody::LinkConstPtr plink, Vector&
 
 void TriMesh::ApplyTransform(const Transform& t)
 {
-    FOREACH(it, vertices) {
-        *it = t * *it;
+    if( vertices.size() > 0 ) {
+        geometry::transformPoints(t, &vertices[0], &vertices[0], vertices.size());
     }
 }
 
@@ -1796,8 +1801,8 @@ void TriMesh::Append(const TriMesh& mesh, const Transform& trans)
 {
     int offset = (int)vertices.size();
     vertices.resize(vertices.size() + mesh.vertices.size());
-    for(size_t i = 0; i < mesh.vertices.size(); ++i) {
-        vertices[i+offset] = trans * mesh.vertices[i];
+    if( mesh.vertices.size() > 0 ) {
+        geometry::transformPoints(trans, &mesh.vertices[0], &vertices[offset], mesh.vertices.size());
     }
     if( indices.capacity() < indices.size()+mesh.indices.size() ) {
         indices.reserve(indices.size()+mesh.indices.size());
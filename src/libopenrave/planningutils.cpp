@@ -18,6 +18,8 @@
 #include <boost/lexical_cast.hpp>
 #include <openrave/planningutils.h>
 #include <openrave/plannerparameters.h>
+#include <boost/thread/condition.hpp>
+#include <deque>
 
 //#include <boost/iostreams/device/file_descriptor.hpp>
 //#include <boost/iostreams/stream.hpp>
@@ -153,6 +155,424 @@ int JitterActiveDOF(RobotBasePtr robot,int nMaxIterations,dReal fRand,const Plan
     return 0;
 }
 
+ClonedEnvironmentPool::ClonedEnvironmentPool(RobotBasePtr probot, int numthreads) : _probot(probot), _ncheckeroptions(0)
+{
+    if( numthreads <= 0 ) {
+        _vrobots.push_back(_probot);
+        return;
+    }
+    _vclones.resize(numthreads);
+    _vrobots.resize(numthreads);
+    for(int i = 0; i < numthreads; ++i) {
+        _vclones[i] = _probot->GetEnv()->CloneSelf(Clone_Bodies);
+        // the simulation thread polls the environment lock and would compete with the worker holding it
+        _vclones[i]->StopSimulation();
+    }
+    _CloneAll();
+}
+
+ClonedEnvironmentPool::~ClonedEnvironmentPool()
+{
+    FOREACH(itclone, _vclones) {
+        (*itclone)->Destroy();
+    }
+}
+
+bool ClonedEnvironmentPool::Synchronize()
+{
+    if( _vclones.size() == 0 ) {
+        return false;
+    }
+    EnvironmentBasePtr penv = _probot->GetEnv();
+    CollisionCheckerBasePtr pchecker = penv->GetCollisionChecker();
+    if( (!!pchecker ? pchecker->GetXMLId() : std::string()) != _checkerid ) {
+        _CloneAll();
+        return true;
+    }
+    std::vector<KinBodyPtr> vbodies;
+    penv->GetBodies(vbodies);
+    if( vbodies.size() != _mapstamps.size() ) {
+        _CloneAll();
+        return true;
+    }
+    std::vector<KinBodyPtr> vchanged;
+    FOREACHC(itbody, vbodies) {
+        std::map<std::string, std::pair<int, int> >::const_iterator itstamp = _mapstamps.find((*itbody)->GetName());
+        if( itstamp == _mapstamps.end() || itstamp->second.first != (*itbody)->GetEnvironmentId() ) {
+            _CloneAll();
+            return true;
+        }
+        if( itstamp->second.second != (*itbody)->GetUpdateStamp() ) {
+            vchanged.push_back(*itbody);
+        }
+    }
+
+    // copy the state of the bodies that only moved or changed their enabled links, anything else needs a new clone
+    std::vector<Transform> vtransforms;
+    std::vector<dReal> vdoflastsetvalues;
+    std::vector<RobotBase::GrabbedInfoPtr> vgrabbedinfos, vclonegrabbedinfos;
+    FOREACHC(itclone, _vclones) {
+        FOREACHC(itbody, vchanged) {
+            KinBodyPtr pclonebody = (*itclone)->GetKinBody((*itbody)->GetName());
+            if( !pclonebody || pclonebody->GetKinematicsGeometryHash() != (*itbody)->GetKinematicsGeometryHash() ) {
+                _CloneAll();
+                return true;
+            }
+            if( (*itbody)->IsRobot() ) {
+                RaveInterfaceCast<RobotBase>(*itbody)->GetGrabbedInfo(vgrabbedinfos);
+                RaveInterfaceCast<RobotBase>(pclonebody)->GetGrabbedInfo(vclonegrabbedinfos);
+                bool bGrabbedChanged = vgrabbedinfos.size() != vclonegrabbedinfos.size();
+                for(size_t i = 0; i < vgrabbedinfos.size() && !bGrabbedChanged; ++i) {
+                    const RobotBase::GrabbedInfo& info = *vgrabbedinfos[i], &cloneinfo = *vclonegrabbedinfos[i];
+                    bGrabbedChanged = info._grabbedname != cloneinfo._grabbedname || info._robotlinkname != cloneinfo._robotlinkname || info._setRobotLinksToIgnore != cloneinfo._setRobotLinksToIgnore || TransformDistanceFast(info._trelative, cloneinfo._trelative) > g_fEpsilonLinear;
+                }
+                if( bGrabbedChanged ) {
+                    _CloneAll();
+                    return true;
+                }
+            }
+            (*itbody)->GetLinkTransformations(vtransforms, vdoflastsetvalues);
+            pclonebody->SetLinkTransformations(vtransforms, vdoflastsetvalues);
+            const std::vector<KinBody::LinkPtr>& vlinks = (*itbody)->GetLinks();
+            for(size_t ilink = 0; ilink < vlinks.size(); ++ilink) {
+                if( pclonebody->GetLinks()[ilink]->IsEnabled() != vlinks[ilink]->IsEnabled() ) {
+                    pclonebody->GetLinks()[ilink]->Enable(vlinks[ilink]->IsEnabled());
+                }
+            }
+        }
+    }
+    FOREACHC(itbody, vchanged) {
+        _mapstamps[(*itbody)->GetName()].second = (*itbody)->GetUpdateStamp();
+    }
+    _SynchronizeCheckerOptions();
+    return false;
+}
+
+void ClonedEnvironmentPool::SynchronizeActiveDOFs()
+{
+    FOREACH(itrobot, _vrobots) {
+        if( *itrobot != _probot && ((*itrobot)->GetActiveDOFIndices() != _probot->GetActiveDOFIndices() || (*itrobot)->GetAffineDOF() != _probot->GetAffineDOF()) ) {
+            (*itrobot)->SetActiveDOFs(_probot->GetActiveDOFIndices(), _probot->GetAffineDOF(), _probot->GetAffineRotationAxis());
+        }
+    }
+}
+
+void ClonedEnvironmentPool::Run(const boost::function<void(size_t)>& fn)
+{
+    boost::thread_group threads;
+    for(size_t i = 1; i < _vrobots.size(); ++i) {
+        threads.create_thread(boost::bind(&ClonedEnvironmentPool::_RunLocked, this, boost::cref(fn), i));
+    }
+    _RunLocked(fn, 0);
+    threads.join_all();
+}
+
+void ClonedEnvironmentPool::_RunLocked(const boost::function<void(size_t)>& fn, size_t index)
+{
+    if( _vclones.size() > 0 ) {
+        EnvironmentMutex::scoped_lock lockenv(_vclones.at(index)->GetMutex());
+        fn(index);
+    }
+    else {
+        fn(index);
+    }
+}
+
+void ClonedEnvironmentPool::_CloneAll()
+{
+    EnvironmentBasePtr penv = _probot->GetEnv();
+    for(size_t i = 0; i < _vclones.size(); ++i) {
+        // reuses the bodies whose kinematics and geometry did not change
+        _vclones[i]->Clone(penv, Clone_Bodies);
+        _vrobots[i] = _vclones[i]->GetRobot(_probot->GetName());
+        OPENRAVE_ASSERT_FORMAT(!!_vrobots[i], "failed to find robot %s in the cloned environment", _probot->GetName(), ORE_InvalidState);
+    }
+    CollisionCheckerBasePtr pchecker = penv->GetCollisionChecker();
+    _checkerid = !!pchecker ? pchecker->GetXMLId() : std::string();
+    _ncheckeroptions = !!pchecker ? pchecker->GetCollisionOptions() : 0;
+    _mapstamps.clear();
+    std::vector<KinBodyPtr> vbodies;
+    penv->GetBodies(vbodies);
+    FOREACHC(itbody, vbodies) {
+        _mapstamps[(*itbody)->GetName()] = std::make_pair((*itbody)->GetEnvironmentId(), (*itbody)->GetUpdateStamp());
+    }
+}
+
+void ClonedEnvironmentPool::_SynchronizeCheckerOptions()
+{
+    CollisionCheckerBasePtr pchecker = _probot->GetEnv()->GetCollisionChecker();
+    if( !!pchecker && pchecker->GetCollisionOptions() != _ncheckeroptions ) {
+        _ncheckeroptions = pchecker->GetCollisionOptions();
+        FOREACHC(itclone, _vclones) {
+            (*itclone)->GetCollisionChecker()->SetCollisionOptions(_ncheckeroptions);
+        }
+    }
+}
+
+class ActiveDOFBatchChecker::Worker
+{
+public:
+    std::vector<KinBodyPtr> _vbodies; ///< the bodies of ActiveDOFBatchChecker::_vreferenceinvtransforms in the environment of the worker
+    std::vector<dReal> _vvalues;
+};
+
+ActiveDOFBatchChecker::ActiveDOFBatchChecker(RobotBasePtr robot, int numthreads) : _probot(robot), _flinkdistthresh(0), _pvconfigs(NULL), _pvperturbations(NULL), _pvresults(NULL), _nextindex(0), _bestindex(0), _numpruned(0), _numchecked(0)
+{
+    _ppool.reset(new ClonedEnvironmentPool(_probot, numthreads));
+    _vworkers.resize(_ppool->GetNumWorkers());
+    FOREACH(itworker, _vworkers) {
+        *itworker = WorkerPtr(new Worker());
+    }
+}
+
+ActiveDOFBatchChecker::~ActiveDOFBatchChecker()
+{
+}
+
+void ActiveDOFBatchChecker::SynchronizeEnvironments()
+{
+    if( _ppool->Synchronize() ) {
+        FOREACH(itworker, _vworkers) {
+            (*itworker)->_vbodies.resize(0);
+        }
+    }
+}
+
+void ActiveDOFBatchChecker::SetLinkDistanceThreshold(dReal fthresh)
+{
+    _flinkdistthresh = fthresh;
+    _vreferenceinvtransforms.resize(0);
+    _vreferencespheres.resize(0);
+    FOREACH(itworker, _vworkers) {
+        (*itworker)->_vbodies.resize(0);
+    }
+    if( fthresh <= 0 ) {
+        return;
+    }
+    std::vector<KinBodyPtr> vbodies;
+    _probot->GetGrabbed(vbodies);
+    vbodies.insert(vbodies.begin(), _probot);
+    _vreferenceinvtransforms.resize(vbodies.size());
+    _vreferencespheres.resize(vbodies.size());
+    for(size_t ibody = 0; ibody < vbodies.size(); ++ibody) {
+        const std::vector<KinBody::LinkPtr>& vlinks = vbodies[ibody]->GetLinks();
+        _vreferenceinvtransforms[ibody].first = vbodies[ibody]->GetName();
+        _vreferenceinvtransforms[ibody].second.resize(vlinks.size());
+        _vreferencespheres[ibody].resize(vlinks.size());
+        for(size_t ilink = 0; ilink < vlinks.size(); ++ilink) {
+            _vreferenceinvtransforms[ibody].second[ilink] = vlinks[ilink]->GetTransform().inverse();
+            // build the sphere trees here since the workers would build the same shared trees concurrently
+            KinBody::Link::SphereTreeConstPtr pspheretree = vlinks[ilink]->GetSphereTree();
+            if( !!pspheretree && pspheretree->spheres.size() > 0 ) {
+                _vreferencespheres[ibody][ilink] = pspheretree->spheres[0];
+            }
+            else {
+                _vreferencespheres[ibody][ilink] = Vector(0,0,0,0);
+            }
+        }
+    }
+}
+
+int ActiveDOFBatchChecker::CheckBatch(const std::vector< std::vector<dReal> >& vconfigs, const std::vector<dReal>& vperturbations, std::vector<int>* pvresults)
+{
+    if( !!pvresults ) {
+        pvresults->resize(0);
+        pvresults->resize(vconfigs.size(), 0);
+    }
+    if( vconfigs.size() == 0 ) {
+        return -1;
+    }
+    uint64_t starttime = utils::GetNanoPerformanceTime();
+    _pvconfigs = &vconfigs;
+    _pvperturbations = &vperturbations;
+    _pvresults = pvresults;
+    _nextindex = 0;
+    _bestindex = vconfigs.size();
+    _numpruned = 0;
+    _numchecked = 0;
+    {
+        boost::shared_ptr<KinBody::KinBodyStateSaver> saver;
+        if( !_ppool->IsCloned() ) {
+            saver.reset(new KinBody::KinBodyStateSaver(_probot, KinBody::Save_LinkTransformation));
+        }
+        _ppool->SynchronizeActiveDOFs();
+        _ppool->Run(boost::bind(&ActiveDOFBatchChecker::_CheckConfigurations, this, _1));
+    }
+    _pvconfigs = NULL;
+    _pvperturbations = NULL;
+    _pvresults = NULL;
+
+    _statistics.numrounds += 1;
+    _statistics.numcandidates += vconfigs.size();
+    _statistics.numpruned += _numpruned;
+    _statistics.numchecked += _numchecked;
+    _statistics.fcheckduration += 1e-9*(utils::GetNanoPerformanceTime() - starttime);
+    return _bestindex < vconfigs.size() ? (int)_bestindex : -1;
+}
+
+void ActiveDOFBatchChecker::_CheckConfigurations(size_t iworker)
+{
+    WorkerPtr worker = _vworkers.at(iworker);
+    RobotBasePtr probot = _ppool->GetRobot(iworker);
+    EnvironmentBasePtr penv = probot->GetEnv();
+    if( worker->_vbodies.size() != _vreferenceinvtransforms.size() ) {
+        worker->_vbodies.resize(_vreferenceinvtransforms.size());
+        for(size_t ibody = 0; ibody < _vreferenceinvtransforms.size(); ++ibody) {
+            worker->_vbodies[ibody] = penv->GetKinBody(_vreferenceinvtransforms[ibody].first);
+            if( !!worker->_vbodies[ibody] && worker->_vbodies[ibody]->GetLinks().size() != _vreferenceinvtransforms[ibody].second.size() ) {
+                worker->_vbodies[ibody].reset();
+            }
+        }
+    }
+
+    int numpruned = 0, numchecked = 0;
+    while(1) {
+        size_t index;
+        {
+            boost::mutex::scoped_lock lock(_mutex);
+            if( _nextindex >= _bestindex ) {
+                break;
+            }
+            index = _nextindex++;
+        }
+        const std::vector<dReal>& vconfig = _pvconfigs->at(index);
+        bool bCollision = false;
+        try {
+            probot->SetActiveDOFValues(vconfig, KinBody::CLA_CheckLimitsSilent);
+            if( _flinkdistthresh > 0 ) {
+                // any point of the link sphere moves at most the distance of its center plus the radius times the chord of the rotation angle
+                bool bPruned = false;
+                for(size_t ibody = 0; ibody < worker->_vbodies.size() && !bPruned; ++ibody) {
+                    if( !worker->_vbodies[ibody] ) {
+                        continue;
+                    }
+                    const std::vector<KinBody::LinkPtr>& vlinks = worker->_vbodies[ibody]->GetLinks();
+                    for(size_t ilink = 0; ilink < vlinks.size(); ++ilink) {
+                        Transform trel = _vreferenceinvtransforms[ibody].second[ilink] * vlinks[ilink]->GetTransform();
+                        const Vector& sphere = _vreferencespheres[ibody][ilink];
+                        Vector vcenter(sphere.x, sphere.y, sphere.z);
+                        dReal fchord = 2*RaveSqrt(trel.rot.y*trel.rot.y + trel.rot.z*trel.rot.z + trel.rot.w*trel.rot.w);
+                        if( RaveSqrt((trel*vcenter - vcenter).lengthsqr3()) + sphere.w*fchord > _flinkdistthresh ) {
+                            bPruned = true;
+                            break;
+                        }
+                    }
+                }
+                if( bPruned ) {
+                    ++numpruned;
+                    if( !!_pvresults ) {
+                        _pvresults->at(index) = -2;
+                    }
+                    continue;
+                }
+            }
+            ++numchecked;
+            if( _pvperturbations->size() == 0 ) {
+                bCollision = penv->CheckCollision(KinBodyConstPtr(probot)) || probot->CheckSelfCollision();
+            }
+            FOREACHC(itperturbation, *_pvperturbations) {
+                worker->_vvalues.resize(vconfig.size());
+                for(size_t j = 0; j < vconfig.size(); ++j) {
+                    worker->_vvalues[j] = vconfig[j] + *itperturbation;
+                }
+                probot->SetActiveDOFValues(worker->_vvalues, KinBody::CLA_CheckLimitsSilent);
+                if( penv->CheckCollision(KinBodyConstPtr(probot)) || probot->CheckSelfCollision() ) {
+                    bCollision = true;
+                    break;
+                }
+            }
+        }
+        catch(const std::exception& ex) {
+            RAVELOG_WARN_FORMAT("failed to check jittered configuration %d: %s", index%ex.what());
+            bCollision = true;
+        }
+        if( !!_pvresults ) {
+            _pvresults->at(index) = bCollision ? -1 : 1;
+        }
+        if( !bCollision ) {
+            boost::mutex::scoped_lock lock(_mutex);
+            if( index < _bestindex ) {
+                _bestindex = index;
+            }
+        }
+    }
+
+    boost::mutex::scoped_lock lock(_mutex);
+    _numpruned += numpruned;
+    _numchecked += numchecked;
+}
+
+int JitterActiveDOFBatch(RobotBasePtr robot, int nMaxIterations, dReal fRand, int nBatchSize, int nThreads, dReal fLinkDistThresh, JitterStatistics* pstatistics)
+{
+    RAVELOG_VERBOSE("starting batched jitter active dof...\n");
+    uint64_t starttime = utils::GetNanoPerformanceTime();
+    vector<dReal> curdof, vweights;
+    robot->GetActiveDOFValues(curdof);
+    robot->GetActiveDOFWeights(vweights);
+
+    // have to test with perturbations since very small changes in angles can produce collision inconsistencies
+    std::vector<dReal> vperturbations(3,0);
+    vperturbations[1] = 1e-5f;
+    vperturbations[2] = -1e-5f;
+
+    std::vector< std::vector<dReal> > vconfigs(1,curdof);
+    {
+        // checking the current configuration on the robot itself does not need any clones
+        ActiveDOFBatchChecker currentchecker(robot, 0);
+        if( currentchecker.CheckBatch(vconfigs, vperturbations) == 0 || fRand <= 0 ) {
+            return -1;
+        }
+    }
+
+    ActiveDOFBatchChecker checker(robot, nThreads);
+    checker.SetLinkDistanceThreshold(fLinkDistThresh);
+    nBatchSize = max(1, nBatchSize);
+    // small rounds would take too long to reach the full jitter
+    const int nMaxIterRadiusThresh = min(nMaxIterations/2, 8*nBatchSize);
+    std::vector< std::vector<dReal> > vsamples;
+    std::vector< std::pair<dReal, int> > vdistindices;
+    int ret = 0;
+    for(int iter = 0; iter < nMaxIterations; ) {
+        int num = min(nBatchSize, nMaxIterations-iter);
+        vsamples.resize(num);
+        vdistindices.resize(num);
+        for(int i = 0; i < num; ++i, ++iter) {
+            // ramp of the jitter as iterations increase
+            dReal fjitter = fRand;
+            if( iter < nMaxIterRadiusThresh ) {
+                // the last round below the threshold can go over it when it is not a multiple of the batch size
+                fjitter = min(fRand, fRand*dReal(iter/nBatchSize+1)*nBatchSize/dReal(nMaxIterRadiusThresh));
+            }
+            dReal fdist = 0;
+            vsamples[i].resize(curdof.size());
+            for(size_t j = 0; j < curdof.size(); ++j) {
+                dReal fdelta = fjitter * (RaveRandomFloat()-0.5f);
+                vsamples[i][j] = curdof[j] + fdelta;
+                fdist += vweights.at(j)*fdelta*fdelta;
+            }
+            vdistindices[i] = make_pair(fdist, i);
+        }
+        std::sort(vdistindices.begin(), vdistindices.end());
+        vconfigs.resize(num);
+        for(int i = 0; i < num; ++i) {
+            vconfigs[i] = vsamples[vdistindices[i].second];
+        }
+        int index = checker.CheckBatch(vconfigs, vperturbations);
+        if( index >= 0 ) {
+            robot->SetActiveDOFValues(vconfigs[index], KinBody::CLA_CheckLimitsSilent);
+            ret = 1;
+            break;
+        }
+    }
+
+    const JitterStatistics& statistics = checker.GetStatistics();
+    RAVELOG_DEBUG_FORMAT("batched jitter %s, rounds=%d, pruned=%d, checked=%d (%f/s), computation=%fs", (ret ? "succeeded" : "failed")%statistics.numrounds%statistics.numpruned%statistics.numchecked%(statistics.fcheckduration > 0 ? statistics.numchecked/statistics.fcheckduration : 0)%(1e-9*(utils::GetNanoPerformanceTime() - starttime)));
+    if( !!pstatistics ) {
+        *pstatistics = statistics;
+    }
+    return ret;
+}
+
 bool JitterTransform(KinBodyPtr pbody, float fJitter, int nMaxIterations)
 {
     RAVELOG_VERBOSE("starting jitter transform...\n");
@@ -543,29 +963,689 @@ public:
         }
     }
 
-    string DumpTrajectory(TrajectoryBaseConstPtr trajectory)
-    {
-        string filename = str(boost::format("%s/failedtrajectory%d.xml")%RaveGetHomeDirectory()%(RaveRandomInt()%1000));
-        ofstream f(filename.c_str());
-        f << std::setprecision(std::numeric_limits<dReal>::digits10+1);     /// have to do this or otherwise precision gets lost
-        trajectory->serialize(f);
-        return filename;
+    string DumpTrajectory(TrajectoryBaseConstPtr trajectory)
+    {
+        string filename = str(boost::format("%s/failedtrajectory%d.xml")%RaveGetHomeDirectory()%(RaveRandomInt()%1000));
+        ofstream f(filename.c_str());
+        f << std::setprecision(std::numeric_limits<dReal>::digits10+1);     /// have to do this or otherwise precision gets lost
+        trajectory->serialize(f);
+        return filename;
+    }
+
+protected:
+    PlannerBase::PlannerParametersConstPtr _parameters;
+};
+
+void VerifyTrajectory(PlannerBase::PlannerParametersConstPtr parameters, TrajectoryBaseConstPtr trajectory, dReal samplingstep)
+{
+    EnvironmentMutex::scoped_lock lockenv(trajectory->GetEnv()->GetMutex());
+    if( !parameters ) {
+        PlannerBase::PlannerParametersPtr newparams(new PlannerBase::PlannerParameters());
+        newparams->SetConfigurationSpecification(trajectory->GetEnv(), trajectory->GetConfigurationSpecification().GetTimeDerivativeSpecification(0));
+        parameters = newparams;
+    }
+    TrajectoryVerifier v(parameters);
+    v.VerifyTrajectory(trajectory,samplingstep);
+}
+
+class ActiveDOFTrajectoryVerifier::Worker
+{
+public:
+    RobotBasePtr _probot; ///< the robot in the environment of the worker
+    TrajectoryBaseConstPtr _ptraj; ///< the trajectory being verified, a clone if the worker has its own environment since sampling is not multi-thread safe
+    TrajectoryBasePtr _ptrajclone;
+    std::vector<KinBodyPtr> _vbodies; ///< the bodies of ActiveDOFTrajectoryVerifier::_vmovingbodynames in the environment of the worker
+    std::vector<dReal> _vvalues;
+    std::vector< boost::array<dReal,4> > _vintervals; ///< the stack of intervals to refine: start time, start clearance, end time, end clearance
+    std::vector< std::pair<int, int> > _vnodepairs; ///< the stack of the sphere tree distance query
+};
+
+static const int s_nFineSphereTreeDepth = 8;
+
+/// \brief link pairs that cannot be certified for this many sampling steps at some grid point are checked on their own at every step
+static const dReal s_fTightPairSteps = 8;
+
+/// \brief returns a lower bound of the distance between two links from the leaves of their sphere trees, at most fmaxdist
+static dReal _ComputeSphereTreeDistance(const KinBody::Link::SphereTree& tree0, const Transform& t0, const KinBody::Link::SphereTree& tree1, const Transform& t1, dReal fmaxdist, std::vector< std::pair<int, int> >& vnodepairs)
+{
+    dReal fdist = fmaxdist;
+    vnodepairs.resize(0);
+    vnodepairs.push_back(std::make_pair(0, 0));
+    while(vnodepairs.size() > 0) {
+        std::pair<int, int> nodepair = vnodepairs.back();
+        vnodepairs.pop_back();
+        const Vector& sphere0 = tree0.spheres[nodepair.first];
+        const Vector& sphere1 = tree1.spheres[nodepair.second];
+        Vector vdelta = t0*Vector(sphere0.x, sphere0.y, sphere0.z) - t1*Vector(sphere1.x, sphere1.y, sphere1.z);
+        dReal fnodedist = RaveSqrt(vdelta.lengthsqr3()) - sphere0.w - sphere1.w;
+        if( fnodedist >= fdist ) {
+            continue;
+        }
+        bool bleaf0 = tree0.children[nodepair.first].first < 0, bleaf1 = tree1.children[nodepair.second].first < 0;
+        if( bleaf0 && bleaf1 ) {
+            if( fnodedist <= 0 ) {
+                return 0;
+            }
+            fdist = fnodedist;
+        }
+        else if( bleaf1 || (!bleaf0 && sphere0.w >= sphere1.w) ) {
+            // descend into the larger sphere
+            vnodepairs.push_back(std::make_pair(tree0.children[nodepair.first].first, nodepair.second));
+            vnodepairs.push_back(std::make_pair(tree0.children[nodepair.first].second, nodepair.second));
+        }
+        else {
+            vnodepairs.push_back(std::make_pair(nodepair.first, tree1.children[nodepair.second].first));
+            vnodepairs.push_back(std::make_pair(nodepair.first, tree1.children[nodepair.second].second));
+        }
+    }
+    return fdist;
+}
+
+ActiveDOFTrajectoryVerifier::ActiveDOFTrajectoryVerifier(RobotBasePtr robot, int numthreads) : _probot(robot), _fcoarsestep(0.1), _fsamplingstep(0.002), _cachesize(64), _bclearance(false), _nextindex(0), _collisionindex(0), _fcollisiontime(0), _numchecked(0), _numcertified(0), _numtightchecked(0)
+{
+    _ppool.reset(new ClonedEnvironmentPool(_probot, numthreads));
+    _vworkers.resize(_ppool->GetNumWorkers());
+    FOREACH(itworker, _vworkers) {
+        *itworker = WorkerPtr(new Worker());
+    }
+}
+
+ActiveDOFTrajectoryVerifier::~ActiveDOFTrajectoryVerifier()
+{
+}
+
+void ActiveDOFTrajectoryVerifier::SetSamplingSteps(dReal fcoarsestep, dReal fsamplingstep)
+{
+    OPENRAVE_ASSERT_OP(fsamplingstep,>,0);
+    _fcoarsestep = max(fcoarsestep, fsamplingstep);
+    _fsamplingstep = fsamplingstep;
+}
+
+void ActiveDOFTrajectoryVerifier::SetCacheSize(size_t cachesize)
+{
+    _cachesize = cachesize;
+    if( _mapverdicts.size() > _cachesize ) {
+        _mapverdicts.clear();
+    }
+}
+
+void ActiveDOFTrajectoryVerifier::SynchronizeEnvironments()
+{
+    _ppool->Synchronize();
+}
+
+std::string ActiveDOFTrajectoryVerifier::_GetEnvironmentHash() const
+{
+    EnvironmentBasePtr penv = _probot->GetEnv();
+    std::stringstream ss;
+    CollisionCheckerBasePtr pchecker = penv->GetCollisionChecker();
+    if( !!pchecker ) {
+        ss << pchecker->GetXMLId() << " " << pchecker->GetCollisionOptions() << " ";
+    }
+    std::vector<KinBodyPtr> vbodies;
+    penv->GetBodies(vbodies);
+    FOREACHC(itbody, vbodies) {
+        // the update stamps of the robot and its grabbed bodies change when checking moves and restores them
+        int stamp = (*itbody)->GetUpdateStamp();
+        std::map<int, std::pair<int, int> >::const_iterator itstamp = _mapmovingstamps.find((*itbody)->GetEnvironmentId());
+        if( itstamp != _mapmovingstamps.end() && itstamp->second.first == stamp ) {
+            stamp = itstamp->second.second;
+        }
+        ss << (*itbody)->GetEnvironmentId() << " " << stamp << " ";
+        FOREACHC(itlink, (*itbody)->GetLinks()) {
+            ss << (*itlink)->IsEnabled();
+        }
+        ss << " ";
+    }
+    return utils::GetMD5HashString(ss.str());
+}
+
+std::string ActiveDOFTrajectoryVerifier::_GetTrajectoryHash(TrajectoryBaseConstPtr trajectory) const
+{
+    std::stringstream ss; ss << std::setprecision(std::numeric_limits<dReal>::digits10+1);
+    ss << trajectory->GetConfigurationSpecification() << _probot->GetActiveConfigurationSpecification() << " " << _fcoarsestep << " " << _fsamplingstep;
+    std::vector<dReal> vdata;
+    trajectory->GetWaypoints(0, trajectory->GetNumWaypoints(), vdata);
+    std::string s = ss.str();
+    if( vdata.size() > 0 ) {
+        s.append(reinterpret_cast<const char*>(&vdata[0]), vdata.size()*sizeof(dReal));
+    }
+    return utils::GetMD5HashString(s);
+}
+
+/** \brief returns an upper bound on the speed of a sphere attached to link1 with respect to link0
+
+    The joints of the chain between the links are visited from link1, accumulating the distances between consecutive joint anchors,
+    which are fixed in the link between the joints. So every sum bounds the distance from the anchor to the sphere in any configuration,
+    and a revolute joint moves the sphere at most that distance times its speed.
+    \param vdofspeeds the maximum speeds of the active dofs
+ */
+static dReal _ComputeRelativeSpeedBound(RobotBasePtr probot, const std::vector<dReal>& vdofspeeds, int linkindex0, int linkindex1, const Vector& sphere1, std::vector<KinBody::JointPtr>& vchain)
+{
+    if( linkindex0 == linkindex1 || !probot->GetChain(linkindex0, linkindex1, vchain) ) {
+        return 0;
+    }
+    const std::vector<int>& vactiveindices = probot->GetActiveDOFIndices();
+    dReal fspeed = 0, fdist = sphere1.w;
+    Vector vprev(sphere1.x, sphere1.y, sphere1.z);
+    for(int ichain = (int)vchain.size()-1; ichain >= 0; --ichain) {
+        KinBody::JointPtr pjoint = vchain[ichain];
+        Vector vanchor = pjoint->GetAnchor();
+        fdist += RaveSqrt((vanchor - vprev).lengthsqr3());
+        vprev = vanchor;
+        if( pjoint->GetDOFIndex() < 0 ) {
+            continue;
+        }
+        for(int idof = 0; idof < pjoint->GetDOF(); ++idof) {
+            std::vector<int>::const_iterator itactive = find(vactiveindices.begin(), vactiveindices.end(), pjoint->GetDOFIndex()+idof);
+            if( itactive == vactiveindices.end() ) {
+                continue;
+            }
+            dReal fdofspeed = vdofspeeds.at(itactive - vactiveindices.begin());
+            if( pjoint->IsRevolute(idof) ) {
+                fspeed += fdofspeed*fdist;
+            }
+            else {
+                // the translation moves the sphere directly and changes the distances to the anchors before it
+                fspeed += fdofspeed;
+                std::vector<dReal> vlower, vupper;
+                pjoint->GetLimits(vlower, vupper);
+                fdist += vupper.at(idof) - vlower.at(idof);
+            }
+        }
+    }
+    return fspeed;
+}
+
+bool ActiveDOFTrajectoryVerifier::_InitClearance(TrajectoryBaseConstPtr trajectory)
+{
+    _vmovingbodynames.resize(0);
+    _vmovingtrees.resize(0);
+    _vmovingspeeds.resize(0);
+    _vobstacles.resize(0);
+    _vselfpairs.resize(0);
+    _vselfpairspeeds.resize(0);
+    if( _probot->GetAffineDOF() != 0 ) {
+        return false;
+    }
+    // the speed of a mimic joint driven by the active dofs is not bounded by their speeds
+    const std::vector<int>& vactiveindices = _probot->GetActiveDOFIndices();
+    std::vector<int> vmimicdofs;
+    for(int ijointset = 0; ijointset < 2; ++ijointset) {
+        const std::vector<KinBody::JointPtr>& vjoints = ijointset == 0 ? _probot->GetJoints() : _probot->GetPassiveJoints();
+        FOREACHC(itjoint, vjoints) {
+            for(int idof = 0; idof < (*itjoint)->GetDOF(); ++idof) {
+                if( (*itjoint)->IsMimic(idof) ) {
+                    (*itjoint)->GetMimicDOFIndices(vmimicdofs, idof);
+                    FOREACHC(itdof, vmimicdofs) {
+                        if( find(vactiveindices.begin(), vactiveindices.end(), *itdof) != vactiveindices.end() ) {
+                            return false;
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    // the speed of a dof along linear and quadratic segments is bounded by the speeds at the waypoints and the average speeds between them.
+    // other interpolations can overshoot between the waypoints, so their speed has no bound that can be computed here.
+    std::vector<dReal> vdofspeeds, vdata;
+    std::vector<ConfigurationSpecification::Group>::const_iterator itgroup = trajectory->GetConfigurationSpecification().FindCompatibleGroup(_activespec._vgroups.at(0), false);
+    if( itgroup == trajectory->GetConfigurationSpecification()._vgroups.end() ) {
+        return false;
+    }
+    if( itgroup->interpolation != "linear" && itgroup->interpolation != "quadratic" ) {
+        RAVELOG_DEBUG_FORMAT("interpolation %s does not bound the dof speeds, refining every segment", itgroup->interpolation);
+        return false;
+    }
+    ConfigurationSpecification spec = _activespec + _activespec.ConvertToVelocitySpecification();
+    int timeoffset = spec.AddDeltaTimeGroup();
+    int dof = _activespec.GetDOF(), stride = spec.GetDOF();
+    trajectory->GetWaypoints(0, trajectory->GetNumWaypoints(), vdata, spec);
+    vdofspeeds.resize(dof, 0);
+    for(size_t ipoint = 0; ipoint*stride < vdata.size(); ++ipoint) {
+        std::vector<dReal>::const_iterator itpoint = vdata.begin() + ipoint*stride;
+        for(int j = 0; j < dof; ++j) {
+            dReal fspeed = RaveFabs(itpoint[dof+j]);
+            if( ipoint > 0 && itpoint[timeoffset] > 0 ) {
+                fspeed = max(fspeed, RaveFabs(itpoint[j] - itpoint[j-stride])/itpoint[timeoffset]);
+            }
+            else if( ipoint > 0 && RaveFabs(itpoint[j] - itpoint[j-stride]) > g_fEpsilonLinear ) {
+                RAVELOG_DEBUG_FORMAT("dof %d jumps at waypoint %d, refining every segment", j%ipoint);
+                return false;
+            }
+            vdofspeeds[j] = max(vdofspeeds[j], fspeed);
+        }
+    }
+
+    // the sphere trees are retrieved here since the workers would build the same shared trees concurrently
+    std::vector<KinBodyPtr> vgrabbed, vbodies;
+    _probot->GetGrabbed(vgrabbed);
+    vgrabbed.insert(vgrabbed.begin(), _probot);
+    std::vector<int> vgrabbinglinks(vgrabbed.size(), -1);
+    _vmovingbodynames.resize(vgrabbed.size());
+    _vmovingtrees.resize(vgrabbed.size());
+    _vmovingspeeds.resize(vgrabbed.size());
+    std::vector< std::vector<Vector> > vrootspheres(vgrabbed.size());
+    std::vector<KinBody::JointPtr> vchain;
+    // only keep the fine trees of the links that are still moving
+    std::map<KinBody::Link::SphereTree const*, std::pair<KinBody::Link::SphereTreeConstPtr, KinBody::Link::SphereTreeConstPtr> > mapfinetrees;
+    int baselinkindex = _probot->GetLinks().at(0)->GetIndex();
+    for(size_t ibody = 0; ibody < vgrabbed.size(); ++ibody) {
+        const std::vector<KinBody::LinkPtr>& vlinks = vgrabbed[ibody]->GetLinks();
+        if( ibody > 0 ) {
+            KinBody::LinkPtr pgrabbinglink = _probot->IsGrabbing(vgrabbed[ibody]);
+            if( !!pgrabbinglink ) {
+                vgrabbinglinks[ibody] = pgrabbinglink->GetIndex();
+            }
+        }
+        _vmovingbodynames[ibody] = vgrabbed[ibody]->GetName();
+        _vmovingtrees[ibody].resize(vlinks.size());
+        _vmovingspeeds[ibody].resize(vlinks.size(), 0);
+        vrootspheres[ibody].resize(vlinks.size(), Vector(0,0,0,0));
+        for(size_t ilink = 0; ilink < vlinks.size(); ++ilink) {
+            if( !vlinks[ilink]->IsEnabled() || (ibody > 0 && vgrabbinglinks[ibody] < 0) ) {
+                continue;
+            }
+            // the shared trees are too coarse for links that are close to each other, like the links of a wrist.
+            // the shared tree of a link is replaced whenever its collision mesh changes, so it identifies the fine tree.
+            KinBody::Link::SphereTreeConstPtr psharedtree = vlinks[ilink]->GetSphereTree();
+            if( !psharedtree || psharedtree->spheres.size() == 0 ) {
+                continue;
+            }
+            std::pair<KinBody::Link::SphereTreeConstPtr, KinBody::Link::SphereTreeConstPtr>& finetree = mapfinetrees[psharedtree.get()];
+            if( !finetree.second ) {
+                std::map<KinBody::Link::SphereTree const*, std::pair<KinBody::Link::SphereTreeConstPtr, KinBody::Link::SphereTreeConstPtr> >::const_iterator itfinetree = _mapfinetrees.find(psharedtree.get());
+                if( itfinetree != _mapfinetrees.end() ) {
+                    finetree = itfinetree->second;
+                }
+                else {
+                    boost::shared_ptr<KinBody::Link::SphereTree> pspheretree(new KinBody::Link::SphereTree());
+                    pspheretree->Init(vlinks[ilink]->GetCollisionData(), s_nFineSphereTreeDepth);
+                    finetree = std::make_pair(psharedtree, KinBody::Link::SphereTreeConstPtr(pspheretree));
+                }
+            }
+            KinBody::Link::SphereTreeConstPtr pspheretree = finetree.second;
+            _vmovingtrees[ibody][ilink] = pspheretree;
+            const Vector& sphere = pspheretree->spheres[0];
+            Vector vcenter = vlinks[ilink]->GetTransform() * Vector(sphere.x, sphere.y, sphere.z);
+            vrootspheres[ibody][ilink] = Vector(vcenter.x, vcenter.y, vcenter.z, sphere.w);
+            // the base of the robot does not move, and the grabbed bodies move with their grabbing link
+            _vmovingspeeds[ibody][ilink] = _ComputeRelativeSpeedBound(_probot, vdofspeeds, baselinkindex, ibody > 0 ? vgrabbinglinks[ibody] : (int)ilink, vrootspheres[ibody][ilink], vchain);
+        }
+    }
+    _mapfinetrees.swap(mapfinetrees);
+    _probot->GetEnv()->GetBodies(vbodies);
+    FOREACHC(itbody, vbodies) {
+        if( find(vgrabbed.begin(), vgrabbed.end(), *itbody) != vgrabbed.end() || !(*itbody)->IsEnabled() ) {
+            continue;
+        }
+        FOREACHC(itlink, (*itbody)->GetLinks()) {
+            if( (*itlink)->IsEnabled() ) {
+                KinBody::Link::SphereTreeConstPtr pspheretree = (*itlink)->GetSphereTree();
+                if( !!pspheretree && pspheretree->spheres.size() > 0 ) {
+                    _vobstacles.push_back(std::make_pair((*itlink)->GetTransform(), pspheretree));
+                }
+            }
+        }
+    }
+
+    // self collisions can only appear between links with an active dof between them. Either link can be considered fixed, so the smaller bound is used.
+    std::vector< boost::array<int,4> > vcandidatepairs;
+    const std::set<int>& setnonadjacent = _probot->GetNonAdjacentLinks(KinBody::AO_Enabled|KinBody::AO_ActiveDOFs);
+    FOREACHC(itpair, setnonadjacent) {
+        boost::array<int,4> selfpair = { { 0, *itpair & 0xffff, 0, (*itpair >> 16) & 0xffff}};
+        vcandidatepairs.push_back(selfpair);
+    }
+    for(size_t ibody = 1; ibody < vgrabbed.size(); ++ibody) {
+        for(size_t ilink = 0; ilink < _vmovingtrees[0].size(); ++ilink) {
+            if( (int)ilink != vgrabbinglinks[ibody] ) {
+                for(size_t igrabbedlink = 0; igrabbedlink < _vmovingtrees[ibody].size(); ++igrabbedlink) {
+                    boost::array<int,4> selfpair = { { (int)ibody, (int)igrabbedlink, 0, (int)ilink}};
+                    vcandidatepairs.push_back(selfpair);
+                }
+            }
+        }
+    }
+    FOREACHC(itpair, vcandidatepairs) {
+        const boost::array<int,4>& selfpair = *itpair;
+        if( !_vmovingtrees[selfpair[0]][selfpair[1]] || !_vmovingtrees[selfpair[2]][selfpair[3]] ) {
+            continue;
+        }
+        int linkindex0 = selfpair[0] > 0 ? vgrabbinglinks[selfpair[0]] : selfpair[1];
+        int linkindex1 = selfpair[2] > 0 ? vgrabbinglinks[selfpair[2]] : selfpair[3];
+        dReal fspeed0 = _ComputeRelativeSpeedBound(_probot, vdofspeeds, linkindex1, linkindex0, vrootspheres[selfpair[0]][selfpair[1]], vchain);
+        dReal fspeed1 = _ComputeRelativeSpeedBound(_probot, vdofspeeds, linkindex0, linkindex1, vrootspheres[selfpair[2]][selfpair[3]], vchain);
+        if( min(fspeed0, fspeed1) > 0 ) {
+            _vselfpairs.push_back(selfpair);
+            _vselfpairspeeds.push_back(min(fspeed0, fspeed1));
+        }
+    }
+    return true;
+}
+
+bool ActiveDOFTrajectoryVerifier::Verify(TrajectoryBaseConstPtr trajectory, dReal* ptimecollision)
+{
+    uint64_t starttime = utils::GetNanoPerformanceTime();
+    _statistics.numverified += 1;
+    std::string hash;
+    if( _cachesize > 0 ) {
+        hash = _GetTrajectoryHash(trajectory) + _GetEnvironmentHash();
+        std::map<std::string, std::pair<bool, dReal> >::const_iterator itverdict = _mapverdicts.find(hash);
+        if( itverdict != _mapverdicts.end() ) {
+            _statistics.numcachehits += 1;
+            _statistics.fverifyduration += 1e-9*(utils::GetNanoPerformanceTime() - starttime);
+            if( !itverdict->second.first && !!ptimecollision ) {
+                *ptimecollision = itverdict->second.second;
+            }
+            return itverdict->second.first;
+        }
+    }
+    _ppool->Synchronize();
+    _ppool->SynchronizeActiveDOFs();
+
+    _activespec = _probot->GetActiveConfigurationSpecification();
+    _bclearance = _InitClearance(trajectory);
+    dReal fduration = trajectory->GetDuration();
+    size_t numsegments = fduration > 0 ? (size_t)RaveCeil(fduration/_fcoarsestep) : 0;
+    _vgridtimes.resize(numsegments+1);
+    for(size_t i = 0; i <= numsegments; ++i) {
+        _vgridtimes[i] = numsegments > 0 ? fduration*dReal(i)/dReal(numsegments) : 0;
+    }
+    _vgridclearances.resize(0);
+    _vgridclearances.resize(_vgridtimes.size(), 0);
+    _vgridpairclearances.resize(0);
+    _vgridpairclearances.resize(_vgridtimes.size()*_vselfpairs.size(), _fcoarsestep);
+    _vtightpairs.resize(0);
+    _collisionindex = _vgridtimes.size();
+    _fcollisiontime = 0;
+    _numchecked = 0;
+    _numcertified = 0;
+    _numtightchecked = 0;
+
+    for(size_t iworker = 0; iworker < _vworkers.size(); ++iworker) {
+        WorkerPtr worker = _vworkers[iworker];
+        worker->_probot = _ppool->GetRobot(iworker);
+        if( worker->_probot != _probot ) {
+            if( !worker->_ptrajclone || worker->_ptrajclone->GetXMLId() != trajectory->GetXMLId() || worker->_ptrajclone->GetEnv() != worker->_probot->GetEnv() ) {
+                worker->_ptrajclone = RaveCreateTrajectory(worker->_probot->GetEnv(), trajectory->GetXMLId());
+            }
+            worker->_ptrajclone->Clone(trajectory, 0);
+            worker->_ptraj = worker->_ptrajclone;
+        }
+        else {
+            worker->_ptraj = trajectory;
+        }
+        worker->_vbodies.resize(_vmovingbodynames.size());
+        for(size_t ibody = 0; ibody < _vmovingbodynames.size(); ++ibody) {
+            worker->_vbodies[ibody] = worker->_probot->GetEnv()->GetKinBody(_vmovingbodynames[ibody]);
+            OPENRAVE_ASSERT_FORMAT(!!worker->_vbodies[ibody] && worker->_vbodies[ibody]->GetLinks().size() == _vmovingtrees[ibody].size(), "body %s of the worker does not match", _vmovingbodynames[ibody], ORE_InvalidState);
+        }
+    }
+
+    std::vector<KinBodyPtr> vmovingbodies;
+    _probot->GetGrabbed(vmovingbodies);
+    vmovingbodies.push_back(_probot);
+    std::vector<std::pair<int, int> > vmovingstamps(vmovingbodies.size());
+    for(size_t ibody = 0; ibody < vmovingbodies.size(); ++ibody) {
+        int stamp = vmovingbodies[ibody]->GetUpdateStamp();
+        std::map<int, std::pair<int, int> >::const_iterator itstamp = _mapmovingstamps.find(vmovingbodies[ibody]->GetEnvironmentId());
+        vmovingstamps[ibody] = std::make_pair(vmovingbodies[ibody]->GetEnvironmentId(), itstamp != _mapmovingstamps.end() && itstamp->second.first == stamp ? itstamp->second.second : stamp);
+    }
+    {
+        boost::shared_ptr<KinBody::KinBodyStateSaver> saver;
+        if( !_ppool->IsCloned() ) {
+            saver.reset(new KinBody::KinBodyStateSaver(_probot, KinBody::Save_LinkTransformation));
+        }
+        _nextindex = 0;
+        _ppool->Run(boost::bind(&ActiveDOFTrajectoryVerifier::_CheckGrid, this, _1));
+        _CertifyGrid();
+        _nextindex = 0;
+        _ppool->Run(boost::bind(&ActiveDOFTrajectoryVerifier::_RefineSegments, this, _1));
+    }
+    FOREACH(itworker, _vworkers) {
+        (*itworker)->_ptraj.reset();
+    }
+    // checking restores the moving bodies, so their new stamps stand for the stamps before checking
+    _mapmovingstamps.clear();
+    for(size_t ibody = 0; ibody < vmovingbodies.size(); ++ibody) {
+        _mapmovingstamps[vmovingstamps[ibody].first] = std::make_pair(vmovingbodies[ibody]->GetUpdateStamp(), vmovingstamps[ibody].second);
+    }
+
+    bool bSuccess = _collisionindex >= _vgridtimes.size();
+    if( !bSuccess && !!ptimecollision ) {
+        *ptimecollision = _fcollisiontime;
+    }
+    if( _cachesize > 0 ) {
+        if( _mapverdicts.size() >= _cachesize ) {
+            _mapverdicts.clear();
+        }
+        _mapverdicts[hash] = make_pair(bSuccess, _fcollisiontime);
+    }
+    _statistics.numchecked += _numchecked;
+    _statistics.numcertified += _numcertified;
+    _statistics.numtightchecked += _numtightchecked;
+    _statistics.fverifyduration += 1e-9*(utils::GetNanoPerformanceTime() - starttime);
+    RAVELOG_VERBOSE_FORMAT("verified trajectory of %fs: %s, checked=%d, certified=%d, tightchecked=%d, clearance=%d", fduration%(bSuccess ? "free" : "collision")%_numchecked%_numcertified%_numtightchecked%_bclearance);
+    return bSuccess;
+}
+
+void ActiveDOFTrajectoryVerifier::_CheckGrid(size_t iworker)
+{
+    WorkerPtr worker = _vworkers.at(iworker);
+    int numchecked = 0;
+    while(1) {
+        size_t index;
+        {
+            boost::mutex::scoped_lock lock(_mutex);
+            if( _nextindex >= _collisionindex ) {
+                break;
+            }
+            index = _nextindex++;
+        }
+        dReal fclearance = 0;
+        bool bCollision = false;
+        try {
+            ++numchecked;
+            // every index is written by one worker only and read after all workers finished
+            bCollision = _CheckConfiguration(worker, _vgridtimes[index], fclearance, _vselfpairs.size() > 0 ? &_vgridpairclearances[index*_vselfpairs.size()] : NULL);
+        }
+        catch(const std::exception& ex) {
+            RAVELOG_WARN_FORMAT("failed to check trajectory at %fs: %s", _vgridtimes[index]%ex.what());
+            bCollision = true;
+        }
+        if( bCollision ) {
+            _SetCollision(index, _vgridtimes[index]);
+        }
+        else {
+            _vgridclearances[index] = fclearance;
+        }
+    }
+
+    boost::mutex::scoped_lock lock(_mutex);
+    _numchecked += numchecked;
+}
+
+void ActiveDOFTrajectoryVerifier::_CertifyGrid()
+{
+    if( !_bclearance ) {
+        return;
+    }
+    // a pair that stays too close to certify more than a few sampling steps would force the refinement down to the sampling
+    // step, so it is checked on its own at every step and the other pairs certify the intervals. Pairs with grabbed bodies
+    // are never tight since the links the robot ignores when grabbing are not known here.
+    _vtightpairs.resize(_vselfpairs.size(), 0);
+    for(size_t ipair = 0; ipair < _vselfpairs.size(); ++ipair) {
+        if( _vselfpairs[ipair][0] != 0 || _vselfpairs[ipair][2] != 0 ) {
+            continue;
+        }
+        for(size_t index = 0; index < _vgridtimes.size() && index < _collisionindex; ++index) {
+            if( _vgridpairclearances[index*_vselfpairs.size()+ipair] < s_fTightPairSteps*_fsamplingstep ) {
+                _vtightpairs[ipair] = 1;
+                break;
+            }
+        }
+    }
+    for(size_t index = 0; index < _vgridtimes.size() && index < _collisionindex; ++index) {
+        for(size_t ipair = 0; ipair < _vselfpairs.size(); ++ipair) {
+            if( !_vtightpairs[ipair] ) {
+                _vgridclearances[index] = min(_vgridclearances[index], _vgridpairclearances[index*_vselfpairs.size()+ipair]);
+            }
+        }
+    }
+}
+
+void ActiveDOFTrajectoryVerifier::_RefineSegments(size_t iworker)
+{
+    WorkerPtr worker = _vworkers.at(iworker);
+    bool bHasTightPairs = find(_vtightpairs.begin(), _vtightpairs.end(), 1) != _vtightpairs.end();
+    int numchecked = 0, numcertified = 0, numtightchecked = 0;
+    while(1) {
+        size_t index;
+        {
+            boost::mutex::scoped_lock lock(_mutex);
+            // segment index starts at grid point index, so a collision at a grid point only leaves the segments before it
+            if( _nextindex+1 >= _vgridtimes.size() || _nextindex >= _collisionindex ) {
+                break;
+            }
+            index = _nextindex++;
+        }
+        boost::array<dReal,4> interval = { { _vgridtimes[index], _vgridclearances[index], _vgridtimes[index+1], _vgridclearances[index+1]}};
+        worker->_vintervals.resize(0);
+        worker->_vintervals.push_back(interval);
+        dReal fsegmentend = _vgridtimes[index+1];
+        try {
+            while(worker->_vintervals.size() > 0) {
+                interval = worker->_vintervals.back();
+                worker->_vintervals.pop_back();
+                dReal fdelta = interval[2] - interval[0];
+                if( fdelta <= interval[1] + interval[3] ) {
+                    // every configuration of the interval is closer in time to one of the ends than its clearance
+                    ++numcertified;
+                    continue;
+                }
+                if( fdelta <= _fsamplingstep ) {
+                    continue;
+                }
+                dReal fmidtime = 0.5*(interval[0] + interval[2]), fclearance = 0;
+                ++numchecked;
+                if( _CheckConfiguration(worker, fmidtime, fclearance, NULL) ) {
+                    // the remaining intervals are after the collision, so only the left half is refined to find an earlier one
+                    _SetCollision(index, fmidtime);
+                    fsegmentend = fmidtime;
+                    worker->_vintervals.resize(0);
+                    interval[2] = fmidtime;
+                    interval[3] = 0;
+                    worker->_vintervals.push_back(interval);
+                    continue;
+                }
+                // the left half is refined first so that the first collision found is the earliest
+                boost::array<dReal,4> right = { { fmidtime, fclearance, interval[2], interval[3]}};
+                worker->_vintervals.push_back(right);
+                interval[2] = fmidtime;
+                interval[3] = fclearance;
+                worker->_vintervals.push_back(interval);
+            }
+            if( bHasTightPairs ) {
+                // the grid points are fully checked, so only the sampling steps strictly inside the segment are left
+                for(dReal ftime = (floor(_vgridtimes[index]/_fsamplingstep)+1)*_fsamplingstep; ftime < fsegmentend; ftime += _fsamplingstep) {
+                    ++numtightchecked;
+                    if( _CheckTightPairs(worker, ftime) ) {
+                        _SetCollision(index, ftime);
+                        break;
+                    }
+                }
+            }
+        }
+        catch(const std::exception& ex) {
+            RAVELOG_WARN_FORMAT("failed to check trajectory segment %d: %s", index%ex.what());
+            _SetCollision(index, _vgridtimes[index]);
+        }
+    }
+
+    boost::mutex::scoped_lock lock(_mutex);
+    _numchecked += numchecked;
+    _numcertified += numcertified;
+    _numtightchecked += numtightchecked;
+}
+
+bool ActiveDOFTrajectoryVerifier::_CheckConfiguration(WorkerPtr worker, dReal ftime, dReal& ftimeclearance, dReal* ppairclearances)
+{
+    RobotBasePtr probot = worker->_probot;
+    ftimeclearance = 0;
+    worker->_ptraj->Sample(worker->_vvalues, ftime, _activespec);
+    probot->SetActiveDOFValues(worker->_vvalues, KinBody::CLA_CheckLimitsSilent);
+    if( probot->GetEnv()->CheckCollision(KinBodyConstPtr(probot)) || probot->CheckSelfCollision() ) {
+        return true;
+    }
+    if( !_bclearance ) {
+        return false;
     }
 
-protected:
-    PlannerBase::PlannerParametersConstPtr _parameters;
-};
+    // clearances beyond the coarse step do not certify more
+    ftimeclearance = _fcoarsestep;
+    for(size_t ibody = 0; ibody < worker->_vbodies.size() && ftimeclearance > 0; ++ibody) {
+        const std::vector<KinBody::LinkPtr>& vlinks = worker->_vbodies[ibody]->GetLinks();
+        for(size_t ilink = 0; ilink < vlinks.size() && ftimeclearance > 0; ++ilink) {
+            dReal fspeed = _vmovingspeeds[ibody][ilink];
+            const KinBody::Link::SphereTreeConstPtr& pspheretree = _vmovingtrees[ibody][ilink];
+            if( fspeed <= 0 || !pspheretree || pspheretree->spheres.size() == 0 ) {
+                continue;
+            }
+            Transform tlink = vlinks[ilink]->GetTransform();
+            FOREACHC(itobstacle, _vobstacles) {
+                dReal fdist = _ComputeSphereTreeDistance(*pspheretree, tlink, *itobstacle->second, itobstacle->first, fspeed*ftimeclearance, worker->_vnodepairs);
+                ftimeclearance = min(ftimeclearance, fdist/fspeed);
+                if( ftimeclearance <= 0 ) {
+                    break;
+                }
+            }
+        }
+    }
+    // on the grid, every pair gets its own clearance so that the tight pairs can be found
+    for(size_t ipair = 0; ipair < _vselfpairs.size() && (!!ppairclearances || ftimeclearance > 0); ++ipair) {
+        if( !ppairclearances && _vtightpairs.size() > 0 && _vtightpairs[ipair] ) {
+            continue;
+        }
+        const boost::array<int,4>& selfpair = _vselfpairs[ipair];
+        dReal fspeed = _vselfpairspeeds[ipair];
+        dReal fmaxclearance = !!ppairclearances ? _fcoarsestep : ftimeclearance;
+        const KinBody::Link::SphereTree& spheretree0 = *_vmovingtrees[selfpair[0]][selfpair[1]];
+        const KinBody::Link::SphereTree& spheretree1 = *_vmovingtrees[selfpair[2]][selfpair[3]];
+        Transform tlink0 = worker->_vbodies[selfpair[0]]->GetLinks()[selfpair[1]]->GetTransform();
+        Transform tlink1 = worker->_vbodies[selfpair[2]]->GetLinks()[selfpair[3]]->GetTransform();
+        dReal fdist = _ComputeSphereTreeDistance(spheretree0, tlink0, spheretree1, tlink1, fspeed*fmaxclearance, worker->_vnodepairs);
+        if( !!ppairclearances ) {
+            ppairclearances[ipair] = min(fmaxclearance, fdist/fspeed);
+        }
+        else {
+            ftimeclearance = min(ftimeclearance, fdist/fspeed);
+        }
+    }
+    return false;
+}
 
-void VerifyTrajectory(PlannerBase::PlannerParametersConstPtr parameters, TrajectoryBaseConstPtr trajectory, dReal samplingstep)
+bool ActiveDOFTrajectoryVerifier::_CheckTightPairs(WorkerPtr worker, dReal ftime)
 {
-    EnvironmentMutex::scoped_lock lockenv(trajectory->GetEnv()->GetMutex());
-    if( !parameters ) {
-        PlannerBase::PlannerParametersPtr newparams(new PlannerBase::PlannerParameters());
-        newparams->SetConfigurationSpecification(trajectory->GetEnv(), trajectory->GetConfigurationSpecification().GetTimeDerivativeSpecification(0));
-        parameters = newparams;
+    RobotBasePtr probot = worker->_probot;
+    worker->_ptraj->Sample(worker->_vvalues, ftime, _activespec);
+    probot->SetActiveDOFValues(worker->_vvalues, KinBody::CLA_CheckLimitsSilent);
+    const std::vector<KinBody::LinkPtr>& vlinks = probot->GetLinks();
+    for(size_t ipair = 0; ipair < _vselfpairs.size(); ++ipair) {
+        if( _vtightpairs[ipair] && probot->GetEnv()->CheckCollision(KinBody::LinkConstPtr(vlinks.at(_vselfpairs[ipair][1])), KinBody::LinkConstPtr(vlinks.at(_vselfpairs[ipair][3]))) ) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void ActiveDOFTrajectoryVerifier::_SetCollision(size_t index, dReal ftime)
+{
+    boost::mutex::scoped_lock lock(_mutex);
+    if( index < _collisionindex || (index == _collisionindex && ftime < _fcollisiontime) ) {
+        _collisionindex = index;
+        _fcollisiontime = ftime;
     }
-    TrajectoryVerifier v(parameters);
-    v.VerifyTrajectory(trajectory,samplingstep);
 }
 
 PlannerStatus _PlanActiveDOFTrajectory(TrajectoryBasePtr traj, RobotBasePtr probot, bool hastimestamps, dReal fmaxvelmult, dReal fmaxaccelmult, const std::string& plannername, bool bsmooth, const std::string& plannerparameters)
@@ -1944,7 +3024,7 @@ void GetDHParameters(std::vector<DHParameter>& vparameters, KinBodyConstPtr pbod
     }
 }
 
-DynamicsCollisionConstraint::DynamicsCollisionConstraint(PlannerBase::PlannerParametersPtr parameters, const std::list<KinBodyPtr>& listCheckBodies, int filtermask) : _listCheckBodies(listCheckBodies), _filtermask(filtermask), _perturbation(0.1)
+DynamicsCollisionConstraint::DynamicsCollisionConstraint(PlannerBase::PlannerParametersPtr parameters, const std::list<KinBodyPtr>& listCheckBodies, int filtermask) : _listCheckBodies(listCheckBodies), _filtermask(filtermask), _perturbation(0.1), _fContinuousTolerance(0)
 {
     BOOST_ASSERT(listCheckBodies.size()>0);
     _report.reset(new CollisionReport());
@@ -1979,6 +3059,12 @@ void DynamicsCollisionConstraint::SetPerturbation(dReal perturbation)
     _perturbation = perturbation;
 }
 
+void DynamicsCollisionConstraint::SetContinuousCollisionTolerance(dReal tolerance)
+{
+    OPENRAVE_ASSERT_OP(tolerance,>=,0);
+    _fContinuousTolerance = tolerance;
+}
+
 int DynamicsCollisionConstraint::_SetAndCheckState(PlannerBase::PlannerParametersPtr params, const std::vector<dReal>& vdofvalues, const std::vector<dReal>& vdofvelocities, const std::vector<dReal>& vdofaccels, int options, ConstraintFilterReturnPtr filterreturn)
 {
     if( params->SetStateValues(vdofvalues, 0) != 0 ) {
@@ -2052,8 +3138,11 @@ int DynamicsCollisionConstraint::_CheckState(const std::vector<dReal>& vdofaccel
                 // have to extract the correct accelerations from vdofaccels use specvel and timederivative=1
                 _specvel.ExtractJointValues(_dofaccelerations.begin(), vdofaccels.begin(), pbody, _vdofindices, 1);
 
-                // compute inverse dynamics and check
-                pbody->ComputeInverseDynamics(_doftorques, _dofaccelerations);
+                // compute inverse dynamics and check. the batch version does not set the body state, but it still reads the current link
+                // velocities from the physics engine and allocates its scratch on every call
+                pbody->GetDOFValues(_dofvalues);
+                pbody->GetDOFVelocities(_dofvelocities);
+                pbody->ComputeInverseDynamicsBatch(_doftorques, _dofvalues, _dofvelocities, _dofaccelerations);
                 FOREACH(it, _vtorquevalues) {
                     int index = it->first;
                     dReal fmaxtorque = it->second;
@@ -2240,6 +3329,21 @@ int DynamicsCollisionConstraint::Check(const std::vector<dReal>& q0, const std::
         return 0;
     }
 
+    if( _fContinuousTolerance > 0 && (maskoptions & CFO_CheckEnvCollisions) && numSteps > 1 && !(options & CFO_FillCheckedConfiguration) && !(timeelapsed > 0 && dq0.size() == _vtempconfig.size() && dq1.size() == _vtempconfig.size()) ) {
+        // check the environment collisions of the whole line at once and only discretize for the remaining constraints.
+        // the discretization checks the steps from start to numSteps-1 and the end only if bCheckEnd, so leave out the same ends.
+        int ncontinuousret = _CheckContinuousCollision(params, q0, q1, dReal(start)/numSteps, bCheckEnd ? dReal(1) : dReal(numSteps-1)/numSteps, maskoptions, filterreturn);
+        if( ncontinuousret > 0 ) {
+            return ncontinuousret;
+        }
+        else if( ncontinuousret == 0 ) {
+            maskoptions &= ~CFO_CheckEnvCollisions;
+            if( !(maskoptions & (CFO_CheckSelfCollisions|CFO_CheckTimeBasedConstraints|CFO_CheckUserConstraints)) ) {
+                return 0;
+            }
+        }
+    }
+
     if( !!filterreturn && (options & CFO_FillCheckedConfiguration) ) {
         if( (int)filterreturn->_configurations.capacity() < (1+numSteps)*params->GetDOF() ) {
             filterreturn->_configurations.reserve((1+numSteps)*params->GetDOF());
@@ -2391,6 +3495,89 @@ int DynamicsCollisionConstraint::Check(const std::vector<dReal>& q0, const std::
     return 0;
 }
 
+int DynamicsCollisionConstraint::_CheckContinuousCollision(PlannerBase::PlannerParametersPtr params, const std::vector<dReal>& q0, const std::vector<dReal>& q1, dReal fstart, dReal fend, int options, ConstraintFilterReturnPtr filterreturn)
+{
+    if( _listCheckBodies.size() != 1 || (options & CFO_CheckWithPerturbation) ) {
+        return -1;
+    }
+    KinBodyPtr pbody = _listCheckBodies.front();
+    CollisionCheckerBasePtr pchecker = pbody->GetEnv()->GetCollisionChecker();
+    if( !pchecker || pbody->GetDOF() == 0 ) {
+        return -1;
+    }
+
+    // the states set here are only used to compare the planner motion with the dof motion, so restore the body afterwards
+    KinBody::KinBodyStateSaver saver(pbody, KinBody::Save_LinkTransformation);
+
+    // the checker moves the dof values linearly, so make sure the planner does the same by looking at the end and middle
+    // states. This rejects affine motions and neighbor functions that project on constraints.
+    if( params->SetStateValues(q0, 0) != 0 ) {
+        return -1;
+    }
+    Transform t0 = pbody->GetTransform();
+    pbody->GetDOFValues(_vcontinuousvalues0);
+    _vtempconfig = q0;
+    _vcontinuousdelta = dQ;
+    FOREACH(it, _vcontinuousdelta) {
+        *it *= 0.5;
+    }
+    if( !params->_neighstatefn(_vtempconfig, _vcontinuousdelta, 0) || params->SetStateValues(_vtempconfig, 0) != 0 ) {
+        return -1;
+    }
+    Transform tmid = pbody->GetTransform();
+    pbody->GetDOFValues(_vcontinuousvaluesmid);
+    if( params->SetStateValues(q1, 0) != 0 ) {
+        return -1;
+    }
+    Transform t1 = pbody->GetTransform();
+    pbody->GetDOFValues(_vcontinuousvalues1);
+    if( TransformDistanceFast(t0, tmid) > g_fEpsilonLinear || TransformDistanceFast(t0, t1) > g_fEpsilonLinear ) {
+        return -1;
+    }
+    _vcontinuousdelta = _vcontinuousvalues1;
+    pbody->SubtractDOFValues(_vcontinuousdelta, _vcontinuousvalues0);
+    pbody->SubtractDOFValues(_vcontinuousvaluesmid, _vcontinuousvalues0);
+    for(size_t i = 0; i < _vcontinuousdelta.size(); ++i) {
+        if( RaveFabs(_vcontinuousvaluesmid[i] - 0.5*_vcontinuousdelta[i]) > g_fEpsilonLinear ) {
+            return -1;
+        }
+    }
+
+    // only check the part of the line from fstart to fend
+    _vcontinuousvalues1 = _vcontinuousvalues0;
+    for(size_t i = 0; i < _vcontinuousdelta.size(); ++i) {
+        _vcontinuousvalues0[i] += fstart*_vcontinuousdelta[i];
+        _vcontinuousvalues1[i] += fend*_vcontinuousdelta[i];
+    }
+
+    dReal fcollisiontime = 0;
+    int ret = pchecker->CheckContinuousCollision(pbody, _vcontinuousvalues0, _vcontinuousvalues1, _fContinuousTolerance, fcollisiontime, _report);
+    if( ret < 0 ) {
+        return -1;
+    }
+    else if( ret == 0 ) {
+        return 0;
+    }
+    fcollisiontime = fstart + fcollisiontime*(fend-fstart);
+
+    for(size_t i = 0; i < q0.size(); ++i) {
+        _vtempconfig[i] = q0[i] + fcollisiontime*dQ.at(i);
+    }
+    if( !!filterreturn ) {
+        filterreturn->_returncode = CFO_CheckEnvCollisions;
+        filterreturn->_invalidvalues = _vtempconfig;
+        filterreturn->_fTimeWhenInvalid = fcollisiontime;
+        if( options & CFO_FillCollisionReport ) {
+            filterreturn->_report = *_report;
+        }
+    }
+    if( IS_DEBUGLEVEL(Level_Verbose) ) {
+        params->SetStateValues(_vtempconfig, 0);
+        _PrintOnFailure(std::string("continuous collision failed ")+_report->__str__());
+    }
+    return CFO_CheckEnvCollisions;
+}
+
 SimpleDistanceMetric::SimpleDistanceMetric(RobotBasePtr robot) : _robot(robot)
 {
     _robot->GetActiveDOFWeights(weights2);
@@ -2442,6 +3629,445 @@ bool SimpleNeighborhoodSampler::Sample(std::vector<dReal>& samples)
     return samples.size()>0;
 }
 
+/// \brief jitters the end effector of ikparam out of collision and checks that an ik solution exists there
+///
+/// Tries offsets along the axes first and then random offsets growing up to fjittermaxdist.
+/// \param[inout] ikparam set to the jittered parameterization if successful
+/// \return true if a collision-free parameterization with an ik solution was found
+static bool _JitterEndEffector(RobotBase::ManipulatorConstPtr pmanip, IkParameterization& ikparam, dReal fjittermaxdist, int numRedundantSamplesForEEChecking, int ikfilteroptions, SpaceSamplerBasePtr psampler, CollisionReportPtr report, IkReturnPtr& ikreturnjittered)
+{
+    bool bcollision=true;
+    // randomly add small offset to the ik until it stops being in collision
+    Transform tjitter;
+    // before random sampling, first try sampling along the axes. try order z,y,x since z is most likely gravity
+    int N = 4;
+    dReal delta = fjittermaxdist/N;
+    for(int iaxis = 2; iaxis >= 0; --iaxis) {
+        tjitter.trans = Vector();
+        for(int iiter = 0; iiter < 2*N; ++iiter) {
+            tjitter.trans[iaxis] = fjittermaxdist*delta*(1+iiter/2);
+            if( iiter & 1 ) {
+                // revert sign
+                tjitter.trans[iaxis] = -tjitter.trans[iaxis];
+            }
+            IkParameterization ikparamjittered = tjitter * ikparam;
+            try {
+                if( !pmanip->CheckEndEffectorCollision(ikparamjittered,report, numRedundantSamplesForEEChecking) ) {
+                    // make sure at least one ik solution exists...
+                    if( !ikreturnjittered ) {
+                        ikreturnjittered.reset(new IkReturn(IKRA_Success));
+                    }
+                    bool biksuccess = pmanip->FindIKSolution(ikparamjittered, ikfilteroptions, ikreturnjittered);
+                    if( biksuccess ) {
+                        ikparam = ikparamjittered;
+                        bcollision = false;
+                        break;
+                    }
+                    else {
+                        RAVELOG_VERBOSE_FORMAT("jitter succeed position, but ik failed: 0x%.8x", ikreturnjittered->_action);
+                    }
+                }
+            }
+            catch(const std::exception& ex) {
+                // ignore most likely ik failed in CheckEndEffectorCollision
+            }
+        }
+        if( !bcollision ) {
+            break;
+        }
+    }
+
+    if( bcollision ) {
+        // try random samples, most likely will fail...
+        int nMaxIterations = 100;
+        std::vector<dReal> xyzsamples(3);
+        dReal delta = (fjittermaxdist*2)/nMaxIterations;
+        for(int iiter = 1; iiter <= nMaxIterations; ++iiter) {
+            psampler->SampleSequence(xyzsamples,3,IT_Closed);
+            tjitter.trans = Vector(xyzsamples[0]-0.5f, xyzsamples[1]-0.5f, xyzsamples[2]-0.5f) * (delta*iiter);
+            IkParameterization ikparamjittered = tjitter * ikparam;
+            try {
+                if( !pmanip->CheckEndEffectorCollision(ikparamjittered, report, numRedundantSamplesForEEChecking) ) {
+                    if( !ikreturnjittered ) {
+                        ikreturnjittered.reset(new IkReturn(IKRA_Success));
+                    }
+                    bool biksuccess = pmanip->FindIKSolution(ikparamjittered, ikfilteroptions, ikreturnjittered);
+                    if( biksuccess ) {
+                        ikparam = ikparamjittered;
+                        bcollision = false;
+                        break;
+                    }
+                    else {
+                        RAVELOG_VERBOSE_FORMAT("jitter succed position, but ik failed: 0x%.8x", ikreturnjittered->_action);
+                    }
+                }
+            }
+            catch(const std::exception& ex) {
+                // ignore most likely ik failed in CheckEndEffectorCollision
+            }
+        }
+    }
+    return !bcollision;
+}
+
+/// \brief returns the position the end effector has to reach for ikparam, false if the type has no position
+static bool _GetIkParameterizationPosition(const IkParameterization& ikparam, Vector& vposition)
+{
+    switch(ikparam.GetType()) {
+    case IKP_Transform6D:
+        vposition = ikparam.GetTransform6D().trans;
+        return true;
+    case IKP_Translation3D:
+        vposition = ikparam.GetTranslation3D();
+        return true;
+    case IKP_TranslationDirection5D:
+        vposition = ikparam.GetTranslationDirection5D().pos;
+        return true;
+    default:
+        return false;
+    }
+}
+
+/// \brief returns an upper bound of the distance the end effector can be from vbase, -1 if the arm has no bound
+///
+/// Sums the distances between the anchors of the joints along the chain of the arm, which is only a bound if all the
+/// moving joints are revolute.
+static dReal _ComputeArmReach(RobotBase::ManipulatorConstPtr pmanip, Vector& vbase)
+{
+    RobotBasePtr probot = pmanip->GetRobot();
+    std::vector<KinBody::JointPtr> vjoints;
+    if( !probot->GetChain(pmanip->GetBase()->GetIndex(), pmanip->GetEndEffector()->GetIndex(), vjoints) ) {
+        return -1;
+    }
+    dReal freach = 0;
+    bool bmoving = false;
+    Vector vprev;
+    FOREACHC(itjoint, vjoints) {
+        if( (*itjoint)->IsStatic() ) {
+            continue;
+        }
+        if( (*itjoint)->GetDOF() != 1 || !(*itjoint)->IsRevolute(0) ) {
+            return -1;
+        }
+        Vector vanchor = (*itjoint)->GetAnchor();
+        if( !bmoving ) {
+            vbase = vanchor;
+            bmoving = true;
+        }
+        else {
+            freach += RaveSqrt((vanchor-vprev).lengthsqr3());
+        }
+        vprev = vanchor;
+    }
+    if( !bmoving ) {
+        return -1;
+    }
+    return freach + RaveSqrt((pmanip->GetTransform().trans-vprev).lengthsqr3());
+}
+
+class ManipulatorIKGoalSampler::ParallelSampler
+{
+public:
+    struct Candidate
+    {
+        IkParameterization _ikparam;
+        int _orgindex;
+        int _numleft;
+        dReal _fscore; ///< distance to the end effector pose when the candidates were ordered
+        SpaceSamplerBasePtr _psampler; ///< samples the free parameters
+        bool operator<(const Candidate& r) const {
+            return _fscore < r._fscore;
+        }
+    };
+
+    ParallelSampler(ManipulatorIKGoalSampler& sampler, int numthreads, int maxready) : _maxready(max(1,maxready)), _numworking(0), _numliveworkers(0), _numevaluated(0), _bStop(false)
+    {
+        RobotBase::ManipulatorConstPtr pmanip = sampler._pmanip;
+        _robotname = sampler._probot->GetName();
+        _manipname = pmanip->GetName();
+        _nummaxsamples = sampler._nummaxsamples;
+        _ikfilteroptions = sampler._ikfilteroptions;
+        _searchfreeparameters = sampler._searchfreeparameters;
+        _fjittermaxdist = sampler._fjittermaxdist;
+
+        // drop the parameterizations that the arm cannot reach and order the rest by how far the end effector has to move
+        Vector vbase, vposition;
+        dReal freach = _ComputeArmReach(pmanip, vbase);
+        _vcandidates.reserve(sampler._listsamples.size());
+        FOREACHC(itsample, sampler._listsamples) {
+            if( freach > 0 && _GetIkParameterizationPosition(itsample->_ikparam, vposition) ) {
+                dReal fdist = RaveSqrt((vposition-vbase).lengthsqr3());
+                if( fdist > freach*1.01+0.001 ) {
+                    RAVELOG_VERBOSE_FORMAT("ik parameterization %d is %f away from the arm base, reach is %f", itsample->_orgindex%fdist%freach);
+                    continue;
+                }
+            }
+            Candidate candidate;
+            candidate._ikparam = itsample->_ikparam;
+            candidate._orgindex = itsample->_orgindex;
+            candidate._numleft = itsample->_numleft;
+            candidate._fscore = 0;
+            try {
+                candidate._fscore = itsample->_ikparam.ComputeDistanceSqr(pmanip->GetIkParameterization(itsample->_ikparam));
+            }
+            catch(const std::exception& ex) {
+                RAVELOG_VERBOSE_FORMAT("failed to compute the end effector parameterization: %s", ex.what());
+            }
+            _vcandidates.push_back(candidate);
+        }
+        std::stable_sort(_vcandidates.begin(), _vcandidates.end());
+        for(size_t i = 0; i < _vcandidates.size(); ++i) {
+            _queuecandidates.push_back(i);
+        }
+
+        EnvironmentBasePtr penv = sampler._probot->GetEnv();
+        IkSolverBasePtr piksolver = pmanip->GetIkSolver();
+        OPENRAVE_ASSERT_FORMAT(!!piksolver, "manipulator %s:%s does not have an ik solver", _robotname%_manipname, ORE_InvalidArguments);
+        std::vector< std::pair<int32_t, IkSolverBase::IkFilterCallbackFn> > vfilters;
+        piksolver->GetCustomFilters(vfilters);
+        if( vfilters.size() > 0 ) {
+            // the filters are written for the caller's environment and thread, for example python callbacks need the GIL
+            throw OPENRAVE_EXCEPTION_FORMAT("ik solver of manipulator %s:%s has %d custom filters, which cannot be called from the worker threads", _robotname%_manipname%vfilters.size(), ORE_InvalidState);
+        }
+        try {
+            EnvironmentMutex::scoped_lock lock(penv->GetMutex());
+            _vclonedenvs.resize(numthreads);
+            _vclonedmanips.resize(numthreads);
+            _vclonedsamplers.resize(numthreads);
+            for(int ithread = 0; ithread < numthreads; ++ithread) {
+                EnvironmentBasePtr pclonedenv = penv->CloneSelf(Clone_Bodies);
+                _vclonedenvs[ithread] = pclonedenv;
+                // the simulation thread polls the environment lock and would compete with the worker holding it
+                pclonedenv->StopSimulation();
+                RobotBasePtr pclonedrobot = pclonedenv->GetRobot(_robotname);
+                if( !!pclonedrobot ) {
+                    _vclonedmanips[ithread] = pclonedrobot->GetManipulator(_manipname);
+                }
+                if( !_vclonedmanips[ithread] ) {
+                    throw OPENRAVE_EXCEPTION_FORMAT("failed to find manipulator %s:%s in the cloned environment", _robotname%_manipname, ORE_InvalidState);
+                }
+                // cloning the bodies does not clone the ik solver, so the free increments are lost unless copied here
+                IkSolverBasePtr pclonedsolver = RaveCreateIkSolver(pclonedenv, piksolver->GetXMLId());
+                if( !pclonedsolver ) {
+                    throw OPENRAVE_EXCEPTION_FORMAT("failed to create ik solver %s for the cloned environment", piksolver->GetXMLId(), ORE_InvalidState);
+                }
+                pclonedsolver->Clone(piksolver, 0);
+                if( !_vclonedmanips[ithread]->SetIkSolver(pclonedsolver) ) {
+                    throw OPENRAVE_EXCEPTION_FORMAT("failed to set the cloned ik solver %s on manipulator %s:%s", piksolver->GetXMLId()%_robotname%_manipname, ORE_InvalidState);
+                }
+                _vclonedsamplers[ithread] = RaveCreateSpaceSampler(pclonedenv,"mt19937");
+                if( !_vclonedsamplers[ithread] ) {
+                    throw OPENRAVE_EXCEPTION_FORMAT0("failed to create the mt19937 sampler", ORE_InvalidState);
+                }
+                _vclonedsamplers[ithread]->SetSeed(ithread+1);
+            }
+        }
+        catch(...) {
+            _DestroyClones();
+            throw;
+        }
+        _vthreads.resize(numthreads);
+        for(int ithread = 0; ithread < numthreads; ++ithread) {
+            {
+                boost::mutex::scoped_lock lock(_mutex);
+                ++_numliveworkers;
+            }
+            _vthreads[ithread].reset(new boost::thread(boost::bind(&ParallelSampler::_WorkerThread, this, ithread)));
+        }
+    }
+
+    virtual ~ParallelSampler()
+    {
+        {
+            boost::mutex::scoped_lock lock(_mutex);
+            _bStop = true;
+        }
+        _condworkers.notify_all();
+        _condready.notify_all();
+        FOREACH(itthread, _vthreads) {
+            (*itthread)->join();
+        }
+        _DestroyClones();
+    }
+
+    /// \brief pops a ready solution, waiting for the workers to finish at most nummaxtries evaluations
+    ///
+    /// \param[out] orgindex the index of the parameterization of the solution
+    bool Pop(IkReturnPtr& ikreturn, int& orgindex, int nummaxtries)
+    {
+        boost::mutex::scoped_lock lock(_mutex);
+        uint64_t numevaluatedstart = _numevaluated;
+        while( _listready.size() == 0 ) {
+            if( (_queuecandidates.size() == 0 && _numworking == 0) || _numliveworkers == 0 || _numevaluated-numevaluatedstart >= (uint64_t)max(1,nummaxtries) ) {
+                return false;
+            }
+            _condready.wait(lock);
+        }
+        orgindex = _listready.front().first;
+        ikreturn = _listready.front().second;
+        _listready.pop_front();
+        _condworkers.notify_one();
+        return true;
+    }
+
+protected:
+    void _DestroyClones()
+    {
+        _vclonedmanips.resize(0);
+        _vclonedsamplers.resize(0);
+        FOREACH(itenv, _vclonedenvs) {
+            if( !!*itenv ) {
+                (*itenv)->Destroy();
+            }
+        }
+        _vclonedenvs.resize(0);
+    }
+
+    void _WorkerThread(int ithread)
+    {
+        try {
+            _RunWorker(ithread);
+        }
+        catch(const std::exception& ex) {
+            RAVELOG_WARN_FORMAT("ik goal sampler worker %d stopped: %s", ithread%ex.what());
+        }
+        {
+            boost::mutex::scoped_lock lock(_mutex);
+            --_numliveworkers;
+        }
+        // Pop stops waiting once there are no workers left
+        _condready.notify_all();
+    }
+
+    void _RunWorker(int ithread)
+    {
+        EnvironmentBasePtr penv = _vclonedenvs.at(ithread);
+        RobotBase::ManipulatorPtr pmanip = _vclonedmanips.at(ithread);
+        SpaceSamplerBasePtr psampler = _vclonedsamplers.at(ithread);
+        CollisionReportPtr report(new CollisionReport());
+        std::vector<IkReturnPtr> vikreturns;
+        while(1) {
+            size_t icandidate;
+            {
+                boost::mutex::scoped_lock lock(_mutex);
+                while( !_bStop && (_queuecandidates.size() == 0 || _listready.size() >= _maxready) ) {
+                    if( _queuecandidates.size() == 0 && _numworking == 0 ) {
+                        // everything is evaluated
+                        return;
+                    }
+                    _condworkers.wait(lock);
+                }
+                if( _bStop ) {
+                    return;
+                }
+                icandidate = _queuecandidates.front();
+                _queuecandidates.pop_front();
+                ++_numworking;
+            }
+
+            bool brequeue = false;
+            vikreturns.resize(0);
+            try {
+                EnvironmentMutex::scoped_lock envlock(penv->GetMutex());
+                brequeue = _Evaluate(pmanip, _vcandidates[icandidate], psampler, report, vikreturns);
+            }
+            catch(const std::exception& ex) {
+                RAVELOG_WARN_FORMAT("ik goal sampler worker %d failed: %s", ithread%ex.what());
+                vikreturns.resize(0);
+            }
+
+            {
+                boost::mutex::scoped_lock lock(_mutex);
+                --_numworking;
+                ++_numevaluated;
+                if( brequeue ) {
+                    _queuecandidates.push_back(icandidate);
+                }
+                FOREACH(itikreturn, vikreturns) {
+                    _listready.push_back(make_pair(_vcandidates[icandidate]._orgindex, *itikreturn));
+                }
+            }
+            _condready.notify_all();
+            _condworkers.notify_all();
+        }
+    }
+
+    /// \brief does one ManipulatorIKGoalSampler::Sample try of the candidate in the cloned environment
+    ///
+    /// \return true if the candidate should be tried again
+    bool _Evaluate(RobotBase::ManipulatorPtr pmanip, Candidate& candidate, SpaceSamplerBasePtr psampler, CollisionReportPtr report, std::vector<IkReturnPtr>& vikreturns)
+    {
+        int numRedundantSamplesForEEChecking = 0;
+        if( (int)pmanip->GetArmIndices().size() > candidate._ikparam.GetDOF() ) {
+            numRedundantSamplesForEEChecking = 40;
+        }
+        bool bFullEndEffectorKnown = candidate._ikparam.GetType() == IKP_Transform6D || pmanip->GetArmDOF() <= candidate._ikparam.GetDOF();
+        bool bCheckEndEffector = !(_ikfilteroptions & IKFO_IgnoreEndEffectorEnvCollisions);
+        // same as the serial Sample, only this try uses the jittered parameterization
+        IkParameterization ikparam = candidate._ikparam;
+        if( candidate._numleft == _nummaxsamples && bCheckEndEffector ) {
+            try {
+                if( pmanip->CheckEndEffectorCollision(ikparam, report, numRedundantSamplesForEEChecking) ) {
+                    IkReturnPtr ikreturnjittered;
+                    if( _fjittermaxdist <= 0 || !_JitterEndEffector(pmanip, ikparam, _fjittermaxdist, numRedundantSamplesForEEChecking, _ikfilteroptions, psampler, report, ikreturnjittered) ) {
+                        RAVELOG_VERBOSE(str(boost::format("sampleiksolutions gripper in collision: %s.\n")%report->__str__()));
+                        return false;
+                    }
+                }
+            }
+            catch(const std::exception& ex) {
+                if( candidate._ikparam.GetType() == IKP_Transform6D ) {
+                    RAVELOG_WARN(str(boost::format("CheckEndEffectorCollision threw exception: %s")%ex.what()));
+                }
+                else {
+                    // most likely the ik couldn't get solved
+                    RAVELOG_VERBOSE(str(boost::format("sampleiksolutions failed to solve ik: %s.\n")%ex.what()));
+                    return false;
+                }
+            }
+        }
+
+        std::vector<dReal> vfree;
+        if( pmanip->GetIkSolver()->GetNumFreeParameters() > 0 ) {
+            if( _searchfreeparameters ) {
+                if( !candidate._psampler ) {
+                    candidate._psampler = RaveCreateSpaceSampler(pmanip->GetRobot()->GetEnv(),"halton");
+                    candidate._psampler->SetSpaceDOF(pmanip->GetIkSolver()->GetNumFreeParameters());
+                }
+                candidate._psampler->SampleSequence(vfree,1);
+            }
+            else {
+                pmanip->GetIkSolver()->GetFreeParameters(vfree);
+            }
+        }
+        if( !pmanip->FindIKSolutions(ikparam, vfree, _ikfilteroptions|(bFullEndEffectorKnown&&bCheckEndEffector ? IKFO_IgnoreEndEffectorEnvCollisions : 0), vikreturns) ) {
+            vikreturns.resize(0);
+        }
+        return --candidate._numleft > 0 && vfree.size() > 0 && _searchfreeparameters;
+    }
+
+    std::string _robotname, _manipname;
+    int _nummaxsamples, _ikfilteroptions;
+    bool _searchfreeparameters;
+    dReal _fjittermaxdist;
+    size_t _maxready;
+
+    std::vector<Candidate> _vcandidates; ///< a candidate is only accessed by the worker that popped it from _queuecandidates
+    std::deque<size_t> _queuecandidates; ///< candidates left to try, protected by _mutex
+    std::list< std::pair<int, IkReturnPtr> > _listready; ///< the solutions and the indices of their parameterizations, protected by _mutex
+    int _numworking; ///< number of workers evaluating a candidate, protected by _mutex
+    int _numliveworkers; ///< number of worker threads that have not exited, protected by _mutex
+    uint64_t _numevaluated; ///< number of tries done, protected by _mutex
+    bool _bStop; ///< protected by _mutex
+    boost::mutex _mutex;
+    boost::condition _condready; ///< notified when a try is done
+    boost::condition _condworkers; ///< notified when the queues change
+    std::vector<EnvironmentBasePtr> _vclonedenvs;
+    std::vector<RobotBase::ManipulatorPtr> _vclonedmanips; ///< the manipulator of every worker in its cloned environment
+    std::vector<SpaceSamplerBasePtr> _vclonedsamplers; ///< the jitter sampler of every worker
+    std::vector<boost::shared_ptr<boost::thread> > _vthreads;
+};
+
 ManipulatorIKGoalSampler::ManipulatorIKGoalSampler(RobotBase::ManipulatorConstPtr pmanip, const std::list<IkParameterization>& listparameterizations, int nummaxsamples, int nummaxtries, dReal fsampleprob, bool searchfreeparameters, int ikfilteroptions) : _pmanip(pmanip), _nummaxsamples(nummaxsamples), _nummaxtries(nummaxtries), _fsampleprob(fsampleprob), _ikfilteroptions(ikfilteroptions), _searchfreeparameters(searchfreeparameters)
 {
     _tempikindex = -1;
@@ -2491,6 +4117,15 @@ IkReturnPtr ManipulatorIKGoalSampler::Sample()
         }
         return ikreturnlocal;
     }
+    if( !!_pparallel ) {
+        IkReturnPtr ikreturnlocal;
+        int orgindex = -1;
+        if( !_pparallel->Pop(ikreturnlocal, orgindex, _nummaxtries) ) {
+            return IkReturnPtr();
+        }
+        _listreturnedsamples.push_back(orgindex);
+        return ikreturnlocal;
+    }
     IkReturnPtr ikreturnjittered;
     for(int itry = 0; itry < _nummaxtries; ++itry ) {
         if( _listsamples.size() == 0 ) {
@@ -2524,76 +4159,7 @@ IkReturnPtr ManipulatorIKGoalSampler::Sample()
                     if( _fjittermaxdist > 0 ) {
                         // try jittering the end effector out
                         RAVELOG_VERBOSE_FORMAT("starting jitter transform %f...", _fjittermaxdist);
-                        // randomly add small offset to the ik until it stops being in collision
-                        Transform tjitter;
-                        // before random sampling, first try sampling along the axes. try order z,y,x since z is most likely gravity
-                        int N = 4;
-                        dReal delta = _fjittermaxdist/N;
-                        for(int iaxis = 2; iaxis >= 0; --iaxis) {
-                            tjitter.trans = Vector();
-                            for(int iiter = 0; iiter < 2*N; ++iiter) {
-                                tjitter.trans[iaxis] = _fjittermaxdist*delta*(1+iiter/2);
-                                if( iiter & 1 ) {
-                                    // revert sign
-                                    tjitter.trans[iaxis] = -tjitter.trans[iaxis];
-                                }
-                                IkParameterization ikparamjittered = tjitter * ikparam;
-                                try {
-                                    if( !_pmanip->CheckEndEffectorCollision(ikparamjittered,_report, numRedundantSamplesForEEChecking) ) {
-                                        // make sure at least one ik solution exists...
-                                        if( !ikreturnjittered ) {
-                                            ikreturnjittered.reset(new IkReturn(IKRA_Success));
-                                        }
-                                        bool biksuccess = _pmanip->FindIKSolution(ikparamjittered, _ikfilteroptions, ikreturnjittered);
-                                        if( biksuccess ) {
-                                            ikparam = ikparamjittered;
-                                            bcollision = false;
-                                            break;
-                                        }
-                                        else {
-                                            RAVELOG_VERBOSE_FORMAT("jitter succeed position, but ik failed: 0x%.8x", ikreturnjittered->_action);
-                                        }
-                                    }
-                                }
-                                catch(const std::exception& ex) {
-                                    // ignore most likely ik failed in CheckEndEffectorCollision
-                                }
-                            }
-                            if( !bcollision ) {
-                                break;
-                            }
-                        }
-
-                        if( bcollision ) {
-                            // try random samples, most likely will fail...
-                            int nMaxIterations = 100;
-                            std::vector<dReal> xyzsamples(3);
-                            dReal delta = (_fjittermaxdist*2)/nMaxIterations;
-                            for(int iiter = 1; iiter <= nMaxIterations; ++iiter) {
-                                _pindexsampler->SampleSequence(xyzsamples,3,IT_Closed);
-                                tjitter.trans = Vector(xyzsamples[0]-0.5f, xyzsamples[1]-0.5f, xyzsamples[2]-0.5f) * (delta*iiter);
-                                IkParameterization ikparamjittered = tjitter * ikparam;
-                                try {
-                                    if( !_pmanip->CheckEndEffectorCollision(ikparamjittered, _report, numRedundantSamplesForEEChecking) ) {
-                                        if( !ikreturnjittered ) {
-                                            ikreturnjittered.reset(new IkReturn(IKRA_Success));
-                                        }
-                                        bool biksuccess = _pmanip->FindIKSolution(ikparamjittered, _ikfilteroptions, ikreturnjittered);
-                                        if( biksuccess ) {
-                                            ikparam = ikparamjittered;
-                                            bcollision = false;
-                                            break;
-                                        }
-                                        else {
-                                            RAVELOG_VERBOSE_FORMAT("jitter succed position, but ik failed: 0x%.8x", ikreturnjittered->_action);
-                                        }
-                                    }
-                                }
-                                catch(const std::exception& ex) {
-                                    // ignore most likely ik failed in CheckEndEffectorCollision
-                                }
-                            }
-                        }
+                        bcollision = !_JitterEndEffector(_pmanip, ikparam, _fjittermaxdist, numRedundantSamplesForEEChecking, _ikfilteroptions, _pindexsampler, _report, ikreturnjittered);
                     }
                     if( bcollision ) {
                         RAVELOG_VERBOSE(str(boost::format("sampleiksolutions gripper in collision: %s.\n")%_report->__str__()));
@@ -2700,5 +4266,14 @@ void ManipulatorIKGoalSampler::SetJitter(dReal maxdist)
     _fjittermaxdist = maxdist;
 }
 
+void ManipulatorIKGoalSampler::SetParallel(int numthreads, int maxready)
+{
+    // stop the old workers before cloning
+    _pparallel.reset();
+    if( numthreads > 0 ) {
+        _pparallel.reset(new ParallelSampler(*this, numthreads, maxready));
+    }
+}
+
 } // planningutils
 } // OpenRAVE
@@ -27,6 +27,7 @@
 #ifdef _WIN32
 #define WIN32_LEAN_AND_MEAN
 #include <windows.h>
+#include <sys/stat.h>
 #define PLUGIN_EXT ".dll"
 #define OPENRAVE_LAZY_LOADING false
 #else
@@ -35,6 +36,7 @@
 #include <sys/stat.h>
 #include <sys/types.h>
 #include <dirent.h>
+#include <unistd.h>
 
 #ifdef __APPLE_CC__
 #define PLUGIN_EXT ".dylib"
@@ -314,7 +316,7 @@ protected:
     typedef boost::shared_ptr<Plugin const> PluginConstPtr;
     friend class Plugin;
 
-    RaveDatabase() : _bShutdown(false) {
+    RaveDatabase() : _bPluginIndexModified(false), _bShutdown(false) {
     }
     virtual ~RaveDatabase() {
         Destroy();
@@ -360,8 +362,11 @@ protected:
         return RaveInterfaceCast<SpaceSamplerBase>(Create(penv, PT_SpaceSampler, name));
     }
 
-    virtual bool Init(bool bLoadAllPlugins)
+    /// \param pluginindexfilename if not empty, file to cache the plugin attributes in, see \ref _LoadPluginIndex
+    virtual bool Init(bool bLoadAllPlugins, const std::string& pluginindexfilename=std::string())
     {
+        _pluginindexfilename = pluginindexfilename;
+        _LoadPluginIndex();
         _threadPluginLoader.reset(new boost::thread(boost::bind(&RaveDatabase::_PluginLoaderThread, this)));
         std::vector<std::string> vplugindirs;
 #ifdef _WIN32
@@ -601,7 +606,7 @@ protected:
                 string strplugin = pdir;
                 strplugin += "\\";
                 strplugin += FindFileData.cFileName;
-                LoadPlugin(strplugin.c_str());
+                _AddPlugin(strplugin);
             } while (FindNextFileA(hFind, &FindFileData) != 0);
             FindClose(hFind);
         }
@@ -617,7 +622,7 @@ protected:
                     string strplugin = pdir;
                     strplugin += "/";
                     strplugin += ep->d_name;
-                    LoadPlugin(strplugin.c_str());
+                    _AddPlugin(strplugin);
                 }
             }
             (void) closedir (dp);
@@ -626,40 +631,42 @@ protected:
             RAVELOG_DEBUG("Couldn't open directory %s\n", pdir.c_str());
         }
 #endif
+        boost::mutex::scoped_lock lock(_mutex);
+        _CleanupUnusedLibraries();
+        _SavePluginIndex();
         return true;
     }
 
     void ReloadPlugins()
     {
-        boost::mutex::scoped_lock lock(_mutex);
-        FOREACH(itplugin,_listplugins) {
+        list<PluginPtr> listplugins;
+        {
+            boost::mutex::scoped_lock lock(_mutex);
+            listplugins = _listplugins;
+        }
+        // open the libraries without _mutex so that other threads can still create interfaces
+        FOREACH(itplugin,listplugins) {
             PluginPtr newplugin = _LoadPlugin((*itplugin)->ppluginname);
             if( !!newplugin ) {
-                *itplugin = newplugin;
+                boost::mutex::scoped_lock lock(_mutex);
+                std::list<PluginPtr>::iterator itold = find(_listplugins.begin(), _listplugins.end(), *itplugin);
+                if( itold != _listplugins.end() ) {
+                    *itold = newplugin;
+                }
             }
         }
+        boost::mutex::scoped_lock lock(_mutex);
         _CleanupUnusedLibraries();
+        _SavePluginIndex();
     }
 
     bool LoadPlugin(const std::string& pluginname)
     {
+        bool bsuccess = _AddPlugin(pluginname);
         boost::mutex::scoped_lock lock(_mutex);
-        std::list<PluginPtr>::iterator it = _GetPlugin(pluginname);
-        string newpluginname;
-        if( it != _listplugins.end() ) {
-            // since we got a match, use the old name and remove the old library
-            newpluginname = (*it)->ppluginname;
-            _listplugins.erase(it);
-        }
-        else {
-            newpluginname = pluginname;
-        }
-        PluginPtr p = _LoadPlugin(newpluginname);
-        if( !!p ) {
-            _listplugins.push_back(p);
-        }
         _CleanupUnusedLibraries();
-        return !!p;
+        _SavePluginIndex();
+        return bsuccess;
     }
 
     bool RemovePlugin(const std::string& pluginname)
@@ -803,8 +810,48 @@ protected:
         return _listplugins.end();
     }
 
+    /// \brief loads the plugin and adds it to _listplugins, replaces the plugin of the same name if it exists
+    ///
+    /// _mutex should not be locked, it is only held while _listplugins is updated
+    bool _AddPlugin(const std::string& pluginname)
+    {
+        string newpluginname = pluginname;
+        {
+            boost::mutex::scoped_lock lock(_mutex);
+            std::list<PluginPtr>::iterator it = _GetPlugin(pluginname);
+            if( it != _listplugins.end() ) {
+                // since we got a match, use the old name and remove the old library
+                newpluginname = (*it)->ppluginname;
+            }
+        }
+        PluginPtr p = _LoadPlugin(newpluginname);
+        boost::mutex::scoped_lock lock(_mutex);
+        std::list<PluginPtr>::iterator it = _GetPlugin(newpluginname);
+        if( it != _listplugins.end() ) {
+            _listplugins.erase(it);
+        }
+        if( !!p ) {
+            _listplugins.push_back(p);
+        }
+        return !!p;
+    }
+
+    /// \brief opens the shared object and reads its attributes, unless the plugin index already has them
+    ///
+    /// _mutex should not be locked since opening shared objects can take a long time, it is only held while the index
+    /// is accessed.
     PluginPtr _LoadPlugin(const string& _libraryname)
     {
+        std::list<std::string> listplugindirs;
+        {
+            boost::mutex::scoped_lock lock(_mutex);
+            PluginPtr pindexed;
+            if( _LoadPluginFromIndex(_libraryname, pindexed) ) {
+                return pindexed;
+            }
+            listplugindirs = _listplugindirs;
+        }
+
         string libraryname = _libraryname;
         void* plibrary = _SysLoadLibrary(libraryname.c_str(),OPENRAVE_LAZY_LOADING);
         if( plibrary == NULL ) {
@@ -843,7 +890,7 @@ protected:
 #ifdef HAVE_BOOST_FILESYSTEM
         if( plibrary == NULL ) {
             // try adding from the current plugin libraries
-            FOREACH(itdir,_listplugindirs) {
+            FOREACH(itdir,listplugindirs) {
                 string newlibraryname = boost::filesystem::absolute(libraryname,*itdir).string();
                 plibrary = _SysLoadLibrary(newlibraryname.c_str(),OPENRAVE_LAZY_LOADING);
                 if( !!plibrary ) {
@@ -864,8 +911,10 @@ protected:
 
         try {
             if( !p->Load_GetPluginAttributes() ) {
-                // might not be a plugin
+                // might not be a plugin, remember it so the next processes do not open it again
                 RAVELOG_VERBOSE(str(boost::format("%s: can't load GetPluginAttributes function, might not be an OpenRAVE plugin\n")%libraryname));
+                boost::mutex::scoped_lock lock(_mutex);
+                _AddToPluginIndex(libraryname, p->_infocached, false);
                 return PluginPtr();
             }
 
@@ -875,6 +924,8 @@ protected:
             else {
                 if( !p->pfnGetPluginAttributes(&p->_infocached, sizeof(p->_infocached)) ) {
                     RAVELOG_WARN(str(boost::format("%s: GetPluginAttributes failed\n")%libraryname));
+                    boost::mutex::scoped_lock lock(_mutex);
+                    _AddToPluginIndex(libraryname, p->_infocached, false);
                     return PluginPtr();
                 }
             }
@@ -899,6 +950,10 @@ protected:
         RAVELOG_DEBUG("loading plugin: %s\n", info.dli_fname);
 #endif
 
+        {
+            boost::mutex::scoped_lock lock(_mutex);
+            _AddToPluginIndex(libraryname, p->_infocached, true);
+        }
         p->_bInitializing = false;
         if( OPENRAVE_LAZY_LOADING ) {
             // have confirmed that plugin is ok, so reload with no-lazy loading
@@ -910,6 +965,185 @@ protected:
         return p;
     }
 
+    /// \brief creates the plugin from its index entry without opening the shared object
+    ///
+    /// The library is loaded by _confirmLibrary when an interface is created for the first time. _mutex should be locked.
+    /// \param[out] p the plugin, empty if the index knows the file is not a plugin
+    /// \return false if the file has no valid entry in the index
+    bool _LoadPluginFromIndex(const std::string& libraryname, PluginPtr& p)
+    {
+        p.reset();
+        std::map<std::string, PluginIndexEntry>::const_iterator itentry = _mapPluginIndex.find(_GetPluginIndexKey(libraryname));
+        if( itentry == _mapPluginIndex.end() ) {
+            return false;
+        }
+        int64_t mtime = 0, filesize = 0;
+        if( !_GetPluginFileStamp(libraryname, mtime, filesize) || mtime != itentry->second.mtime || filesize != itentry->second.filesize ) {
+            return false;
+        }
+        if( !itentry->second.bIsPlugin ) {
+            RAVELOG_VERBOSE("skipping %s, the plugin index has it as not an openrave plugin\n", libraryname.c_str());
+            return true;
+        }
+        p.reset(new Plugin(shared_from_this()));
+        p->ppluginname = libraryname;
+        p->_infocached = itentry->second.info;
+        p->_bInitializing = false;
+        RAVELOG_DEBUG("loading plugin from index: %s\n", libraryname.c_str());
+        return true;
+    }
+
+    /// \param bIsPlugin false if the file could be opened but is not an openrave plugin
+    ///
+    /// _mutex should be locked
+    void _AddToPluginIndex(const std::string& libraryname, const PLUGININFO& info, bool bIsPlugin)
+    {
+        if( _pluginindexfilename.size() == 0 ) {
+            return;
+        }
+        PluginIndexEntry entry;
+        if( !_GetPluginFileStamp(libraryname, entry.mtime, entry.filesize) ) {
+            return;
+        }
+        entry.bIsPlugin = bIsPlugin;
+        if( bIsPlugin ) {
+            entry.info = info;
+        }
+        _mapPluginIndex[_GetPluginIndexKey(libraryname)] = entry;
+        _bPluginIndexModified = true;
+    }
+
+    /// \brief reads _mapPluginIndex from _pluginindexfilename
+    ///
+    /// The index stores the PLUGININFO of every plugin file along with the file modification time and size, so starting
+    /// up does not need to open every shared object just to call GetPluginAttributes. Shared objects in the plugin
+    /// directories that are not openrave plugins are stored too, so they are not opened again either. An entry is only
+    /// used if the file did not change. The whole index is ignored if it was written with a different
+    /// OPENRAVE_PLUGININFO_HASH.
+    void _LoadPluginIndex()
+    {
+        _mapPluginIndex.clear();
+        _bPluginIndexModified = false;
+        if( _pluginindexfilename.size() == 0 ) {
+            return;
+        }
+        ifstream f(_pluginindexfilename.c_str());
+        if( !f ) {
+            return;
+        }
+        std::string header, infohash, libraryname, line;
+        int version = 0;
+        f >> header >> version >> infohash;
+        if( !f || header != "openrave_plugin_index" || version != s_nPluginIndexVersion || infohash != OPENRAVE_PLUGININFO_HASH ) {
+            RAVELOG_DEBUG(str(boost::format("ignoring plugin index %s since it was written by a different version")%_pluginindexfilename));
+            _bPluginIndexModified = true;
+            return;
+        }
+        getline(f, line);
+        while( getline(f, libraryname) ) {
+            if( libraryname.size() == 0 ) {
+                continue;
+            }
+            PluginIndexEntry entry;
+            int numtypes = 0;
+            f >> entry.mtime >> entry.filesize >> entry.bIsPlugin >> entry.info.version >> numtypes;
+            for(int itype = 0; itype < numtypes && !!f; ++itype) {
+                int type = 0, numnames = 0;
+                f >> type >> numnames;
+                if( numnames < 0 ) {
+                    f.setstate(std::ios::failbit);
+                    break;
+                }
+                std::vector<std::string>& vnames = entry.info.interfacenames[(InterfaceType)type];
+                vnames.resize(numnames);
+                FOREACH(itname, vnames) {
+                    f >> *itname;
+                }
+            }
+            if( !f ) {
+                RAVELOG_WARN(str(boost::format("plugin index %s is corrupted, rebuilding it")%_pluginindexfilename));
+                _mapPluginIndex.clear();
+                _bPluginIndexModified = true;
+                return;
+            }
+            getline(f, line);
+            _mapPluginIndex[libraryname] = entry;
+        }
+    }
+
+    /// \brief writes _mapPluginIndex to _pluginindexfilename if it changed
+    void _SavePluginIndex()
+    {
+        if( !_bPluginIndexModified || _pluginindexfilename.size() == 0 ) {
+            return;
+        }
+        _bPluginIndexModified = false;
+        // write to a temporary file and rename it so that processes starting at the same time never read a partial index
+#ifdef _WIN32
+        string tempfilename = str(boost::format("%s.%d")%_pluginindexfilename%GetCurrentProcessId());
+#else
+        string tempfilename = str(boost::format("%s.%d")%_pluginindexfilename%getpid());
+#endif
+        {
+            ofstream f(tempfilename.c_str());
+            if( !f ) {
+                RAVELOG_VERBOSE(str(boost::format("failed to write plugin index %s")%tempfilename));
+                return;
+            }
+            f << "openrave_plugin_index " << s_nPluginIndexVersion << " " << OPENRAVE_PLUGININFO_HASH << endl;
+            int64_t mtime = 0, filesize = 0;
+            FOREACHC(itentry, _mapPluginIndex) {
+                // drop plugins that were removed
+                if( !_GetPluginFileStamp(itentry->first, mtime, filesize) ) {
+                    continue;
+                }
+                const PLUGININFO& info = itentry->second.info;
+                f << itentry->first << endl << itentry->second.mtime << " " << itentry->second.filesize << " " << itentry->second.bIsPlugin << " " << info.version << " " << info.interfacenames.size();
+                FOREACHC(ittype, info.interfacenames) {
+                    f << " " << (int)ittype->first << " " << ittype->second.size();
+                    FOREACHC(itname, ittype->second) {
+                        f << " " << *itname;
+                    }
+                }
+                f << endl;
+            }
+        }
+#ifdef _WIN32
+        remove(_pluginindexfilename.c_str());
+#endif
+        if( rename(tempfilename.c_str(), _pluginindexfilename.c_str()) != 0 ) {
+            RAVELOG_VERBOSE(str(boost::format("failed to write plugin index %s")%_pluginindexfilename));
+            remove(tempfilename.c_str());
+        }
+    }
+
+    static std::string _GetPluginIndexKey(const std::string& libraryname)
+    {
+#if defined(HAVE_BOOST_FILESYSTEM) && defined(BOOST_FILESYSTEM_VERSION) && BOOST_FILESYSTEM_VERSION >= 3
+        return boost::filesystem::absolute(boost::filesystem::path(libraryname)).string();
+#else
+        return libraryname;
+#endif
+    }
+
+    static bool _GetPluginFileStamp(const std::string& filename, int64_t& mtime, int64_t& filesize)
+    {
+#ifdef _WIN32
+        struct _stat64 st;
+        if( _stat64(filename.c_str(), &st) != 0 ) {
+            return false;
+        }
+#else
+        struct stat st;
+        if( stat(filename.c_str(), &st) != 0 ) {
+            return false;
+        }
+#endif
+        mtime = (int64_t)st.st_mtime;
+        filesize = (int64_t)st.st_size;
+        return true;
+    }
+
     static void* _SysLoadLibrary(const std::string& lib, bool bLazy=false)
     {
         // check if file exists first
@@ -1033,6 +1267,20 @@ protected:
     std::list< boost::weak_ptr<RegisteredInterface> > _listRegisteredInterfaces;
     std::list<std::string> _listplugindirs;
 
+    /// \brief cached attributes of a plugin file, see \ref _LoadPluginIndex
+    struct PluginIndexEntry
+    {
+        PluginIndexEntry() : mtime(0), filesize(0), bIsPlugin(true) {
+        }
+        int64_t mtime, filesize;
+        bool bIsPlugin; ///< false if the file is not an openrave plugin, info is empty
+        PLUGININFO info;
+    };
+    static const int s_nPluginIndexVersion = 2;
+    std::string _pluginindexfilename; ///< empty if the index is disabled
+    std::map<std::string, PluginIndexEntry> _mapPluginIndex; ///< indexed by the absolute plugin filename, protected by _mutex
+    bool _bPluginIndexModified;
+
     /// \name plugin loading
     //@{
     mutable boost::mutex _mutexPluginLoader;     ///< specifically for loading shared objects
@@ -102,6 +102,57 @@ void TrajectoryBase::GetWaypoints(size_t startindex, size_t endindex, std::vecto
     }
 }
 
+/// \brief forwards to the trajectory methods for implementations that do not provide a sampler
+class DefaultTrajectorySampler : public TrajectoryBase::Sampler
+{
+public:
+    DefaultTrajectorySampler(TrajectoryBaseConstPtr ptraj) : _ptraj(ptraj) {
+    }
+
+    void Sample(std::vector<dReal>& data, dReal time)
+    {
+        _ptraj->Sample(data,time);
+    }
+
+    void Sample(std::vector<dReal>& data, dReal time, const ConfigurationSpecification& spec)
+    {
+        // convert the sample of the internal specification so that the delta time is relative to the previous waypoint like the other samplers
+        _ptraj->Sample(_vinternaldata,time);
+        data.resize(spec.GetDOF());
+        ConfigurationSpecification::ConvertData(data.begin(),spec,_vinternaldata.begin(),_ptraj->GetConfigurationSpecification(),1,_ptraj->GetEnv());
+    }
+
+    size_t GetFirstWaypointIndexAfterTime(dReal time)
+    {
+        return _ptraj->GetFirstWaypointIndexAfterTime(time);
+    }
+
+protected:
+    TrajectoryBaseConstPtr _ptraj;
+    std::vector<dReal> _vinternaldata;
+};
+
+TrajectoryBase::SamplerPtr TrajectoryBase::CreateSampler() const
+{
+    return SamplerPtr(new DefaultTrajectorySampler(shared_trajectory_const()));
+}
+
+void TrajectoryBase::SamplePoints(std::vector<dReal>& data, const std::vector<dReal>& times, const ConfigurationSpecification& spec) const
+{
+    size_t dof = spec.GetDOF();
+    data.resize(times.size()*dof);
+    if( times.size() == 0 ) {
+        return;
+    }
+    SamplerPtr psampler = CreateSampler();
+    vector<dReal> vpoint;
+    vpoint.reserve(dof);
+    for(size_t i = 0; i < times.size(); ++i) {
+        psampler->Sample(vpoint,times[i],spec);
+        std::copy(vpoint.begin(),vpoint.end(),data.begin()+i*dof);
+    }
+}
+
 // Old API
 
 bool TrajectoryBase::SampleTrajectory(dReal time, TrajectoryBase::Point& tp) const
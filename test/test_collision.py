@@ -242,6 +242,294 @@ class RunCollision(EnvironmentSetup):
         manip.CheckEndEffectorCollision(report)
         assert(len(report.vLinkColliding)==4)
 
+class TestBulletCollision(EnvironmentSetup):
+    def setup(self):
+        EnvironmentSetup.setup(self)
+        self.checker = RaveCreateCollisionChecker(self.env,'bullet')
+        if self.checker is None:
+            raise nose.SkipTest('bullet collision checker is not available')
+        self.env.SetCollisionChecker(self.checker)
+
+    def test_paircache(self):
+        self.log.info('compare the persistent pair cache with a new checker after moving, enabling and disabling bodies')
+        env=self.env
+        self.LoadEnv('data/lab1.env.xml')
+        with env:
+            robot=env.GetRobots()[0]
+            bodies = [body for body in env.GetBodies() if body != robot]
+            links = robot.GetLinks()
+            queries = [(link,body) for link in links for body in bodies]
+            lower,upper = robot.GetDOFLimits()
+            for iter in range(40):
+                robot.SetDOFValues(lower+random.rand(len(lower))*(upper-lower))
+                body = bodies[random.randint(len(bodies))]
+                if iter % 3 == 0:
+                    body.Enable(not body.IsEnabled())
+                elif iter % 3 == 1:
+                    T = body.GetTransform()
+                    T[0:3,3] = links[random.randint(len(links))].GetTransform()[0:3,3] + 0.2*(random.rand(3)-0.5)
+                    body.SetTransform(T)
+                else:
+                    link = links[random.randint(len(links))]
+                    link.Enable(not link.IsEnabled())
+                results = self.checker.CheckCollisionBatch(queries)
+
+                # a checker created for the clone has no cached pairs or manifolds
+                envref = env.CloneSelf(CloningOptions.Bodies)
+                try:
+                    checkerref = RaveCreateCollisionChecker(envref,'bullet')
+                    envref.SetCollisionChecker(checkerref)
+                    for (link,body),result in izip(queries,results):
+                        expected = checkerref.CheckCollision(envref.GetKinBody(link.GetParent().GetName()).GetLinks()[link.GetIndex()], envref.GetKinBody(body.GetName()))
+                        assert(self.checker.CheckCollision(link,body) == expected)
+                        assert(result == expected)
+                finally:
+                    envref.Destroy()
+
+class TestPQPCollision(EnvironmentSetup):
+    def setup(self):
+        EnvironmentSetup.setup(self)
+        self.checker = RaveCreateCollisionChecker(self.env,'pqp')
+        if self.checker is None:
+            raise nose.SkipTest('pqp collision checker is not available')
+        self.env.SetCollisionChecker(self.checker)
+
+    def test_continuous(self):
+        self.log.info('compare the continuous collision checks of straight lines with discretized checks')
+        env=self.env
+        # the tridof robot has no mimic joints, which the continuous checks do not support
+        self.LoadEnv('data/tridoftable.env.xml')
+        tolerance = 0.005
+        numsteps = 200
+        with env:
+            robot=env.GetRobots()[0]
+            # the base rests on the table, so lift it out of the tolerance of the continuous checks
+            T = robot.GetTransform()
+            T[2,3] += 2*tolerance
+            robot.SetTransform(T)
+            # the first joints are circular, the continuous checks take the shortest path between the values
+            lower,upper = robot.GetDOFLimits()
+            lower = maximum(lower,-pi)
+            upper = minimum(upper,pi)
+            def SampleFree():
+                while True:
+                    values = lower+random.rand(len(lower))*(upper-lower)
+                    robot.SetDOFValues(values)
+                    if not env.CheckCollision(robot):
+                        return values
+            for iter in range(40):
+                q0 = SampleFree()
+                q1 = SampleFree()
+                robot.SetDOFValues(q0)
+                ret,collisiontime = self.checker.CheckContinuousCollision(robot,q0,q1,tolerance)
+                assert(ret >= 0)
+                assert(transdist(robot.GetDOFValues(),q0) <= g_epsilon)
+                delta = robot.SubtractDOFValues(q1,q0)
+                discretetime = None
+                for istep in range(numsteps+1):
+                    robot.SetDOFValues(q0+(istep/float(numsteps))*delta)
+                    if env.CheckCollision(robot):
+                        discretetime = istep/float(numsteps)
+                        break
+                if discretetime is not None:
+                    # continuous checks are conservative, so they cannot find the collision later than the discretization
+                    assert(ret == 1)
+                    assert(collisiontime <= discretetime)
+                elif ret == 1:
+                    # either the discretization stepped over the collision or the body passes closer than the tolerance
+                    robot.SetDOFValues(q0+collisiontime*delta)
+                    self.checker.SetCollisionOptions(CollisionOptions.Distance)
+                    report = CollisionReport()
+                    env.CheckCollision(robot,report)
+                    self.checker.SetCollisionOptions(0)
+                    assert(report.minDistance <= 2*tolerance)
+
+    def test_paralleldistance(self):
+        self.log.info('compare the distances computed on several threads with the ones computed on the calling thread')
+        env=self.env
+        self.LoadEnv('data/lab1.env.xml')
+        with env:
+            robot=env.GetRobots()[0]
+            checkerparallel = RaveCreateCollisionChecker(env,'pqp')
+            checkerparallel.InitEnvironment()
+            checkerparallel.SendCommand('SetNumThreads 4')
+            for checker in [self.checker,checkerparallel]:
+                checker.SetCollisionOptions(CollisionOptions.Distance|CollisionOptions.Contacts)
+            link = robot.GetActiveManipulator().GetEndEffector()
+            lower,upper = robot.GetDOFLimits()
+            report = CollisionReport()
+            reportparallel = CollisionReport()
+            for iter in range(100):
+                robot.SetDOFValues(lower+random.rand(len(lower))*(upper-lower))
+                for body in [robot,link]:
+                    # the same warm starts are used for every thread count, so the results are the same
+                    ret = self.checker.CheckCollision(body,report=report)
+                    retparallel = checkerparallel.CheckCollision(body,report=reportparallel)
+                    assert(ret == retparallel)
+                    assert(report.minDistance == reportparallel.minDistance)
+                    assert(report.plink1 == reportparallel.plink1 and report.plink2 == reportparallel.plink2)
+                    assert(len(report.contacts) == len(reportparallel.contacts))
+
+    def test_boxprecision(self):
+        self.log.info('compare the box collisions of the pqp checker with separating axis tests in double precision')
+        # with OPT_PQP_FLOAT32, pqp rounds the meshes and transforms to 32bit floats, which only matters for boxes closer than the tolerance
+        env=self.env
+        tolerance = 1e-4
+        a = array([0.1,0.2,0.3])
+        b = array([0.4,0.05,0.2]) # cannot fit in the other box, pqp only detects intersecting surfaces
+        with env:
+            box0 = RaveCreateKinBody(env,'')
+            box0.SetName('box0')
+            box0.InitFromBoxes(array([r_[zeros(3),a]]),True)
+            env.Add(box0)
+            box1 = RaveCreateKinBody(env,'')
+            box1.SetName('box1')
+            box1.InitFromBoxes(array([r_[zeros(3),b]]),True)
+            env.Add(box1)
+            numchecked = 0
+            for iter in range(2000):
+                quat = random.randn(4)
+                T = matrixFromQuat(quat/linalg.norm(quat))
+                T[0:3,3] = 1.2*(random.rand(3)-0.5)
+                box1.SetTransform(T)
+                # largest gap of the boxes along the 15 separating axes, negative if they overlap
+                R = T[0:3,0:3]
+                axes = [eye(3)[i] for i in range(3)] + [R[:,j] for j in range(3)] + [cross(eye(3)[i],R[:,j]) for i in range(3) for j in range(3)]
+                gaps = []
+                for axis in axes:
+                    if linalg.norm(axis) > 1e-6:
+                        axis = axis/linalg.norm(axis)
+                        gaps.append(abs(dot(T[0:3,3],axis)) - dot(a,abs(axis)) - dot(b,abs(dot(axis,R))))
+                separation = max(gaps)
+                if abs(separation) < tolerance:
+                    continue
+                assert(env.CheckCollision(box0,box1) == (separation < 0))
+                numchecked += 1
+            assert(numchecked > 1900)
+
+    def test_sharedmodels(self):
+        self.log.info('check that identical bodies and cloned environments share the pqp models')
+        env=self.env
+        with env:
+            nummodels = int(self.checker.SendCommand('GetNumModels'))
+            body1 = env.ReadKinBodyURI('data/mug1.kinbody.xml')
+            env.Add(body1,True)
+            nummodels1 = int(self.checker.SendCommand('GetNumModels'))
+            assert(nummodels1 > nummodels)
+            body2 = env.ReadKinBodyURI('data/mug1.kinbody.xml')
+            env.Add(body2,True)
+            assert(int(self.checker.SendCommand('GetNumModels')) == nummodels1)
+            envclone = env.CloneSelf(CloningOptions.Bodies)
+            try:
+                checkerclone = RaveCreateCollisionChecker(envclone,'pqp')
+                envclone.SetCollisionChecker(checkerclone)
+                assert(checkerclone.CheckCollision(envclone.GetKinBody(body1.GetName())))
+                assert(int(self.checker.SendCommand('GetNumModels')) == nummodels1)
+            finally:
+                envclone.Destroy()
+            # a different mesh has its own model
+            body3 = env.ReadKinBodyURI('data/mug2.kinbody.xml')
+            env.Add(body3,True)
+            assert(int(self.checker.SendCommand('GetNumModels')) > nummodels1)
+
+class TestSDFCollision(EnvironmentSetup):
+    def test_comparechecker(self):
+        self.log.info('compare the collisions and distances of the sdf checker with the checker it wraps')
+        env=self.env
+        with env:
+            for name,boxes in [('floor',[[0,0,-0.05,0.5,0.5,0.05]]), ('wall',[[0.4,0,0.3,0.05,0.5,0.3]]), ('probe',[[0,0,0,0.05,0.05,0.05],[0.1,0,0,0.02,0.02,0.08]])]:
+                body=RaveCreateKinBody(env,'')
+                body.InitFromBoxes(array(boxes),True)
+                body.SetName(name)
+                env.Add(body)
+            probe=env.GetKinBody('probe')
+            # the default checker for the collisions, pqp for the distances
+            checkernames = [env.GetCollisionChecker().GetXMLId()]
+            if not 'pqp' in checkernames:
+                checkernames.append('pqp')
+            for checkername in checkernames:
+                checkerref=RaveCreateCollisionChecker(env,checkername)
+                checker=RaveCreateCollisionChecker(env,'sdfchecker '+checkername)
+                if checkerref is None or checker is None:
+                    continue
+                checkerref.InitEnvironment()
+                checker.InitEnvironment()
+                # probe has no dofs, so it would be static too
+                checker.SendCommand('SetStaticBodies floor wall')
+                bdistance = checkerref.SetCollisionOptions(CollisionOptions.Distance)
+                checkerref.SetCollisionOptions(0)
+                report=CollisionReport()
+                reportref=CollisionReport()
+                random.seed(0)
+                numcollisions = 0
+                for iter in range(200):
+                    T = matrixFromAxisAngle(random.rand(3)-0.5)
+                    T[0:3,3] = [-0.3+0.8*random.rand(), -0.3+0.6*random.rand(), -0.05+0.45*random.rand()]
+                    probe.SetTransform(T)
+                    collision = checkerref.CheckCollision(probe)
+                    assert(checker.CheckCollision(probe) == collision)
+                    numcollisions += collision
+                    # without the exact check the field is conservative
+                    checker.SendCommand('SetExactCheck 0')
+                    if collision:
+                        assert(checker.CheckCollision(probe))
+                    checker.SendCommand('SetExactCheck 1')
+                    if bdistance:
+                        checkerref.SetCollisionOptions(CollisionOptions.Distance)
+                        checker.SetCollisionOptions(CollisionOptions.Distance)
+                        assert(checker.CheckCollision(probe,report=report) == checkerref.CheckCollision(probe,report=reportref))
+                        if not collision:
+                            # the field gives a lower bound of the distance
+                            assert(report.minDistance <= reportref.minDistance+g_epsilon)
+                            assert(report.minDistance >= reportref.minDistance-0.1)
+                        checkerref.SetCollisionOptions(0)
+                        checker.SetCollisionOptions(0)
+                assert(numcollisions > 0 and numcollisions < 200)
+                fieldchecks,fieldfree,fallbacks,rebuilds = [int(s) for s in checker.SendCommand('GetStatistics').split()]
+                assert(fieldchecks > 0 and fieldfree > 0)
+
+    def test_grabbedstatic(self):
+        self.log.info('a grabbed body touching a static body is a collision of the robot')
+        env=self.env
+        with env:
+            for name,boxes in [('floor',[[0,0,-0.05,0.5,0.5,0.05]]), ('other',[[2,0,0,0.05,0.05,0.05]]), ('target',[[0,0,0,0.05,0.05,0.05]])]:
+                body=RaveCreateKinBody(env,'')
+                body.InitFromBoxes(array(boxes),True)
+                body.SetName(name)
+                env.Add(body)
+            robot=self.LoadRobotData("""<robot name="hand">
+  <kinbody>
+    <body name="base" type="dynamic">
+      <geom type="box">
+        <extents>0.05 0.05 0.05</extents>
+      </geom>
+    </body>
+  </kinbody>
+  <manipulator name="hand">
+    <base>base</base>
+    <effector>base</effector>
+  </manipulator>
+</robot>""")
+            other=env.GetKinBody('other')
+            target=env.GetKinBody('target')
+            # the hand is above the floor, the box it holds goes into it
+            robot.SetTransform(matrixFromPose([1,0,0,0,0,0,0.3]))
+            target.SetTransform(matrixFromPose([1,0,0,0,0,0,0.02]))
+            robot.Grab(target,robot.GetLinks()[0])
+            checkerref=RaveCreateCollisionChecker(env,'pqp')
+            checker=RaveCreateCollisionChecker(env,'sdfchecker pqp')
+            checkerref.InitEnvironment()
+            checker.InitEnvironment()
+            checker.SendCommand('SetStaticBodies floor')
+            for exactcheck in [1,0]:
+                checker.SendCommand('SetExactCheck %d'%exactcheck)
+                robot.SetTransform(matrixFromPose([1,0,0,0,0,0,0.3]))
+                assert(checkerref.CheckCollision(robot,[other],[]))
+                assert(checker.CheckCollision(robot,[other],[]))
+                robot.SetTransform(matrixFromPose([1,0,0,0,0,0,1.0]))
+                assert(not checkerref.CheckCollision(robot,[other],[]))
+                assert(not checker.CheckCollision(robot,[other],[]))
+
 #generate_classes(RunCollision, globals(), [('ode','ode'),('bullet','bullet')])
 
 class test_ode(RunCollision):
@@ -14,6 +14,7 @@
 from common_test_openrave import *
 from subprocess import Popen, PIPE
 import shutil
+import tempfile
 import threading
 
 class TestEnvironment(EnvironmentSetup):
@@ -84,7 +85,156 @@ class TestEnvironment(EnvironmentSetup):
                 for link in body3.GetLinks():
                     for geom in link.GetGeometries():
                         assert( transdist(geom.GetRenderScale(),scalefactor) <= g_epsilon )
-            
+
+    def test_loadsamemesh(self):
+        self.log.info('load the same mesh twice, the second load comes from the import cache')
+        env=self.env
+        with env:
+            scalefactor = array([2.0,3.0,4.0])
+            def getmeshes(body):
+                return [geom.GetCollisionMesh() for link in body.GetLinks() for geom in link.GetGeometries()]
+
+            body1=env.ReadKinBodyURI('data/mug1.kinbody.xml')
+            env.Add(body1,True)
+            meshes1 = getmeshes(body1)
+            body2=env.ReadKinBodyURI('data/mug1.kinbody.xml')
+            env.Add(body2,True)
+            meshes2 = getmeshes(body2)
+            assert(len(meshes1) == len(meshes2) and len(meshes1) > 0)
+            for mesh1,mesh2 in izip(meshes1,meshes2):
+                assert(len(mesh1.vertices) > 0)
+                assert(all(mesh1.indices==mesh2.indices))
+                assert(transdist(mesh1.vertices,mesh2.vertices) <= g_epsilon)
+
+            body3=env.ReadKinBodyURI('data/mug1.kinbody.xml',{'scalegeometry':'%f %f %f'%tuple(scalefactor)})
+            env.Add(body3,True)
+            for mesh1,mesh3 in izip(meshes1,getmeshes(body3)):
+                assert(all(mesh1.indices==mesh3.indices))
+                assert(transdist(mesh1.vertices*scalefactor,mesh3.vertices) <= g_epsilon)
+
+            # the loads share the imported meshes and a geometry copies its mesh when modified, so changing the first body does not change the other loads
+            link1 = body1.GetLinks()[0]
+            infos = [geom.GetInfo() for geom in link1.GetGeometries()]
+            for info in infos:
+                info._meshcollision.vertices += 0.1
+            link1.InitGeometries(infos)
+            for mesh1,mesh1changed in izip(meshes1,getmeshes(body1)):
+                assert(transdist(mesh1.vertices+0.1,mesh1changed.vertices) <= g_epsilon*len(mesh1.vertices))
+            for mesh1,mesh2 in izip(meshes1,getmeshes(body2)):
+                assert(transdist(mesh1.vertices,mesh2.vertices) <= g_epsilon)
+            body4=env.ReadKinBodyURI('data/mug1.kinbody.xml')
+            env.Add(body4,True)
+            for mesh1,mesh4 in izip(meshes1,getmeshes(body4)):
+                assert(transdist(mesh1.vertices,mesh4.vertices) <= g_epsilon)
+
+    def test_scenecache(self):
+        self.log.info('load a scene with the scene cache, the second load comes from the cache until an included file changes')
+        scenedir = tempfile.mkdtemp()
+        scenefilename = os.path.join(scenedir,'scene.env.xml')
+        open(scenefilename,'w').write("""<environment>
+  <kinbody name="arm" file="arm.kinbody.xml">
+    <translation>0.5 0 0</translation>
+  </kinbody>
+  <kinbody name="mug" file="data/mug1.kinbody.xml"/>
+</environment>
+""")
+        def writearm(length):
+            open(os.path.join(scenedir,'arm.kinbody.xml'),'w').write("""<kinbody name="arm">
+  <body name="base" type="dynamic">
+    <geom type="box">
+      <extents>0.1 0.1 0.05</extents>
+    </geom>
+  </body>
+  <body name="arm0" type="dynamic">
+    <offsetfrom>base</offsetfrom>
+    <translation>0 0 0.3</translation>
+    <geom type="box">
+      <extents>0.05 0.05 %f</extents>
+    </geom>
+  </body>
+  <joint name="j0" type="hinge">
+    <body>base</body>
+    <body>arm0</body>
+    <offsetfrom>base</offsetfrom>
+    <axis>0 0 1</axis>
+    <limitsdeg>-90 90</limitsdeg>
+  </joint>
+</kinbody>
+"""%length)
+
+        def loadscene():
+            env2=Environment()
+            try:
+                assert(env2.Load(scenefilename))
+                bodies = []
+                for body in env2.GetBodies():
+                    links = []
+                    for link in body.GetLinks():
+                        geometries = [(geom.GetType(),geom.GetTransform(),geom.GetBoxExtents(),geom.GetCollisionMesh()) for geom in link.GetGeometries()]
+                        links.append((link.GetName(),link.GetTransform(),geometries))
+                    joints = [(joint.GetName(),joint.GetType(),joint.GetDOFIndex(),joint.GetAnchor(),joint.GetAxis(0),joint.GetLimits()) for joint in body.GetJoints()]
+                    bodies.append((body.GetName(),body.GetKinematicsGeometryHash(),links,joints))
+                return bodies
+            finally:
+                env2.Destroy()
+
+        def comparescenes(bodies1,bodies2):
+            assert(len(bodies1) == len(bodies2))
+            for (name1,hash1,links1,joints1),(name2,hash2,links2,joints2) in izip(bodies1,bodies2):
+                assert(name1 == name2 and hash1 == hash2)
+                assert(len(links1) == len(links2))
+                for (linkname1,T1,geometries1),(linkname2,T2,geometries2) in izip(links1,links2):
+                    assert(linkname1 == linkname2)
+                    assert(transdist(T1,T2) <= g_epsilon)
+                    assert(len(geometries1) == len(geometries2))
+                    for (type1,Tgeom1,extents1,mesh1),(type2,Tgeom2,extents2,mesh2) in izip(geometries1,geometries2):
+                        assert(type1 == type2)
+                        assert(transdist(Tgeom1,Tgeom2) <= g_epsilon)
+                        assert(transdist(extents1,extents2) <= g_epsilon)
+                        assert(all(mesh1.indices == mesh2.indices))
+                        assert(transdist(mesh1.vertices,mesh2.vertices) <= g_epsilon)
+                assert(len(joints1) == len(joints2))
+                for (jointname1,type1,dofindex1,anchor1,axis1,limits1),(jointname2,type2,dofindex2,anchor2,axis2,limits2) in izip(joints1,joints2):
+                    assert(jointname1 == jointname2 and type1 == type2 and dofindex1 == dofindex2)
+                    assert(transdist(anchor1,anchor2) <= g_epsilon)
+                    assert(transdist(axis1,axis2) <= g_epsilon)
+                    assert(transdist(limits1,limits2) <= g_epsilon)
+
+        cachedir = os.path.join(RaveGetHomeDirectory(),'scenecache')
+        def getcachefiles():
+            return set(os.listdir(cachedir)) if os.path.exists(cachedir) else set()
+
+        OPENRAVE_SCENECACHE = os.environ.get('OPENRAVE_SCENECACHE',None)
+        os.environ['OPENRAVE_SCENECACHE'] = '1'
+        cachefilename = None
+        try:
+            writearm(0.2)
+            oldcachefiles = getcachefiles()
+            coldbodies = loadscene()
+            newcachefiles = getcachefiles()-oldcachefiles
+            assert(len(newcachefiles) == 1)
+            cachefilename = os.path.join(cachedir,newcachefiles.pop())
+            # a hit refreshes the modification time of the entry
+            os.utime(cachefilename,(0,0))
+            warmbodies = loadscene()
+            assert(os.path.getmtime(cachefilename) > 0)
+            comparescenes(coldbodies,warmbodies)
+
+            # editing the included file invalidates the entry
+            writearm(0.25)
+            editedbodies = loadscene()
+            assert(editedbodies[0][0] == 'arm' and editedbodies[0][1] != coldbodies[0][1])
+            assert(transdist(editedbodies[0][2][1][2][0][2],[0.05,0.05,0.25]) <= g_epsilon)
+            comparescenes(editedbodies,loadscene())
+        finally:
+            if OPENRAVE_SCENECACHE is None:
+                del os.environ['OPENRAVE_SCENECACHE']
+            else:
+                os.environ['OPENRAVE_SCENECACHE'] = OPENRAVE_SCENECACHE
+            if cachefilename is not None and os.path.exists(cachefilename):
+                os.remove(cachefilename)
+            shutil.rmtree(scenedir)
+
     def test_unicode(self):
         env=self.env
         name = 'テスト名前'.decode('utf-8')
@@ -262,3 +412,64 @@ class TestEnvironment(EnvironmentSetup):
         # thread is done, so should be able to lock
         assert(env.Lock(1.0))
         env.Unlock()
+
+    def test_staterecorder(self):
+        self.log.info('record the bodies of the environment with the state recorder and seek back to every snapshot')
+        env=self.env
+        self.LoadEnv('data/lab1.env.xml')
+        env.StopSimulation()
+        random.seed(0)
+        filename = 'test staterecorder.bin'
+        recorder = RaveCreateModule(env,'staterecorder')
+        def getstate():
+            state = {}
+            for body in env.GetBodies():
+                state[body.GetName()] = (body.GetLinkTransformations(), body.GetDOFValues())
+            grabbed = sorted([body.GetName() for body in robot.GetGrabbed()])
+            return state, grabbed
+
+        try:
+            with env:
+                robot=env.GetRobots()[0]
+                mug = env.GetKinBody('mug1')
+                # small chunks so that seeking has to switch chunks and replay the changed bodies of a chunk
+                assert(recorder.SendCommand('Start chunkframes 4 filename %s'%filename) is not None)
+                recorded = []
+                for i in range(15):
+                    if i % 3 == 0:
+                        robot.SetDOFValues(randlimits(*robot.GetDOFLimits()))
+                    if i % 5 == 1:
+                        T = robot.GetTransform()
+                        T[0:3,3] += random.rand(3)-0.5
+                        robot.SetTransform(T)
+                    if i == 4:
+                        robot.Grab(mug)
+                    if i == 10:
+                        robot.ReleaseAllGrabbed()
+                        mug.SetTransform(matrixFromAxisAngle(random.rand(3)))
+                    # the writer thread has to pick up the previous snapshot first
+                    while recorder.SendCommand('Record') == '0':
+                        time.sleep(0.01)
+                    recorded.append((env.GetSimulationTime(),getstate()))
+                    env.StepSimulation(0.01)
+                recorder.SendCommand('Stop')
+
+                numframes,firsttime,lasttime = [int(s) for s in recorder.SendCommand('Open %s'%filename).split()]
+                assert(numframes==len(recorded))
+                assert(firsttime==recorded[0][0] and lasttime==recorded[-1][0])
+                for index in random.permutation(len(recorded)):
+                    simtime,(expectedstate,expectedgrabbed) = recorded[index]
+                    robot.ReleaseAllGrabbed()
+                    robot.SetDOFValues(randlimits(*robot.GetDOFLimits()))
+                    # times between snapshots go to the previous snapshot
+                    for seektime in [simtime, simtime+5000]:
+                        assert(int(recorder.SendCommand('Seek %d'%seektime))==simtime)
+                        state,grabbed = getstate()
+                        assert(grabbed==expectedgrabbed)
+                        for name,(linktransforms,dofvalues) in expectedstate.iteritems():
+                            assert(transdist(state[name][0],linktransforms) <= g_epsilon)
+                            assert(transdist(state[name][1],dofvalues) <= g_epsilon)
+        finally:
+            recorder.SendCommand('Stop')
+            if os.path.exists(filename):
+                os.remove(filename)
@@ -13,6 +13,10 @@
 # limitations under the License.
 from common_test_openrave import *
 import imp
+import sys
+import shutil
+import tempfile
+from subprocess import Popen, PIPE
 
 log=logging.getLogger('openravepytest')
 
@@ -63,3 +67,58 @@ def test_ikparam():
     
     ikparam2 = ikparam*T
     ikparam2.GetTranslationDirection5D().pos()
+
+def test_pluginindex():
+    log.info('start openrave in new processes sharing the plugin index and check when the index is rebuilt')
+    homedir = tempfile.mkdtemp()
+    indexfilename = os.path.join(homedir,'plugins.index')
+    script = """from openravepy import *
+RaveInitialize(True,level=DebugLevel.Error)
+print sorted([(int(type),sorted(names)) for type,names in RaveGetLoadedInterfaces().iteritems()])
+RaveDestroy()
+"""
+    def getinterfaces():
+        environ = dict(os.environ)
+        environ['OPENRAVE_HOME'] = homedir
+        p = Popen([sys.executable,'-c',script],stdout=PIPE,env=environ)
+        out = p.communicate()[0]
+        assert(p.returncode == 0)
+        return out.strip().splitlines()[-1]
+
+    def modifyindex(fn):
+        # an entry is the library name followed by: mtime size isplugin version numtypes [type numnames names]...
+        lines = open(indexfilename).read().splitlines()
+        for i in range(1,len(lines),2):
+            values = lines[i+1].split()
+            if values[2] == '1' and int(values[4]) > 0 and int(values[6]) > 0:
+                fn(lines,values)
+                lines[i+1] = ' '.join(values)
+                break
+        open(indexfilename,'w').write('\n'.join(lines)+'\n')
+
+    def renameinterface(lines,values):
+        values[7] = 'pluginindextest'
+    def changemtime(lines,values):
+        values[0] = str(int(values[0])+1)
+    def changesize(lines,values):
+        values[1] = str(int(values[1])+1)
+    def changehash(lines,values):
+        lines[0] = ' '.join(lines[0].split()[0:2]+['0'*32])
+
+    try:
+        interfaces = getinterfaces()
+        assert(os.path.exists(indexfilename))
+        indexdata = open(indexfilename).read()
+        # the second start reads the plugin attributes from the index and leaves it as it is
+        assert(getinterfaces() == interfaces)
+        assert(open(indexfilename).read() == indexdata)
+        # the entries are used as long as the files do not change
+        modifyindex(renameinterface)
+        assert(getinterfaces().find('pluginindextest') >= 0)
+        for changefn in [changemtime,changesize,changehash]:
+            modifyindex(renameinterface)
+            modifyindex(changefn)
+            assert(getinterfaces() == interfaces)
+            assert(open(indexfilename).read() == indexdata)
+    finally:
+        shutil.rmtree(homedir)
@@ -0,0 +1,111 @@
+# -*- coding: utf-8 -*-
+# Copyright (C) 2012 Rosen Diankov <rosen.diankov@gmail.com>
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+from common_test_openrave import *
+
+# parallel gripper made only of boxes so the grasps do not depend on the mesh importers
+_gripperxml = """<robot name="gripper">
+  <kinbody>
+    <body name="palm" type="dynamic">
+      <geom type="box">
+        <extents>0.02 0.08 0.01</extents>
+      </geom>
+    </body>
+    <body name="finger0" type="dynamic">
+      <offsetfrom>palm</offsetfrom>
+      <translation>0 0.07 0.06</translation>
+      <geom type="box">
+        <extents>0.01 0.005 0.05</extents>
+      </geom>
+    </body>
+    <body name="finger1" type="dynamic">
+      <offsetfrom>palm</offsetfrom>
+      <translation>0 -0.07 0.06</translation>
+      <geom type="box">
+        <extents>0.01 0.005 0.05</extents>
+      </geom>
+    </body>
+    <joint name="j0" type="slider">
+      <body>palm</body>
+      <body>finger0</body>
+      <offsetfrom>finger0</offsetfrom>
+      <axis>0 -1 0</axis>
+      <limits>0 0.07</limits>
+    </joint>
+    <joint name="j1" type="slider">
+      <body>palm</body>
+      <body>finger1</body>
+      <offsetfrom>finger1</offsetfrom>
+      <axis>0 1 0</axis>
+      <limits>0 0.07</limits>
+    </joint>
+  </kinbody>
+  <manipulator name="hand">
+    <base>palm</base>
+    <effector>palm</effector>
+    <joints>j0 j1</joints>
+    <closingdirection>1 1</closingdirection>
+    <direction>0 0 1</direction>
+  </manipulator>
+</robot>
+"""
+
+class TestGrasping(EnvironmentSetup):
+    def test_graspthreaded(self):
+        self.log.info('stop GraspThreaded after maxforceclosuregrasps and resume it from the returned grasp id')
+        env=self.env
+        robot=self.LoadRobotData(_gripperxml)
+        target=RaveCreateKinBody(env,'')
+        target.InitFromBoxes(array([[0,0,0,0.03,0.03,0.06]]),True)
+        target.SetName('target')
+        env.Add(target)
+        with env:
+            manip=robot.SetActiveManipulator('hand')
+            robot.SetActiveDOFs(manip.GetGripperIndices(),DOFAffine.X+DOFAffine.Y+DOFAffine.Z)
+            grasper=interfaces.Grasper(robot,friction=0.4)
+
+        # rays on the sides of the box pointing inside, two of them are shifted so that the hand misses the box
+        approachrays = []
+        for iz,z in enumerate([-0.03,0,0.03]):
+            for axis,sign in [(0,1),(0,-1),(1,1),(1,-1)]:
+                position = array([0.0,0.0,z])
+                position[axis] = 0.03*sign
+                direction = zeros(3)
+                direction[axis] = -sign
+                if (iz,axis,sign) in [(1,1,-1),(2,0,1)]:
+                    position[2] += 0.5
+                approachrays.append(r_[position,direction])
+        approachrays = array(approachrays)
+        kwargs = {'approachrays':approachrays, 'standoffs':array([0.0]), 'preshapes':array([[0.0,0.0]]), 'rolls':array([0,pi/2]), 'manipulatordirections':array([[0,0,1.0]]), 'target':target, 'forceclosurethreshold':1e-9}
+        numgrasps = len(approachrays)*2
+        def getkeys(grasps):
+            return [tuple(grasp[0])+tuple(grasp[1])+(grasp[2],grasp[3]) for grasp in grasps]
+
+        nextid,grasps = grasper.GraspThreaded(numthreads=1,**kwargs)
+        assert(nextid==numgrasps)
+        refkeys = getkeys(grasps)
+        assert(0 < len(refkeys) and len(refkeys) < numgrasps)
+
+        maxforceclosuregrasps = 3
+        for numthreads in [1,4]:
+            nextid,grasps = grasper.GraspThreaded(numthreads=numthreads,maxforceclosuregrasps=maxforceclosuregrasps,**kwargs)
+            keys = getkeys(grasps)
+            assert(len(set(keys))==len(keys))
+            assert(len([grasp for grasp in grasps if grasp[5] > 0]) >= maxforceclosuregrasps)
+            if numthreads == 1:
+                assert(len(grasps)==maxforceclosuregrasps)
+            assert(nextid < numgrasps)
+            # all the grasps below nextid were evaluated, so resuming returns exactly the remaining grasps
+            nextid2,grasps2 = grasper.GraspThreaded(numthreads=numthreads,startindex=nextid,**kwargs)
+            assert(nextid2==numgrasps)
+            assert(keys+getkeys(grasps2)==refkeys)
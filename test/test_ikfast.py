@@ -287,7 +287,31 @@ def test_robot_ikfast():
         # for some reason the plugindatabase _threadPluginLoader thread is on a different process
         # than the main threading waiting for it to finish, so it is necessary to call RaveDestroy
         RaveDestroy()
-    
+
+def test_computereachability():
+    log.info('compare the reachability computed by the threaded ikfast module command with the serial computation')
+    envlocal=Environment()
+    envlocal.StopSimulation()
+    try:
+        # puma comes with its ik solver, so nothing has to be generated
+        robot=envlocal.ReadRobotURI('robots/puma.robot.xml')
+        envlocal.Add(robot)
+        rmodel = databases.kinematicreachability.ReachabilityModel(robot)
+        results = []
+        for numthreads in [None,4]:
+            rmodel.generate(xyzdelta=0.25,quatdelta=1.0,numthreads=numthreads)
+            # the rotations can come out with the opposite quaternion sign, so only compare the positions and solutions
+            stats = sorted([tuple(numpy.round(stat[4:7],6))+(stat[7],) for stat in rmodel.reachabilitystats])
+            results.append((rmodel.reachability3d,rmodel.reachabilitydensity3d,stats))
+        reachability3d,reachabilitydensity3d,stats = results[0]
+        assert(sum(reachability3d) > 0)
+        for reachability3dthreaded,reachabilitydensity3dthreaded,statsthreaded in results[1:]:
+            assert(all(reachability3dthreaded==reachability3d))
+            assert(all(reachabilitydensity3dthreaded==reachabilitydensity3d))
+            assert(statsthreaded==stats)
+    finally:
+        envlocal.Destroy()
+
 if __name__ == "__main__":
     import test_ikfast
     options = parseoptions()
@@ -94,6 +94,62 @@ class TestIkSolver(EnvironmentSetup):
             sampler=planningutils.ManipulatorIKGoalSampler(robot.GetActiveManipulator(),[ikparam],nummaxsamples=20,nummaxtries=10,jitter=0.03)
             assert(sampler.Sample() is not None)
 
+    def test_parallelsampler(self):
+        self.log.info('sample ik goals with worker threads and check the solutions against the parameterizations')
+        env=self.env
+        self.LoadEnv('data/lab1.env.xml')
+        robot=env.GetRobots()[0]
+        ikmodel = databases.inversekinematics.InverseKinematicsModel(robot,IkParameterization.Type.Transform6D)
+        if not ikmodel.load():
+            ikmodel.autogenerate()
+
+        with env:
+            manip = ikmodel.manip
+            lower,upper = robot.GetDOFLimits(manip.GetArmIndices())
+            ikparams = []
+            while len(ikparams) < 10:
+                robot.SetDOFValues(randlimits(lower,upper),manip.GetArmIndices())
+                if not robot.CheckSelfCollision() and not env.CheckCollision(robot):
+                    ikparams.append(manip.GetIkParameterization(IkParameterizationType.Transform6D))
+            sampler=planningutils.ManipulatorIKGoalSampler(manip,ikparams,nummaxsamples=20,nummaxtries=10,jitter=0)
+            sampler.SetParallel(3,4)
+            numsamples = 0
+            for i in range(20):
+                sol = sampler.Sample()
+                if sol is None:
+                    break
+                ikparam = ikparams[sampler.GetIkParameterizationIndex(numsamples)]
+                numsamples += 1
+                robot.SetDOFValues(sol,manip.GetArmIndices())
+                assert(transdist(manip.GetTransform(),ikparam.GetTransform6D()) <= g_epsilon)
+                assert(not robot.CheckSelfCollision() and not env.CheckCollision(robot))
+            assert(numsamples > 0)
+            sampler.SetParallel(0)
+
+            # the robot in collision can only be sampled with jitter, the workers jitter their own copy of the parameterization
+            robot.SetDOFValues([ -8.44575603e-02,   1.48528347e+00,  -5.09108824e-08, 6.48108822e-01,  -4.57571203e-09,  -1.04008750e-08, 7.26855048e-10,   5.50807826e-08,   5.50807826e-08, -1.90689327e-08,   0.00000000e+00])
+            ikparam=manip.GetIkParameterization(IkParameterizationType.Transform6D)
+            sampler=planningutils.ManipulatorIKGoalSampler(manip,[ikparam],nummaxsamples=20,nummaxtries=10,jitter=0)
+            sampler.SetParallel(2)
+            assert(sampler.Sample() is None)
+            sampler=planningutils.ManipulatorIKGoalSampler(manip,[ikparam],nummaxsamples=20,nummaxtries=10,jitter=0.03)
+            sampler.SetParallel(2)
+            sol = sampler.Sample()
+            assert(sol is not None)
+            robot.SetDOFValues(sol,manip.GetArmIndices())
+            assert(not env.CheckCollision(robot))
+            assert(transdist(manip.GetTransform()[0:3,3],ikparam.GetTransform6D()[0:3,3]) <= sqrt(3)*0.03+g_epsilon)
+            sampler.SetParallel(0)
+
+            # python filters cannot be called from the workers
+            def filter1(sol,manip,ikparam):
+                return IkReturnAction.Success
+            handle = manip.GetIkSolver().RegisterCustomFilter(0,filter1)
+            sampler=planningutils.ManipulatorIKGoalSampler(manip,[ikparam],nummaxsamples=20,nummaxtries=10,jitter=0.03)
+            assert_raises(openrave_exception,sampler.SetParallel,2)
+            assert(sampler.Sample() is not None)
+            handle.close()
+
     def test_jointlimitsfilter(self):
         env=self.env
         self.LoadEnv('data/lab1.env.xml')
@@ -12,6 +12,7 @@
 # See the License for the specific language governing permissions and
 # limitations under the License.
 from common_test_openrave import *
+import threading
 
 class TestKinematics(EnvironmentSetup):
     def test_bodybasic(self):
@@ -527,6 +528,56 @@ class TestKinematics(EnvironmentSetup):
                         assert( transdist(-torquegravity, gravitypartials) < 0.1*deltastep*len(gravitypartials))
                         assert( transdist(torquegravity, testtorque_e-testtorque_e2) <= 1e-10 )
 
+    def test_inversedynamicsbatch(self):
+        self.log.info('compare the batched inverse dynamics with ComputeInverseDynamics for every state')
+        env=self.env
+        with env:
+            for envfile in ['robots/wam7.kinbody.xml', 'robots/barretthand.robot.xml', 'robots/barrettwam.robot.xml']:
+                env.Reset()
+                self.LoadEnv(envfile,{'skipgeometry':'1'})
+                body = [body for body in env.GetBodies() if body.GetDOF() > 0][0]
+                env.GetPhysicsEngine().SetGravity(random.rand(3)*10-5)
+                lower,upper = body.GetDOFLimits()
+                vellimits = body.GetDOFVelocityLimits()
+                link0vel = [random.rand(3)-0.5,random.rand(3)-0.5]
+                numstates = 20
+                dofvalues = array([randlimits(lower,upper) for i in range(numstates)])
+                dofvelocities = array([randlimits(-vellimits,vellimits) for i in range(numstates)])
+                dofaccelerations = 10*random.rand(numstates,body.GetDOF())-5
+                def ComputeSerial(velocities,accelerations):
+                    torques = []
+                    for istate in range(numstates):
+                        body.SetDOFValues(dofvalues[istate])
+                        body.SetDOFVelocities(velocities[istate],*link0vel)
+                        torques.append(body.ComputeInverseDynamics(accelerations[istate]))
+                    # the batch moves the base link with its current velocity
+                    body.SetDOFVelocities(zeros(body.GetDOF()),*link0vel)
+                    return array(torques)
+
+                def CheckTorques(torques,expected):
+                    assert(torques.shape == expected.shape)
+                    assert(transdist(torques,expected) <= g_epsilon*max(1.0,numpy.max(abs(expected))))
+
+                expected = ComputeSerial(dofvelocities,dofaccelerations)
+                CheckTorques(body.ComputeInverseDynamicsBatch(dofvalues,dofvelocities,dofaccelerations),expected)
+                CheckTorques(body.ComputeInverseDynamicsBatch(dofvalues),ComputeSerial(zeros(dofvalues.shape),zeros(dofvalues.shape)))
+                assert_raises(openrave_exception,body.ComputeInverseDynamicsBatch,dofvalues,dofvelocities[:-1])
+
+                # the compiled tree has to follow the masses, and threads compiling it at the same time get the same torques
+                link = body.GetLinks()[-1]
+                link.SetMass(link.GetMass()+1)
+                expected = ComputeSerial(dofvelocities,dofaccelerations)
+                threadresults = [None]*4
+                def ComputeThread(ithread):
+                    threadresults[ithread] = body.ComputeInverseDynamicsBatch(dofvalues,dofvelocities,dofaccelerations,True)
+                threads = [threading.Thread(target=ComputeThread,args=(ithread,)) for ithread in range(len(threadresults))]
+                for t in threads:
+                    t.start()
+                for t in threads:
+                    t.join()
+                for torques in threadresults:
+                    CheckTorques(torques,expected)
+
     def test_hessian(self):
         self.log.info('check the jacobian and hessian computation')
         env=self.env
@@ -589,6 +640,44 @@ class TestKinematics(EnvironmentSetup):
                         coeffs1,residuals, rank, singular_values, rcond=polyfit(mults,errsecond/errsecond[-1],3,full=True)
                         assert(residuals<0.01)
                         
+    def test_jacobianchains(self):
+        self.log.info('check the jacobians computed from the cached chains against CalculateJacobian and finite differences')
+        env=self.env
+        self.LoadEnv('robots/barrettwam.robot.xml',{'skipgeometry':'1'})
+        body = env.GetBodies()[0]
+        lowerlimit,upperlimit = body.GetDOFLimits()
+        dof = body.GetDOF()
+        # more index sets than the chains cached per link, so chains get evicted and compiled again
+        vindices = [None]+[random.permutation(dof)[:random.randint(1,dof+1)] for i in range(10)]
+        deltastep = 1e-6
+        for iter in range(5):
+            dofvalues = randlimits(numpy.minimum(lowerlimit+2*deltastep,upperlimit), numpy.maximum(upperlimit-2*deltastep,lowerlimit))
+            body.SetDOFValues(dofvalues)
+            for ilink,link in enumerate(body.GetLinks()):
+                position = link.GetTransform()[0:3,3] + random.rand(3)-0.5
+                Jt = body.CalculateJacobian(ilink,position)
+                Ja = body.CalculateAngularVelocityJacobian(ilink)
+                # translation derivatives of the point attached to the link
+                localposition = TransformInversePoints(link.GetTransform(),[position])[0]
+                Jtnumerical = zeros((3,dof))
+                for idof in range(dof):
+                    deltavalues = zeros(dof)
+                    deltavalues[idof] = deltastep
+                    body.SetDOFValues(dofvalues+deltavalues)
+                    p1 = TransformPoints(link.GetTransform(),[localposition])[0]
+                    body.SetDOFValues(dofvalues-deltavalues)
+                    p0 = TransformPoints(link.GetTransform(),[localposition])[0]
+                    Jtnumerical[:,idof] = (p1-p0)/(2*deltastep)
+                body.SetDOFValues(dofvalues)
+                assert(transdist(Jt,Jtnumerical) <= 1e-5)
+                for indices in vindices:
+                    J = body.ComputeJacobianTranslationAxisAngle(ilink,position,indices)
+                    columns = range(dof) if indices is None else indices
+                    assert(transdist(J[0:3],Jt[:,columns]) <= g_epsilon)
+                    assert(transdist(J[3:6],Ja[:,columns]) <= g_epsilon)
+                    assert(transdist(J[0:3],body.ComputeJacobianTranslation(ilink,position,indices)) <= g_epsilon)
+                    assert(transdist(J[3:6],body.ComputeJacobianAxisAngle(ilink,indices)) <= g_epsilon)
+
     def test_initkinbody(self):
         self.log.info('tests initializing a kinematics body')
         env=self.env
@@ -706,6 +795,98 @@ class TestKinematics(EnvironmentSetup):
                         vmax = numpy.max(geom.GetCollisionMesh().vertices,0)
                         assert( transdist(0.5*(vmax-vmin),extents) <= g_epsilon )
 
+    def test_spheretree(self):
+        self.log.info('check the link sphere trees and the generated spheres geometry group')
+        env=self.env
+        with env:
+            robot=self.LoadRobot('robots/barrettwam.robot.xml')
+            for link in robot.GetLinks():
+                trimesh = link.GetCollisionData()
+                spheretree = link.GetSphereTree()
+                if len(trimesh.indices) == 0:
+                    assert(spheretree is None)
+                    assert(link.GetGroupNumGeometries('spheres') == -1)
+                    continue
+                spheres, children, leaves = spheretree
+                assert(len(spheres) == len(children))
+                # the root encloses the whole mesh
+                assert(all(sqrt(sum((trimesh.vertices-spheres[0][0:3])**2,1)) <= spheres[0][3]+g_epsilon))
+                for ileaf in leaves:
+                    assert(children[ileaf] == (-1,-1))
+                geometryinfos = link.GetGeometriesFromGroup('spheres')
+                assert(len(geometryinfos) == len(leaves))
+                assert(link.GetGroupNumGeometries('spheres') == len(leaves))
+                for geometryinfo, ileaf in zip(geometryinfos, leaves):
+                    assert(geometryinfo._type == GeometryType.Sphere)
+                    assert(transdist(geometryinfo._t[0:3,3], spheres[ileaf][0:3]) <= g_epsilon)
+                    assert(abs(geometryinfo._vGeomData[0]-spheres[ileaf][3]) <= g_epsilon)
+
+            # setting the group keeps it, the default geometries generate it from the original mesh again
+            link = robot.GetLinks()[1]
+            spheres = link.GetSphereTree()[0]
+            numspheres = link.GetGroupNumGeometries('spheres')
+            link.SetGeometriesFromGroup('spheres')
+            assert(len(link.GetGeometries()) == numspheres)
+            assert(link.GetGroupNumGeometries('spheres') == numspheres)
+            link.SetGeometriesFromGroup('')
+            assert(link.GetGroupNumGeometries('spheres') == numspheres)
+            assert(transdist(link.GetSphereTree()[0], spheres) <= g_epsilon)
+
+    def test_changecallbacks(self):
+        self.log.info('check the dispatch of the change callbacks, registering during a dispatch and suspending them')
+        env=self.env
+        with env:
+            robot=self.LoadRobot('robots/barrettwam.robot.xml')
+            values = robot.GetDOFValues()
+            calls = []
+            handle0 = robot.RegisterChangeCallback(KinBodyProperty.LinkTransforms, lambda: calls.append(0))
+            handle1 = robot.RegisterChangeCallback(KinBodyProperty.LinkTransforms|KinBodyProperty.Name, lambda: calls.append(1))
+            robot.SetDOFValues(values)
+            assert(calls == [0,1])
+
+            # a callback registered for several properties is called once for every one of them that changed, from the lowest property
+            del calls[:]
+            with robot.CreateChangeCallbackSuspender():
+                robot.SetDOFValues(values)
+                with robot.CreateChangeCallbackSuspender():
+                    robot.SetName('changecallbacks')
+                robot.SetDOFValues(values)
+                assert(len(calls) == 0)
+            assert(calls == [1,0,1])
+
+            # callbacks registered during a dispatch are called starting with the next one
+            del calls[:]
+            handles = []
+            def registercallback():
+                calls.append(2)
+                if len(handles) == 0:
+                    handles.append(robot.RegisterChangeCallback(KinBodyProperty.LinkTransforms, lambda: calls.append(3)))
+            handle2 = robot.RegisterChangeCallback(KinBodyProperty.LinkTransforms, registercallback)
+            robot.SetDOFValues(values)
+            assert(calls == [0,1,2])
+            del calls[:]
+            robot.SetDOFValues(values)
+            assert(calls == [0,1,2,3])
+
+            # callbacks unregistered during a dispatch are not called anymore, even later in the same dispatch
+            del calls[:]
+            handle0 = None
+            handle2 = None
+            del handles[:]
+            unregisterhandles = []
+            def unregistercallback():
+                calls.append(4)
+                del unregisterhandles[:]
+            handle4 = robot.RegisterChangeCallback(KinBodyProperty.LinkTransforms, unregistercallback)
+            unregisterhandles.append(robot.RegisterChangeCallback(KinBodyProperty.LinkTransforms, lambda: calls.append(5)))
+            robot.SetDOFValues(values)
+            assert(calls == [1,4])
+            del calls[:]
+            handle1 = None
+            handle4 = None
+            robot.SetDOFValues(values)
+            assert(len(calls) == 0)
+
     def test_hashes(self):
         robot = self.LoadRobot(g_robotfiles[0])
         s = robot.serialize(SerializationOptions.Kinematics)
@@ -1110,6 +1291,62 @@ class TestKinematics(EnvironmentSetup):
             assert(body.GetLinks()[0].GetStringParameters('jp') == u'\u65e5\u672c\u8a9e')
             assert(body.GetJoints()[0].GetStringParameters('test2') == 'has spaces')
 
+    def test_bufferinto(self):
+        self.log.info('compare the functions writing into preallocated arrays with the ones returning new arrays')
+        env=self.env
+        self.LoadEnv('data/lab1.env.xml')
+        with env:
+            robot=env.GetRobots()[0]
+            lower,upper = robot.GetDOFLimits()
+            indices = arange(0,robot.GetDOF(),2)
+            values = zeros(robot.GetDOF())
+            indexvalues = zeros(len(indices))
+            transforms = zeros((len(robot.GetLinks()),4,4))
+            poses = zeros((len(robot.GetLinks()),7))
+            for iter in range(10):
+                robot.SetDOFValues(randlimits(lower,upper))
+                robot.GetDOFValuesInto(values)
+                assert(transdist(values,robot.GetDOFValues()) <= g_epsilon)
+                robot.GetDOFValuesInto(indexvalues,indices)
+                assert(transdist(indexvalues,robot.GetDOFValues(indices)) <= g_epsilon)
+                robot.GetLinkTransformationsInto(transforms)
+                assert(transdist(transforms,robot.GetLinkTransformations()) <= g_epsilon)
+                robot.GetLinkTransformationsInto(poses)
+                assert(transdist(poses,[link.GetTransformPose() for link in robot.GetLinks()]) <= g_epsilon)
+            assert_raises(openrave_exception,robot.GetDOFValuesInto,zeros(1),[robot.GetDOF()])
+            assert_raises(openrave_exception,robot.GetDOFValuesInto,zeros(1),[-1])
+            assert_raises(openrave_exception,robot.GetDOFValuesInto,zeros(robot.GetDOF()+1))
+            assert_raises(openrave_exception,robot.GetLinkTransformationsInto,zeros(16*len(robot.GetLinks())))
+
+            configs = array([randlimits(lower,upper) for i in range(20)])
+            valuesbefore = robot.GetDOFValues()
+            results = robot.CheckCollisionBatch(configs,None,None,True)
+            assert(transdist(robot.GetDOFValues(),valuesbefore) <= g_epsilon)
+            expected = []
+            for config in configs:
+                robot.SetDOFValues(config)
+                expected.append(env.CheckCollision(robot) or robot.CheckSelfCollision())
+            robot.SetDOFValues(valuesbefore)
+            assert(all(results == array(expected)))
+
+        self.log.info('check batches from several threads, each with its own environment and the GIL released')
+        envs = [env.CloneSelf(CloningOptions.Bodies) for i in range(3)]
+        try:
+            threadresults = [None]*len(envs)
+            def CheckThread(ienv):
+                with envs[ienv]:
+                    threadresults[ienv] = envs[ienv].GetRobots()[0].CheckCollisionBatch(configs,None,None,True,True)
+            threads = [threading.Thread(target=CheckThread,args=(ienv,)) for ienv in range(len(envs))]
+            for t in threads:
+                t.start()
+            for t in threads:
+                t.join()
+            for result in threadresults:
+                assert(all(result == results))
+        finally:
+            for envclone in envs:
+                envclone.Destroy()
+
     def test_paddinggeometry(self):
         env=self.env
         robot=self.LoadRobot('robots/barrettwam.robot.xml')
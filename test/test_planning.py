@@ -601,6 +601,64 @@ class RunPlanning(EnvironmentSetup):
             self.RunTrajectory(robot,traj1)
             self.RunTrajectory(robot,traj2)
 
+    def test_trajectoryverifier(self):
+        self.log.info('compare the threaded trajectory verifier with VerifyTrajectory')
+        env=self.env
+        self.LoadEnv('data/lab1.env.xml')
+        with env:
+            robot = env.GetRobots()[0]
+            manip = robot.GetActiveManipulator()
+            robot.SetActiveDOFs(manip.GetArmIndices())
+            parameters = Planner.PlannerParameters()
+            parameters.SetRobotActiveJoints(robot)
+            lower,upper = robot.GetActiveDOFLimits()
+            samplingstep = 0.002
+            verifiers = []
+            for numthreads in [0,2]:
+                verifier = planningutils.ActiveDOFTrajectoryVerifier(robot,numthreads)
+                verifier.SetSamplingSteps(0.05,samplingstep)
+                verifier.SetCacheSize(0)
+                verifiers.append(verifier)
+
+            def SampleFreeConfiguration():
+                with robot:
+                    while True:
+                        values = randlimits(lower,upper)
+                        robot.SetActiveDOFValues(values)
+                        if not env.CheckCollision(robot) and not robot.CheckSelfCollision():
+                            return values
+
+            def CheckTrajectories():
+                for itraj in range(6):
+                    traj = RaveCreateTrajectory(env,'')
+                    traj.Init(robot.GetActiveConfigurationSpecification('linear'))
+                    traj.Insert(0,r_[SampleFreeConfiguration(),SampleFreeConfiguration()])
+                    planningutils.RetimeActiveDOFTrajectory(traj,robot,False,1,1,'LinearTrajectoryRetimer')
+                    with robot:
+                        try:
+                            planningutils.VerifyTrajectory(parameters,traj,samplingstep=samplingstep)
+                            expectedvalid = True
+                        except openrave_exception:
+                            expectedvalid = False
+                    activedofvalues = robot.GetActiveDOFValues()
+                    for verifier in verifiers:
+                        valid, timecollision = verifier.Verify(traj)
+                        assert(valid == expectedvalid)
+                        assert(transdist(robot.GetActiveDOFValues(),activedofvalues) <= g_epsilon)
+                        if not valid:
+                            with robot:
+                                robot.SetActiveDOFValues(traj.GetConfigurationSpecification().ExtractJointValues(traj.Sample(timecollision),robot,robot.GetActiveDOFIndices()))
+                                assert(env.CheckCollision(robot) or robot.CheckSelfCollision())
+
+            CheckTrajectories()
+            # the clones only copy the state of the bodies that changed, including the joints that are not active
+            robot.SetDOFValues(randlimits(*robot.GetDOFLimits(manip.GetGripperIndices())),manip.GetGripperIndices())
+            body = env.GetKinBody('mug1')
+            T = body.GetTransform()
+            T[0:3,3] = manip.GetTransform()[0:3,3]+[0,0,0.2]
+            body.SetTransform(T)
+            CheckTrajectories()
+
     def test_jittertransform(self):
         env=self.env
         self.LoadEnv('data/lab1.env.xml')
@@ -615,6 +673,44 @@ class RunPlanning(EnvironmentSetup):
             assert(success)
             assert(not env.CheckCollision(collisionbody))
 
+    def test_jitteractivedofbatch(self):
+        self.log.info('jitter a robot that starts in collision with the batched search and the configuration jitterer')
+        env=self.env
+        with env:
+            robot=self.LoadRobot('robots/barrettwam.robot.xml')
+            robot.SetActiveDOFs(robot.GetActiveManipulator().GetArmIndices())
+            orgvalues = robot.GetActiveDOFValues()
+            # a small box around the vertex of the hand that is the farthest from the base puts the robot in collision
+            link = robot.GetActiveManipulator().GetEndEffector()
+            vertices = transformPoints(link.GetTransform(),link.GetCollisionData().vertices)
+            vertex = vertices[argmax(sum((vertices-robot.GetTransform()[0:3,3])**2,1))]
+            box = RaveCreateKinBody(env,'')
+            box.SetName('obstacle')
+            box.InitFromBoxes(array([r_[vertex,0.005,0.005,0.005]]),True)
+            env.Add(box)
+            assert(env.CheckCollision(robot))
+
+            maxjitter = 0.1
+            for numthreads in [0,2]:
+                robot.SetActiveDOFValues(orgvalues)
+                ret = planningutils.JitterActiveDOFBatch(robot,jitter=maxjitter,batchsize=16,numthreads=numthreads)
+                assert(ret == 1)
+                assert(not env.CheckCollision(robot) and not robot.CheckSelfCollision())
+                assert(all(abs(robot.GetActiveDOFValues()-orgvalues) <= maxjitter))
+            assert(planningutils.JitterActiveDOFBatch(robot) == -1)
+
+            jitterer = RaveCreateSpaceSampler(env,'ConfigurationJitterer %s'%robot.GetName())
+            jitterer.SendCommand('SetMaxJitter %f'%maxjitter)
+            for batchsize, numthreads in [(1,0),(16,0),(16,2)]:
+                robot.SetActiveDOFValues(orgvalues)
+                jitterer.SendCommand('SetBatchSize %d %d'%(batchsize,numthreads))
+                values = jitterer.SampleSequence(SampleDataType.Real,1)
+                assert(len(values) == robot.GetActiveDOF())
+                assert(transdist(robot.GetActiveDOFValues(),values) <= g_epsilon)
+                assert(not env.CheckCollision(robot) and not robot.CheckSelfCollision())
+                assert(all(abs(values-orgvalues) <= maxjitter))
+            assert(len(jitterer.SampleSequence(SampleDataType.Real,1)) == 0)
+
 #generate_classes(RunPlanning, globals(), [('ode','ode'),('bullet','bullet')])
 
 class test_ode(RunPlanning):
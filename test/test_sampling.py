@@ -56,3 +56,81 @@ class TestSampling(EnvironmentSetup):
         robot.SetActiveDOFs(range(robot.GetDOF()-4),Robot.DOFAffine.X|Robot.DOFAffine.Y|Robot.DOFAffine.RotationAxis,[0,0,1])
         values = sp.SampleSequence(SampleDataType.Real,1)
         assert(len(values[0]) == robot.GetActiveDOF())
+
+    def test_bulksampling(self):
+        self.log.info('check that sampling many values in one call returns the same values as sampling them one at a time')
+        N = 2000 # more values than the 624 words of the mt19937 and sfmt19937 states, so the states are regenerated inside one call
+        for samplername in ['mt19937','sfmt19937','halton']:
+            for dim in [1,5]:
+                for type in [SampleDataType.Real, SampleDataType.Uint32]:
+                    sp0=RaveCreateSpaceSampler(self.env,samplername)
+                    sp1=RaveCreateSpaceSampler(self.env,samplername)
+                    if sp0 is None or not sp0.Supports(type):
+                        continue
+                    self.log.debug('name=%s, type=%s, dim=%d',samplername,type,dim)
+                    for sp in [sp0,sp1]:
+                        sp.SetSpaceDOF(dim)
+                        sp.SetSeed(1234)
+                    bulkvalues = sp0.SampleSequence(type,N)
+                    singlevalues = hstack([sp1.SampleSequence(type,1) for i in range(N)])
+                    assert(len(bulkvalues) == N*dim and all(bulkvalues == singlevalues))
+                    # the next call continues the same stream
+                    assert(all(sp0.SampleSequence(type,3) == hstack([sp1.SampleSequence(type,1) for i in range(3)])))
+
+    def test_bulksampling_reference(self):
+        self.log.info('check the bulk samplers against reference sequences')
+        sp=RaveCreateSpaceSampler(self.env,'mt19937')
+        sp.SetSeed(5489)
+        values = sp.SampleSequence(SampleDataType.Uint32,10000)
+        # the first and the 10000th output of std::mt19937 with its default seed
+        assert(values[0] == 3499211612 and values[9999] == 4123659995)
+
+        sp=RaveCreateSpaceSampler(self.env,'sfmt19937')
+        if sp is not None:
+            sp.SetSeed(1234)
+            # the first outputs of the reference SFMT19937 implementation for init_gen_rand(1234)
+            assert(all(sp.SampleSequence(SampleDataType.Uint32,5) == [3440181298, 1564997079, 1510669302, 2930277156, 1452439940]))
+
+        # the incremental halton sequence is the radical inverse of the indices 0, 1, ... in the first primes
+        def radicalinverse(index,base):
+            f = 0.0
+            scale = 1.0/base
+            while index > 0:
+                f += (index%base)*scale
+                index //= base
+                scale /= base
+            return f
+        sp=RaveCreateSpaceSampler(self.env,'halton')
+        sp.SetSpaceDOF(3)
+        values = reshape(hstack([sp.SampleSequence(SampleDataType.Real,100), sp.SampleSequence(SampleDataType.Real,900)]),(1000,3))
+        for i in range(len(values)):
+            for j,base in enumerate([2,3,5]):
+                assert(abs(values[i][j]-radicalinverse(i,base)) <= g_epsilon)
+
+    def test_robotbulksampling(self):
+        self.log.info('check that the robot configuration sampler maps the samples of its sampler into the active dof limits')
+        self.LoadEnv('data/lab1.env.xml')
+        robot = self.env.GetRobots()[0]
+        lower,upper = robot.GetActiveDOFLimits()
+        circular = []
+        for dof in robot.GetActiveDOFIndices():
+            joint = robot.GetJointFromDOFIndex(dof)
+            circular.append(joint.IsCircular(dof-joint.GetDOFIndex()))
+        lower = where(circular,-pi,lower)
+        upper = where(circular,pi,upper)
+        N = 1000
+        for samplername in ['mt19937','sfmt19937','halton']:
+            sp=RaveCreateSpaceSampler(self.env,'RobotConfiguration %s %s'%(robot.GetName(),samplername))
+            spunit=RaveCreateSpaceSampler(self.env,samplername)
+            sp1=RaveCreateSpaceSampler(self.env,'RobotConfiguration %s %s'%(robot.GetName(),samplername))
+            if spunit is None:
+                continue
+            spunit.SetSpaceDOF(robot.GetActiveDOF())
+            for s in [sp,spunit,sp1]:
+                s.SetSeed(1234)
+            values = reshape(sp.SampleSequence(SampleDataType.Real,N),(N,robot.GetActiveDOF()))
+            unitvalues = reshape(spunit.SampleSequence(SampleDataType.Real,N),(N,robot.GetActiveDOF()))
+            assert(all(abs(values - (lower+unitvalues*(upper-lower))) <= g_epsilon))
+            assert(all(values >= tile(lower,(N,1))-g_epsilon) and all(values <= tile(upper,(N,1))+g_epsilon))
+            singlevalues = reshape(hstack([sp1.SampleSequence(SampleDataType.Real,1) for i in range(N)]),(N,robot.GetActiveDOF()))
+            assert(all(values == singlevalues))
@@ -12,6 +12,7 @@
 # See the License for the specific language governing permissions and
 # limitations under the License.
 from common_test_openrave import *
+import threading
 
 class TestTrajectory(EnvironmentSetup):
     def test_merging(self):
@@ -835,3 +836,202 @@ class TestTrajectory(EnvironmentSetup):
             assert( sum(abs(traj.GetWaypoint(-1, robot.GetActiveConfigurationSpecification())-jitteredgoal)) <= g_epsilon)
             planningutils.VerifyTrajectory(parameters, traj,0.01)
             
+
+    def test_chunkedtraj(self):
+        self.log.info('compare the chunked trajectory against the generic trajectory with random inserts, removes, and samples')
+        env=self.env
+        spec = ConfigurationSpecification()
+        spec.AddGroup('joint_values',3,'linear')
+        spec.AddDeltaTimeGroup()
+        dof = spec.GetDOF()
+        traj = RaveCreateTrajectory(env,'')
+        chunkedtraj = RaveCreateTrajectory(env,'ChunkedTrajectory')
+        chunkedtraj.SendCommand('SetChunkSize 4')
+        traj.Init(spec)
+        chunkedtraj.Init(spec)
+        def checktrajs():
+            assert(traj.GetNumWaypoints()==chunkedtraj.GetNumWaypoints())
+            if traj.GetNumWaypoints() > 0:
+                assert(transdist(traj.GetWaypoints(0,traj.GetNumWaypoints()),chunkedtraj.GetWaypoints(0,chunkedtraj.GetNumWaypoints())) <= g_epsilon)
+                assert(abs(traj.GetDuration()-chunkedtraj.GetDuration()) <= g_epsilon)
+                for t in random.rand(5)*traj.GetDuration():
+                    assert(transdist(traj.Sample(t),chunkedtraj.Sample(t)) <= g_epsilon)
+
+        random.seed(0)
+        for itest in range(300):
+            numwaypoints = traj.GetNumWaypoints()
+            if numwaypoints > 0 and random.rand() < 0.3:
+                startindex = random.randint(numwaypoints)
+                endindex = random.randint(startindex,numwaypoints+1)
+                traj.Remove(startindex,endindex)
+                chunkedtraj.Remove(startindex,endindex)
+            else:
+                index = random.randint(numwaypoints+1)
+                data = random.rand(dof*random.randint(1,10))
+                traj.Insert(index,data)
+                chunkedtraj.Insert(index,data)
+            checktrajs()
+
+        # save over the file that the trajectory is mapped from
+        filename = 'testchunkedtraj.bin'
+        try:
+            assert(chunkedtraj.SendCommand('SaveBinary %s'%filename) is not None)
+            assert(chunkedtraj.SendCommand('LoadBinary %s'%filename) is not None)
+            checktrajs()
+            index = chunkedtraj.GetNumWaypoints()//2
+            data = random.rand(dof*3)
+            traj.Insert(index,data)
+            chunkedtraj.Insert(index,data)
+            assert(chunkedtraj.SendCommand('SaveBinary %s'%filename) is not None)
+            checktrajs()
+            assert(chunkedtraj.SendCommand('LoadBinary %s'%filename) is not None)
+            checktrajs()
+
+            # sample the mapped trajectory from several threads, SampleTrajectoryInto releases the GIL
+            times = random.rand(200)*traj.GetDuration()
+            expected = reshape([traj.Sample(t) for t in times],(len(times),dof))
+            threadresults = [zeros((len(times),dof)) for i in range(4)]
+            threads = [threading.Thread(target=chunkedtraj.SampleTrajectoryInto,args=(times,out)) for out in threadresults]
+            for t in threads:
+                t.start()
+            for t in threads:
+                t.join()
+            for out in threadresults:
+                assert(transdist(out,expected) <= g_epsilon)
+
+            # the clone shares the mapped file, but modifying it does not change the original
+            clonedtraj = RaveCreateTrajectory(env,'ChunkedTrajectory')
+            clonedtraj.Clone(chunkedtraj,0)
+            assert(clonedtraj.GetNumWaypoints()==traj.GetNumWaypoints())
+            assert(transdist(clonedtraj.GetWaypoints(0,clonedtraj.GetNumWaypoints()),traj.GetWaypoints(0,traj.GetNumWaypoints())) <= g_epsilon)
+            for t in random.rand(5)*traj.GetDuration():
+                assert(transdist(traj.Sample(t),clonedtraj.Sample(t)) <= g_epsilon)
+            clonedtraj.Remove(0,2)
+            clonedtraj.Insert(1,random.rand(dof*3))
+            checktrajs()
+            del clonedtraj
+            checktrajs()
+        finally:
+            os.remove(filename)
+
+    def test_convertedsampling(self):
+        self.log.info('check that sampling and getting waypoints in another specification gives the same results as ConvertData')
+        env=self.env
+        self.LoadEnv('data/lab1.env.xml')
+        with env:
+            robot=env.GetRobots()[0]
+            robot.SetActiveDOFs(range(7))
+            spec = robot.GetActiveConfigurationSpecification('linear')
+            spec.AddDerivativeGroups(1,False)
+            spec.AddDeltaTimeGroup()
+            traj = RaveCreateTrajectory(env,'')
+            traj.Init(spec)
+            lower,upper = robot.GetActiveDOFLimits()
+            values = randlimits(lower,upper)
+            for i in range(10):
+                prevvalues = values
+                values = randlimits(lower,upper)
+                deltatime = 0.1+random.rand()
+                waypoint = zeros(spec.GetDOF())
+                spec.InsertJointValues(waypoint,values,robot,robot.GetActiveDOFIndices(),0)
+                # the velocities of the linear segment ending at the waypoint, so that the trajectory is valid
+                spec.InsertJointValues(waypoint,(values-prevvalues)/deltatime,robot,robot.GetActiveDOFIndices(),1)
+                spec.InsertDeltaTime(waypoint,deltatime)
+                traj.Insert(traj.GetNumWaypoints(),waypoint)
+            # permuted subset of the joints, and groups that are not in the trajectory and filled from the robot
+            targetspec = ConfigurationSpecification()
+            targetspec.AddGroup('joint_values %s 3 1 5'%robot.GetName(),3,'linear')
+            targetspec.AddGroup('affine_transform %s %d'%(robot.GetName(),DOFAffine.Transform),RaveGetAffineDOF(DOFAffine.Transform),'linear')
+            targetspec.AddGroup('joint_velocities %s 0 1'%robot.GetName(),2,'linear')
+            robot.SetTransform(matrixFromAxisAngle(random.rand(3)))
+            robot.SetDOFValues(randlimits(*robot.GetDOFLimits()))
+            times = random.rand(20)*traj.GetDuration()*1.1
+            out = zeros((len(times),targetspec.GetDOF()))
+            traj.SampleTrajectoryInto(times,out,targetspec)
+            for t,values in izip(times,out):
+                expected = spec.ConvertData(targetspec,traj.Sample(t),1,env,True)
+                assert(transdist(traj.Sample(t,targetspec),expected) <= g_epsilon)
+                assert(transdist(values,expected) <= g_epsilon)
+            expected = spec.ConvertData(targetspec,traj.GetWaypoints(0,traj.GetNumWaypoints()),traj.GetNumWaypoints(),env,True)
+            assert(transdist(traj.GetWaypoints(0,traj.GetNumWaypoints(),targetspec),expected) <= g_epsilon)
+            # the default values have to follow the robot after the converter is cached
+            robot.SetTransform(eye(4))
+            expected = spec.ConvertData(targetspec,traj.Sample(0.5),1,env,True)
+            assert(transdist(traj.Sample(0.5,targetspec),expected) <= g_epsilon)
+
+    def test_trajectorysampler(self):
+        self.log.info('compare the trajectory samplers with Sample at random, increasing, backward and waypoint times')
+        env=self.env
+        random.seed(0)
+        dof = 3
+        numwaypoints = 20
+        def integrate(values,derivs,deltatimes,interpolation):
+            # make the values consistent with their derivatives for the interpolations that the trajectory validates
+            for i in range(1,len(values)):
+                if interpolation == 'linear':
+                    values[i] = values[i-1] + deltatimes[i]*derivs[i]
+                elif interpolation == 'quadratic':
+                    values[i] = values[i-1] + 0.5*deltatimes[i]*(derivs[i-1]+derivs[i])
+
+        for interpolation,derivativeinterpolation in [('linear','next'),('quadratic','linear'),('cubic','quadratic'),('quintic','quartic'),('sextic','quartic')]:
+            spec = ConfigurationSpecification()
+            spec.AddGroup('joint_values dummy 0 1 2',dof,interpolation)
+            spec.AddGroup('joint_velocities dummy 0 1 2',dof,derivativeinterpolation)
+            spec.AddGroup('joint_accelerations dummy 0 1 2',dof,'next')
+            spec.AddGroup('joint_jerks dummy 0 1 2',dof,'next')
+            spec.AddDeltaTimeGroup()
+            valuesspec = ConfigurationSpecification()
+            valuesspec.AddGroup('joint_values dummy 2 0',2,interpolation)
+            data = random.rand(numwaypoints,spec.GetDOF())-0.5
+            deltatimes = 0.05+random.rand(numwaypoints)
+            data[:,-1] = deltatimes
+            integrate(data[:,3:6],data[:,6:9],deltatimes,derivativeinterpolation)
+            integrate(data[:,0:3],data[:,3:6],deltatimes,interpolation)
+            waypointtimes = cumsum(deltatimes)
+            # the generic trajectory has its own cursor, the chunked trajectory uses the default sampler of TrajectoryBase
+            for trajname in ['','ChunkedTrajectory']:
+                traj = RaveCreateTrajectory(env,trajname)
+                traj.Init(spec)
+                traj.Insert(0,data.flatten())
+                sampler = traj.CreateSampler()
+                def checktimes(times):
+                    for t in times:
+                        assert(transdist(sampler.Sample(t),traj.Sample(t)) <= g_epsilon)
+                        assert(transdist(sampler.Sample(t,valuesspec),traj.Sample(t,valuesspec)) <= g_epsilon)
+                        assert(sampler.GetFirstWaypointIndexAfterTime(t)==traj.GetFirstWaypointIndexAfterTime(t))
+
+                duration = traj.GetDuration()
+                checktimes(sort(random.rand(200))*duration)
+                checktimes(random.rand(200)*duration)
+                checktimes(sort(random.rand(100))[::-1]*duration)
+                checktimes(r_[waypointtimes,waypointtimes[::-1],[0,duration,duration+0.1]])
+                # the sampler has to follow modifications of the trajectory
+                traj.Remove(15,numwaypoints)
+                checktimes(sort(random.rand(100))*duration)
+                traj.Insert(15,data[15:].flatten())
+                checktimes(sort(random.rand(100))*duration)
+
+    def test_sampletrajectoryinto(self):
+        self.log.info('compare sampling many times into a preallocated array with sampling every time')
+        env=self.env
+        spec = ConfigurationSpecification()
+        spec.AddGroup('joint_values',3,'linear')
+        spec.AddDeltaTimeGroup()
+        dof = spec.GetDOF()
+        traj = RaveCreateTrajectory(env,'')
+        traj.Init(spec)
+        data = random.rand(dof*20)
+        traj.Insert(0,data)
+        valuesspec = ConfigurationSpecification()
+        valuesspec.AddGroup('joint_values',3,'linear')
+        # increasing times and times out of order
+        for times in [sort(random.rand(50))*traj.GetDuration(), random.rand(50)*traj.GetDuration(), array([])]:
+            out = zeros((len(times),dof))
+            traj.SampleTrajectoryInto(times,out)
+            for t,values in izip(times,out):
+                assert(transdist(values,traj.Sample(t)) <= g_epsilon)
+            valuesout = zeros((len(times),3))
+            traj.SampleTrajectoryInto(times,valuesout,valuesspec)
+            for t,values in izip(times,valuesout):
+                assert(transdist(values,traj.Sample(t,valuesspec)) <= g_epsilon)
+        assert_raises(openrave_exception,traj.SampleTrajectoryInto,[0.0],zeros(dof+1))